@@ -0,0 +1,401 @@
+/****************************************************************************
+ * apps/benchmarks/aiobench/aiobench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <aio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef CONFIG_FS_AIO_RING
+#  include <sys/aioring.h>
+#endif
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define AIOBENCH_DEFAULT_OPS    4096
+#define AIOBENCH_DEFAULT_DEPTH  8
+#define AIOBENCH_DEFAULT_BSIZE  512
+#define AIOBENCH_NBLOCKS        64
+#define AIOBENCH_MAX_DEPTH      64
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct aiobench_s
+{
+  int fd;               /* The test file */
+  int nops;             /* Number of reads per test */
+  int depth;            /* Number of reads in flight */
+  size_t bsize;         /* Size of each read */
+  FAR char *buffer;     /* depth * bsize bytes */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void show_usage(FAR const char *progname, int exitcode)
+{
+  printf("\nUsage: %s [-f file] [-n ops] [-q depth] [-b bytes]\n",
+         progname);
+  printf("\nWhere:\n");
+  printf("  -f test file (default: %s)\n", CONFIG_BENCHMARK_AIOBENCH_PATH);
+  printf("  -n number of reads per test (default: %d)\n",
+         AIOBENCH_DEFAULT_OPS);
+  printf("  -q number of reads in flight, at most %d (default: %d)\n",
+         AIOBENCH_MAX_DEPTH, AIOBENCH_DEFAULT_DEPTH);
+  printf("  -b size of each read (default: %d)\n", AIOBENCH_DEFAULT_BSIZE);
+  exit(exitcode);
+}
+
+static uint64_t aiobench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static off_t aiobench_offset(FAR struct aiobench_s *bench, int op)
+{
+  return (off_t)(op % AIOBENCH_NBLOCKS) * bench->bsize;
+}
+
+static void aiobench_prepare(FAR struct aiobench_s *bench,
+                             FAR struct aiocb *cb, int slot, int op)
+{
+  memset(cb, 0, sizeof(*cb));
+  cb->aio_fildes = bench->fd;
+  cb->aio_buf    = bench->buffer + slot * bench->bsize;
+  cb->aio_nbytes = bench->bsize;
+  cb->aio_offset = aiobench_offset(bench, op);
+  cb->aio_sigevent.sigev_notify = SIGEV_NONE;
+}
+
+/* Keep 'depth' reads in flight with aio_read() and wait for them one by
+ * one with aio_suspend().
+ */
+
+static int aiobench_posix(FAR struct aiobench_s *bench)
+{
+  struct aiocb cbs[AIOBENCH_MAX_DEPTH];
+  FAR const struct aiocb *list[1];
+  int submitted = 0;
+  int completed = 0;
+  int slot;
+
+  for (slot = 0; slot < bench->depth && submitted < bench->nops; slot++)
+    {
+      aiobench_prepare(bench, &cbs[slot], slot, submitted++);
+      if (aio_read(&cbs[slot]) < 0)
+        {
+          return -errno;
+        }
+    }
+
+  for (slot = 0; completed < bench->nops; slot = (slot + 1) % bench->depth)
+    {
+      list[0] = &cbs[slot];
+      while (aio_error(&cbs[slot]) == EINPROGRESS)
+        {
+          aio_suspend(list, 1, NULL);
+        }
+
+      if (aio_return(&cbs[slot]) != bench->bsize)
+        {
+          return -EIO;
+        }
+
+      completed++;
+
+      if (submitted < bench->nops)
+        {
+          aiobench_prepare(bench, &cbs[slot], slot, submitted++);
+          if (aio_read(&cbs[slot]) < 0)
+            {
+              return -errno;
+            }
+        }
+    }
+
+  return OK;
+}
+
+/* Submit the reads 'depth' at a time with lio_listio(LIO_WAIT) */
+
+static int aiobench_listio(FAR struct aiobench_s *bench)
+{
+  struct aiocb cbs[AIOBENCH_MAX_DEPTH];
+  FAR struct aiocb *list[AIOBENCH_MAX_DEPTH];
+  int done = 0;
+  int count;
+  int i;
+
+  while (done < bench->nops)
+    {
+      count = bench->nops - done;
+      if (count > bench->depth)
+        {
+          count = bench->depth;
+        }
+
+      for (i = 0; i < count; i++)
+        {
+          aiobench_prepare(bench, &cbs[i], i, done + i);
+          cbs[i].aio_lio_opcode = LIO_READ;
+          list[i] = &cbs[i];
+        }
+
+      if (lio_listio(LIO_WAIT, list, count, NULL) < 0)
+        {
+          return -errno;
+        }
+
+      for (i = 0; i < count; i++)
+        {
+          if (aio_return(&cbs[i]) != bench->bsize)
+            {
+              return -EIO;
+            }
+        }
+
+      done += count;
+    }
+
+  return OK;
+}
+
+#ifdef CONFIG_FS_AIO_RING
+static void aiobench_queue(FAR struct aiobench_s *bench,
+                           FAR struct aioring_s *ring, int slot, int op)
+{
+  FAR struct aioring_sqe_s *sqe = aioring_get_sqe(ring);
+
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode    = AIORING_OP_READ;
+  sqe->fd        = bench->fd;
+  sqe->off       = aiobench_offset(bench, op);
+  sqe->addr      = bench->buffer + slot * bench->bsize;
+  sqe->len       = bench->bsize;
+  sqe->user_data = slot;
+}
+
+/* Keep 'depth' reads in flight in a ring: reap the completions from the
+ * ring and submit the replacements with one aioring_enter() per batch.
+ */
+
+static int aiobench_ring(FAR struct aiobench_s *bench)
+{
+  FAR struct aioring_cqe_s *cqe;
+  FAR struct aioring_s *ring;
+  int submitted = 0;
+  int completed = 0;
+  int pending = 0;
+  int ret = OK;
+  int slot;
+  int fd;
+
+  fd = aioring_setup(bench->depth, &ring);
+  if (fd < 0)
+    {
+      return -errno;
+    }
+
+  for (slot = 0; slot < bench->depth && submitted < bench->nops; slot++)
+    {
+      aiobench_queue(bench, ring, slot, submitted++);
+      pending++;
+    }
+
+  while (completed < bench->nops)
+    {
+      if (aioring_enter(fd, pending, 1, AIORING_ENTER_GETEVENTS) < 0)
+        {
+          ret = -errno;
+          break;
+        }
+
+      pending = 0;
+      while ((cqe = aioring_peek_cqe(ring)) != NULL)
+        {
+          slot = cqe->user_data;
+          if (cqe->res != bench->bsize)
+            {
+              ret = cqe->res < 0 ? cqe->res : -EIO;
+            }
+
+          aioring_cqe_seen(ring);
+          completed++;
+
+          if (submitted < bench->nops)
+            {
+              aiobench_queue(bench, ring, slot, submitted++);
+              pending++;
+            }
+        }
+
+      if (ret < 0)
+        {
+          break;
+        }
+    }
+
+  close(fd);
+  return ret;
+}
+#endif
+
+static void aiobench_run(FAR struct aiobench_s *bench, FAR const char *name,
+                         CODE int (*test)(FAR struct aiobench_s *bench))
+{
+  uint64_t start;
+  uint64_t elapsed;
+  int ret;
+
+  start   = aiobench_now();
+  ret     = test(bench);
+  elapsed = aiobench_now() - start;
+
+  if (ret < 0)
+    {
+      printf("%-12s failed: %d\n", name, ret);
+    }
+  else if (elapsed > 0)
+    {
+      printf("%-12s %8d reads in %10" PRIu64 " us, %8" PRIu64 " ops/s\n",
+             name, bench->nops, elapsed,
+             (uint64_t)bench->nops * 1000000 / elapsed);
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * aiobench_main
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  FAR const char *path = CONFIG_BENCHMARK_AIOBENCH_PATH;
+  struct aiobench_s bench;
+  int option;
+  int i;
+
+  bench.nops  = AIOBENCH_DEFAULT_OPS;
+  bench.depth = AIOBENCH_DEFAULT_DEPTH;
+  bench.bsize = AIOBENCH_DEFAULT_BSIZE;
+
+  while ((option = getopt(argc, argv, "f:n:q:b:h")) != ERROR)
+    {
+      switch (option)
+        {
+          case 'f':
+            path = optarg;
+            break;
+
+          case 'n':
+            bench.nops = atoi(optarg);
+            break;
+
+          case 'q':
+            bench.depth = atoi(optarg);
+            break;
+
+          case 'b':
+            bench.bsize = atoi(optarg);
+            break;
+
+          case 'h':
+            show_usage(argv[0], EXIT_SUCCESS);
+            break;
+
+          default:
+            show_usage(argv[0], EXIT_FAILURE);
+            break;
+        }
+    }
+
+  if (bench.nops <= 0 || bench.depth <= 0 ||
+      bench.depth > AIOBENCH_MAX_DEPTH || bench.bsize == 0)
+    {
+      show_usage(argv[0], EXIT_FAILURE);
+    }
+
+  bench.buffer = malloc(bench.depth * bench.bsize);
+  if (bench.buffer == NULL)
+    {
+      printf("Failed to allocate the buffers\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Create the test file */
+
+  bench.fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (bench.fd < 0)
+    {
+      printf("Failed to create %s: %d\n", path, errno);
+      free(bench.buffer);
+      return EXIT_FAILURE;
+    }
+
+  memset(bench.buffer, 0xa5, bench.bsize);
+  for (i = 0; i < AIOBENCH_NBLOCKS; i++)
+    {
+      if (write(bench.fd, bench.buffer, bench.bsize) != bench.bsize)
+        {
+          printf("Failed to write %s: %d\n", path, errno);
+          goto out;
+        }
+    }
+
+  printf("%d reads of %zu bytes, %d in flight\n",
+         bench.nops, bench.bsize, bench.depth);
+
+  aiobench_run(&bench, "aio_read", aiobench_posix);
+  aiobench_run(&bench, "lio_listio", aiobench_listio);
+#ifdef CONFIG_FS_AIO_RING
+  aiobench_run(&bench, "aioring", aiobench_ring);
+#endif
+
+out:
+  close(bench.fd);
+  unlink(path);
+  free(bench.buffer);
+  return EXIT_SUCCESS;
+}
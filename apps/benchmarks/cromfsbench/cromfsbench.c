@@ -0,0 +1,266 @@
+/****************************************************************************
+ * apps/benchmarks/cromfsbench/cromfsbench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/mount.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define CROMFSBENCH_FILE            CONFIG_BENCHMARK_CROMFSBENCH_MOUNTPT \
+                                    "/data.txt"
+#define CROMFSBENCH_DEFAULT_BSIZE   256
+#define CROMFSBENCH_DEFAULT_READS   4096
+#define CROMFSBENCH_DEFAULT_READERS 2
+#define CROMFSBENCH_MAX_READERS     8
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct cromfsbench_s
+{
+  int fds[CROMFSBENCH_MAX_READERS]; /* Readers of the test file */
+  int nreaders;                     /* Number of readers */
+  int nreads;                       /* Number of random reads */
+  size_t bsize;                     /* Size of each read */
+  off_t fsize;                      /* Size of the test file */
+  FAR char *buffer;                 /* bsize bytes */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void show_usage(FAR const char *progname, int exitcode)
+{
+  printf("\nUsage: %s [-b bytes] [-n reads] [-r readers]\n", progname);
+  printf("\nWhere:\n");
+  printf("  -b size of each read (default: %d)\n",
+         CROMFSBENCH_DEFAULT_BSIZE);
+  printf("  -n number of random reads (default: %d)\n",
+         CROMFSBENCH_DEFAULT_READS);
+  printf("  -r number of readers of the file, at most %d (default: %d)\n",
+         CROMFSBENCH_MAX_READERS, CROMFSBENCH_DEFAULT_READERS);
+  exit(exitcode);
+}
+
+static uint64_t cromfsbench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Read the whole file from the beginning with the first reader */
+
+static ssize_t cromfsbench_sequential(FAR struct cromfsbench_s *bench)
+{
+  ssize_t total = 0;
+  ssize_t nread;
+
+  if (lseek(bench->fds[0], 0, SEEK_SET) < 0)
+    {
+      return -errno;
+    }
+
+  while ((nread = read(bench->fds[0], bench->buffer, bench->bsize)) > 0)
+    {
+      total += nread;
+    }
+
+  return nread < 0 ? -errno : total;
+}
+
+/* Read at random offsets, taking turns between the readers */
+
+static ssize_t cromfsbench_random(FAR struct cromfsbench_s *bench)
+{
+  ssize_t total = 0;
+  ssize_t nread;
+  off_t offset;
+  int fd;
+  int i;
+
+  srand(1);
+  for (i = 0; i < bench->nreads; i++)
+    {
+      fd     = bench->fds[i % bench->nreaders];
+      offset = rand() % bench->fsize;
+
+      nread = pread(fd, bench->buffer, bench->bsize, offset);
+      if (nread < 0)
+        {
+          return -errno;
+        }
+
+      total += nread;
+    }
+
+  return total;
+}
+
+static void cromfsbench_run(FAR struct cromfsbench_s *bench,
+                            FAR const char *name,
+                            CODE ssize_t (*test)(FAR struct cromfsbench_s *))
+{
+  uint64_t start;
+  uint64_t elapsed;
+  ssize_t ret;
+
+  start   = cromfsbench_now();
+  ret     = test(bench);
+  elapsed = cromfsbench_now() - start;
+
+  if (ret < 0)
+    {
+      printf("%-12s failed: %zd\n", name, ret);
+    }
+  else if (elapsed > 0)
+    {
+      printf("%-12s %8zd bytes in %10" PRIu64 " us, %8" PRIu64 " KB/s\n",
+             name, ret, elapsed, (uint64_t)ret * 1000000 / 1024 / elapsed);
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * cromfsbench_main
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct cromfsbench_s bench;
+  bool mounted = false;
+  int ret = EXIT_SUCCESS;
+  int option;
+  int i;
+
+  bench.bsize    = CROMFSBENCH_DEFAULT_BSIZE;
+  bench.nreads   = CROMFSBENCH_DEFAULT_READS;
+  bench.nreaders = CROMFSBENCH_DEFAULT_READERS;
+
+  while ((option = getopt(argc, argv, "b:n:r:h")) != ERROR)
+    {
+      switch (option)
+        {
+          case 'b':
+            bench.bsize = atoi(optarg);
+            break;
+
+          case 'n':
+            bench.nreads = atoi(optarg);
+            break;
+
+          case 'r':
+            bench.nreaders = atoi(optarg);
+            break;
+
+          case 'h':
+            show_usage(argv[0], EXIT_SUCCESS);
+            break;
+
+          default:
+            show_usage(argv[0], EXIT_FAILURE);
+            break;
+        }
+    }
+
+  if (bench.bsize == 0 || bench.nreads <= 0 || bench.nreaders <= 0 ||
+      bench.nreaders > CROMFSBENCH_MAX_READERS)
+    {
+      show_usage(argv[0], EXIT_FAILURE);
+    }
+
+  bench.buffer = malloc(bench.bsize);
+  if (bench.buffer == NULL)
+    {
+      printf("Failed to allocate the buffer\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Mount the image unless that was already done */
+
+  if (mount(NULL, CONFIG_BENCHMARK_CROMFSBENCH_MOUNTPT, "cromfs",
+            MS_RDONLY, NULL) == 0)
+    {
+      mounted = true;
+    }
+
+  for (i = 0; i < bench.nreaders; i++)
+    {
+      bench.fds[i] = open(CROMFSBENCH_FILE, O_RDONLY);
+      if (bench.fds[i] < 0)
+        {
+          printf("Failed to open %s: %d\n", CROMFSBENCH_FILE, errno);
+          ret = EXIT_FAILURE;
+          goto out;
+        }
+    }
+
+  bench.fsize = lseek(bench.fds[0], 0, SEEK_END);
+  if (bench.fsize <= 0)
+    {
+      printf("Failed to get the size of %s\n", CROMFSBENCH_FILE);
+      ret = EXIT_FAILURE;
+      goto out;
+    }
+
+  printf("%jd bytes, reads of %zu bytes, %d readers\n",
+         (intmax_t)bench.fsize, bench.bsize, bench.nreaders);
+
+  cromfsbench_run(&bench, "sequential", cromfsbench_sequential);
+  cromfsbench_run(&bench, "random", cromfsbench_random);
+
+out:
+  while (i-- > 0)
+    {
+      close(bench.fds[i]);
+    }
+
+  if (mounted)
+    {
+      umount(CONFIG_BENCHMARK_CROMFSBENCH_MOUNTPT);
+    }
+
+  free(bench.buffer);
+  return ret;
+}
@@ -0,0 +1,339 @@
+/****************************************************************************
+ * apps/benchmarks/epollbench/epollbench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/epoll.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define EPOLLBENCH_DEFAULT_IDLE     256
+#define EPOLLBENCH_DEFAULT_ACTIVE   1
+#define EPOLLBENCH_DEFAULT_ROUNDS   1000
+#define EPOLLBENCH_MAX_ACTIVE       16
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct epollbench_s
+{
+  int nidle;            /* Number of idle pipes in this run */
+  int nactive;          /* Number of pipes written in every round */
+  int rounds;           /* Number of rounds per test */
+  FAR int (*pipes)[2];  /* nactive active pipes followed by the idle ones */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void show_usage(FAR const char *progname, int exitcode)
+{
+  printf("\nUsage: %s [-i idle] [-a active] [-n rounds]\n", progname);
+  printf("\nWhere:\n");
+  printf("  -i largest number of idle pipes (default: %d)\n",
+         EPOLLBENCH_DEFAULT_IDLE);
+  printf("  -a number of active pipes, at most %d (default: %d)\n",
+         EPOLLBENCH_MAX_ACTIVE, EPOLLBENCH_DEFAULT_ACTIVE);
+  printf("  -n number of rounds per test (default: %d)\n",
+         EPOLLBENCH_DEFAULT_ROUNDS);
+  exit(exitcode);
+}
+
+static uint64_t epollbench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Make the active pipes readable */
+
+static int epollbench_kick(FAR struct epollbench_s *bench)
+{
+  int i;
+
+  for (i = 0; i < bench->nactive; i++)
+    {
+      if (write(bench->pipes[i][1], "x", 1) != 1)
+        {
+          return -errno;
+        }
+    }
+
+  return OK;
+}
+
+static int epollbench_drain(FAR struct epollbench_s *bench, int fd)
+{
+  char c;
+
+  return read(fd, &c, 1) == 1 ? OK : -errno;
+}
+
+/* Every round makes the active pipes readable and waits with epoll_wait()
+ * until all of them were reported and drained.
+ */
+
+static int epollbench_epoll(FAR struct epollbench_s *bench)
+{
+  struct epoll_event evs[EPOLLBENCH_MAX_ACTIVE];
+  struct epoll_event ev;
+  int total = bench->nactive + bench->nidle;
+  int ret = OK;
+  int round;
+  int epfd;
+  int done;
+  int n;
+  int i;
+
+  epfd = epoll_create1(EPOLL_CLOEXEC);
+  if (epfd < 0)
+    {
+      return -errno;
+    }
+
+  for (i = 0; i < total; i++)
+    {
+      ev.events  = EPOLLIN;
+      ev.data.fd = bench->pipes[i][0];
+      if (epoll_ctl(epfd, EPOLL_CTL_ADD, bench->pipes[i][0], &ev) < 0)
+        {
+          ret = -errno;
+          goto out;
+        }
+    }
+
+  for (round = 0; round < bench->rounds && ret >= 0; round++)
+    {
+      ret = epollbench_kick(bench);
+      for (done = 0; done < bench->nactive && ret >= 0; done += n)
+        {
+          n = epoll_wait(epfd, evs, EPOLLBENCH_MAX_ACTIVE, -1);
+          if (n < 0)
+            {
+              ret = -errno;
+              break;
+            }
+
+          for (i = 0; i < n && ret >= 0; i++)
+            {
+              ret = epollbench_drain(bench, evs[i].data.fd);
+            }
+        }
+    }
+
+out:
+  close(epfd);
+  return ret;
+}
+
+/* The same rounds with poll() over all the pipes */
+
+static int epollbench_poll(FAR struct epollbench_s *bench)
+{
+  int total = bench->nactive + bench->nidle;
+  FAR struct pollfd *fds;
+  int ret = OK;
+  int round;
+  int done;
+  int n;
+  int i;
+
+  fds = malloc(total * sizeof(*fds));
+  if (fds == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  for (i = 0; i < total; i++)
+    {
+      fds[i].fd     = bench->pipes[i][0];
+      fds[i].events = POLLIN;
+    }
+
+  for (round = 0; round < bench->rounds && ret >= 0; round++)
+    {
+      ret = epollbench_kick(bench);
+      for (done = 0; done < bench->nactive && ret >= 0; done += n)
+        {
+          n = poll(fds, total, -1);
+          if (n < 0)
+            {
+              ret = -errno;
+              break;
+            }
+
+          for (i = 0; i < total && ret >= 0; i++)
+            {
+              if (fds[i].revents & POLLIN)
+                {
+                  ret = epollbench_drain(bench, fds[i].fd);
+                }
+            }
+        }
+    }
+
+  free(fds);
+  return ret;
+}
+
+static void epollbench_run(FAR struct epollbench_s *bench,
+                           FAR const char *name,
+                           CODE int (*test)(FAR struct epollbench_s *bench))
+{
+  uint64_t start;
+  uint64_t elapsed;
+  int ret;
+
+  start   = epollbench_now();
+  ret     = test(bench);
+  elapsed = epollbench_now() - start;
+
+  if (ret < 0)
+    {
+      printf("%-8s %6d idle: failed: %d\n", name, bench->nidle, ret);
+    }
+  else
+    {
+      printf("%-8s %6d idle: %8" PRIu64 " ns per round\n", name,
+             bench->nidle, elapsed * 1000 / bench->rounds);
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * epollbench_main
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct epollbench_s bench;
+  int maxidle = EPOLLBENCH_DEFAULT_IDLE;
+  int npipes = 0;
+  int option;
+  int ret = EXIT_SUCCESS;
+  int i;
+
+  bench.nactive = EPOLLBENCH_DEFAULT_ACTIVE;
+  bench.rounds  = EPOLLBENCH_DEFAULT_ROUNDS;
+
+  while ((option = getopt(argc, argv, "i:a:n:h")) != ERROR)
+    {
+      switch (option)
+        {
+          case 'i':
+            maxidle = atoi(optarg);
+            break;
+
+          case 'a':
+            bench.nactive = atoi(optarg);
+            break;
+
+          case 'n':
+            bench.rounds = atoi(optarg);
+            break;
+
+          case 'h':
+            show_usage(argv[0], EXIT_SUCCESS);
+            break;
+
+          default:
+            show_usage(argv[0], EXIT_FAILURE);
+            break;
+        }
+    }
+
+  if (maxidle < 0 || bench.nactive <= 0 ||
+      bench.nactive > EPOLLBENCH_MAX_ACTIVE || bench.rounds <= 0)
+    {
+      show_usage(argv[0], EXIT_FAILURE);
+    }
+
+  bench.pipes = malloc((bench.nactive + maxidle) * sizeof(*bench.pipes));
+  if (bench.pipes == NULL)
+    {
+      printf("Failed to allocate the pipes\n");
+      return EXIT_FAILURE;
+    }
+
+  for (npipes = 0; npipes < bench.nactive + maxidle; npipes++)
+    {
+      if (pipe(bench.pipes[npipes]) < 0)
+        {
+          printf("Failed to create pipe %d: %d\n", npipes, errno);
+          ret = EXIT_FAILURE;
+          goto out;
+        }
+    }
+
+  printf("%d active pipes, %d rounds\n", bench.nactive, bench.rounds);
+
+  /* The cost of epoll_wait() should not depend on the number of idle
+   * descriptors, the cost of poll() grows with it.
+   */
+
+  for (bench.nidle = 0; ; bench.nidle = bench.nidle ? bench.nidle * 4 : 16)
+    {
+      if (bench.nidle > maxidle)
+        {
+          bench.nidle = maxidle;
+        }
+
+      epollbench_run(&bench, "epoll", epollbench_epoll);
+      epollbench_run(&bench, "poll", epollbench_poll);
+
+      if (bench.nidle == maxidle)
+        {
+          break;
+        }
+    }
+
+out:
+  for (i = 0; i < npipes; i++)
+    {
+      close(bench.pipes[i][0]);
+      close(bench.pipes[i][1]);
+    }
+
+  free(bench.pipes);
+  return ret;
+}
@@ -0,0 +1,309 @@
+/****************************************************************************
+ * apps/benchmarks/fdbench/fdbench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define FDBENCH_DEFAULT_IDLE        256
+#define FDBENCH_DEFAULT_THREADS     4
+#define FDBENCH_DEFAULT_ROUNDS      10000
+#define FDBENCH_MAX_THREADS         16
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct fdbench_s
+{
+  int nidle;            /* Number of idle pipes open in this run */
+  int nthreads;         /* Number of threads in this run */
+  int rounds;           /* Number of write and read pairs per thread */
+  FAR int (*pipes)[2];  /* One pipe per thread followed by the idle ones */
+};
+
+struct fdbench_thread_s
+{
+  FAR struct fdbench_s *bench;
+  int index;            /* Pipe of the thread */
+  int ret;              /* Result of the thread */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void show_usage(FAR const char *progname, int exitcode)
+{
+  printf("\nUsage: %s [-i idle] [-t threads] [-n rounds]\n", progname);
+  printf("\nWhere:\n");
+  printf("  -i largest number of idle pipes (default: %d)\n",
+         FDBENCH_DEFAULT_IDLE);
+  printf("  -t largest number of threads, at most %d (default: %d)\n",
+         FDBENCH_MAX_THREADS, FDBENCH_DEFAULT_THREADS);
+  printf("  -n number of rounds per thread (default: %d)\n",
+         FDBENCH_DEFAULT_ROUNDS);
+  exit(exitcode);
+}
+
+static uint64_t fdbench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Write a byte to the pipe of the thread and read it back, every call
+ * looks its descriptor up in the table of the task.
+ */
+
+static FAR void *fdbench_thread(FAR void *arg)
+{
+  FAR struct fdbench_thread_s *thread = arg;
+  FAR int *fds = thread->bench->pipes[thread->index];
+  char c = 'x';
+  int i;
+
+  for (i = 0; i < thread->bench->rounds; i++)
+    {
+      if (write(fds[1], &c, 1) != 1 || read(fds[0], &c, 1) != 1)
+        {
+          thread->ret = -errno;
+          break;
+        }
+    }
+
+  return NULL;
+}
+
+static void fdbench_io(FAR struct fdbench_s *bench)
+{
+  struct fdbench_thread_s threads[FDBENCH_MAX_THREADS];
+  pthread_t ids[FDBENCH_MAX_THREADS];
+  uint64_t elapsed;
+  uint64_t start;
+  int ret = OK;
+  int n;
+  int i;
+
+  start = fdbench_now();
+  for (n = 0; n < bench->nthreads; n++)
+    {
+      threads[n].bench = bench;
+      threads[n].index = n;
+      threads[n].ret   = OK;
+      ret = -pthread_create(&ids[n], NULL, fdbench_thread, &threads[n]);
+      if (ret < 0)
+        {
+          break;
+        }
+    }
+
+  for (i = 0; i < n; i++)
+    {
+      pthread_join(ids[i], NULL);
+      if (threads[i].ret < 0)
+        {
+          ret = threads[i].ret;
+        }
+    }
+
+  elapsed = fdbench_now() - start;
+
+  if (ret < 0)
+    {
+      printf("io    %6d idle %2d threads: failed: %d\n",
+             bench->nidle, bench->nthreads, ret);
+      return;
+    }
+
+  /* Two calls per round in every thread */
+
+  printf("io    %6d idle %2d threads: %8" PRIu64 " ns per call\n",
+         bench->nidle, bench->nthreads,
+         elapsed * 1000 / (2 * (uint64_t)bench->rounds * bench->nthreads));
+}
+
+/* dup() and close() with all the lower descriptors in use, the search for
+ * the lowest free descriptor walks past all of them.
+ */
+
+static void fdbench_alloc(FAR struct fdbench_s *bench)
+{
+  uint64_t elapsed;
+  uint64_t start;
+  int fd;
+  int i;
+
+  start = fdbench_now();
+  for (i = 0; i < bench->rounds; i++)
+    {
+      fd = dup(bench->pipes[0][0]);
+      if (fd < 0)
+        {
+          printf("alloc %6d idle: failed: %d\n", bench->nidle, errno);
+          return;
+        }
+
+      close(fd);
+    }
+
+  elapsed = fdbench_now() - start;
+  printf("alloc %6d idle: %8" PRIu64 " ns per dup and close\n",
+         bench->nidle, elapsed * 1000 / bench->rounds);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * fdbench_main
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct fdbench_s bench;
+  int maxthreads = FDBENCH_DEFAULT_THREADS;
+  int maxidle = FDBENCH_DEFAULT_IDLE;
+  int npipes = 0;
+  int option;
+  int ret = EXIT_SUCCESS;
+  int i;
+
+  bench.rounds = FDBENCH_DEFAULT_ROUNDS;
+
+  while ((option = getopt(argc, argv, "i:t:n:h")) != ERROR)
+    {
+      switch (option)
+        {
+          case 'i':
+            maxidle = atoi(optarg);
+            break;
+
+          case 't':
+            maxthreads = atoi(optarg);
+            break;
+
+          case 'n':
+            bench.rounds = atoi(optarg);
+            break;
+
+          case 'h':
+            show_usage(argv[0], EXIT_SUCCESS);
+            break;
+
+          default:
+            show_usage(argv[0], EXIT_FAILURE);
+            break;
+        }
+    }
+
+  if (maxidle < 0 || maxthreads <= 0 ||
+      maxthreads > FDBENCH_MAX_THREADS || bench.rounds <= 0)
+    {
+      show_usage(argv[0], EXIT_FAILURE);
+    }
+
+  bench.pipes = malloc((maxthreads + maxidle) * sizeof(*bench.pipes));
+  if (bench.pipes == NULL)
+    {
+      printf("Failed to allocate the pipes\n");
+      return EXIT_FAILURE;
+    }
+
+  for (npipes = 0; npipes < maxthreads; npipes++)
+    {
+      if (pipe(bench.pipes[npipes]) < 0)
+        {
+          printf("Failed to create pipe %d: %d\n", npipes, errno);
+          ret = EXIT_FAILURE;
+          goto out;
+        }
+    }
+
+  printf("%d rounds per thread\n", bench.rounds);
+
+  /* The cost of a call should depend neither on the number of open
+   * descriptors nor on the number of threads using the table.
+   */
+
+  for (bench.nidle = 0; ; bench.nidle = bench.nidle ? bench.nidle * 4 : 16)
+    {
+      if (bench.nidle > maxidle)
+        {
+          bench.nidle = maxidle;
+        }
+
+      /* Open the idle pipes of this run */
+
+      for (; npipes < maxthreads + bench.nidle; npipes++)
+        {
+          if (pipe(bench.pipes[npipes]) < 0)
+            {
+              printf("Failed to create pipe %d: %d\n", npipes, errno);
+              ret = EXIT_FAILURE;
+              goto out;
+            }
+        }
+
+      for (bench.nthreads = 1; bench.nthreads <= maxthreads;
+           bench.nthreads *= 2)
+        {
+          fdbench_io(&bench);
+        }
+
+      fdbench_alloc(&bench);
+
+      if (bench.nidle == maxidle)
+        {
+          break;
+        }
+    }
+
+out:
+  for (i = 0; i < npipes; i++)
+    {
+      close(bench.pipes[i][0]);
+      close(bench.pipes[i][1]);
+    }
+
+  free(bench.pipes);
+  return ret;
+}
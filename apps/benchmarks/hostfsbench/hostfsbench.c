@@ -0,0 +1,456 @@
+/****************************************************************************
+ * apps/benchmarks/hostfsbench/hostfsbench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/param.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define HOSTFSBENCH_DEFAULT_FILESIZE  (4 * 1024 * 1024)
+#define HOSTFSBENCH_DEFAULT_STATS     1000
+#define HOSTFSBENCH_DEFAULT_FILES     256
+#define HOSTFSBENCH_IDLE_USEC         1000000
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct hostfsbench_s
+{
+  char path[PATH_MAX];      /* File written and read */
+  char dir[PATH_MAX];       /* Directory listed */
+  size_t filesize;          /* Size of the file */
+  int stats;                /* Number of stat() calls */
+  int files;                /* Number of files in the directory */
+  FAR char *buf;            /* I/O buffer of the largest block size */
+  volatile bool stop;       /* Tells the CPU-bound thread to stop */
+  volatile uint64_t spins;  /* Work done by the CPU-bound thread */
+  uint64_t rate;            /* Its spins per second without I/O */
+};
+
+/* The I/O done by one measurement and the CPU-bound work next to it */
+
+struct hostfsbench_mark_s
+{
+  uint64_t start;
+  uint64_t spins;
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* Block sizes of the runs, from below a typical readahead to above it */
+
+static const size_t g_hostfsbench_bsizes[] =
+{
+  64, 512, 4096, 65536, 262144
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void show_usage(FAR const char *progname, int exitcode)
+{
+  printf("\nUsage: %s [-p path] [-s filesize] [-n stats] [-f files]\n",
+         progname);
+  printf("\nWhere:\n");
+  printf("  -p directory on the hostfs mount (default: %s)\n",
+         CONFIG_BENCHMARK_HOSTFSBENCH_MOUNTPT);
+  printf("  -s size of the file written and read (default: %d)\n",
+         HOSTFSBENCH_DEFAULT_FILESIZE);
+  printf("  -n number of stat() calls (default: %d)\n",
+         HOSTFSBENCH_DEFAULT_STATS);
+  printf("  -f number of files in the directory listed (default: %d)\n",
+         HOSTFSBENCH_DEFAULT_FILES);
+  exit(exitcode);
+}
+
+static uint64_t hostfsbench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Throughput in KiB/s of size bytes moved in elapsed microseconds */
+
+static uint64_t hostfsbench_kbps(size_t size, uint64_t elapsed)
+{
+  return elapsed ? (uint64_t)size * 1000000 / 1024 / elapsed : 0;
+}
+
+/* Run below the priority of the benchmark, so that it only gets the CPU
+ * while the I/O thread waits.  With synchronous host calls the I/O thread
+ * never waits and the whole simulation stalls in the host instead.
+ */
+
+static FAR void *hostfsbench_spin(FAR void *arg)
+{
+  FAR struct hostfsbench_s *bench = arg;
+  volatile uint32_t seed = 1;
+  int i;
+
+  while (!bench->stop)
+    {
+      for (i = 0; i < 1000; i++)
+        {
+          seed = seed * 1103515245 + 12345;
+        }
+
+      bench->spins++;
+    }
+
+  return NULL;
+}
+
+static void hostfsbench_begin(FAR struct hostfsbench_s *bench,
+                              FAR struct hostfsbench_mark_s *mark)
+{
+  mark->spins = bench->spins;
+  mark->start = hostfsbench_now();
+}
+
+/* Return the elapsed microseconds and the work of the CPU-bound thread
+ * in percent of its rate without I/O.
+ */
+
+static uint64_t hostfsbench_end(FAR struct hostfsbench_s *bench,
+                                FAR struct hostfsbench_mark_s *mark,
+                                FAR uint64_t *cpu)
+{
+  uint64_t elapsed = hostfsbench_now() - mark->start;
+  uint64_t spins = bench->spins - mark->spins;
+
+  *cpu = elapsed && bench->rate ?
+         spins * 1000000 * 100 / elapsed / bench->rate : 0;
+  return elapsed;
+}
+
+static int hostfsbench_write(FAR struct hostfsbench_s *bench, size_t bsize)
+{
+  size_t done;
+  ssize_t n;
+  int ret = OK;
+  int fd;
+
+  fd = open(bench->path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0)
+    {
+      return -errno;
+    }
+
+  for (done = 0; done < bench->filesize; done += n)
+    {
+      n = write(fd, bench->buf, MIN(bsize, bench->filesize - done));
+      if (n <= 0)
+        {
+          ret = n < 0 ? -errno : -EIO;
+          break;
+        }
+    }
+
+  if (ret >= 0 && fsync(fd) < 0)
+    {
+      ret = -errno;
+    }
+
+  if (close(fd) < 0 && ret >= 0)
+    {
+      ret = -errno;
+    }
+
+  return ret;
+}
+
+static int hostfsbench_read(FAR struct hostfsbench_s *bench, size_t bsize)
+{
+  size_t done;
+  ssize_t n;
+  int ret = OK;
+  int fd;
+
+  fd = open(bench->path, O_RDONLY);
+  if (fd < 0)
+    {
+      return -errno;
+    }
+
+  for (done = 0; done < bench->filesize; done += n)
+    {
+      n = read(fd, bench->buf, bsize);
+      if (n <= 0)
+        {
+          ret = n < 0 ? -errno : -EIO;
+          break;
+        }
+    }
+
+  close(fd);
+  return ret;
+}
+
+static void hostfsbench_run(FAR struct hostfsbench_s *bench, size_t bsize)
+{
+  struct hostfsbench_mark_s mark;
+  uint64_t wtime;
+  uint64_t rtime;
+  uint64_t wcpu;
+  uint64_t rcpu;
+  int ret;
+
+  hostfsbench_begin(bench, &mark);
+  ret   = hostfsbench_write(bench, bsize);
+  wtime = hostfsbench_end(bench, &mark, &wcpu);
+  if (ret < 0)
+    {
+      printf("%7zu: write failed: %d\n", bsize, ret);
+      return;
+    }
+
+  hostfsbench_begin(bench, &mark);
+  ret   = hostfsbench_read(bench, bsize);
+  rtime = hostfsbench_end(bench, &mark, &rcpu);
+  if (ret < 0)
+    {
+      printf("%7zu: read failed: %d\n", bsize, ret);
+      return;
+    }
+
+  printf("%7zu: write %8" PRIu64 " KiB/s cpu %3" PRIu64 "%%, "
+         "read %8" PRIu64 " KiB/s cpu %3" PRIu64 "%%\n",
+         bsize, hostfsbench_kbps(bench->filesize, wtime), wcpu,
+         hostfsbench_kbps(bench->filesize, rtime), rcpu);
+}
+
+static void hostfsbench_stat(FAR struct hostfsbench_s *bench)
+{
+  struct hostfsbench_mark_s mark;
+  struct stat st;
+  uint64_t elapsed;
+  uint64_t cpu;
+  int i;
+
+  hostfsbench_begin(bench, &mark);
+  for (i = 0; i < bench->stats; i++)
+    {
+      if (stat(bench->path, &st) < 0)
+        {
+          printf("stat failed: %d\n", errno);
+          return;
+        }
+    }
+
+  elapsed = hostfsbench_end(bench, &mark, &cpu);
+  printf("   stat: %8" PRIu64 " us per call, cpu %3" PRIu64 "%%\n",
+         elapsed / bench->stats, cpu);
+}
+
+/* List a directory of bench->files empty files */
+
+static void hostfsbench_readdir(FAR struct hostfsbench_s *bench)
+{
+  struct hostfsbench_mark_s mark;
+  char path[PATH_MAX];
+  FAR struct dirent *entry;
+  FAR DIR *dir;
+  uint64_t elapsed;
+  uint64_t cpu;
+  int entries = 0;
+  int fd;
+  int i;
+
+  if (mkdir(bench->dir, 0777) < 0 && errno != EEXIST)
+    {
+      printf("mkdir failed: %d\n", errno);
+      return;
+    }
+
+  for (i = 0; i < bench->files; i++)
+    {
+      snprintf(path, sizeof(path), "%s/%d", bench->dir, i);
+      fd = open(path, O_WRONLY | O_CREAT, 0666);
+      if (fd >= 0)
+        {
+          close(fd);
+        }
+    }
+
+  hostfsbench_begin(bench, &mark);
+  dir = opendir(bench->dir);
+  if (dir != NULL)
+    {
+      while ((entry = readdir(dir)) != NULL)
+        {
+          entries++;
+        }
+
+      closedir(dir);
+    }
+
+  elapsed = hostfsbench_end(bench, &mark, &cpu);
+  printf("readdir: %8" PRIu64 " us per entry, cpu %3" PRIu64 "%%\n",
+         entries ? elapsed / entries : 0, cpu);
+
+  for (i = 0; i < bench->files; i++)
+    {
+      snprintf(path, sizeof(path), "%s/%d", bench->dir, i);
+      unlink(path);
+    }
+
+  rmdir(bench->dir);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * hostfsbench_main
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  FAR const char *path = CONFIG_BENCHMARK_HOSTFSBENCH_MOUNTPT;
+  struct hostfsbench_s bench;
+  struct sched_param param;
+  pthread_attr_t attr;
+  pthread_t thread;
+  uint64_t start;
+  size_t bufsize;
+  size_t i;
+  int option;
+  int ret;
+
+  memset(&bench, 0, sizeof(bench));
+  bench.filesize = HOSTFSBENCH_DEFAULT_FILESIZE;
+  bench.stats    = HOSTFSBENCH_DEFAULT_STATS;
+  bench.files    = HOSTFSBENCH_DEFAULT_FILES;
+
+  while ((option = getopt(argc, argv, "p:s:n:f:h")) != ERROR)
+    {
+      switch (option)
+        {
+          case 'p':
+            path = optarg;
+            break;
+
+          case 's':
+            bench.filesize = atoi(optarg);
+            break;
+
+          case 'n':
+            bench.stats = atoi(optarg);
+            break;
+
+          case 'f':
+            bench.files = atoi(optarg);
+            break;
+
+          case 'h':
+            show_usage(argv[0], EXIT_SUCCESS);
+            break;
+
+          default:
+            show_usage(argv[0], EXIT_FAILURE);
+            break;
+        }
+    }
+
+  if (bench.filesize == 0 || bench.stats <= 0 || bench.files < 0)
+    {
+      show_usage(argv[0], EXIT_FAILURE);
+    }
+
+  bufsize = g_hostfsbench_bsizes[nitems(g_hostfsbench_bsizes) - 1];
+  bench.buf = malloc(bufsize);
+  if (bench.buf == NULL)
+    {
+      printf("Failed to allocate the buffer\n");
+      return EXIT_FAILURE;
+    }
+
+  memset(bench.buf, 0x5a, bufsize);
+  snprintf(bench.path, sizeof(bench.path), "%s/hostfsbench.dat", path);
+  snprintf(bench.dir, sizeof(bench.dir), "%s/hostfsbench.dir", path);
+
+  /* Start the CPU-bound thread one priority level below ours */
+
+  sched_getparam(0, &param);
+  param.sched_priority--;
+  pthread_attr_init(&attr);
+  pthread_attr_setschedparam(&attr, &param);
+  ret = pthread_create(&thread, &attr, hostfsbench_spin, &bench);
+  pthread_attr_destroy(&attr);
+  if (ret != 0)
+    {
+      printf("Failed to create the CPU-bound thread: %d\n", ret);
+      free(bench.buf);
+      return EXIT_FAILURE;
+    }
+
+  /* Its rate while we sleep is the reference for the runs */
+
+  start = bench.spins;
+  usleep(HOSTFSBENCH_IDLE_USEC);
+  bench.rate = (bench.spins - start) * 1000000 / HOSTFSBENCH_IDLE_USEC;
+
+  printf("%zu byte file, block size: throughput, CPU-bound work left\n",
+         bench.filesize);
+  for (i = 0; i < nitems(g_hostfsbench_bsizes); i++)
+    {
+      hostfsbench_run(&bench, g_hostfsbench_bsizes[i]);
+    }
+
+  hostfsbench_stat(&bench);
+  hostfsbench_readdir(&bench);
+
+  bench.stop = true;
+  pthread_join(thread, NULL);
+
+  unlink(bench.path);
+  free(bench.buf);
+  return EXIT_SUCCESS;
+}
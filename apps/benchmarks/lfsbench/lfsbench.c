@@ -0,0 +1,378 @@
+/****************************************************************************
+ * apps/benchmarks/lfsbench/lfsbench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/param.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define LFSBENCH_DEFAULT_OPS        1000
+#define LFSBENCH_DEFAULT_READSIZE   64
+#define LFSBENCH_DEFAULT_FILESIZE   16384
+#define LFSBENCH_WRITESIZE          4096
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct lfsbench_s
+{
+  char rdpath[PATH_MAX];    /* File read by the reader */
+  char wrpath[PATH_MAX];    /* File written by the writer */
+  int ops;                  /* Number of reads and stats per run */
+  size_t readsize;          /* Size of every read */
+  size_t filesize;          /* Size of the file read */
+  volatile bool stop;       /* Tells the writer to stop */
+  uint32_t writes;          /* Number of writes done by the writer */
+};
+
+struct lfsbench_lat_s
+{
+  uint64_t total;
+  uint64_t max;
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void show_usage(FAR const char *progname, int exitcode)
+{
+  printf("\nUsage: %s [-p path] [-n ops] [-r readsize] [-f filesize]\n",
+         progname);
+  printf("\nWhere:\n");
+  printf("  -p directory on the littlefs mount (default: %s)\n",
+         CONFIG_BENCHMARK_LFSBENCH_MOUNTPT);
+  printf("  -n number of reads and stats per run (default: %d)\n",
+         LFSBENCH_DEFAULT_OPS);
+  printf("  -r size of every read (default: %d)\n",
+         LFSBENCH_DEFAULT_READSIZE);
+  printf("  -f size of the file read (default: %d)\n",
+         LFSBENCH_DEFAULT_FILESIZE);
+  exit(exitcode);
+}
+
+static uint64_t lfsbench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void lfsbench_record(FAR struct lfsbench_lat_s *lat, uint64_t start)
+{
+  uint64_t elapsed = lfsbench_now() - start;
+
+  lat->total += elapsed;
+  if (elapsed > lat->max)
+    {
+      lat->max = elapsed;
+    }
+}
+
+/* Create the file read by the reader */
+
+static int lfsbench_prepare(FAR struct lfsbench_s *bench)
+{
+  char buf[LFSBENCH_DEFAULT_READSIZE];
+  size_t done;
+  ssize_t n;
+  int ret = OK;
+  int fd;
+
+  fd = open(bench->rdpath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0)
+    {
+      return -errno;
+    }
+
+  for (done = 0; done < bench->filesize; done += n)
+    {
+      memset(buf, done & 0xff, sizeof(buf));
+      n = write(fd, buf, MIN(sizeof(buf), bench->filesize - done));
+      if (n <= 0)
+        {
+          ret = -errno;
+          break;
+        }
+    }
+
+  if (ret >= 0 && fsync(fd) < 0)
+    {
+      ret = -errno;
+    }
+
+  close(fd);
+  return ret;
+}
+
+/* Append to and sync a second file until told to stop, every sync
+ * programs and erases flash blocks with the mount lock held.
+ */
+
+static FAR void *lfsbench_writer(FAR void *arg)
+{
+  FAR struct lfsbench_s *bench = arg;
+  FAR char *buf;
+  int fd;
+
+  buf = malloc(LFSBENCH_WRITESIZE);
+  if (buf == NULL)
+    {
+      return NULL;
+    }
+
+  memset(buf, 0x5a, LFSBENCH_WRITESIZE);
+  fd = open(bench->wrpath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd >= 0)
+    {
+      while (!bench->stop)
+        {
+          if (write(fd, buf, LFSBENCH_WRITESIZE) != LFSBENCH_WRITESIZE ||
+              fsync(fd) < 0)
+            {
+              break;
+            }
+
+          bench->writes++;
+
+          /* Start over before the mount fills up */
+
+          if (bench->writes % 16 == 0)
+            {
+              ftruncate(fd, 0);
+              lseek(fd, 0, SEEK_SET);
+            }
+        }
+
+      close(fd);
+    }
+
+  free(buf);
+  return NULL;
+}
+
+/* Read the file sequentially in small chunks and stat it, recording the
+ * latency of every call.
+ */
+
+static int lfsbench_reader(FAR struct lfsbench_s *bench,
+                           FAR struct lfsbench_lat_s *rlat,
+                           FAR struct lfsbench_lat_s *slat)
+{
+  struct stat st;
+  uint64_t start;
+  FAR char *buf;
+  ssize_t n;
+  int ret = OK;
+  int fd;
+  int i;
+
+  buf = malloc(bench->readsize);
+  if (buf == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  fd = open(bench->rdpath, O_RDONLY);
+  if (fd < 0)
+    {
+      free(buf);
+      return -errno;
+    }
+
+  memset(rlat, 0, sizeof(*rlat));
+  memset(slat, 0, sizeof(*slat));
+
+  for (i = 0; i < bench->ops; i++)
+    {
+      start = lfsbench_now();
+      n = read(fd, buf, bench->readsize);
+      lfsbench_record(rlat, start);
+      if (n < 0)
+        {
+          ret = -errno;
+          break;
+        }
+      else if (n == 0)
+        {
+          lseek(fd, 0, SEEK_SET);
+        }
+
+      start = lfsbench_now();
+      if (stat(bench->rdpath, &st) < 0)
+        {
+          ret = -errno;
+          break;
+        }
+
+      lfsbench_record(slat, start);
+    }
+
+  close(fd);
+  free(buf);
+  return ret;
+}
+
+static int lfsbench_run(FAR struct lfsbench_s *bench, bool writer)
+{
+  struct lfsbench_lat_s rlat;
+  struct lfsbench_lat_s slat;
+  pthread_t thread;
+  int ret;
+
+  bench->stop   = false;
+  bench->writes = 0;
+
+  if (writer)
+    {
+      ret = pthread_create(&thread, NULL, lfsbench_writer, bench);
+      if (ret != 0)
+        {
+          return -ret;
+        }
+    }
+
+  ret = lfsbench_reader(bench, &rlat, &slat);
+
+  if (writer)
+    {
+      bench->stop = true;
+      pthread_join(thread, NULL);
+    }
+
+  if (ret < 0)
+    {
+      printf("%-10s failed: %d\n", writer ? "writer" : "idle", ret);
+      return ret;
+    }
+
+  printf("%-10s read avg %6" PRIu64 " max %8" PRIu64 " us, "
+         "stat avg %6" PRIu64 " max %8" PRIu64 " us, %" PRIu32 " writes\n",
+         writer ? "writer" : "idle",
+         rlat.total / bench->ops, rlat.max,
+         slat.total / bench->ops, slat.max, bench->writes);
+  return OK;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * lfsbench_main
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  FAR const char *path = CONFIG_BENCHMARK_LFSBENCH_MOUNTPT;
+  struct lfsbench_s bench;
+  int option;
+  int ret;
+
+  memset(&bench, 0, sizeof(bench));
+  bench.ops      = LFSBENCH_DEFAULT_OPS;
+  bench.readsize = LFSBENCH_DEFAULT_READSIZE;
+  bench.filesize = LFSBENCH_DEFAULT_FILESIZE;
+
+  while ((option = getopt(argc, argv, "p:n:r:f:h")) != ERROR)
+    {
+      switch (option)
+        {
+          case 'p':
+            path = optarg;
+            break;
+
+          case 'n':
+            bench.ops = atoi(optarg);
+            break;
+
+          case 'r':
+            bench.readsize = atoi(optarg);
+            break;
+
+          case 'f':
+            bench.filesize = atoi(optarg);
+            break;
+
+          case 'h':
+            show_usage(argv[0], EXIT_SUCCESS);
+            break;
+
+          default:
+            show_usage(argv[0], EXIT_FAILURE);
+            break;
+        }
+    }
+
+  if (bench.ops <= 0 || bench.readsize == 0 || bench.filesize == 0)
+    {
+      show_usage(argv[0], EXIT_FAILURE);
+    }
+
+  snprintf(bench.rdpath, sizeof(bench.rdpath), "%s/lfsbench.rd", path);
+  snprintf(bench.wrpath, sizeof(bench.wrpath), "%s/lfsbench.wr", path);
+
+  ret = lfsbench_prepare(&bench);
+  if (ret < 0)
+    {
+      printf("Failed to create %s: %d\n", bench.rdpath, ret);
+      return EXIT_FAILURE;
+    }
+
+  printf("%d reads of %zu bytes from a %zu byte file\n",
+         bench.ops, bench.readsize, bench.filesize);
+
+  /* Without the read cache every read and stat waits for the syncs of the
+   * writer, with it most of them are served without the mount lock.
+   */
+
+  ret = lfsbench_run(&bench, false);
+  if (ret >= 0)
+    {
+      ret = lfsbench_run(&bench, true);
+    }
+
+  unlink(bench.rdpath);
+  unlink(bench.wrpath);
+  return ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -28,6 +28,9 @@
 
 #include <sys/stat.h>
 #include <unistd.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -45,6 +48,85 @@
  * Private data
  ****************************************************************************/
 
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/* Write 'count' single sectors at random positions and report the IOPS
+ * and, for an FTL device, the write amplification.
+ */
+
+static int mtd_random_write(FAR struct inode *inode,
+                            FAR struct partition_info_s *info, int count)
+{
+  struct ftl_stats_s before;
+  struct ftl_stats_s after;
+  struct timespec start;
+  struct timespec end;
+  double elapsed_time;
+  bool stats;
+  char *buffer;
+  ssize_t nwritten;
+  int ret = OK;
+  int x;
+
+  buffer = (char *)malloc(info->sectorsize);
+  if (buffer == NULL)
+    {
+      fprintf(stderr, "Error allocating buffer\n");
+      return -ENOMEM;
+    }
+
+  memset(buffer, 0x5a, info->sectorsize);
+  stats = inode->u.i_bops->ioctl(inode, BIOC_FTLSTATS,
+                                 (unsigned long)&before) == OK;
+
+  printf("\nStarting %d random writes...\n", count);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (x = 0; x < count; x++)
+    {
+      nwritten = inode->u.i_bops->write(inode,
+                                        (FAR const unsigned char *)buffer,
+                                        rand() % info->numsectors, 1);
+      if (nwritten != 1)
+        {
+          fprintf(stderr, "Write failed: %zd\n", nwritten);
+          ret = nwritten < 0 ? nwritten : -EIO;
+          goto errout_with_buffer;
+        }
+    }
+
+  /* Include writing back whatever the device still caches */
+
+  inode->u.i_bops->ioctl(inode, BIOC_FLUSH, 0);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  elapsed_time = (end.tv_sec - start.tv_sec) + \
+                 (end.tv_nsec - start.tv_nsec) / 1e9;
+
+  printf("\nRandom writes completed in %.2f seconds\n", elapsed_time);
+  printf("Write IOPS: %.1f\n", count / elapsed_time);
+
+  if (stats && inode->u.i_bops->ioctl(inode, BIOC_FTLSTATS,
+                                      (unsigned long)&after) == OK)
+    {
+      after.nwritten    -= before.nwritten;
+      after.nprogrammed -= before.nprogrammed;
+      after.nerased     -= before.nerased;
+
+      printf("Sectors written:    %10" PRIu32 "\n", after.nwritten);
+      printf("Sectors programmed: %10" PRIu32 "\n", after.nprogrammed);
+      printf("Blocks erased:      %10" PRIu32 "\n", after.nerased);
+      printf("Write amplification: %.2f\n",
+             (double)after.nprogrammed / after.nwritten);
+    }
+
+errout_with_buffer:
+  free(buffer);
+  return ret;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -63,21 +145,37 @@ int main(int argc, FAR char *argv[])
   size_t                  total_bytes_written = 0;
   size_t                  total_bytes_read = 0;
   char                    *buffer;
+  int                     nrandom = 0;
+  int                     option;
+
+  while ((option = getopt(argc, argv, "r:")) != ERROR)
+    {
+      switch (option)
+        {
+          case 'r':
+            nrandom = atoi(optarg);
+            break;
+
+          default:
+            optind = argc;
+            break;
+        }
+    }
 
   /* Argument given? */
 
-  if (argc < 2)
+  if (optind != argc - 1 || nrandom < 0)
     {
-      fprintf(stderr, "usage: mtd flash_block_device\n");
+      fprintf(stderr, "usage: mtd [-r count] flash_block_device\n");
       return -1;
     }
 
   /* Find the inode of the block driver identified by 'source' */
 
-  ret = open_blockdriver(argv[1], 0, &inode);
+  ret = open_blockdriver(argv[optind], 0, &inode);
   if (ret < 0)
     {
-      fprintf(stderr, "Failed to open %s\n", argv[1]);
+      fprintf(stderr, "Failed to open %s\n", argv[optind]);
       return ret;
     }
 
@@ -107,6 +205,14 @@ int main(int argc, FAR char *argv[])
   printf("   Erase block:  %10" PRIx32 "\n", geo.erasesize);
   printf("   Total size:   %10d\n", info.sectorsize * info.numsectors);
 
+  if (nrandom > 0)
+    {
+      /* Random writes smaller than an erase block */
+
+      mtd_random_write(inode, &info, nrandom);
+      goto errout_with_driver;
+    }
+
   if (info.sectorsize != geo.erasesize)
     {
       fprintf(stderr, "Sector size does not match the erase block size.\n"
@@ -25,6 +25,8 @@
  ****************************************************************************/
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
 #include <pthread.h>
 #include <sched.h>
@@ -37,6 +39,7 @@
 #include <string.h>
 #include <sys/param.h>
 #include <sys/poll.h>
+#include <sys/stat.h>
 
 #include <nuttx/sched.h>
 
@@ -56,6 +59,12 @@ struct performance_thread_s
   struct performance_time_s time;
 };
 
+struct performance_mutex_s
+{
+  pthread_mutex_t mutex;
+  struct performance_time_s time;
+};
+
 struct performance_entry_s
 {
   const char name[NAME_MAX];
@@ -74,6 +83,11 @@ static size_t poll_performance(void);
 static size_t pipe_performance(void);
 static size_t semwait_performance(void);
 static size_t sempost_performance(void);
+static size_t mutex_contended_performance(void);
+static size_t mutex_contended_pi_performance(void);
+static size_t stat_deep_performance(void);
+static size_t stat_missing_performance(void);
+static size_t open_deep_performance(void);
 
 /****************************************************************************
  * Private Data
@@ -89,6 +103,11 @@ static const struct performance_entry_s g_entry_list[] =
   {"pipe-rw", pipe_performance},
   {"semwait", semwait_performance},
   {"sempost", sempost_performance},
+  {"mutex-contended", mutex_contended_performance},
+  {"mutex-contended-pi", mutex_contended_pi_performance},
+  {"stat-deep", stat_deep_performance},
+  {"stat-missing", stat_missing_performance},
+  {"open-deep", open_deep_performance},
 };
 
 /****************************************************************************
@@ -354,6 +373,154 @@ static size_t sempost_performance(void)
   return performance_gettime(&result);
 }
 
+/****************************************************************************
+ * Contended mutex performance
+ ****************************************************************************/
+
+static FAR void *mutex_contended_task(FAR void *arg)
+{
+  FAR struct performance_mutex_s *perf = arg;
+
+  /* Block on the mutex held by the lower priority thread, which boosts the
+   * holder if priority inheritance is enabled, and run again when the
+   * holder unlocks it.
+   */
+
+  performance_start(&perf->time);
+  pthread_mutex_lock(&perf->mutex);
+  performance_end(&perf->time);
+  pthread_mutex_unlock(&perf->mutex);
+  return NULL;
+}
+
+static size_t mutex_contended(int protocol)
+{
+  struct performance_mutex_s perf;
+  pthread_mutexattr_t attr;
+  pthread_t tid;
+
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setprotocol(&attr, protocol);
+  pthread_mutex_init(&perf.mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+
+  pthread_mutex_lock(&perf.mutex);
+  tid = performance_thread_create(mutex_contended_task, &perf,
+                                  CONFIG_BENCHMARK_OSPERF_PRIORITY + 1);
+  pthread_mutex_unlock(&perf.mutex);
+  pthread_join(tid, NULL);
+
+  pthread_mutex_destroy(&perf.mutex);
+  return performance_gettime(&perf.time);
+}
+
+static size_t mutex_contended_performance(void)
+{
+  return mutex_contended(PTHREAD_PRIO_NONE);
+}
+
+static size_t mutex_contended_pi_performance(void)
+{
+  return mutex_contended(PTHREAD_PRIO_INHERIT);
+}
+
+/****************************************************************************
+ * Path lookup performance
+ ****************************************************************************/
+
+#define DEEP_DIR  CONFIG_BENCHMARK_OSPERF_FSPATH "/osperf/1/2/3/4/5/6/7"
+#define DEEP_FILE DEEP_DIR "/file"
+
+static void deep_prepare(void)
+{
+  static bool prepared;
+  char path[] = DEEP_DIR;
+  FAR char *ptr;
+  int fd;
+
+  if (prepared)
+    {
+      return;
+    }
+
+  /* Create the directories one level at a time, like mkdir -p */
+
+  for (ptr = path + strlen(CONFIG_BENCHMARK_OSPERF_FSPATH) + 1; ; ptr++)
+    {
+      if (*ptr == '/' || *ptr == '\0')
+        {
+          char ch = *ptr;
+
+          *ptr = '\0';
+          if (mkdir(path, 0777) < 0 && errno != EEXIST)
+            {
+              printf("Failed to create %s: %d\n", path, errno);
+              return;
+            }
+
+          if (ch == '\0')
+            {
+              break;
+            }
+
+          *ptr = ch;
+        }
+    }
+
+  fd = open(DEEP_FILE, O_WRONLY | O_CREAT, 0666);
+  if (fd < 0)
+    {
+      printf("Failed to create %s: %d\n", DEEP_FILE, errno);
+      return;
+    }
+
+  close(fd);
+  prepared = true;
+}
+
+static size_t stat_deep(FAR const char *path)
+{
+  struct performance_time_s result;
+  struct stat buf;
+
+  deep_prepare();
+
+  performance_start(&result);
+  stat(path, &buf);
+  performance_end(&result);
+
+  return performance_gettime(&result);
+}
+
+static size_t stat_deep_performance(void)
+{
+  return stat_deep(DEEP_FILE);
+}
+
+static size_t stat_missing_performance(void)
+{
+  return stat_deep(DEEP_DIR "/missing");
+}
+
+static size_t open_deep_performance(void)
+{
+  struct performance_time_s result;
+  int fd;
+
+  deep_prepare();
+
+  performance_start(&result);
+  fd = open(DEEP_FILE, O_RDONLY);
+  performance_end(&result);
+
+  if (fd >= 0)
+    {
+      close(fd);
+    }
+
+  return performance_gettime(&result);
+}
+
 /****************************************************************************
  * performance_help
  ****************************************************************************/
@@ -0,0 +1,378 @@
+/****************************************************************************
+ * apps/benchmarks/statsbench/statsbench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <nuttx/procstats.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define STATSBENCH_DEFAULT_SAMPLES  100
+#define STATSBENCH_DEFAULT_BUFSIZE  16384
+#define STATSBENCH_MAX_THREADS      128
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct statsbench_s
+{
+  FAR const char *path;     /* procfs mount point */
+  int samples;              /* Number of samples of every run */
+  size_t bufsize;           /* Size of the read buffer */
+  FAR char *buf;            /* Read buffer */
+  char name[PATH_MAX];      /* Path of a text file */
+  size_t bytes;             /* Bytes read by the last sample */
+  int nrecords;             /* Tasks or records seen by the last sample */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void show_usage(FAR const char *progname, int exitcode)
+{
+  printf("\nUsage: %s [-p path] [-n samples] [-t threads] [-b bufsize]\n",
+         progname);
+  printf("\nWhere:\n");
+  printf("  -p procfs mount point (default: %s)\n",
+         CONFIG_BENCHMARK_STATSBENCH_MOUNTPT);
+  printf("  -n number of samples per run (default: %d)\n",
+         STATSBENCH_DEFAULT_SAMPLES);
+  printf("  -t idle threads created to add tasks, at most %d (default: 0)\n",
+         STATSBENCH_MAX_THREADS);
+  printf("  -b size of the read buffer (default: %d)\n",
+         STATSBENCH_DEFAULT_BUFSIZE);
+  exit(exitcode);
+}
+
+static uint64_t statsbench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static FAR void *statsbench_idle(FAR void *arg)
+{
+  sem_wait(arg);
+  return NULL;
+}
+
+/* Read a whole text file and pick the value of one field, the way a
+ * monitoring agent parses it.
+ */
+
+static int statsbench_text(FAR struct statsbench_s *bench,
+                           FAR const char *field)
+{
+  FAR char *value;
+  ssize_t n;
+  size_t len = 0;
+  int fd;
+
+  fd = open(bench->name, O_RDONLY);
+  if (fd < 0)
+    {
+      return -errno;
+    }
+
+  while ((n = read(fd, bench->buf + len, bench->bufsize - 1 - len)) > 0)
+    {
+      len += n;
+    }
+
+  close(fd);
+
+  bench->buf[len] = '\0';
+  bench->bytes   += len;
+
+  if (field != NULL)
+    {
+      value = strstr(bench->buf, field);
+      if (value != NULL)
+        {
+          strtol(value + strlen(field), NULL, 10);
+        }
+    }
+
+  return OK;
+}
+
+/* One sample from /proc/<pid>/status of every task, /proc/cpuload,
+ * /proc/meminfo and /proc/iobinfo.  Files that are not configured are
+ * skipped.
+ */
+
+static int statsbench_sample_text(FAR struct statsbench_s *bench)
+{
+  FAR struct dirent *entry;
+  FAR DIR *dir;
+
+  bench->bytes    = 0;
+  bench->nrecords = 0;
+
+  dir = opendir(bench->path);
+  if (dir == NULL)
+    {
+      return -errno;
+    }
+
+  while ((entry = readdir(dir)) != NULL)
+    {
+      if (!isdigit(entry->d_name[0]))
+        {
+          continue;
+        }
+
+      snprintf(bench->name, sizeof(bench->name), "%s/%s/status",
+               bench->path, entry->d_name);
+      if (statsbench_text(bench, "Priority:") >= 0)
+        {
+          bench->nrecords++;
+        }
+    }
+
+  closedir(dir);
+
+  snprintf(bench->name, sizeof(bench->name), "%s/cpuload", bench->path);
+  statsbench_text(bench, NULL);
+  snprintf(bench->name, sizeof(bench->name), "%s/meminfo", bench->path);
+  statsbench_text(bench, "Umem");
+  snprintf(bench->name, sizeof(bench->name), "%s/iobinfo", bench->path);
+  statsbench_text(bench, NULL);
+  return OK;
+}
+
+/* One snapshot from /proc/stats, walking all records */
+
+static int statsbench_sample_binary(FAR struct statsbench_s *bench, int fd)
+{
+  FAR struct procstats_hdr_s *hdr;
+  FAR struct procstats_rec_s *rec;
+  size_t offset;
+  ssize_t n;
+
+  n = pread(fd, bench->buf, bench->bufsize, 0);
+  if (n < (ssize_t)sizeof(*hdr))
+    {
+      return n < 0 ? -errno : -EIO;
+    }
+
+  hdr = (FAR struct procstats_hdr_s *)bench->buf;
+  if (hdr->magic != PROCSTATS_MAGIC || hdr->version != PROCSTATS_VERSION)
+    {
+      return -EPROTO;
+    }
+
+  if ((hdr->flags & PROCSTATS_FLAG_TRUNCATED) != 0)
+    {
+      return -E2BIG;
+    }
+
+  bench->bytes    = n;
+  bench->nrecords = 0;
+
+  for (offset = sizeof(*hdr); offset + sizeof(*rec) <= (size_t)n;
+       offset += rec->size)
+    {
+      rec = (FAR struct procstats_rec_s *)(bench->buf + offset);
+      if (rec->size < sizeof(*rec))
+        {
+          return -EPROTO;
+        }
+
+      bench->nrecords++;
+    }
+
+  return OK;
+}
+
+static void statsbench_run(FAR struct statsbench_s *bench,
+                           FAR const char *name, int fd)
+{
+  uint64_t elapsed;
+  uint64_t start;
+  int ret = OK;
+  int i;
+
+  start = statsbench_now();
+  for (i = 0; i < bench->samples && ret >= 0; i++)
+    {
+      ret = fd < 0 ? statsbench_sample_text(bench) :
+                     statsbench_sample_binary(bench, fd);
+    }
+
+  elapsed = statsbench_now() - start;
+
+  if (ret < 0)
+    {
+      printf("%-6s failed: %d\n", name, ret);
+      return;
+    }
+
+  printf("%-6s %8" PRIu64 " us per sample, %6zu bytes, %4d %s\n",
+         name, elapsed / bench->samples, bench->bytes, bench->nrecords,
+         fd < 0 ? "tasks" : "records");
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * statsbench_main
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  pthread_t threads[STATSBENCH_MAX_THREADS];
+  struct statsbench_s bench;
+  sem_t sem;
+  int nthreads = 0;
+  int option;
+  int fd;
+  int n;
+  int i;
+
+  memset(&bench, 0, sizeof(bench));
+  bench.path    = CONFIG_BENCHMARK_STATSBENCH_MOUNTPT;
+  bench.samples = STATSBENCH_DEFAULT_SAMPLES;
+  bench.bufsize = STATSBENCH_DEFAULT_BUFSIZE;
+
+  while ((option = getopt(argc, argv, "p:n:t:b:h")) != ERROR)
+    {
+      switch (option)
+        {
+          case 'p':
+            bench.path = optarg;
+            break;
+
+          case 'n':
+            bench.samples = atoi(optarg);
+            break;
+
+          case 't':
+            nthreads = atoi(optarg);
+            break;
+
+          case 'b':
+            bench.bufsize = atoi(optarg);
+            break;
+
+          case 'h':
+            show_usage(argv[0], EXIT_SUCCESS);
+            break;
+
+          default:
+            show_usage(argv[0], EXIT_FAILURE);
+            break;
+        }
+    }
+
+  if (bench.samples <= 0 || nthreads < 0 ||
+      nthreads > STATSBENCH_MAX_THREADS ||
+      bench.bufsize < sizeof(struct procstats_hdr_s))
+    {
+      show_usage(argv[0], EXIT_FAILURE);
+    }
+
+  bench.buf = malloc(bench.bufsize);
+  if (bench.buf == NULL)
+    {
+      printf("Failed to allocate the buffer\n");
+      return EXIT_FAILURE;
+    }
+
+  snprintf(bench.name, sizeof(bench.name), "%s/stats", bench.path);
+  fd = open(bench.name, O_RDWR);
+  if (fd < 0)
+    {
+      printf("Failed to open %s: %d\n", bench.name, errno);
+      free(bench.buf);
+      return EXIT_FAILURE;
+    }
+
+  /* Idle threads stand in for the tasks of a bigger system */
+
+  sem_init(&sem, 0, 0);
+  for (n = 0; n < nthreads; n++)
+    {
+      if (pthread_create(&threads[n], NULL, statsbench_idle, &sem) != 0)
+        {
+          break;
+        }
+    }
+
+  printf("%d samples, %d idle threads\n", bench.samples, n);
+
+  statsbench_run(&bench, "text", -1);
+  statsbench_run(&bench, "full", fd);
+
+  /* Idle tasks do not change, a delta snapshot leaves them out */
+
+  if (write(fd, PROCSTATS_CMD_DELTA, strlen(PROCSTATS_CMD_DELTA)) < 0)
+    {
+      printf("Delta snapshots not supported: %d\n", errno);
+    }
+  else
+    {
+      statsbench_run(&bench, "delta", fd);
+    }
+
+  for (i = 0; i < n; i++)
+    {
+      sem_post(&sem);
+    }
+
+  for (i = 0; i < n; i++)
+    {
+      pthread_join(threads[i], NULL);
+    }
+
+  sem_destroy(&sem);
+  close(fd);
+  free(bench.buf);
+  return EXIT_SUCCESS;
+}
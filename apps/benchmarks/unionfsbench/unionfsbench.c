@@ -0,0 +1,308 @@
+/****************************************************************************
+ * apps/benchmarks/unionfsbench/unionfsbench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/stat.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define UNIONFSBENCH_DEFAULT_ROUNDS  100
+#define UNIONFSBENCH_MAXNAMES        256
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct unionfsbench_s
+{
+  FAR const char *path;     /* Directory listed */
+  int rounds;               /* Number of rounds of every test */
+  int nnames;               /* Number of names in the directory */
+  FAR char (*names)[NAME_MAX + 1];
+  char buf[PATH_MAX];       /* Full path of a name */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void show_usage(FAR const char *progname, int exitcode)
+{
+  printf("\nUsage: %s [-p path] [-n rounds] [-c file]\n", progname);
+  printf("\nWhere:\n");
+  printf("  -p directory on the union mount (default: %s)\n",
+         CONFIG_BENCHMARK_UNIONFSBENCH_MOUNTPT);
+  printf("  -n number of rounds of every test (default: %d)\n",
+         UNIONFSBENCH_DEFAULT_ROUNDS);
+  printf("  -c file of file system 2 to open for writing, which copies\n"
+         "     it up with FS_UNIONFS_COPYUP\n");
+  exit(exitcode);
+}
+
+static uint64_t unionfsbench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* List the directory repeatedly, the names of the first listing are kept
+ * for the stat() test.
+ */
+
+static int unionfsbench_list(FAR struct unionfsbench_s *bench)
+{
+  FAR struct dirent *entry;
+  FAR DIR *dir;
+  uint64_t elapsed;
+  uint64_t start;
+  int n = 0;
+  int i;
+
+  start = unionfsbench_now();
+  for (i = 0; i < bench->rounds; i++)
+    {
+      dir = opendir(bench->path);
+      if (dir == NULL)
+        {
+          printf("opendir %s failed: %d\n", bench->path, errno);
+          return -errno;
+        }
+
+      for (n = 0; (entry = readdir(dir)) != NULL; n++)
+        {
+          if (i == 0 && n < UNIONFSBENCH_MAXNAMES)
+            {
+              strlcpy(bench->names[n], entry->d_name, NAME_MAX + 1);
+            }
+        }
+
+      closedir(dir);
+    }
+
+  elapsed = unionfsbench_now() - start;
+
+  bench->nnames = n < UNIONFSBENCH_MAXNAMES ? n : UNIONFSBENCH_MAXNAMES;
+  printf("  list: %8" PRIu64 " us per listing of %d names\n",
+         elapsed / bench->rounds, n);
+  return OK;
+}
+
+/* stat() every name of the directory, each lookup has to find out which
+ * file system holds the name.
+ */
+
+static void unionfsbench_stat(FAR struct unionfsbench_s *bench)
+{
+  struct stat st;
+  uint64_t elapsed;
+  uint64_t start;
+  int i;
+  int j;
+
+  if (bench->nnames == 0)
+    {
+      return;
+    }
+
+  start = unionfsbench_now();
+  for (i = 0; i < bench->rounds; i++)
+    {
+      for (j = 0; j < bench->nnames; j++)
+        {
+          snprintf(bench->buf, sizeof(bench->buf), "%s/%s",
+                   bench->path, bench->names[j]);
+          if (stat(bench->buf, &st) < 0)
+            {
+              printf("stat %s failed: %d\n", bench->buf, errno);
+              return;
+            }
+        }
+    }
+
+  elapsed = unionfsbench_now() - start;
+  printf("  stat: %8" PRIu64 " ns per call\n",
+         elapsed * 1000 / ((uint64_t)bench->rounds * bench->nnames));
+}
+
+/* stat() names that exist on neither file system, without the directory
+ * cache both of them are asked every time.
+ */
+
+static void unionfsbench_miss(FAR struct unionfsbench_s *bench)
+{
+  struct stat st;
+  uint64_t elapsed;
+  uint64_t start;
+  int i;
+
+  start = unionfsbench_now();
+  for (i = 0; i < bench->rounds; i++)
+    {
+      snprintf(bench->buf, sizeof(bench->buf), "%s/unionfsbench.%d",
+               bench->path, i);
+      if (stat(bench->buf, &st) == 0 || errno != ENOENT)
+        {
+          printf("stat %s did not fail with ENOENT\n", bench->buf);
+          return;
+        }
+    }
+
+  elapsed = unionfsbench_now() - start;
+  printf("  miss: %8" PRIu64 " ns per call\n",
+         elapsed * 1000 / bench->rounds);
+}
+
+/* Open a file for writing twice: the first open copies it to file system 1
+ * when it is on file system 2 only, the second one finds it there.
+ */
+
+static void unionfsbench_copyup(FAR const char *path)
+{
+  uint64_t elapsed[2];
+  uint64_t start;
+  struct stat st;
+  int fd;
+  int i;
+
+  if (stat(path, &st) < 0)
+    {
+      printf("stat %s failed: %d\n", path, errno);
+      return;
+    }
+
+  for (i = 0; i < 2; i++)
+    {
+      start = unionfsbench_now();
+      fd = open(path, O_WRONLY | O_APPEND);
+      if (fd < 0)
+        {
+          printf("open %s failed: %d\n", path, errno);
+          return;
+        }
+
+      close(fd);
+      elapsed[i] = unionfsbench_now() - start;
+    }
+
+  printf("copyup: %8" PRIu64 " us for %jd bytes, %" PRIu64
+         " us to open again\n", elapsed[0], (intmax_t)st.st_size,
+         elapsed[1]);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * unionfsbench_main
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  FAR const char *copyup = NULL;
+  struct unionfsbench_s bench;
+  int option;
+  int ret;
+
+  memset(&bench, 0, sizeof(bench));
+  bench.path   = CONFIG_BENCHMARK_UNIONFSBENCH_MOUNTPT;
+  bench.rounds = UNIONFSBENCH_DEFAULT_ROUNDS;
+
+  while ((option = getopt(argc, argv, "p:n:c:h")) != ERROR)
+    {
+      switch (option)
+        {
+          case 'p':
+            bench.path = optarg;
+            break;
+
+          case 'n':
+            bench.rounds = atoi(optarg);
+            break;
+
+          case 'c':
+            copyup = optarg;
+            break;
+
+          case 'h':
+            show_usage(argv[0], EXIT_SUCCESS);
+            break;
+
+          default:
+            show_usage(argv[0], EXIT_FAILURE);
+            break;
+        }
+    }
+
+  if (bench.rounds <= 0)
+    {
+      show_usage(argv[0], EXIT_FAILURE);
+    }
+
+  bench.names = malloc(UNIONFSBENCH_MAXNAMES * sizeof(*bench.names));
+  if (bench.names == NULL)
+    {
+      printf("Failed to allocate the names\n");
+      return EXIT_FAILURE;
+    }
+
+  printf("%s, %d rounds\n", bench.path, bench.rounds);
+
+  /* The first listing reads both file systems, the later ones are served
+   * by the merged directory cache.
+   */
+
+  ret = unionfsbench_list(&bench);
+  if (ret >= 0)
+    {
+      unionfsbench_stat(&bench);
+      unionfsbench_miss(&bench);
+    }
+
+  if (copyup != NULL)
+    {
+      unionfsbench_copyup(copyup);
+    }
+
+  free(bench.names);
+  return ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,296 @@
+/****************************************************************************
+ * apps/benchmarks/v9fsbench/v9fsbench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/param.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define V9FSBENCH_DEFAULT_FILESIZE  (4 * 1024 * 1024)
+#define V9FSBENCH_DEFAULT_STATS     1000
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct v9fsbench_s
+{
+  char path[PATH_MAX];  /* File written and read */
+  size_t filesize;      /* Size of the file */
+  int stats;            /* Number of stat() calls */
+  FAR char *buf;        /* I/O buffer of the largest block size */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* Block sizes of the runs, from below a typical iounit to many of them */
+
+static const size_t g_v9fsbench_bsizes[] =
+{
+  512, 4096, 65536, 262144
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void show_usage(FAR const char *progname, int exitcode)
+{
+  printf("\nUsage: %s [-p path] [-s filesize] [-n stats]\n", progname);
+  printf("\nWhere:\n");
+  printf("  -p directory on the V9FS mount (default: %s)\n",
+         CONFIG_BENCHMARK_V9FSBENCH_MOUNTPT);
+  printf("  -s size of the file written and read (default: %d)\n",
+         V9FSBENCH_DEFAULT_FILESIZE);
+  printf("  -n number of stat() calls (default: %d)\n",
+         V9FSBENCH_DEFAULT_STATS);
+  exit(exitcode);
+}
+
+static uint64_t v9fsbench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Throughput in KiB/s of size bytes moved in elapsed microseconds */
+
+static uint64_t v9fsbench_kbps(size_t size, uint64_t elapsed)
+{
+  return elapsed ? (uint64_t)size * 1000000 / 1024 / elapsed : 0;
+}
+
+static int v9fsbench_write(FAR struct v9fsbench_s *bench, size_t bsize)
+{
+  size_t done;
+  ssize_t n;
+  int ret = OK;
+  int fd;
+
+  fd = open(bench->path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0)
+    {
+      return -errno;
+    }
+
+  for (done = 0; done < bench->filesize; done += n)
+    {
+      n = write(fd, bench->buf, MIN(bsize, bench->filesize - done));
+      if (n <= 0)
+        {
+          ret = n < 0 ? -errno : -EIO;
+          break;
+        }
+    }
+
+  /* Count the data still in flight or buffered */
+
+  if (ret >= 0 && fsync(fd) < 0)
+    {
+      ret = -errno;
+    }
+
+  if (close(fd) < 0 && ret >= 0)
+    {
+      ret = -errno;
+    }
+
+  return ret;
+}
+
+static int v9fsbench_read(FAR struct v9fsbench_s *bench, size_t bsize)
+{
+  size_t done;
+  ssize_t n;
+  int ret = OK;
+  int fd;
+
+  fd = open(bench->path, O_RDONLY);
+  if (fd < 0)
+    {
+      return -errno;
+    }
+
+  for (done = 0; done < bench->filesize; done += n)
+    {
+      n = read(fd, bench->buf, bsize);
+      if (n <= 0)
+        {
+          ret = n < 0 ? -errno : -EIO;
+          break;
+        }
+    }
+
+  close(fd);
+  return ret;
+}
+
+static void v9fsbench_run(FAR struct v9fsbench_s *bench, size_t bsize)
+{
+  uint64_t wtime;
+  uint64_t rtime;
+  uint64_t start;
+  int ret;
+
+  start = v9fsbench_now();
+  ret   = v9fsbench_write(bench, bsize);
+  wtime = v9fsbench_now() - start;
+  if (ret < 0)
+    {
+      printf("%7zu: write failed: %d\n", bsize, ret);
+      return;
+    }
+
+  start = v9fsbench_now();
+  ret   = v9fsbench_read(bench, bsize);
+  rtime = v9fsbench_now() - start;
+  if (ret < 0)
+    {
+      printf("%7zu: read failed: %d\n", bsize, ret);
+      return;
+    }
+
+  printf("%7zu: write %8" PRIu64 " KiB/s, read %8" PRIu64 " KiB/s\n",
+         bsize, v9fsbench_kbps(bench->filesize, wtime),
+         v9fsbench_kbps(bench->filesize, rtime));
+}
+
+/* stat() the same file repeatedly, a walk and attribute cache serves all
+ * but the first one.
+ */
+
+static void v9fsbench_stat(FAR struct v9fsbench_s *bench)
+{
+  struct stat st;
+  uint64_t start;
+  uint64_t elapsed;
+  int i;
+
+  start = v9fsbench_now();
+  for (i = 0; i < bench->stats; i++)
+    {
+      if (stat(bench->path, &st) < 0)
+        {
+          printf("stat failed: %d\n", errno);
+          return;
+        }
+    }
+
+  elapsed = v9fsbench_now() - start;
+  printf("   stat: %8" PRIu64 " us per call\n", elapsed / bench->stats);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * v9fsbench_main
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  FAR const char *path = CONFIG_BENCHMARK_V9FSBENCH_MOUNTPT;
+  struct v9fsbench_s bench;
+  size_t bufsize;
+  size_t i;
+  int option;
+
+  memset(&bench, 0, sizeof(bench));
+  bench.filesize = V9FSBENCH_DEFAULT_FILESIZE;
+  bench.stats    = V9FSBENCH_DEFAULT_STATS;
+
+  while ((option = getopt(argc, argv, "p:s:n:h")) != ERROR)
+    {
+      switch (option)
+        {
+          case 'p':
+            path = optarg;
+            break;
+
+          case 's':
+            bench.filesize = atoi(optarg);
+            break;
+
+          case 'n':
+            bench.stats = atoi(optarg);
+            break;
+
+          case 'h':
+            show_usage(argv[0], EXIT_SUCCESS);
+            break;
+
+          default:
+            show_usage(argv[0], EXIT_FAILURE);
+            break;
+        }
+    }
+
+  if (bench.filesize == 0 || bench.stats <= 0)
+    {
+      show_usage(argv[0], EXIT_FAILURE);
+    }
+
+  bufsize = g_v9fsbench_bsizes[nitems(g_v9fsbench_bsizes) - 1];
+  bench.buf = malloc(bufsize);
+  if (bench.buf == NULL)
+    {
+      printf("Failed to allocate the buffer\n");
+      return EXIT_FAILURE;
+    }
+
+  memset(bench.buf, 0x5a, bufsize);
+  snprintf(bench.path, sizeof(bench.path), "%s/v9fsbench.dat", path);
+
+  printf("%zu byte file, block size: throughput\n", bench.filesize);
+  for (i = 0; i < nitems(g_v9fsbench_bsizes); i++)
+    {
+      v9fsbench_run(&bench, g_v9fsbench_bsizes[i]);
+    }
+
+  v9fsbench_stat(&bench);
+
+  unlink(bench.path);
+  free(bench.buf);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,245 @@
+/****************************************************************************
+ * apps/benchmarks/zipbench/zipbench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/mount.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define ZIPBENCH_DEFAULT_BSIZE  4096
+#define ZIPBENCH_DEFAULT_READS  256
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct zipbench_s
+{
+  int fd;               /* The file inside the archive */
+  int nreads;           /* Number of random reads per test */
+  size_t bsize;         /* Size of each read */
+  off_t fsize;          /* Size of the file */
+  FAR char *buffer;     /* bsize bytes */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void show_usage(FAR const char *progname, int exitcode)
+{
+  printf("\nUsage: %s [-n reads] [-b bytes] <archive> <file>\n", progname);
+  printf("\nWhere:\n");
+  printf("  -n number of random reads per test (default: %d)\n",
+         ZIPBENCH_DEFAULT_READS);
+  printf("  -b size of each read (default: %d)\n", ZIPBENCH_DEFAULT_BSIZE);
+  printf("  <archive> zip archive, mounted at %s\n",
+         CONFIG_BENCHMARK_ZIPBENCH_MOUNTPT);
+  printf("  <file> deflated file inside the archive\n");
+  exit(exitcode);
+}
+
+static uint64_t zipbench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Read bsize bytes at random offsets */
+
+static int zipbench_random(FAR struct zipbench_s *bench)
+{
+  off_t offset;
+  int i;
+
+  for (i = 0; i < bench->nreads; i++)
+    {
+      offset = ((off_t)rand() * bench->bsize) % bench->fsize;
+      if (lseek(bench->fd, offset, SEEK_SET) != offset ||
+          read(bench->fd, bench->buffer, bench->bsize) < 0)
+        {
+          return -errno;
+        }
+    }
+
+  return bench->nreads;
+}
+
+/* Read the whole file once, this records all the inflate checkpoints */
+
+static int zipbench_sequential(FAR struct zipbench_s *bench)
+{
+  ssize_t nread;
+  int count = 0;
+
+  if (lseek(bench->fd, 0, SEEK_SET) != 0)
+    {
+      return -errno;
+    }
+
+  while ((nread = read(bench->fd, bench->buffer, bench->bsize)) > 0)
+    {
+      count++;
+    }
+
+  return nread < 0 ? -errno : count;
+}
+
+static void zipbench_run(FAR struct zipbench_s *bench, FAR const char *name,
+                         CODE int (*test)(FAR struct zipbench_s *bench))
+{
+  uint64_t start;
+  uint64_t elapsed;
+  int ret;
+
+  srand(1);
+
+  start   = zipbench_now();
+  ret     = test(bench);
+  elapsed = zipbench_now() - start;
+
+  if (ret < 0)
+    {
+      printf("%-12s failed: %d\n", name, ret);
+    }
+  else if (ret > 0)
+    {
+      printf("%-12s %8d reads in %10" PRIu64 " us, %8" PRIu64
+             " us per read\n", name, ret, elapsed, elapsed / ret);
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * zipbench_main
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct zipbench_s bench;
+  char path[PATH_MAX];
+  int ret = EXIT_SUCCESS;
+  int option;
+
+  bench.nreads = ZIPBENCH_DEFAULT_READS;
+  bench.bsize  = ZIPBENCH_DEFAULT_BSIZE;
+
+  while ((option = getopt(argc, argv, "n:b:h")) != ERROR)
+    {
+      switch (option)
+        {
+          case 'n':
+            bench.nreads = atoi(optarg);
+            break;
+
+          case 'b':
+            bench.bsize = atoi(optarg);
+            break;
+
+          case 'h':
+            show_usage(argv[0], EXIT_SUCCESS);
+            break;
+
+          default:
+            show_usage(argv[0], EXIT_FAILURE);
+            break;
+        }
+    }
+
+  if (argc - optind != 2 || bench.nreads <= 0 || bench.bsize == 0)
+    {
+      show_usage(argv[0], EXIT_FAILURE);
+    }
+
+  bench.buffer = malloc(bench.bsize);
+  if (bench.buffer == NULL)
+    {
+      printf("Failed to allocate the buffer\n");
+      return EXIT_FAILURE;
+    }
+
+  if (mount(NULL, CONFIG_BENCHMARK_ZIPBENCH_MOUNTPT, "zipfs", MS_RDONLY,
+            argv[optind]) < 0)
+    {
+      printf("Failed to mount %s: %d\n", argv[optind], errno);
+      free(bench.buffer);
+      return EXIT_FAILURE;
+    }
+
+  snprintf(path, sizeof(path), "%s/%s", CONFIG_BENCHMARK_ZIPBENCH_MOUNTPT,
+           argv[optind + 1]);
+
+  bench.fd = open(path, O_RDONLY);
+  if (bench.fd < 0)
+    {
+      printf("Failed to open %s: %d\n", path, errno);
+      ret = EXIT_FAILURE;
+      goto out;
+    }
+
+  bench.fsize = lseek(bench.fd, 0, SEEK_END);
+  if (bench.fsize <= 0)
+    {
+      printf("Failed to get the size of %s\n", path);
+      ret = EXIT_FAILURE;
+      goto out_with_fd;
+    }
+
+  printf("%jd bytes, %d random reads of %zu bytes\n",
+         (intmax_t)bench.fsize, bench.nreads, bench.bsize);
+
+  /* The first random pass records the checkpoints as it goes, the one
+   * after the sequential pass can resume from any of them.
+   */
+
+  zipbench_run(&bench, "random", zipbench_random);
+  zipbench_run(&bench, "sequential", zipbench_sequential);
+  zipbench_run(&bench, "random", zipbench_random);
+
+out_with_fd:
+  close(bench.fd);
+out:
+  umount(CONFIG_BENCHMARK_ZIPBENCH_MOUNTPT);
+  free(bench.buffer);
+  return ret;
+}
@@ -0,0 +1,306 @@
+/****************************************************************************
+ * apps/system/lockstat/lockstat_main.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define LOCKSTAT_PATH    "/proc/lockstat"
+#define LOCKSTAT_LINELEN 512
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* The sort keys, in the order of the columns of /proc/lockstat */
+
+enum lockstat_key_e
+{
+  LOCKSTAT_KEY_ACQUIRED = 0,
+  LOCKSTAT_KEY_CONTENDED,
+  LOCKSTAT_KEY_WAIT_TOTAL,
+  LOCKSTAT_KEY_WAIT_MAX,
+  LOCKSTAT_KEY_HOLD_MAX,
+  LOCKSTAT_NKEYS
+};
+
+/* One line of /proc/lockstat */
+
+struct lockstat_line_s
+{
+  uint64_t key[LOCKSTAT_NKEYS];
+  FAR char *text;
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static FAR const char *g_key_names[LOCKSTAT_NKEYS] =
+{
+  "acquired",
+  "contended",
+  "wait",
+  "maxwait",
+  "hold"
+};
+
+static int g_sort_key = LOCKSTAT_KEY_WAIT_TOTAL;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void show_usage(FAR const char *progname, int exitcode)
+{
+  int i;
+
+  printf("\nUsage: %s [-r] [-n count] [-s key]\n", progname);
+  printf("\nWhere:\n");
+  printf("  -r reset the statistics after showing them\n");
+  printf("  -n show only the first count locks\n");
+  printf("  -s sort by key, one of:");
+  for (i = 0; i < LOCKSTAT_NKEYS; i++)
+    {
+      printf(" %s", g_key_names[i]);
+    }
+
+  printf(" (default: wait)\n");
+  exit(exitcode);
+}
+
+static int lockstat_compare(FAR const void *a, FAR const void *b)
+{
+  FAR const struct lockstat_line_s *la = a;
+  FAR const struct lockstat_line_s *lb = b;
+
+  /* Descending order */
+
+  if (la->key[g_sort_key] > lb->key[g_sort_key])
+    {
+      return -1;
+    }
+  else if (la->key[g_sort_key] < lb->key[g_sort_key])
+    {
+      return 1;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * lockstat_main
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  FAR struct lockstat_line_s *lines = NULL;
+  FAR struct lockstat_line_s *tmp;
+  FAR char *trailer = NULL;
+  FAR char *buffer;
+  FAR FILE *stream;
+  size_t nlines = 0;
+  size_t maxlines = 0;
+  size_t count = SIZE_MAX;
+  size_t i;
+  bool reset = false;
+  int option;
+  int ret = EXIT_SUCCESS;
+
+  while ((option = getopt(argc, argv, "rn:s:h")) != ERROR)
+    {
+      switch (option)
+        {
+          case 'r':
+            reset = true;
+            break;
+
+          case 'n':
+            count = strtoul(optarg, NULL, 0);
+            break;
+
+          case 's':
+            for (g_sort_key = 0; g_sort_key < LOCKSTAT_NKEYS; g_sort_key++)
+              {
+                if (strcmp(optarg, g_key_names[g_sort_key]) == 0)
+                  {
+                    break;
+                  }
+              }
+
+            if (g_sort_key == LOCKSTAT_NKEYS)
+              {
+                printf("Unknown sort key: %s\n", optarg);
+                show_usage(argv[0], EXIT_FAILURE);
+              }
+            break;
+
+          case 'h':
+            show_usage(argv[0], EXIT_SUCCESS);
+            break;
+
+          default:
+            show_usage(argv[0], EXIT_FAILURE);
+            break;
+        }
+    }
+
+  buffer = malloc(LOCKSTAT_LINELEN);
+  if (buffer == NULL)
+    {
+      printf("Failed to allocate the line buffer\n");
+      return EXIT_FAILURE;
+    }
+
+  stream = fopen(LOCKSTAT_PATH, "r");
+  if (stream == NULL)
+    {
+      printf("Failed to open %s\n", LOCKSTAT_PATH);
+      free(buffer);
+      return EXIT_FAILURE;
+    }
+
+  /* The first line is the header, print it as is */
+
+  if (fgets(buffer, LOCKSTAT_LINELEN, stream) != NULL)
+    {
+      fputs(buffer, stdout);
+    }
+
+  while (fgets(buffer, LOCKSTAT_LINELEN, stream) != NULL)
+    {
+      struct lockstat_line_s line;
+      unsigned long acquired;
+      unsigned long contended;
+      FAR void *lock;
+      char type[16];
+
+      /* The line that is not lock statistics ("dropped") is printed
+       * after the sorted ones.
+       */
+
+      if (sscanf(buffer, "%p %15s %lu %lu %" SCNu64 " %" SCNu64
+                 " %" SCNu64, &lock, type, &acquired, &contended,
+                 &line.key[LOCKSTAT_KEY_WAIT_TOTAL],
+                 &line.key[LOCKSTAT_KEY_WAIT_MAX],
+                 &line.key[LOCKSTAT_KEY_HOLD_MAX]) != 7)
+        {
+          if (trailer == NULL)
+            {
+              trailer = strdup(buffer);
+            }
+
+          continue;
+        }
+
+      line.key[LOCKSTAT_KEY_ACQUIRED]  = acquired;
+      line.key[LOCKSTAT_KEY_CONTENDED] = contended;
+      line.text = strdup(buffer);
+      if (line.text == NULL)
+        {
+          ret = EXIT_FAILURE;
+          break;
+        }
+
+      if (nlines >= maxlines)
+        {
+          maxlines = maxlines ? 2 * maxlines : 32;
+          tmp = realloc(lines, maxlines * sizeof(struct lockstat_line_s));
+          if (tmp == NULL)
+            {
+              free(line.text);
+              ret = EXIT_FAILURE;
+              break;
+            }
+
+          lines = tmp;
+        }
+
+      lines[nlines++] = line;
+    }
+
+  fclose(stream);
+
+  qsort(lines, nlines, sizeof(struct lockstat_line_s), lockstat_compare);
+
+  for (i = 0; i < nlines; i++)
+    {
+      if (i < count)
+        {
+          fputs(lines[i].text, stdout);
+        }
+
+      free(lines[i].text);
+    }
+
+  if (trailer != NULL)
+    {
+      fputs(trailer, stdout);
+      free(trailer);
+    }
+
+  free(lines);
+  free(buffer);
+
+  if (ret != EXIT_SUCCESS)
+    {
+      printf("Out of memory\n");
+    }
+
+  /* Any write resets the statistics */
+
+  if (reset)
+    {
+      int fd = open(LOCKSTAT_PATH, O_WRONLY);
+      if (fd < 0 || write(fd, "0", 1) != 1)
+        {
+          printf("Failed to reset %s\n", LOCKSTAT_PATH);
+          ret = EXIT_FAILURE;
+        }
+
+      if (fd >= 0)
+        {
+          close(fd);
+        }
+    }
+
+  return ret;
+}
@@ -34,6 +34,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <stdarg.h>
 #include <stddef.h>
@@ -89,6 +90,8 @@ static void show_usage(FAR const char *progname, int exitcode)
   printf("  Test case 3: epoll_wait with some driver/socket need call\n");
   printf("               poll_setup() again when it's internal state\n");
   printf("               changed.\n");
+  printf("  Test case 4: level-triggered, edge-triggered and oneshot\n");
+  printf("               events of a pipe.\n");
   exit(exitcode);
 }
 
@@ -451,6 +454,118 @@ static int epoll03_teardown(FAR void **state)
   return 0;
 }
 
+/****************************************************************************
+ * Name: epoll04_setup
+ ****************************************************************************/
+
+static int epoll04_setup(FAR void **state)
+{
+  FAR struct epoll_args_s *args = *state;
+  int ret;
+  int fd;
+
+  ret = pipe(args->fd);
+  assert_true(ret >= 0);
+
+  fd = epoll_create(1);
+  assert_true(fd >= 0);
+  args->efd = fd;
+
+  args->ev.events = EPOLLIN;
+  args->ev.data.fd = args->fd[0];
+  ret = epoll_ctl(fd, EPOLL_CTL_ADD, args->fd[0], &args->ev);
+  assert_true(ret >= 0);
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: epoll04
+ ****************************************************************************/
+
+static void epoll04(FAR void **state)
+{
+  FAR struct epoll_args_s *args = *state;
+  struct epoll_event evs;
+  char buf[2];
+  int ret;
+
+  /* Level-triggered: reported as long as the pipe is readable */
+
+  ret = write(args->fd[1], "a", 1);
+  assert_true(ret == 1);
+
+  ret = epoll_wait(args->efd, &evs, 1, 0);
+  assert_true(ret == 1);
+  assert_true(evs.data.fd == args->fd[0] && evs.events == EPOLLIN);
+  ret = epoll_wait(args->efd, &evs, 1, 0);
+  assert_true(ret == 1);
+
+  /* Edge-triggered: reported once per write */
+
+  args->ev.events = EPOLLIN | EPOLLET;
+  ret = epoll_ctl(args->efd, EPOLL_CTL_MOD, args->fd[0], &args->ev);
+  assert_true(ret >= 0);
+
+  ret = epoll_wait(args->efd, &evs, 1, 0);
+  assert_true(ret == 1);
+  ret = epoll_wait(args->efd, &evs, 1, 0);
+  assert_true(ret == 0);
+
+  ret = write(args->fd[1], "b", 1);
+  assert_true(ret == 1);
+  ret = epoll_wait(args->efd, &evs, 1, 100);
+  assert_true(ret == 1);
+  ret = epoll_wait(args->efd, &evs, 1, 0);
+  assert_true(ret == 0);
+
+  /* Oneshot: reported once until it is armed again */
+
+  args->ev.events = EPOLLIN | EPOLLONESHOT;
+  ret = epoll_ctl(args->efd, EPOLL_CTL_MOD, args->fd[0], &args->ev);
+  assert_true(ret >= 0);
+
+  ret = epoll_wait(args->efd, &evs, 1, 0);
+  assert_true(ret == 1);
+  ret = epoll_wait(args->efd, &evs, 1, 0);
+  assert_true(ret == 0);
+
+  ret = epoll_ctl(args->efd, EPOLL_CTL_MOD, args->fd[0], &args->ev);
+  assert_true(ret >= 0);
+  ret = epoll_wait(args->efd, &evs, 1, 0);
+  assert_true(ret == 1);
+
+  /* Level-triggered again: nothing once the pipe is drained */
+
+  args->ev.events = EPOLLIN;
+  ret = epoll_ctl(args->efd, EPOLL_CTL_MOD, args->fd[0], &args->ev);
+  assert_true(ret >= 0);
+
+  ret = read(args->fd[0], buf, sizeof(buf));
+  assert_true(ret == 2);
+  ret = epoll_wait(args->efd, &evs, 1, 0);
+  assert_true(ret == 0);
+}
+
+/****************************************************************************
+ * Name: epoll04_teardown
+ ****************************************************************************/
+
+static int epoll04_teardown(FAR void **state)
+{
+  FAR struct epoll_args_s *args = *state;
+  int ret;
+
+  ret = epoll_ctl(args->efd, EPOLL_CTL_DEL, args->fd[0], &args->ev);
+  assert_true(ret >= 0);
+
+  close(args->efd);
+  close(args->fd[0]);
+  close(args->fd[1]);
+
+  return 0;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -484,6 +599,10 @@ int main(int argc, FAR char *argv[])
                                                epoll03_setup,
                                                epoll03_teardown,
                                                &epoll_args),
+      cmocka_unit_test_prestate_setup_teardown(epoll04,
+                                               epoll04_setup,
+                                               epoll04_teardown,
+                                               &epoll_args),
     };
 
   return cmocka_run_group_tests(tests, NULL, NULL);
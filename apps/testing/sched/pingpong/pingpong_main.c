@@ -0,0 +1,299 @@
+/****************************************************************************
+ * apps/testing/sched/pingpong/pingpong_main.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define PINGPONG_DEFAULT_PAIRS    4
+#define PINGPONG_DEFAULT_SECONDS  5
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* One thread of a ping-pong pair.  The thread waits on 'wait' and posts
+ * 'post'; the peer thread uses the same two semaphores the other way
+ * round.
+ */
+
+struct pingpong_thread_s
+{
+  pthread_t thread;
+  FAR sem_t *wait;
+  FAR sem_t *post;
+  uint32_t count;       /* Number of wakeups received */
+  uint32_t migrations;  /* Number of times the thread changed CPU */
+};
+
+struct pingpong_pair_s
+{
+  sem_t ping;
+  sem_t pong;
+  struct pingpong_thread_s thread[2];
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static volatile bool g_pingpong_stop;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void show_usage(FAR const char *progname, int exitcode)
+{
+  printf("\nUsage: %s [-p pairs] [-d seconds] [-n priority]\n", progname);
+  printf("\nWhere:\n");
+  printf("  -p number of thread pairs (default: %d)\n",
+         PINGPONG_DEFAULT_PAIRS);
+  printf("  -d duration of the run in seconds (default: %d)\n",
+         PINGPONG_DEFAULT_SECONDS);
+  printf("  -n priority of the threads (default: priority of %s)\n",
+         progname);
+  exit(exitcode);
+}
+
+static FAR void *pingpong_thread(FAR void *arg)
+{
+  FAR struct pingpong_thread_s *self = arg;
+  int cpu = sched_getcpu();
+  int now;
+
+  while (!g_pingpong_stop)
+    {
+      sem_post(self->post);
+      if (sem_wait(self->wait) < 0)
+        {
+          break;
+        }
+
+      self->count++;
+
+      now = sched_getcpu();
+      if (now != cpu)
+        {
+          self->migrations++;
+          cpu = now;
+        }
+    }
+
+  /* Make sure that the peer is not left waiting */
+
+  sem_post(self->post);
+  return NULL;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * pingpong_main
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  FAR struct pingpong_pair_s *pairs;
+  struct sched_param param;
+  struct timespec start;
+  struct timespec end;
+  pthread_attr_t attr;
+  uint64_t elapsed;
+  uint64_t total = 0;
+  uint64_t migrations = 0;
+  int npairs = PINGPONG_DEFAULT_PAIRS;
+  int seconds = PINGPONG_DEFAULT_SECONDS;
+  int priority = -1;
+  int started = 0;
+  int option;
+  int ret;
+  int i;
+  int j;
+
+  while ((option = getopt(argc, argv, "p:d:n:h")) != ERROR)
+    {
+      switch (option)
+        {
+          case 'p':
+            npairs = atoi(optarg);
+            break;
+
+          case 'd':
+            seconds = atoi(optarg);
+            break;
+
+          case 'n':
+            priority = atoi(optarg);
+            break;
+
+          case 'h':
+            show_usage(argv[0], EXIT_SUCCESS);
+            break;
+
+          default:
+            show_usage(argv[0], EXIT_FAILURE);
+            break;
+        }
+    }
+
+  if (npairs <= 0 || seconds <= 0)
+    {
+      show_usage(argv[0], EXIT_FAILURE);
+    }
+
+  pairs = calloc(npairs, sizeof(struct pingpong_pair_s));
+  if (pairs == NULL)
+    {
+      printf("Failed to allocate %d pairs\n", npairs);
+      return EXIT_FAILURE;
+    }
+
+  if (priority < 0)
+    {
+      sched_getparam(0, &param);
+      priority = param.sched_priority;
+    }
+
+  /* The threads run at the same priority as (or at a higher priority
+   * than) this task, so they are all created before any of them starts
+   * ping-ponging.
+   */
+
+  pthread_attr_init(&attr);
+  param.sched_priority = priority;
+  pthread_attr_setschedparam(&attr, &param);
+
+  g_pingpong_stop = false;
+  sched_lock();
+
+  for (i = 0; i < npairs; i++)
+    {
+      FAR struct pingpong_pair_s *pair = &pairs[i];
+
+      sem_init(&pair->ping, 0, 0);
+      sem_init(&pair->pong, 0, 0);
+
+      pair->thread[0].wait = &pair->ping;
+      pair->thread[0].post = &pair->pong;
+      pair->thread[1].wait = &pair->pong;
+      pair->thread[1].post = &pair->ping;
+
+      for (j = 0; j < 2; j++)
+        {
+          ret = pthread_create(&pair->thread[j].thread, &attr,
+                               pingpong_thread, &pair->thread[j]);
+          if (ret != 0)
+            {
+              printf("pthread_create failed: %d\n", ret);
+              break;
+            }
+
+          started++;
+        }
+
+      if (ret != 0)
+        {
+          break;
+        }
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  sched_unlock();
+
+  if (started == 2 * npairs)
+    {
+      sleep(seconds);
+    }
+
+  g_pingpong_stop = true;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  /* Release a thread whose peer could not be created */
+
+  if (started % 2 != 0)
+    {
+      sem_post(&pairs[started / 2].ping);
+    }
+
+  for (i = 0; i < started; i++)
+    {
+      pthread_join(pairs[i / 2].thread[i % 2].thread, NULL);
+    }
+
+  pthread_attr_destroy(&attr);
+
+  elapsed = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000 +
+            (end.tv_nsec - start.tv_nsec) / 1000;
+
+  printf("%8s %12s %12s\n", "pair", "roundtrips", "migrations");
+  for (i = 0; i < started / 2; i++)
+    {
+      FAR struct pingpong_pair_s *pair = &pairs[i];
+
+      /* Each thread is woken up once per round trip */
+
+      printf("%8d %12" PRIu32 " %12" PRIu32 "\n", i,
+             pair->thread[0].count,
+             pair->thread[0].migrations + pair->thread[1].migrations);
+
+      total      += pair->thread[0].count;
+      migrations += pair->thread[0].migrations + pair->thread[1].migrations;
+    }
+
+  for (i = 0; i < npairs && i <= started / 2; i++)
+    {
+      sem_destroy(&pairs[i].ping);
+      sem_destroy(&pairs[i].pong);
+    }
+
+  free(pairs);
+
+  if (elapsed > 0)
+    {
+      printf("total: %" PRIu64 " roundtrips in %" PRIu64 " us, "
+             "%" PRIu64 " roundtrips/s, %" PRIu64 " migrations\n",
+             total, elapsed, total * 1000000 / elapsed, migrations);
+    }
+
+  return started == 2 * npairs ? EXIT_SUCCESS : EXIT_FAILURE;
+}
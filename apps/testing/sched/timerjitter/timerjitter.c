@@ -25,10 +25,17 @@
  ****************************************************************************/
 
 #include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <signal.h>
 #include <time.h>
+#include <unistd.h>
+
+#if defined(CONFIG_TIMER_FD) || defined(__linux__)
+#  include <sys/timerfd.h>
+#  define HAVE_TIMERFD
+#endif
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -55,8 +62,21 @@
  * Private Type
  ****************************************************************************/
 
+/* The timing source being measured.  POSIX timers are based on wdog (tick
+ * resolution) while clock_nanosleep and timerfd use hrtimers when the
+ * kernel is built with CONFIG_HRTIMER.
+ */
+
+enum timerjitter_mode_e
+{
+  TIMERJITTER_TIMER = 0,      /* timer_create + sigwait */
+  TIMERJITTER_NANOSLEEP,      /* clock_nanosleep(TIMER_ABSTIME) */
+  TIMERJITTER_TIMERFD         /* timerfd_create + read */
+};
+
 struct timerjitter_param_s
 {
+  enum timerjitter_mode_e mode;
   clockid_t     clockid;
   unsigned int  interval;
   unsigned long max_cnt;
@@ -139,9 +159,13 @@ static FAR void *timerjitter(FAR void *arg)
   struct itimerspec tspec;
   struct sigevent   sigev;
   sigset_t          sigset;
-  timer_t           timer;
+  timer_t           timer = 0;
+#ifdef HAVE_TIMERFD
+  uint64_t          expirations;
+#endif
   int64_t           diff;
   int               sigs;
+  int               fd = -1;
   int               ret;
 
   sigemptyset(&sigset);
@@ -151,10 +175,6 @@ static FAR void *timerjitter(FAR void *arg)
   intv.tv_sec  = param->interval / USEC_PER_SEC;
   intv.tv_nsec = (param->interval % USEC_PER_SEC) * 1000;
 
-  sigev.sigev_notify = SIGEV_SIGNAL;
-  sigev.sigev_signo  = SIGALRM;
-
-  timer_create(param->clockid, &sigev, &timer);
   clock_gettime(param->clockid, &now);
 
   next = now;
@@ -167,7 +187,28 @@ static FAR void *timerjitter(FAR void *arg)
   /* Using TIMER_ABSTIME */
 
   tspec.it_value = next;
-  timer_settime(timer, TIMER_ABSTIME, &tspec, NULL);
+
+  if (param->mode == TIMERJITTER_TIMER)
+    {
+      sigev.sigev_notify = SIGEV_SIGNAL;
+      sigev.sigev_signo  = SIGALRM;
+
+      timer_create(param->clockid, &sigev, &timer);
+      timer_settime(timer, TIMER_ABSTIME, &tspec, NULL);
+    }
+#ifdef HAVE_TIMERFD
+  else if (param->mode == TIMERJITTER_TIMERFD)
+    {
+      fd = timerfd_create(param->clockid, 0);
+      if (fd < 0)
+        {
+          printf("timerfd_create failed\n");
+          return NULL;
+        }
+
+      timerfd_settime(fd, TFD_TIMER_ABSTIME, &tspec, NULL);
+    }
+#endif
 
   param->avg = 0;
   param->max = 0;
@@ -175,9 +216,34 @@ static FAR void *timerjitter(FAR void *arg)
 
   while (param->cur_cnt++ < param->max_cnt)
     {
+      if (param->mode == TIMERJITTER_NANOSLEEP)
+        {
+          /* Sleep until the next absolute deadline */
+
+          ret = clock_nanosleep(param->clockid, TIMER_ABSTIME, &next, NULL);
+          if (ret)
+            {
+              printf("clock_nanosleep failed %d\n", ret);
+              break;
+            }
+        }
+#ifdef HAVE_TIMERFD
+      else if (param->mode == TIMERJITTER_TIMERFD)
+        {
+          /* Wait for the timerfd to expire */
+
+          if (read(fd, &expirations, sizeof(expirations)) !=
+              sizeof(expirations))
+            {
+              printf("timerfd read failed\n");
+              break;
+            }
+        }
+#endif
+
       /* Wait for SIGALRM */
 
-      if (sigwait(&sigset, &sigs) < 0)
+      else if (sigwait(&sigset, &sigs) < 0)
         {
           printf("sig wait failed\n");
           break;
@@ -220,6 +286,15 @@ static FAR void *timerjitter(FAR void *arg)
         }
     }
 
+  if (param->mode == TIMERJITTER_TIMER)
+    {
+      timer_delete(timer);
+    }
+  else if (fd >= 0)
+    {
+      close(fd);
+    }
+
   param->avg = param->avg / param->cur_cnt;
   return NULL;
 }
@@ -236,6 +311,7 @@ int main(int argc, FAR char *argv[])
 {
   struct timerjitter_param_s param =
   {
+    .mode     = TIMERJITTER_TIMER,
     .clockid  = DEFAULT_CLOCKID,
     .interval = DEFAULT_INTERVAL,
     .max_cnt  = DEFAULT_ITERATION,
@@ -280,12 +356,27 @@ int main(int argc, FAR char *argv[])
                   case 'r':
                     param.clockid = CLOCK_REALTIME;
                     continue;
+                  case 't':
+                    param.mode = TIMERJITTER_TIMER;
+                    continue;
+                  case 'n':
+                    param.mode = TIMERJITTER_NANOSLEEP;
+                    continue;
+#ifdef HAVE_TIMERFD
+                  case 'f':
+                    param.mode = TIMERJITTER_TIMERFD;
+                    continue;
+#endif
                   case 'h':
                     printf(
-                    "usage: timerjitter [-pmr] [interval(us)] [iteration]\n"
+                    "usage: timerjitter [-pmrtnf] [interval(us)] "
+                    "[iteration]\n"
                     "-p: print time diff between two iteration\n"
                     "-m: use CLOCK_MONOTONIC\n"
                     "-r: use CLOCK_REALTIME\n"
+                    "-t: wait on a POSIX timer signal (default)\n"
+                    "-n: sleep with clock_nanosleep(TIMER_ABSTIME)\n"
+                    "-f: wait on a timerfd\n"
                     "");
                     return 0;
                   default:
@@ -30,6 +30,8 @@
 #include <sys/ioctl.h>
 
 #include <dirent.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <string.h>
@@ -39,6 +41,26 @@
 #include "hostfs.h"
 #include "sim_internal.h"
 
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_HOSTFS_ASYNC
+
+/* The submission queue is served in order by the I/O threads, the
+ * completion queue is drained by host_aio_poll().  Both are protected by
+ * g_aio_lock, which the NuttX side only takes with interrupts disabled.
+ */
+
+static pthread_mutex_t    g_aio_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t     g_aio_cond = PTHREAD_COND_INITIALIZER;
+static struct host_aio_s *g_aio_head;
+static struct host_aio_s *g_aio_tail;
+static struct host_aio_s *g_aio_done;
+static int                g_aio_nthreads;
+
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -120,6 +142,137 @@ static void host_stat_convert(struct stat *hostbuf, struct nuttx_stat_s *buf)
   buf->st_blocks       = hostbuf->st_blocks;
 }
 
+#ifdef CONFIG_FS_HOSTFS_ASYNC
+
+/****************************************************************************
+ * Name: host_aio_perform
+ *
+ * Description:
+ *   Perform one request in the context of an I/O thread.
+ *
+ ****************************************************************************/
+
+static void host_aio_perform(struct host_aio_s *aio)
+{
+  struct nuttx_dirent_s *entries;
+  int64_t ret;
+
+  switch (aio->op)
+    {
+      case HOST_AIO_OPEN:
+        ret = host_open(aio->path, aio->flags, aio->mode);
+        break;
+
+      case HOST_AIO_READ:
+        ret = host_uninterruptible_errno(pread, aio->fd, aio->buf,
+                                         aio->count, aio->offset);
+        break;
+
+      case HOST_AIO_WRITE:
+
+        /* Files opened for append always write at the host position */
+
+        if (aio->offset < 0)
+          {
+            ret = host_uninterruptible_errno(write, aio->fd, aio->buf,
+                                             aio->count);
+          }
+        else
+          {
+            ret = host_uninterruptible_errno(pwrite, aio->fd, aio->buf,
+                                             aio->count, aio->offset);
+          }
+
+        break;
+
+      case HOST_AIO_SYNC:
+        ret = host_uninterruptible_errno(fsync, aio->fd);
+        break;
+
+      case HOST_AIO_FSTAT:
+        ret = host_fstat(aio->fd, aio->buf);
+        break;
+
+      case HOST_AIO_STAT:
+        ret = host_stat(aio->path, aio->buf);
+        break;
+
+      case HOST_AIO_READDIR:
+
+        /* Return a batch of entries, fewer only at the end */
+
+        entries = aio->buf;
+        for (ret = 0; ret < (int64_t)aio->count; ret++)
+          {
+            if (host_readdir(aio->dirp, &entries[ret]) < 0)
+              {
+                break;
+              }
+          }
+
+        break;
+
+      default:
+        ret = -ENOSYS;
+        break;
+    }
+
+  aio->result = ret;
+}
+
+/****************************************************************************
+ * Name: host_aio_thread
+ *
+ * Description:
+ *   An I/O thread.  It blocks all the signals, so that the interrupts of
+ *   the simulation are only ever delivered to the CPU threads.
+ *
+ ****************************************************************************/
+
+static void *host_aio_thread(void *arg)
+{
+  struct host_aio_s *aio;
+  sigset_t set;
+  int kick;
+
+  sigfillset(&set);
+  pthread_sigmask(SIG_SETMASK, &set, NULL);
+
+  while (1)
+    {
+      pthread_mutex_lock(&g_aio_lock);
+      while (g_aio_head == NULL)
+        {
+          pthread_cond_wait(&g_aio_cond, &g_aio_lock);
+        }
+
+      aio        = g_aio_head;
+      g_aio_head = aio->next;
+      pthread_mutex_unlock(&g_aio_lock);
+
+      host_aio_perform(aio);
+
+      /* Raise the interrupt only when the completion queue was empty, the
+       * handler drains all of it.
+       */
+
+      pthread_mutex_lock(&g_aio_lock);
+      kick       = g_aio_done == NULL;
+      aio->next  = g_aio_done;
+      g_aio_done = aio;
+      pthread_mutex_unlock(&g_aio_lock);
+
+      if (kick)
+        {
+          kill(getpid(), host_aio_irq());
+        }
+    }
+
+  return NULL;
+}
+
+#endif /* CONFIG_FS_HOSTFS_ASYNC */
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -597,3 +750,111 @@ int host_chstat(const char *path, const struct nuttx_stat_s *buf, int flags)
 
   return 0;
 }
+
+#ifdef CONFIG_FS_HOSTFS_ASYNC
+
+/****************************************************************************
+ * Name: host_aio_submit
+ *
+ * Description:
+ *   Queue a request for the I/O threads, which are started by the first
+ *   request.  aio->done() is called from host_aio_poll() when it is done.
+ *
+ ****************************************************************************/
+
+int host_aio_submit(struct host_aio_s *aio)
+{
+  pthread_attr_t attr;
+  pthread_t thread;
+  uint64_t flags;
+  int ret = 0;
+
+  flags = up_irq_save();
+  pthread_mutex_lock(&g_aio_lock);
+
+  if (g_aio_nthreads == 0)
+    {
+      pthread_attr_init(&attr);
+      pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+      while (g_aio_nthreads < CONFIG_FS_HOSTFS_ASYNC_THREADS)
+        {
+          ret = pthread_create(&thread, &attr, host_aio_thread, NULL);
+          if (ret != 0)
+            {
+              break;
+            }
+
+          g_aio_nthreads++;
+        }
+
+      pthread_attr_destroy(&attr);
+    }
+
+  if (g_aio_nthreads > 0)
+    {
+      aio->next = NULL;
+      if (g_aio_head == NULL)
+        {
+          g_aio_head = aio;
+        }
+      else
+        {
+          g_aio_tail->next = aio;
+        }
+
+      g_aio_tail = aio;
+      pthread_cond_signal(&g_aio_cond);
+      ret = 0;
+    }
+  else
+    {
+      ret = host_errno_convert(-ret);
+    }
+
+  pthread_mutex_unlock(&g_aio_lock);
+  up_irq_restore(flags);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: host_aio_poll
+ *
+ * Description:
+ *   Complete the finished requests, called from the interrupt handler of
+ *   host_aio_irq().
+ *
+ ****************************************************************************/
+
+void host_aio_poll(void)
+{
+  struct host_aio_s *aio;
+  struct host_aio_s *next;
+
+  pthread_mutex_lock(&g_aio_lock);
+  aio        = g_aio_done;
+  g_aio_done = NULL;
+  pthread_mutex_unlock(&g_aio_lock);
+
+  /* done() may release the request, read the link first */
+
+  for (; aio != NULL; aio = next)
+    {
+      next = aio->next;
+      aio->done(aio);
+    }
+}
+
+/****************************************************************************
+ * Name: host_aio_irq
+ *
+ * Description:
+ *   The interrupt raised by the I/O threads when requests are done.
+ *
+ ****************************************************************************/
+
+int host_aio_irq(void)
+{
+  return SIGIO;
+}
+
+#endif /* CONFIG_FS_HOSTFS_ASYNC */
@@ -25,8 +25,10 @@
  ****************************************************************************/
 
 #include <nuttx/arch.h>
+#include <nuttx/irq.h>
 #include <nuttx/audio/audio.h>
 #include <nuttx/audio/audio_fake.h>
+#include <nuttx/fs/hostfs.h>
 #include <nuttx/kthread.h>
 #include <nuttx/motor/foc/foc_dummy.h>
 #include <nuttx/mtd/mtd.h>
@@ -161,6 +163,16 @@ static void sim_init_smartfs(void)
 }
 #endif
 
+#ifdef CONFIG_FS_HOSTFS_ASYNC
+static int sim_hostfs_interrupt(int irq, void *context, void *arg)
+{
+  /* Wake up the threads waiting for the finished hostfs requests */
+
+  host_aio_poll();
+  return OK;
+}
+#endif
+
 static int sim_loop_task(int argc, char **argv)
 {
   while (1)
@@ -271,6 +283,13 @@ void up_initialize(void)
 
   sim_uartinit();
 
+#ifdef CONFIG_FS_HOSTFS_ASYNC
+  /* The hostfs I/O threads raise this interrupt when requests are done */
+
+  irq_attach(host_aio_irq(), sim_hostfs_interrupt, NULL);
+  up_enable_irq(host_aio_irq());
+#endif
+
 #if defined(CONFIG_FS_FAT) && !defined(CONFIG_DISABLE_MOUNTPOINT)
   sim_registerblockdevice(); /* Our FAT ramdisk at /dev/ram0 */
 #endif
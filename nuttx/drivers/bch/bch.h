@@ -35,29 +35,61 @@
 
 #include <nuttx/mutex.h>
 #include <nuttx/fs/fs.h>
+#include <nuttx/fs/pagecache.h>
 
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
 
 #define MAX_OPENCNT       (255)                  /* Limit of uint8_t */
+#define BCH_NOSECTOR      ((size_t)-1)           /* Cache entry is unused */
+
+/* Transfers to the block driver, through the page cache if enabled */
+
+#ifdef CONFIG_FS_PAGECACHE
+#  define bchlib_hwread(b,buf,s,n)  pagecache_read((b)->inode, buf, s, n)
+#  define bchlib_hwwrite(b,buf,s,n) pagecache_write((b)->inode, buf, s, n)
+#else
+#  define bchlib_hwread(b,buf,s,n) \
+     (b)->inode->u.i_bops->read((b)->inode, buf, s, n)
+#  define bchlib_hwwrite(b,buf,s,n) \
+     (b)->inode->u.i_bops->write((b)->inode, buf, s, n)
+#endif
 
 /****************************************************************************
  * Public Types
  ****************************************************************************/
 
+/* One entry of the sector cache */
+
+struct bch_cache_s
+{
+  size_t sector;           /* The sector in the buffer or BCH_NOSECTOR */
+  uint32_t age;            /* LRU clock at the last access */
+  bool dirty;              /* true: Data has been written to the buffer */
+  FAR uint8_t *buffer;     /* One sector buffer */
+};
+
 struct bchlib_s
 {
   FAR struct inode *inode; /* I-node of the block driver */
   uint32_t sectsize;       /* The size of one sector on the device */
   size_t nsectors;         /* Number of sectors supported by the device */
-  size_t sector;           /* The current sector in the buffer */
+  size_t nextsector;       /* The sector after the last one accessed */
   mutex_t lock;            /* For atomic accesses to this structure */
+  uint32_t age;            /* LRU clock of the sector cache */
+  uint16_t ncache;         /* Number of sectors in the cache */
   uint8_t refs;            /* Number of references */
-  bool dirty;              /* true: Data has been written to the buffer */
   bool readonly;           /* true: Only read operations are supported */
   bool unlinked;           /* true: The driver has been unlinked */
-  FAR uint8_t *buffer;     /* One sector buffer */
+  FAR struct bch_cache_s *cache; /* Sector cache, allocated on first use */
+  FAR uint8_t *buffer;     /* Buffers of all the sectors in the cache */
+
+#ifndef CONFIG_FS_PAGECACHE
+  /* Write back requests if the driver has a submit method */
+
+  FAR struct block_request_s *reqs;
+#endif
 
 #if defined(CONFIG_BCH_ENCRYPTION)
   uint8_t key[CONFIG_BCH_ENCRYPTION_KEY_SIZE];  /* Encryption key */
@@ -83,8 +115,12 @@ EXTERN const struct file_operations g_bch_fops;
  * Public Function Prototypes
  ****************************************************************************/
 
-EXTERN int  bchlib_flushsector(FAR struct bchlib_s *bch, bool discard);
-EXTERN int  bchlib_readsector(FAR struct bchlib_s *bch, size_t sector);
+EXTERN int  bchlib_flushsector(FAR struct bchlib_s *bch, size_t sector,
+                               size_t nsectors, bool discard);
+EXTERN int  bchlib_readsector(FAR struct bchlib_s *bch, size_t sector,
+                              FAR struct bch_cache_s **cache);
+EXTERN int  bchlib_setcache(FAR struct bchlib_s *bch, size_t ncache);
+EXTERN void bchlib_freecache(FAR struct bchlib_s *bch);
 
 #undef EXTERN
 #if defined(__cplusplus)
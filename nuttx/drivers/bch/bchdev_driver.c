@@ -172,7 +172,7 @@ static int bch_close(FAR struct file *filep)
 
   /* Flush any dirty pages remaining in the cache */
 
-  bchlib_flushsector(bch, false);
+  bchlib_flushsector(bch, 0, bch->nsectors, false);
 
   /* Decrement the reference count (I don't use bchlib_decref() because I
    * want the entire close operation to be atomic wrt other driver
@@ -435,19 +435,49 @@ static int bch_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
         break;
 #endif
 
-      case BIOC_DISCARD:
+      /* This is a request to change the size of the sector cache */
+
+      case BIOC_CACHESIZE:
         {
-          /* Invalidate the sector so next read is from the device- */
+          ret = nxmutex_lock(&bch->lock);
+          if (ret < 0)
+            {
+              break;
+            }
 
-          bch->sector = (size_t)-1;
-          goto ioctl_default;
+          ret = bchlib_setcache(bch, (size_t)arg);
+          nxmutex_unlock(&bch->lock);
         }
+        break;
 
+      case BIOC_DISCARD:
       case BIOC_FLUSH:
         {
-          /* Flush any dirty pages remaining in the cache */
+          ret = nxmutex_lock(&bch->lock);
+          if (ret < 0)
+            {
+              break;
+            }
+
+          /* Flush any dirty pages remaining in the cache.  On discard, also
+           * invalidate the cached sectors so next read is from the device.
+           */
 
-          ret = bchlib_flushsector(bch, false);
+          ret = bchlib_flushsector(bch, 0, bch->nsectors,
+                                   cmd == BIOC_DISCARD);
+#ifdef CONFIG_FS_PAGECACHE
+          if (ret >= 0)
+            {
+              ret = pagecache_flush(bch->inode);
+            }
+
+          if (ret >= 0 && cmd == BIOC_DISCARD)
+            {
+              ret = pagecache_invalidate(bch->inode);
+            }
+#endif
+
+          nxmutex_unlock(&bch->lock);
           if (ret < 0)
             {
               break;
@@ -458,7 +488,6 @@ static int bch_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
 
       /* Pass the IOCTL command on to the contained block driver. */
 
-ioctl_default:
       default:
         {
           FAR struct inode *bchinode = bch->inode;
@@ -27,8 +27,10 @@
 #include <nuttx/config.h>
 #include <nuttx/kmalloc.h>
 
+#include <sys/param.h>
 #include <sys/types.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <errno.h>
 #include <assert.h>
 #include <debug.h>
@@ -62,10 +64,11 @@ static void bch_xor(uint32_t *R, uint32_t *A, uint32_t *B)
  ****************************************************************************/
 
 #if defined(CONFIG_BCH_ENCRYPTION)
-static int bch_cypher(FAR struct bchlib_s *bch, int encrypt)
+static int bch_cypher(FAR struct bchlib_s *bch,
+                      FAR struct bch_cache_s *cache, int encrypt)
 {
   int blocks = bch->sectsize / 16;
-  FAR uint32_t *buffer = (FAR uint32_t *)bch->buffer;
+  FAR uint32_t *buffer = (FAR uint32_t *)cache->buffer;
   int i;
 
   for (i = 0; i < blocks; i++, buffer += 16 / sizeof(uint32_t) )
@@ -73,7 +76,7 @@ static int bch_cypher(FAR struct bchlib_s *bch, int encrypt)
       uint32_t T[4];
       uint32_t X[4] =
       {
-        bch->sector, 0, 0, i
+        cache->sector, 0, 0, i
       };
 
       aes_cypher(X, X, 16, NULL, bch->key, CONFIG_BCH_ENCRYPTION_KEY_SIZE,
@@ -92,122 +95,516 @@ static int bch_cypher(FAR struct bchlib_s *bch, int encrypt)
 #endif
 
 /****************************************************************************
- * Public Functions
+ * Name: bchlib_inrange
+ *
+ * Description:
+ *   Return true if the cache entry holds one of the 'nsectors' sectors
+ *   starting at 'sector'.
+ *
  ****************************************************************************/
 
+static inline bool bchlib_inrange(FAR struct bch_cache_s *cache,
+                                  size_t sector, size_t nsectors)
+{
+  return cache->sector != BCH_NOSECTOR && cache->sector >= sector &&
+         cache->sector - sector < nsectors;
+}
+
 /****************************************************************************
- * Name: bchlib_flushsector
+ * Name: bchlib_alloccache
  *
  * Description:
- *   Flush the current contents of the sector buffer (if dirty)
- *
- * Assumptions:
- *   Caller must assume mutual exclusion
+ *   Allocate the sector cache on first use.  The sector buffers are
+ *   allocated as one contiguous region so that adjacent cache entries
+ *   holding adjacent sectors can be transferred with a single request.
  *
  ****************************************************************************/
 
-int bchlib_flushsector(FAR struct bchlib_s *bch, bool discard)
+static int bchlib_alloccache(FAR struct bchlib_s *bch)
 {
-  FAR struct inode *inode;
-  ssize_t ret = OK;
+  size_t i;
+
+  if (bch->cache != NULL)
+    {
+      return OK;
+    }
 
-  /* Check if the sector has been modified and is out of synch with the
-   * media.
+  bch->cache = kmm_zalloc(bch->ncache * sizeof(struct bch_cache_s));
+  if (bch->cache == NULL)
+    {
+      ferr("Failed to allocate sector cache\n");
+      return -ENOMEM;
+    }
+
+#if CONFIG_BCH_BUFFER_ALIGNMENT != 0
+  bch->buffer = kmm_memalign(CONFIG_BCH_BUFFER_ALIGNMENT,
+                             bch->ncache * bch->sectsize);
+#else
+  bch->buffer = kmm_malloc(bch->ncache * bch->sectsize);
+#endif
+  if (bch->buffer == NULL)
+    {
+      ferr("Failed to allocate sector buffer\n");
+      kmm_free(bch->cache);
+      bch->cache = NULL;
+      return -ENOMEM;
+    }
+
+  for (i = 0; i < bch->ncache; i++)
+    {
+      bch->cache[i].sector = BCH_NOSECTOR;
+      bch->cache[i].buffer = bch->buffer + i * bch->sectsize;
+    }
+
+#ifndef CONFIG_FS_PAGECACHE
+  /* One write request per run of the cache at most.  Without memory the
+   * runs are written one at a time.
    */
 
-  if (bch->dirty && bch->buffer != NULL)
+  if (bch->inode->u.i_bops->submit != NULL)
     {
-      inode = bch->inode;
+      bch->reqs = kmm_malloc(bch->ncache * sizeof(struct block_request_s));
+    }
+#endif
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: bchlib_run
+ *
+ * Description:
+ *   Return the number of dirty entries starting at slot 'first' and before
+ *   slot 'last' that hold adjacent sectors of [sector, sector + nsectors).
+ *
+ ****************************************************************************/
+
+static size_t bchlib_run(FAR struct bchlib_s *bch, size_t first,
+                         size_t last, size_t sector, size_t nsectors)
+{
+  FAR struct bch_cache_s *cache = &bch->cache[first];
+  size_t count;
+
+  if (!cache->dirty || !bchlib_inrange(cache, sector, nsectors))
+    {
+      return 0;
+    }
+
+  for (count = 1; first + count < last; count++)
+    {
+      if (!cache[count].dirty ||
+          cache[count].sector != cache->sector + count ||
+          !bchlib_inrange(&cache[count], sector, nsectors))
+        {
+          break;
+        }
+    }
+
+  return count;
+}
+
+/****************************************************************************
+ * Name: bchlib_writebatch
+ *
+ * Description:
+ *   bchlib_writeback() for block drivers with a submit method: The runs
+ *   are submitted together and waited for at once.
+ *
+ ****************************************************************************/
+
+#ifndef CONFIG_FS_PAGECACHE
+static int bchlib_writebatch(FAR struct bchlib_s *bch, size_t first,
+                             size_t last, size_t sector, size_t nsectors)
+{
+  FAR struct block_request_s *req;
+  FAR struct bch_cache_s *cache;
+  struct block_batch_s batch;
+  size_t nreqs = 0;
+  size_t count;
+  size_t i;
+  size_t j;
+  int ret;
+
+  block_batch_init(&batch, bch->inode);
+
+  while (first < last)
+    {
+      count = bchlib_run(bch, first, last, sector, nsectors);
+      if (count == 0)
+        {
+          first++;
+          continue;
+        }
+
+      cache = &bch->cache[first];
 
 #if defined(CONFIG_BCH_ENCRYPTION)
-      /* Encrypt data as necessary */
+      for (i = 0; i < count; i++)
+        {
+          bch_cypher(bch, &cache[i], CYPHER_ENCRYPT);
+        }
+#endif
 
-      bch_cypher(bch, CYPHER_ENCRYPT);
+      block_batch_add(&batch, &bch->reqs[nreqs++], BLOCK_REQ_WRITE,
+                      cache->buffer, cache->sector, count);
+      first += count;
+    }
+
+  ret = block_batch_wait(&batch);
+  if (ret < 0)
+    {
+      ferr("Write failed: %d\n", ret);
+    }
+
+  /* The sectors are in sync with the media if all the requests succeeded */
+
+  for (i = 0; i < nreqs; i++)
+    {
+      req   = &bch->reqs[i];
+      cache = &bch->cache[(req->buffer - bch->buffer) / bch->sectsize];
+      for (j = 0; j < req->nsectors; j++)
+        {
+#if defined(CONFIG_BCH_ENCRYPTION)
+          bch_cypher(bch, &cache[j], CYPHER_DECRYPT);
 #endif
+          if (ret >= 0)
+            {
+              cache[j].dirty = false;
+            }
+        }
+    }
 
-      /* Write the sector to the media */
+  return ret;
+}
+#endif
 
-      ret = inode->u.i_bops->write(inode, bch->buffer, bch->sector, 1);
-      if (ret < 0)
+/****************************************************************************
+ * Name: bchlib_writeback
+ *
+ * Description:
+ *   Write the dirty cache entries of the slots [first, last) that hold one
+ *   of the sectors [sector, sector + nsectors) back to the media.  Runs of
+ *   dirty entries that are adjacent both in the cache and on the media are
+ *   written with a single request.
+ *
+ ****************************************************************************/
+
+static int bchlib_writeback(FAR struct bchlib_s *bch, size_t first,
+                            size_t last, size_t sector, size_t nsectors)
+{
+  FAR struct bch_cache_s *cache;
+  ssize_t ret;
+  size_t count;
+  size_t i;
+
+#ifndef CONFIG_FS_PAGECACHE
+  if (bch->reqs != NULL)
+    {
+      return bchlib_writebatch(bch, first, last, sector, nsectors);
+    }
+#endif
+
+  while (first < last)
+    {
+      count = bchlib_run(bch, first, last, sector, nsectors);
+      if (count == 0)
         {
-          ferr("Write failed: %zd\n", ret);
-          return (int)ret;
+          first++;
+          continue;
         }
 
+      cache = &bch->cache[first];
+
+#if defined(CONFIG_BCH_ENCRYPTION)
+      /* Encrypt data as necessary */
+
+      for (i = 0; i < count; i++)
+        {
+          bch_cypher(bch, &cache[i], CYPHER_ENCRYPT);
+        }
+#endif
+
+      /* Write the sectors to the media */
+
+      ret = bchlib_hwwrite(bch, cache->buffer, cache->sector, count);
+
 #if defined(CONFIG_BCH_ENCRYPTION)
       /* Computation overhead to save memory for extra sector buffer
        * TODO: Add configuration switch for extra sector buffer
        */
 
-      bch_cypher(bch, CYPHER_DECRYPT);
+      for (i = 0; i < count; i++)
+        {
+          bch_cypher(bch, &cache[i], CYPHER_DECRYPT);
+        }
 #endif
 
-      /* The sector is now in sync with the media */
+      if (ret < 0)
+        {
+          ferr("Write failed: %zd\n", ret);
+          return (int)ret;
+        }
+
+      /* The sectors are now in sync with the media */
+
+      for (i = 0; i < count; i++)
+        {
+          cache[i].dirty = false;
+        }
 
-      bch->dirty = false;
+      first += count;
     }
 
-  if (discard)
+  return OK;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: bchlib_flushsector
+ *
+ * Description:
+ *   Flush the cached contents of the sectors [sector, sector + nsectors)
+ *   (if dirty) and optionally remove them from the cache.
+ *
+ * Assumptions:
+ *   Caller must assume mutual exclusion
+ *
+ ****************************************************************************/
+
+int bchlib_flushsector(FAR struct bchlib_s *bch, size_t sector,
+                       size_t nsectors, bool discard)
+{
+  int ret;
+  size_t i;
+
+  if (bch->cache == NULL)
     {
-      bch->sector = (size_t)-1;
+      return OK;
     }
 
-  return (int)ret;
+  ret = bchlib_writeback(bch, 0, bch->ncache, sector, nsectors);
+  if (ret >= 0 && discard)
+    {
+      for (i = 0; i < bch->ncache; i++)
+        {
+          if (bchlib_inrange(&bch->cache[i], sector, nsectors))
+            {
+              bch->cache[i].sector = BCH_NOSECTOR;
+            }
+        }
+    }
+
+  return ret;
 }
 
 /****************************************************************************
  * Name: bchlib_readsector
  *
  * Description:
- *   Read the current sector contents into buffer
+ *   Return the cache entry holding 'sector', reading the sector from the
+ *   media if it is not cached yet.  The least recently used entries are
+ *   replaced.  If the sector follows the last one accessed, up to
+ *   CONFIG_BCH_READAHEAD sectors are read ahead with the same request.
  *
  * Assumptions:
  *   Caller must assume mutual exclusion
  *
  ****************************************************************************/
 
-int bchlib_readsector(FAR struct bchlib_s *bch, size_t sector)
+int bchlib_readsector(FAR struct bchlib_s *bch, size_t sector,
+                      FAR struct bch_cache_s **cache)
 {
-  FAR struct inode *inode;
-  ssize_t ret = OK;
+  FAR struct bch_cache_s *entry;
+  uint32_t bestage = 0;
+  uint32_t age;
+  size_t count = 1;
+  size_t best = 0;
+  size_t i;
+  size_t j;
+  ssize_t ret;
+
+  ret = bchlib_alloccache(bch);
+  if (ret < 0)
+    {
+      return (int)ret;
+    }
 
-  if (bch->buffer == NULL)
+  bch->age++;
+
+  /* Check if the sector is already cached */
+
+  for (i = 0; i < bch->ncache; i++)
     {
-#if CONFIG_BCH_BUFFER_ALIGNMENT != 0
-      bch->buffer = kmm_memalign(CONFIG_BCH_BUFFER_ALIGNMENT, bch->sectsize);
-#else
-      bch->buffer = kmm_malloc(bch->sectsize);
-#endif
-      if (bch->buffer == NULL)
+      entry = &bch->cache[i];
+      if (entry->sector == sector)
         {
-          ferr("Failed to allocate sector buffer\n");
-          return -ENOMEM;
+          entry->age     = bch->age;
+          bch->nextsector = sector + 1;
+          *cache = entry;
+          return OK;
         }
     }
 
-  if (bch->sector != sector)
+#if CONFIG_BCH_READAHEAD > 0
+  /* Read ahead on sequential access, using at most half of the cache so
+   * that the read ahead sectors do not evict all of the others.  Stop at
+   * the first sector that is already cached.
+   */
+
+  if (sector == bch->nextsector)
     {
-      inode = bch->inode;
+      count = MIN(CONFIG_BCH_READAHEAD, bch->ncache / 2);
+      count = MIN(count, bch->nsectors - sector);
 
-      ret = bchlib_flushsector(bch, true);
-      if (ret < 0)
+      for (i = 1; i < count; i++)
         {
-          ferr("Flush failed: %zd\n", ret);
-          return (int)ret;
+          for (j = 0; j < bch->ncache; j++)
+            {
+              if (bch->cache[j].sector == sector + i)
+                {
+                  count = i;
+                  break;
+                }
+            }
         }
 
-      ret = inode->u.i_bops->read(inode, bch->buffer, sector, 1);
-      if (ret < 0)
+      count = MAX(count, 1);
+    }
+#endif
+
+  /* Select the 'count' adjacent entries that were least recently used,
+   * i.e. whose most recently used entry is the oldest one.  Unused entries
+   * are the oldest ones of all.  Ages are measured relative to the current
+   * clock so that the comparison survives the wrap-around of the clock.
+   */
+
+  for (i = 0; i + count <= bch->ncache; i++)
+    {
+      age = UINT32_MAX;
+      for (j = i; j < i + count; j++)
         {
-          ferr("Read failed: %zd\n", ret);
-          return (int)ret;
+          entry = &bch->cache[j];
+          if (entry->sector != BCH_NOSECTOR &&
+              bch->age - entry->age < age)
+            {
+              age = bch->age - entry->age;
+            }
+        }
+
+      if (i == 0 || age > bestage)
+        {
+          bestage = age;
+          best    = i;
         }
+    }
 
-      bch->sector = sector;
+  /* Write back the dirty entries to be replaced and forget them */
+
+  ret = bchlib_writeback(bch, best, best + count, 0, BCH_NOSECTOR);
+  if (ret < 0)
+    {
+      ferr("Flush failed: %zd\n", ret);
+      return (int)ret;
+    }
+
+  for (i = best; i < best + count; i++)
+    {
+      bch->cache[i].sector = BCH_NOSECTOR;
+    }
+
+  entry = &bch->cache[best];
+  ret = bchlib_hwread(bch, entry->buffer, sector, count);
+  if (ret < 0)
+    {
+      ferr("Read failed: %zd\n", ret);
+      return (int)ret;
+    }
+
+  /* Only the sectors actually read are valid */
+
+  if (ret > 0 && (size_t)ret < count)
+    {
+      count = ret;
+    }
+
+  for (i = 0; i < count; i++)
+    {
+      entry[i].sector = sector + i;
+      entry[i].age    = bch->age;
+      entry[i].dirty  = false;
 #if defined(CONFIG_BCH_ENCRYPTION)
-      bch_cypher(bch, CYPHER_DECRYPT);
+      bch_cypher(bch, &entry[i], CYPHER_DECRYPT);
 #endif
     }
 
-  return (int)ret;
+  bch->nextsector = sector + 1;
+  *cache = entry;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: bchlib_setcache
+ *
+ * Description:
+ *   Change the number of sectors in the cache.  The cached sectors are
+ *   flushed and the new cache is allocated on the next access.
+ *
+ * Assumptions:
+ *   Caller must assume mutual exclusion
+ *
+ ****************************************************************************/
+
+int bchlib_setcache(FAR struct bchlib_s *bch, size_t ncache)
+{
+  int ret;
+
+  if (ncache < 1 || ncache > UINT16_MAX)
+    {
+      return -EINVAL;
+    }
+
+  ret = bchlib_flushsector(bch, 0, bch->nsectors, false);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  bchlib_freecache(bch);
+  bch->ncache = ncache;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: bchlib_freecache
+ *
+ * Description:
+ *   Free the sector cache.  Dirty sectors are lost, the caller must flush
+ *   them first.
+ *
+ ****************************************************************************/
+
+void bchlib_freecache(FAR struct bchlib_s *bch)
+{
+  if (bch->cache != NULL)
+    {
+      kmm_free(bch->cache);
+      bch->cache = NULL;
+    }
+
+  if (bch->buffer != NULL)
+    {
+      kmm_free(bch->buffer);
+      bch->buffer = NULL;
+    }
+
+#ifndef CONFIG_FS_PAGECACHE
+  if (bch->reqs != NULL)
+    {
+      kmm_free(bch->reqs);
+      bch->reqs = NULL;
+    }
+#endif
 }
@@ -70,6 +70,7 @@ ssize_t bchlib_read(FAR void *handle, FAR char *buffer, off_t offset,
                     size_t len)
 {
   FAR struct bchlib_s *bch = (FAR struct bchlib_s *)handle;
+  FAR struct bch_cache_s *cache;
   size_t   nsectors;
   size_t   sector;
   uint16_t sectoffset;
@@ -103,7 +104,7 @@ ssize_t bchlib_read(FAR void *handle, FAR char *buffer, off_t offset,
     {
       /* Read the sector into the sector buffer */
 
-      ret = bchlib_readsector(bch, sector);
+      ret = bchlib_readsector(bch, sector, &cache);
       if (ret < 0)
         {
           return ret;
@@ -120,7 +121,7 @@ ssize_t bchlib_read(FAR void *handle, FAR char *buffer, off_t offset,
           nbytes = len;
         }
 
-      memcpy(buffer, &bch->buffer[sectoffset], nbytes);
+      memcpy(buffer, &cache->buffer[sectoffset], nbytes);
 
       /* Adjust pointers and counts */
 
@@ -148,8 +149,18 @@ ssize_t bchlib_read(FAR void *handle, FAR char *buffer, off_t offset,
           nsectors = bch->nsectors - sector;
         }
 
-      ret = bch->inode->u.i_bops->read(bch->inode, (FAR uint8_t *)buffer,
-                                       sector, nsectors);
+      /* Flush the dirty cached sectors of the range so that the media is
+       * up to date.
+       */
+
+      ret = bchlib_flushsector(bch, sector, nsectors, false);
+      if (ret < 0)
+        {
+          ferr("ERROR: Flush failed: %d\n", ret);
+          return ret;
+        }
+
+      ret = bchlib_hwread(bch, (FAR uint8_t *)buffer, sector, nsectors);
       if (ret < 0)
         {
           ferr("ERROR: Read failed: %d\n", ret);
@@ -162,6 +173,8 @@ ssize_t bchlib_read(FAR void *handle, FAR char *buffer, off_t offset,
       nbytes     = nsectors * bch->sectsize;
       bytesread += nbytes;
 
+      bch->nextsector = sector;
+
       if (sector >= bch->nsectors)
         {
           return bytesread;
@@ -177,7 +190,7 @@ ssize_t bchlib_read(FAR void *handle, FAR char *buffer, off_t offset,
     {
       /* Read the sector into the sector buffer */
 
-      ret = bchlib_readsector(bch, sector);
+      ret = bchlib_readsector(bch, sector, &cache);
       if (ret < 0)
         {
           return ret;
@@ -185,7 +198,7 @@ ssize_t bchlib_read(FAR void *handle, FAR char *buffer, off_t offset,
 
       /* Copy the head end of the sector to the user buffer */
 
-      memcpy(buffer, bch->buffer, len);
+      memcpy(buffer, cache->buffer, len);
 
       /* Adjust counts */
 
@@ -111,7 +111,7 @@ int bchlib_setup(FAR const char *blkdev, int oflags, FAR void **handle)
   nxmutex_init(&bch->lock);
   bch->nsectors = geo.geo_nsectors;
   bch->sectsize = geo.geo_sectorsize;
-  bch->sector   = (size_t)-1;
+  bch->ncache   = CONFIG_BCH_CACHE_NSECTORS;
   bch->readonly = readonly;
   *handle = bch;
   return OK;
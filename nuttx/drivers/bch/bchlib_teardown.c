@@ -64,7 +64,16 @@ int bchlib_teardown(FAR void *handle)
 
   /* Flush any pending data to the block driver */
 
-  bchlib_flushsector(bch, false);
+  bchlib_flushsector(bch, 0, bch->nsectors, false);
+
+#ifdef CONFIG_FS_PAGECACHE
+  /* Write back the sectors delayed by the page cache and forget them */
+
+  if (pagecache_invalidate(bch->inode) < 0)
+    {
+      ferr("ERROR: Failed to write back the cached sectors\n");
+    }
+#endif
 
   /* Close the block driver */
 
@@ -72,10 +81,7 @@ int bchlib_teardown(FAR void *handle)
 
   /* Free the BCH state structure */
 
-  if (bch->buffer)
-    {
-      kmm_free(bch->buffer);
-    }
+  bchlib_freecache(bch);
 
   nxmutex_destroy(&bch->lock);
   kmm_free(bch);
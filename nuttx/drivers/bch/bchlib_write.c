@@ -56,9 +56,8 @@ ssize_t bchlib_write(FAR void *handle, FAR const char *buffer, off_t offset,
         size_t len)
 {
   FAR struct bchlib_s *bch = (FAR struct bchlib_s *)handle;
-#ifndef CONFIG_BCH_FORCE_INDIRECT
+  FAR struct bch_cache_s *cache;
   size_t   nsectors;
-#endif
   size_t   sector;
   uint16_t sectoffset;
   size_t   nbytes;
@@ -89,7 +88,7 @@ ssize_t bchlib_write(FAR void *handle, FAR const char *buffer, off_t offset,
     {
       /* Read the full sector into the sector buffer */
 
-      ret = bchlib_readsector(bch, sector);
+      ret = bchlib_readsector(bch, sector, &cache);
       if (ret < 0)
         {
           return ret;
@@ -106,8 +105,8 @@ ssize_t bchlib_write(FAR void *handle, FAR const char *buffer, off_t offset,
           nbytes = len;
         }
 
-      memcpy(&bch->buffer[sectoffset], buffer, nbytes);
-      bch->dirty = true;
+      memcpy(&cache->buffer[sectoffset], buffer, nbytes);
+      cache->dirty = true;
 
       /* Adjust pointers and counts */
 
@@ -127,14 +126,16 @@ ssize_t bchlib_write(FAR void *handle, FAR const char *buffer, off_t offset,
 
 #ifdef CONFIG_BCH_FORCE_INDIRECT
 
-  /* indirectly by using sector buffer.
+  /* indirectly by using the sector cache.  The sectors are written back
+   * together once all of them are in the cache.
    */
 
+  nsectors = 0;
   while (len > 0)
     {
       /* Read the sector into the sector buffer */
 
-      ret = bchlib_readsector(bch, sector);
+      ret = bchlib_readsector(bch, sector, &cache);
       if (ret < 0)
         {
           return ret;
@@ -143,24 +144,29 @@ ssize_t bchlib_write(FAR void *handle, FAR const char *buffer, off_t offset,
       /* Copy the data from the user buffer to the sector buffer */
 
       nbytes = len > bch->sectsize ? bch->sectsize : len;
-      memcpy(bch->buffer, buffer, nbytes);
-      bch->dirty = true;
-
-      /* Write the sector back to the block device */
-
-      ret = bchlib_flushsector(bch, false);
-      if (ret < 0)
-        {
-          ferr("ERROR: Flush failed: %d\n", ret);
-          return ret;
-        }
+      memcpy(cache->buffer, buffer, nbytes);
+      cache->dirty = true;
 
       /* Adjust pointers and counts */
 
       buffer       += nbytes;
       len          -= nbytes;
       byteswritten += nbytes;
-      sector++;
+      nsectors++;
+
+      if (++sector >= bch->nsectors)
+        {
+          break;
+        }
+    }
+
+  /* Write the sectors back to the block device */
+
+  ret = bchlib_flushsector(bch, sector - nsectors, nsectors, false);
+  if (ret < 0)
+    {
+      ferr("ERROR: Flush failed: %d\n", ret);
+      return ret;
     }
 #else
 
@@ -175,10 +181,16 @@ ssize_t bchlib_write(FAR void *handle, FAR const char *buffer, off_t offset,
           nsectors = bch->nsectors - sector;
         }
 
-      /* Flush the dirty sector to keep the sector sequence */
+      /* Flush the dirty sectors to keep the sector sequence and forget
+       * the cached copies of the sectors that are overwritten.
+       */
+
+      ret = bchlib_flushsector(bch, 0, bch->nsectors, false);
+      if (ret >= 0)
+        {
+          ret = bchlib_flushsector(bch, sector, nsectors, true);
+        }
 
-      ret = bchlib_flushsector(bch, sector <= bch->sector &&
-                               bch->sector < (sector + nsectors));
       if (ret < 0)
         {
           ferr("ERROR: Flush failed: %d\n", ret);
@@ -187,8 +199,8 @@ ssize_t bchlib_write(FAR void *handle, FAR const char *buffer, off_t offset,
 
       /* Write the contiguous sectors */
 
-      ret = bch->inode->u.i_bops->write(bch->inode, (FAR uint8_t *)buffer,
-                                        sector, nsectors);
+      ret = bchlib_hwwrite(bch, (FAR const uint8_t *)buffer, sector,
+                           nsectors);
       if (ret < 0)
         {
           ferr("ERROR: Write failed: %d\n", ret);
@@ -216,7 +228,7 @@ ssize_t bchlib_write(FAR void *handle, FAR const char *buffer, off_t offset,
     {
       /* Read the sector into the sector buffer */
 
-      ret = bchlib_readsector(bch, sector);
+      ret = bchlib_readsector(bch, sector, &cache);
       if (ret < 0)
         {
           return ret;
@@ -224,8 +236,8 @@ ssize_t bchlib_write(FAR void *handle, FAR const char *buffer, off_t offset,
 
       /* Copy the head end of the sector from the user buffer */
 
-      memcpy(bch->buffer, buffer, len);
-      bch->dirty = true;
+      memcpy(cache->buffer, buffer, len);
+      cache->dirty = true;
 
       /* Adjust counts */
 
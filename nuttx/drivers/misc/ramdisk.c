@@ -95,6 +95,8 @@ static int     rd_geometry(FAR struct inode *inode,
                            FAR struct geometry *geometry);
 static int     rd_ioctl(FAR struct inode *inode, int cmd,
                         unsigned long arg);
+static int     rd_submit(FAR struct inode *inode,
+                         FAR struct block_request_s *req);
 
 #ifndef CONFIG_DISABLE_PSEUDOFS_OPERATIONS
 static int     rd_unlink(FAR struct inode *inode);
@@ -116,10 +118,11 @@ static const struct block_operations g_bops =
   rd_read,     /* read     */
   rd_write,    /* write    */
   rd_geometry, /* geometry */
-  rd_ioctl     /* ioctl    */
+  rd_ioctl,    /* ioctl    */
 #ifndef CONFIG_DISABLE_PSEUDOFS_OPERATIONS
-  , rd_unlink  /* unlink   */
+  rd_unlink,   /* unlink   */
 #endif
+  rd_submit    /* submit   */
 };
 
 /****************************************************************************
@@ -363,6 +366,51 @@ static int rd_ioctl(FAR struct inode *inode, int cmd, unsigned long arg)
   return -ENOTTY;
 }
 
+/****************************************************************************
+ * Name: rd_submit
+ *
+ * Description:
+ *   Perform a chain of requests.  The copies are done right away, the
+ *   driver serves to exercise the users of the asynchronous interface.
+ *
+ ****************************************************************************/
+
+static int rd_submit(FAR struct inode *inode,
+                     FAR struct block_request_s *req)
+{
+  FAR struct block_request_s *next;
+  ssize_t ret;
+
+  for (; req != NULL; req = next)
+    {
+      next = req->merged;
+
+      switch (req->op)
+        {
+          case BLOCK_REQ_READ:
+            ret = rd_read(inode, req->buffer, req->sector, req->nsectors);
+            break;
+
+          case BLOCK_REQ_WRITE:
+            ret = rd_write(inode, req->buffer, req->sector, req->nsectors);
+            break;
+
+          case BLOCK_REQ_FLUSH:
+            ret = 0;
+            break;
+
+          default:
+            ret = -EINVAL;
+            break;
+        }
+
+      req->result = ret;
+      req->done(req);
+    }
+
+  return OK;
+}
+
 /****************************************************************************
  * Name: rd_unlink
  *
@@ -41,7 +41,11 @@
 #include <errno.h>
 #include <fcntl.h>
 
+#include <nuttx/crc32.h>
 #include <nuttx/kmalloc.h>
+#include <nuttx/mutex.h>
+#include <nuttx/queue.h>
+#include <nuttx/wqueue.h>
 #include <nuttx/fs/fs.h>
 #include <nuttx/fs/ioctl.h>
 #include <nuttx/mtd/mtd.h>
@@ -63,10 +67,90 @@
 
 #define DEV_NAME_MAX    (NAME_MAX + 5)
 
+#if defined(CONFIG_FTL_WRITEBACK_DELAY) && CONFIG_FTL_WRITEBACK_DELAY > 0
+#  define FTL_HAVE_WBDELAY 1
+#endif
+
+/* Dirty R/W blocks of a cached erase block */
+
+#ifdef CONFIG_FTL_WRITEBACK
+#  define FTL_ISDIRTY(e,b)  (((e)->dirty[(b) >> 3] & (1 << ((b) & 7))) != 0)
+#  define FTL_SETDIRTY(e,b) ((e)->dirty[(b) >> 3] |= 1 << ((b) & 7))
+#  define FTL_DIRTYSIZE(d)  (((d)->blkper + 7) >> 3)
+#endif
+
+#ifdef CONFIG_FTL_LOGSTRUCT
+#  define ftl_read_blocks(d,s,n,b) ftl_log_bread(d,s,n,b)
+#else
+#  define ftl_read_blocks(d,s,n,b) ftl_mtd_bread(d,s,n,b)
+#endif
+
+#ifdef CONFIG_FTL_LOGSTRUCT
+/* Journal of the log-structured map */
+
+#define FTL_LOG_MAGIC      0x4d4c5446 /* "FTLM" */
+#define FTL_LOG_CHECKPOINT 1
+#define FTL_LOG_UPDATE     2
+#define FTL_LOG_NONE       UINT32_MAX
+
+/* Map entries of a checkpoint and update page */
+
+#define FTL_LOG_CKPER(d)   (((d)->geo.blocksize - \
+                             sizeof(struct ftl_loghdr_s)) / sizeof(uint32_t))
+#define FTL_LOG_UPDPER(d)  (FTL_LOG_CKPER(d) / 2)
+
+/* State of the physical erase blocks in log-structured mode */
+
+#define FTL_PBLOCK_FREE    0  /* Not used, to be erased */
+#define FTL_PBLOCK_ERASED  1  /* Not used and erased */
+#define FTL_PBLOCK_USED    2  /* Holds a logical erase block */
+#define FTL_PBLOCK_MAP     3  /* Holds the journal */
+#define FTL_PBLOCK_BAD     4
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
 
+#ifdef CONFIG_FTL_WRITEBACK
+/* An erase block of the write-back cache */
+
+struct ftl_cache_s
+{
+  dq_entry_t            node;     /* LRU list, most recent first */
+  off_t                 eblock;   /* Logical erase block, -1 if unused */
+  uint16_t              ndirty;   /* Number of R/W blocks written */
+  bool                  valid;    /* All the R/W blocks are in buffer */
+  FAR uint8_t          *dirty;    /* Bitmap of the R/W blocks written */
+  FAR uint8_t          *buffer;   /* Content of the erase block */
+};
+#endif
+
+#ifdef CONFIG_FTL_LOGSTRUCT
+/* Header of a journal page.  A checkpoint page is followed by the physical
+ * erase blocks of 'count' logical erase blocks from 'first' on, an update
+ * page by 'count' pairs of logical and physical erase block.
+ */
+
+struct ftl_loghdr_s
+{
+  uint32_t              magic;
+  uint32_t              seq;      /* Increases with every journal write */
+  uint32_t              crc;      /* CRC32 of the page with crc zero */
+  uint16_t              type;
+  uint16_t              count;
+  uint32_t              first;
+};
+
+/* A logical erase block remapped, but not in the journal yet */
+
+struct ftl_pending_s
+{
+  uint32_t              lblock;
+  uint32_t              oldblock; /* Physical erase block replaced */
+};
+#endif
+
 struct ftl_struct_s
 {
   FAR struct mtd_dev_s *mtd;      /* Contained MTD interface */
@@ -84,6 +168,43 @@ struct ftl_struct_s
 
   FAR off_t            *lptable;
   off_t                 lpcount;
+
+  struct ftl_stats_s    stats;    /* Write statistics */
+
+#ifdef CONFIG_FTL_WRITEBACK
+  /* The write-back cache of erase blocks */
+
+  mutex_t               lock;     /* Protects the cache and the map */
+  dq_queue_t            lru;      /* Cached erase blocks */
+  struct ftl_cache_s    cache[CONFIG_FTL_WRITEBACK_NBLOCKS];
+#  ifdef FTL_HAVE_WBDELAY
+  struct work_s         work;     /* Delayed write-back */
+#  endif
+#endif
+
+#ifdef CONFIG_FTL_LOGSTRUCT
+  /* The map between logical and physical erase blocks */
+
+  FAR uint32_t         *l2p;      /* Physical erase block of each logical */
+  FAR uint8_t          *pstate;   /* State of each physical erase block */
+  FAR uint8_t          *logpage;  /* One journal page */
+  uint32_t              nlblocks; /* Number of logical erase blocks */
+  uint32_t              cursor;   /* Next physical erase block to use */
+
+  /* The two erase blocks of the journal */
+
+  uint32_t              mapblock[2];
+  uint32_t              mapseq;   /* Sequence of the last journal page */
+  uint16_t              mappage;  /* Next page of the journal block */
+  uint8_t               mapside;  /* Journal block in use */
+  uint8_t               erasestate;
+  uint16_t              npending;
+  uint16_t              maxpending;
+  struct ftl_pending_s  pending[CONFIG_FTL_LOGSTRUCT_NSPARES];
+#  ifdef CONFIG_SCHED_LPWORK
+  struct work_s         gcwork;   /* Background erase */
+#  endif
+#endif
 };
 
 /****************************************************************************
@@ -98,9 +219,11 @@ static ssize_t ftl_read(FAR struct inode *inode, FAR unsigned char *buffer,
                  blkcnt_t start_sector, unsigned int nsectors);
 static ssize_t ftl_flush(FAR void *priv, FAR const uint8_t *buffer,
                  off_t startblock, size_t nblocks);
+#ifndef CONFIG_FTL_LOGSTRUCT
 static ssize_t ftl_flush_direct(FAR struct ftl_struct_s *dev,
                                 FAR const uint8_t *buffer,
                                 off_t startblock, size_t nblocks);
+#endif
 static ssize_t ftl_write(FAR struct inode *inode,
                  FAR const unsigned char *buffer, blkcnt_t start_sector,
                  unsigned int nsectors);
@@ -111,6 +234,10 @@ static int     ftl_ioctl(FAR struct inode *inode, int cmd,
 #ifndef CONFIG_DISABLE_PSEUDOFS_OPERATIONS
 static int     ftl_unlink(FAR struct inode *inode);
 #endif
+#ifdef CONFIG_FTL_WRITEBACK
+static int     ftl_cache_sync(FAR struct ftl_struct_s *dev);
+#endif
+static void    ftl_uninitialize(FAR struct ftl_struct_s *dev);
 
 /****************************************************************************
  * Private Data
@@ -133,6 +260,7 @@ static const struct block_operations g_bops =
  * Private Functions
  ****************************************************************************/
 
+#ifndef CONFIG_FTL_LOGSTRUCT
 /****************************************************************************
  * Name: ftl_init_map
  *
@@ -205,219 +333,1359 @@ static size_t ftl_get_cblock(FAR struct ftl_struct_s *dev, off_t start,
         }
     }
 
-  return count;
+  return count;
+}
+#endif
+
+/****************************************************************************
+ * Name: ftl_open
+ *
+ * Description: Open the block device
+ *
+ ****************************************************************************/
+
+static int ftl_open(FAR struct inode *inode)
+{
+  FAR struct ftl_struct_s *dev;
+
+  DEBUGASSERT(inode->i_private);
+  dev = inode->i_private;
+  dev->refs++;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftl_close
+ *
+ * Description: close the block device
+ *
+ ****************************************************************************/
+
+static int ftl_close(FAR struct inode *inode)
+{
+  FAR struct ftl_struct_s *dev;
+
+  DEBUGASSERT(inode->i_private);
+  dev = inode->i_private;
+
+#ifdef CONFIG_FTL_WRITEBUFFER
+  rwb_flush(&dev->rwb);
+#endif
+#ifdef CONFIG_FTL_WRITEBACK
+  ftl_cache_sync(dev);
+#endif
+
+  if (--dev->refs == 0 && dev->unlinked)
+    {
+      ftl_uninitialize(dev);
+    }
+
+  return OK;
+}
+
+#ifndef CONFIG_FTL_LOGSTRUCT
+/****************************************************************************
+ * Name: ftl_mtd_bread
+ *
+ * Description:
+ *   Read the specified number of sectors. If mtd device is nor flash, it
+ *   can be read once time. If mtd device is nand flash, it can be read one
+ *   block every time and need to skip bad block until the specified number
+ *   of sectors finish.
+ *
+ ****************************************************************************/
+
+static ssize_t ftl_mtd_bread(FAR struct ftl_struct_s *dev, off_t startblock,
+                             size_t nblocks, FAR uint8_t *buffer)
+{
+  off_t mask = dev->blkper - 1;
+  size_t nread = nblocks;
+  ssize_t ret = OK;
+
+  if (dev->lptable == NULL)
+    {
+      ret = MTD_BREAD(dev->mtd, startblock, nblocks, buffer);
+      if (ret != nblocks)
+        {
+          ferr("ERROR: Read %zu blocks starting at block %" PRIdOFF
+               " failed: %zd\n", nblocks, startblock, ret);
+        }
+
+      return ret;
+    }
+
+  while (nblocks > 0)
+    {
+      off_t startphysicalblock;
+      off_t starteraseblock;
+      off_t offset;
+      size_t count;
+
+      starteraseblock = startblock / dev->blkper;
+      if (starteraseblock >= dev->lpcount)
+        {
+          ret = -ENOSPC;
+          break;
+        }
+
+      offset = startblock & mask;
+      count = ftl_get_cblock(dev, starteraseblock,
+                             (offset + nblocks + mask) / dev->blkper);
+      count = MIN(count * dev->blkper - offset, nblocks);
+      startphysicalblock = dev->lptable[starteraseblock] *
+                           dev->blkper + offset;
+      ret = MTD_BREAD(dev->mtd, startphysicalblock, count, buffer);
+      if (ret == count || ret == -EUCLEAN)
+        {
+          nblocks -= count;
+          startblock += count;
+          buffer += count * dev->geo.blocksize;
+        }
+      else
+        {
+          ftl_update_map(dev, starteraseblock);
+          break;
+        }
+    }
+
+  return nblocks != nread ? nread - nblocks : ret;
+}
+
+/****************************************************************************
+ * Name: ftl_mtd_bwrite
+ *
+ * Description:
+ *   Write the specified eraseblocks. If mtd device is nor flash, it
+ *   can be written once time. If mtd device is nand flash, it can be write
+ *   one block every time and need to skip bad block until writing success.
+ *
+ ****************************************************************************/
+
+static ssize_t ftl_mtd_bwrite(FAR struct ftl_struct_s *dev, off_t startblock,
+                              FAR const uint8_t *buffer)
+{
+  off_t starteraseblock;
+  ssize_t ret;
+
+  dev->stats.nprogrammed += dev->blkper;
+  if (dev->lptable == NULL)
+    {
+      ret = MTD_BWRITE(dev->mtd, startblock, dev->blkper, buffer);
+      if (ret != dev->blkper)
+        {
+          ferr("ERROR: Write block %" PRIdOFF " failed: %zd\n",
+               startblock, ret);
+        }
+
+      return ret;
+    }
+
+  starteraseblock = startblock / dev->blkper;
+  while (1)
+    {
+      if (starteraseblock >= dev->lpcount)
+        {
+          return -ENOSPC;
+        }
+
+      ret = MTD_BWRITE(dev->mtd, dev->lptable[starteraseblock] * dev->blkper,
+                       dev->blkper, buffer);
+      if (ret == dev->blkper)
+        {
+          return ret;
+        }
+
+      dev->stats.nprogrammed += dev->blkper;
+
+      MTD_MARKBAD(dev->mtd, dev->lptable[starteraseblock]);
+      ftl_update_map(dev, starteraseblock);
+    }
+}
+
+/****************************************************************************
+ * Name: ftl_mtd_erase
+ *
+ * Description:
+ *   Erase the specified number of sectors. If mtd device is nor flash, it
+ *   can be erased once time. If mtd device is nand flash, it can be erased
+ *   one block every time and need to skip bad block until the specified
+ *   number of sectors finish.
+ *
+ ****************************************************************************/
+
+static ssize_t ftl_mtd_erase(FAR struct ftl_struct_s *dev, off_t startblock)
+{
+  ssize_t ret;
+
+  dev->stats.nerased++;
+  if (dev->lptable == NULL)
+    {
+      ret = MTD_ERASE(dev->mtd, startblock, 1);
+      if (ret < 0)
+        {
+          ferr("ERROR: Erase block %" PRIdOFF " failed: %zd\n",
+               startblock, ret);
+        }
+
+      return ret;
+    }
+
+  while (1)
+    {
+      if (startblock >= dev->lpcount)
+        {
+          return -ENOSPC;
+        }
+
+      ret = MTD_ERASE(dev->mtd, dev->lptable[startblock], 1);
+      if (ret == 1)
+        {
+          return ret;
+        }
+
+      dev->stats.nerased++;
+
+      MTD_MARKBAD(dev->mtd, dev->lptable[startblock]);
+      ftl_update_map(dev, startblock);
+    }
+}
+
+#endif /* CONFIG_FTL_LOGSTRUCT */
+
+#ifdef CONFIG_FTL_LOGSTRUCT
+/****************************************************************************
+ * Name: ftl_log_find
+ *
+ * Description: Find the next physical erase block in the given state.
+ *
+ ****************************************************************************/
+
+static uint32_t ftl_log_find(FAR struct ftl_struct_s *dev, uint8_t state)
+{
+  uint32_t pblock;
+  uint32_t i;
+
+  for (i = 0; i < dev->geo.neraseblocks; i++)
+    {
+      pblock = (dev->cursor + i) % dev->geo.neraseblocks;
+      if (dev->pstate[pblock] == state)
+        {
+          return pblock;
+        }
+    }
+
+  return FTL_LOG_NONE;
+}
+
+/****************************************************************************
+ * Name: ftl_log_erase
+ *
+ * Description: Erase a free physical erase block, retire it on failure.
+ *
+ ****************************************************************************/
+
+static int ftl_log_erase(FAR struct ftl_struct_s *dev, uint32_t pblock)
+{
+  int ret;
+
+  dev->stats.nerased++;
+  ret = MTD_ERASE(dev->mtd, pblock, 1);
+  if (ret >= 0)
+    {
+      dev->pstate[pblock] = FTL_PBLOCK_ERASED;
+      return OK;
+    }
+
+  ferr("ERROR: Erase block %" PRIu32 " failed: %d\n", pblock, ret);
+  MTD_MARKBAD(dev->mtd, pblock);
+  dev->pstate[pblock] = FTL_PBLOCK_BAD;
+  return ret;
+}
+
+/****************************************************************************
+ * Name: ftl_log_worker
+ *
+ * Description: Erase the free physical erase blocks in the background, so
+ *              that writes find them erased.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SCHED_LPWORK
+static void ftl_log_worker(FAR void *arg)
+{
+  FAR struct ftl_struct_s *dev = arg;
+  uint32_t pblock;
+
+  do
+    {
+      if (nxmutex_lock(&dev->lock) < 0)
+        {
+          return;
+        }
+
+      pblock = ftl_log_find(dev, FTL_PBLOCK_FREE);
+      if (pblock != FTL_LOG_NONE)
+        {
+          ftl_log_erase(dev, pblock);
+        }
+
+      nxmutex_unlock(&dev->lock);
+    }
+  while (pblock != FTL_LOG_NONE);
+}
+#endif
+
+static void ftl_log_reclaim(FAR struct ftl_struct_s *dev)
+{
+#ifdef CONFIG_SCHED_LPWORK
+  if (work_available(&dev->gcwork))
+    {
+      work_queue(LPWORK, &dev->gcwork, ftl_log_worker, dev, 0);
+    }
+#endif
+}
+
+/****************************************************************************
+ * Name: ftl_log_alloc
+ *
+ * Description: Get an erased physical erase block.
+ *
+ ****************************************************************************/
+
+static int ftl_log_alloc(FAR struct ftl_struct_s *dev,
+                         FAR uint32_t *pblock)
+{
+  *pblock = ftl_log_find(dev, FTL_PBLOCK_ERASED);
+  while (*pblock == FTL_LOG_NONE)
+    {
+      /* Nothing was erased in the background yet */
+
+      *pblock = ftl_log_find(dev, FTL_PBLOCK_FREE);
+      if (*pblock == FTL_LOG_NONE)
+        {
+          return -ENOSPC;
+        }
+
+      if (ftl_log_erase(dev, *pblock) < 0)
+        {
+          *pblock = FTL_LOG_NONE;
+        }
+    }
+
+  dev->cursor = (*pblock + 1) % dev->geo.neraseblocks;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftl_log_readpage
+ *
+ * Description: Read and check a page of a journal block.  Returns -ENODATA
+ *              if the page is erased.
+ *
+ ****************************************************************************/
+
+static int ftl_log_readpage(FAR struct ftl_struct_s *dev, int side,
+                            uint16_t page)
+{
+  FAR struct ftl_loghdr_s *hdr = (FAR struct ftl_loghdr_s *)dev->logpage;
+  uint32_t crc;
+  ssize_t ret;
+  size_t i;
+
+  ret = MTD_BREAD(dev->mtd, dev->mapblock[side] * dev->blkper + page, 1,
+                  dev->logpage);
+  if (ret != 1 && ret != -EUCLEAN)
+    {
+      return ret < 0 ? ret : -EIO;
+    }
+
+  for (i = 0; i < dev->geo.blocksize; i++)
+    {
+      if (dev->logpage[i] != dev->erasestate)
+        {
+          break;
+        }
+    }
+
+  if (i == dev->geo.blocksize)
+    {
+      return -ENODATA;
+    }
+
+  crc      = hdr->crc;
+  hdr->crc = 0;
+  if (hdr->magic != FTL_LOG_MAGIC ||
+      crc32(dev->logpage, dev->geo.blocksize) != crc)
+    {
+      return -EINVAL;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftl_log_writepage
+ *
+ * Description: Seal the journal page in logpage and program it.
+ *
+ ****************************************************************************/
+
+static int ftl_log_writepage(FAR struct ftl_struct_s *dev, int side,
+                             uint16_t page)
+{
+  FAR struct ftl_loghdr_s *hdr = (FAR struct ftl_loghdr_s *)dev->logpage;
+  ssize_t ret;
+
+  hdr->magic = FTL_LOG_MAGIC;
+  hdr->seq   = ++dev->mapseq;
+  hdr->crc   = 0;
+  hdr->crc   = crc32(dev->logpage, dev->geo.blocksize);
+
+  dev->stats.nprogrammed++;
+  ret = MTD_BWRITE(dev->mtd, dev->mapblock[side] * dev->blkper + page, 1,
+                   dev->logpage);
+  if (ret != 1)
+    {
+      ferr("ERROR: Write journal page %u failed: %zd\n", page, ret);
+      return ret < 0 ? ret : -EIO;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftl_log_checkpoint
+ *
+ * Description: Erase a journal block and write the whole map to it.  All
+ *              the pages of a checkpoint have the same sequence number.
+ *
+ ****************************************************************************/
+
+static int ftl_log_checkpoint(FAR struct ftl_struct_s *dev, int side)
+{
+  FAR struct ftl_loghdr_s *hdr = (FAR struct ftl_loghdr_s *)dev->logpage;
+  uint32_t seq = dev->mapseq;
+  uint32_t first;
+  uint16_t page = 0;
+  int ret;
+
+  dev->stats.nerased++;
+  ret = MTD_ERASE(dev->mtd, dev->mapblock[side], 1);
+  if (ret < 0)
+    {
+      ferr("ERROR: Erase journal block %" PRIu32 " failed: %d\n",
+           dev->mapblock[side], ret);
+      return ret;
+    }
+
+  for (first = 0; first < dev->nlblocks; first += FTL_LOG_CKPER(dev))
+    {
+      memset(dev->logpage, dev->erasestate, dev->geo.blocksize);
+      hdr->type  = FTL_LOG_CHECKPOINT;
+      hdr->count = MIN(FTL_LOG_CKPER(dev), dev->nlblocks - first);
+      hdr->first = first;
+      memcpy(hdr + 1, &dev->l2p[first], hdr->count * sizeof(uint32_t));
+
+      dev->mapseq = seq;
+      ret = ftl_log_writepage(dev, side, page++);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  dev->mapside = side;
+  dev->mappage = page;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftl_log_commit
+ *
+ * Description: Record the pending remappings in the journal and release
+ *              the physical erase blocks they replaced.
+ *
+ ****************************************************************************/
+
+static int ftl_log_commit(FAR struct ftl_struct_s *dev)
+{
+  FAR struct ftl_loghdr_s *hdr = (FAR struct ftl_loghdr_s *)dev->logpage;
+  FAR uint32_t *pairs = (FAR uint32_t *)(hdr + 1);
+  uint32_t oldblock;
+  int ret = -ENOSPC;
+  int i;
+
+  if (dev->npending == 0)
+    {
+      return OK;
+    }
+
+  if (dev->mappage < dev->blkper)
+    {
+      memset(dev->logpage, dev->erasestate, dev->geo.blocksize);
+      hdr->type  = FTL_LOG_UPDATE;
+      hdr->count = dev->npending;
+      hdr->first = 0;
+      for (i = 0; i < dev->npending; i++)
+        {
+          pairs[2 * i]     = dev->pending[i].lblock;
+          pairs[2 * i + 1] = dev->l2p[dev->pending[i].lblock];
+        }
+
+      ret = ftl_log_writepage(dev, dev->mapside, dev->mappage++);
+    }
+
+  if (ret < 0)
+    {
+      /* The journal block is full, start the other one with the map */
+
+      ret = ftl_log_checkpoint(dev, !dev->mapside);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  for (i = 0; i < dev->npending; i++)
+    {
+      oldblock = dev->pending[i].oldblock;
+      if (oldblock != FTL_LOG_NONE)
+        {
+          dev->pstate[oldblock] = FTL_PBLOCK_FREE;
+        }
+    }
+
+  dev->npending = 0;
+  ftl_log_reclaim(dev);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftl_log_bread
+ *
+ * Description: Read R/W blocks through the map.  Blocks never written read
+ *              as erased.
+ *
+ ****************************************************************************/
+
+static ssize_t ftl_log_bread(FAR struct ftl_struct_s *dev, off_t startblock,
+                             size_t nblocks, FAR uint8_t *buffer)
+{
+  size_t remaining = nblocks;
+  uint32_t lblock;
+  uint32_t pblock;
+  off_t offset;
+  size_t count;
+  ssize_t ret;
+
+  while (remaining > 0)
+    {
+      lblock = startblock / dev->blkper;
+      offset = startblock & (dev->blkper - 1);
+      count  = MIN(dev->blkper - offset, remaining);
+      if (lblock >= dev->nlblocks)
+        {
+          return -ENOSPC;
+        }
+
+      pblock = dev->l2p[lblock];
+      if (pblock == FTL_LOG_NONE)
+        {
+          memset(buffer, dev->erasestate, count * dev->geo.blocksize);
+        }
+      else
+        {
+          ret = MTD_BREAD(dev->mtd, pblock * dev->blkper + offset, count,
+                          buffer);
+          if (ret != count && ret != -EUCLEAN)
+            {
+              ferr("ERROR: Read %zu blocks starting at block %" PRIdOFF
+                   " failed: %zd\n", count, startblock, ret);
+              return ret < 0 ? ret : -EIO;
+            }
+        }
+
+      startblock += count;
+      remaining  -= count;
+      buffer     += count * dev->geo.blocksize;
+    }
+
+  return nblocks;
+}
+
+/****************************************************************************
+ * Name: ftl_log_bwrite
+ *
+ * Description: Write a logical erase block to an erased physical erase
+ *              block and remap it.  The physical erase block it replaces
+ *              stays in use until the journal records the new one.
+ *
+ ****************************************************************************/
+
+static int ftl_log_bwrite(FAR struct ftl_struct_s *dev, uint32_t lblock,
+                          FAR const uint8_t *buffer)
+{
+  uint32_t pblock;
+  ssize_t ret;
+  int i;
+
+  if (lblock >= dev->nlblocks)
+    {
+      return -ENOSPC;
+    }
+
+  do
+    {
+      ret = ftl_log_alloc(dev, &pblock);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      dev->stats.nprogrammed += dev->blkper;
+      ret = MTD_BWRITE(dev->mtd, pblock * dev->blkper, dev->blkper, buffer);
+      if (ret != dev->blkper)
+        {
+          ferr("ERROR: Write block %" PRIu32 " failed: %zd\n", pblock, ret);
+          MTD_MARKBAD(dev->mtd, pblock);
+          dev->pstate[pblock] = FTL_PBLOCK_BAD;
+        }
+    }
+  while (ret != dev->blkper);
+
+  dev->pstate[pblock] = FTL_PBLOCK_USED;
+
+  for (i = 0; i < dev->npending; i++)
+    {
+      if (dev->pending[i].lblock == lblock)
+        {
+          break;
+        }
+    }
+
+  if (i < dev->npending)
+    {
+      /* Replaced again before the journal recorded it */
+
+      dev->pstate[dev->l2p[lblock]] = FTL_PBLOCK_FREE;
+    }
+  else
+    {
+      dev->pending[i].lblock   = lblock;
+      dev->pending[i].oldblock = dev->l2p[lblock];
+      dev->npending++;
+    }
+
+  dev->l2p[lblock] = pblock;
+
+  /* There must be an erase block left for every pending one */
+
+  if (dev->npending == dev->maxpending)
+    {
+      return ftl_log_commit(dev);
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftl_log_replay
+ *
+ * Description: Load the map from the checkpoint of a journal block and
+ *              apply the updates that follow it.  Returns -ENODATA or
+ *              -EINVAL if the checkpoint is incomplete and the error of
+ *              the MTD driver if a page cannot be read.
+ *
+ ****************************************************************************/
+
+static int ftl_log_replay(FAR struct ftl_struct_s *dev, int side)
+{
+  FAR struct ftl_loghdr_s *hdr = (FAR struct ftl_loghdr_s *)dev->logpage;
+  FAR uint32_t *entries = (FAR uint32_t *)(hdr + 1);
+  uint32_t seq = 0;
+  uint32_t first;
+  uint16_t page = 0;
+  int ret;
+  int i;
+
+  for (first = 0; first < dev->nlblocks; first += FTL_LOG_CKPER(dev))
+    {
+      ret = ftl_log_readpage(dev, side, page);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      if (hdr->type != FTL_LOG_CHECKPOINT ||
+          hdr->first != first || (page > 0 && hdr->seq != seq) ||
+          hdr->count != MIN(FTL_LOG_CKPER(dev), dev->nlblocks - first))
+        {
+          return -EINVAL;
+        }
+
+      memcpy(&dev->l2p[first], entries, hdr->count * sizeof(uint32_t));
+      seq = hdr->seq;
+      page++;
+    }
+
+  for (; page < dev->blkper; page++)
+    {
+      ret = ftl_log_readpage(dev, side, page);
+      if (ret < 0 && ret != -ENODATA && ret != -EINVAL)
+        {
+          return ret;
+        }
+
+      if (ret < 0 || hdr->type != FTL_LOG_UPDATE || hdr->seq <= seq ||
+          hdr->count > FTL_LOG_UPDPER(dev))
+        {
+          break;
+        }
+
+      for (i = 0; i < hdr->count; i++)
+        {
+          if (entries[2 * i] < dev->nlblocks)
+            {
+              dev->l2p[entries[2 * i]] = entries[2 * i + 1];
+            }
+        }
+
+      seq = hdr->seq;
+    }
+
+  /* A page that is neither valid nor erased was torn by a power loss and
+   * must not be programmed again, continue in the other journal block.
+   */
+
+  if (page < dev->blkper && ret != -ENODATA)
+    {
+      page = dev->blkper;
+    }
+
+  dev->mapside = side;
+  dev->mappage = page;
+  dev->mapseq  = seq;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftl_log_initialize
+ *
+ * Description: Set up the log-structured map.  The first two good erase
+ *              blocks hold the journal, the journal block with the newest
+ *              complete checkpoint is replayed.  The device is formatted
+ *              only if the journal was never written, read errors and
+ *              damaged journals are returned to the caller.
+ *
+ ****************************************************************************/
+
+static int ftl_log_initialize(FAR struct ftl_struct_s *dev)
+{
+  FAR struct ftl_loghdr_s *hdr;
+  uint32_t seq[2];
+  uint32_t ngood = 0;
+  uint32_t pblock;
+  uint32_t lblock;
+  bool valid[2];
+  bool blank[2];
+  bool format;
+  int nmap = 0;
+  int side;
+  int ret;
+
+  if (FTL_LOG_UPDPER(dev) < 1)
+    {
+      return -EINVAL;
+    }
+
+  dev->erasestate = 0xff;
+  MTD_IOCTL(dev->mtd, MTDIOC_ERASESTATE,
+            (unsigned long)((uintptr_t)&dev->erasestate));
+
+  dev->pstate  = kmm_zalloc(dev->geo.neraseblocks);
+  dev->logpage = kmm_malloc(dev->geo.blocksize);
+  if (dev->pstate == NULL || dev->logpage == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  for (pblock = 0; pblock < dev->geo.neraseblocks; pblock++)
+    {
+      if (MTD_ISBAD(dev->mtd, pblock) > 0)
+        {
+          dev->pstate[pblock] = FTL_PBLOCK_BAD;
+        }
+      else if (nmap < 2)
+        {
+          dev->mapblock[nmap++] = pblock;
+          dev->pstate[pblock]   = FTL_PBLOCK_MAP;
+        }
+      else
+        {
+          dev->pstate[pblock] = FTL_PBLOCK_FREE;
+          ngood++;
+        }
+    }
+
+  if (ngood <= CONFIG_FTL_LOGSTRUCT_NSPARES)
+    {
+      return -ENOSPC;
+    }
+
+  dev->nlblocks   = ngood - CONFIG_FTL_LOGSTRUCT_NSPARES;
+  dev->maxpending = MIN(CONFIG_FTL_LOGSTRUCT_NSPARES, FTL_LOG_UPDPER(dev));
+  if (div_round_up(dev->nlblocks, FTL_LOG_CKPER(dev)) >= dev->blkper)
+    {
+      ferr("ERROR: The map does not fit into a journal block\n");
+      return -E2BIG;
+    }
+
+  dev->l2p = kmm_malloc(dev->nlblocks * sizeof(uint32_t));
+  if (dev->l2p == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  /* Replay the journal block with the newest checkpoint, or the other one
+   * if that checkpoint is not complete.
+   */
+
+  hdr = (FAR struct ftl_loghdr_s *)dev->logpage;
+  for (side = 0; side < 2; side++)
+    {
+      ret = ftl_log_readpage(dev, side, 0);
+      if (ret < 0 && ret != -ENODATA && ret != -EINVAL)
+        {
+          ferr("ERROR: Read journal block %" PRIu32 " failed: %d\n",
+               dev->mapblock[side], ret);
+          return ret;
+        }
+
+      valid[side] = ret >= 0 && hdr->type == FTL_LOG_CHECKPOINT;
+      blank[side] = ret == -ENODATA ||
+                    (ret == -EINVAL && hdr->magic != FTL_LOG_MAGIC);
+      seq[side]   = hdr->seq;
+    }
+
+  /* A checkpoint that is not complete was torn by a power loss, the other
+   * journal block still holds the previous one then.
+   */
+
+  side = valid[1] && (!valid[0] || seq[1] > seq[0]);
+  ret  = valid[side] ? ftl_log_replay(dev, side) : -ENOENT;
+  if ((ret == -ENODATA || ret == -EINVAL) && valid[1 - side])
+    {
+      ret = ftl_log_replay(dev, 1 - side);
+    }
+
+  /* Format only a journal that was never written: both blocks erased or
+   * foreign, or the first checkpoint torn right after the second block
+   * was erased by a format.  Anything else is reported to the caller
+   * rather than wiping the device.
+   */
+
+  format = (ret == -ENOENT && blank[0] && blank[1]) ||
+           (ret == -ENODATA && valid[0] && blank[1]);
+  if (ret < 0 && !format)
+    {
+      ferr("ERROR: Journal replay failed: %d\n", ret);
+      return ret == -ENOENT ? -EINVAL : ret;
+    }
+
+  if (format)
+    {
+      fwarn("WARNING: No journal, formatting\n");
+
+      memset(dev->l2p, 0xff, dev->nlblocks * sizeof(uint32_t));
+      ret = MTD_ERASE(dev->mtd, dev->mapblock[1], 1);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      ret = ftl_log_checkpoint(dev, 0);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  for (lblock = 0; lblock < dev->nlblocks; lblock++)
+    {
+      pblock = dev->l2p[lblock];
+      if (pblock == FTL_LOG_NONE)
+        {
+          continue;
+        }
+
+      if (pblock >= dev->geo.neraseblocks ||
+          dev->pstate[pblock] != FTL_PBLOCK_FREE)
+        {
+          ferr("ERROR: Bad mapping of erase block %" PRIu32 "\n", lblock);
+          dev->l2p[lblock] = FTL_LOG_NONE;
+        }
+      else
+        {
+          dev->pstate[pblock] = FTL_PBLOCK_USED;
+        }
+    }
+
+  /* The other erase blocks may hold anything, erase them before use */
+
+  ftl_log_reclaim(dev);
+  return OK;
+}
+
+static void ftl_log_uninitialize(FAR struct ftl_struct_s *dev)
+{
+#ifdef CONFIG_SCHED_LPWORK
+  work_cancel_sync(LPWORK, &dev->gcwork);
+#endif
+  kmm_free(dev->l2p);
+  kmm_free(dev->pstate);
+  kmm_free(dev->logpage);
+}
+#endif /* CONFIG_FTL_LOGSTRUCT */
+
+#ifdef CONFIG_FTL_WRITEBACK
+/****************************************************************************
+ * Name: ftl_cache_find
+ *
+ * Description: Find a logical erase block in the write-back cache and make
+ *              it the most recently used one.
+ *
+ ****************************************************************************/
+
+static FAR struct ftl_cache_s *ftl_cache_find(FAR struct ftl_struct_s *dev,
+                                              off_t eblock)
+{
+  FAR dq_entry_t *node;
+
+  for (node = dq_peek(&dev->lru); node != NULL; node = dq_next(node))
+    {
+      FAR struct ftl_cache_s *entry = (FAR struct ftl_cache_s *)node;
+
+      if (entry->eblock == eblock)
+        {
+          dq_rem(node, &dev->lru);
+          dq_addfirst(node, &dev->lru);
+          return entry;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: ftl_cache_run
+ *
+ * Description: Return the number of R/W blocks from 'block' on that are
+ *              all dirty or all clean.
+ *
+ ****************************************************************************/
+
+static size_t ftl_cache_run(FAR struct ftl_struct_s *dev,
+                            FAR struct ftl_cache_s *entry, size_t block)
+{
+  bool dirty = FTL_ISDIRTY(entry, block);
+  size_t n = 1;
+
+  while (block + n < dev->blkper && FTL_ISDIRTY(entry, block + n) == dirty)
+    {
+      n++;
+    }
+
+  return n;
+}
+
+/****************************************************************************
+ * Name: ftl_write_eblock
+ *
+ * Description: Write a whole logical erase block to the flash.
+ *
+ ****************************************************************************/
+
+static int ftl_write_eblock(FAR struct ftl_struct_s *dev, off_t eblock,
+                            FAR const uint8_t *buffer)
+{
+#ifdef CONFIG_FTL_LOGSTRUCT
+  return ftl_log_bwrite(dev, eblock, buffer);
+#else
+  size_t nxfrd;
+  int ret;
+
+  ret = ftl_mtd_erase(dev, eblock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  nxfrd = ftl_mtd_bwrite(dev, eblock * dev->blkper, buffer);
+  return nxfrd == dev->blkper ? OK : -EIO;
+#endif
+}
+
+/****************************************************************************
+ * Name: ftl_cache_writeback
+ *
+ * Description: Write a dirty cached erase block back to the flash.  The
+ *              R/W blocks that were not written are read from the flash
+ *              first.
+ *
+ ****************************************************************************/
+
+static int ftl_cache_writeback(FAR struct ftl_struct_s *dev,
+                               FAR struct ftl_cache_s *entry)
+{
+  off_t startblock = entry->eblock * dev->blkper;
+  size_t nxfrd;
+  size_t i;
+  size_t n;
+  int ret;
+
+  if (entry->ndirty == 0)
+    {
+      return OK;
+    }
+
+  for (i = 0; !entry->valid && i < dev->blkper; i += n)
+    {
+      n = ftl_cache_run(dev, entry, i);
+      if (!FTL_ISDIRTY(entry, i))
+        {
+          nxfrd = ftl_read_blocks(dev, startblock + i, n,
+                                  entry->buffer + i * dev->geo.blocksize);
+          if (nxfrd != n)
+            {
+              return -EIO;
+            }
+        }
+    }
+
+  ret = ftl_write_eblock(dev, entry->eblock, entry->buffer);
+  if (ret >= 0)
+    {
+      memset(entry->dirty, 0, FTL_DIRTYSIZE(dev));
+      entry->ndirty = 0;
+      entry->valid  = true;
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: ftl_cache_flush
+ *
+ * Description: Write all the dirty cached erase blocks back.  Called with
+ *              the device locked.
+ *
+ ****************************************************************************/
+
+static int ftl_cache_flush(FAR struct ftl_struct_s *dev)
+{
+  FAR dq_entry_t *node;
+  int ret = OK;
+  int err;
+
+  for (node = dq_peek(&dev->lru); node != NULL; node = dq_next(node))
+    {
+      err = ftl_cache_writeback(dev, (FAR struct ftl_cache_s *)node);
+      if (err < 0)
+        {
+          ret = err;
+        }
+    }
+
+#ifdef CONFIG_FTL_LOGSTRUCT
+  err = ftl_log_commit(dev);
+  if (err < 0)
+    {
+      ret = err;
+    }
+#endif
+
+  return ret;
+}
+
+static int ftl_cache_sync(FAR struct ftl_struct_s *dev)
+{
+  int ret;
+
+  ret = nxmutex_lock(&dev->lock);
+  if (ret >= 0)
+    {
+      ret = ftl_cache_flush(dev);
+      nxmutex_unlock(&dev->lock);
+    }
+
+  return ret;
 }
 
-/****************************************************************************
- * Name: ftl_open
- *
- * Description: Open the block device
- *
- ****************************************************************************/
-
-static int ftl_open(FAR struct inode *inode)
+#ifdef FTL_HAVE_WBDELAY
+static void ftl_cache_worker(FAR void *arg)
 {
-  FAR struct ftl_struct_s *dev;
+  FAR struct ftl_struct_s *dev = arg;
+  int ret;
 
-  DEBUGASSERT(inode->i_private);
-  dev = inode->i_private;
-  dev->refs++;
-  return OK;
+  ret = ftl_cache_sync(dev);
+  if (ret < 0)
+    {
+      ferr("ERROR: Write-back failed: %d\n", ret);
+    }
 }
+#endif
 
 /****************************************************************************
- * Name: ftl_close
+ * Name: ftl_cache_get
  *
- * Description: close the block device
+ * Description: Get the cache entry of a logical erase block, reusing the
+ *              least recently used one if the erase block is not cached.
  *
  ****************************************************************************/
 
-static int ftl_close(FAR struct inode *inode)
+static int ftl_cache_get(FAR struct ftl_struct_s *dev, off_t eblock,
+                         FAR struct ftl_cache_s **entryp)
 {
-  FAR struct ftl_struct_s *dev;
-
-  DEBUGASSERT(inode->i_private);
-  dev = inode->i_private;
-
-#ifdef CONFIG_FTL_WRITEBUFFER
-  rwb_flush(&dev->rwb);
-#endif
+  FAR struct ftl_cache_s *entry;
+  int ret;
 
-  if (--dev->refs == 0 && dev->unlinked)
+  entry = ftl_cache_find(dev, eblock);
+  if (entry == NULL)
     {
-#ifdef FTL_HAVE_RWBUFFER
-      rwb_uninitialize(&dev->rwb);
-#endif
-      if (dev->eblock)
+      entry = (FAR struct ftl_cache_s *)dq_tail(&dev->lru);
+      ret = ftl_cache_writeback(dev, entry);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      if (entry->buffer == NULL)
         {
-          kmm_free(dev->eblock);
+          entry->buffer = kmm_malloc(dev->geo.erasesize +
+                                     FTL_DIRTYSIZE(dev));
+          if (entry->buffer == NULL)
+            {
+              return -ENOMEM;
+            }
+
+          entry->dirty = entry->buffer + dev->geo.erasesize;
+          memset(entry->dirty, 0, FTL_DIRTYSIZE(dev));
         }
 
-      kmm_free(dev);
+      entry->eblock = eblock;
+      entry->valid  = false;
+      dq_rem(&entry->node, &dev->lru);
+      dq_addfirst(&entry->node, &dev->lru);
     }
 
+  *entryp = entry;
   return OK;
 }
 
 /****************************************************************************
- * Name: ftl_mtd_bread
+ * Name: ftl_cache_write
  *
- * Description:
- *   Read the specified number of sectors. If mtd device is nor flash, it
- *   can be read once time. If mtd device is nand flash, it can be read one
- *   block every time and need to skip bad block until the specified number
- *   of sectors finish.
+ * Description: Write R/W blocks.  Whole erase blocks are written to the
+ *              flash right away, partial ones are collected in the cache.
  *
  ****************************************************************************/
 
-static ssize_t ftl_mtd_bread(FAR struct ftl_struct_s *dev, off_t startblock,
-                             size_t nblocks, FAR uint8_t *buffer)
+static ssize_t ftl_cache_write(FAR struct ftl_struct_s *dev,
+                               FAR const uint8_t *buffer,
+                               off_t startblock, size_t nblocks)
 {
-  off_t mask = dev->blkper - 1;
-  size_t nread = nblocks;
-  ssize_t ret = OK;
+  FAR struct ftl_cache_s *entry;
+  size_t remaining = nblocks;
+  bool dirtied = false;
+  off_t eblock;
+  off_t offset;
+  size_t count;
+  size_t i;
+  int ret;
+#ifdef CONFIG_FTL_LOGSTRUCT
+  int err;
+#endif
 
-  if (dev->lptable == NULL)
+  ret = nxmutex_lock(&dev->lock);
+  if (ret < 0)
     {
-      ret = MTD_BREAD(dev->mtd, startblock, nblocks, buffer);
-      if (ret != nblocks)
-        {
-          ferr("ERROR: Read %zu blocks starting at block %" PRIdOFF
-               " failed: %zd\n", nblocks, startblock, ret);
-        }
-
       return ret;
     }
 
-  while (nblocks > 0)
+  while (remaining > 0)
     {
-      off_t startphysicalblock;
-      off_t starteraseblock;
-      off_t offset;
-      size_t count;
+      eblock = startblock / dev->blkper;
+      offset = startblock & (dev->blkper - 1);
+      count  = MIN(dev->blkper - offset, remaining);
 
-      starteraseblock = startblock / dev->blkper;
-      if (starteraseblock >= dev->lpcount)
+      if (count == dev->blkper)
         {
-          ret = -ENOSPC;
-          break;
-        }
+          /* The new content replaces the cached one */
 
-      offset = startblock & mask;
-      count = ftl_get_cblock(dev, starteraseblock,
-                             (offset + nblocks + mask) / dev->blkper);
-      count = MIN(count * dev->blkper - offset, nblocks);
-      startphysicalblock = dev->lptable[starteraseblock] *
-                           dev->blkper + offset;
-      ret = MTD_BREAD(dev->mtd, startphysicalblock, count, buffer);
-      if (ret == count || ret == -EUCLEAN)
-        {
-          nblocks -= count;
-          startblock += count;
-          buffer += count * dev->geo.blocksize;
+          entry = ftl_cache_find(dev, eblock);
+          if (entry != NULL)
+            {
+              memset(entry->dirty, 0, FTL_DIRTYSIZE(dev));
+              entry->eblock = -1;
+              entry->ndirty = 0;
+              dq_rem(&entry->node, &dev->lru);
+              dq_addlast(&entry->node, &dev->lru);
+            }
+
+          ret = ftl_write_eblock(dev, eblock, buffer);
         }
       else
         {
-          ftl_update_map(dev, starteraseblock);
+          ret = ftl_cache_get(dev, eblock, &entry);
+          if (ret >= 0)
+            {
+              memcpy(entry->buffer + offset * dev->geo.blocksize, buffer,
+                     count * dev->geo.blocksize);
+              for (i = offset; i < offset + count; i++)
+                {
+                  if (!FTL_ISDIRTY(entry, i))
+                    {
+                      FTL_SETDIRTY(entry, i);
+                      entry->ndirty++;
+                    }
+                }
+
+              dirtied = true;
+            }
+        }
+
+      if (ret < 0)
+        {
           break;
         }
+
+      startblock += count;
+      remaining  -= count;
+      buffer     += count * dev->geo.blocksize;
     }
 
-  return nblocks != nread ? nread - nblocks : ret;
+#ifdef CONFIG_FTL_LOGSTRUCT
+  err = ftl_log_commit(dev);
+  if (ret >= 0)
+    {
+      ret = err;
+    }
+#endif
+
+#ifdef FTL_HAVE_WBDELAY
+  if (dirtied && work_available(&dev->work))
+    {
+      work_queue(LPWORK, &dev->work, ftl_cache_worker, dev,
+                 MSEC2TICK(CONFIG_FTL_WRITEBACK_DELAY));
+    }
+#else
+  UNUSED(dirtied);
+#endif
+
+  nxmutex_unlock(&dev->lock);
+  return ret < 0 ? ret : nblocks;
 }
 
 /****************************************************************************
- * Name: ftl_mtd_bwrite
+ * Name: ftl_cache_read
  *
- * Description:
- *   Write the specified eraseblocks. If mtd device is nor flash, it
- *   can be written once time. If mtd device is nand flash, it can be write
- *   one block every time and need to skip bad block until writing success.
+ * Description: Read R/W blocks, from the cache where it has them.
  *
  ****************************************************************************/
 
-static ssize_t ftl_mtd_bwrite(FAR struct ftl_struct_s *dev, off_t startblock,
-                              FAR const uint8_t *buffer)
+static ssize_t ftl_cache_read(FAR struct ftl_struct_s *dev,
+                              FAR uint8_t *buffer, off_t startblock,
+                              size_t nblocks)
 {
-  off_t starteraseblock;
-  ssize_t ret;
+  FAR struct ftl_cache_s *entry;
+  size_t blocksize = dev->geo.blocksize;
+  size_t remaining = nblocks;
+  off_t eblock;
+  off_t offset;
+  size_t count;
+  size_t nxfrd;
+  size_t i;
+  size_t n;
+  int ret;
 
-  if (dev->lptable == NULL)
+  ret = nxmutex_lock(&dev->lock);
+  if (ret < 0)
     {
-      ret = MTD_BWRITE(dev->mtd, startblock, dev->blkper, buffer);
-      if (ret != dev->blkper)
-        {
-          ferr("ERROR: Write block %" PRIdOFF " failed: %zd\n",
-               startblock, ret);
-        }
-
       return ret;
     }
 
-  starteraseblock = startblock / dev->blkper;
-  while (1)
+  while (remaining > 0 && ret >= 0)
     {
-      if (starteraseblock >= dev->lpcount)
-        {
-          return -ENOSPC;
-        }
+      eblock = startblock / dev->blkper;
+      offset = startblock & (dev->blkper - 1);
+      count  = MIN(dev->blkper - offset, remaining);
 
-      ret = MTD_BWRITE(dev->mtd, dev->lptable[starteraseblock] * dev->blkper,
-                       dev->blkper, buffer);
-      if (ret == dev->blkper)
+      entry = ftl_cache_find(dev, eblock);
+      for (i = offset; i < offset + count; i += n)
         {
-          return ret;
+          if (entry == NULL)
+            {
+              n = count;
+            }
+          else
+            {
+              n = MIN(ftl_cache_run(dev, entry, i), offset + count - i);
+            }
+
+          if (entry != NULL && (entry->valid || FTL_ISDIRTY(entry, i)))
+            {
+              memcpy(buffer + (i - offset) * blocksize,
+                     entry->buffer + i * blocksize, n * blocksize);
+            }
+          else
+            {
+              nxfrd = ftl_read_blocks(dev, eblock * dev->blkper + i, n,
+                                      buffer + (i - offset) * blocksize);
+              if (nxfrd != n)
+                {
+                  ret = -EIO;
+                  break;
+                }
+            }
         }
 
-      MTD_MARKBAD(dev->mtd, dev->lptable[starteraseblock]);
-      ftl_update_map(dev, starteraseblock);
+      startblock += count;
+      remaining  -= count;
+      buffer     += count * blocksize;
     }
-}
 
-/****************************************************************************
- * Name: ftl_mtd_erase
- *
- * Description:
- *   Erase the specified number of sectors. If mtd device is nor flash, it
- *   can be erased once time. If mtd device is nand flash, it can be erased
- *   one block every time and need to skip bad block until the specified
- *   number of sectors finish.
- *
- ****************************************************************************/
+  nxmutex_unlock(&dev->lock);
+  return ret < 0 ? ret : nblocks;
+}
 
-static ssize_t ftl_mtd_erase(FAR struct ftl_struct_s *dev, off_t startblock)
+static void ftl_cache_initialize(FAR struct ftl_struct_s *dev)
 {
-  ssize_t ret;
+  int i;
 
-  if (dev->lptable == NULL)
+  nxmutex_init(&dev->lock);
+  dq_init(&dev->lru);
+  for (i = 0; i < CONFIG_FTL_WRITEBACK_NBLOCKS; i++)
     {
-      ret = MTD_ERASE(dev->mtd, startblock, 1);
-      if (ret < 0)
-        {
-          ferr("ERROR: Erase block %" PRIdOFF " failed: %zd\n",
-               startblock, ret);
-        }
-
-      return ret;
+      dev->cache[i].eblock = -1;
+      dq_addlast(&dev->cache[i].node, &dev->lru);
     }
+}
 
-  while (1)
-    {
-      if (startblock >= dev->lpcount)
-        {
-          return -ENOSPC;
-        }
-
-      ret = MTD_ERASE(dev->mtd, dev->lptable[startblock], 1);
-      if (ret == 1)
-        {
-          return ret;
-        }
+static void ftl_cache_uninitialize(FAR struct ftl_struct_s *dev)
+{
+  int i;
 
-      MTD_MARKBAD(dev->mtd, dev->lptable[startblock]);
-      ftl_update_map(dev, startblock);
+#ifdef FTL_HAVE_WBDELAY
+  work_cancel_sync(LPWORK, &dev->work);
+#endif
+  for (i = 0; i < CONFIG_FTL_WRITEBACK_NBLOCKS; i++)
+    {
+      kmm_free(dev->cache[i].buffer);
     }
+
+  nxmutex_destroy(&dev->lock);
 }
+#endif /* CONFIG_FTL_WRITEBACK */
 
 /****************************************************************************
  * Name: ftl_reload
@@ -433,7 +1701,11 @@ static ssize_t ftl_reload(FAR void *priv, FAR uint8_t *buffer,
 
   /* Read the full erase block into the buffer */
 
+#ifdef CONFIG_FTL_WRITEBACK
+  return ftl_cache_read(dev, buffer, startblock, nblocks);
+#else
   return ftl_mtd_bread(dev, startblock, nblocks, buffer);
+#endif
 }
 
 /****************************************************************************
@@ -467,6 +1739,7 @@ static ssize_t ftl_read(FAR struct inode *inode, unsigned char *buffer,
  *
  ****************************************************************************/
 
+#ifndef CONFIG_FTL_WRITEBACK
 static int ftl_alloc_eblock(FAR struct ftl_struct_s *dev)
 {
   if (dev->eblock == NULL)
@@ -478,7 +1751,9 @@ static int ftl_alloc_eblock(FAR struct ftl_struct_s *dev)
 
   return dev->eblock != NULL ? OK : -ENOMEM;
 }
+#endif
 
+#ifndef CONFIG_FTL_LOGSTRUCT
 /****************************************************************************
  * Name: ftl_flush_direct
  *
@@ -511,6 +1786,7 @@ static ssize_t ftl_flush_direct(FAR struct ftl_struct_s *dev,
             }
         }
 
+      dev->stats.nprogrammed += count;
       if (dev->lptable == NULL)
         {
           ret = MTD_BWRITE(dev->mtd, startblock, count, buffer);
@@ -546,11 +1822,13 @@ static ssize_t ftl_flush_direct(FAR struct ftl_struct_s *dev,
 
   return nblocks;
 }
+#endif
 
 static ssize_t ftl_flush(FAR void *priv, FAR const uint8_t *buffer,
                          off_t startblock, size_t nblocks)
 {
   struct ftl_struct_s *dev = (struct ftl_struct_s *)priv;
+#ifndef CONFIG_FTL_WRITEBACK
   off_t  alignedblock;
   off_t  mask;
   off_t  rwblock;
@@ -560,13 +1838,22 @@ static ssize_t ftl_flush(FAR void *priv, FAR const uint8_t *buffer,
   size_t nxfrd;
   int    nbytes;
   int    ret;
+#endif
 
+#ifndef CONFIG_FTL_LOGSTRUCT
   if (dev->oflags & O_DIRECT)
     {
       /* Direct write mode */
 
       return ftl_flush_direct(dev, buffer, startblock, nblocks);
     }
+#endif
+
+#ifdef CONFIG_FTL_WRITEBACK
+  /* Collect the partial erase blocks in the write-back cache */
+
+  return ftl_cache_write(dev, buffer, startblock, nblocks);
+#else
 
   /* Get the aligned block.  Here is is assumed: (1) The number of R/W blocks
    * per erase block is a power of 2, and (2) the erase begins with that same
@@ -726,6 +2013,7 @@ static ssize_t ftl_flush(FAR void *priv, FAR const uint8_t *buffer,
     }
 
   return nblocks;
+#endif
 }
 
 /****************************************************************************
@@ -745,6 +2033,7 @@ static ssize_t ftl_write(FAR struct inode *inode,
 
   DEBUGASSERT(inode->i_private);
   dev = inode->i_private;
+  dev->stats.nwritten += nsectors;
 #ifdef FTL_HAVE_RWBUFFER
   return rwb_write(&dev->rwb, start_sector, nsectors, buffer);
 #else
@@ -772,7 +2061,11 @@ static int ftl_geometry(FAR struct inode *inode,
       geometry->geo_available     = true;
       geometry->geo_mediachanged  = false;
       geometry->geo_writeenabled  = true;
+#ifdef CONFIG_FTL_LOGSTRUCT
+      geometry->geo_nsectors      = dev->nlblocks * dev->blkper;
+#else
       geometry->geo_nsectors      = dev->geo.neraseblocks * dev->blkper;
+#endif
       geometry->geo_sectorsize    = dev->geo.blocksize;
 
       strlcpy(geometry->geo_model, dev->geo.model,
@@ -818,6 +2111,27 @@ static int ftl_ioctl(FAR struct inode *inode, int cmd, unsigned long arg)
 #ifdef CONFIG_FTL_WRITEBUFFER
       rwb_flush(&dev->rwb);
 #endif
+#ifdef CONFIG_FTL_WRITEBACK
+      ret = ftl_cache_sync(dev);
+      if (ret < 0)
+        {
+          return ret;
+        }
+#endif
+    }
+
+  if (cmd == BIOC_FTLSTATS)
+    {
+      FAR struct ftl_stats_s *stats =
+        (FAR struct ftl_stats_s *)((uintptr_t)arg);
+
+      if (stats == NULL)
+        {
+          return -EINVAL;
+        }
+
+      *stats = dev->stats;
+      return OK;
     }
 
   /* No other block driver ioctl commands are not recognized by this
@@ -852,21 +2166,37 @@ static int ftl_unlink(FAR struct inode *inode)
   dev->unlinked = true;
   if (dev->refs == 0)
     {
-#ifdef FTL_HAVE_RWBUFFER
-      rwb_uninitialize(&dev->rwb);
-#endif
-      if (dev->eblock)
-        {
-          kmm_free(dev->eblock);
-        }
-
-      kmm_free(dev);
+      ftl_uninitialize(dev);
     }
 
   return OK;
 }
 #endif
 
+/****************************************************************************
+ * Name: ftl_uninitialize
+ *
+ * Description: Free the device once it is unlinked and closed
+ *
+ ****************************************************************************/
+
+static void ftl_uninitialize(FAR struct ftl_struct_s *dev)
+{
+#ifdef FTL_HAVE_RWBUFFER
+  rwb_uninitialize(&dev->rwb);
+#endif
+#ifdef CONFIG_FTL_WRITEBACK
+  ftl_cache_uninitialize(dev);
+#endif
+#ifdef CONFIG_FTL_LOGSTRUCT
+  ftl_log_uninitialize(dev);
+#endif
+
+  kmm_free(dev->eblock);
+  kmm_free(dev->lptable);
+  kmm_free(dev);
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -908,6 +2238,12 @@ int ftl_initialize_by_path(FAR const char *path, FAR struct mtd_dev_s *mtd,
       dev->mtd = mtd;
       dev->oflags = oflags;
 
+#ifdef CONFIG_FTL_LOGSTRUCT
+      /* Every write goes to a spare erase block */
+
+      dev->oflags &= ~(O_DIRECT | O_SYNC);
+#endif
+
       /* Get the device geometry. (casting to uintptr_t first eliminates
        * complaints on some architectures where the sizeof long is different
        * from the size of a pointer).
@@ -954,6 +2290,22 @@ int ftl_initialize_by_path(FAR const char *path, FAR struct mtd_dev_s *mtd,
         }
 #endif
 
+#ifdef CONFIG_FTL_WRITEBACK
+      ftl_cache_initialize(dev);
+#endif
+
+#ifdef CONFIG_FTL_LOGSTRUCT
+      ret = ftl_log_initialize(dev);
+      if (ret < 0)
+        {
+          ferr("ERROR: ftl_log_initialize failed: %d\n", ret);
+          goto out;
+        }
+
+#  ifdef FTL_HAVE_RWBUFFER
+      dev->rwb.nblocks = dev->nlblocks * dev->blkper;
+#  endif
+#else
       if (MTD_ISBAD(dev->mtd, 0) != -ENOSYS)
         {
           ret = ftl_init_map(dev);
@@ -962,6 +2314,7 @@ int ftl_initialize_by_path(FAR const char *path, FAR struct mtd_dev_s *mtd,
               goto out;
             }
         }
+#endif
 
       /* Inode private data is a reference to the FTL device structure */
 
@@ -969,12 +2322,8 @@ int ftl_initialize_by_path(FAR const char *path, FAR struct mtd_dev_s *mtd,
       if (ret < 0)
         {
           ferr("ERROR: register_blockdriver failed: %d\n", -ret);
-          kmm_free(dev->lptable);
 out:
-#ifdef FTL_HAVE_RWBUFFER
-          rwb_uninitialize(&dev->rwb);
-#endif
-          kmm_free(dev);
+          ftl_uninitialize(dev);
         }
     }
 
@@ -28,6 +28,8 @@
 
 #include <nuttx/arch.h>
 #include <nuttx/clock.h>
+#include <nuttx/hrtimer.h>
+#include <nuttx/spinlock.h>
 #include <nuttx/timers/arch_alarm.h>
 
 /****************************************************************************
@@ -48,6 +50,20 @@ static FAR struct oneshot_lowerhalf_s *g_oneshot_lower;
 static clock_t g_current_tick;
 #endif
 
+#ifdef CONFIG_HRTIMER
+/* The oneshot timer is shared by the scheduler and the hrtimers.  It is
+ * always programmed for the earlier of the next scheduler tick and the
+ * next hrtimer expiration.  The state below is protected by g_alarm_lock,
+ * which is never held while the scheduler or the hrtimer callbacks run:
+ * up_hrtimer_start() is called with the hrtimer queue lock held.
+ */
+
+static spinlock_t g_alarm_lock = SP_UNLOCKED;
+static clock_t g_alarm_tick = CLOCK_MAX;    /* Next scheduler tick */
+static uint64_t g_hrtimer_ns = UINT64_MAX;  /* Next hrtimer expiration */
+static bool g_alarm_expiring;               /* In oneshot_callback() */
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -99,14 +115,94 @@ static void udelay_coarse(useconds_t microseconds)
     }
 }
 
+#ifdef CONFIG_HRTIMER
+static void oneshot_callback(FAR struct oneshot_lowerhalf_s *lower,
+                             FAR void *arg);
+
+/****************************************************************************
+ * Name: oneshot_reprogram
+ *
+ * Description:
+ *   Program the oneshot timer for the earlier of the next scheduler tick
+ *   and the next hrtimer expiration.
+ *
+ * Assumptions:
+ *   g_alarm_lock is held.
+ *
+ ****************************************************************************/
+
+static int oneshot_reprogram(void)
+{
+  struct timespec ts;
+  uint64_t expired;
+  uint64_t now;
+
+  if (g_oneshot_lower == NULL)
+    {
+      return -EAGAIN;
+    }
+
+  /* Nothing to do now, the callback reprograms the timer when done */
+
+  if (g_alarm_expiring)
+    {
+      return OK;
+    }
+
+  expired = g_alarm_tick != CLOCK_MAX ?
+            (uint64_t)g_alarm_tick * NSEC_PER_TICK : UINT64_MAX;
+  if (g_hrtimer_ns < expired)
+    {
+      expired = g_hrtimer_ns;
+    }
+
+  if (expired == UINT64_MAX)
+    {
+      return ONESHOT_CANCEL(g_oneshot_lower, &ts);
+    }
+
+  ONESHOT_CURRENT(g_oneshot_lower, &ts);
+  now = clock_time2nsec(&ts);
+  clock_nsec2time(&ts, expired > now ? expired - now : 0);
+  return ONESHOT_START(g_oneshot_lower, oneshot_callback, NULL, &ts);
+}
+#endif
+
 static void oneshot_callback(FAR struct oneshot_lowerhalf_s *lower,
                              FAR void *arg)
 {
   clock_t now = 0;
+#ifdef CONFIG_HRTIMER
+  struct timespec ts;
+  irqstate_t flags;
+  bool expired;
+
+  flags = spin_lock_irqsave(&g_alarm_lock);
+  g_alarm_expiring = true;
+  spin_unlock_irqrestore(&g_alarm_lock, flags);
+#endif
 
   ONESHOT_TICK_CURRENT(g_oneshot_lower, &now);
 #ifdef CONFIG_SCHED_TICKLESS
+#  ifdef CONFIG_HRTIMER
+  /* The expiration may be due to an hrtimer only */
+
+  flags   = spin_lock_irqsave(&g_alarm_lock);
+  expired = now >= g_alarm_tick;
+  if (expired)
+    {
+      g_alarm_tick = CLOCK_MAX;
+    }
+
+  spin_unlock_irqrestore(&g_alarm_lock, flags);
+
+  if (expired)
+    {
+      nxsched_alarm_tick_expiration(now);
+    }
+#  else
   nxsched_alarm_tick_expiration(now);
+#  endif
 #else
   /* Start the next tick first, in order to minimize latency. Ideally
    * the ONESHOT_TICK_START would also return the current tick so that
@@ -114,7 +210,13 @@ static void oneshot_callback(FAR struct oneshot_lowerhalf_s *lower,
    * atomically w. respect to a HW timer
    */
 
+#  ifdef CONFIG_HRTIMER
+  flags = spin_lock_irqsave(&g_alarm_lock);
+  g_alarm_tick = now + 1;
+  spin_unlock_irqrestore(&g_alarm_lock, flags);
+#  else
   ONESHOT_TICK_START(g_oneshot_lower, oneshot_callback, NULL, 1);
+#  endif
 
   /* It is always an error if this progresses more than 1 tick at a time.
    * That would break any timer based on wdog; such timers might timeout
@@ -131,6 +233,31 @@ static void oneshot_callback(FAR struct oneshot_lowerhalf_s *lower,
       nxsched_process_timer();
     }
 #endif
+
+#ifdef CONFIG_HRTIMER
+  /* Run the expired hrtimers and program the next expiration */
+
+  ONESHOT_CURRENT(g_oneshot_lower, &ts);
+
+  flags   = spin_lock_irqsave(&g_alarm_lock);
+  expired = clock_time2nsec(&ts) >= g_hrtimer_ns;
+  if (expired)
+    {
+      g_hrtimer_ns = UINT64_MAX;
+    }
+
+  spin_unlock_irqrestore(&g_alarm_lock, flags);
+
+  if (expired)
+    {
+      hrtimer_process(clock_time2nsec(&ts));
+    }
+
+  flags = spin_lock_irqsave(&g_alarm_lock);
+  g_alarm_expiring = false;
+  oneshot_reprogram();
+  spin_unlock_irqrestore(&g_alarm_lock, flags);
+#endif
 }
 
 /****************************************************************************
@@ -141,6 +268,8 @@ void up_alarm_set_lowerhalf(FAR struct oneshot_lowerhalf_s *lower)
 {
 #ifdef CONFIG_SCHED_TICKLESS
   clock_t ticks = 0;
+#elif defined(CONFIG_HRTIMER)
+  irqstate_t flags;
 #endif
 
   g_oneshot_lower = lower;
@@ -150,7 +279,14 @@ void up_alarm_set_lowerhalf(FAR struct oneshot_lowerhalf_s *lower)
   g_oneshot_maxticks = ticks < UINT32_MAX ? ticks : UINT32_MAX;
 #else
   ONESHOT_TICK_CURRENT(g_oneshot_lower, &g_current_tick);
+#  ifdef CONFIG_HRTIMER
+  flags = spin_lock_irqsave(&g_alarm_lock);
+  g_alarm_tick = g_current_tick + 1;
+  oneshot_reprogram();
+  spin_unlock_irqrestore(&g_alarm_lock, flags);
+#  else
   ONESHOT_TICK_START(g_oneshot_lower, oneshot_callback, NULL, 1);
+#  endif
 #endif
 }
 
@@ -275,7 +411,17 @@ int weak_function up_alarm_tick_cancel(FAR clock_t *ticks)
 
   if (g_oneshot_lower != NULL)
     {
+#ifdef CONFIG_HRTIMER
+      irqstate_t flags = spin_lock_irqsave(&g_alarm_lock);
+
+      /* Keep the oneshot running for pending hrtimers */
+
+      g_alarm_tick = CLOCK_MAX;
+      ret = oneshot_reprogram();
+      spin_unlock_irqrestore(&g_alarm_lock, flags);
+#else
       ret = ONESHOT_TICK_CANCEL(g_oneshot_lower, ticks);
+#endif
       ONESHOT_TICK_CURRENT(g_oneshot_lower, ticks);
     }
 
@@ -314,6 +460,13 @@ int weak_function up_alarm_tick_start(clock_t ticks)
 
   if (g_oneshot_lower != NULL)
     {
+#ifdef CONFIG_HRTIMER
+      irqstate_t flags = spin_lock_irqsave(&g_alarm_lock);
+
+      g_alarm_tick = ticks;
+      ret = oneshot_reprogram();
+      spin_unlock_irqrestore(&g_alarm_lock, flags);
+#else
       clock_t now = 0;
       clock_t delta;
 
@@ -326,12 +479,49 @@ int weak_function up_alarm_tick_start(clock_t ticks)
 
       ret = ONESHOT_TICK_START(g_oneshot_lower, oneshot_callback,
                                NULL, delta);
+#endif
     }
 
   return ret;
 }
 #endif
 
+/****************************************************************************
+ * Name: up_hrtimer_start
+ *
+ * Description:
+ *   Request a call to hrtimer_process() at the absolute time 'ns'.  A
+ *   value of UINT64_MAX means that no hrtimer is pending.
+ *
+ * Input Parameters:
+ *   ns - The CLOCK_MONOTONIC time of the next hrtimer expiration, in
+ *        nanoseconds.
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success; a negated errno value is returned on
+ *   any failure.
+ *
+ * Assumptions:
+ *   May be called from interrupt level handling or from the normal tasking
+ *   level.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_HRTIMER
+int up_hrtimer_start(uint64_t ns)
+{
+  irqstate_t flags;
+  int ret;
+
+  flags = spin_lock_irqsave(&g_alarm_lock);
+  g_hrtimer_ns = ns;
+  ret = oneshot_reprogram();
+  spin_unlock_irqrestore(&g_alarm_lock, flags);
+
+  return ret;
+}
+#endif
+
 /****************************************************************************
  * Name: up_perf_*
  *
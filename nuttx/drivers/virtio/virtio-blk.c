@@ -24,8 +24,10 @@
  * Included Files
  ****************************************************************************/
 
+#include <sys/param.h>
 #include <debug.h>
 #include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 
 #include <nuttx/fs/fs.h>
@@ -45,6 +47,7 @@
 
 /* Block feature bits */
 
+#define VIRTIO_BLK_F_SEG_MAX        2  /* Maximum number of segments */
 #define VIRTIO_BLK_F_RO             5  /* Disk is read-only */
 #define VIRTIO_BLK_F_BLK_SIZE       6  /* Block size of disk is available */
 #define VIRTIO_BLK_F_FLUSH          9  /* Cache flush command support */
@@ -66,6 +69,12 @@
 #define VIRTIO_BLK_SECTOR_BITS      9
 #define VIRTIO_BLK_SECTOR_SIZE      (1UL << VIRTIO_BLK_SECTOR_BITS)
 
+/* Largest number of data buffers of one command, the requests of a chain
+ * beyond it are sent with the next command.
+ */
+
+#define VIRTIO_BLK_MAX_SEGS         16
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -114,12 +123,29 @@ begin_packed_struct struct virtio_blk_config_s
   uint32_t secure_erase_sector_alignment;
 } end_packed_struct;
 
+/* One command in the virtqueue, its cookie */
+
+struct virtio_blk_cmd_s
+{
+  FAR struct virtio_blk_cmd_s  *flink;          /* Next free command */
+  struct virtio_blk_req_s       hdr;            /* The block out header */
+  struct virtio_blk_resp_s      resp;           /* The block in header */
+  FAR struct block_request_s   *req;            /* First request or NULL */
+  unsigned int                  nreqs;          /* Requests of the command */
+  sem_t                         sem;            /* Wakes up a waiter */
+};
+
 struct virtio_blk_priv_s
 {
   FAR struct virtio_device     *vdev;           /* Virtio device */
   spinlock_t                    lock;           /* Lock */
   uint64_t                      nsectors;       /* Sectore numbers */
   uint32_t                      block_size;     /* Block size */
+  uint32_t                      seg_max;        /* Data buffers per command */
+  FAR struct virtio_blk_cmd_s  *cmds;           /* All the commands */
+  FAR struct virtio_blk_cmd_s  *freecmd;        /* Commands not in use */
+  FAR struct block_request_s   *pending;        /* Chains not yet queued */
+  FAR struct block_request_s   *pendtail;       /* Last chain not queued */
   char                          name[NAME_MAX]; /* Device name */
 };
 
@@ -144,6 +170,8 @@ static int     virtio_blk_geometry(FAR struct inode *inode,
                                    FAR struct geometry *geometry);
 static int     virtio_blk_ioctl(FAR struct inode *inode, int cmd,
                                 unsigned long arg);
+static int     virtio_blk_submit(FAR struct inode *inode,
+                                 FAR struct block_request_s *req);
 static int     virtio_blk_flush(FAR struct virtio_blk_priv_s *priv);
 
 /* Other functions */
@@ -174,7 +202,11 @@ static const struct block_operations g_virtio_blk_bops =
   virtio_blk_read,     /* read     */
   virtio_blk_write,    /* write    */
   virtio_blk_geometry, /* geometry */
-  virtio_blk_ioctl     /* ioctl    */
+  virtio_blk_ioctl,    /* ioctl    */
+#ifndef CONFIG_DISABLE_PSEUDOFS_OPERATIONS
+  NULL,                /* unlink   */
+#endif
+  virtio_blk_submit    /* submit   */
 };
 
 static int g_virtio_blk_idx = 0;
@@ -184,37 +216,258 @@ static int g_virtio_blk_idx = 0;
  ****************************************************************************/
 
 /****************************************************************************
- * Name: virtio_blk_wait_complete
+ * Name: virtio_blk_finish
  *
  * Description:
- *   Wait the virtio block request complete
+ *   Complete a command taken from the virtqueue.
  *
  ****************************************************************************/
 
-static void virtio_blk_wait_complete(FAR struct virtqueue *vq,
-                                     FAR sem_t *respsem)
+static void virtio_blk_finish(FAR struct virtio_blk_priv_s *priv,
+                              FAR struct virtio_blk_cmd_s *cmd)
 {
-  FAR struct virtio_blk_priv_s *priv = vq->vq_dev->priv;
-  FAR sem_t *sem;
+  FAR struct block_request_s *req = cmd->req;
+  unsigned int nreqs = cmd->nreqs;
+  irqstate_t flags;
+  int error;
+
+  if (req == NULL)
+    {
+      nxsem_post(&cmd->sem);
+      return;
+    }
+
+  if (cmd->resp.status == VIRTIO_BLK_S_OK)
+    {
+      error = OK;
+    }
+  else
+    {
+      vrterr("Request %" PRIu32 " Error %u\n", cmd->hdr.type,
+             cmd->resp.status);
+      error = cmd->resp.status == VIRTIO_BLK_S_UNSUPP ? -ENOTSUP : -EIO;
+    }
+
+  flags = spin_lock_irqsave(&priv->lock);
+  cmd->flink    = priv->freecmd;
+  priv->freecmd = cmd;
+  spin_unlock_irqrestore(&priv->lock, flags);
+
+  block_complete(req, nreqs, error);
+}
+
+/****************************************************************************
+ * Name: virtio_blk_issue
+ *
+ * Description:
+ *   Move the pending chains to the virtqueue while there are free commands
+ *   and descriptors.  A chain with more requests than the data buffers of
+ *   a command is sent with several commands.
+ *
+ ****************************************************************************/
 
-  if (up_interrupt_context())
+static void virtio_blk_issue(FAR struct virtio_blk_priv_s *priv)
+{
+  FAR struct virtqueue *vq = priv->vdev->vrings_info[0].vq;
+  FAR struct virtqueue_buf vb[VIRTIO_BLK_MAX_SEGS + 2];
+  FAR struct virtio_blk_cmd_s *cmd;
+  FAR struct block_request_s *req;
+  FAR struct block_request_s *next;
+  irqstate_t flags;
+  unsigned int nsegs;
+  bool kick = false;
+  bool write;
+  int ret;
+
+  flags = spin_lock_irqsave(&priv->lock);
+
+  while ((req = priv->pending) != NULL && priv->freecmd != NULL)
     {
-      for (; ; )
+      /* Buffer 0: the block out header;
+       * Buffer 1..n: the read/write buffers of the requests;
+       * Buffer n + 1: the block in header, return the status.
+       */
+
+      nsegs = 0;
+      next  = req;
+      if (req->op != BLOCK_REQ_FLUSH)
+        {
+          for (; next != NULL && nsegs < priv->seg_max; next = next->merged)
+            {
+              vb[++nsegs].buf = next->buffer;
+              vb[nsegs].len   = next->nsectors * priv->block_size;
+            }
+        }
+      else
+        {
+          next = req->merged;
+        }
+
+      if (vq->vq_free_cnt < nsegs + 2)
+        {
+          break;
+        }
+
+      cmd           = priv->freecmd;
+      priv->freecmd = cmd->flink;
+
+      write             = req->op == BLOCK_REQ_WRITE;
+      cmd->req          = req;
+      cmd->nreqs        = MAX(nsegs, 1);
+      cmd->hdr.type     = req->op == BLOCK_REQ_FLUSH ? VIRTIO_BLK_T_FLUSH :
+                          write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+      cmd->hdr.reserved = 0;
+      cmd->hdr.sector   = req->op == BLOCK_REQ_FLUSH ? 0 :
+                          req->sector * priv->block_size >>
+                          VIRTIO_BLK_SECTOR_BITS;
+      cmd->resp.status  = VIRTIO_BLK_S_IOERR;
+
+      vb[0].buf         = &cmd->hdr;
+      vb[0].len         = VIRTIO_BLK_REQ_HEADER_SIZE;
+      vb[nsegs + 1].buf = &cmd->resp;
+      vb[nsegs + 1].len = VIRTIO_BLK_RESP_HEADER_SIZE;
+
+      ret = virtqueue_add_buffer(vq, vb, write ? nsegs + 1 : 1,
+                                 write ? 1 : nsegs + 1, cmd);
+      if (ret < 0)
+        {
+          vrterr("virtqueue_add_buffer failed, ret=%d\n", ret);
+          cmd->flink    = priv->freecmd;
+          priv->freecmd = cmd;
+          break;
+        }
+
+      /* The rest of a long chain stays at the head of the queue */
+
+      if (next != NULL)
         {
-          sem = virtqueue_get_buffer_lock(vq, NULL, NULL, &priv->lock);
-          if (sem == respsem)
+          next->flink = req->flink;
+          if (priv->pendtail == req)
             {
-              break;
+              priv->pendtail = next;
             }
-          else if (sem != NULL)
+
+          priv->pending = next;
+        }
+      else
+        {
+          priv->pending = req->flink;
+          if (priv->pending == NULL)
             {
-              nxsem_post(sem);
+              priv->pendtail = NULL;
             }
         }
+
+      kick = true;
+    }
+
+  if (kick)
+    {
+      virtqueue_kick(vq);
+    }
+
+  spin_unlock_irqrestore(&priv->lock, flags);
+}
+
+/****************************************************************************
+ * Name: virtio_blk_queue
+ *
+ * Description:
+ *   Append a chain of requests to the pending chains and start as many of
+ *   them as the virtqueue takes.
+ *
+ ****************************************************************************/
+
+static void virtio_blk_queue(FAR struct virtio_blk_priv_s *priv,
+                             FAR struct block_request_s *req)
+{
+  irqstate_t flags;
+
+  req->flink = NULL;
+
+  flags = spin_lock_irqsave(&priv->lock);
+  if (priv->pendtail != NULL)
+    {
+      priv->pendtail->flink = req;
     }
   else
     {
-      nxsem_wait_uninterruptible(respsem);
+      priv->pending = req;
+    }
+
+  priv->pendtail = req;
+  spin_unlock_irqrestore(&priv->lock, flags);
+
+  virtio_blk_issue(priv);
+}
+
+/****************************************************************************
+ * Name: virtio_blk_wakeup
+ ****************************************************************************/
+
+static void virtio_blk_wakeup(FAR struct block_request_s *req)
+{
+  nxsem_post(req->priv);
+}
+
+/****************************************************************************
+ * Name: virtio_blk_transfer
+ *
+ * Description:
+ *   Queue one request behind the asynchronous ones and wait for it.
+ *
+ ****************************************************************************/
+
+static ssize_t virtio_blk_transfer(FAR struct virtio_blk_priv_s *priv,
+                                   uint8_t op, FAR void *buffer,
+                                   blkcnt_t startsector,
+                                   unsigned int nsectors)
+{
+  struct block_request_s req;
+  sem_t sem;
+
+  nxsem_init(&sem, 0, 0);
+
+  req.merged   = NULL;
+  req.buffer   = buffer;
+  req.sector   = startsector;
+  req.nsectors = nsectors;
+  req.op       = op;
+  req.done     = virtio_blk_wakeup;
+  req.priv     = &sem;
+
+  virtio_blk_queue(priv, &req);
+  nxsem_wait_uninterruptible(&sem);
+  nxsem_destroy(&sem);
+
+  return req.result;
+}
+
+/****************************************************************************
+ * Name: virtio_blk_wait_complete
+ *
+ * Description:
+ *   Wait the virtio block request complete in interrupt context
+ *
+ ****************************************************************************/
+
+static void virtio_blk_wait_complete(FAR struct virtqueue *vq,
+                                     FAR struct virtio_blk_cmd_s *respcmd)
+{
+  FAR struct virtio_blk_priv_s *priv = vq->vq_dev->priv;
+  FAR struct virtio_blk_cmd_s *cmd;
+
+  for (; ; )
+    {
+      cmd = virtqueue_get_buffer_lock(vq, NULL, NULL, &priv->lock);
+      if (cmd == respcmd)
+        {
+          break;
+        }
+      else if (cmd != NULL)
+        {
+          virtio_blk_finish(priv, cmd);
+        }
     }
 }
 
@@ -233,21 +486,28 @@ static ssize_t virtio_blk_rdwr(FAR struct virtio_blk_priv_s *priv,
   FAR struct virtio_device *vdev = priv->vdev;
   FAR struct virtqueue *vq = vdev->vrings_info[0].vq;
   FAR struct virtqueue_buf vb[3];
-  struct virtio_blk_resp_s resp;
-  struct virtio_blk_req_s req;
+  struct virtio_blk_cmd_s cmd;
   irqstate_t flags;
-  sem_t respsem;
   ssize_t ret;
   int readnum;
 
-  nxsem_init(&respsem, 0, 0);
+  /* Outside of interrupt handlers the request waits for its turn */
+
+  if (!up_interrupt_context())
+    {
+      return virtio_blk_transfer(priv, write ? BLOCK_REQ_WRITE :
+                                 BLOCK_REQ_READ, buffer, startsector,
+                                 nsectors);
+    }
 
   /* Build the block request */
 
-  req.type     = write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
-  req.reserved = 0;
-  req.sector   = startsector * priv->block_size >> VIRTIO_BLK_SECTOR_BITS;
-  resp.status  = VIRTIO_BLK_S_IOERR;
+  cmd.req          = NULL;
+  cmd.hdr.type     = write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+  cmd.hdr.reserved = 0;
+  cmd.hdr.sector   = startsector * priv->block_size >>
+                     VIRTIO_BLK_SECTOR_BITS;
+  cmd.resp.status  = VIRTIO_BLK_S_IOERR;
 
   /* Fill the virtqueue buffer:
    * Buffer 0: the block out header;
@@ -255,21 +515,18 @@ static ssize_t virtio_blk_rdwr(FAR struct virtio_blk_priv_s *priv,
    * Buffer 2: the block in header, return the status.
    */
 
-  vb[0].buf = &req;
+  vb[0].buf = &cmd.hdr;
   vb[0].len = VIRTIO_BLK_REQ_HEADER_SIZE;
   vb[1].buf = buffer;
   vb[1].len = nsectors * priv->block_size;
-  vb[2].buf = &resp;
+  vb[2].buf = &cmd.resp;
   vb[2].len = VIRTIO_BLK_RESP_HEADER_SIZE;
   readnum = write ? 2 : 1;
 
-  if (up_interrupt_context())
-    {
-      virtqueue_disable_cb_lock(vq, &priv->lock);
-    }
+  virtqueue_disable_cb_lock(vq, &priv->lock);
 
   flags = spin_lock_irqsave(&priv->lock);
-  ret = virtqueue_add_buffer(vq, vb, readnum, 3 - readnum, &respsem);
+  ret = virtqueue_add_buffer(vq, vb, readnum, 3 - readnum, &cmd);
   if (ret < 0)
     {
       spin_unlock_irqrestore(&priv->lock, flags);
@@ -282,20 +539,16 @@ static ssize_t virtio_blk_rdwr(FAR struct virtio_blk_priv_s *priv,
 
   /* Wait for the request completion */
 
-  virtio_blk_wait_complete(vq, &respsem);
+  virtio_blk_wait_complete(vq, &cmd);
 
-  if (resp.status != VIRTIO_BLK_S_OK)
+  if (cmd.resp.status != VIRTIO_BLK_S_OK)
     {
       vrterr("%s Error\n", write ? "Write" : "Read");
       ret = -EIO;
     }
 
 err:
-  if (up_interrupt_context())
-    {
-      virtqueue_enable_cb_lock(vq, &priv->lock);
-    }
-
+  virtqueue_enable_cb_lock(vq, &priv->lock);
   return ret >= 0 ? nsectors : ret;
 }
 
@@ -401,55 +654,12 @@ static int virtio_blk_geometry(FAR struct inode *inode,
 }
 
 /****************************************************************************
- * Name: virtio_blk_ioctl
+ * Name: virtio_blk_flush
  ****************************************************************************/
 
 static int virtio_blk_flush(FAR struct virtio_blk_priv_s *priv)
 {
-  FAR struct virtio_device *vdev = priv->vdev;
-  FAR struct virtqueue *vq = vdev->vrings_info[0].vq;
-  FAR struct virtqueue_buf vb[2];
-  struct virtio_blk_resp_s resp;
-  struct virtio_blk_req_s req;
-  irqstate_t flags;
-  sem_t respsem;
-  int ret;
-
-  nxsem_init(&respsem, 0, 0);
-
-  /* Build the block request */
-
-  req.type     = VIRTIO_BLK_T_FLUSH;
-  req.reserved = 0;
-  req.sector   = 0;
-  resp.status  = VIRTIO_BLK_S_IOERR;
-
-  vb[0].buf = &req;
-  vb[0].len = VIRTIO_BLK_REQ_HEADER_SIZE;
-  vb[1].buf = &resp;
-  vb[1].len = VIRTIO_BLK_RESP_HEADER_SIZE;
-
-  flags = spin_lock_irqsave(&priv->lock);
-  ret = virtqueue_add_buffer(vq, vb, 1, 1, &respsem);
-  if (ret < 0)
-    {
-      spin_unlock_irqrestore(&priv->lock, flags);
-      return ret;
-    }
-
-  virtqueue_kick(vq);
-  spin_unlock_irqrestore(&priv->lock, flags);
-
-  /* Wait for the request completion */
-
-  nxsem_wait_uninterruptible(&respsem);
-  if (resp.status != VIRTIO_BLK_S_OK)
-    {
-      vrterr("Flush Error\n");
-      ret = -EIO;
-    }
-
-  return ret;
+  return virtio_blk_transfer(priv, BLOCK_REQ_FLUSH, NULL, 0, 0);
 }
 
 /****************************************************************************
@@ -478,6 +688,41 @@ static int virtio_blk_ioctl(FAR struct inode *inode, int cmd,
   return ret;
 }
 
+/****************************************************************************
+ * Name: virtio_blk_submit
+ *
+ * Description:
+ *   Queue a chain of requests, completed from virtio_blk_done().
+ *
+ ****************************************************************************/
+
+static int virtio_blk_submit(FAR struct inode *inode,
+                             FAR struct block_request_s *req)
+{
+  FAR struct virtio_blk_priv_s *priv;
+
+  DEBUGASSERT(inode->i_private);
+  priv = inode->i_private;
+
+  if (req->op == BLOCK_REQ_WRITE &&
+      virtio_has_feature(priv->vdev, VIRTIO_BLK_F_RO))
+    {
+      return -EPERM;
+    }
+
+  /* Without a write cache there is nothing to flush */
+
+  if (req->op == BLOCK_REQ_FLUSH &&
+      !virtio_has_feature(priv->vdev, VIRTIO_BLK_F_FLUSH))
+    {
+      block_complete(req, 1, OK);
+      return OK;
+    }
+
+  virtio_blk_queue(priv, req);
+  return OK;
+}
+
 /****************************************************************************
  * Name: virtio_blk_done
  ****************************************************************************/
@@ -485,18 +730,22 @@ static int virtio_blk_ioctl(FAR struct inode *inode, int cmd,
 static void virtio_blk_done(FAR struct virtqueue *vq)
 {
   FAR struct virtio_blk_priv_s *priv = vq->vq_dev->priv;
-  FAR sem_t *respsem;
+  FAR struct virtio_blk_cmd_s *cmd;
 
   for (; ; )
     {
-      respsem = virtqueue_get_buffer_lock(vq, NULL, NULL, &priv->lock);
-      if (respsem == NULL)
+      cmd = virtqueue_get_buffer_lock(vq, NULL, NULL, &priv->lock);
+      if (cmd == NULL)
         {
           break;
         }
 
-      nxsem_post(respsem);
+      virtio_blk_finish(priv, cmd);
     }
+
+  /* Refill the queue with the requests waiting for free commands */
+
+  virtio_blk_issue(priv);
 }
 
 /****************************************************************************
@@ -507,7 +756,11 @@ static int virtio_blk_init(FAR struct virtio_blk_priv_s *priv,
                            FAR struct virtio_device *vdev)
 {
   FAR const char *vqname[1];
+  FAR struct virtqueue *vq;
   vq_callback callback[1];
+  uint32_t segmax = 0;
+  unsigned int ncmds;
+  unsigned int i;
   int ret;
 
   priv->vdev = vdev;
@@ -517,7 +770,8 @@ static int virtio_blk_init(FAR struct virtio_blk_priv_s *priv,
   /* Initialize the virtio device */
 
   virtio_set_status(vdev, VIRTIO_CONFIG_STATUS_DRIVER);
-  virtio_negotiate_features(vdev, (1UL << VIRTIO_BLK_F_RO) |
+  virtio_negotiate_features(vdev, (1UL << VIRTIO_BLK_F_SEG_MAX) |
+                                  (1UL << VIRTIO_BLK_F_RO) |
                                   (1UL << VIRTIO_BLK_F_BLK_SIZE) |
                                   (1UL << VIRTIO_BLK_F_FLUSH), NULL);
   virtio_set_status(vdev, VIRTIO_CONFIG_FEATURES_OK);
@@ -531,8 +785,38 @@ static int virtio_blk_init(FAR struct virtio_blk_priv_s *priv,
       return ret;
     }
 
+  /* Every command takes at least three descriptors, one per request
+   * header, status and data buffer.
+   */
+
+  vq = vdev->vrings_info[0].vq;
+  priv->seg_max = MIN(VIRTIO_BLK_MAX_SEGS, vq->vq_nentries - 2);
+  if (virtio_has_feature(vdev, VIRTIO_BLK_F_SEG_MAX))
+    {
+      virtio_read_config_member(vdev, struct virtio_blk_config_s, seg_max,
+                                &segmax);
+      if (segmax > 0)
+        {
+          priv->seg_max = MIN(priv->seg_max, segmax);
+        }
+    }
+
+  ncmds = MAX(vq->vq_nentries / 3, 1);
+  priv->cmds = kmm_zalloc(ncmds * sizeof(struct virtio_blk_cmd_s));
+  if (priv->cmds == NULL)
+    {
+      virtio_delete_virtqueues(vdev);
+      return -ENOMEM;
+    }
+
+  for (i = 0; i < ncmds; i++)
+    {
+      priv->cmds[i].flink = priv->freecmd;
+      priv->freecmd       = &priv->cmds[i];
+    }
+
   virtio_set_status(vdev, VIRTIO_CONFIG_STATUS_DRIVER_OK);
-  virtqueue_enable_cb(vdev->vrings_info[0].vq);
+  virtqueue_enable_cb(vq);
   return ret;
 }
 
@@ -543,9 +827,23 @@ static int virtio_blk_init(FAR struct virtio_blk_priv_s *priv,
 static void virtio_blk_uninit(FAR struct virtio_blk_priv_s *priv)
 {
   FAR struct virtio_device *vdev = priv->vdev;
+  FAR struct block_request_s *req;
+  FAR struct block_request_s *next;
 
   virtio_reset_device(vdev);
   virtio_delete_virtqueues(vdev);
+
+  /* Fail the requests that never reached the device */
+
+  for (req = priv->pending; req != NULL; req = next)
+    {
+      next = req->flink;
+      block_complete(req, UINT_MAX, -ENODEV);
+    }
+
+  priv->pending  = NULL;
+  priv->pendtail = NULL;
+  kmm_free(priv->cmds);
 }
 
 /****************************************************************************
@@ -28,10 +28,14 @@
 #include <nuttx/config.h>
 
 #include <sys/types.h>
+#include <sys/aioring.h>
+#include <stdbool.h>
+#include <poll.h>
 #include <string.h>
 #include <aio.h>
 
 #include <nuttx/queue.h>
+#include <nuttx/semaphore.h>
 #include <nuttx/wqueue.h>
 
 #ifdef CONFIG_FS_AIO
@@ -52,6 +56,33 @@
  * Public Types
  ****************************************************************************/
 
+/* Work queued to the AIO worker pool by aio_work_queue() */
+
+struct aio_work_s
+{
+  dq_entry_t link;                 /* Supports a doubly linked list */
+  worker_t worker;                 /* Function run by a worker thread */
+  FAR void *arg;                   /* Argument of the function */
+  bool queued;                     /* Not yet taken by a worker thread */
+};
+
+/* State of one operation run by aio_execute().  An operation that has to
+ * wait for its file to become ready does not hold a worker thread: it
+ * sets up a poll on the file and aio_execute() returns -EINPROGRESS.  The
+ * poll callback, or aio_exec_cancel(), queues 'work' again and the worker
+ * function calls aio_execute() once more to finish the operation.
+ */
+
+struct fdlist;
+struct aio_exec_s
+{
+  struct pollfd fds;               /* Poll on the file while waiting */
+  FAR struct aio_work_s *work;     /* Queued again when the wait is over */
+  FAR struct fdlist *fdlist;       /* Receives the accepted descriptors */
+  volatile uint8_t state;          /* See AIO_EXEC_* in aio_execute.c */
+  volatile bool canceled;          /* Set by aio_exec_cancel() */
+};
+
 /* This structure contains one AIO control block and appends information
  * needed by the logic running on the worker thread.  These structures are
  * pre-allocated, the number pre-allocated controlled by CONFIG_FS_NAIOC.
@@ -63,11 +94,9 @@ struct aio_container_s
   dq_entry_t aioc_link;            /* Supports a doubly linked list */
   FAR struct aiocb *aioc_aiocbp;   /* The contained AIO control block */
   FAR struct file *aioc_filep;     /* File structure to use with the I/O */
-  struct work_s aioc_work;         /* Used to defer I/O to the work thread */
+  struct aio_work_s aioc_work;     /* Used to defer I/O to the workers */
+  struct aio_exec_s aioc_exec;     /* State of the operation */
   pid_t aioc_pid;                  /* ID of the waiting task */
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  uint8_t aioc_prio;               /* Priority of the waiting task */
-#endif
 };
 
 /****************************************************************************
@@ -206,7 +235,7 @@ FAR struct aiocb *aioc_decant(FAR struct aio_container_s *aioc);
  * Name: aio_queue
  *
  * Description:
- *   Schedule the asynchronous I/O on the low priority work queue
+ *   Schedule the asynchronous I/O on the AIO worker pool
  *
  * Input Parameters:
  *   arg - Worker argument.  In this case, a pointer to an instance of
@@ -239,6 +268,97 @@ int aio_queue(FAR struct aio_container_s *aioc, worker_t worker);
 
 int aio_signal(pid_t pid, FAR struct aiocb *aiocbp);
 
+/****************************************************************************
+ * Name: aio_work_queue
+ *
+ * Description:
+ *   Queue work to the AIO worker pool.  The worker threads are created by
+ *   the first call.
+ *
+ * Input Parameters:
+ *   work   - The work structure, unused until the worker has run
+ *   worker - The function run by a worker thread
+ *   arg    - The argument of the function
+ *
+ * Returned Value:
+ *   Zero (OK) on success; a negated errno value if the worker threads
+ *   could not be created.
+ *
+ ****************************************************************************/
+
+int aio_work_queue(FAR struct aio_work_s *work, worker_t worker,
+                   FAR void *arg);
+
+/****************************************************************************
+ * Name: aio_work_cancel
+ *
+ * Description:
+ *   Remove work from the AIO worker pool if no worker has taken it yet.
+ *
+ * Returned Value:
+ *   Zero (OK) if the work was removed; -ENOENT if it is running or done.
+ *
+ ****************************************************************************/
+
+int aio_work_cancel(FAR struct aio_work_s *work);
+
+/****************************************************************************
+ * Name: aio_execute
+ *
+ * Description:
+ *   Run one operation on a worker thread.  This is shared by the POSIX
+ *   interfaces and by the submission rings.  Operations on files that may
+ *   block (devices, pipes and sockets) first wait until the file is ready,
+ *   without holding the worker thread.
+ *
+ * Input Parameters:
+ *   filep - The file of the operation
+ *   sqe   - The operation
+ *   exec  - State of the operation, initialized by aio_exec_init()
+ *
+ * Returned Value:
+ *   The result of the operation, a negated errno value on failure.
+ *   -EINPROGRESS if the file is not ready: exec->work is queued again when
+ *   it is, its worker must then call aio_execute() with the same arguments.
+ *
+ ****************************************************************************/
+
+ssize_t aio_execute(FAR struct file *filep,
+                    FAR const struct aioring_sqe_s *sqe,
+                    FAR struct aio_exec_s *exec);
+
+/****************************************************************************
+ * Name: aio_exec_init
+ *
+ * Description:
+ *   Initialize the state of an operation before its work is queued.
+ *
+ * Input Parameters:
+ *   exec   - State of the operation
+ *   fdlist - Receives the descriptors of AIORING_OP_ACCEPT, may be NULL
+ *   work   - The work that runs the operation
+ *
+ ****************************************************************************/
+
+void aio_exec_init(FAR struct aio_exec_s *exec, FAR struct fdlist *fdlist,
+                   FAR struct aio_work_s *work);
+
+/****************************************************************************
+ * Name: aio_exec_cancel
+ *
+ * Description:
+ *   Cancel an operation.  An operation that waits for its file is queued
+ *   again to complete with -ECANCELED.
+ *
+ * Returned Value:
+ *   Zero (OK) if the work of the operation was removed before it ever ran,
+ *   the caller completes the operation then.  -EINPROGRESS if a worker
+ *   runs the operation or will run it again.
+ *
+ ****************************************************************************/
+
+int aio_exec_cancel(FAR struct aio_exec_s *exec);
+
 #undef EXTERN
 #if defined(__cplusplus)
 }
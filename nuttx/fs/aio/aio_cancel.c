@@ -124,14 +124,15 @@ int aio_cancel(int fildes, FAR struct aiocb *aiocbp)
           if (aioc)
             {
               /* Yes... attempt to cancel the I/O.  There are two
-               * possibilities:* (1) the work has already been started and
-               * is no longer queued, or (2) the work has not been started
-               * and is still in the work queue.  Only the second case can
-               * be canceled.  work_cancel() will return -ENOENT in the
-               * first case.
+               * possibilities:* (1) the work has already been started, or
+               * (2) the work has not been started and is still in the work
+               * queue.  Only the second case can be canceled here.  In the
+               * first case aio_exec_cancel() returns -EINPROGRESS, an
+               * operation waiting for its file then completes with
+               * ECANCELED.
                */
 
-              status = work_cancel(LPWORK, &aioc->aioc_work);
+              status = aio_exec_cancel(&aioc->aioc_exec);
               if (status >= 0)
                 {
                   /* Remove the container from the list of pending
@@ -181,14 +182,15 @@ int aio_cancel(int fildes, FAR struct aiocb *aiocbp)
           if (aioc)
             {
               /* Yes... attempt to cancel the I/O.  There are two
-               * possibilities:* (1) the work has already been started and
-               * is no longer queued, or (2) the work has not been started
-               * and is still in the work queue.  Only the second case can
-               * be canceled.  work_cancel() will return -ENOENT in the
-               * first case.
+               * possibilities:* (1) the work has already been started, or
+               * (2) the work has not been started and is still in the work
+               * queue.  Only the second case can be canceled here.  In the
+               * first case aio_exec_cancel() returns -EINPROGRESS, an
+               * operation waiting for its file then completes with
+               * ECANCELED.
                */
 
-              status = work_cancel(LPWORK, &aioc->aioc_work);
+              status = aio_exec_cancel(&aioc->aioc_exec);
               if (status >= 0)
                 {
                   /* Remove the container from the list of pending
@@ -0,0 +1,507 @@
+/****************************************************************************
+ * fs/aio/aio_execute.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/socket.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+
+#include <nuttx/fs/fs.h>
+#include <nuttx/net/net.h>
+#include <nuttx/spinlock.h>
+
+#include "aio/aio.h"
+#include "fs_heap.h"
+
+#ifdef CONFIG_FS_AIO
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* States of an operation (aio_exec_s::state) */
+
+#define AIO_EXEC_IDLE     0  /* No poll set up on the file */
+#define AIO_EXEC_ARMED    1  /* Poll set up, the worker still runs */
+#define AIO_EXEC_WAITING  2  /* Poll set up, no worker runs the operation */
+#define AIO_EXEC_READY    3  /* Queued again, the poll must be torn down */
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* Serializes the state changes of the operations with the poll callbacks,
+ * which may run in interrupt context.
+ */
+
+static spinlock_t g_aio_execlock = SP_UNLOCKED;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: aio_events
+ *
+ * Description:
+ *   Return the poll events that an operation waits for before it runs, or
+ *   zero if it runs immediately.  Regular files and block devices never
+ *   need to wait.
+ *
+ ****************************************************************************/
+
+static pollevent_t aio_events(FAR struct file *filep,
+                              FAR const struct aioring_sqe_s *sqe)
+{
+  FAR struct inode *inode = filep->f_inode;
+
+  if (inode == NULL || INODE_IS_MOUNTPT(inode) || INODE_IS_BLOCK(inode) ||
+      INODE_IS_MTD(inode))
+    {
+      return sqe->opcode == AIORING_OP_POLL ? sqe->opflags : 0;
+    }
+
+  switch (sqe->opcode)
+    {
+      case AIORING_OP_READ:
+      case AIORING_OP_RECV:
+      case AIORING_OP_ACCEPT:
+        return POLLIN;
+
+      case AIORING_OP_WRITE:
+      case AIORING_OP_SEND:
+        return POLLOUT;
+
+      case AIORING_OP_POLL:
+        return sqe->opflags;
+
+      default:
+        return 0;
+    }
+}
+
+/****************************************************************************
+ * Name: aio_exec_pollcb
+ *
+ * Description:
+ *   Poll callback of a waiting operation: queue its work again.
+ *
+ ****************************************************************************/
+
+static void aio_exec_pollcb(FAR struct pollfd *fds)
+{
+  FAR struct aio_exec_s *exec = fds->arg;
+  irqstate_t flags;
+  bool requeue;
+
+  flags   = spin_lock_irqsave(&g_aio_execlock);
+  requeue = exec->state == AIO_EXEC_WAITING;
+  if (requeue)
+    {
+      exec->state = AIO_EXEC_READY;
+    }
+
+  spin_unlock_irqrestore(&g_aio_execlock, flags);
+
+  /* The operation ran on a worker before, so the worker threads exist and
+   * queueing the work cannot fail.
+   */
+
+  if (requeue)
+    {
+      aio_work_queue(exec->work, exec->work->worker, exec->work->arg);
+    }
+}
+
+/****************************************************************************
+ * Name: aio_ready
+ *
+ * Description:
+ *   Tear down the poll of an operation that was woken up.
+ *
+ * Returned Value:
+ *   The events reported by the file or -ECANCELED if the operation was
+ *   cancelled first.
+ *
+ ****************************************************************************/
+
+static int aio_ready(FAR struct file *filep, FAR struct aio_exec_s *exec)
+{
+  file_poll(filep, &exec->fds, false);
+  exec->state = AIO_EXEC_IDLE;
+
+  return exec->fds.revents != 0 ? (int)exec->fds.revents : -ECANCELED;
+}
+
+/****************************************************************************
+ * Name: aio_wait
+ *
+ * Description:
+ *   Set up a poll for 'events' on the file.  Unless the file is ready
+ *   already, the worker thread lets go of the operation: the poll callback
+ *   queues it again.
+ *
+ * Returned Value:
+ *   The events reported by the file, -EINPROGRESS if the operation waits,
+ *   -ECANCELED if it was cancelled first or a negated errno value if the
+ *   file cannot be polled.
+ *
+ ****************************************************************************/
+
+static int aio_wait(FAR struct file *filep, pollevent_t events,
+                    FAR struct aio_exec_s *exec)
+{
+  irqstate_t flags;
+  int ret;
+
+  memset(&exec->fds, 0, sizeof(exec->fds));
+  exec->fds.events = events;
+  exec->fds.arg    = exec;
+  exec->fds.cb     = aio_exec_pollcb;
+  exec->state      = AIO_EXEC_ARMED;
+
+  ret = file_poll(filep, &exec->fds, true);
+  if (ret < 0)
+    {
+      exec->state = AIO_EXEC_IDLE;
+      return ret;
+    }
+
+  /* poll_notify() sets revents before it calls aio_exec_pollcb() */
+
+  flags = spin_lock_irqsave(&g_aio_execlock);
+  if (exec->fds.revents == 0 && !exec->canceled)
+    {
+      exec->state = AIO_EXEC_WAITING;
+      spin_unlock_irqrestore(&g_aio_execlock, flags);
+      return -EINPROGRESS;
+    }
+
+  spin_unlock_irqrestore(&g_aio_execlock, flags);
+  return aio_ready(filep, exec);
+}
+
+/****************************************************************************
+ * Name: aio_accept
+ *
+ * Description:
+ *   Accept a connection and install the new socket in the descriptor list
+ *   of the owner of the operation.  The listening socket was ready: do not
+ *   block if another thread took the connection first, return -EAGAIN.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NET
+static int aio_accept(FAR struct file *filep,
+                      FAR const struct aioring_sqe_s *sqe,
+                      FAR struct aio_exec_s *exec)
+{
+  FAR struct socket *psock = file_socket(filep);
+  FAR struct socket_conn_s *conn;
+  FAR struct socket *newsock;
+  int oflags = O_RDWR;
+  bool nonblock;
+  int ret;
+
+  if (psock == NULL)
+    {
+      return -ENOTSOCK;
+    }
+
+  if (exec->fdlist == NULL ||
+      (sqe->opflags & ~(SOCK_NONBLOCK | SOCK_CLOEXEC)) != 0)
+    {
+      return -EINVAL;
+    }
+
+  newsock = fs_heap_zalloc(sizeof(*newsock));
+  if (newsock == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  /* The network lock is recursive and a non-blocking accept keeps it, so
+   * the listening socket is never seen non-blocking by anyone else.
+   */
+
+  net_lock();
+  conn     = psock->s_conn;
+  nonblock = _SS_ISNONBLOCK(conn->s_flags);
+  conn->s_flags |= _SF_NONBLOCK;
+
+  ret = psock_accept(psock, NULL, NULL, newsock, sqe->opflags);
+  if (!nonblock)
+    {
+      conn->s_flags &= ~_SF_NONBLOCK;
+    }
+
+  net_unlock();
+  if (ret < 0)
+    {
+      fs_heap_free(newsock);
+      return ret;
+    }
+
+  if (sqe->opflags & SOCK_CLOEXEC)
+    {
+      oflags |= O_CLOEXEC;
+    }
+
+  if (sqe->opflags & SOCK_NONBLOCK)
+    {
+      oflags |= O_NONBLOCK;
+    }
+
+  ret = fdlist_allocate_from_inode(exec->fdlist, filep->f_inode, oflags, 0,
+                                   newsock, 0);
+  if (ret < 0)
+    {
+      psock_close(newsock);
+      fs_heap_free(newsock);
+    }
+
+  return ret;
+}
+#endif
+
+/****************************************************************************
+ * Name: aio_run
+ *
+ * Description:
+ *   Perform an operation once its file is ready.
+ *
+ ****************************************************************************/
+
+static ssize_t aio_run(FAR struct file *filep,
+                       FAR const struct aioring_sqe_s *sqe,
+                       FAR struct aio_exec_s *exec)
+{
+  switch (sqe->opcode)
+    {
+      case AIORING_OP_NOP:
+        return 0;
+
+      case AIORING_OP_READ:
+        if (sqe->off < 0)
+          {
+            return file_read(filep, sqe->addr, sqe->len);
+          }
+
+        return file_pread(filep, sqe->addr, sqe->len, sqe->off);
+
+      case AIORING_OP_WRITE:
+        if (sqe->off < 0)
+          {
+            return file_write(filep, sqe->addr, sqe->len);
+          }
+
+        return file_pwrite(filep, sqe->addr, sqe->len, sqe->off);
+
+      case AIORING_OP_FSYNC:
+        return file_fsync(filep);
+
+      case AIORING_OP_POLL:
+        return sqe->opflags;
+
+#ifdef CONFIG_NET
+      case AIORING_OP_ACCEPT:
+        return aio_accept(filep, sqe, exec);
+
+      case AIORING_OP_RECV:
+      case AIORING_OP_SEND:
+        {
+          FAR struct socket *psock = file_socket(filep);
+
+          if (psock == NULL)
+            {
+              return -ENOTSOCK;
+            }
+
+          /* The socket was ready: do not block if another reader or writer
+           * got there first.
+           */
+
+          if (sqe->opcode == AIORING_OP_RECV)
+            {
+              return psock_recv(psock, sqe->addr, sqe->len,
+                                sqe->opflags | MSG_DONTWAIT);
+            }
+
+          return psock_send(psock, sqe->addr, sqe->len,
+                            sqe->opflags | MSG_DONTWAIT);
+        }
+#endif
+
+      default:
+        return -EINVAL;
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: aio_exec_init
+ *
+ * Description:
+ *   Initialize the state of an operation before its work is queued.
+ *
+ ****************************************************************************/
+
+void aio_exec_init(FAR struct aio_exec_s *exec, FAR struct fdlist *fdlist,
+                   FAR struct aio_work_s *work)
+{
+  memset(exec, 0, sizeof(*exec));
+  exec->work   = work;
+  exec->fdlist = fdlist;
+  exec->state  = AIO_EXEC_IDLE;
+}
+
+/****************************************************************************
+ * Name: aio_exec_cancel
+ *
+ * Description:
+ *   Cancel an operation.  An operation that waits for its file is queued
+ *   again to complete with -ECANCELED.
+ *
+ ****************************************************************************/
+
+int aio_exec_cancel(FAR struct aio_exec_s *exec)
+{
+  irqstate_t flags;
+  bool requeue = false;
+  int ret = -EINPROGRESS;
+
+  flags = spin_lock_irqsave(&g_aio_execlock);
+  exec->canceled = true;
+  if (exec->state == AIO_EXEC_IDLE)
+    {
+      /* Not waiting: either the work was never taken by a worker, or a
+       * worker runs it right now.
+       */
+
+      if (aio_work_cancel(exec->work) == OK)
+        {
+          ret = OK;
+        }
+    }
+  else if (exec->state == AIO_EXEC_WAITING)
+    {
+      exec->state = AIO_EXEC_READY;
+      requeue     = true;
+    }
+
+  spin_unlock_irqrestore(&g_aio_execlock, flags);
+
+  if (requeue)
+    {
+      aio_work_queue(exec->work, exec->work->worker, exec->work->arg);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: aio_execute
+ *
+ * Description:
+ *   Run one operation on a worker thread.  This is shared by the POSIX
+ *   interfaces and by the submission rings.  Operations on files that may
+ *   block (devices, pipes and sockets) first wait until the file is ready,
+ *   without holding the worker thread.
+ *
+ * Input Parameters:
+ *   filep - The file of the operation
+ *   sqe   - The operation
+ *   exec  - State of the operation, initialized by aio_exec_init()
+ *
+ * Returned Value:
+ *   The result of the operation, a negated errno value on failure.
+ *   -EINPROGRESS if the file is not ready: exec->work is queued again when
+ *   it is, its worker must then call aio_execute() with the same arguments.
+ *
+ ****************************************************************************/
+
+ssize_t aio_execute(FAR struct file *filep,
+                    FAR const struct aioring_sqe_s *sqe,
+                    FAR struct aio_exec_s *exec)
+{
+  pollevent_t events;
+  ssize_t ret;
+
+  for (; ; )
+    {
+      events = aio_events(filep, sqe);
+      if (exec->state != AIO_EXEC_IDLE)
+        {
+          /* Queued again by aio_exec_pollcb() or aio_exec_cancel() */
+
+          ret = aio_ready(filep, exec);
+        }
+      else if (exec->canceled)
+        {
+          return -ECANCELED;
+        }
+      else
+        {
+          ret = events != 0 ? aio_wait(filep, events, exec) : 0;
+        }
+
+      if (sqe->opcode == AIORING_OP_POLL || ret == -EINPROGRESS ||
+          ret == -ECANCELED)
+        {
+          return ret;
+        }
+
+      /* A file without a poll method cannot be waited for, the operation
+       * will block the worker instead.
+       */
+
+      if (ret == -ENOSYS)
+        {
+          return aio_run(filep, sqe, exec);
+        }
+      else if (ret < 0)
+        {
+          return ret;
+        }
+
+      /* Wait again if another thread consumed the readiness first */
+
+      ret = aio_run(filep, sqe, exec);
+      if (ret != -EAGAIN || events == 0)
+        {
+          return ret;
+        }
+    }
+}
+
+#endif /* CONFIG_FS_AIO */
@@ -63,27 +63,31 @@ static void aio_fsync_worker(FAR void *arg)
 {
   FAR struct aio_container_s *aioc = (FAR struct aio_container_s *)arg;
   FAR struct aiocb *aiocbp;
+  struct aioring_sqe_s sqe;
   pid_t pid;
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  uint8_t prio;
-#endif
   int ret;
 
-  /* Get the information from the container, decant the AIO control block,
-   * and free the container before starting any I/O.  That will minimize
-   * the delays by any other threads waiting for a pre-allocated container.
+  /* The container holds the file and the state of the operation until the
+   * I/O is done.
    */
 
   DEBUGASSERT(aioc && aioc->aioc_aiocbp);
-  pid    = aioc->aioc_pid;
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  prio   = aioc->aioc_prio;
-#endif
-  aiocbp = aioc_decant(aioc);
+  aiocbp = aioc->aioc_aiocbp;
 
-  /* Perform the fsync using aioc_filep */
+  /* Perform the fsync using filep */
+
+  memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = AIORING_OP_FSYNC;
+
+  ret = aio_execute(aioc->aioc_filep, &sqe, &aioc->aioc_exec);
+  if (ret == -EINPROGRESS)
+    {
+      return;
+    }
+
+  pid = aioc->aioc_pid;
+  aioc_decant(aioc);
 
-  ret = file_fsync(aioc->aioc_filep);
   if (ret < 0)
     {
       ferr("ERROR: file_fsync failed: %d\n", ret);
@@ -97,12 +101,6 @@ static void aio_fsync_worker(FAR void *arg)
   /* Signal the client */
 
   aio_signal(pid, aiocbp);
-
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  /* Restore the low priority worker thread default priority */
-
-  lpwork_restorepriority(prio);
-#endif
 }
 
 /****************************************************************************
@@ -26,7 +26,6 @@
 
 #include <nuttx/config.h>
 
-#include <sched.h>
 #include <aio.h>
 #include <assert.h>
 #include <errno.h>
@@ -46,7 +45,7 @@
  * Name: aio_queue
  *
  * Description:
- *   Schedule the asynchronous I/O on the low priority work queue
+ *   Schedule the asynchronous I/O on the AIO worker pool
  *
  * Input Parameters:
  *   arg - Worker argument.  In this case, a pointer to an instance of
@@ -62,39 +61,20 @@ int aio_queue(FAR struct aio_container_s *aioc, worker_t worker)
 {
   int ret;
 
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  /* Prohibit context switches until we complete the queuing */
+  /* Schedule the work on the AIO worker pool */
 
-  sched_lock();
-
-  /* Make sure that the low-priority worker thread is running at at least
-   * the priority specified for this action.
-   */
-
-  lpwork_boostpriority(aioc->aioc_prio);
-#endif
-
-  /* Schedule the work on the low priority worker thread */
-
-  ret = work_queue(LPWORK, &aioc->aioc_work, worker, aioc, 0);
+  aio_exec_init(&aioc->aioc_exec, NULL, &aioc->aioc_work);
+  ret = aio_work_queue(&aioc->aioc_work, worker, aioc);
   if (ret < 0)
     {
       FAR struct aiocb *aiocbp = aioc->aioc_aiocbp;
       DEBUGASSERT(aiocbp);
 
-#ifdef CONFIG_PRIORITY_INHERITANCE
-      lpwork_restorepriority(aioc->aioc_prio);
-#endif
       aiocbp->aio_result = ret;
       set_errno(-ret);
       ret = ERROR;
     }
 
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  /* Now the low-priority work queue might run at its new priority */
-
-  sched_unlock();
-#endif
   return ret;
 }
 
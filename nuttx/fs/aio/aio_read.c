@@ -63,34 +63,40 @@ static void aio_read_worker(FAR void *arg)
 {
   FAR struct aio_container_s *aioc = (FAR struct aio_container_s *)arg;
   FAR struct aiocb *aiocbp;
+  struct aioring_sqe_s sqe;
   pid_t pid;
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  uint8_t prio;
-#endif
   ssize_t nread = 0;
 
-  /* Get the information from the container, decant the AIO control block,
-   * and free the container before starting any I/O.  That will minimize
-   * the delays by any other threads waiting for a pre-allocated container.
+  /* The container holds the file and the state of the operation until the
+   * I/O is done: an operation that waits for its file lets go of the
+   * worker thread and this function runs again when the file is ready.
    */
 
   DEBUGASSERT(aioc && aioc->aioc_aiocbp);
-  pid    = aioc->aioc_pid;
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  prio   = aioc->aioc_prio;
-#endif
-  aiocbp = aioc_decant(aioc);
+  aiocbp = aioc->aioc_aiocbp;
 
   /* Perform the file read using:
    *
-   *   aioc_filep   - File structure pointer
+   *   filep        - File structure pointer
    *   aio_buf      - Location of buffer
    *   aio_nbytes   - Length of transfer
    *   aio_offset   - File offset
    */
 
-  nread = file_pread(aioc->aioc_filep, (FAR void *)aiocbp->aio_buf,
-                     aiocbp->aio_nbytes, aiocbp->aio_offset);
+  memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = AIORING_OP_READ;
+  sqe.off    = aiocbp->aio_offset;
+  sqe.addr   = (FAR void *)aiocbp->aio_buf;
+  sqe.len    = aiocbp->aio_nbytes;
+
+  nread = aio_execute(aioc->aioc_filep, &sqe, &aioc->aioc_exec);
+  if (nread == -EINPROGRESS)
+    {
+      return;
+    }
+
+  pid = aioc->aioc_pid;
+  aioc_decant(aioc);
 
   /* Set the result of the read operation. */
 
@@ -106,12 +112,6 @@ static void aio_read_worker(FAR void *arg)
   /* Signal the client */
 
   aio_signal(pid, aiocbp);
-
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  /* Restore the low priority worker thread default priority */
-
-  lpwork_restorepriority(prio);
-#endif
 }
 
 /****************************************************************************
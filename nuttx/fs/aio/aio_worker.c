@@ -0,0 +1,221 @@
+/****************************************************************************
+ * fs/aio/aio_worker.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <nuttx/kthread.h>
+#include <nuttx/mutex.h>
+#include <nuttx/queue.h>
+#include <nuttx/semaphore.h>
+#include <nuttx/spinlock.h>
+
+#include "aio/aio.h"
+
+#ifdef CONFIG_FS_AIO
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* Work waiting for a worker thread, in submission order */
+
+static dq_queue_t g_aio_workq;
+static spinlock_t g_aio_worklock = SP_UNLOCKED;
+
+/* Counts the work in g_aio_workq (and the cancelled work that the worker
+ * threads will skip).
+ */
+
+static sem_t g_aio_worksem = SEM_INITIALIZER(0);
+
+/* Number of worker threads running, serialized by g_aio_startlock */
+
+static mutex_t g_aio_startlock = NXMUTEX_INITIALIZER;
+static int g_aio_nworkers;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: aio_worker_thread
+ *
+ * Description:
+ *   The worker threads run the work in the order it was queued.  Several
+ *   operations proceed in parallel, so that a slow device or a socket
+ *   waiting for data does not hold up the other operations.
+ *
+ ****************************************************************************/
+
+static int aio_worker_thread(int argc, FAR char *argv[])
+{
+  FAR struct aio_work_s *work;
+  irqstate_t flags;
+
+  for (; ; )
+    {
+      nxsem_wait_uninterruptible(&g_aio_worksem);
+
+      flags = spin_lock_irqsave(&g_aio_worklock);
+      work  = (FAR struct aio_work_s *)dq_remfirst(&g_aio_workq);
+      if (work != NULL)
+        {
+          work->queued = false;
+        }
+
+      spin_unlock_irqrestore(&g_aio_worklock, flags);
+
+      if (work != NULL)
+        {
+          work->worker(work->arg);
+        }
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: aio_worker_start
+ *
+ * Description:
+ *   Create the worker threads.  This is deferred to the first request,
+ *   aio_initialize() runs too early in the boot sequence.
+ *
+ ****************************************************************************/
+
+static int aio_worker_start(void)
+{
+  int ret;
+
+  ret = nxmutex_lock(&g_aio_startlock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  while (g_aio_nworkers < CONFIG_FS_AIO_NWORKERS)
+    {
+      ret = kthread_create("aio", CONFIG_FS_AIO_PRIORITY,
+                           CONFIG_FS_AIO_STACKSIZE,
+                           aio_worker_thread, NULL);
+      if (ret < 0)
+        {
+          ferr("ERROR: Failed to create an AIO worker: %d\n", ret);
+          break;
+        }
+
+      g_aio_nworkers++;
+    }
+
+  ret = g_aio_nworkers > 0 ? OK : ret;
+  nxmutex_unlock(&g_aio_startlock);
+  return ret;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: aio_work_queue
+ *
+ * Description:
+ *   Queue work to the AIO worker pool.  The worker threads are created by
+ *   the first call.
+ *
+ * Input Parameters:
+ *   work   - The work structure, unused until the worker has run
+ *   worker - The function run by a worker thread
+ *   arg    - The argument of the function
+ *
+ * Returned Value:
+ *   Zero (OK) on success; a negated errno value if the worker threads
+ *   could not be created.
+ *
+ ****************************************************************************/
+
+int aio_work_queue(FAR struct aio_work_s *work, worker_t worker,
+                   FAR void *arg)
+{
+  irqstate_t flags;
+  int ret;
+
+  DEBUGASSERT(work != NULL && worker != NULL);
+
+  if (g_aio_nworkers == 0)
+    {
+      ret = aio_worker_start();
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  work->worker = worker;
+  work->arg    = arg;
+
+  flags = spin_lock_irqsave(&g_aio_worklock);
+  work->queued = true;
+  dq_addlast(&work->link, &g_aio_workq);
+  spin_unlock_irqrestore(&g_aio_worklock, flags);
+
+  nxsem_post(&g_aio_worksem);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: aio_work_cancel
+ *
+ * Description:
+ *   Remove work from the AIO worker pool if no worker has taken it yet.
+ *
+ * Returned Value:
+ *   Zero (OK) if the work was removed; -ENOENT if it is running or done.
+ *
+ ****************************************************************************/
+
+int aio_work_cancel(FAR struct aio_work_s *work)
+{
+  irqstate_t flags;
+  int ret = -ENOENT;
+
+  flags = spin_lock_irqsave(&g_aio_worklock);
+  if (work->queued)
+    {
+      dq_rem(&work->link, &g_aio_workq);
+      work->queued = false;
+      ret = OK;
+    }
+
+  spin_unlock_irqrestore(&g_aio_worklock, flags);
+  return ret;
+}
+
+#endif /* CONFIG_FS_AIO */
@@ -65,28 +65,24 @@ static void aio_write_worker(FAR void *arg)
 {
   FAR struct aio_container_s *aioc = (FAR struct aio_container_s *)arg;
   FAR struct aiocb *aiocbp;
+  FAR struct file *filep;
+  struct aioring_sqe_s sqe;
   pid_t pid;
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  uint8_t prio;
-#endif
   ssize_t nwritten = 0;
   int oflags;
 
-  /* Get the information from the container, decant the AIO control block,
-   * and free the container before starting any I/O.  That will minimize
-   * the delays by any other threads waiting for a pre-allocated container.
+  /* The container holds the file and the state of the operation until the
+   * I/O is done: an operation that waits for its file lets go of the
+   * worker thread and this function runs again when the file is ready.
    */
 
   DEBUGASSERT(aioc && aioc->aioc_aiocbp);
-  pid    = aioc->aioc_pid;
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  prio   = aioc->aioc_prio;
-#endif
-  aiocbp = aioc_decant(aioc);
+  aiocbp = aioc->aioc_aiocbp;
+  filep  = aioc->aioc_filep;
 
   /* Call fcntl(F_GETFL) to get the file open mode. */
 
-  oflags = file_fcntl(aioc->aioc_filep, F_GETFL);
+  oflags = file_fcntl(filep, F_GETFL);
   if (oflags < 0)
     {
       ferr("ERROR: file_fcntl failed: %d\n", oflags);
@@ -96,28 +92,25 @@ static void aio_write_worker(FAR void *arg)
 
   /* Perform the write using:
    *
-   *   aioc_filep   - File structure pointer
+   *   filep        - File structure pointer
    *   aio_buf      - Location of buffer
    *   aio_nbytes   - Length of transfer
    *   aio_offset   - File offset
+   *
+   * If O_APPEND is set in the file open flags, append to the current file
+   * position instead.
    */
 
-  /* Check if O_APPEND is set in the file open flags */
-
-  if ((oflags & O_APPEND) != 0)
-    {
-      /* Append to the current file position */
+  memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = AIORING_OP_WRITE;
+  sqe.off    = (oflags & O_APPEND) != 0 ? -1 : aiocbp->aio_offset;
+  sqe.addr   = (FAR void *)aiocbp->aio_buf;
+  sqe.len    = aiocbp->aio_nbytes;
 
-      nwritten = file_write(aioc->aioc_filep,
-                            (FAR const void *)aiocbp->aio_buf,
-                            aiocbp->aio_nbytes);
-    }
-  else
+  nwritten = aio_execute(filep, &sqe, &aioc->aioc_exec);
+  if (nwritten == -EINPROGRESS)
     {
-      nwritten = file_pwrite(aioc->aioc_filep,
-                             (FAR const void *)aiocbp->aio_buf,
-                             aiocbp->aio_nbytes,
-                             aiocbp->aio_offset);
+      return;
     }
 
   if (nwritten < 0)
@@ -130,16 +123,12 @@ static void aio_write_worker(FAR void *arg)
   aiocbp->aio_result = nwritten;
 
 errout:
+  pid = aioc->aioc_pid;
+  aioc_decant(aioc);
 
   /* Signal the client */
 
   aio_signal(pid, aiocbp);
-
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  /* Restore the low priority worker thread default priority */
-
-  lpwork_restorepriority(prio);
-#endif
 }
 
 /****************************************************************************
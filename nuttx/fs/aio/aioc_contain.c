@@ -62,10 +62,6 @@ FAR struct aio_container_s *aio_contain(FAR struct aiocb *aiocbp)
 {
   FAR struct aio_container_s *aioc;
   FAR struct file *filep;
-
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  struct sched_param param;
-#endif
   int ret;
 
   /* Get the file structure corresponding to the file descriptor. */
@@ -95,11 +91,6 @@ FAR struct aio_container_s *aio_contain(FAR struct aiocb *aiocbp)
   aioc->aioc_filep  = filep;
   aioc->aioc_pid    = nxsched_getpid();
 
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  DEBUGVERIFY(nxsched_get_param(aioc->aioc_pid, &param));
-  aioc->aioc_prio   = param.sched_priority;
-#endif
-
   /* Add the container to the pending transfer list. */
 
   ret = aio_lock();
@@ -0,0 +1,746 @@
+/****************************************************************************
+ * fs/aio/aioring.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/aioring.h>
+#include <sys/param.h>
+#include <assert.h>
+#include <errno.h>
+#include <debug.h>
+#include <fcntl.h>
+#include <poll.h>
+
+#include <nuttx/fs/fs.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/mutex.h>
+#include <nuttx/nuttx.h>
+#include <nuttx/sched.h>
+#include <nuttx/semaphore.h>
+
+#include "aio/aio.h"
+#include "fs_heap.h"
+
+#ifdef CONFIG_FS_AIO_RING
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Number of threads that may poll() a ring at the same time */
+
+#define AIORING_NPOLLWAITERS 2
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct aioring_ctx_s;
+
+/* One submitted entry.  The first entry of a linked chain carries the
+ * work and the execution state of the whole chain.
+ */
+
+struct aioring_req_s
+{
+  struct aio_work_s work;            /* Queued to the AIO workers */
+  dq_entry_t link;                   /* In the list of running chains */
+  FAR struct aioring_req_s *next;    /* Next in the chain or free list */
+  FAR struct aioring_req_s *cur;     /* Entry of the chain being run */
+  FAR struct aioring_ctx_s *ctx;     /* The ring of the entry */
+  FAR struct file *filep;            /* The file of the operation */
+  struct aio_exec_s exec;            /* State of the chain being run */
+  struct aioring_sqe_s sqe;          /* Copy of the submission */
+  int res;                           /* Error of the submission */
+};
+
+/* The kernel side of a ring.  The application may write anything to the
+ * shared ring: The kernel only reads sq_tail and cq_head from it and keeps
+ * its own copy of the layout and of the indices it produces.
+ */
+
+struct aioring_ctx_s
+{
+  mutex_t lock;                      /* Protects everything below */
+  FAR struct aioring_s *ring;        /* Shared with the application */
+  FAR struct aioring_sqe_s *sqes;    /* Submission entries of the ring */
+  FAR struct aioring_cqe_s *cqes;    /* Completion entries of the ring */
+  uint32_t sq_mask;                  /* Number of submission entries - 1 */
+  uint32_t cq_mask;                  /* Number of completion entries - 1 */
+  uint32_t sq_head;                  /* Next entry consumed by the kernel */
+  uint32_t cq_tail;                  /* Next completion produced */
+  FAR struct fdlist *fdlist;         /* Descriptors of the owner */
+  FAR struct aioring_req_s *free;    /* Free request structures */
+  dq_queue_t running;                /* Chains submitted, not complete */
+  unsigned int inflight;             /* Requests not returned to free */
+  unsigned int nwaiters;             /* Threads waiting in aioring_enter */
+  sem_t waitsem;                     /* Wakes up the waiters */
+  sem_t closesem;                    /* Wakes up aioring_close() */
+  uint8_t crefs;                     /* Open count */
+  bool closing;                      /* Cancel everything */
+  FAR struct pollfd *fds[AIORING_NPOLLWAITERS];
+  struct aioring_req_s reqs[1];      /* One per completion entry */
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+static int aioring_open(FAR struct file *filep);
+static int aioring_close(FAR struct file *filep);
+static int aioring_poll(FAR struct file *filep, FAR struct pollfd *fds,
+                        bool setup);
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const struct file_operations g_aioring_fops =
+{
+  aioring_open,     /* open */
+  aioring_close,    /* close */
+  NULL,             /* read */
+  NULL,             /* write */
+  NULL,             /* seek */
+  NULL,             /* ioctl */
+  NULL,             /* mmap */
+  NULL,             /* truncate */
+  aioring_poll      /* poll */
+};
+
+static struct inode g_aioring_inode =
+{
+  NULL,                   /* i_parent */
+  NULL,                   /* i_peer */
+  NULL,                   /* i_child */
+  1,                      /* i_crefs */
+  FSNODEFLAG_TYPE_DRIVER, /* i_flags */
+  {
+    &g_aioring_fops       /* u */
+  }
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: aioring_ncqes
+ *
+ * Description:
+ *   Return the number of completions that the application has not reaped.
+ *   A cq_head that the application moved out of the queue counts as a
+ *   full queue.
+ *
+ ****************************************************************************/
+
+static inline uint32_t aioring_ncqes(FAR struct aioring_ctx_s *ctx)
+{
+  uint32_t head = __atomic_load_n(&ctx->ring->cq_head, __ATOMIC_ACQUIRE);
+
+  return MIN(ctx->cq_tail - head, ctx->cq_mask + 1);
+}
+
+/****************************************************************************
+ * Name: aioring_complete
+ *
+ * Description:
+ *   Post a completion.  Submission never lets the requests in flight and
+ *   the unreaped completions exceed the size of the completion queue, so
+ *   there is room unless the application moved cq_head back, in which
+ *   case it only loses its own completions.  Called with the ring locked.
+ *
+ ****************************************************************************/
+
+static void aioring_complete(FAR struct aioring_ctx_s *ctx,
+                             FAR struct aioring_req_s *req, int res)
+{
+  FAR struct aioring_cqe_s *cqe;
+  uint32_t tail = ctx->cq_tail;
+  int semcount;
+
+  cqe            = &ctx->cqes[tail & ctx->cq_mask];
+  cqe->user_data = req->sqe.user_data;
+  cqe->res       = res;
+  cqe->flags     = 0;
+
+  ctx->cq_tail = tail + 1;
+  __atomic_store_n(&ctx->ring->cq_tail, tail + 1, __ATOMIC_RELEASE);
+
+  poll_notify(ctx->fds, AIORING_NPOLLWAITERS, POLLIN);
+
+  nxsem_get_value(&ctx->waitsem, &semcount);
+  if (semcount < (int)ctx->nwaiters)
+    {
+      nxsem_post(&ctx->waitsem);
+    }
+}
+
+/****************************************************************************
+ * Name: aioring_worker
+ *
+ * Description:
+ *   Run a chain of linked entries on an AIO worker thread.  The entries
+ *   run in order; once an entry fails, the rest of the chain completes
+ *   with -ECANCELED.  An entry that waits for its file lets go of the
+ *   worker thread, the chain resumes from that entry when it is ready.
+ *
+ ****************************************************************************/
+
+static void aioring_worker(FAR void *arg)
+{
+  FAR struct aioring_req_s *head = arg;
+  FAR struct aioring_ctx_s *ctx = head->ctx;
+  FAR struct aioring_req_s *req;
+  FAR struct aioring_req_s *last;
+  unsigned int count = 0;
+  bool failed = false;
+  int res;
+
+  for (req = head->cur; req != NULL; req = req->next)
+    {
+      if (failed)
+        {
+          res = -ECANCELED;
+        }
+      else if (req->res < 0)
+        {
+          res = req->res;
+        }
+      else if (req->sqe.opcode == AIORING_OP_NOP)
+        {
+          res = head->exec.canceled ? -ECANCELED : 0;
+        }
+      else
+        {
+          res = aio_execute(req->filep, &req->sqe, &head->exec);
+          if (res == -EINPROGRESS)
+            {
+              head->cur = req;
+              return;
+            }
+        }
+
+      if (req->filep != NULL)
+        {
+          file_put(req->filep);
+          req->filep = NULL;
+        }
+
+      failed = res < 0;
+
+      nxmutex_lock(&ctx->lock);
+      aioring_complete(ctx, req, res);
+      nxmutex_unlock(&ctx->lock);
+    }
+
+  /* Return the chain to the free list only now, the execution state lives
+   * in its first entry.
+   */
+
+  for (last = head; ; last = last->next)
+    {
+      count++;
+      if (last->next == NULL)
+        {
+          break;
+        }
+    }
+
+  nxmutex_lock(&ctx->lock);
+  dq_rem(&head->link, &ctx->running);
+  last->next     = ctx->free;
+  ctx->free      = head;
+  ctx->inflight -= count;
+  if (ctx->closing && ctx->inflight == 0)
+    {
+      nxsem_post(&ctx->closesem);
+    }
+
+  nxmutex_unlock(&ctx->lock);
+}
+
+/****************************************************************************
+ * Name: aioring_submit
+ *
+ * Description:
+ *   Take up to 'to_submit' entries from the submission queue and queue
+ *   them to the AIO workers.  A linked chain is always submitted whole.
+ *   Called with the ring locked.
+ *
+ * Returned Value:
+ *   The number of entries submitted or a negated errno value if none could
+ *   be submitted.
+ *
+ ****************************************************************************/
+
+static int aioring_submit(FAR struct aioring_ctx_s *ctx,
+                          unsigned int to_submit)
+{
+  FAR struct aioring_s *ring = ctx->ring;
+  FAR struct aioring_req_s *head;
+  FAR struct aioring_req_s *req;
+  FAR struct aioring_req_s **tailp;
+  unsigned int submitted = 0;
+  uint32_t head_idx;
+  uint32_t tail_idx;
+  uint32_t count;
+  uint32_t i;
+  int ret = OK;
+
+  while (submitted < to_submit)
+    {
+      head_idx = ctx->sq_head;
+      tail_idx = __atomic_load_n(&ring->sq_tail, __ATOMIC_ACQUIRE);
+      if (head_idx == tail_idx)
+        {
+          break;
+        }
+
+      if (tail_idx - head_idx > ctx->sq_mask + 1)
+        {
+          ret = -EINVAL;
+          break;
+        }
+
+      /* Measure the chain that starts at the head of the queue */
+
+      count = 1;
+      while ((ctx->sqes[(head_idx + count - 1) & ctx->sq_mask].flags &
+              AIORING_SQE_LINK) != 0 && head_idx + count != tail_idx)
+        {
+          count++;
+        }
+
+      if (ctx->inflight + count + aioring_ncqes(ctx) > ctx->cq_mask + 1)
+        {
+          ret = -EBUSY;
+          break;
+        }
+
+      /* Copy the entries, take the references on their files */
+
+      head  = NULL;
+      tailp = &head;
+
+      for (i = 0; i < count; i++)
+        {
+          req        = ctx->free;
+          ctx->free  = req->next;
+          req->next  = NULL;
+          req->ctx   = ctx;
+          req->filep = NULL;
+          req->res   = OK;
+          req->sqe   = ctx->sqes[(head_idx + i) & ctx->sq_mask];
+
+          if (req->sqe.opcode != AIORING_OP_NOP)
+            {
+              req->res = file_get(req->sqe.fd, &req->filep);
+            }
+
+          *tailp = req;
+          tailp  = &req->next;
+        }
+
+      aio_exec_init(&head->exec, ctx->fdlist, &head->work);
+      head->cur = head;
+      dq_addlast(&head->link, &ctx->running);
+      ctx->inflight += count;
+
+      ctx->sq_head = head_idx + count;
+      __atomic_store_n(&ring->sq_head, ctx->sq_head, __ATOMIC_RELEASE);
+      submitted += count;
+
+      ret = aio_work_queue(&head->work, aioring_worker, head);
+      if (ret < 0)
+        {
+          /* Complete the chain here: the first entry with the error, the
+           * rest of the chain as cancelled.
+           */
+
+          ferr("ERROR: aio_work_queue failed: %d\n", ret);
+          head->res = ret;
+          nxmutex_unlock(&ctx->lock);
+          aioring_worker(head);
+          nxmutex_lock(&ctx->lock);
+          break;
+        }
+    }
+
+  return submitted > 0 ? (int)submitted : ret;
+}
+
+/****************************************************************************
+ * Name: aioring_open
+ ****************************************************************************/
+
+static int aioring_open(FAR struct file *filep)
+{
+  FAR struct aioring_ctx_s *ctx = filep->f_priv;
+  int ret;
+
+  ret = nxmutex_lock(&ctx->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (ctx->crefs >= 255)
+    {
+      ret = -EMFILE;
+    }
+  else
+    {
+      ctx->crefs++;
+    }
+
+  nxmutex_unlock(&ctx->lock);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: aioring_close
+ *
+ * Description:
+ *   Cancel the entries in flight, wait for the workers to let go of the
+ *   ring and free it.
+ *
+ ****************************************************************************/
+
+static int aioring_close(FAR struct file *filep)
+{
+  FAR struct aioring_ctx_s *ctx = filep->f_priv;
+  FAR struct aioring_req_s *head;
+  FAR dq_entry_t *entry;
+
+  nxmutex_lock(&ctx->lock);
+  if (--ctx->crefs > 0)
+    {
+      nxmutex_unlock(&ctx->lock);
+      return OK;
+    }
+
+  ctx->closing = true;
+
+restart:
+  for (entry = dq_peek(&ctx->running); entry != NULL; entry = dq_next(entry))
+    {
+      head = container_of(entry, struct aioring_req_s, link);
+      if (!head->exec.canceled && aio_exec_cancel(&head->exec) == OK)
+        {
+          /* Not started: complete it here, it frees itself */
+
+          nxmutex_unlock(&ctx->lock);
+          aioring_worker(head);
+          nxmutex_lock(&ctx->lock);
+          goto restart;
+        }
+    }
+
+  while (ctx->inflight > 0)
+    {
+      nxmutex_unlock(&ctx->lock);
+      nxsem_wait_uninterruptible(&ctx->closesem);
+      nxmutex_lock(&ctx->lock);
+    }
+
+  nxmutex_unlock(&ctx->lock);
+
+  kumm_free(ctx->ring);
+  nxsem_destroy(&ctx->closesem);
+  nxsem_destroy(&ctx->waitsem);
+  nxmutex_destroy(&ctx->lock);
+  fs_heap_free(ctx);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: aioring_poll
+ *
+ * Description:
+ *   The ring is readable while completions are waiting to be reaped.
+ *
+ ****************************************************************************/
+
+static int aioring_poll(FAR struct file *filep, FAR struct pollfd *fds,
+                        bool setup)
+{
+  FAR struct aioring_ctx_s *ctx = filep->f_priv;
+  int ret;
+  int i;
+
+  ret = nxmutex_lock(&ctx->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (!setup)
+    {
+      FAR struct pollfd **slot = (FAR struct pollfd **)fds->priv;
+
+      if (slot != NULL)
+        {
+          *slot     = NULL;
+          fds->priv = NULL;
+        }
+
+      goto out;
+    }
+
+  for (i = 0; i < AIORING_NPOLLWAITERS; i++)
+    {
+      if (ctx->fds[i] == NULL)
+        {
+          ctx->fds[i] = fds;
+          fds->priv   = &ctx->fds[i];
+          break;
+        }
+    }
+
+  if (i >= AIORING_NPOLLWAITERS)
+    {
+      fds->priv = NULL;
+      ret       = -EBUSY;
+      goto out;
+    }
+
+  if (aioring_ncqes(ctx) > 0)
+    {
+      poll_notify(&fds, 1, POLLIN);
+    }
+
+out:
+  nxmutex_unlock(&ctx->lock);
+  return ret;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: aioring_setup
+ *
+ * Description:
+ *   Create a ring with room for 'entries' submissions (rounded up to a
+ *   power of two) and twice as many completions.  The ring is allocated in
+ *   the memory of the caller and is valid until the returned descriptor is
+ *   closed.
+ *
+ * Returned Value:
+ *   The ring descriptor on success; -1 with errno set on failure.
+ *
+ ****************************************************************************/
+
+int aioring_setup(unsigned int entries, FAR struct aioring_s **ring)
+{
+  FAR struct aioring_ctx_s *ctx;
+  FAR struct aioring_s *shared;
+  unsigned int nsqes = 1;
+  unsigned int ncqes;
+  unsigned int i;
+  int ret;
+
+  if (entries == 0 || entries > AIORING_MAX_ENTRIES || ring == NULL)
+    {
+      ret = -EINVAL;
+      goto errout;
+    }
+
+  while (nsqes < entries)
+    {
+      nsqes <<= 1;
+    }
+
+  ncqes = 2 * nsqes;
+
+  /* The entries follow the ring header.  The sizes of the header and of
+   * the entries are multiples of 8 bytes, the alignment of user_data.
+   */
+
+  shared = kumm_zalloc(sizeof(struct aioring_s) +
+                       nsqes * sizeof(struct aioring_sqe_s) +
+                       ncqes * sizeof(struct aioring_cqe_s));
+  if (shared == NULL)
+    {
+      ret = -ENOMEM;
+      goto errout;
+    }
+
+  shared->sq_mask = nsqes - 1;
+  shared->cq_mask = ncqes - 1;
+  shared->sqes    = (FAR struct aioring_sqe_s *)(shared + 1);
+  shared->cqes    = (FAR struct aioring_cqe_s *)(shared->sqes + nsqes);
+
+  /* A request structure for every completion entry: the requests in
+   * flight never exceed the free completion entries.
+   */
+
+  ctx = fs_heap_zalloc(sizeof(struct aioring_ctx_s) +
+                       (ncqes - 1) * sizeof(struct aioring_req_s));
+  if (ctx == NULL)
+    {
+      ret = -ENOMEM;
+      goto errout_with_shared;
+    }
+
+  nxmutex_init(&ctx->lock);
+  nxsem_init(&ctx->waitsem, 0, 0);
+  nxsem_init(&ctx->closesem, 0, 0);
+  ctx->ring    = shared;
+  ctx->sqes    = shared->sqes;
+  ctx->cqes    = shared->cqes;
+  ctx->sq_mask = shared->sq_mask;
+  ctx->cq_mask = shared->cq_mask;
+  ctx->fdlist  = nxsched_get_fdlist();
+  ctx->crefs   = 1;
+
+  for (i = 0; i < ncqes; i++)
+    {
+      ctx->reqs[i].next = ctx->free;
+      ctx->free         = &ctx->reqs[i];
+    }
+
+  ret = file_allocate_from_inode(&g_aioring_inode, O_RDWR | O_CLOEXEC, 0,
+                                 ctx, 0);
+  if (ret < 0)
+    {
+      goto errout_with_ctx;
+    }
+
+  *ring = shared;
+  return ret;
+
+errout_with_ctx:
+  nxsem_destroy(&ctx->closesem);
+  nxsem_destroy(&ctx->waitsem);
+  nxmutex_destroy(&ctx->lock);
+  fs_heap_free(ctx);
+errout_with_shared:
+  kumm_free(shared);
+errout:
+  set_errno(-ret);
+  return ERROR;
+}
+
+/****************************************************************************
+ * Name: aioring_enter
+ *
+ * Description:
+ *   Queue up to 'to_submit' entries of the submission queue to the AIO
+ *   workers and, with AIORING_ENTER_GETEVENTS, wait until at least
+ *   'min_complete' completions can be reaped.
+ *
+ * Returned Value:
+ *   The number of entries submitted on success; -1 with errno set on
+ *   failure.  EBUSY means that no entry could be submitted because the
+ *   completion queue would overflow.
+ *
+ ****************************************************************************/
+
+int aioring_enter(int fd, unsigned int to_submit, unsigned int min_complete,
+                  unsigned int flags)
+{
+  FAR struct aioring_ctx_s *ctx;
+  FAR struct file *filep;
+  int submitted = 0;
+  int ret;
+
+  ret = file_get(fd, &filep);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  if (filep->f_inode != &g_aioring_inode ||
+      (flags & ~AIORING_ENTER_GETEVENTS) != 0)
+    {
+      ret = -EINVAL;
+      goto errout_with_filep;
+    }
+
+  ctx = filep->f_priv;
+  ret = nxmutex_lock(&ctx->lock);
+  if (ret < 0)
+    {
+      goto errout_with_filep;
+    }
+
+  if (to_submit > 0)
+    {
+      ret = aioring_submit(ctx, to_submit);
+      if (ret < 0)
+        {
+          goto errout_with_lock;
+        }
+
+      submitted = ret;
+    }
+
+  if ((flags & AIORING_ENTER_GETEVENTS) != 0)
+    {
+      /* Nothing to wait for if the completions cannot arrive */
+
+      if (min_complete > ctx->inflight + aioring_ncqes(ctx))
+        {
+          min_complete = ctx->inflight + aioring_ncqes(ctx);
+        }
+
+      while (aioring_ncqes(ctx) < min_complete)
+        {
+          ctx->nwaiters++;
+          nxmutex_unlock(&ctx->lock);
+          ret = nxsem_wait(&ctx->waitsem);
+          nxmutex_lock(&ctx->lock);
+          ctx->nwaiters--;
+
+          if (ret < 0)
+            {
+              goto errout_with_lock;
+            }
+        }
+    }
+
+  nxmutex_unlock(&ctx->lock);
+  file_put(filep);
+  return submitted;
+
+errout_with_lock:
+  nxmutex_unlock(&ctx->lock);
+errout_with_filep:
+  file_put(filep);
+  if (submitted > 0)
+    {
+      return submitted;
+    }
+
+errout:
+  set_errno(-ret);
+  return ERROR;
+}
+
+#endif /* CONFIG_FS_AIO_RING */
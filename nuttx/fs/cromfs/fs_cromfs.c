@@ -41,6 +41,9 @@
 #include <debug.h>
 
 #include <nuttx/kmalloc.h>
+#include <nuttx/mutex.h>
+#include <nuttx/queue.h>
+#include <nuttx/wqueue.h>
 #include <nuttx/fs/fs.h>
 #include <nuttx/fs/ioctl.h>
 
@@ -55,6 +58,20 @@
 
 #define CROMFS_MAX_LINKS 64
 
+#if CONFIG_FS_CROMFS_CACHE_NBLOCKS > 0
+#  define CROMFS_CBLOCK_SIZE(bsize) \
+     (sizeof(struct cromfs_cblock_s) - 1 + (bsize))
+#else
+#  define cromfs_cache_bind(fs)                 OK
+#  define cromfs_cache_unbind()
+#  define cromfs_cache_read(off, dest, pos, len) false
+#  define cromfs_cache_insert(fs, off, src, len)
+#endif
+
+#ifndef CONFIG_FS_CROMFS_PREFETCH
+#  define cromfs_prefetch(fs, hdr)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -74,7 +91,44 @@ struct cromfs_file_s
   uint32_t ff_offset;                       /* Cached block offset (zero means none) */
   uint16_t ff_ulen;                         /* Length of decompressed data in cache */
   FAR uint8_t *ff_buffer;                   /* Cached, decompressed data */
+  FAR const struct lzf_header_s *ff_blkhdr; /* Block of the previous read */
+  uint32_t ff_blkoffs;                      /* File offset of that block */
+  off_t ff_nextpos;                         /* Offset after the previous read */
+};
+
+#if CONFIG_FS_CROMFS_CACHE_NBLOCKS > 0
+/* One decompressed block in the cache.  Blocks are identified by the
+ * volume offset of their compressed data, which is unique for each block
+ * of each file and shared by the hard links to the file.
+ */
+
+struct cromfs_cblock_s
+{
+  dq_entry_t cb_lru;         /* Must be first: LRU list entry */
+  uint32_t cb_offset;        /* Compressed data offset (zero means none) */
+  uint16_t cb_ulen;          /* Length of the decompressed data */
+  uint8_t cb_data[1];        /* Decompressed data */
+};
+
+/* The decompressed block cache shared by all open files of all mounts */
+
+struct cromfs_cache_s
+{
+  mutex_t cc_lock;           /* Protects the cache, not held to decompress */
+  unsigned int cc_crefs;     /* Number of mounts */
+  dq_queue_t cc_lru;         /* Blocks, most recently used first */
+  FAR uint8_t *cc_blocks;    /* Memory of all blocks */
+#ifdef CONFIG_FS_CROMFS_PREFETCH
+  struct work_s cc_work;     /* Decompresses the prefetched block */
+
+  /* The block to prefetch */
+
+  FAR const struct lzf_header_s *cc_prefetch;
+  FAR uint8_t *cc_pfbuffer;  /* Decompression buffer of cc_work */
+  bool cc_pfbusy;            /* cc_work is queued or running */
+#endif
 };
+#endif
 
 /* This is the form of the callback from cromfs_foreach_node(): */
 
@@ -230,6 +284,13 @@ const struct mountpt_operations g_cromfs_operations =
 
 extern const struct cromfs_volume_s g_cromfs_image;
 
+#if CONFIG_FS_CROMFS_CACHE_NBLOCKS > 0
+static struct cromfs_cache_s g_cromfs_cache =
+{
+  NXMUTEX_INITIALIZER
+};
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -728,6 +789,316 @@ static int cromfs_find_node(FAR const struct cromfs_volume_s *fs,
     }
 }
 
+/****************************************************************************
+ * Name: cromfs_blkinfo
+ *
+ * Description:
+ *   Get the decompressed and compressed length of a block and return the
+ *   size of the block in the image.
+ *
+ ****************************************************************************/
+
+static uint32_t cromfs_blkinfo(FAR const struct lzf_header_s *hdr,
+                               FAR uint16_t *ulen, FAR uint16_t *clen)
+{
+  if (hdr->lzf_type == LZF_TYPE0_HDR)
+    {
+      FAR const struct lzf_type0_header_s *hdr0 =
+        (FAR const struct lzf_type0_header_s *)hdr;
+
+      *ulen = (uint16_t)hdr0->lzf_len[0] << 8 |
+              (uint16_t)hdr0->lzf_len[1];
+      *clen = *ulen;
+      return (uint32_t)*ulen + LZF_TYPE0_HDR_SIZE;
+    }
+  else
+    {
+      FAR const struct lzf_type1_header_s *hdr1 =
+        (FAR const struct lzf_type1_header_s *)hdr;
+
+      *ulen = (uint16_t)hdr1->lzf_ulen[0] << 8 |
+              (uint16_t)hdr1->lzf_ulen[1];
+      *clen = (uint16_t)hdr1->lzf_clen[0] << 8 |
+              (uint16_t)hdr1->lzf_clen[1];
+      return (uint32_t)*clen + LZF_TYPE1_HDR_SIZE;
+    }
+}
+
+#if CONFIG_FS_CROMFS_CACHE_NBLOCKS > 0
+
+/****************************************************************************
+ * Name: cromfs_cache_bind
+ *
+ * Description:
+ *   Take a reference to the block cache, allocating it on first use.
+ *
+ ****************************************************************************/
+
+static int cromfs_cache_bind(FAR const struct cromfs_volume_s *fs)
+{
+  FAR struct cromfs_cblock_s *cblock;
+  size_t size = CROMFS_CBLOCK_SIZE(fs->cv_bsize);
+  int ret;
+  int i;
+
+  ret = nxmutex_lock(&g_cromfs_cache.cc_lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (g_cromfs_cache.cc_blocks == NULL)
+    {
+      g_cromfs_cache.cc_blocks =
+        fs_heap_malloc(size * CONFIG_FS_CROMFS_CACHE_NBLOCKS);
+      if (g_cromfs_cache.cc_blocks == NULL)
+        {
+          nxmutex_unlock(&g_cromfs_cache.cc_lock);
+          return -ENOMEM;
+        }
+
+#ifdef CONFIG_FS_CROMFS_PREFETCH
+      g_cromfs_cache.cc_pfbuffer = fs_heap_malloc(fs->cv_bsize);
+      if (g_cromfs_cache.cc_pfbuffer == NULL)
+        {
+          fs_heap_free(g_cromfs_cache.cc_blocks);
+          g_cromfs_cache.cc_blocks = NULL;
+          nxmutex_unlock(&g_cromfs_cache.cc_lock);
+          return -ENOMEM;
+        }
+#endif
+
+      dq_init(&g_cromfs_cache.cc_lru);
+      for (i = 0; i < CONFIG_FS_CROMFS_CACHE_NBLOCKS; i++)
+        {
+          cblock = (FAR struct cromfs_cblock_s *)
+                   (g_cromfs_cache.cc_blocks + i * size);
+          cblock->cb_offset = 0;
+          dq_addlast(&cblock->cb_lru, &g_cromfs_cache.cc_lru);
+        }
+    }
+
+  g_cromfs_cache.cc_crefs++;
+  nxmutex_unlock(&g_cromfs_cache.cc_lock);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: cromfs_cache_unbind
+ *
+ * Description:
+ *   Drop a reference to the block cache, freeing it with the last one.
+ *
+ ****************************************************************************/
+
+static void cromfs_cache_unbind(void)
+{
+  nxmutex_lock(&g_cromfs_cache.cc_lock);
+  if (--g_cromfs_cache.cc_crefs > 0)
+    {
+      nxmutex_unlock(&g_cromfs_cache.cc_lock);
+      return;
+    }
+
+  nxmutex_unlock(&g_cromfs_cache.cc_lock);
+
+#ifdef CONFIG_FS_CROMFS_PREFETCH
+  /* The prefetch worker takes the lock */
+
+  work_cancel_sync(LPWORK, &g_cromfs_cache.cc_work);
+#endif
+
+  nxmutex_lock(&g_cromfs_cache.cc_lock);
+  if (g_cromfs_cache.cc_crefs == 0)
+    {
+      fs_heap_free(g_cromfs_cache.cc_blocks);
+      g_cromfs_cache.cc_blocks = NULL;
+#ifdef CONFIG_FS_CROMFS_PREFETCH
+      fs_heap_free(g_cromfs_cache.cc_pfbuffer);
+      g_cromfs_cache.cc_pfbuffer = NULL;
+      g_cromfs_cache.cc_pfbusy   = false;
+#endif
+    }
+
+  nxmutex_unlock(&g_cromfs_cache.cc_lock);
+}
+
+/****************************************************************************
+ * Name: cromfs_cache_find
+ *
+ * Description:
+ *   Find a block in the cache.  Called with the cache locked.
+ *
+ ****************************************************************************/
+
+static FAR struct cromfs_cblock_s *cromfs_cache_find(uint32_t offset)
+{
+  FAR dq_entry_t *entry;
+
+  for (entry = dq_peek(&g_cromfs_cache.cc_lru); entry != NULL;
+       entry = dq_next(entry))
+    {
+      FAR struct cromfs_cblock_s *cblock =
+        (FAR struct cromfs_cblock_s *)entry;
+
+      if (cblock->cb_offset == offset)
+        {
+          return cblock;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: cromfs_cache_read
+ *
+ * Description:
+ *   Copy part of a decompressed block from the cache.  Returns false if the
+ *   block is not cached.
+ *
+ ****************************************************************************/
+
+static bool cromfs_cache_read(uint32_t offset, FAR uint8_t *dest,
+                              unsigned int pos, unsigned int len)
+{
+  FAR struct cromfs_cblock_s *cblock;
+
+  if (nxmutex_lock(&g_cromfs_cache.cc_lock) < 0)
+    {
+      return false;
+    }
+
+  cblock = cromfs_cache_find(offset);
+  if (cblock != NULL)
+    {
+      DEBUGASSERT(cblock->cb_ulen >= pos + len);
+      memcpy(dest, &cblock->cb_data[pos], len);
+
+      dq_rem(&cblock->cb_lru, &g_cromfs_cache.cc_lru);
+      dq_addfirst(&cblock->cb_lru, &g_cromfs_cache.cc_lru);
+    }
+
+  nxmutex_unlock(&g_cromfs_cache.cc_lock);
+  return cblock != NULL;
+}
+
+/****************************************************************************
+ * Name: cromfs_cache_insert
+ *
+ * Description:
+ *   Add a decompressed block to the cache, replacing the least recently
+ *   used one.  The block may have been added meanwhile by another reader
+ *   that decompressed it at the same time.
+ *
+ ****************************************************************************/
+
+static void cromfs_cache_insert(FAR const struct cromfs_volume_s *fs,
+                                uint32_t offset, FAR const uint8_t *src,
+                                unsigned int len)
+{
+  FAR struct cromfs_cblock_s *cblock;
+
+  DEBUGASSERT(len <= fs->cv_bsize);
+
+  if (nxmutex_lock(&g_cromfs_cache.cc_lock) < 0)
+    {
+      return;
+    }
+
+  cblock = cromfs_cache_find(offset);
+  if (cblock == NULL)
+    {
+      cblock = (FAR struct cromfs_cblock_s *)
+               dq_tail(&g_cromfs_cache.cc_lru);
+      cblock->cb_offset = offset;
+      cblock->cb_ulen   = len;
+      memcpy(cblock->cb_data, src, len);
+    }
+
+  dq_rem(&cblock->cb_lru, &g_cromfs_cache.cc_lru);
+  dq_addfirst(&cblock->cb_lru, &g_cromfs_cache.cc_lru);
+  nxmutex_unlock(&g_cromfs_cache.cc_lock);
+}
+
+#ifdef CONFIG_FS_CROMFS_PREFETCH
+
+/****************************************************************************
+ * Name: cromfs_prefetch_worker
+ *
+ * Description:
+ *   Decompress the prefetched block into the cache.
+ *
+ ****************************************************************************/
+
+static void cromfs_prefetch_worker(FAR void *arg)
+{
+  FAR const struct cromfs_volume_s *fs = arg;
+  FAR const struct lzf_header_s *hdr;
+  FAR const uint8_t *src;
+  unsigned int decomplen;
+  uint32_t voloffs;
+  uint16_t ulen;
+  uint16_t clen;
+  bool cached;
+
+  nxmutex_lock(&g_cromfs_cache.cc_lock);
+  hdr     = g_cromfs_cache.cc_prefetch;
+  src     = (FAR const uint8_t *)hdr + LZF_TYPE1_HDR_SIZE;
+  voloffs = cromfs_addr2offset(fs, src);
+  cached  = cromfs_cache_find(voloffs) != NULL;
+  nxmutex_unlock(&g_cromfs_cache.cc_lock);
+
+  if (!cached)
+    {
+      cromfs_blkinfo(hdr, &ulen, &clen);
+      decomplen = lzf_decompress(src, clen, g_cromfs_cache.cc_pfbuffer,
+                                 fs->cv_bsize);
+      if (decomplen == ulen)
+        {
+          cromfs_cache_insert(fs, voloffs, g_cromfs_cache.cc_pfbuffer,
+                              decomplen);
+        }
+    }
+
+  nxmutex_lock(&g_cromfs_cache.cc_lock);
+  g_cromfs_cache.cc_pfbusy = false;
+  nxmutex_unlock(&g_cromfs_cache.cc_lock);
+}
+
+/****************************************************************************
+ * Name: cromfs_prefetch
+ *
+ * Description:
+ *   Start decompressing the block that a sequential reader will need next.
+ *   The request is dropped while a previous one is in progress, so there is
+ *   a single prefetch buffer even with several low priority workers.
+ *
+ ****************************************************************************/
+
+static void cromfs_prefetch(FAR const struct cromfs_volume_s *fs,
+                            FAR const struct lzf_header_s *hdr)
+{
+  if (hdr->lzf_type != LZF_TYPE1_HDR ||
+      nxmutex_lock(&g_cromfs_cache.cc_lock) < 0)
+    {
+      return;
+    }
+
+  if (!g_cromfs_cache.cc_pfbusy)
+    {
+      g_cromfs_cache.cc_pfbusy   = true;
+      g_cromfs_cache.cc_prefetch = hdr;
+      work_queue(LPWORK, &g_cromfs_cache.cc_work, cromfs_prefetch_worker,
+                 (FAR void *)fs, 0);
+    }
+
+  nxmutex_unlock(&g_cromfs_cache.cc_lock);
+}
+
+#endif /* CONFIG_FS_CROMFS_PREFETCH */
+#endif /* CONFIG_FS_CROMFS_CACHE_NBLOCKS > 0 */
+
 /****************************************************************************
  * Name: cromfs_open
  ****************************************************************************/
@@ -897,15 +1268,27 @@ static ssize_t cromfs_read(FAR struct file *filep, FAR char *buffer,
       buflen = ff->ff_node->cn_size - filep->f_pos;
     }
 
-  /* Find the compressed block containing the current offset, f_pos */
+  /* Find the compressed block containing the current offset, f_pos.
+   * Sequential reads continue from the block of the previous read rather
+   * than searching from the first block of the file.
+   */
 
   dest      = (FAR uint8_t *)buffer;
   remaining = buflen;
   fpos      = filep->f_pos;
-  blkoffs   = 0;
   ulen      = 0;
-  nexthdr   = (FAR struct lzf_header_s *)
-               cromfs_offset2addr(fs, ff->ff_node->u.cn_blocks);
+
+  if (ff->ff_blkhdr != NULL && fpos >= ff->ff_blkoffs)
+    {
+      nexthdr = (FAR struct lzf_header_s *)ff->ff_blkhdr;
+      blkoffs = ff->ff_blkoffs;
+    }
+  else
+    {
+      nexthdr = (FAR struct lzf_header_s *)
+                 cromfs_offset2addr(fs, ff->ff_node->u.cn_blocks);
+      blkoffs = 0;
+    }
 
   /* Look until we find the compressed block containing the start of the
    * requested data.
@@ -921,38 +1304,26 @@ static ssize_t cromfs_read(FAR struct file *filep, FAR char *buffer,
 
       do
         {
-          uint32_t blksize;
-
           /* Go to the next block */
 
           currhdr  = nexthdr;
           blkoffs += ulen;
+          nexthdr  = (FAR struct lzf_header_s *)
+                     ((FAR uint8_t *)currhdr +
+                      cromfs_blkinfo(currhdr, &ulen, &clen));
+        }
+      while (fpos >= (blkoffs + ulen));
 
-          if (currhdr->lzf_type == LZF_TYPE0_HDR)
-            {
-              FAR struct lzf_type0_header_s *hdr0 =
-                (FAR struct lzf_type0_header_s *)currhdr;
+      copyoffs = fpos - blkoffs;
+      DEBUGASSERT(ulen > copyoffs);
+      copysize = ulen - copyoffs;
 
-              ulen    = (uint16_t)hdr0->lzf_len[0] << 8 |
-                        (uint16_t)hdr0->lzf_len[1];
-              blksize = (uint32_t)ulen + LZF_TYPE0_HDR_SIZE;
-            }
-          else
-            {
-              FAR struct lzf_type1_header_s * hdr1 =
-                (FAR struct lzf_type1_header_s *)currhdr;
-
-              ulen    = (uint16_t)hdr1->lzf_ulen[0] << 8 |
-                        (uint16_t)hdr1->lzf_ulen[1];
-              clen    = (uint16_t)hdr1->lzf_clen[0] << 8 |
-                        (uint16_t)hdr1->lzf_clen[1];
-              blksize = (uint32_t)clen + LZF_TYPE1_HDR_SIZE;
-            }
+      if (copysize > remaining)
+        {
+          /* Clip to the size really needed */
 
-          nexthdr  = (FAR struct lzf_header_s *)
-                     ((FAR uint8_t *)currhdr + blksize);
+          copysize = remaining;
         }
-      while (fpos >= (blkoffs + ulen));
 
       /* Check if we need to decompress the next block into the user
        * buffer.
@@ -964,17 +1335,6 @@ static ssize_t cromfs_read(FAR struct file *filep, FAR char *buffer,
            * user buffer.
            */
 
-          copyoffs = (blkoffs >= filep->f_pos) ? 0 : filep->f_pos - blkoffs;
-          DEBUGASSERT(ulen > copyoffs);
-          copysize = ulen - copyoffs;
-
-          if (copysize > remaining)
-            {
-              /* Clip to the size really needed */
-
-              copysize = remaining;
-            }
-
           src = (FAR const uint8_t *)currhdr + LZF_TYPE0_HDR_SIZE;
           memcpy(dest, &src[copyoffs], copysize);
 
@@ -983,74 +1343,58 @@ static ssize_t cromfs_read(FAR struct file *filep, FAR char *buffer,
         }
       else
         {
-          /* If the source of the data is at the beginning of the compressed
-           * data buffer and if the uncompressed data would not overrun the
-           * buffer, then we can decompress directly into the user buffer.
-           */
+          uint32_t voloffs;
 
-          if (filep->f_pos <= blkoffs && ulen <= remaining)
-            {
-              uint32_t voloffs;
+          /* Get the address and offset in the CROMFS image to obtain the
+           * data.  Check if we already have this offset in the private
+           * buffer of the file or in the block cache shared by all files.
+           */
 
-              copyoffs = 0;
-              copysize = ulen;
+          src     = (FAR const uint8_t *)currhdr + LZF_TYPE1_HDR_SIZE;
+          voloffs = cromfs_addr2offset(fs, src);
 
-              /* Get the address and offset in the CROMFS image to obtain
-               * the data.  Check if we already have this offset in the
-               * cache.
-               */
+          if (voloffs == ff->ff_offset)
+            {
+              DEBUGASSERT(ff->ff_ulen >= (copyoffs + copysize));
+              memcpy(dest, &ff->ff_buffer[copyoffs], copysize);
+            }
+          else if (cromfs_cache_read(voloffs, dest, copyoffs, copysize))
+            {
+              finfo("voloffs=%" PRIu32 " cached\n", voloffs);
+            }
 
-              src     = (FAR const uint8_t *)currhdr + LZF_TYPE1_HDR_SIZE;
-              voloffs = cromfs_addr2offset(fs, src);
-              if (voloffs != ff->ff_offset)
-                {
-                  unsigned int decomplen;
+          /* If the whole block is wanted, then we can decompress directly
+           * into the user buffer.
+           */
 
-                  decomplen = lzf_decompress(src, clen, dest, fs->cv_bsize);
+          else if (copysize == ulen)
+            {
+              unsigned int decomplen;
 
-                  ff->ff_offset = voloffs;
-                  ff->ff_ulen   = decomplen;
-                }
+              decomplen = lzf_decompress(src, clen, dest, fs->cv_bsize);
+              DEBUGASSERT(decomplen >= copysize);
+              cromfs_cache_insert(fs, voloffs, dest, decomplen);
 
               finfo("voloffs=%" PRIu32 " blkoffs=%" PRIu32
-                    " ulen=%" PRIu16 " ff_offset=%" PRIu32 " copysize=%u\n",
-                    voloffs, blkoffs, ulen, ff->ff_offset, copysize);
-              DEBUGASSERT(ff->ff_ulen >= copysize);
+                    " ulen=%" PRIu16 " copysize=%u\n",
+                    voloffs, blkoffs, ulen, copysize);
             }
           else
             {
-              uint32_t voloffs;
+              unsigned int decomplen;
 
               /* No, we will need to decompress into the our intermediate
                * decompression buffer.
                */
 
-              copyoffs = (blkoffs >= filep->f_pos) ?
-                            0 : filep->f_pos - blkoffs;
-              DEBUGASSERT(ulen > copyoffs);
-              copysize = ulen - copyoffs;
-
-              if (copysize > remaining)
-                {
-                  /* Clip to the size really needed */
-
-                  copysize = remaining;
-                }
-
               DEBUGASSERT((copyoffs + copysize) <=  fs->cv_bsize);
 
-              src = (FAR const uint8_t *)currhdr + LZF_TYPE1_HDR_SIZE;
-              voloffs = cromfs_addr2offset(fs, src);
-              if (voloffs != ff->ff_offset)
-                {
-                  unsigned int decomplen;
+              decomplen = lzf_decompress(src, clen, ff->ff_buffer,
+                                         fs->cv_bsize);
 
-                  decomplen = lzf_decompress(src, clen, ff->ff_buffer,
-                                             fs->cv_bsize);
-
-                  ff->ff_offset = voloffs;
-                  ff->ff_ulen   = decomplen;
-                }
+              ff->ff_offset = voloffs;
+              ff->ff_ulen   = decomplen;
+              cromfs_cache_insert(fs, voloffs, ff->ff_buffer, decomplen);
 
               finfo("voloffs=%" PRIu32 " blkoffs=%" PRIu32 " ulen=%" PRIu16
                     " clen=%" PRIu16 " ff_offset=%" PRIu32
@@ -1072,6 +1416,21 @@ static ssize_t cromfs_read(FAR struct file *filep, FAR char *buffer,
       fpos      += copysize;
     }
 
+  if (buflen > 0)
+    {
+      /* Decompress the next block ahead of a sequential reader */
+
+      if (filep->f_pos == ff->ff_nextpos &&
+          blkoffs + ulen < ff->ff_node->cn_size)
+        {
+          cromfs_prefetch(fs, nexthdr);
+        }
+
+      ff->ff_blkhdr  = currhdr;
+      ff->ff_blkoffs = blkoffs;
+      ff->ff_nextpos = fpos;
+    }
+
   /* Update the file pointer */
 
   filep->f_pos = fpos;
@@ -1431,11 +1790,21 @@ static int cromfs_rewinddir(FAR struct inode *mountpt,
 static int cromfs_bind(FAR struct inode *blkdriver, FAR const void *data,
                        FAR void **handle)
 {
+  int ret;
+
   finfo("blkdriver: %p data: %p handle: %p\n", blkdriver, data, handle);
 
   DEBUGASSERT(blkdriver == NULL && handle != NULL);
   DEBUGASSERT(g_cromfs_image.cv_magic == CROMFS_MAGIC);
 
+  /* Take a reference to the decompressed block cache */
+
+  ret = cromfs_cache_bind(&g_cromfs_image);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
   /* Return the new file system handle */
 
   *handle = (FAR void *)&g_cromfs_image;
@@ -1455,6 +1824,8 @@ static int cromfs_unbind(FAR void *handle, FAR struct inode **blkdriver,
 {
   finfo("handle: %p blkdriver: %p flags: %02x\n",
         handle, blkdriver, flags);
+
+  cromfs_cache_unbind();
   return OK;
 }
 
@@ -0,0 +1,328 @@
+/****************************************************************************
+ * fs/driver/fs_blockrequest.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/ioctl.h>
+#include <nuttx/semaphore.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Largest chain built by a plug, in sectors */
+
+#define BLOCK_PLUG_MAXSECTORS  128
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: block_transfer
+ *
+ * Description:
+ *   Perform one request with the synchronous methods of the driver.
+ *
+ ****************************************************************************/
+
+static ssize_t block_transfer(FAR struct inode *inode,
+                              FAR struct block_request_s *req)
+{
+  FAR const struct block_operations *bops = inode->u.i_bops;
+
+  switch (req->op)
+    {
+      case BLOCK_REQ_READ:
+        return bops->read(inode, req->buffer, req->sector, req->nsectors);
+
+      case BLOCK_REQ_WRITE:
+        if (bops->write == NULL)
+          {
+            return -EACCES;
+          }
+
+        return bops->write(inode, req->buffer, req->sector, req->nsectors);
+
+      case BLOCK_REQ_FLUSH:
+        if (bops->ioctl == NULL)
+          {
+            return 0;
+          }
+
+        return bops->ioctl(inode, BIOC_FLUSH, 0);
+
+      default:
+        return -EINVAL;
+    }
+}
+
+/****************************************************************************
+ * Name: block_batch_done
+ ****************************************************************************/
+
+static void block_batch_done(FAR struct block_request_s *req)
+{
+  FAR struct block_batch_s *batch = req->priv;
+
+  if (req->result < 0 && batch->error == 0)
+    {
+      batch->error = req->result;
+    }
+  else if (req->result >= 0 && req->op != BLOCK_REQ_FLUSH &&
+           req->result != (ssize_t)req->nsectors && batch->error == 0)
+    {
+      batch->error = -EIO;
+    }
+
+  nxsem_post(&batch->done);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: block_submit
+ *
+ * Description:
+ *   Start a chain of block requests.
+ *
+ ****************************************************************************/
+
+int block_submit(FAR struct inode *inode, FAR struct block_request_s *req)
+{
+  FAR struct block_request_s *next;
+  ssize_t ret;
+  int error = OK;
+
+  DEBUGASSERT(inode != NULL && req != NULL);
+
+  if (inode->u.i_bops->submit != NULL)
+    {
+      ret = inode->u.i_bops->submit(inode, req);
+      if (ret >= 0)
+        {
+          return OK;
+        }
+
+      block_complete(req, UINT_MAX, ret);
+      return ret;
+    }
+
+  /* Without a submit method the chain is performed right away */
+
+  for (; req != NULL; req = next)
+    {
+      next        = req->merged;
+      ret         = block_transfer(inode, req);
+      req->result = ret;
+      if (ret < 0 && error == OK)
+        {
+          error = ret;
+        }
+
+      req->done(req);
+    }
+
+  return error;
+}
+
+/****************************************************************************
+ * Name: block_complete
+ *
+ * Description:
+ *   Complete 'count' requests of a chain starting with 'req'.
+ *
+ ****************************************************************************/
+
+void block_complete(FAR struct block_request_s *req, unsigned int count,
+                    int error)
+{
+  FAR struct block_request_s *next;
+
+  /* The callback may release the request, read the link first */
+
+  for (; req != NULL && count > 0; req = next, count--)
+    {
+      next        = req->merged;
+      req->result = error < 0 ? error :
+                    req->op == BLOCK_REQ_FLUSH ? 0 : req->nsectors;
+      req->done(req);
+    }
+}
+
+/****************************************************************************
+ * Name: block_plug_init
+ ****************************************************************************/
+
+void block_plug_init(FAR struct block_plug_s *plug, FAR struct inode *inode)
+{
+  plug->inode      = inode;
+  plug->head       = NULL;
+  plug->tail       = NULL;
+  plug->last       = NULL;
+  plug->nsectors   = 0;
+  plug->maxsectors = BLOCK_PLUG_MAXSECTORS;
+}
+
+/****************************************************************************
+ * Name: block_plug_add
+ *
+ * Description:
+ *   Add a request to a plug, merging it into the last chain if it
+ *   continues it.
+ *
+ ****************************************************************************/
+
+void block_plug_add(FAR struct block_plug_s *plug,
+                    FAR struct block_request_s *req)
+{
+  FAR struct block_request_s *last = plug->last;
+
+  req->flink  = NULL;
+  req->merged = NULL;
+
+  if (last != NULL && last->op == req->op && req->op != BLOCK_REQ_FLUSH &&
+      last->sector + last->nsectors == req->sector &&
+      plug->nsectors + req->nsectors <= plug->maxsectors)
+    {
+      last->merged    = req;
+      plug->last      = req;
+      plug->nsectors += req->nsectors;
+      return;
+    }
+
+  if (plug->tail != NULL)
+    {
+      plug->tail->flink = req;
+    }
+  else
+    {
+      plug->head = req;
+    }
+
+  plug->tail     = req;
+  plug->last     = req;
+  plug->nsectors = req->nsectors;
+}
+
+/****************************************************************************
+ * Name: block_plug_flush
+ *
+ * Description:
+ *   Submit all the chains of a plug in the order they were added.
+ *
+ ****************************************************************************/
+
+int block_plug_flush(FAR struct block_plug_s *plug)
+{
+  FAR struct block_request_s *req;
+  FAR struct block_request_s *next;
+  int error = OK;
+  int ret;
+
+  req            = plug->head;
+  plug->head     = NULL;
+  plug->tail     = NULL;
+  plug->last     = NULL;
+  plug->nsectors = 0;
+
+  for (; req != NULL; req = next)
+    {
+      next = req->flink;
+      ret  = block_submit(plug->inode, req);
+      if (ret < 0 && error == OK)
+        {
+          error = ret;
+        }
+    }
+
+  return error;
+}
+
+/****************************************************************************
+ * Name: block_batch_init
+ ****************************************************************************/
+
+void block_batch_init(FAR struct block_batch_s *batch,
+                      FAR struct inode *inode)
+{
+  block_plug_init(&batch->plug, inode);
+  nxsem_init(&batch->done, 0, 0);
+  batch->count = 0;
+  batch->error = OK;
+}
+
+/****************************************************************************
+ * Name: block_batch_add
+ ****************************************************************************/
+
+void block_batch_add(FAR struct block_batch_s *batch,
+                     FAR struct block_request_s *req, uint8_t op,
+                     FAR unsigned char *buffer, blkcnt_t sector,
+                     unsigned int nsectors)
+{
+  req->op       = op;
+  req->buffer   = buffer;
+  req->sector   = sector;
+  req->nsectors = nsectors;
+  req->done     = block_batch_done;
+  req->priv     = batch;
+
+  block_plug_add(&batch->plug, req);
+  batch->count++;
+}
+
+/****************************************************************************
+ * Name: block_batch_wait
+ *
+ * Description:
+ *   Submit the requests of a batch and wait for all of them.
+ *
+ ****************************************************************************/
+
+int block_batch_wait(FAR struct block_batch_s *batch)
+{
+  block_plug_flush(&batch->plug);
+
+  /* Every request is completed, also the ones that failed to start */
+
+  while (batch->count > 0)
+    {
+      nxsem_wait_uninterruptible(&batch->done);
+      batch->count--;
+    }
+
+  nxsem_destroy(&batch->done);
+  return batch->error;
+}
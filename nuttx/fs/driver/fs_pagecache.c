@@ -0,0 +1,1199 @@
+/****************************************************************************
+ * fs/driver/fs_pagecache.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/param.h>
+#include <sys/types.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <debug.h>
+
+#include <nuttx/clock.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/mutex.h>
+#include <nuttx/queue.h>
+#include <nuttx/semaphore.h>
+#include <nuttx/wqueue.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/pagecache.h>
+
+#ifdef CONFIG_FS_PAGECACHE
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Number of hash buckets, must be a power of two */
+
+#define PAGECACHE_NBUCKETS  64
+
+/* Allocation size of a page holding one sector of 'n' bytes */
+
+#define SIZEOF_PAGECACHE_PAGE_S(n) \
+  (sizeof(struct pagecache_page_s) - 1 + (n))
+
+#define SIZEOF_PAGECACHE_RA_S(n) \
+  (sizeof(struct pagecache_ra_s) - 1 + (n))
+
+/* Drivers with a submit method read ahead in the background and write
+ * back all the dirty runs of a device with one batch.
+ */
+
+#define PAGECACHE_ASYNC(dev) ((dev)->inode->u.i_bops->submit != NULL)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* A readahead in flight on a driver with a submit method */
+
+struct pagecache_ra_s
+{
+  struct block_request_s req;        /* The read request */
+  sem_t done;                        /* Posted on completion */
+  unsigned char data[1];             /* Sector data */
+};
+
+/* One block driver using the page cache */
+
+struct pagecache_dev_s
+{
+  FAR struct pagecache_dev_s *flink; /* Next device */
+  FAR struct inode *inode;           /* The block driver */
+  FAR struct pagecache_ra_s *ra;     /* Readahead in flight or NULL */
+  blkcnt_t nsectors;                 /* Size of the media in sectors */
+  blkcnt_t nextsector;               /* Sector following the previous read */
+  uint16_t sectorsize;               /* Size of one sector in bytes */
+  uint16_t window;                   /* Readahead window in sectors */
+  bool failed;                       /* A write back of this pass failed */
+  int error;                         /* Deferred write back error */
+};
+
+/* One cached sector */
+
+struct pagecache_page_s
+{
+  dq_entry_t lru;                     /* Must be first: LRU list entry */
+  FAR struct pagecache_page_s *hnext; /* Next page in the hash bucket */
+  FAR struct pagecache_dev_s *dev;    /* The device of the sector */
+  blkcnt_t sector;                    /* The sector in data[] */
+  bool dirty;                         /* Not yet written back */
+  bool writing;                       /* In a write back batch */
+  unsigned char data[1];              /* Sector data */
+};
+
+struct pagecache_s
+{
+  mutex_t lock;                     /* Protects everything, held during I/O */
+  dq_queue_t lru;                   /* Pages, most recently used first */
+  FAR struct pagecache_page_s *bucket[PAGECACHE_NBUCKETS];
+  FAR struct pagecache_dev_s *devs; /* Devices using the cache */
+  size_t used;                      /* Bytes of sector data */
+  size_t dirty;                     /* Bytes of dirty sector data */
+  struct work_s work;               /* Delayed write back */
+  struct pagecache_stats_s stats;   /* Statistics */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct pagecache_s g_pagecache =
+{
+  NXMUTEX_INITIALIZER
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: pagecache_hash
+ ****************************************************************************/
+
+static inline unsigned int
+pagecache_hash(FAR struct pagecache_dev_s *dev, blkcnt_t sector)
+{
+  uintptr_t key = (uintptr_t)dev / sizeof(uintptr_t) + (uintptr_t)sector;
+
+  return (key ^ (key >> 6)) & (PAGECACHE_NBUCKETS - 1);
+}
+
+/****************************************************************************
+ * Name: pagecache_getdev
+ *
+ * Description:
+ *   Find the state of a block driver, creating it if requested.  NULL is
+ *   returned if the driver cannot use the cache.
+ *
+ ****************************************************************************/
+
+static FAR struct pagecache_dev_s *
+pagecache_getdev(FAR struct inode *inode, bool create)
+{
+  FAR struct pagecache_dev_s *dev;
+  struct geometry geo;
+
+  for (dev = g_pagecache.devs; dev != NULL; dev = dev->flink)
+    {
+      if (dev->inode == inode)
+        {
+          return dev;
+        }
+    }
+
+  if (!create || inode->u.i_bops->geometry == NULL ||
+      inode->u.i_bops->geometry(inode, &geo) < 0 ||
+      geo.geo_sectorsize == 0 || geo.geo_sectorsize > UINT16_MAX ||
+      geo.geo_sectorsize > CONFIG_FS_PAGECACHE_SIZE)
+    {
+      return NULL;
+    }
+
+  dev = kmm_zalloc(sizeof(struct pagecache_dev_s));
+  if (dev != NULL)
+    {
+      dev->inode      = inode;
+      dev->nsectors   = geo.geo_nsectors;
+      dev->sectorsize = geo.geo_sectorsize;
+      dev->flink      = g_pagecache.devs;
+      g_pagecache.devs = dev;
+    }
+
+  return dev;
+}
+
+/****************************************************************************
+ * Name: pagecache_find
+ ****************************************************************************/
+
+static FAR struct pagecache_page_s *
+pagecache_find(FAR struct pagecache_dev_s *dev, blkcnt_t sector)
+{
+  FAR struct pagecache_page_s *page;
+
+  page = g_pagecache.bucket[pagecache_hash(dev, sector)];
+  while (page != NULL && (page->dev != dev || page->sector != sector))
+    {
+      page = page->hnext;
+    }
+
+  return page;
+}
+
+/****************************************************************************
+ * Name: pagecache_touch
+ *
+ * Description:
+ *   Make a page the most recently used one.
+ *
+ ****************************************************************************/
+
+static void pagecache_touch(FAR struct pagecache_page_s *page)
+{
+  dq_rem(&page->lru, &g_pagecache.lru);
+  dq_addfirst(&page->lru, &g_pagecache.lru);
+}
+
+/****************************************************************************
+ * Name: pagecache_remove
+ *
+ * Description:
+ *   Unlink a page from the cache and free it.  Dirty data is lost.
+ *
+ ****************************************************************************/
+
+static size_t pagecache_remove(FAR struct pagecache_page_s *page)
+{
+  FAR struct pagecache_page_s **link;
+  size_t sectorsize = page->dev->sectorsize;
+
+  link = &g_pagecache.bucket[pagecache_hash(page->dev, page->sector)];
+  while (*link != page)
+    {
+      link = &(*link)->hnext;
+    }
+
+  *link = page->hnext;
+  dq_rem(&page->lru, &g_pagecache.lru);
+
+  g_pagecache.used -= sectorsize;
+  if (page->dirty)
+    {
+      g_pagecache.dirty -= sectorsize;
+    }
+
+  kmm_free(page);
+  return SIZEOF_PAGECACHE_PAGE_S(sectorsize);
+}
+
+/****************************************************************************
+ * Name: pagecache_writerun
+ *
+ * Description:
+ *   Write back a dirty page together with the dirty pages of the adjacent
+ *   sectors, up to CONFIG_FS_PAGECACHE_CLUSTER sectors in one transfer.
+ *   The pages are clean afterwards only if the write succeeded.  Otherwise
+ *   they stay dirty for a later retry and the device is marked as failed
+ *   for the current pass.
+ *
+ * Returned Value:
+ *   Zero (OK) on success or a negated errno value if the write failed.
+ *
+ ****************************************************************************/
+
+static int pagecache_writerun(FAR struct pagecache_page_s *page)
+{
+  FAR struct pagecache_page_s *run[CONFIG_FS_PAGECACHE_CLUSTER];
+  FAR struct pagecache_dev_s *dev = page->dev;
+  FAR struct pagecache_page_s *prev;
+  FAR unsigned char *buffer = NULL;
+  size_t sectorsize = dev->sectorsize;
+  blkcnt_t start = page->sector;
+  unsigned int count;
+  unsigned int i;
+  ssize_t ret;
+
+  /* Find the start of the run, keeping 'page' inside of it */
+
+  for (count = 1; count < CONFIG_FS_PAGECACHE_CLUSTER && start > 0;
+       count++)
+    {
+      prev = pagecache_find(dev, start - 1);
+      if (prev == NULL || !prev->dirty)
+        {
+          break;
+        }
+
+      start--;
+    }
+
+  for (count = 0; count < CONFIG_FS_PAGECACHE_CLUSTER; count++)
+    {
+      run[count] = pagecache_find(dev, start + count);
+      if (run[count] == NULL || !run[count]->dirty)
+        {
+          break;
+        }
+    }
+
+  DEBUGASSERT(count > 0);
+
+  /* Gather the run in a bounce buffer.  Without memory, the first page is
+   * written alone and the others are left to the next pass.
+   */
+
+  if (count > 1)
+    {
+      buffer = kmm_malloc(count * sectorsize);
+      if (buffer == NULL)
+        {
+          count = 1;
+        }
+    }
+
+  if (buffer != NULL)
+    {
+      for (i = 0; i < count; i++)
+        {
+          memcpy(buffer + i * sectorsize, run[i]->data, sectorsize);
+        }
+
+      ret = dev->inode->u.i_bops->write(dev->inode, buffer, start, count);
+      kmm_free(buffer);
+    }
+  else
+    {
+      ret = dev->inode->u.i_bops->write(dev->inode, run[0]->data, start, 1);
+    }
+
+  if (ret >= 0 && ret != count)
+    {
+      ret = -EIO;
+    }
+
+  if (ret < 0)
+    {
+      ferr("ERROR: Write back of %u sectors at %" PRIuOFF " failed: %zd\n",
+           count, (off_t)start, ret);
+      dev->failed = true;
+      dev->error  = ret;
+      return ret;
+    }
+
+  for (i = 0; i < count; i++)
+    {
+      run[i]->dirty = false;
+    }
+
+  g_pagecache.dirty -= count * sectorsize;
+  g_pagecache.stats.writeback += count;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: pagecache_writebatch
+ *
+ * Description:
+ *   Write back all dirty pages of a device with one batch of requests, one
+ *   per page, so that the driver has all of them in flight at once.  The
+ *   pages of a run are added in sector order and merged by the plug.  The
+ *   page data is written in place: The lock is held until the batch is
+ *   done.  Only the pages of the requests that succeeded are clean
+ *   afterwards.  Without memory for the requests the pages are left to
+ *   pagecache_writerun().
+ *
+ ****************************************************************************/
+
+static void pagecache_writebatch(FAR struct pagecache_dev_s *dev)
+{
+  FAR struct block_request_s *reqs;
+  FAR struct pagecache_page_s *page;
+  FAR struct pagecache_page_s *prev;
+  struct block_batch_s batch;
+  FAR dq_entry_t *entry;
+  size_t sectorsize = dev->sectorsize;
+  size_t count = 0;
+  size_t done = 0;
+  size_t max;
+  size_t i;
+  blkcnt_t start;
+  int ret;
+
+  max  = g_pagecache.dirty / sectorsize;
+  reqs = max > 0 ? kmm_malloc(max * sizeof(struct block_request_s)) : NULL;
+  if (reqs == NULL)
+    {
+      return;
+    }
+
+  block_batch_init(&batch, dev->inode);
+
+  for (entry = dq_tail(&g_pagecache.lru); entry != NULL && count < max;
+       entry = dq_prev(entry))
+    {
+      page = (FAR struct pagecache_page_s *)entry;
+      if (!page->dirty || page->writing || page->dev != dev)
+        {
+          continue;
+        }
+
+      /* Start with the first page of the run */
+
+      for (start = page->sector; start > 0; start--)
+        {
+          prev = pagecache_find(dev, start - 1);
+          if (prev == NULL || !prev->dirty || prev->writing)
+            {
+              break;
+            }
+        }
+
+      while (count < max && (page = pagecache_find(dev, start)) != NULL &&
+             page->dirty && !page->writing)
+        {
+          block_batch_add(&batch, &reqs[count++], BLOCK_REQ_WRITE,
+                          page->data, start++, 1);
+          page->writing = true;
+        }
+    }
+
+  ret = block_batch_wait(&batch);
+
+  /* The pages of the failed requests stay dirty for a later retry */
+
+  for (i = 0; i < count; i++)
+    {
+      page = pagecache_find(dev, reqs[i].sector);
+      page->writing = false;
+      if (reqs[i].result == (ssize_t)reqs[i].nsectors)
+        {
+          page->dirty = false;
+          done++;
+        }
+    }
+
+  if (ret < 0)
+    {
+      ferr("ERROR: Write back of %zu sectors failed: %d\n",
+           count - done, ret);
+      dev->failed = true;
+      dev->error  = ret;
+    }
+
+  g_pagecache.dirty -= done * sectorsize;
+  g_pagecache.stats.writeback += done;
+
+  kmm_free(reqs);
+}
+
+/****************************************************************************
+ * Name: pagecache_writeback
+ *
+ * Description:
+ *   Write back the dirty pages of a device or of all devices if 'dev' is
+ *   NULL, the least recently used first.  A device whose write back fails
+ *   is not retried before the next pass.
+ *
+ ****************************************************************************/
+
+static void pagecache_writeback(FAR struct pagecache_dev_s *dev)
+{
+  FAR struct pagecache_dev_s *next;
+  FAR dq_entry_t *entry;
+
+  for (next = g_pagecache.devs; next != NULL; next = next->flink)
+    {
+      next->failed = false;
+      if ((dev == NULL || next == dev) && g_pagecache.dirty > 0 &&
+          PAGECACHE_ASYNC(next))
+        {
+          pagecache_writebatch(next);
+        }
+    }
+
+  /* The pages left are written run by run */
+
+  for (entry = dq_tail(&g_pagecache.lru);
+       entry != NULL && g_pagecache.dirty > 0;
+       entry = dq_prev(entry))
+    {
+      FAR struct pagecache_page_s *page =
+        (FAR struct pagecache_page_s *)entry;
+
+      if (page->dirty && !page->dev->failed &&
+          (dev == NULL || page->dev == dev))
+        {
+          pagecache_writerun(page);
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: pagecache_worker
+ *
+ * Description:
+ *   The flusher work item: Write back all dirty pages.
+ *
+ ****************************************************************************/
+
+static void pagecache_worker(FAR void *arg)
+{
+  if (nxmutex_lock(&g_pagecache.lock) >= 0)
+    {
+      pagecache_writeback(NULL);
+      nxmutex_unlock(&g_pagecache.lock);
+    }
+}
+
+/****************************************************************************
+ * Name: pagecache_reclaim
+ *
+ * Description:
+ *   Evict the least recently used pages until 'size' more bytes of sector
+ *   data fit in the budget.  Dirty pages are written back first, those
+ *   that cannot be written back are kept.
+ *
+ * Returned Value:
+ *   True if 'size' more bytes fit in the budget.
+ *
+ ****************************************************************************/
+
+static bool pagecache_reclaim(size_t size)
+{
+  FAR struct pagecache_page_s *page;
+  FAR struct pagecache_dev_s *dev;
+  FAR dq_entry_t *entry;
+  FAR dq_entry_t *prev;
+
+  for (dev = g_pagecache.devs; dev != NULL; dev = dev->flink)
+    {
+      dev->failed = false;
+    }
+
+  for (entry = dq_tail(&g_pagecache.lru);
+       entry != NULL && g_pagecache.used + size > CONFIG_FS_PAGECACHE_SIZE;
+       entry = prev)
+    {
+      prev = dq_prev(entry);
+      page = (FAR struct pagecache_page_s *)entry;
+
+      if (page->dirty &&
+          (page->dev->failed || pagecache_writerun(page) < 0))
+        {
+          continue;
+        }
+
+      pagecache_remove(page);
+      g_pagecache.stats.evictions++;
+    }
+
+  return g_pagecache.used + size <= CONFIG_FS_PAGECACHE_SIZE;
+}
+
+/****************************************************************************
+ * Name: pagecache_insert
+ *
+ * Description:
+ *   Add a page with the data of a sector that is not in the cache.  NULL
+ *   is returned if there is no memory for the page or if the cache is
+ *   full of pages that cannot be written back.
+ *
+ ****************************************************************************/
+
+static FAR struct pagecache_page_s *
+pagecache_insert(FAR struct pagecache_dev_s *dev, blkcnt_t sector,
+                 FAR const unsigned char *data)
+{
+  FAR struct pagecache_page_s *page;
+  unsigned int index;
+
+  if (!pagecache_reclaim(dev->sectorsize))
+    {
+      return NULL;
+    }
+
+  page = kmm_malloc(SIZEOF_PAGECACHE_PAGE_S(dev->sectorsize));
+  if (page == NULL)
+    {
+      return NULL;
+    }
+
+  page->dev     = dev;
+  page->sector  = sector;
+  page->dirty   = false;
+  page->writing = false;
+  memcpy(page->data, data, dev->sectorsize);
+
+  index = pagecache_hash(dev, sector);
+  page->hnext = g_pagecache.bucket[index];
+  g_pagecache.bucket[index] = page;
+
+  dq_addfirst(&page->lru, &g_pagecache.lru);
+  g_pagecache.used += dev->sectorsize;
+  return page;
+}
+
+/****************************************************************************
+ * Name: pagecache_fill
+ *
+ * Description:
+ *   Read 'count' missing sectors into 'buffer' and 'ra' more sectors ahead
+ *   of them, and add them all to the cache.
+ *
+ * Returned Value:
+ *   The number of sectors read into 'buffer' or a negated errno value.
+ *
+ ****************************************************************************/
+
+static ssize_t pagecache_fill(FAR struct pagecache_dev_s *dev,
+                              FAR unsigned char *buffer, blkcnt_t sector,
+                              unsigned int count, unsigned int ra)
+{
+  FAR struct inode *inode = dev->inode;
+  FAR unsigned char *iobuf = buffer;
+  size_t sectorsize = dev->sectorsize;
+  ssize_t nread;
+  ssize_t i;
+
+  /* Read the requested sectors and the readahead ones in one transfer */
+
+  if (ra > 0)
+    {
+      iobuf = kmm_malloc((count + ra) * sectorsize);
+      if (iobuf == NULL)
+        {
+          iobuf = buffer;
+          ra    = 0;
+        }
+    }
+
+  nread = inode->u.i_bops->read(inode, iobuf, sector, count + ra);
+  if (nread > 0)
+    {
+      for (i = 0; i < nread; i++)
+        {
+          pagecache_insert(dev, sector + i, iobuf + i * sectorsize);
+        }
+
+      if (nread > count)
+        {
+          g_pagecache.stats.readahead += nread - count;
+          nread = count;
+        }
+
+      g_pagecache.stats.misses += nread;
+    }
+
+  if (iobuf != buffer)
+    {
+      if (nread > 0)
+        {
+          memcpy(buffer, iobuf, nread * sectorsize);
+        }
+
+      kmm_free(iobuf);
+    }
+
+  return nread;
+}
+
+/****************************************************************************
+ * Name: pagecache_radone
+ *
+ * Description:
+ *   Completion of a readahead, possibly in an interrupt handler.  The data
+ *   is added to the cache by the next pagecache_reap().
+ *
+ ****************************************************************************/
+
+static void pagecache_radone(FAR struct block_request_s *req)
+{
+  nxsem_post(&((FAR struct pagecache_ra_s *)req)->done);
+}
+
+/****************************************************************************
+ * Name: pagecache_reap
+ *
+ * Description:
+ *   Add the sectors of a completed readahead to the cache, waiting for it
+ *   if requested.  Sectors cached meanwhile are newer and kept.
+ *
+ ****************************************************************************/
+
+static void pagecache_reap(FAR struct pagecache_dev_s *dev, bool wait)
+{
+  FAR struct pagecache_ra_s *ra = dev->ra;
+  ssize_t i;
+
+  if (ra == NULL)
+    {
+      return;
+    }
+
+  if (wait)
+    {
+      nxsem_wait_uninterruptible(&ra->done);
+    }
+  else if (nxsem_trywait(&ra->done) < 0)
+    {
+      return;
+    }
+
+  dev->ra = NULL;
+
+  for (i = 0; i < ra->req.result; i++)
+    {
+      if (pagecache_find(dev, ra->req.sector + i) == NULL &&
+          pagecache_insert(dev, ra->req.sector + i,
+                           ra->data + i * dev->sectorsize) != NULL)
+        {
+          g_pagecache.stats.readahead++;
+        }
+    }
+
+  nxsem_destroy(&ra->done);
+  kmm_free(ra);
+}
+
+/****************************************************************************
+ * Name: pagecache_inflight
+ *
+ * Description:
+ *   Return true if the readahead in flight covers one of the sectors
+ *   [sector, sector + nsectors).
+ *
+ ****************************************************************************/
+
+static bool pagecache_inflight(FAR struct pagecache_dev_s *dev,
+                               blkcnt_t sector, blkcnt_t nsectors)
+{
+  FAR struct pagecache_ra_s *ra = dev->ra;
+
+  return ra != NULL && ra->req.sector < sector + nsectors &&
+         sector < ra->req.sector + ra->req.nsectors;
+}
+
+/****************************************************************************
+ * Name: pagecache_prefetch
+ *
+ * Description:
+ *   Keep a readahead in flight in the window following a sequential read
+ *   that ended before 'sector', so that the reader finds the next sectors
+ *   in the cache instead of waiting for them.
+ *
+ ****************************************************************************/
+
+static void pagecache_prefetch(FAR struct pagecache_dev_s *dev,
+                               blkcnt_t sector)
+{
+  FAR struct pagecache_ra_s *ra;
+  blkcnt_t end = MIN(sector + dev->window, dev->nsectors);
+  unsigned int count;
+
+  pagecache_reap(dev, false);
+  if (dev->ra != NULL)
+    {
+      return;
+    }
+
+  /* Read the first run of missing sectors in the window */
+
+  while (sector < end && pagecache_find(dev, sector) != NULL)
+    {
+      sector++;
+    }
+
+  count = 0;
+  while (sector + count < end &&
+         pagecache_find(dev, sector + count) == NULL)
+    {
+      count++;
+    }
+
+  if (count == 0)
+    {
+      return;
+    }
+
+  /* The window keeps growing while the reader stays sequential */
+
+  dev->window = MIN(2 * dev->window, CONFIG_FS_PAGECACHE_CLUSTER);
+
+  ra = kmm_malloc(SIZEOF_PAGECACHE_RA_S(count * dev->sectorsize));
+  if (ra == NULL)
+    {
+      return;
+    }
+
+  nxsem_init(&ra->done, 0, 0);
+  ra->req.merged   = NULL;
+  ra->req.buffer   = ra->data;
+  ra->req.sector   = sector;
+  ra->req.nsectors = count;
+  ra->req.op       = BLOCK_REQ_READ;
+  ra->req.done     = pagecache_radone;
+  ra->req.priv     = dev;
+
+  /* A failed submit completes the request with the error */
+
+  dev->ra = ra;
+  block_submit(dev->inode, &ra->req);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: pagecache_read
+ *
+ * Description:
+ *   Read sectors of a block driver through the page cache.
+ *
+ ****************************************************************************/
+
+ssize_t pagecache_read(FAR struct inode *inode, FAR unsigned char *buffer,
+                       blkcnt_t start, unsigned int nsectors)
+{
+  FAR struct pagecache_page_s *page;
+  FAR struct pagecache_dev_s *dev;
+  unsigned int sectorsize;
+  unsigned int ra;
+  unsigned int i;
+  unsigned int j;
+  bool sequential;
+  ssize_t ret;
+
+  ret = nxmutex_lock(&g_pagecache.lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  dev = pagecache_getdev(inode, true);
+  if (dev == NULL)
+    {
+      nxmutex_unlock(&g_pagecache.lock);
+      return inode->u.i_bops->read(inode, buffer, start, nsectors);
+    }
+
+  sectorsize      = dev->sectorsize;
+  sequential      = start == dev->nextsector;
+  dev->nextsector = start + nsectors;
+
+  /* Add a completed readahead to the cache, wait for it if it holds
+   * sectors of this request.
+   */
+
+  pagecache_reap(dev, pagecache_inflight(dev, start, nsectors));
+
+  for (i = 0; i < nsectors; )
+    {
+      page = pagecache_find(dev, start + i);
+      if (page != NULL)
+        {
+          memcpy(buffer + i * sectorsize, page->data, sectorsize);
+          pagecache_touch(page);
+          g_pagecache.stats.hits++;
+          i++;
+          continue;
+        }
+
+      /* Read the whole run of missing sectors at once */
+
+      for (j = i + 1; j < nsectors; j++)
+        {
+          if (pagecache_find(dev, start + j) != NULL)
+            {
+              break;
+            }
+        }
+
+      /* Read ahead after the request.  The window doubles each time a
+       * sequential access misses and collapses on a random access.
+       */
+
+      ra = 0;
+      if (j == nsectors)
+        {
+          if (!sequential)
+            {
+              dev->window = 0;
+            }
+          else if (dev->window == 0)
+            {
+              dev->window = MIN(nsectors, CONFIG_FS_PAGECACHE_CLUSTER);
+            }
+          else
+            {
+              dev->window = MIN(2 * dev->window,
+                                CONFIG_FS_PAGECACHE_CLUSTER);
+            }
+
+          /* Drivers with a submit method read ahead in the background */
+
+          while (!PAGECACHE_ASYNC(dev) && ra < dev->window &&
+                 start + j + ra < dev->nsectors &&
+                 pagecache_find(dev, start + j + ra) == NULL)
+            {
+              ra++;
+            }
+        }
+
+      ret = pagecache_fill(dev, buffer + i * sectorsize, start + i, j - i,
+                           ra);
+      if (ret < 0)
+        {
+          ferr("ERROR: Read of %u sectors at %" PRIuOFF " failed: %zd\n",
+               j - i, (off_t)(start + i), ret);
+          break;
+        }
+
+      i += ret;
+      if (i < j)
+        {
+          break;
+        }
+    }
+
+  /* Read the window ahead in the background, also when the request was
+   * served from the cache.
+   */
+
+  if (PAGECACHE_ASYNC(dev) && sequential && i == nsectors)
+    {
+      pagecache_prefetch(dev, start + nsectors);
+    }
+
+  nxmutex_unlock(&g_pagecache.lock);
+  return i > 0 ? (ssize_t)i : ret;
+}
+
+/****************************************************************************
+ * Name: pagecache_write
+ *
+ * Description:
+ *   Write sectors of a block driver through the page cache.
+ *
+ ****************************************************************************/
+
+ssize_t pagecache_write(FAR struct inode *inode,
+                        FAR const unsigned char *buffer, blkcnt_t start,
+                        unsigned int nsectors)
+{
+  FAR struct pagecache_page_s *page;
+  FAR struct pagecache_dev_s *dev;
+  FAR const unsigned char *data;
+  unsigned int sectorsize;
+  unsigned int i;
+  ssize_t ret;
+
+  ret = nxmutex_lock(&g_pagecache.lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  dev = pagecache_getdev(inode, true);
+  if (dev == NULL)
+    {
+      nxmutex_unlock(&g_pagecache.lock);
+      return inode->u.i_bops->write(inode, buffer, start, nsectors);
+    }
+
+  /* A readahead of these sectors would bring back the old data */
+
+  if (pagecache_inflight(dev, start, nsectors))
+    {
+      pagecache_reap(dev, true);
+    }
+
+  sectorsize = dev->sectorsize;
+  for (i = 0; i < nsectors; i++)
+    {
+      data = buffer + i * sectorsize;
+      page = pagecache_find(dev, start + i);
+      if (page != NULL)
+        {
+          memcpy(page->data, data, sectorsize);
+          pagecache_touch(page);
+        }
+      else
+        {
+          page = pagecache_insert(dev, start + i, data);
+        }
+
+      if (page == NULL)
+        {
+          /* No memory for the page, write the sector through */
+
+          ret = inode->u.i_bops->write(inode, data, start + i, 1);
+          if (ret < 0)
+            {
+              break;
+            }
+        }
+      else if (!page->dirty)
+        {
+          page->dirty = true;
+          g_pagecache.dirty += sectorsize;
+        }
+    }
+
+  /* Throttle the writers when half of the cache is dirty, otherwise leave
+   * the write back to the flusher.
+   */
+
+  if (g_pagecache.dirty > CONFIG_FS_PAGECACHE_SIZE / 2)
+    {
+      pagecache_writeback(NULL);
+    }
+  else if (g_pagecache.dirty > 0 && work_available(&g_pagecache.work))
+    {
+      work_queue(LPWORK, &g_pagecache.work, pagecache_worker, NULL,
+                 MSEC2TICK(CONFIG_FS_PAGECACHE_FLUSH_DELAY));
+    }
+
+  nxmutex_unlock(&g_pagecache.lock);
+  return i > 0 ? (ssize_t)i : ret;
+}
+
+/****************************************************************************
+ * Name: pagecache_flush
+ *
+ * Description:
+ *   Write back all dirty sectors of a block driver.
+ *
+ ****************************************************************************/
+
+int pagecache_flush(FAR struct inode *inode)
+{
+  FAR struct pagecache_dev_s *dev;
+  int ret;
+
+  ret = nxmutex_lock(&g_pagecache.lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  dev = pagecache_getdev(inode, false);
+  if (dev != NULL)
+    {
+      /* Failed sectors are still dirty and retried: Only an error of this
+       * pass means that data did not reach the driver.
+       */
+
+      dev->error = OK;
+      pagecache_writeback(dev);
+      ret        = dev->error;
+      dev->error = OK;
+    }
+
+  nxmutex_unlock(&g_pagecache.lock);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: pagecache_invalidate
+ *
+ * Description:
+ *   Write back the dirty sectors of a block driver and forget all of its
+ *   sectors.
+ *
+ ****************************************************************************/
+
+int pagecache_invalidate(FAR struct inode *inode)
+{
+  FAR struct pagecache_dev_s **link;
+  FAR struct pagecache_dev_s *dev;
+  FAR dq_entry_t *entry;
+  FAR dq_entry_t *next;
+  size_t lost = 0;
+  int ret = OK;
+
+  nxmutex_lock(&g_pagecache.lock);
+
+  for (link = &g_pagecache.devs; (dev = *link) != NULL; link = &dev->flink)
+    {
+      if (dev->inode == inode)
+        {
+          break;
+        }
+    }
+
+  if (dev != NULL)
+    {
+      pagecache_reap(dev, true);
+
+      /* The sectors delayed for other users of the driver, e.g. a BCH
+       * character driver, must reach it before they are forgotten.
+       */
+
+      dev->error = OK;
+      pagecache_writeback(dev);
+      ret        = dev->error;
+
+      /* The driver is about to be closed: Sectors that could not be written
+       * back cannot be kept for a retry.
+       */
+
+      for (entry = dq_peek(&g_pagecache.lru); entry != NULL; entry = next)
+        {
+          FAR struct pagecache_page_s *page =
+            (FAR struct pagecache_page_s *)entry;
+
+          next = dq_next(entry);
+          if (page->dev == dev)
+            {
+              if (page->dirty)
+                {
+                  lost++;
+                }
+
+              pagecache_remove(page);
+            }
+        }
+
+      if (lost > 0)
+        {
+          ferr("ERROR: %zu sectors could not be written back: %d\n",
+               lost, ret);
+        }
+
+      *link = dev->flink;
+      kmm_free(dev);
+    }
+
+  nxmutex_unlock(&g_pagecache.lock);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: pagecache_shrink
+ *
+ * Description:
+ *   Release clean pages to the heap, the least recently used first.
+ *
+ ****************************************************************************/
+
+size_t pagecache_shrink(size_t size)
+{
+  FAR struct pagecache_page_s *page;
+  FAR dq_entry_t *entry;
+  FAR dq_entry_t *prev;
+  size_t freed = 0;
+
+  /* The cache may be the one allocating */
+
+  if (nxmutex_trylock(&g_pagecache.lock) < 0)
+    {
+      return 0;
+    }
+
+  for (entry = dq_tail(&g_pagecache.lru);
+       entry != NULL && freed < size; entry = prev)
+    {
+      prev = dq_prev(entry);
+      page = (FAR struct pagecache_page_s *)entry;
+      if (!page->dirty)
+        {
+          freed += pagecache_remove(page);
+          g_pagecache.stats.evictions++;
+        }
+    }
+
+  nxmutex_unlock(&g_pagecache.lock);
+  return freed;
+}
+
+/****************************************************************************
+ * Name: pagecache_stats
+ *
+ * Description:
+ *   Return a snapshot of the page cache statistics.
+ *
+ ****************************************************************************/
+
+void pagecache_stats(FAR struct pagecache_stats_s *stats)
+{
+  nxmutex_lock(&g_pagecache.lock);
+
+  *stats       = g_pagecache.stats;
+  stats->size  = CONFIG_FS_PAGECACHE_SIZE;
+  stats->used  = g_pagecache.used;
+  stats->dirty = g_pagecache.dirty;
+
+  nxmutex_unlock(&g_pagecache.lock);
+}
+
+#endif /* CONFIG_FS_PAGECACHE */
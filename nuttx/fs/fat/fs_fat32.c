@@ -26,6 +26,7 @@
 
 #include <nuttx/config.h>
 
+#include <sys/param.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/statfs.h>
@@ -42,6 +43,7 @@
 #include <nuttx/kmalloc.h>
 #include <nuttx/fs/fs.h>
 #include <nuttx/fs/fat.h>
+#include <nuttx/fs/pagecache.h>
 
 #include "inode/inode.h"
 #include "fs_fat32.h"
@@ -113,6 +115,9 @@ static int     fat_stat_root(FAR struct fat_mountpt_s *fs,
                  FAR struct stat *buf);
 static int     fat_stat(struct inode *mountpt, const char *relpath,
                  FAR struct stat *buf);
+#ifdef CONFIG_FS_PAGECACHE
+static int     fat_syncfs(FAR struct inode *mountpt);
+#endif
 
 /****************************************************************************
  * Public Data
@@ -156,7 +161,13 @@ const struct mountpt_operations g_fat_operations =
   fat_rmdir,         /* rmdir */
   fat_rename,        /* rename */
   fat_stat,          /* stat */
-  NULL               /* chstat */
+  NULL,              /* chstat */
+#ifdef CONFIG_FS_PAGECACHE
+  fat_syncfs,        /* syncfs */
+#else
+  NULL,              /* syncfs */
+#endif
+  MNTPT_FLAG_DCACHE  /* flags */
 };
 
 /****************************************************************************
@@ -553,6 +564,73 @@ out:
   return ret;
 }
 
+/****************************************************************************
+ * Name: fat_extent_lookup
+ *
+ * Description:
+ *   Return the media cluster of the file cluster 'index' if it lies in one
+ *   of the runs of contiguous clusters remembered for the file, or zero if
+ *   it is unknown.
+ *
+ ****************************************************************************/
+
+static uint32_t fat_extent_lookup(FAR struct fat_file_s *ff, uint32_t index)
+{
+  if (index - ff->ff_extent.fe_index < ff->ff_extent.fe_length)
+    {
+      return ff->ff_extent.fe_cluster + (index - ff->ff_extent.fe_index);
+    }
+
+  if (index - ff->ff_run.fe_index < ff->ff_run.fe_length)
+    {
+      return ff->ff_run.fe_cluster + (index - ff->ff_run.fe_index);
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: fat_extent_track
+ *
+ * Description:
+ *   Record that the file cluster 'index' is the media cluster 'cluster'.
+ *   Consecutive clusters extend the current run; the longest run seen is
+ *   kept so that later seeks can skip it without walking the FAT.
+ *
+ ****************************************************************************/
+
+static void fat_extent_track(FAR struct fat_file_s *ff, uint32_t index,
+                             uint32_t cluster)
+{
+  FAR struct fat_extent_s *run = &ff->ff_run;
+
+  if (index - run->fe_index < run->fe_length &&
+      cluster - run->fe_cluster == index - run->fe_index)
+    {
+      /* Already known */
+
+      return;
+    }
+
+  if (run->fe_length > 0 &&
+      index == run->fe_index + run->fe_length &&
+      cluster == run->fe_cluster + run->fe_length)
+    {
+      run->fe_length++;
+    }
+  else
+    {
+      run->fe_index   = index;
+      run->fe_cluster = cluster;
+      run->fe_length  = 1;
+    }
+
+  if (run->fe_length > ff->ff_extent.fe_length)
+    {
+      ff->ff_extent = *run;
+    }
+}
+
 /****************************************************************************
  * Name: fat_get_sectors
  *
@@ -620,6 +698,20 @@ static int fat_get_sectors(FAR struct file *filep, bool read)
       num_traversed = 1;
     }
 
+  /* Skip the part of the chain that is known to be contiguous */
+
+  if (num_traversed > 0)
+    {
+      fat_extent_track(ff, num_traversed - 1, cluster);
+
+      i = MIN(num_clu, new_num_clu) - 1;
+      if (i >= num_traversed && fat_extent_lookup(ff, i) != 0)
+        {
+          cluster = fat_extent_lookup(ff, i);
+          num_traversed = i + 1;
+        }
+    }
+
   /* Traverse the existing chain */
 
   for (i = num_traversed; i < num_clu && i < new_num_clu; i++)
@@ -632,6 +724,8 @@ static int fat_get_sectors(FAR struct file *filep, bool read)
         {
           return -EIO;
         }
+
+      fat_extent_track(ff, i, cluster);
     }
 
   if (read)
@@ -684,6 +778,8 @@ static int fat_get_sectors(FAR struct file *filep, bool read)
           return -EIO;
         }
 
+      fat_extent_track(ff, i, cluster);
+
       /* zero area (2) */
 
       ret = fat_zero_cluster(fs, cluster, 0, clu_size);
@@ -707,6 +803,8 @@ static int fat_get_sectors(FAR struct file *filep, bool read)
           return -EIO;
         }
 
+      fat_extent_track(ff, i, cluster);
+
       /* zero area (3) */
 
       zero_end = filep->f_pos & (clu_size -1);
@@ -1492,6 +1590,15 @@ static int fat_sync(FAR struct file *filep)
       ret          = fat_updatefsinfo(fs);
     }
 
+#ifdef CONFIG_FS_PAGECACHE
+  /* Write back the sectors delayed by the page cache */
+
+  if (ret >= 0)
+    {
+      ret = pagecache_flush(fs->fs_blkdriver);
+    }
+#endif
+
 errout_with_lock:
   nxmutex_unlock(&fs->fs_lock);
   return ret;
@@ -1599,6 +1706,8 @@ static int fat_dup(FAR const struct file *oldp, FAR struct file *newp)
   newff->ff_startcluster     = oldff->ff_startcluster;     /* Start cluster of file on media */
   newff->ff_currentsector    = oldff->ff_currentsector;    /* Current sector */
   newff->ff_cachesector      = 0;                          /* Sector in file buffer */
+  newff->ff_extent           = oldff->ff_extent;           /* Longest contiguous run */
+  newff->ff_run              = oldff->ff_run;              /* Run of the last access */
 
   /* Attach the private date to the struct file instance */
 
@@ -1914,6 +2023,13 @@ static int fat_truncate(FAR struct file *filep, off_t length)
       ndx      = (ff->ff_dirindex & DIRSEC_NDXMASK(fs)) * DIR_SIZE;
       direntry = &fs->fs_buffer[ndx];
 
+      /* The clusters past the new end of the file are released, forget
+       * the runs of clusters remembered for the file.
+       */
+
+      memset(&ff->ff_extent, 0, sizeof(struct fat_extent_s));
+      memset(&ff->ff_run, 0, sizeof(struct fat_extent_s));
+
       /* Handle the simple case where we are shrinking the file to zero
        * length.
        */
@@ -2333,6 +2449,14 @@ static int fat_unbind(FAR void *handle, FAR struct inode **blkdriver,
       FAR struct inode *inode = fs->fs_blkdriver;
       if (inode)
         {
+#ifdef CONFIG_FS_PAGECACHE
+          /* Write back the sectors delayed by the page cache.  They are
+           * forgotten by fat_release() below.
+           */
+
+          pagecache_flush(inode);
+#endif
+
           if (inode->u.i_bops && inode->u.i_bops->close)
             {
               inode->u.i_bops->close(inode);
@@ -2353,10 +2477,7 @@ static int fat_unbind(FAR void *handle, FAR struct inode **blkdriver,
 
   /* Release the mountpoint private data */
 
-  if (fs->fs_buffer)
-    {
-      fat_io_free(fs->fs_buffer, fs->fs_hwsectorsize);
-    }
+  fat_release(fs);
 
   nxmutex_destroy(&fs->fs_lock);
   fs_heap_free(fs);
@@ -3092,6 +3213,62 @@ errout_with_lock:
   return ret;
 }
 
+/****************************************************************************
+ * Name: fat_syncfs
+ *
+ * Description: Write back the buffered data of all open files, the FSINFO
+ *   sector and the sectors delayed by the page cache.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_PAGECACHE
+static int fat_syncfs(FAR struct inode *mountpt)
+{
+  FAR struct fat_mountpt_s *fs;
+  FAR struct fat_file_s *ff;
+  int ret;
+
+  /* Sanity checks */
+
+  DEBUGASSERT(mountpt && mountpt->i_private);
+
+  /* Get the mountpoint private data from the inode structure */
+
+  fs = mountpt->i_private;
+
+  ret = nxmutex_lock(&fs->fs_lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = fat_checkmount(fs);
+  if (ret != OK)
+    {
+      goto errout_with_lock;
+    }
+
+  for (ff = fs->fs_head; ff != NULL; ff = ff->ff_next)
+    {
+      ret = fat_ffcacheflush(fs, ff);
+      if (ret < 0)
+        {
+          goto errout_with_lock;
+        }
+    }
+
+  ret = fat_updatefsinfo(fs);
+  if (ret >= 0)
+    {
+      ret = pagecache_flush(fs->fs_blkdriver);
+    }
+
+errout_with_lock:
+  nxmutex_unlock(&fs->fs_lock);
+  return ret;
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
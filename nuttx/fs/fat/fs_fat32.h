@@ -857,6 +857,18 @@
  * Public Types
  ****************************************************************************/
 
+/* One entry of the mountpoint sector cache.  The cache holds clean copies
+ * of the FAT and directory sectors most recently read into fs_buffer.
+ */
+
+#if CONFIG_FAT_SECTOR_CACHE > 0
+struct fat_sectcache_s
+{
+  off_t    sc_sector;              /* Cached sector number or -1 if unused */
+  uint32_t sc_age;                 /* Value of fs_cacheage at the last access */
+};
+#endif
+
 /* This structure represents the overall mountpoint state.  An instance of
  * this structure is retained as inode private data on each mountpoint that
  * is mounted with a fat32 filesystem.
@@ -891,6 +903,26 @@ struct fat_mountpt_s
   uint8_t  fs_fatsecperclus;       /* MBR: Sectors per allocation unit: 2**n, n=0..7 */
   uint8_t *fs_buffer;              /* This is an allocated buffer to hold one
                                     * sector from the device */
+#if CONFIG_FAT_SECTOR_CACHE > 0
+  FAR struct fat_sectcache_s *fs_cache; /* Sector cache entries */
+  FAR uint8_t *fs_cachebuffer;     /* Sector cache data, one sector per entry */
+  uint32_t fs_cacheage;            /* LRU clock of the sector cache */
+#endif
+#ifdef CONFIG_FAT_FREE_BITMAP
+  FAR uint32_t *fs_freemap;        /* One bit per cluster, set if in use */
+#endif
+};
+
+/* A run of clusters of a file that are contiguous on the media:  file
+ * clusters fe_index .. fe_index + fe_length - 1 are the media clusters
+ * fe_cluster .. fe_cluster + fe_length - 1.
+ */
+
+struct fat_extent_s
+{
+  uint32_t fe_index;               /* Index of the first cluster in the file */
+  uint32_t fe_cluster;             /* Media cluster number of that cluster */
+  uint32_t fe_length;              /* Number of clusters, zero if unknown */
 };
 
 /* This structure represents on open file under the mountpoint.  An instance
@@ -912,6 +944,8 @@ struct fat_file_s
   off_t    ff_currentsector;       /* Current sector being operated on */
   off_t    ff_cachesector;         /* Current sector in the file buffer */
   off_t    ff_pos;                 /* Current position in the file */
+  struct fat_extent_s ff_extent;   /* Longest contiguous run seen so far */
+  struct fat_extent_s ff_run;      /* Run being followed by the last access */
   uint8_t *ff_buffer;              /* File buffer (for partial sector accesses) */
 };
 
@@ -1032,6 +1066,7 @@ EXTERN time_t fat_fattime2systime(uint16_t fattime, uint16_t fatdate);
 
 EXTERN int    fat_mount(FAR struct fat_mountpt_s *fs, bool writeable);
 EXTERN int    fat_checkmount(FAR struct fat_mountpt_s *fs);
+EXTERN void   fat_release(FAR struct fat_mountpt_s *fs);
 
 /* low-level hardware access */
 
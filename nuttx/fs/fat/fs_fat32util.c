@@ -40,6 +40,7 @@
 #include <nuttx/kmalloc.h>
 #include <nuttx/fs/fs.h>
 #include <nuttx/fs/fat.h>
+#include <nuttx/fs/pagecache.h>
 
 #include "inode/inode.h"
 #include "fs_fat32.h"
@@ -270,6 +271,276 @@ static int fat_checkbootrecord(struct fat_mountpt_s *fs)
   return OK;
 }
 
+/****************************************************************************
+ * Name: fat_cachelookup
+ *
+ * Description:
+ *   Return the cached copy of a sector or NULL if the sector is not in the
+ *   sector cache.
+ *
+ ****************************************************************************/
+
+#if CONFIG_FAT_SECTOR_CACHE > 0
+static FAR uint8_t *fat_cachelookup(FAR struct fat_mountpt_s *fs,
+                                    off_t sector)
+{
+  int i;
+
+  if (fs->fs_cache != NULL)
+    {
+      for (i = 0; i < CONFIG_FAT_SECTOR_CACHE; i++)
+        {
+          if (fs->fs_cache[i].sc_sector == sector)
+            {
+              fs->fs_cache[i].sc_age = ++fs->fs_cacheage;
+              return fs->fs_cachebuffer + i * fs->fs_hwsectorsize;
+            }
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: fat_cacheinsert
+ *
+ * Description:
+ *   Save a copy of a sector that was just read from the media, replacing
+ *   the least recently used entry of the sector cache.
+ *
+ ****************************************************************************/
+
+static void fat_cacheinsert(FAR struct fat_mountpt_s *fs, off_t sector,
+                            FAR const uint8_t *buffer)
+{
+  FAR struct fat_sectcache_s *entry;
+  uint32_t oldest = 0;
+  int victim = 0;
+  int i;
+
+  if (fs->fs_cache == NULL)
+    {
+      return;
+    }
+
+  for (i = 0; i < CONFIG_FAT_SECTOR_CACHE; i++)
+    {
+      entry = &fs->fs_cache[i];
+      if (entry->sc_sector < 0)
+        {
+          victim = i;
+          break;
+        }
+
+      /* Compare the ages relative to the clock to survive the wrap-around */
+
+      if (fs->fs_cacheage - entry->sc_age > oldest)
+        {
+          oldest = fs->fs_cacheage - entry->sc_age;
+          victim = i;
+        }
+    }
+
+  entry            = &fs->fs_cache[victim];
+  entry->sc_sector = sector;
+  entry->sc_age    = ++fs->fs_cacheage;
+  memcpy(fs->fs_cachebuffer + victim * fs->fs_hwsectorsize, buffer,
+         fs->fs_hwsectorsize);
+}
+
+/****************************************************************************
+ * Name: fat_cacheupdate
+ *
+ * Description:
+ *   Keep the cached copies of sectors that were just written to the media
+ *   in sync with the media.
+ *
+ ****************************************************************************/
+
+static void fat_cacheupdate(FAR struct fat_mountpt_s *fs,
+                            FAR const uint8_t *buffer, off_t sector,
+                            unsigned int nsectors)
+{
+  FAR struct fat_sectcache_s *entry;
+  int i;
+
+  if (fs->fs_cache == NULL)
+    {
+      return;
+    }
+
+  for (i = 0; i < CONFIG_FAT_SECTOR_CACHE; i++)
+    {
+      entry = &fs->fs_cache[i];
+      if (entry->sc_sector >= sector &&
+          entry->sc_sector < sector + nsectors)
+        {
+          memcpy(fs->fs_cachebuffer + i * fs->fs_hwsectorsize,
+                 buffer + (entry->sc_sector - sector) * fs->fs_hwsectorsize,
+                 fs->fs_hwsectorsize);
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: fat_cachealloc
+ *
+ * Description:
+ *   Allocate the sector cache when the volume is mounted.  The cache is
+ *   only an optimization:  if there is not enough memory, the volume is
+ *   used without it.
+ *
+ ****************************************************************************/
+
+static void fat_cachealloc(FAR struct fat_mountpt_s *fs)
+{
+  int i;
+
+  fs->fs_cache = fs_heap_malloc(CONFIG_FAT_SECTOR_CACHE *
+                                sizeof(struct fat_sectcache_s));
+  fs->fs_cachebuffer = fs_heap_malloc(CONFIG_FAT_SECTOR_CACHE *
+                                      fs->fs_hwsectorsize);
+  if (fs->fs_cache == NULL || fs->fs_cachebuffer == NULL)
+    {
+      fwarn("WARNING: No memory for the sector cache\n");
+      fs_heap_free(fs->fs_cache);
+      fs_heap_free(fs->fs_cachebuffer);
+      fs->fs_cache       = NULL;
+      fs->fs_cachebuffer = NULL;
+      return;
+    }
+
+  for (i = 0; i < CONFIG_FAT_SECTOR_CACHE; i++)
+    {
+      fs->fs_cache[i].sc_sector = -1;
+      fs->fs_cache[i].sc_age    = 0;
+    }
+}
+#endif
+
+/****************************************************************************
+ * Name: fat_freemapupdate
+ *
+ * Description:
+ *   Mark a cluster as used or free in the free-cluster bitmap.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FAT_FREE_BITMAP
+static void fat_freemapupdate(FAR struct fat_mountpt_s *fs,
+                              uint32_t cluster, bool used)
+{
+  if (fs->fs_freemap != NULL && cluster >= 2 &&
+      cluster < fs->fs_nclusters + 2)
+    {
+      cluster -= 2;
+      if (used)
+        {
+          fs->fs_freemap[cluster >> 5] |= (uint32_t)1 << (cluster & 31);
+        }
+      else
+        {
+          fs->fs_freemap[cluster >> 5] &= ~((uint32_t)1 << (cluster & 31));
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: fat_freemapbuild
+ *
+ * Description:
+ *   Build the free-cluster bitmap with one pass over the FAT the first time
+ *   that a cluster has to be allocated.  The free cluster count of FSINFO
+ *   is refreshed by the same pass.
+ *
+ * Returned Value:
+ *   Zero (OK) if the bitmap is available, a negated errno value otherwise.
+ *
+ ****************************************************************************/
+
+static int fat_freemapbuild(FAR struct fat_mountpt_s *fs)
+{
+  uint32_t nfreeclusters = 0;
+  uint32_t cluster;
+  off_t next;
+
+  if (fs->fs_freemap != NULL)
+    {
+      return OK;
+    }
+
+  fs->fs_freemap = fs_heap_zalloc(((fs->fs_nclusters + 31) >> 5) *
+                                  sizeof(uint32_t));
+  if (fs->fs_freemap == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  for (cluster = 2; cluster < fs->fs_nclusters + 2; cluster++)
+    {
+      next = fat_getcluster(fs, cluster);
+      if (next < 0)
+        {
+          fs_heap_free(fs->fs_freemap);
+          fs->fs_freemap = NULL;
+          return (int)next;
+        }
+
+      if (next != 0)
+        {
+          fat_freemapupdate(fs, cluster, true);
+        }
+      else
+        {
+          nfreeclusters++;
+        }
+    }
+
+  if (fs->fs_fsifreecount != nfreeclusters)
+    {
+      fs->fs_fsifreecount = nfreeclusters;
+      if (fs->fs_type == FSTYPE_FAT32)
+        {
+          fs->fs_fsidirty = true;
+        }
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: fat_freemapsearch
+ *
+ * Description:
+ *   Return the first free cluster in the range [first, last) of the
+ *   free-cluster bitmap or zero if there is none.  Fully used words of the
+ *   bitmap are skipped 32 clusters at a time.
+ *
+ ****************************************************************************/
+
+static uint32_t fat_freemapsearch(FAR struct fat_mountpt_s *fs,
+                                  uint32_t first, uint32_t last)
+{
+  uint32_t bit;
+
+  for (bit = first - 2; bit < last - 2; bit++)
+    {
+      if ((bit & 31) == 0 && fs->fs_freemap[bit >> 5] == UINT32_MAX)
+        {
+          bit += 31;
+          continue;
+        }
+
+      if ((fs->fs_freemap[bit >> 5] & ((uint32_t)1 << (bit & 31))) == 0)
+        {
+          return bit + 2;
+        }
+    }
+
+  return 0;
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -520,6 +791,12 @@ int fat_mount(struct fat_mountpt_s *fs, bool writeable)
       goto errout;
     }
 
+#if CONFIG_FAT_SECTOR_CACHE > 0
+  /* Allocate the cache of FAT and directory sectors */
+
+  fat_cachealloc(fs);
+#endif
+
   /* Search FAT boot record on the drive.  First check the MBR at sector
    * zero.  This could be either the boot record or a partition that refers
    * to the boot record.
@@ -658,14 +935,56 @@ int fat_mount(struct fat_mountpt_s *fs, bool writeable)
   return OK;
 
 errout_with_buffer:
-  fat_io_free(fs->fs_buffer, fs->fs_hwsectorsize);
-  fs->fs_buffer = NULL;
+  fat_release(fs);
 
 errout:
   fs->fs_mounted = false;
   return ret;
 }
 
+/****************************************************************************
+ * Name: fat_release
+ *
+ * Description:
+ *   Free the buffers allocated for the mountpoint.  This is called when the
+ *   volume is unmounted.
+ *
+ ****************************************************************************/
+
+void fat_release(FAR struct fat_mountpt_s *fs)
+{
+#ifdef CONFIG_FS_PAGECACHE
+  if (fs->fs_blkdriver && pagecache_invalidate(fs->fs_blkdriver) < 0)
+    {
+      ferr("ERROR: Failed to write back the cached sectors\n");
+    }
+#endif
+
+  if (fs->fs_buffer)
+    {
+      fat_io_free(fs->fs_buffer, fs->fs_hwsectorsize);
+      fs->fs_buffer = NULL;
+    }
+
+#if CONFIG_FAT_SECTOR_CACHE > 0
+  if (fs->fs_cache)
+    {
+      fs_heap_free(fs->fs_cache);
+      fs_heap_free(fs->fs_cachebuffer);
+      fs->fs_cache       = NULL;
+      fs->fs_cachebuffer = NULL;
+    }
+#endif
+
+#ifdef CONFIG_FAT_FREE_BITMAP
+  if (fs->fs_freemap)
+    {
+      fs_heap_free(fs->fs_freemap);
+      fs->fs_freemap = NULL;
+    }
+#endif
+}
+
 /****************************************************************************
  * Name: fat_checkmount
  *
@@ -703,9 +1022,24 @@ int fat_checkmount(struct fat_mountpt_s *fs)
             }
         }
 
-      /* If we get here, the mount is NOT healthy */
+      /* If we get here, the mount is NOT healthy.  Names cached as missing
+       * may exist on the new media.
+       */
 
       fs->fs_mounted = false;
+      inode_dcache_invalidate();
+
+#ifdef CONFIG_FS_PAGECACHE
+      /* The cached sectors may belong to another media.  The delayed ones
+       * are written back first, they may belong to another user of the
+       * driver.
+       */
+
+      if (fs->fs_blkdriver && pagecache_invalidate(fs->fs_blkdriver) < 0)
+        {
+          ferr("ERROR: Failed to write back the cached sectors\n");
+        }
+#endif
     }
 
   return -ENODEV;
@@ -728,8 +1062,13 @@ int fat_hwread(struct fat_mountpt_s *fs, uint8_t *buffer,  off_t sector,
       struct inode *inode = fs->fs_blkdriver;
       if (inode && inode->u.i_bops && inode->u.i_bops->read)
         {
+#ifdef CONFIG_FS_PAGECACHE
+          ssize_t nsectorsread = pagecache_read(inode, buffer, sector,
+                                                nsectors);
+#else
           ssize_t nsectorsread = inode->u.i_bops->read(inode, buffer,
                                                        sector, nsectors);
+#endif
           if (nsectorsread == nsectors)
             {
               ret = OK;
@@ -761,8 +1100,13 @@ int fat_hwwrite(struct fat_mountpt_s *fs, uint8_t *buffer, off_t sector,
       struct inode *inode = fs->fs_blkdriver;
       if (inode && inode->u.i_bops && inode->u.i_bops->write)
         {
+#ifdef CONFIG_FS_PAGECACHE
+          ssize_t nsectorswritten =
+              pagecache_write(inode, buffer, sector, nsectors);
+#else
           ssize_t nsectorswritten =
               inode->u.i_bops->write(inode, buffer, sector, nsectors);
+#endif
 
           if (nsectorswritten == nsectors)
             {
@@ -772,6 +1116,15 @@ int fat_hwwrite(struct fat_mountpt_s *fs, uint8_t *buffer, off_t sector,
             {
               ret = nsectorswritten;
             }
+
+#if CONFIG_FAT_SECTOR_CACHE > 0
+          /* Keep the cached copies of the sectors in sync with the media */
+
+          if (nsectorswritten > 0)
+            {
+              fat_cacheupdate(fs, buffer, sector, nsectorswritten);
+            }
+#endif
         }
     }
 
@@ -1103,6 +1456,9 @@ int fat_putcluster(struct fat_mountpt_s *fs, uint32_t clusterno,
       /* Mark the modified sector as "dirty" and return success */
 
       fs->fs_dirty = true;
+#ifdef CONFIG_FAT_FREE_BITMAP
+      fat_freemapupdate(fs, clusterno, nextcluster != 0);
+#endif
       return OK;
     }
 
@@ -1226,6 +1582,29 @@ int32_t fat_extendchain(struct fat_mountpt_s *fs, uint32_t cluster)
       startcluster = cluster;
     }
 
+#ifdef CONFIG_FAT_FREE_BITMAP
+  /* Search the free-cluster bitmap if it is available:  First from the
+   * start cluster to the end of the FAT, then from the beginning of the
+   * FAT back to the start cluster.
+   */
+
+  if (fat_freemapbuild(fs) == OK)
+    {
+      newcluster = fat_freemapsearch(fs, startcluster + 1,
+                                     fs->fs_nclusters + 2);
+      if (newcluster == 0)
+        {
+          newcluster = fat_freemapsearch(fs, 2, startcluster + 1);
+          if (newcluster == 0)
+            {
+              return 0;
+            }
+        }
+
+      goto found;
+    }
+#endif
+
   /* Loop until (1) we discover that there are not free clusters
    * (return 0), an errors occurs (return -errno), or (3) we find
    * the next cluster (return the new cluster number).
@@ -1288,6 +1667,9 @@ int32_t fat_extendchain(struct fat_mountpt_s *fs, uint32_t cluster)
    * number in 'newcluster'  Now mark that cluster as in-use.
    */
 
+#ifdef CONFIG_FAT_FREE_BITMAP
+found:
+#endif
   ret = fat_putcluster(fs, newcluster, 0x0fffffff);
   if (ret < 0)
     {
@@ -1817,12 +2199,17 @@ int fat_fscacheflush(struct fat_mountpt_s *fs)
  *
  * Description:
  *   Read the specified sector into the sector cache, flushing any existing
- *   dirty sectors as necessary.
+ *   dirty sectors as necessary.  With CONFIG_FAT_SECTOR_CACHE, recently
+ *   used sectors are copied from the mountpoint sector cache instead of
+ *   being read from the media again.
  *
  ****************************************************************************/
 
 int fat_fscacheread(struct fat_mountpt_s *fs, off_t sector)
 {
+#if CONFIG_FAT_SECTOR_CACHE > 0
+  FAR uint8_t *cached;
+#endif
   int ret;
 
   /* fs->fs_currentsector holds the current sector that is buffered in
@@ -1844,10 +2231,24 @@ int fat_fscacheread(struct fat_mountpt_s *fs, off_t sector)
 
       /* Then read the specified sector into the cache */
 
-      ret = fat_hwread(fs, fs->fs_buffer, sector, 1);
-      if (ret < 0)
+#if CONFIG_FAT_SECTOR_CACHE > 0
+      cached = fat_cachelookup(fs, sector);
+      if (cached != NULL)
         {
-          return ret;
+          memcpy(fs->fs_buffer, cached, fs->fs_hwsectorsize);
+        }
+      else
+#endif
+        {
+          ret = fat_hwread(fs, fs->fs_buffer, sector, 1);
+          if (ret < 0)
+            {
+              return ret;
+            }
+
+#if CONFIG_FAT_SECTOR_CACHE > 0
+          fat_cacheinsert(fs, sector, fs->fs_buffer);
+#endif
         }
 
       /* Update the cached sector number */
@@ -26,6 +26,7 @@
 
 #include <nuttx/config.h>
 
+#include <sys/param.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/statfs.h>
@@ -40,6 +41,7 @@
 
 #include <nuttx/lib/lib.h>
 #include <nuttx/mutex.h>
+#include <nuttx/semaphore.h>
 #include <nuttx/fs/fs.h>
 #include <nuttx/fs/fat.h>
 #include <nuttx/fs/ioctl.h>
@@ -63,8 +65,26 @@ struct hostfs_dir_s
 {
   struct fs_dirent_s base;
   FAR void *dir;
+  mutex_t lock;                  /* Serializes readdir and rewinddir */
+#ifdef CONFIG_FS_HOSTFS_ASYNC
+  int nentries;                  /* Number of entries in the batch */
+  int next;                      /* Next entry returned from the batch */
+  struct dirent entries[CONFIG_FS_HOSTFS_DIR_BATCH];
+#endif
 };
 
+#ifdef CONFIG_FS_HOSTFS_ASYNC
+/* A request performed by the host I/O threads and the semaphore its
+ * caller waits on.
+ */
+
+struct hostfs_aio_s
+{
+  struct host_aio_s aio;
+  sem_t sem;
+};
+#endif
+
 /****************************************************************************
  * Private Function Prototypes
  ****************************************************************************/
@@ -240,6 +260,333 @@ static void hostfs_mkpath(FAR struct hostfs_mountpt_s  *fs,
     }
 }
 
+#ifdef CONFIG_FS_HOSTFS_ASYNC
+
+/****************************************************************************
+ * Name: hostfs_aio_done
+ *
+ * Description: Wake up the thread waiting for a request, called from the
+ *   interrupt raised by the host I/O threads.
+ *
+ ****************************************************************************/
+
+static void hostfs_aio_done(FAR struct host_aio_s *aio)
+{
+  FAR struct hostfs_aio_s *req = (FAR struct hostfs_aio_s *)aio;
+
+  nxsem_post(&req->sem);
+}
+
+/****************************************************************************
+ * Name: hostfs_aio
+ *
+ * Description: Perform a request in the host I/O threads.  Only the
+ *   calling thread waits for it, the rest of the system keeps running
+ *   while the host blocks.
+ *
+ ****************************************************************************/
+
+static int64_t hostfs_aio(FAR struct hostfs_aio_s *req)
+{
+  int ret;
+
+  nxsem_init(&req->sem, 0, 0);
+  req->aio.done = hostfs_aio_done;
+
+  ret = host_aio_submit(&req->aio);
+  if (ret >= 0)
+    {
+      /* The host writes to the request, it must outlive the wait */
+
+      nxsem_wait_uninterruptible(&req->sem);
+    }
+
+  nxsem_destroy(&req->sem);
+  return ret < 0 ? ret : req->aio.result;
+}
+#endif
+
+/****************************************************************************
+ * Name: hostfs_host_open
+ ****************************************************************************/
+
+static int hostfs_host_open(FAR const char *path, int oflags, mode_t mode)
+{
+#ifdef CONFIG_FS_HOSTFS_ASYNC
+  struct hostfs_aio_s req;
+
+  memset(&req, 0, sizeof(req));
+  req.aio.op    = HOST_AIO_OPEN;
+  req.aio.path  = path;
+  req.aio.flags = oflags;
+  req.aio.mode  = mode;
+  return hostfs_aio(&req);
+#else
+  return host_open(path, oflags, mode);
+#endif
+}
+
+/****************************************************************************
+ * Name: hostfs_pread
+ *
+ * Description: Read from a position of the host file.  The synchronous
+ *   host interface has no pread(), the host position is tracked to seek
+ *   only when it differs.
+ *
+ ****************************************************************************/
+
+static ssize_t hostfs_pread(FAR struct hostfs_ofile_s *hf, FAR void *buf,
+                            size_t len, off_t pos)
+{
+#ifdef CONFIG_FS_HOSTFS_ASYNC
+  struct hostfs_aio_s req;
+
+  memset(&req, 0, sizeof(req));
+  req.aio.op     = HOST_AIO_READ;
+  req.aio.fd     = hf->fd;
+  req.aio.buf    = buf;
+  req.aio.count  = len;
+  req.aio.offset = pos;
+  return hostfs_aio(&req);
+#else
+  ssize_t ret;
+
+  if (hf->hostpos != pos)
+    {
+      ret = host_lseek(hf->fd, hf->hostpos, pos, SEEK_SET);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      hf->hostpos = pos;
+    }
+
+  ret = host_read(hf->fd, buf, len);
+  if (ret > 0)
+    {
+      hf->hostpos += ret;
+    }
+
+  return ret;
+#endif
+}
+
+/****************************************************************************
+ * Name: hostfs_pwrite
+ *
+ * Description: Write to a position of the host file, or to its end if
+ *   pos is negative.
+ *
+ ****************************************************************************/
+
+static ssize_t hostfs_pwrite(FAR struct hostfs_ofile_s *hf,
+                             FAR const void *buf, size_t len, off_t pos)
+{
+#ifdef CONFIG_FS_HOSTFS_ASYNC
+  struct hostfs_aio_s req;
+
+  memset(&req, 0, sizeof(req));
+  req.aio.op     = HOST_AIO_WRITE;
+  req.aio.fd     = hf->fd;
+  req.aio.buf    = (FAR void *)buf;
+  req.aio.count  = len;
+  req.aio.offset = pos;
+  return hostfs_aio(&req);
+#else
+  ssize_t ret;
+
+  if (pos >= 0 && hf->hostpos != pos)
+    {
+      ret = host_lseek(hf->fd, hf->hostpos, pos, SEEK_SET);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      hf->hostpos = pos;
+    }
+
+  ret = host_write(hf->fd, buf, len);
+  if (pos < 0)
+    {
+      /* The host appended, its position is not known any more */
+
+      hf->hostpos = -1;
+    }
+  else if (ret > 0)
+    {
+      hf->hostpos += ret;
+    }
+
+  return ret;
+#endif
+}
+
+/****************************************************************************
+ * Name: hostfs_host_sync
+ ****************************************************************************/
+
+static void hostfs_host_sync(int fd)
+{
+#ifdef CONFIG_FS_HOSTFS_ASYNC
+  struct hostfs_aio_s req;
+
+  memset(&req, 0, sizeof(req));
+  req.aio.op = HOST_AIO_SYNC;
+  req.aio.fd = fd;
+  hostfs_aio(&req);
+#else
+  host_sync(fd);
+#endif
+}
+
+/****************************************************************************
+ * Name: hostfs_host_fstat
+ ****************************************************************************/
+
+static int hostfs_host_fstat(int fd, FAR struct stat *buf)
+{
+#ifdef CONFIG_FS_HOSTFS_ASYNC
+  struct hostfs_aio_s req;
+
+  memset(&req, 0, sizeof(req));
+  req.aio.op  = HOST_AIO_FSTAT;
+  req.aio.fd  = fd;
+  req.aio.buf = buf;
+  return hostfs_aio(&req);
+#else
+  return host_fstat(fd, buf);
+#endif
+}
+
+/****************************************************************************
+ * Name: hostfs_host_stat
+ ****************************************************************************/
+
+static int hostfs_host_stat(FAR const char *path, FAR struct stat *buf)
+{
+#ifdef CONFIG_FS_HOSTFS_ASYNC
+  struct hostfs_aio_s req;
+
+  memset(&req, 0, sizeof(req));
+  req.aio.op   = HOST_AIO_STAT;
+  req.aio.path = path;
+  req.aio.buf  = buf;
+  return hostfs_aio(&req);
+#else
+  return host_stat(path, buf);
+#endif
+}
+
+#if CONFIG_FS_HOSTFS_READAHEAD > 0
+
+/****************************************************************************
+ * Name: hostfs_invalidate
+ *
+ * Description: Drop the readahead buffer of the file after it was written
+ *   and mark the buffers of the other open files of the same path stale.
+ *
+ ****************************************************************************/
+
+static void hostfs_invalidate(FAR struct hostfs_mountpt_s *fs,
+                              FAR struct hostfs_ofile_s *hf)
+{
+  FAR struct hostfs_ofile_s *other;
+
+  hf->ralen = 0;
+
+  nxmutex_lock(&g_lock);
+  for (other = fs->fs_head; other != NULL; other = other->fnext)
+    {
+      if (other != hf && strcmp(other->relpath, hf->relpath) == 0)
+        {
+          other->rastale = true;
+        }
+    }
+
+  nxmutex_unlock(&g_lock);
+}
+
+/****************************************************************************
+ * Name: hostfs_readahead
+ *
+ * Description: Read through the readahead buffer.  Sequential reads
+ *   smaller than the buffer refill it from the host, other reads go to
+ *   the host directly.
+ *
+ ****************************************************************************/
+
+static ssize_t hostfs_readahead(FAR struct hostfs_ofile_s *hf,
+                                FAR char *buffer, size_t buflen, off_t pos)
+{
+  bool eof = false;
+  size_t done = 0;
+  ssize_t ret = 0;
+  size_t n;
+
+  if (hf->rastale)
+    {
+      hf->rastale = false;
+      hf->ralen   = 0;
+    }
+
+  while (done < buflen)
+    {
+      if (pos >= hf->rapos && pos < hf->rapos + (off_t)hf->ralen)
+        {
+          n = MIN(buflen - done, hf->rapos + hf->ralen - pos);
+          memcpy(buffer + done, hf->rabuf + (pos - hf->rapos), n);
+          done += n;
+          pos  += n;
+          continue;
+        }
+
+      if (eof)
+        {
+          break;
+        }
+
+      if (buflen - done < CONFIG_FS_HOSTFS_READAHEAD && pos == hf->nextpos)
+        {
+          if (hf->rabuf == NULL)
+            {
+              hf->rabuf = fs_heap_malloc(CONFIG_FS_HOSTFS_READAHEAD);
+            }
+
+          if (hf->rabuf != NULL)
+            {
+              ret = hostfs_pread(hf, hf->rabuf, CONFIG_FS_HOSTFS_READAHEAD,
+                                 pos);
+              hf->ralen = ret > 0 ? ret : 0;
+              hf->rapos = pos;
+              if (ret <= 0)
+                {
+                  break;
+                }
+
+              eof = ret < CONFIG_FS_HOSTFS_READAHEAD;
+              continue;
+            }
+        }
+
+      /* Large or non-sequential reads bypass the buffer */
+
+      ret = hostfs_pread(hf, buffer + done, buflen - done, pos);
+      if (ret > 0)
+        {
+          done += ret;
+          pos  += ret;
+        }
+
+      break;
+    }
+
+  hf->nextpos = pos;
+  return done > 0 ? done : ret;
+}
+#endif
+
 /****************************************************************************
  * Name: hostfs_open
  ****************************************************************************/
@@ -267,31 +614,24 @@ static int hostfs_open(FAR struct file *filep, FAR const char *relpath,
 
   DEBUGASSERT(fs != NULL);
 
-  /* Take the lock */
-
-  ret = nxmutex_lock(&g_lock);
-  if (ret < 0)
-    {
-      return ret;
-    }
-
   /* Allocate memory for the open file */
 
   len = strlen(relpath);
-  hf = fs_heap_malloc(sizeof(*hf) + len);
+  hf = fs_heap_zalloc(sizeof(*hf) + len);
   if (hf == NULL)
     {
-      ret = -ENOMEM;
-      goto errout_with_lock;
+      return -ENOMEM;
     }
 
   /* Append to the host's root directory */
 
   hostfs_mkpath(fs, relpath, path, sizeof(path));
 
-  /* Try to open the file in the host file system */
+  /* Try to open the file in the host file system.  The lock is not held
+   * while the host opens the file, it only protects the list of files.
+   */
 
-  hf->fd = host_open(path, oflags, mode);
+  hf->fd = hostfs_host_open(path, oflags, mode);
   if (hf->fd < 0)
     {
       /* Error opening file */
@@ -313,10 +653,30 @@ static int hostfs_open(FAR struct file *filep, FAR const char *relpath,
         }
       else
         {
+          host_close(hf->fd);
           goto errout_with_buffer;
         }
     }
 
+#ifndef CONFIG_FS_HOSTFS_ASYNC
+  hf->hostpos = filep->f_pos;
+#endif
+#if CONFIG_FS_HOSTFS_READAHEAD > 0
+  hf->nextpos = filep->f_pos;
+#endif
+
+  nxmutex_init(&hf->lock);
+
+  /* Take the lock */
+
+  ret = nxmutex_lock(&g_lock);
+  if (ret < 0)
+    {
+      nxmutex_destroy(&hf->lock);
+      host_close(hf->fd);
+      goto errout_with_buffer;
+    }
+
   /* Attach the private date to the struct file instance */
 
   filep->f_priv = hf;
@@ -333,14 +693,11 @@ static int hostfs_open(FAR struct file *filep, FAR const char *relpath,
   memcpy(hf->relpath, relpath, len + 1);
   fs->fs_head = hf;
 
-  ret = OK;
-  goto errout_with_lock;
+  nxmutex_unlock(&g_lock);
+  return OK;
 
 errout_with_buffer:
   fs_heap_free(hf);
-
-errout_with_lock:
-  nxmutex_unlock(&g_lock);
   if (ret == -EINVAL)
     {
       ret = -EIO;
@@ -431,6 +788,10 @@ static int hostfs_close(FAR struct file *filep)
   /* Now free the pointer */
 
   filep->f_priv = NULL;
+#if CONFIG_FS_HOSTFS_READAHEAD > 0
+  fs_heap_free(hf->rabuf);
+#endif
+  nxmutex_destroy(&hf->lock);
   fs_heap_free(hf);
 
 okout:
@@ -462,9 +823,9 @@ static ssize_t hostfs_read(FAR struct file *filep, FAR char *buffer,
 
   DEBUGASSERT(fs != NULL);
 
-  /* Take the lock */
+  /* Take the lock of the file */
 
-  ret = nxmutex_lock(&g_lock);
+  ret = nxmutex_lock(&hf->lock);
   if (ret < 0)
     {
       return ret;
@@ -472,13 +833,17 @@ static ssize_t hostfs_read(FAR struct file *filep, FAR char *buffer,
 
   /* Call the host to perform the read */
 
-  ret = host_read(hf->fd, buffer, buflen);
+#if CONFIG_FS_HOSTFS_READAHEAD > 0
+  ret = hostfs_readahead(hf, buffer, buflen, filep->f_pos);
+#else
+  ret = hostfs_pread(hf, buffer, buflen, filep->f_pos);
+#endif
   if (ret > 0)
     {
       filep->f_pos += ret;
     }
 
-  nxmutex_unlock(&g_lock);
+  nxmutex_unlock(&hf->lock);
   return ret;
 }
 
@@ -504,9 +869,9 @@ static ssize_t hostfs_write(FAR struct file *filep, const char *buffer,
 
   DEBUGASSERT(fs != NULL);
 
-  /* Take the lock */
+  /* Take the lock of the file */
 
-  ret = nxmutex_lock(&g_lock);
+  ret = nxmutex_lock(&hf->lock);
   if (ret < 0)
     {
       return ret;
@@ -522,16 +887,23 @@ static ssize_t hostfs_write(FAR struct file *filep, const char *buffer,
       goto errout_with_lock;
     }
 
-  /* Call the host to perform the write */
+  /* Call the host to perform the write, at the end of the file in append
+   * mode.
+   */
 
-  ret = host_write(hf->fd, buffer, buflen);
+  ret = hostfs_pwrite(hf, buffer, buflen,
+                      (hf->oflags & O_APPEND) ? -1 : filep->f_pos);
   if (ret > 0)
     {
       filep->f_pos += ret;
     }
 
+#if CONFIG_FS_HOSTFS_READAHEAD > 0
+  hostfs_invalidate(fs, hf);
+#endif
+
 errout_with_lock:
-  nxmutex_unlock(&g_lock);
+  nxmutex_unlock(&hf->lock);
   return ret;
 }
 
@@ -558,23 +930,36 @@ static off_t hostfs_seek(FAR struct file *filep, off_t offset, int whence)
 
   DEBUGASSERT(fs != NULL);
 
-  /* Take the lock */
+  /* Take the lock of the file */
 
-  ret = nxmutex_lock(&g_lock);
+  ret = nxmutex_lock(&hf->lock);
   if (ret < 0)
     {
       return ret;
     }
 
+  /* The host position is shared by the duplicates of this file and moved
+   * by the readahead, it may differ from the position of this file.
+   */
+
+  if (whence == SEEK_CUR)
+    {
+      offset += filep->f_pos;
+      whence  = SEEK_SET;
+    }
+
   /* Call our internal routine to perform the seek */
 
   ret = host_lseek(hf->fd, filep->f_pos, offset, whence);
   if (ret >= 0)
     {
       filep->f_pos = ret;
+#ifndef CONFIG_FS_HOSTFS_ASYNC
+      hf->hostpos  = ret;
+#endif
     }
 
-  nxmutex_unlock(&g_lock);
+  nxmutex_unlock(&hf->lock);
   return ret;
 }
 
@@ -601,9 +986,9 @@ static int hostfs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
 
   DEBUGASSERT(fs != NULL);
 
-  /* Take the lock */
+  /* Take the lock of the file */
 
-  ret = nxmutex_lock(&g_lock);
+  ret = nxmutex_lock(&hf->lock);
   if (ret < 0)
     {
       return ret;
@@ -632,7 +1017,7 @@ static int hostfs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
         }
     }
 
-  nxmutex_unlock(&g_lock);
+  nxmutex_unlock(&hf->lock);
   return ret;
 }
 
@@ -663,17 +1048,17 @@ static int hostfs_sync(FAR struct file *filep)
 
   DEBUGASSERT(fs != NULL);
 
-  /* Take the lock */
+  /* Take the lock of the file */
 
-  ret = nxmutex_lock(&g_lock);
+  ret = nxmutex_lock(&hf->lock);
   if (ret < 0)
     {
       return ret;
     }
 
-  host_sync(hf->fd);
+  hostfs_host_sync(hf->fd);
 
-  nxmutex_unlock(&g_lock);
+  nxmutex_unlock(&hf->lock);
   return OK;
 }
 
@@ -737,9 +1122,9 @@ static int hostfs_fstat(FAR const struct file *filep, FAR struct stat *buf)
   fs    = inode->i_private;
   DEBUGASSERT(fs != NULL);
 
-  /* Take the lock */
+  /* Take the lock of the file */
 
-  ret = nxmutex_lock(&g_lock);
+  ret = nxmutex_lock(&hf->lock);
   if (ret < 0)
     {
       return ret;
@@ -747,9 +1132,9 @@ static int hostfs_fstat(FAR const struct file *filep, FAR struct stat *buf)
 
   /* Call the host to perform the read */
 
-  ret = host_fstat(hf->fd, buf);
+  ret = hostfs_host_fstat(hf->fd, buf);
 
-  nxmutex_unlock(&g_lock);
+  nxmutex_unlock(&hf->lock);
   return ret;
 }
 
@@ -783,9 +1168,9 @@ static int hostfs_fchstat(FAR const struct file *filep,
   fs    = inode->i_private;
   DEBUGASSERT(fs != NULL);
 
-  /* Take the lock */
+  /* Take the lock of the file */
 
-  ret = nxmutex_lock(&g_lock);
+  ret = nxmutex_lock(&hf->lock);
   if (ret < 0)
     {
       return ret;
@@ -795,7 +1180,7 @@ static int hostfs_fchstat(FAR const struct file *filep,
 
   ret = host_fchstat(hf->fd, buf, flags);
 
-  nxmutex_unlock(&g_lock);
+  nxmutex_unlock(&hf->lock);
   return ret;
 }
 
@@ -824,9 +1209,9 @@ static int hostfs_ftruncate(FAR struct file *filep, off_t length)
   fs    = inode->i_private;
   DEBUGASSERT(fs != NULL);
 
-  /* Take the lock */
+  /* Take the lock of the file */
 
-  ret = nxmutex_lock(&g_lock);
+  ret = nxmutex_lock(&hf->lock);
   if (ret < 0)
     {
       return ret;
@@ -835,8 +1220,11 @@ static int hostfs_ftruncate(FAR struct file *filep, off_t length)
   /* Call the host to perform the truncate */
 
   ret = host_ftruncate(hf->fd, length);
+#if CONFIG_FS_HOSTFS_READAHEAD > 0
+  hostfs_invalidate(fs, hf);
+#endif
 
-  nxmutex_unlock(&g_lock);
+  nxmutex_unlock(&hf->lock);
   return ret;
 }
 
@@ -889,6 +1277,7 @@ static int hostfs_opendir(FAR struct inode *mountpt, FAR const char *relpath,
       goto errout_with_lock;
     }
 
+  nxmutex_init(&hdir->lock);
   *dir = (FAR struct fs_dirent_s *)hdir;
   nxmutex_unlock(&g_lock);
   return OK;
@@ -935,6 +1324,7 @@ static int hostfs_closedir(FAR struct inode *mountpt,
   host_closedir(hdir->dir);
 
   nxmutex_unlock(&g_lock);
+  nxmutex_destroy(&hdir->lock);
   fs_heap_free(hdir);
   return OK;
 }
@@ -961,19 +1351,48 @@ static int hostfs_readdir(FAR struct inode *mountpt,
 
   hdir = (FAR struct hostfs_dir_s *)dir;
 
-  /* Take the lock */
+  /* Take the lock of the directory */
 
-  ret = nxmutex_lock(&g_lock);
+  ret = nxmutex_lock(&hdir->lock);
   if (ret < 0)
     {
       return ret;
     }
 
+#ifdef CONFIG_FS_HOSTFS_ASYNC
+  /* Fetch a batch of entries from the host when all were returned */
+
+  if (hdir->next >= hdir->nentries)
+    {
+      struct hostfs_aio_s req;
+
+      memset(&req, 0, sizeof(req));
+      req.aio.op    = HOST_AIO_READDIR;
+      req.aio.dirp  = hdir->dir;
+      req.aio.buf   = hdir->entries;
+      req.aio.count = CONFIG_FS_HOSTFS_DIR_BATCH;
+
+      hdir->nentries = hostfs_aio(&req);
+      hdir->next     = 0;
+    }
+
+  if (hdir->next < hdir->nentries)
+    {
+      memcpy(entry, &hdir->entries[hdir->next++], sizeof(*entry));
+      ret = OK;
+    }
+  else
+    {
+      ret = hdir->nentries < 0 ? hdir->nentries : -ENOENT;
+      hdir->nentries = 0;
+    }
+#else
   /* Call the host OS's readdir function */
 
   ret = host_readdir(hdir->dir, entry);
+#endif
 
-  nxmutex_unlock(&g_lock);
+  nxmutex_unlock(&hdir->lock);
   return ret;
 }
 
@@ -998,9 +1417,9 @@ static int hostfs_rewinddir(FAR struct inode *mountpt,
 
   hdir = (FAR struct hostfs_dir_s *)dir;
 
-  /* Take the lock */
+  /* Take the lock of the directory */
 
-  ret = nxmutex_lock(&g_lock);
+  ret = nxmutex_lock(&hdir->lock);
   if (ret < 0)
     {
       return ret;
@@ -1010,7 +1429,14 @@ static int hostfs_rewinddir(FAR struct inode *mountpt,
 
   host_rewinddir(hdir->dir);
 
-  nxmutex_unlock(&g_lock);
+#ifdef CONFIG_FS_HOSTFS_ASYNC
+  /* Drop the rest of the batch */
+
+  hdir->nentries = 0;
+  hdir->next     = 0;
+#endif
+
+  nxmutex_unlock(&hdir->lock);
   return OK;
 }
 
@@ -1370,7 +1796,6 @@ static int hostfs_stat(FAR struct inode *mountpt, FAR const char *relpath,
 {
   FAR struct hostfs_mountpt_s *fs;
   char path[HOSTFS_MAX_PATH];
-  int ret;
 
   /* Sanity checks */
 
@@ -1380,22 +1805,15 @@ static int hostfs_stat(FAR struct inode *mountpt, FAR const char *relpath,
 
   fs = mountpt->i_private;
 
-  ret = nxmutex_lock(&g_lock);
-  if (ret < 0)
-    {
-      return ret;
-    }
-
   /* Append to the host's root directory */
 
   hostfs_mkpath(fs, relpath, path, sizeof(path));
 
-  /* Call the host FS to do the stat operation */
-
-  ret = host_stat(path, buf);
+  /* Call the host FS to do the stat operation.  The lock is not needed,
+   * the root directory does not change while mounted.
+   */
 
-  nxmutex_unlock(&g_lock);
-  return ret;
+  return hostfs_host_stat(path, buf);
 }
 
 /****************************************************************************
@@ -33,6 +33,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include <nuttx/mutex.h>
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -43,8 +45,9 @@
  * Public Types
  ****************************************************************************/
 
-/* This structure describes the state of one open file.  This structure
- * is protected by the volume semaphore.
+/* This structure describes the state of one open file.  The list link
+ * and the reference count are protected by the volume lock, the position
+ * of the host file and the readahead buffer by the lock of the file.
  */
 
 struct hostfs_ofile_s
@@ -53,6 +56,17 @@ struct hostfs_ofile_s
   int16_t                   crefs;   /* Reference count */
   mode_t                    oflags;  /* Open mode */
   int                       fd;
+  mutex_t                   lock;    /* Serializes I/O on the host file */
+#ifndef CONFIG_FS_HOSTFS_ASYNC
+  off_t                     hostpos; /* Position of the host file */
+#endif
+#if CONFIG_FS_HOSTFS_READAHEAD > 0
+  FAR char                 *rabuf;   /* Readahead buffer */
+  off_t                     rapos;   /* File position of rabuf */
+  size_t                    ralen;   /* Valid bytes in rabuf */
+  off_t                     nextpos; /* End of the last read */
+  bool                      rastale; /* Written through another file */
+#endif
   char                      relpath[1];
 };
 
@@ -26,8 +26,10 @@
 
 #include <nuttx/config.h>
 
+#include <sys/param.h>
 #include <sys/types.h>
 #include <string.h>
+#include <strings.h>
 #include <assert.h>
 #include <execinfo.h>
 #include <sched.h>
@@ -59,38 +61,174 @@
  ****************************************************************************/
 
 /****************************************************************************
- * Name: fdlist_get_by_index
+ * Name: fdlist_lookup
+ *
+ * Description:
+ *   Return the file of a descriptor with a reference taken, without the
+ *   list lock.  The lookup runs with interrupts disabled and, on SMP, its
+ *   CPU's sequence in fl_readers is odd meanwhile.  fdlist_synchronize()
+ *   waits for it before the file or the array it may still see is
+ *   released.
+ *
  ****************************************************************************/
 
-static void fdlist_get_by_index(FAR struct fdlist *list,
-                                int l1, int l2,
-                                FAR struct file **filep,
-                                FAR struct fd **fdp)
+static FAR struct file *fdlist_lookup(FAR struct fdlist *list, int fd,
+                                      FAR struct fd **fdp)
 {
+  FAR struct file *filep = NULL;
+  FAR struct fd **fds;
   FAR struct fd *fdp1;
   irqstate_t flags;
+  int rows;
+#ifdef CONFIG_SMP
+  int cpu;
+#endif
 
-  flags = spin_lock_irqsave_notrace(&list->fl_lock);
-  fdp1 = &list->fl_fds[l1][l2];
-  *filep = fdp1->f_file;
-  if (*filep != NULL)
+  flags = up_irq_save();
+
+#ifdef CONFIG_SMP
+  cpu = this_cpu();
+  atomic_fetch_add(&list->fl_readers[cpu].fr_seq, 1);
+  UP_DMB();
+#endif
+
+  /* fdlist_extend() publishes fl_fds before it grows fl_rows */
+
+  rows = list->fl_rows;
+  UP_DMB();
+  fds  = list->fl_fds;
+
+  if (fd < rows * CONFIG_NFILE_DESCRIPTORS_PER_BLOCK)
     {
-      atomic_fetch_add(&(*filep)->f_refs, 1);
+      fdp1  = &fds[fd / CONFIG_NFILE_DESCRIPTORS_PER_BLOCK]
+                  [fd % CONFIG_NFILE_DESCRIPTORS_PER_BLOCK];
+      filep = fdp1->f_file;
+      if (filep != NULL)
+        {
+          atomic_fetch_add(&filep->f_refs, 1);
+        }
+
+      if (fdp != NULL)
+        {
+          *fdp = fdp1;
+        }
     }
 
-  spin_unlock_irqrestore_notrace(&list->fl_lock, flags);
-  if (fdp != NULL)
+#ifdef CONFIG_SMP
+  UP_DMB();
+  atomic_fetch_add(&list->fl_readers[cpu].fr_seq, 1);
+#endif
+
+  up_irq_restore(flags);
+  return filep;
+}
+
+/****************************************************************************
+ * Name: fdlist_synchronize
+ *
+ * Description:
+ *   Wait until the lookups that may have seen the list before a change
+ *   are done.  Without SMP a lookup cannot be interrupted by a change.
+ *
+ *   A lookup in progress when the change was made has left an odd sequence
+ *   in fl_readers of its CPU, the sequence moves on when it is done.  The
+ *   lookups that start later see the change and are not waited for, so a
+ *   CPU that keeps looking up descriptors cannot starve the change.
+ *
+ ****************************************************************************/
+
+static void fdlist_synchronize(FAR struct fdlist *list)
+{
+#ifdef CONFIG_SMP
+  int seq[CONFIG_SMP_NCPUS];
+  int cpu;
+
+  UP_DMB();
+  for (cpu = 0; cpu < CONFIG_SMP_NCPUS; cpu++)
+    {
+      seq[cpu] = atomic_read(&list->fl_readers[cpu].fr_seq);
+    }
+
+  for (cpu = 0; cpu < CONFIG_SMP_NCPUS; cpu++)
+    {
+      if ((seq[cpu] & 1) != 0)
+        {
+          while (atomic_read(&list->fl_readers[cpu].fr_seq) == seq[cpu])
+            {
+              UP_DMB();
+            }
+        }
+    }
+#endif
+}
+
+/****************************************************************************
+ * Name: fdlist_mark
+ *
+ * Description:
+ *   Update the bit of a descriptor in the bitmap, with the list lock held.
+ *
+ ****************************************************************************/
+
+static void fdlist_mark(FAR struct fdlist *list, int fd, bool used)
+{
+  if (used)
+    {
+      list->fl_bitmap[fd / 32] |= UINT32_C(1) << (fd % 32);
+    }
+  else
     {
-      *fdp = fdp1;
+      list->fl_bitmap[fd / 32] &= ~(UINT32_C(1) << (fd % 32));
     }
 }
 
+/****************************************************************************
+ * Name: fdlist_find
+ *
+ * Description:
+ *   Return the lowest unused descriptor not below minfd, with the list
+ *   lock held.  If all of them are in use, the lowest one beyond the rows
+ *   of the list is returned.
+ *
+ ****************************************************************************/
+
+static int fdlist_find(FAR struct fdlist *list, int minfd)
+{
+  int count = fdlist_count(list);
+  int words = FDLIST_BITMAP_WORDS(list->fl_rows);
+  uint32_t bits;
+  int word;
+
+  if (minfd >= count)
+    {
+      return minfd;
+    }
+
+  word = minfd / 32;
+  bits = ~list->fl_bitmap[word] & (UINT32_MAX << (minfd % 32));
+  while (bits == 0)
+    {
+      if (++word >= words)
+        {
+          return count;
+        }
+
+      bits = ~list->fl_bitmap[word];
+    }
+
+  /* The bits past the last row are clear */
+
+  return MIN(word * 32 + ffs(bits) - 1, count);
+}
+
 /****************************************************************************
  * Name: fdlist_extend
  ****************************************************************************/
 
 static int fdlist_extend(FAR struct fdlist *list, size_t row)
 {
+  FAR uint32_t *oldbitmap;
+  FAR uint32_t *bitmap;
   FAR struct fd **fds;
   uint8_t orig_rows;
   FAR void *tmp;
@@ -117,6 +255,13 @@ static int fdlist_extend(FAR struct fdlist *list, size_t row)
       return -ENFILE;
     }
 
+  bitmap = fs_heap_zalloc(sizeof(uint32_t) * FDLIST_BITMAP_WORDS(row));
+  if (bitmap == NULL)
+    {
+      fs_heap_free(fds);
+      return -ENFILE;
+    }
+
   i = orig_rows;
   do
     {
@@ -129,6 +274,7 @@ static int fdlist_extend(FAR struct fdlist *list, size_t row)
               fs_heap_free(fds[i]);
             }
 
+          fs_heap_free(bitmap);
           fs_heap_free(fds);
           return -ENFILE;
         }
@@ -151,6 +297,7 @@ static int fdlist_extend(FAR struct fdlist *list, size_t row)
           fs_heap_free(fds[j]);
         }
 
+      fs_heap_free(bitmap);
       fs_heap_free(fds);
 
       return OK;
@@ -161,14 +308,28 @@ static int fdlist_extend(FAR struct fdlist *list, size_t row)
       memcpy(fds, list->fl_fds, list->fl_rows * sizeof(FAR struct fd *));
     }
 
+  memcpy(bitmap, list->fl_bitmap,
+         sizeof(uint32_t) * FDLIST_BITMAP_WORDS(list->fl_rows));
+
+  /* Lookups read fl_rows before fl_fds, publish the new array first */
+
   tmp = list->fl_fds;
+  oldbitmap = list->fl_bitmap;
   list->fl_fds = fds;
+  list->fl_bitmap = bitmap;
+  UP_DMB();
   list->fl_rows = row;
 
   spin_unlock_irqrestore_notrace(&list->fl_lock, flags);
 
+  if (oldbitmap != list->fl_prebitmap)
+    {
+      fs_heap_free(oldbitmap);
+    }
+
   if (tmp != NULL && tmp != &list->fl_prefd)
     {
+      fdlist_synchronize(list);
       fs_heap_free(tmp);
     }
 
@@ -179,14 +340,17 @@ static int fdlist_extend(FAR struct fdlist *list, size_t row)
  * Name: fdlist_uninstall
  ****************************************************************************/
 
-static void fdlist_uninstall(FAR struct fdlist *list, FAR struct fd *fdp)
+static void fdlist_uninstall(FAR struct fdlist *list, int fd,
+                             FAR struct fd *fdp, FAR struct file *expected)
 {
   FAR struct file *filep = NULL;
   irqstate_t flags;
 
   flags = spin_lock_irqsave_notrace(&list->fl_lock);
 
-  if (fdp->f_file != NULL)
+  /* Leave the descriptor alone if it was closed and reused meanwhile */
+
+  if (fdp->f_file != NULL && fdp->f_file == expected)
     {
 #ifdef CONFIG_FDSAN
       fdp->f_tag_fdsan   = 0;
@@ -196,10 +360,16 @@ static void fdlist_uninstall(FAR struct fdlist *list, FAR struct fd *fdp)
 #endif
       filep              = fdp->f_file;
       fdp->f_file        = NULL;
+      fdlist_mark(list, fd, false);
     }
 
   spin_unlock_irqrestore_notrace(&list->fl_lock, flags);
-  file_put(filep);
+
+  if (filep != NULL)
+    {
+      fdlist_synchronize(list);
+      file_put(filep);
+    }
 }
 
 static void fdlist_install(FAR struct fdlist *list, int fd,
@@ -218,13 +388,19 @@ static void fdlist_install(FAR struct fdlist *list, int fd,
 
   fdp = &list->fl_fds[l1][l2];
   oldfilep = fdp->f_file;
-  fdp->f_file = filep;
   file_ref(filep);
   fdp->f_cloexec = !!(oflags & O_CLOEXEC);
+  fdp->f_file = filep;
+  fdlist_mark(list, fd, true);
   FS_ADD_BACKTRACE(fdp);
 
   spin_unlock_irqrestore_notrace(&list->fl_lock, flags);
-  file_put(oldfilep);
+
+  if (oldfilep != NULL)
+    {
+      fdlist_synchronize(list);
+      file_put(oldfilep);
+    }
 }
 
 /****************************************************************************
@@ -258,7 +434,9 @@ static void task_fssync(FAR struct tcb_s *tcb, FAR void *arg)
               return;
             }
 
-          fdlist_get_by_index(&ctcb->group->tg_fdlist, i, j, &filep, NULL);
+          filep = fdlist_lookup(&ctcb->group->tg_fdlist,
+                                i * CONFIG_NFILE_DESCRIPTORS_PER_BLOCK + j,
+                                NULL);
           if (filep != NULL)
             {
               file_fsync(filep);
@@ -348,6 +526,10 @@ int fdlist_dup3(FAR struct fdlist *list, int fd1, int fd2, int flags)
 
 void fdlist_init(FAR struct fdlist *list)
 {
+#ifdef CONFIG_SMP
+  int cpu;
+
+#endif
   /* The first row will reuse pre-allocated files, which will avoid
    * unnecessary allocator accesses during file initialization.
    */
@@ -355,6 +537,16 @@ void fdlist_init(FAR struct fdlist *list)
   list->fl_rows = 1;
   list->fl_fds = &list->fl_prefd;
   list->fl_prefd = list->fl_prefds;
+  list->fl_bitmap = list->fl_prebitmap;
+  memset(list->fl_prebitmap, 0, sizeof(list->fl_prebitmap));
+
+#ifdef CONFIG_SMP
+  for (cpu = 0; cpu < CONFIG_SMP_NCPUS; cpu++)
+    {
+      atomic_set(&list->fl_readers[cpu].fr_seq, 0);
+    }
+#endif
+
   spin_lock_init(&list->fl_lock);
 }
 
@@ -470,6 +662,11 @@ void fdlist_free(FAR struct fdlist *list)
     {
       fs_heap_free(list->fl_fds);
     }
+
+  if (list->fl_bitmap != list->fl_prebitmap)
+    {
+      fs_heap_free(list->fl_bitmap);
+    }
 }
 
 /****************************************************************************
@@ -522,15 +719,12 @@ int fdlist_get2(FAR struct fdlist *list, int fd,
   fd = fdcheck_restore(fd);
 #endif
 
-  if (fd < 0 || fd >= fdlist_count(list))
+  if (fd < 0)
     {
       return -EBADF;
     }
 
-  fdlist_get_by_index(list,
-                      fd / CONFIG_NFILE_DESCRIPTORS_PER_BLOCK,
-                      fd % CONFIG_NFILE_DESCRIPTORS_PER_BLOCK,
-                      filep, fdp);
+  *filep = fdlist_lookup(list, fd, fdp);
   if (*filep == NULL)
     {
       return -EBADF;
@@ -558,8 +752,7 @@ int fdlist_dupfile(FAR struct fdlist *list, int oflags, int minfd,
   FAR struct fd *fdp;
   irqstate_t flags;
   int ret;
-  int i;
-  int j;
+  int fd;
 
   DEBUGASSERT(filep);
 
@@ -567,57 +760,46 @@ int fdlist_dupfile(FAR struct fdlist *list, int oflags, int minfd,
   minfd = fdcheck_restore(minfd);
 #endif
 
-  i = minfd / CONFIG_NFILE_DESCRIPTORS_PER_BLOCK;
-  j = minfd % CONFIG_NFILE_DESCRIPTORS_PER_BLOCK;
-
-  /* Find free file descriptor */
+  /* Find free file descriptor in the bitmap, a word at a time */
 
   flags = spin_lock_irqsave_notrace(&list->fl_lock);
 
-  for (; ; i++, j = 0)
+  while ((fd = fdlist_find(list, minfd)) >= fdlist_count(list))
     {
-      if (i >= list->fl_rows)
-        {
-          spin_unlock_irqrestore_notrace(&list->fl_lock, flags);
-
-          ret = fdlist_extend(list, i + 1);
-          if (ret < 0)
-            {
-              return ret;
-            }
-
-          flags = spin_lock_irqsave_notrace(&list->fl_lock);
-        }
+      spin_unlock_irqrestore_notrace(&list->fl_lock, flags);
 
-      do
+      ret = fdlist_extend(list, fd / CONFIG_NFILE_DESCRIPTORS_PER_BLOCK + 1);
+      if (ret < 0)
         {
-          fdp = &list->fl_fds[i][j];
-          if (fdp->f_file == NULL)
-            {
-              atomic_fetch_add(&filep->f_refs, 1);
-              fdp->f_file        = filep;
-              fdp->f_cloexec     = !!(oflags & O_CLOEXEC);
- #ifdef CONFIG_FDSAN
-              fdp->f_tag_fdsan   = 0;
- #endif
- #ifdef CONFIG_FDCHECK
-              fdp->f_tag_fdcheck = 0;
- #endif
-              goto found;
-            }
+          return ret;
         }
-      while (++j < CONFIG_NFILE_DESCRIPTORS_PER_BLOCK);
+
+      flags = spin_lock_irqsave_notrace(&list->fl_lock);
     }
 
-found:
+  fdp = &list->fl_fds[fd / CONFIG_NFILE_DESCRIPTORS_PER_BLOCK]
+                     [fd % CONFIG_NFILE_DESCRIPTORS_PER_BLOCK];
+  DEBUGASSERT(fdp->f_file == NULL);
+
+  atomic_fetch_add(&filep->f_refs, 1);
+  fdp->f_cloexec     = !!(oflags & O_CLOEXEC);
+#ifdef CONFIG_FDSAN
+  fdp->f_tag_fdsan   = 0;
+#endif
+#ifdef CONFIG_FDCHECK
+  fdp->f_tag_fdcheck = 0;
+#endif
+  fdp->f_file        = filep;
+  fdlist_mark(list, fd, true);
+
   spin_unlock_irqrestore_notrace(&list->fl_lock, flags);
 
   FS_ADD_BACKTRACE(fdp);
 
 #ifdef CONFIG_FDCHECK
-  return fdcheck_protect(i * CONFIG_NFILE_DESCRIPTORS_PER_BLOCK + j);
+  return fdcheck_protect(fd);
 #else
-  return i * CONFIG_NFILE_DESCRIPTORS_PER_BLOCK + j;
+  return fd;
 #endif
 }
 
@@ -697,11 +879,12 @@ int file_allocate(int oflags, int minfd, FAR struct file **filep)
 }
 
 /****************************************************************************
- * Name: file_allocate_from_inode
+ * Name: fdlist_allocate_from_inode
  *
  * Description:
- *   Allocate a struct fd instance and associate it with an file instance.
- *   And initialize them with inode, oflags, pos and priv.
+ *   Allocate a struct fd instance in the given list and associate it with
+ *   an file instance.  And initialize them with inode, oflags, pos and
+ *   priv.
  *
  * Returned Value:
  *   Returns the file descriptor == index into the files array on success;
@@ -709,13 +892,14 @@ int file_allocate(int oflags, int minfd, FAR struct file **filep)
  *
  ****************************************************************************/
 
-int file_allocate_from_inode(FAR struct inode *inode, int oflags, off_t pos,
-                             FAR void *priv, int minfd)
+int fdlist_allocate_from_inode(FAR struct fdlist *list,
+                               FAR struct inode *inode, int oflags,
+                               off_t pos, FAR void *priv, int minfd)
 {
   FAR struct file *filep;
   int fd;
 
-  fd = file_allocate(oflags, minfd, &filep);
+  fd = fdlist_allocate(list, oflags, minfd, &filep);
   if (fd < 0)
     {
       return fd;
@@ -735,6 +919,26 @@ int file_allocate_from_inode(FAR struct inode *inode, int oflags, off_t pos,
   return fd;
 }
 
+/****************************************************************************
+ * Name: file_allocate_from_inode
+ *
+ * Description:
+ *   Allocate a struct fd instance and associate it with an file instance.
+ *   And initialize them with inode, oflags, pos and priv.
+ *
+ * Returned Value:
+ *   Returns the file descriptor == index into the files array on success;
+ *   a negated errno value is returned on any failure.
+ *
+ ****************************************************************************/
+
+int file_allocate_from_inode(FAR struct inode *inode, int oflags, off_t pos,
+                             FAR void *priv, int minfd)
+{
+  return fdlist_allocate_from_inode(nxsched_get_fdlist_from_tcb(this_task()),
+                                    inode, oflags, pos, priv, minfd);
+}
+
 /****************************************************************************
  * Name: fdlist_copy
  *
@@ -751,78 +955,96 @@ int fdlist_copy(FAR struct fdlist *plist, FAR struct fdlist *clist,
                 FAR const posix_spawn_file_actions_t *actions,
                 bool cloexec)
 {
+  FAR struct file *filep;
+  FAR struct fd *fdp;
+  irqstate_t flags;
+  uint32_t bits = 0;
   bool fcloexec;
+  int count;
   int ret;
   int fd;
-  int i;
-  int j;
 
-  for (i = 0; i < plist->fl_rows; i++)
-    {
-      for (j = 0; j < CONFIG_NFILE_DESCRIPTORS_PER_BLOCK; j++)
-        {
-          FAR struct file *filep;
-          FAR struct fd *fdp;
+  count = fdlist_count(plist);
 
-          fd = i * CONFIG_NFILE_DESCRIPTORS_PER_BLOCK + j;
 #ifdef CONFIG_FDCLONE_STDIO
+  /* Determine how many file descriptors to clone.  If
+   * CONFIG_FDCLONE_DISABLE is set, no file descriptors will be
+   * cloned.  If CONFIG_FDCLONE_STDIO is set, only the first
+   * three descriptors (stdin, stdout, and stderr) will be
+   * cloned.  Otherwise all file descriptors will be cloned.
+   */
 
-          /* Determine how many file descriptors to clone.  If
-           * CONFIG_FDCLONE_DISABLE is set, no file descriptors will be
-           * cloned.  If CONFIG_FDCLONE_STDIO is set, only the first
-           * three descriptors (stdin, stdout, and stderr) will be
-           * cloned.  Otherwise all file descriptors will be cloned.
-           */
-
-          if (fd >= 3)
-            {
-              return OK;
-            }
+  count = MIN(count, 3);
 #endif
 
-          fdlist_get_by_index(plist, i, j, &filep, &fdp);
-          if (filep == NULL)
+  for (fd = 0; fd < count; fd++)
+    {
+      /* Skip the unused descriptors a bitmap word at a time */
+
+      if (fd % 32 == 0)
+        {
+          flags = spin_lock_irqsave_notrace(&plist->fl_lock);
+          bits  = plist->fl_bitmap[fd / 32];
+          spin_unlock_irqrestore_notrace(&plist->fl_lock, flags);
+
+          if (bits == 0)
             {
+              fd += 31;
               continue;
             }
+        }
 
-          fcloexec = cloexec && fdp->f_cloexec;
+      if ((bits & (UINT32_C(1) << (fd % 32))) == 0)
+        {
+          continue;
+        }
 
-          /* Skip file dup if file action is unnecessary to duplicate */
+      filep = fdlist_lookup(plist, fd, &fdp);
+      if (filep == NULL)
+        {
+          continue;
+        }
 
-          if (actions != NULL)
-            {
+      fcloexec = cloexec && fdp->f_cloexec;
+
+      /* Skip file dup if file action is unnecessary to duplicate */
+
+      if (actions != NULL)
+        {
 #ifdef CONFIG_FDCHECK
-              fd = fdcheck_protect(fd);
+          fd = fdcheck_protect(fd);
 #endif
-              if (!spawn_file_is_duplicateable(actions, fd, fcloexec))
-                {
-                  file_put(filep);
-                  continue;
-                }
-
+          if (!spawn_file_is_duplicateable(actions, fd, fcloexec))
+            {
 #ifdef CONFIG_FDCHECK
               fd = fdcheck_restore(fd);
 #endif
-            }
-          else if (fcloexec)
-            {
               file_put(filep);
               continue;
             }
 
-          ret = fdlist_extend(clist, i + 1);
-          if (ret < 0)
-            {
-              file_put(filep);
-              return ret;
-            }
-
-          /* Assign filep to the child's descriptor list. Omit the flags */
+#ifdef CONFIG_FDCHECK
+          fd = fdcheck_restore(fd);
+#endif
+        }
+      else if (fcloexec)
+        {
+          file_put(filep);
+          continue;
+        }
 
-          fdlist_install(clist, fd, filep, 0);
+      ret = fdlist_extend(clist,
+                          fd / CONFIG_NFILE_DESCRIPTORS_PER_BLOCK + 1);
+      if (ret < 0)
+        {
           file_put(filep);
+          return ret;
         }
+
+      /* Assign filep to the child's descriptor list. Omit the flags */
+
+      fdlist_install(clist, fd, filep, 0);
+      file_put(filep);
     }
 
   return OK;
@@ -990,9 +1212,13 @@ int fdlist_close(FAR struct fdlist *list, int fd)
       return ret;
     }
 
+#ifdef CONFIG_FDCHECK
+  fd = fdcheck_restore(fd);
+#endif
+
   /* Perform the protected close operation */
 
-  fdlist_uninstall(list, fdp);
+  fdlist_uninstall(list, fd, fdp, filep);
 
   /* fdlist_get2 will increase the reference count, there call
    * file_put reduce reference count.
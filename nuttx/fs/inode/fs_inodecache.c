@@ -0,0 +1,357 @@
+/****************************************************************************
+ * fs/inode/fs_inodecache.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <nuttx/fs/fs.h>
+#include <nuttx/spinlock.h>
+
+#include "inode/inode.h"
+
+#ifdef CONFIG_FS_DCACHE
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* One entry of the path lookup cache.  An entry is valid only while the
+ * generation of the cache is the one that it was filled with; every change
+ * of the name space increments the generation and so invalidates all of
+ * the entries at once.
+ */
+
+struct inode_dcache_s
+{
+  uint32_t gen;                 /* Generation when filled, 0: unused */
+  uint32_t hash;                /* Hash of mountpt and path */
+  FAR struct inode *mountpt;    /* NULL: pseudo file system lookup,
+                                 * else failed lookup in this mountpoint */
+  FAR struct inode *node;       /* Search results (pseudo file system) */
+  FAR struct inode *peer;
+  FAR struct inode *parent;
+  int16_t ret;                  /* Result of the lookup */
+  int16_t pathoff;              /* Offset of desc->path in the path */
+  int16_t reloff;               /* Offset of desc->relpath or -1 */
+  char path[CONFIG_FS_DCACHE_PATHLEN];
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct inode_dcache_s g_dcache[CONFIG_FS_DCACHE_NENTRIES];
+static uint32_t g_dcache_gen = 1;
+static spinlock_t g_dcache_lock = SP_UNLOCKED;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: inode_dcache_hash
+ *
+ * Description:
+ *   FNV-1a hash of the mountpoint and the path.  Returns zero if the path
+ *   is too long to be cached.
+ *
+ ****************************************************************************/
+
+static uint32_t inode_dcache_hash(FAR struct inode *mountpt,
+                                  FAR const char *path)
+{
+  uint32_t hash = 2166136261u ^ (uint32_t)(uintptr_t)mountpt;
+  size_t len = 0;
+
+  for (; *path != '\0'; path++)
+    {
+      if (++len >= CONFIG_FS_DCACHE_PATHLEN)
+        {
+          return 0;
+        }
+
+      hash = (hash ^ (uint8_t)*path) * 16777619u;
+    }
+
+  return hash != 0 ? hash : 1;
+}
+
+/****************************************************************************
+ * Name: inode_dcache_find
+ *
+ * Description:
+ *   Return the valid entry for the mountpoint and path or NULL.
+ *
+ * Assumptions:
+ *   The caller holds g_dcache_lock.
+ *
+ ****************************************************************************/
+
+static FAR struct inode_dcache_s *
+inode_dcache_find(FAR struct inode *mountpt, FAR const char *path,
+                  uint32_t hash)
+{
+  FAR struct inode_dcache_s *entry =
+    &g_dcache[hash % CONFIG_FS_DCACHE_NENTRIES];
+
+  if (entry->gen == g_dcache_gen && entry->hash == hash &&
+      entry->mountpt == mountpt && strcmp(entry->path, path) == 0)
+    {
+      return entry;
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: inode_dcache_fill
+ *
+ * Description:
+ *   Claim the slot of the mountpoint and path for generation 'gen'.
+ *
+ * Assumptions:
+ *   The caller holds g_dcache_lock.
+ *
+ ****************************************************************************/
+
+static FAR struct inode_dcache_s *
+inode_dcache_fill(FAR struct inode *mountpt, FAR const char *path,
+                  uint32_t hash, uint32_t gen)
+{
+  FAR struct inode_dcache_s *entry =
+    &g_dcache[hash % CONFIG_FS_DCACHE_NENTRIES];
+
+  entry->gen     = gen;
+  entry->hash    = hash;
+  entry->mountpt = mountpt;
+  strlcpy(entry->path, path, sizeof(entry->path));
+  return entry;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: inode_dcache_invalidate
+ *
+ * Description:
+ *   Invalidate the whole lookup cache.  This must be called after any
+ *   change of the name space:  Inodes added to or removed from the pseudo
+ *   file system and names created or renamed in a mounted volume.  The
+ *   VFS calls it where it calls the inotify hooks for these changes.  File
+ *   systems that create names without going through the VFS, like unionfs
+ *   in its layers, must call it themselves.
+ *
+ ****************************************************************************/
+
+void inode_dcache_invalidate(void)
+{
+  irqstate_t flags = spin_lock_irqsave(&g_dcache_lock);
+
+  if (++g_dcache_gen == 0)
+    {
+      g_dcache_gen = 1;
+    }
+
+  spin_unlock_irqrestore(&g_dcache_lock, flags);
+}
+
+/****************************************************************************
+ * Name: inode_dcache_generation
+ *
+ * Description:
+ *   Return the current generation of the lookup cache.  A failed lookup in
+ *   a mounted volume is recorded with the generation sampled before the
+ *   lookup, so that it is discarded if the name space changed meanwhile.
+ *
+ ****************************************************************************/
+
+uint32_t inode_dcache_generation(void)
+{
+  return g_dcache_gen;
+}
+
+/****************************************************************************
+ * Name: inode_dcache_lookup
+ *
+ * Description:
+ *   Look up the results of a previous inode search of desc->path.  On a
+ *   hit, the search descriptor is filled in as inode_search() would do.
+ *
+ * Returned Value:
+ *   True if the search was found in the cache, with its result in 'ret'.
+ *
+ * Assumptions:
+ *   The caller holds the inode lock.
+ *
+ ****************************************************************************/
+
+bool inode_dcache_lookup(FAR struct inode_search_s *desc, FAR int *ret)
+{
+  FAR struct inode_dcache_s *entry;
+  FAR const char *path = desc->path;
+  irqstate_t flags;
+  uint32_t hash;
+  bool found = false;
+
+  hash = inode_dcache_hash(NULL, path);
+  if (hash == 0)
+    {
+      return false;
+    }
+
+  flags = spin_lock_irqsave(&g_dcache_lock);
+  entry = inode_dcache_find(NULL, path, hash);
+  if (entry != NULL)
+    {
+      desc->path    = path + entry->pathoff;
+      desc->node    = entry->node;
+      desc->peer    = entry->peer;
+      desc->parent  = entry->parent;
+      desc->relpath = entry->reloff < 0 ? NULL : path + entry->reloff;
+      *ret          = entry->ret;
+      found         = true;
+    }
+
+  spin_unlock_irqrestore(&g_dcache_lock, flags);
+  return found;
+}
+
+/****************************************************************************
+ * Name: inode_dcache_add
+ *
+ * Description:
+ *   Record the results of an inode search of 'path' that did not go
+ *   through any soft link.
+ *
+ * Assumptions:
+ *   The caller holds the inode lock, so the pseudo file system cannot
+ *   change before the results are recorded.
+ *
+ ****************************************************************************/
+
+void inode_dcache_add(FAR const char *path,
+                      FAR const struct inode_search_s *desc, int ret)
+{
+  FAR struct inode_dcache_s *entry;
+  irqstate_t flags;
+  uint32_t hash;
+
+  hash = inode_dcache_hash(NULL, path);
+  if (hash == 0)
+    {
+      return;
+    }
+
+  flags = spin_lock_irqsave(&g_dcache_lock);
+  entry = inode_dcache_fill(NULL, path, hash, g_dcache_gen);
+  entry->node    = desc->node;
+  entry->peer    = desc->peer;
+  entry->parent  = desc->parent;
+  entry->ret     = ret;
+  entry->pathoff = desc->path - path;
+  entry->reloff  = desc->relpath == NULL ? -1 : desc->relpath - path;
+  spin_unlock_irqrestore(&g_dcache_lock, flags);
+}
+
+/****************************************************************************
+ * Name: inode_dcache_negative
+ *
+ * Description:
+ *   Return true if 'relpath' is known not to exist in the volume mounted
+ *   at 'mountpt'.  Only mountpoints whose file system sets
+ *   MNTPT_FLAG_DCACHE are cached.
+ *
+ ****************************************************************************/
+
+bool inode_dcache_negative(FAR struct inode *mountpt,
+                           FAR const char *relpath)
+{
+  irqstate_t flags;
+  uint32_t hash;
+  bool found;
+
+  if ((mountpt->u.i_mops->flags & MNTPT_FLAG_DCACHE) == 0)
+    {
+      return false;
+    }
+
+  hash = inode_dcache_hash(mountpt, relpath);
+  if (hash == 0)
+    {
+      return false;
+    }
+
+  flags = spin_lock_irqsave(&g_dcache_lock);
+  found = inode_dcache_find(mountpt, relpath, hash) != NULL;
+  spin_unlock_irqrestore(&g_dcache_lock, flags);
+  return found;
+}
+
+/****************************************************************************
+ * Name: inode_dcache_addnegative
+ *
+ * Description:
+ *   Record that 'relpath' does not exist in the volume mounted at
+ *   'mountpt'.  'gen' is the generation sampled before the lookup; nothing
+ *   is recorded if the name space changed since.
+ *
+ ****************************************************************************/
+
+void inode_dcache_addnegative(FAR struct inode *mountpt,
+                              FAR const char *relpath, uint32_t gen)
+{
+  FAR struct inode_dcache_s *entry;
+  irqstate_t flags;
+  uint32_t hash;
+
+  if ((mountpt->u.i_mops->flags & MNTPT_FLAG_DCACHE) == 0)
+    {
+      return;
+    }
+
+  hash = inode_dcache_hash(mountpt, relpath);
+  if (hash == 0)
+    {
+      return;
+    }
+
+  flags = spin_lock_irqsave(&g_dcache_lock);
+  if (gen == g_dcache_gen)
+    {
+      entry = inode_dcache_fill(mountpt, relpath, hash, gen);
+      entry->ret = -ENOENT;
+    }
+
+  spin_unlock_irqrestore(&g_dcache_lock, flags);
+}
+
+#endif /* CONFIG_FS_DCACHE */
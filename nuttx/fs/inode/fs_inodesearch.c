@@ -221,6 +221,10 @@ static int _inode_search(FAR struct inode_search_s *desc)
   FAR struct inode *left    = NULL;
   FAR struct inode *above   = NULL;
   FAR const char   *relpath = NULL;
+#ifdef CONFIG_FS_DCACHE
+  FAR const char   *path;
+  bool cacheable = true;
+#endif
   int ret = -ENOENT;
 
   /* Get the search path, skipping over the leading '/'.  The leading '/' is
@@ -235,6 +239,16 @@ static int _inode_search(FAR struct inode_search_s *desc)
       return -EINVAL;
     }
 
+#ifdef CONFIG_FS_DCACHE
+  /* Try the results of a previous search of the same path first */
+
+  path = name;
+  if (inode_dcache_lookup(desc, &ret))
+    {
+      return ret;
+    }
+#endif
+
   /* Traverse the pseudo file system node tree until either (1) all nodes
    * have been examined without finding the matching node, or (2) the
    * matching node is found.
@@ -306,6 +320,12 @@ static int _inode_search(FAR struct inode_search_s *desc)
                 {
                   int status;
 
+#ifdef CONFIG_FS_DCACHE
+                  /* The result depends on the link target too */
+
+                  cacheable = false;
+#endif
+
                   /* If this intermediate inode in the is a soft link, then
                    * (1) recursively look-up the inode referenced by the
                    * soft link, and (2) continue searching with that inode
@@ -412,6 +432,14 @@ static int _inode_search(FAR struct inode_search_s *desc)
   desc->peer    = left;
   desc->parent  = above;
   desc->relpath = relpath;
+
+#ifdef CONFIG_FS_DCACHE
+  if (cacheable && (ret == OK || ret == -ENOENT))
+    {
+      inode_dcache_add(path, desc, ret);
+    }
+#endif
+
   return ret;
 }
 
@@ -251,6 +251,36 @@ int inode_search(FAR struct inode_search_s *desc);
 
 int inode_find(FAR struct inode_search_s *desc);
 
+/****************************************************************************
+ * Name: inode_dcache_*
+ *
+ * Description:
+ *   The path lookup cache (fs_inodecache.c).  It remembers the results of
+ *   the searches of the pseudo file system and the names that do not exist
+ *   in the volumes whose file system sets MNTPT_FLAG_DCACHE.
+ *   inode_dcache_invalidate() must be called after every change of the
+ *   name space, also by file systems that create names in other volumes
+ *   without going through the VFS.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_DCACHE
+void inode_dcache_invalidate(void);
+uint32_t inode_dcache_generation(void);
+bool inode_dcache_lookup(FAR struct inode_search_s *desc, FAR int *ret);
+void inode_dcache_add(FAR const char *path,
+                      FAR const struct inode_search_s *desc, int ret);
+bool inode_dcache_negative(FAR struct inode *mountpt,
+                           FAR const char *relpath);
+void inode_dcache_addnegative(FAR struct inode *mountpt,
+                              FAR const char *relpath, uint32_t gen);
+#else
+#  define inode_dcache_invalidate()
+#  define inode_dcache_generation() 0
+#  define inode_dcache_negative(m,r) false
+#  define inode_dcache_addnegative(m,r,g) UNUSED(g)
+#endif
+
 /****************************************************************************
  * Name: inode_stat
  *
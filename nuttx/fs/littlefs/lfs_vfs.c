@@ -28,14 +28,18 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <nuttx/atomic.h>
 #include <nuttx/fs/fs.h>
 #include <nuttx/fs/ioctl.h>
 #include <nuttx/kmalloc.h>
+#include <nuttx/list.h>
 #include <nuttx/mtd/mtd.h>
 #include <nuttx/mutex.h>
 
+#include <sys/param.h>
 #include <sys/stat.h>
 #include <sys/statfs.h>
 
@@ -52,6 +56,11 @@
 #  error littlefs requires CONFIG_C99_BOOL to be selected
 #endif
 
+#ifndef CONFIG_FS_LITTLEFS_READ_CACHE
+#  define littlefs_file_changed(fs, priv)
+#  define littlefs_meta_changed(fs)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -66,7 +75,27 @@ struct littlefs_file_s
 {
   struct lfs_file       file;
   int                   refs;
+#ifdef CONFIG_FS_LITTLEFS_READ_CACHE
+  struct list_node      node;     /* Open files of the mount */
+  mutex_t               lock;     /* Protects the read cache */
+  atomic_t              gen;      /* Changes when the content may change */
+  int32_t               cgen;     /* gen when the cache was filled */
+  off_t                 cpos;     /* File position of the cached data */
+  size_t                clen;     /* Number of bytes cached */
+  FAR uint8_t          *cache;    /* Data of the last read */
+#endif
+};
+
+#ifdef CONFIG_FS_LITTLEFS_READ_CACHE
+/* A cached stat() result */
+
+struct littlefs_statent_s
+{
+  FAR char             *path;
+  int32_t               gen;      /* mgen of the mount when cached */
+  struct stat           buf;
 };
+#endif
 
 /* This structure represents the overall mountpoint state. An instance of
  * this structure is retained as inode private data on each mountpoint that
@@ -81,6 +110,13 @@ struct littlefs_mountpt_s
   struct lfs_config     cfg;
   struct lfs            lfs;
   bool                  readonly;
+#ifdef CONFIG_FS_LITTLEFS_READ_CACHE
+  struct list_node      files;    /* Open files */
+  atomic_t              mgen;     /* Changes with every metadata change */
+  mutex_t               slock;    /* Protects the stat cache */
+  int                   nextstat; /* Next stat cache entry to replace */
+  struct littlefs_statent_s stats[CONFIG_FS_LITTLEFS_STAT_CACHE];
+#endif
 };
 
 /* NuttX specific file attributes.
@@ -210,10 +246,12 @@ const struct mountpt_operations g_littlefs_operations =
   littlefs_rename,        /* rename */
   littlefs_stat,          /* stat */
 #ifdef CONFIG_FS_LITTLEFS_ATTR_UPDATE
-  littlefs_chstat         /* chstat */
+  littlefs_chstat,        /* chstat */
 #else
-  NULL,
+  NULL,                   /* chstat */
 #endif
+  NULL,                   /* syncfs */
+  MNTPT_FLAG_DCACHE       /* flags */
 };
 
 /****************************************************************************
@@ -335,6 +373,145 @@ static FAR const char *littlefs_convert_path(FAR const char *path)
   return path;
 }
 
+#ifdef CONFIG_FS_LITTLEFS_READ_CACHE
+/****************************************************************************
+ * Name: littlefs_file_changed
+ *
+ * Description:
+ *   Drop the read cache of every open instance of the file.  The mount
+ *   must be locked.
+ *
+ ****************************************************************************/
+
+static void littlefs_file_changed(FAR struct littlefs_mountpt_s *fs,
+                                  FAR struct littlefs_file_s *priv)
+{
+  FAR struct littlefs_file_s *other;
+
+  list_for_every_entry(&fs->files, other, struct littlefs_file_s, node)
+    {
+      if (other->file.id == priv->file.id &&
+          other->file.m.pair[0] == priv->file.m.pair[0] &&
+          other->file.m.pair[1] == priv->file.m.pair[1])
+        {
+          atomic_fetch_add(&other->gen, 1);
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: littlefs_meta_changed
+ *
+ * Description:
+ *   Drop the stat cache.  The mount must be locked.
+ *
+ ****************************************************************************/
+
+static void littlefs_meta_changed(FAR struct littlefs_mountpt_s *fs)
+{
+  atomic_fetch_add(&fs->mgen, 1);
+}
+
+/****************************************************************************
+ * Name: littlefs_stat_lookup
+ *
+ * Description:
+ *   Look up a current stat() result of the path without the mount lock.
+ *
+ ****************************************************************************/
+
+static bool littlefs_stat_lookup(FAR struct littlefs_mountpt_s *fs,
+                                 FAR const char *path, FAR struct stat *buf)
+{
+  int32_t gen = atomic_read(&fs->mgen);
+  bool found = false;
+  int i;
+
+  if (nxmutex_lock(&fs->slock) < 0)
+    {
+      return false;
+    }
+
+  for (i = 0; i < CONFIG_FS_LITTLEFS_STAT_CACHE; i++)
+    {
+      FAR struct littlefs_statent_s *ent = &fs->stats[i];
+
+      if (ent->path != NULL && ent->gen == gen &&
+          strcmp(ent->path, path) == 0)
+        {
+          *buf  = ent->buf;
+          found = true;
+          break;
+        }
+    }
+
+  nxmutex_unlock(&fs->slock);
+  return found;
+}
+
+/****************************************************************************
+ * Name: littlefs_stat_insert
+ *
+ * Description:
+ *   Remember the stat() result of a path, obtained when the mgen of the
+ *   mount was 'gen'.
+ *
+ ****************************************************************************/
+
+static void littlefs_stat_insert(FAR struct littlefs_mountpt_s *fs,
+                                 FAR const char *path,
+                                 FAR const struct stat *buf, int32_t gen)
+{
+  FAR struct littlefs_statent_s *ent;
+  FAR char *copy;
+
+  copy = fs_heap_strdup(path);
+  if (copy == NULL || nxmutex_lock(&fs->slock) < 0)
+    {
+      fs_heap_free(copy);
+      return;
+    }
+
+  ent = &fs->stats[fs->nextstat];
+  fs->nextstat = (fs->nextstat + 1) % CONFIG_FS_LITTLEFS_STAT_CACHE;
+
+  fs_heap_free(ent->path);
+  ent->path = copy;
+  ent->gen  = gen;
+  ent->buf  = *buf;
+  nxmutex_unlock(&fs->slock);
+}
+
+/****************************************************************************
+ * Name: littlefs_read_cached
+ *
+ * Description:
+ *   Copy data from the read cache of the file if it holds the current
+ *   position and nothing changed the file since it was filled.  Called
+ *   with the file, but not the mount locked.
+ *
+ ****************************************************************************/
+
+static ssize_t littlefs_read_cached(FAR struct file *filep,
+                                    FAR char *buffer, size_t buflen)
+{
+  FAR struct littlefs_file_s *priv = filep->f_priv;
+  size_t nread;
+
+  if (priv->clen == 0 || priv->cgen != atomic_read(&priv->gen) ||
+      filep->f_pos < priv->cpos ||
+      filep->f_pos >= priv->cpos + priv->clen)
+    {
+      return 0;
+    }
+
+  nread = MIN(buflen, priv->cpos + priv->clen - filep->f_pos);
+  memcpy(buffer, priv->cache + (filep->f_pos - priv->cpos), nread);
+  filep->f_pos += nread;
+  return nread;
+}
+#endif
+
 /****************************************************************************
  * Name: littlefs_open
  ****************************************************************************/
@@ -363,6 +540,12 @@ static int littlefs_open(FAR struct file *filep, FAR const char *relpath,
     }
 
   priv->refs = 1;
+#ifdef CONFIG_FS_LITTLEFS_READ_CACHE
+  nxmutex_init(&priv->lock);
+  atomic_set(&priv->gen, 0);
+  priv->clen  = 0;
+  priv->cache = NULL;
+#endif
 
   /* Lock */
 
@@ -454,6 +637,19 @@ static int littlefs_open(FAR struct file *filep, FAR const char *relpath,
       lfs_file_sync(&fs->lfs, &priv->file);
     }
 
+#ifdef CONFIG_FS_LITTLEFS_READ_CACHE
+  list_add_tail(&fs->files, &priv->node);
+  if (oflags & LFS_O_TRUNC)
+    {
+      littlefs_file_changed(fs, priv);
+    }
+#endif
+
+  if (oflags & (LFS_O_CREAT | LFS_O_TRUNC))
+    {
+      littlefs_meta_changed(fs);
+    }
+
   nxmutex_unlock(&fs->lock);
 
   /* Attach the private date to the struct file instance */
@@ -466,6 +662,9 @@ errout_with_file:
 errout:
   nxmutex_unlock(&fs->lock);
 errlock:
+#ifdef CONFIG_FS_LITTLEFS_READ_CACHE
+  nxmutex_destroy(&priv->lock);
+#endif
   fs_heap_free(priv);
   return ret;
 }
@@ -498,11 +697,19 @@ static int littlefs_close(FAR struct file *filep)
   if (--priv->refs <= 0)
     {
       ret = littlefs_convert_result(lfs_file_close(&fs->lfs, &priv->file));
+#ifdef CONFIG_FS_LITTLEFS_READ_CACHE
+      list_delete(&priv->node);
+#endif
+      littlefs_meta_changed(fs);
     }
 
   nxmutex_unlock(&fs->lock);
   if (priv->refs <= 0)
     {
+#ifdef CONFIG_FS_LITTLEFS_READ_CACHE
+      nxmutex_destroy(&priv->lock);
+      fs_heap_free(priv->cache);
+#endif
       fs_heap_free(priv);
     }
 
@@ -527,12 +734,33 @@ static ssize_t littlefs_read(FAR struct file *filep, FAR char *buffer,
   inode = filep->f_inode;
   fs    = inode->i_private;
 
+#ifdef CONFIG_FS_LITTLEFS_READ_CACHE
+  ret = nxmutex_lock(&priv->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Try the read cache first, it does not need the mount lock */
+
+  ret = littlefs_read_cached(filep, buffer, buflen);
+  if (ret > 0)
+    {
+      goto out_with_file;
+    }
+
+  if (priv->cache == NULL && buflen < fs->cfg.cache_size)
+    {
+      priv->cache = fs_heap_malloc(fs->cfg.cache_size);
+    }
+#endif
+
   /* Call LFS to perform the read */
 
   ret = nxmutex_lock(&fs->lock);
   if (ret < 0)
     {
-      return ret;
+      goto out_with_file;
     }
 
   if (filep->f_pos != priv->file.pos)
@@ -546,6 +774,30 @@ static ssize_t littlefs_read(FAR struct file *filep, FAR char *buffer,
         }
     }
 
+#ifdef CONFIG_FS_LITTLEFS_READ_CACHE
+  if (priv->cache != NULL && buflen < fs->cfg.cache_size)
+    {
+      /* Read ahead into the cache, the following reads are served from
+       * it without the mount lock.
+       */
+
+      priv->cgen = atomic_read(&priv->gen);
+      priv->cpos = filep->f_pos;
+      priv->clen = 0;
+
+      ret = littlefs_convert_result(lfs_file_read(&fs->lfs, &priv->file,
+                                                  priv->cache,
+                                                  fs->cfg.cache_size));
+      if (ret > 0)
+        {
+          priv->clen = ret;
+          ret = littlefs_read_cached(filep, buffer, buflen);
+        }
+
+      goto out;
+    }
+#endif
+
   ret = littlefs_convert_result(lfs_file_read(&fs->lfs, &priv->file,
                                               buffer, buflen));
   if (ret > 0)
@@ -555,6 +807,10 @@ static ssize_t littlefs_read(FAR struct file *filep, FAR char *buffer,
 
 out:
   nxmutex_unlock(&fs->lock);
+out_with_file:
+#ifdef CONFIG_FS_LITTLEFS_READ_CACHE
+  nxmutex_unlock(&priv->lock);
+#endif
   return ret;
 }
 
@@ -600,6 +856,7 @@ static ssize_t littlefs_write(FAR struct file *filep, const char *buffer,
   if (ret > 0)
     {
       filep->f_pos += ret;
+      littlefs_file_changed(fs, priv);
     }
 
 out:
@@ -632,6 +889,16 @@ static off_t littlefs_seek(FAR struct file *filep, off_t offset, int whence)
       return ret;
     }
 
+  /* The position of the LFS file lags behind f_pos after reads that were
+   * served from the read cache, so SEEK_CUR is relative to f_pos.
+   */
+
+  if (whence == SEEK_CUR)
+    {
+      offset += filep->f_pos;
+      whence  = SEEK_SET;
+    }
+
   ret = littlefs_convert_result(lfs_file_seek(&fs->lfs, &priv->file,
                                               offset, whence));
   if (ret >= 0)
@@ -748,6 +1015,8 @@ static int littlefs_sync(FAR struct file *filep)
     }
 
   ret = littlefs_convert_result(lfs_file_sync(&fs->lfs, &priv->file));
+  littlefs_file_changed(fs, priv);
+  littlefs_meta_changed(fs);
   nxmutex_unlock(&fs->lock);
 
   return ret;
@@ -931,6 +1200,7 @@ static int littlefs_fchstat(FAR const struct file *filep,
 
   ret = littlefs_convert_result(lfs_file_setattr(&fs->lfs, &priv->file, 0,
                                                  &attr, sizeof(attr)));
+  littlefs_meta_changed(fs);
   if (ret < 0)
     {
       goto errout;
@@ -974,6 +1244,8 @@ static int littlefs_truncate(FAR struct file *filep, off_t length)
 
   ret = littlefs_convert_result(lfs_file_truncate(&fs->lfs, &priv->file,
                                                   length));
+  littlefs_file_changed(fs, priv);
+  littlefs_meta_changed(fs);
   nxmutex_unlock(&fs->lock);
 
   return ret;
@@ -1291,6 +1563,10 @@ static int littlefs_bind(FAR struct inode *driver, FAR const void *data,
                          FAR void **handle)
 {
   FAR struct littlefs_mountpt_s *fs;
+  lfs_size_t cache_size = 0;
+  lfs_size_t lookahead_size = 0;
+  bool forceformat = false;
+  bool autoformat = false;
   int ret;
 
   /* Open the block driver */
@@ -1320,6 +1596,56 @@ static int littlefs_bind(FAR struct inode *driver, FAR const void *data,
 
   fs->drv = driver;        /* Save the driver reference */
   nxmutex_init(&fs->lock); /* Initialize the access control mutex */
+#ifdef CONFIG_FS_LITTLEFS_READ_CACHE
+  list_initialize(&fs->files);
+  nxmutex_init(&fs->slock);
+  atomic_set(&fs->mgen, 0);
+#endif
+
+  /* Parse the comma separated mount options */
+
+  if (data != NULL)
+    {
+      FAR char *options;
+      FAR char *saveptr;
+      FAR char *ptr;
+
+      options = fs_heap_strdup(data);
+      if (options == NULL)
+        {
+          ret = -ENOMEM;
+          goto errout_with_fs;
+        }
+
+      ptr = strtok_r(options, ",", &saveptr);
+      while (ptr != NULL)
+        {
+          if (strcmp(ptr, "forceformat") == 0)
+            {
+              forceformat = true;
+            }
+          else if (strcmp(ptr, "autoformat") == 0)
+            {
+              autoformat = true;
+            }
+          else if (strcmp(ptr, "ro") == 0)
+            {
+              fs->readonly = true;
+            }
+          else if (strncmp(ptr, "cache_size=", 11) == 0)
+            {
+              cache_size = strtoul(ptr + 11, NULL, 0);
+            }
+          else if (strncmp(ptr, "lookahead_size=", 15) == 0)
+            {
+              lookahead_size = strtoul(ptr + 15, NULL, 0);
+            }
+
+          ptr = strtok_r(NULL, ",", &saveptr);
+        }
+
+      fs_heap_free(options);
+    }
 
   if (INODE_IS_MTD(driver))
     {
@@ -1395,13 +1721,42 @@ static int littlefs_bind(FAR struct inode *driver, FAR const void *data,
   fs->cfg.disk_version   = CONFIG_FS_LITTLEFS_DISK_VERSION;
 #endif
 
+  /* -o cache_size=N and -o lookahead_size=N override the Kconfig defaults.
+   * The cache size must be a multiple of the read and program sizes and a
+   * factor of the block size, the lookahead size a multiple of 8.
+   */
+
+  if (cache_size != 0)
+    {
+      if (cache_size % fs->cfg.read_size != 0 ||
+          cache_size % fs->cfg.prog_size != 0 ||
+          fs->cfg.block_size % cache_size != 0)
+        {
+          ret = -EINVAL;
+          goto errout_with_fs;
+        }
+
+      fs->cfg.cache_size = cache_size;
+    }
+
+  if (lookahead_size != 0)
+    {
+      if (lookahead_size % 8 != 0)
+        {
+          ret = -EINVAL;
+          goto errout_with_fs;
+        }
+
+      fs->cfg.lookahead_size = lookahead_size;
+    }
+
   /* Then get information about the littlefs filesystem on the devices
    * managed by this driver.
    */
 
   /* Force format the device if -o forceformat */
 
-  if (data && strcmp(data, "forceformat") == 0)
+  if (forceformat)
     {
       ret = littlefs_convert_result(lfs_format(&fs->lfs, &fs->cfg));
       if (ret < 0)
@@ -1410,17 +1765,12 @@ static int littlefs_bind(FAR struct inode *driver, FAR const void *data,
         }
     }
 
-  if (data && !strcmp(data, "ro"))
-    {
-      fs->readonly = true;
-    }
-
   ret = littlefs_convert_result(lfs_mount(&fs->lfs, &fs->cfg));
   if (ret < 0)
     {
       /* Auto format the device if -o autoformat */
 
-      if (ret != -EFAULT || !data || strcmp(data, "autoformat"))
+      if (ret != -EFAULT || !autoformat)
         {
           goto errout_with_fs;
         }
@@ -1444,6 +1794,9 @@ static int littlefs_bind(FAR struct inode *driver, FAR const void *data,
   return OK;
 
 errout_with_fs:
+#ifdef CONFIG_FS_LITTLEFS_READ_CACHE
+  nxmutex_destroy(&fs->slock);
+#endif
   nxmutex_destroy(&fs->lock);
   fs_heap_free(fs);
 errout_with_block:
@@ -1468,6 +1821,9 @@ static int littlefs_unbind(FAR void *handle, FAR struct inode **driver,
 {
   FAR struct littlefs_mountpt_s *fs = handle;
   FAR struct inode *drv = fs->drv;
+#ifdef CONFIG_FS_LITTLEFS_READ_CACHE
+  int i;
+#endif
   int ret;
 
   /* Unmount */
@@ -1503,6 +1859,15 @@ static int littlefs_unbind(FAR void *handle, FAR struct inode **driver,
 
       /* Release the mountpoint private data */
 
+#ifdef CONFIG_FS_LITTLEFS_READ_CACHE
+      for (i = 0; i < CONFIG_FS_LITTLEFS_STAT_CACHE; i++)
+        {
+          fs_heap_free(fs->stats[i].path);
+        }
+
+      nxmutex_destroy(&fs->slock);
+#endif
+
       nxmutex_destroy(&fs->lock);
       fs_heap_free(fs);
     }
@@ -1581,6 +1946,7 @@ static int littlefs_unlink(FAR struct inode *mountpt,
 
   relpath = littlefs_convert_path(relpath);
   ret = littlefs_convert_result(lfs_remove(&fs->lfs, relpath));
+  littlefs_meta_changed(fs);
   nxmutex_unlock(&fs->lock);
 
   return ret;
@@ -1655,6 +2021,7 @@ static int littlefs_mkdir(FAR struct inode *mountpt, FAR const char *relpath,
         }
     }
 
+  littlefs_meta_changed(fs);
   nxmutex_unlock(&fs->lock);
 
 errout:
@@ -1725,6 +2092,7 @@ static int littlefs_rename(FAR struct inode *mountpt,
   newrelpath = littlefs_convert_path(newrelpath);
   ret = littlefs_convert_result(lfs_rename(&fs->lfs, oldrelpath,
                                            newrelpath));
+  littlefs_meta_changed(fs);
   nxmutex_unlock(&fs->lock);
 
   return ret;
@@ -1743,6 +2111,9 @@ static int littlefs_stat(FAR struct inode *mountpt, FAR const char *relpath,
   FAR struct littlefs_mountpt_s *fs;
   struct lfs_info info;
   struct littlefs_attr_s attr;
+#ifdef CONFIG_FS_LITTLEFS_READ_CACHE
+  int32_t gen;
+#endif
   int ret;
 
   memset(buf, 0, sizeof(*buf));
@@ -1750,6 +2121,14 @@ static int littlefs_stat(FAR struct inode *mountpt, FAR const char *relpath,
   /* Get the mountpoint private data from the inode structure */
 
   fs = mountpt->i_private;
+  relpath = littlefs_convert_path(relpath);
+
+#ifdef CONFIG_FS_LITTLEFS_READ_CACHE
+  if (littlefs_stat_lookup(fs, relpath, buf))
+    {
+      return OK;
+    }
+#endif
 
   /* Call the LFS to do the stat operation */
 
@@ -1759,7 +2138,10 @@ static int littlefs_stat(FAR struct inode *mountpt, FAR const char *relpath,
       return ret;
     }
 
-  relpath = littlefs_convert_path(relpath);
+#ifdef CONFIG_FS_LITTLEFS_READ_CACHE
+  gen = atomic_read(&fs->mgen);
+#endif
+
   ret = lfs_stat(&fs->lfs, relpath, &info);
   if (ret < 0)
     {
@@ -1806,6 +2188,13 @@ static int littlefs_stat(FAR struct inode *mountpt, FAR const char *relpath,
 
 errout:
   nxmutex_unlock(&fs->lock);
+#ifdef CONFIG_FS_LITTLEFS_READ_CACHE
+  if (ret >= 0)
+    {
+      littlefs_stat_insert(fs, relpath, buf, gen);
+    }
+#endif
+
   return ret;
 }
 
@@ -1875,6 +2264,7 @@ static int littlefs_chstat(FAR struct inode *mountpt,
 
   ret = littlefs_convert_result(lfs_setattr(&fs->lfs, relpath, 0,
                                             &attr, sizeof(attr)));
+  littlefs_meta_changed(fs);
   if (ret < 0)
     {
       goto errout;
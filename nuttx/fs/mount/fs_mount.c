@@ -487,6 +487,10 @@ int nx_mount(FAR const char *source, FAR const char *target,
 
   mountpt_inode->u.i_mops  = mops;
   mountpt_inode->i_private = fshandle;
+
+  /* The searches below the target now end at the mountpoint */
+
+  inode_dcache_invalidate();
   inode_unlock();
 
   /* We can release our reference to the blkdrver_inode, if the filesystem
@@ -78,6 +78,12 @@
 #  define nfs_statistics(n)
 #endif
 
+/* The attribute cache of a mount */
+
+#if CONFIG_NFS_ATTRCACHE == 0
+#  define nfs_attrcache_purge(nmp, fhandle, length)
+#endif
+
 /****************************************************************************
  *  Public Data
  ****************************************************************************/
@@ -110,6 +116,7 @@ extern "C"
 #define EXTERN extern
 #endif
 
+EXTERN int nfs_checkreply(FAR const void *response);
 EXTERN int nfs_request(FAR struct nfsmount *nmp, int procnum,
                 FAR void *request, size_t reqlen,
                 FAR void *response, size_t resplen);
@@ -126,6 +133,17 @@ EXTERN int nfs_finddir(FAR struct nfsmount *nmp, FAR const char *relpath,
               FAR struct nfs_fattr *attributes, FAR char *filename);
 EXTERN void nfs_attrupdate(FAR struct nfsnode *np,
               FAR struct nfs_fattr *attributes);
+#if CONFIG_NFS_ATTRCACHE > 0
+EXTERN bool nfs_attrcache_lookup(FAR struct nfsmount *nmp,
+              FAR const struct file_handle *dir, FAR const char *name,
+              FAR struct file_handle *fhandle, FAR struct nfs_fattr *fattr);
+EXTERN void nfs_attrcache_enter(FAR struct nfsmount *nmp,
+              FAR const struct file_handle *dir, FAR const char *name,
+              FAR const struct file_handle *fhandle,
+              FAR const struct nfs_fattr *fattr);
+EXTERN void nfs_attrcache_purge(FAR struct nfsmount *nmp,
+              FAR const nfsfh_t *fhandle, size_t length);
+#endif
 
 #undef EXTERN
 #if defined(__cplusplus)
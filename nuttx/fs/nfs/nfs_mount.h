@@ -50,6 +50,8 @@
  ****************************************************************************/
 
 #include <sys/socket.h>
+#include <sys/types.h>
+#include <stdbool.h>
 #include <nuttx/mutex.h>
 
 #include "rpc.h"
@@ -62,6 +64,45 @@
  * Public Types
  ****************************************************************************/
 
+/* A READ or WRITE RPC of the pipeline of a mount.  The RPC itself is the
+ * entry with the same index in nm_calls.
+ */
+
+struct nfsreq
+{
+  FAR struct nfsnode       *r_np;             /* File of the request */
+  uint64_t                  r_offset;         /* File offset of the data */
+  uint32_t                  r_count;          /* Bytes requested or written */
+  uint32_t                  r_len;            /* READ: Bytes left in r_data */
+  FAR uint8_t              *r_data;           /* READ: Unconsumed data */
+  bool                      r_last;           /* READ: Short read or EOF */
+
+  /* I/O buffer of the request, nm_buflen bytes.  It holds the READ reply or
+   * the WRITE call.
+   */
+
+  FAR void                 *r_iobuffer;
+
+  union
+  {
+    struct rpc_call_read    read;
+    struct rpc_reply_write  write;
+  } r_msg;
+};
+
+#if CONFIG_NFS_ATTRCACHE > 0
+/* An entry of the attribute and lookup cache */
+
+struct nfs_attrcache_s
+{
+  FAR char                 *a_name;           /* Entry name, NULL if unused */
+  clock_t                   a_expire;         /* When the entry gets stale */
+  struct file_handle        a_dir;            /* Handle of the directory */
+  struct file_handle        a_fhandle;        /* Handle of the object */
+  struct nfs_fattr          a_fattr;          /* Attributes of the object */
+};
+#endif
+
 /* Mount structure. One mount structure is allocated for each NFS mount. This
  * structure holds NFS specific information for mount.
  */
@@ -80,6 +121,25 @@ struct nfsmount
   uint16_t                  nm_wsize;         /* Max size of write RPC */
   uint16_t                  nm_readdirsize;   /* Size of a readdir RPC */
   uint16_t                  nm_buflen;        /* Size of I/O buffer */
+  bool                      nm_noac;          /* Attribute cache disabled */
+  bool                      nm_noreaddirplus; /* Server lacks READDIRPLUS */
+
+  /* The READ or WRITE RPCs in flight.  Reads are kept in a ring ordered by
+   * file offset, writes may complete in any order.
+   */
+
+  uint8_t                   nm_reqproc;       /* NFSPROC_READ/WRITE or 0 */
+  uint8_t                   nm_reqhead;       /* Oldest read */
+  uint8_t                   nm_nreqs;         /* Requests in the pipeline */
+  uint64_t                  nm_reqnext;       /* Offset of the next read */
+  FAR uint8_t              *nm_reqbuffers;    /* I/O buffers of nm_reqs[1..] */
+  struct rpcclnt_call_s     nm_calls[CONFIG_NFS_PIPELINE_DEPTH];
+  struct nfsreq             nm_reqs[CONFIG_NFS_PIPELINE_DEPTH];
+
+#if CONFIG_NFS_ATTRCACHE > 0
+  uint8_t                   nm_nextattr;      /* Next cache entry to replace */
+  struct nfs_attrcache_s    nm_attrcache[CONFIG_NFS_ATTRCACHE];
+#endif
 
   /* Set aside memory on the stack to hold the largest call message.
    * NOTE that for the case of the write call message, it is the reply
@@ -96,6 +156,7 @@ struct nfsmount
     struct rpc_call_mkdir   mkdir;
     struct rpc_call_rmdir   rmdir;
     struct rpc_call_readdir readdir;
+    struct rpc_call_readdirplus readdirplus;
     struct rpc_call_fs      fsstat;
     struct rpc_call_setattr setattr;
     struct rpc_call_fs      fsinfo;
@@ -104,7 +165,8 @@ struct nfsmount
 
   /* I/O buffer (must be a aligned to 32-bit boundaries).  This buffer used
    * for all reply messages EXCEPT for the WRITE RPC. In that case it is used
-   * for the WRITE call message that contains the data to be written.  This
+   * for the WRITE call message that contains the data to be written.  It is
+   * also the I/O buffer of the first request of the pipeline.  This
    * buffer must be dynamically sized based on the characteristics of the
    * server and upon the configuration of the NuttX network.  It must be
    * sized to hold the largest possible WRITE call message or READ response
@@ -71,6 +71,7 @@ struct nfsnode
   struct timespec     n_ctime;      /* File creation time */
   nfsfh_t             n_fhandle;    /* NFS File Handle */
   uint64_t            n_size;       /* Current size of file */
+  int                 n_error;      /* Error of a completed write */
 };
 
 #endif /* __FS_NFS_NFS_NODE_H */
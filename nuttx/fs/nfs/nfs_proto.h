@@ -551,6 +551,24 @@ struct READDIR3resok
    (sizeof(uint32_t) + sizeof(struct nfs_fattr) + \
     NFSX_V3COOKIEVERF + sizeof(uint32_t) + (n))
 
+struct READDIRPLUS3args
+{
+  struct file_handle dir;                           /* Variable length */
+  nfsuint64          cookie;
+  uint8_t            cookieverf[NFSX_V3COOKIEVERF];
+  uint32_t           dircount;
+  uint32_t           maxcount;
+};
+
+/* The READDIRPLUS reply has the same header as the READDIR reply.  The
+ * cookie of every entry is followed by:
+ *
+ *  Attributes follow (4 bytes)
+ *  Attributes (sizeof(struct nfs_fattr), if they follow)
+ *  Handle follows (4 bytes)
+ *  File handle (variable length, if it follows)
+ */
+
 struct FS3args
 {
   struct file_handle fsroot;
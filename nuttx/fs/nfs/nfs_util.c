@@ -38,6 +38,9 @@
 #include <errno.h>
 #include <debug.h>
 
+#include <nuttx/clock.h>
+
+#include "fs_heap.h"
 #include "rpc.h"
 #include "nfs.h"
 #include "nfs_proto.h"
@@ -101,10 +104,107 @@ static inline int nfs_pathsegment(FAR const char **path, FAR char *buffer,
     }
 }
 
+#if CONFIG_NFS_ATTRCACHE > 0
+/****************************************************************************
+ * Name: nfs_attrcache_timeout
+ *
+ * Description:
+ *   Return how long the attributes of an object may be cached.  Like other
+ *   NFS clients, this is a tenth of the time since the object was last
+ *   modified, within the configured bounds.
+ *
+ ****************************************************************************/
+
+static clock_t nfs_attrcache_timeout(FAR const struct nfs_fattr *fattr)
+{
+  struct timespec mtime;
+  struct timespec now;
+  time_t timeout;
+
+  clock_gettime(CLOCK_REALTIME, &now);
+  fxdr_nfsv3time(&fattr->fa_mtime, &mtime);
+
+  timeout = (now.tv_sec - mtime.tv_sec) / 10;
+  if (timeout < CONFIG_NFS_ACTIMEO_MIN)
+    {
+      timeout = CONFIG_NFS_ACTIMEO_MIN;
+    }
+  else if (timeout > CONFIG_NFS_ACTIMEO_MAX)
+    {
+      timeout = CONFIG_NFS_ACTIMEO_MAX;
+    }
+
+  return SEC2TICK(timeout);
+}
+
+/****************************************************************************
+ * Name: nfs_attrcache_find
+ *
+ * Description:
+ *   Find the cache entry of the name in the directory, or return NULL.
+ *
+ ****************************************************************************/
+
+static FAR struct nfs_attrcache_s *
+nfs_attrcache_find(FAR struct nfsmount *nmp,
+                   FAR const struct file_handle *dir, FAR const char *name)
+{
+  FAR struct nfs_attrcache_s *entry;
+  int i;
+
+  for (i = 0; i < CONFIG_NFS_ATTRCACHE; i++)
+    {
+      entry = &nmp->nm_attrcache[i];
+      if (entry->a_name != NULL && entry->a_dir.length == dir->length &&
+          memcmp(&entry->a_dir.handle, &dir->handle, dir->length) == 0 &&
+          strcmp(entry->a_name, name) == 0)
+        {
+          return entry;
+        }
+    }
+
+  return NULL;
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: nfs_checkreply
+ *
+ * Description:
+ *   Verify the NFS level of the values returned in a reply.
+ *
+ * Returned Value:
+ *   Zero on success; a negative errno value on failure.
+ *
+ ****************************************************************************/
+
+int nfs_checkreply(FAR const void *response)
+{
+  struct nfs_reply_header replyh;
+
+  memcpy(&replyh, response, sizeof(struct nfs_reply_header));
+
+  if (replyh.nfs_status != 0)
+    {
+      /* NFS_ERRORS are the same as NuttX errno values */
+
+      return -fxdr_unsigned(uint32_t, replyh.nfs_status);
+    }
+
+  if (replyh.rh.rpc_verfi.authtype != 0)
+    {
+      ferr("ERROR: NFS authtype %d from server\n",
+           fxdr_unsigned(int, replyh.rh.rpc_verfi.authtype));
+      return -EOPNOTSUPP;
+    }
+
+  return OK;
+}
+
 /****************************************************************************
  * Name: nfs_request
  *
@@ -122,7 +222,6 @@ int nfs_request(FAR struct nfsmount *nmp, int procnum,
                 FAR void *response, size_t resplen)
 {
   FAR struct rpcclnt *clnt = nmp->nm_rpcclnt;
-  struct nfs_reply_header replyh;
   int error;
 
   error = rpcclnt_request(clnt, procnum, NFS_PROG, NFS_VER3,
@@ -158,25 +257,13 @@ int nfs_request(FAR struct nfsmount *nmp, int procnum,
         }
     }
 
-  memcpy(&replyh, response, sizeof(struct nfs_reply_header));
-
-  if (replyh.nfs_status != 0)
+  error = nfs_checkreply(response);
+  if (error == OK)
     {
-      /* NFS_ERRORS are the same as NuttX errno values */
-
-      return -fxdr_unsigned(uint32_t, replyh.nfs_status);
+      finfo("NFS_SUCCESS\n");
     }
 
-  if (replyh.rh.rpc_verfi.authtype != 0)
-    {
-      error = -EOPNOTSUPP;
-      ferr("ERROR: NFS authtype %d from server\n",
-           fxdr_unsigned(int, replyh.rh.rpc_verfi.authtype));
-      return error;
-    }
-
-  finfo("NFS_SUCCESS\n");
-  return OK;
+  return error;
 }
 
 /****************************************************************************
@@ -191,6 +278,9 @@ int nfs_request(FAR struct nfsmount *nmp, int procnum,
  *   call message is variable length, depending upon the size of the path
  *   name.
  *
+ *   If the directory attributes are not needed, the answer may come from
+ *   the attribute cache without a LOOKUP RPC.
+ *
  ****************************************************************************/
 
 int nfs_lookup(FAR struct nfsmount *nmp, FAR const char *filename,
@@ -198,6 +288,9 @@ int nfs_lookup(FAR struct nfsmount *nmp, FAR const char *filename,
                FAR struct nfs_fattr *obj_attributes,
                FAR struct nfs_fattr *dir_attributes)
 {
+#if CONFIG_NFS_ATTRCACHE > 0
+  struct file_handle dir;
+#endif
   FAR uint32_t *ptr;
   uint32_t value;
   int reqlen;
@@ -206,6 +299,16 @@ int nfs_lookup(FAR struct nfsmount *nmp, FAR const char *filename,
 
   DEBUGASSERT(nmp && filename && fhandle);
 
+#if CONFIG_NFS_ATTRCACHE > 0
+  if (dir_attributes == NULL &&
+      nfs_attrcache_lookup(nmp, fhandle, filename, fhandle, obj_attributes))
+    {
+      return OK;
+    }
+
+  memcpy(&dir, fhandle, SIZEOF_file_handle(fhandle->length));
+#endif
+
   /* Get the length of the string to be sent */
 
   namelen = strlen(filename);
@@ -286,6 +389,10 @@ int nfs_lookup(FAR struct nfsmount *nmp, FAR const char *filename,
           memcpy(obj_attributes, ptr, sizeof(struct nfs_fattr));
         }
 
+#if CONFIG_NFS_ATTRCACHE > 0
+      nfs_attrcache_enter(nmp, &dir, filename, fhandle,
+                          (FAR struct nfs_fattr *)ptr);
+#endif
       ptr += uint32_increment(sizeof(struct nfs_fattr));
     }
 
@@ -320,11 +427,19 @@ int nfs_findnode(FAR struct nfsmount *nmp, FAR const char *relpath,
                  FAR struct nfs_fattr *dir_attributes)
 {
   FAR const char *path = relpath;
+  struct nfs_fattr attributes;
   char            buffer[NAME_MAX + 1];
   char            terminator;
   uint32_t         tmp;
   int             error;
 
+  /* The attributes of the intermediate directories are always needed */
+
+  if (obj_attributes == NULL)
+    {
+      obj_attributes = &attributes;
+    }
+
   /* Start with the file handle of the root directory.  */
 
   fhandle->length = nmp->nm_fhsize;
@@ -528,3 +643,126 @@ void nfs_attrupdate(FAR struct nfsnode *np, FAR struct nfs_fattr *attributes)
   fxdr_nfsv3time(&attributes->fa_mtime, &np->n_mtime);
   fxdr_nfsv3time(&attributes->fa_ctime, &np->n_ctime);
 }
+
+#if CONFIG_NFS_ATTRCACHE > 0
+/****************************************************************************
+ * Name: nfs_attrcache_lookup
+ *
+ * Description:
+ *   Look up a name in a directory in the attribute cache.  The directory
+ *   and the returned handles may be the same buffer.
+ *
+ * Returned Value:
+ *   True if the handle and attributes of the object were found and are
+ *   still fresh.
+ *
+ ****************************************************************************/
+
+bool nfs_attrcache_lookup(FAR struct nfsmount *nmp,
+                          FAR const struct file_handle *dir,
+                          FAR const char *name,
+                          FAR struct file_handle *fhandle,
+                          FAR struct nfs_fattr *fattr)
+{
+  FAR struct nfs_attrcache_s *entry;
+
+  if (nmp->nm_noac)
+    {
+      return false;
+    }
+
+  entry = nfs_attrcache_find(nmp, dir, name);
+  if (entry == NULL)
+    {
+      return false;
+    }
+
+  if ((sclock_t)(entry->a_expire - clock_systime_ticks()) <= 0)
+    {
+      fs_heap_free(entry->a_name);
+      entry->a_name = NULL;
+      return false;
+    }
+
+  memcpy(fhandle, &entry->a_fhandle,
+         SIZEOF_file_handle(entry->a_fhandle.length));
+  if (fattr != NULL)
+    {
+      memcpy(fattr, &entry->a_fattr, sizeof(struct nfs_fattr));
+    }
+
+  return true;
+}
+
+/****************************************************************************
+ * Name: nfs_attrcache_enter
+ *
+ * Description:
+ *   Save the handle and attributes of a name in a directory, replacing
+ *   the entries round robin once the cache is full.
+ *
+ ****************************************************************************/
+
+void nfs_attrcache_enter(FAR struct nfsmount *nmp,
+                         FAR const struct file_handle *dir,
+                         FAR const char *name,
+                         FAR const struct file_handle *fhandle,
+                         FAR const struct nfs_fattr *fattr)
+{
+  FAR struct nfs_attrcache_s *entry;
+
+  if (nmp->nm_noac)
+    {
+      return;
+    }
+
+  entry = nfs_attrcache_find(nmp, dir, name);
+  if (entry == NULL)
+    {
+      entry = &nmp->nm_attrcache[nmp->nm_nextattr];
+      nmp->nm_nextattr = (nmp->nm_nextattr + 1) % CONFIG_NFS_ATTRCACHE;
+
+      fs_heap_free(entry->a_name);
+      entry->a_name = fs_heap_strdup(name);
+      if (entry->a_name == NULL)
+        {
+          return;
+        }
+
+      memcpy(&entry->a_dir, dir, SIZEOF_file_handle(dir->length));
+    }
+
+  memcpy(&entry->a_fhandle, fhandle, SIZEOF_file_handle(fhandle->length));
+  memcpy(&entry->a_fattr, fattr, sizeof(struct nfs_fattr));
+  entry->a_expire = clock_systime_ticks() + nfs_attrcache_timeout(fattr);
+}
+
+/****************************************************************************
+ * Name: nfs_attrcache_purge
+ *
+ * Description:
+ *   Drop the cached attributes of an object that was modified, or the
+ *   whole cache if fhandle is NULL.  The latter is used when names are
+ *   created or removed.
+ *
+ ****************************************************************************/
+
+void nfs_attrcache_purge(FAR struct nfsmount *nmp,
+                         FAR const nfsfh_t *fhandle, size_t length)
+{
+  FAR struct nfs_attrcache_s *entry;
+  int i;
+
+  for (i = 0; i < CONFIG_NFS_ATTRCACHE; i++)
+    {
+      entry = &nmp->nm_attrcache[i];
+      if (entry->a_name != NULL &&
+          (fhandle == NULL || (entry->a_fhandle.length == length &&
+           memcmp(&entry->a_fhandle.handle, fhandle, length) == 0)))
+        {
+          fs_heap_free(entry->a_name);
+          entry->a_name = NULL;
+        }
+    }
+}
+#endif
@@ -48,6 +48,7 @@
 
 #include <nuttx/config.h>
 
+#include <sys/param.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/statfs.h>
@@ -136,6 +137,9 @@ static int     nfs_fileopen(FAR struct nfsmount *nmp,
                    FAR struct nfsnode *np, FAR const char *relpath,
                    int oflags, mode_t mode);
 
+static void    nfs_pipe_abort(FAR struct nfsmount *nmp, int error);
+static void    nfs_pipe_flush(FAR struct nfsmount *nmp);
+static int     nfs_write_error(FAR struct nfsnode *np);
 static int     nfs_open(FAR struct file *filep, FAR const char *relpath,
                    int oflags, mode_t mode);
 static int     nfs_close(FAR struct file *filep);
@@ -336,6 +340,7 @@ static int nfs_filecreate(FAR struct nfsmount *nmp, FAR struct nfsnode *np,
 
   /* Send the NFS request. */
 
+  nfs_attrcache_purge(nmp, NULL, 0);
   nfs_statistics(NFSPROC_CREATE);
   ret = nfs_request(nmp, NFSPROC_CREATE,
                     &nmp->nm_msgbuffer.create, reqlen,
@@ -503,6 +508,7 @@ static int nfs_filechstat(FAR struct nfsmount *nmp, FAR struct nfsnode *np,
 
   /* Perform the SETATTR RPC */
 
+  nfs_attrcache_purge(nmp, &np->n_fhandle, np->n_fhsize);
   nfs_statistics(NFSPROC_SETATTR);
   ret = nfs_request(nmp, NFSPROC_SETATTR,
                     &nmp->nm_msgbuffer.setattr, reqlen,
@@ -681,6 +687,8 @@ static int nfs_open(FAR struct file *filep, FAR const char *relpath,
       return ret;
     }
 
+  nfs_pipe_flush(nmp);
+
   /* Try to open an existing file at that path */
 
   ret = nfs_fileopen(nmp, np, relpath, oflags, mode);
@@ -781,6 +789,7 @@ static int nfs_close(FAR struct file *filep)
   FAR struct nfsnode  *np;
   FAR struct nfsnode  *prev;
   FAR struct nfsnode  *curr;
+  int error = OK;
   int ret;
 
   /* Sanity checks */
@@ -802,6 +811,10 @@ static int nfs_close(FAR struct file *filep)
       return ret;
     }
 
+  /* No request in flight may refer to the file once it is freed */
+
+  nfs_pipe_flush(nmp);
+
   /* Decrement the reference count.  If the reference count would not
    * decrement to zero, then that is all we have to do.
    */
@@ -821,6 +834,10 @@ static int nfs_close(FAR struct file *filep)
 
   else
     {
+      /* Report the failure of a write that completed after write() */
+
+      error = nfs_write_error(np);
+
       /* Assume file structure won't be found. This should never happen. */
 
       ret = -EINVAL;
@@ -859,12 +876,457 @@ static int nfs_close(FAR struct file *filep)
 
   filep->f_priv = NULL;
   nxmutex_unlock(&nmp->nm_lock);
+  return ret < 0 ? ret : error;
+}
+
+/****************************************************************************
+ * Name: nfs_pipe_reconnect
+ *
+ * Description:
+ *   Re-establish the connection to the server and send the READ and WRITE
+ *   RPCs in flight again.
+ *
+ ****************************************************************************/
+
+static int nfs_pipe_reconnect(FAR struct nfsmount *nmp)
+{
+  int ret;
+
+  finfo("Reconnect due to timeout\n");
+
+  ret = rpcclnt_connect(nmp->nm_rpcclnt);
+  if (ret == OK)
+    {
+      ret = rpcclnt_resend(nmp->nm_rpcclnt, nmp->nm_calls,
+                           CONFIG_NFS_PIPELINE_DEPTH);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: nfs_pipe_start
+ *
+ * Description:
+ *   Send the READ or WRITE RPC of the pipeline request 'index' without
+ *   waiting for its reply.
+ *
+ ****************************************************************************/
+
+static int nfs_pipe_start(FAR struct nfsmount *nmp, int index, int procnum)
+{
+  FAR struct rpcclnt_call_s *call = &nmp->nm_calls[index];
+  int ret;
+
+  nfs_statistics(procnum);
+  ret = rpcclnt_start(nmp->nm_rpcclnt, call, procnum, NFS_PROG, NFS_VER3);
+  if (ret == -ENOTCONN)
+    {
+      ret = nfs_pipe_reconnect(nmp);
+      if (ret == OK)
+        {
+          ret = rpcclnt_start(nmp->nm_rpcclnt, call, procnum,
+                              NFS_PROG, NFS_VER3);
+        }
+    }
+
+  if (ret < 0)
+    {
+      ferr("ERROR: rpcclnt_start failed: %d\n", ret);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: nfs_pipe_wait
+ *
+ * Description:
+ *   Wait for the reply to one of the READ or WRITE RPCs in flight.
+ *
+ * Returned Value:
+ *   The index of the completed request, with the NFS status of its reply in
+ *   'status'; a negated errno value if the RPCs in flight were lost.
+ *
+ ****************************************************************************/
+
+static int nfs_pipe_wait(FAR struct nfsmount *nmp, FAR int *status)
+{
+  int ret;
+
+  ret = rpcclnt_wait(nmp->nm_rpcclnt, nmp->nm_calls,
+                     CONFIG_NFS_PIPELINE_DEPTH);
+  if (ret == -ENOTCONN)
+    {
+      ret = nfs_pipe_reconnect(nmp);
+      if (ret == OK)
+        {
+          ret = rpcclnt_wait(nmp->nm_rpcclnt, nmp->nm_calls,
+                             CONFIG_NFS_PIPELINE_DEPTH);
+        }
+    }
+
+  if (ret < 0)
+    {
+      ferr("ERROR: rpcclnt_wait failed: %d\n", ret);
+      return ret;
+    }
+
+  *status = nfs_checkreply(nmp->nm_calls[ret].response);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: nfs_pipe_abort
+ *
+ * Description:
+ *   Give up all the requests of the pipeline.  Late replies to them are
+ *   dropped by the RPC layer.  A write that was given up fails with
+ *   'error', which is reported by the next write(), fsync() or close() of
+ *   its file.
+ *
+ ****************************************************************************/
+
+static void nfs_pipe_abort(FAR struct nfsmount *nmp, int error)
+{
+  FAR struct nfsnode *np;
+  int i;
+
+  for (i = 0; i < CONFIG_NFS_PIPELINE_DEPTH; i++)
+    {
+      np = nmp->nm_reqs[i].r_np;
+      if (nmp->nm_reqproc == NFSPROC_WRITE && nmp->nm_calls[i].xid != 0 &&
+          np->n_error == 0)
+        {
+          np->n_error = error;
+        }
+
+      nmp->nm_calls[i].xid = 0;
+    }
+
+  nmp->nm_nreqs = 0;
+}
+
+/****************************************************************************
+ * Name: nfs_write_done
+ *
+ * Description:
+ *   Process the reply to a WRITE RPC of the pipeline.  Errors are recorded
+ *   in the file and reported by the next write(), fsync() or close().
+ *
+ ****************************************************************************/
+
+static void nfs_write_done(FAR struct nfsmount *nmp, int index, int status)
+{
+  FAR struct nfsreq  *req = &nmp->nm_reqs[index];
+  FAR struct nfsnode *np = req->r_np;
+  FAR struct rpc_reply_write *reply = nmp->nm_calls[index].response;
+  FAR uint32_t       *ptr;
+  uint64_t            size;
+  uint32_t            tmp;
+
+  nmp->nm_nreqs--;
+  if (status == OK)
+    {
+      ptr = (FAR uint32_t *)&reply->write;
+
+      /* Parse file_wcc.  First, check if WCC attributes follow. */
+
+      tmp = *ptr++;
+      if (tmp != 0)
+        {
+          /* Yes.. WCC attributes follow.  But we just skip over them. */
+
+          ptr += uint32_increment(sizeof(struct wcc_attr));
+        }
+
+      /* Check if normal file attributes follow.  They may predate other
+       * writes in flight, so the file does not shrink here.
+       */
+
+      tmp = *ptr++;
+      if (tmp != 0)
+        {
+          size = np->n_size;
+          nfs_attrupdate(np, (FAR struct nfs_fattr *)ptr);
+          if (np->n_size < size)
+            {
+              np->n_size = size;
+            }
+
+          ptr += uint32_increment(sizeof(struct nfs_fattr));
+        }
+
+      /* Get the count of bytes actually written.  The data after a short
+       * write was not written, which is an error here.
+       */
+
+      tmp = fxdr_unsigned(uint32_t, *ptr);
+      if (tmp != req->r_count)
+        {
+          status = -EIO;
+        }
+    }
+
+  if (status < 0 && np->n_error == 0)
+    {
+      ferr("ERROR: WRITE at %" PRIu64 " failed: %d\n",
+           req->r_offset, status);
+      np->n_error = status;
+    }
+}
+
+/****************************************************************************
+ * Name: nfs_read_done
+ *
+ * Description:
+ *   Process the reply to a READ RPC of the pipeline.
+ *
+ ****************************************************************************/
+
+static int nfs_read_done(FAR struct nfsmount *nmp, int index, int status)
+{
+  FAR struct nfsreq *req = &nmp->nm_reqs[index];
+  FAR uint32_t      *ptr;
+  uint32_t           tmp;
+
+  if (status < 0)
+    {
+      ferr("ERROR: READ at %" PRIu64 " failed: %d\n",
+           req->r_offset, status);
+      return status;
+    }
+
+  /* Get a pointer to the beginning of the NFS response data */
+
+  ptr = (FAR uint32_t *)
+    &((FAR struct rpc_reply_read *)nmp->nm_calls[index].response)->read;
+
+  /* Check if attributes are included in the responses */
+
+  tmp = *ptr++;
+  if (tmp != 0)
+    {
+      /* Yes.. Update the cached file status in the file structure. */
+
+      nfs_attrupdate(req->r_np, (FAR struct nfs_fattr *)ptr);
+      ptr += uint32_increment(sizeof(struct nfs_fattr));
+    }
+
+  /* Skip the count, which is the same as the length of the data */
+
+  ptr++;
+
+  /* Then come the EOF indication and the length of the read data followed
+   * by the data itself.  The reads after a short read or the end of the
+   * file are not used.
+   */
+
+  tmp          = *ptr++;
+  req->r_len   = fxdr_unsigned(uint32_t, *ptr);
+  req->r_data  = (FAR uint8_t *)(ptr + 1);
+  req->r_last  = tmp != 0 || req->r_len < req->r_count;
+
+  return req->r_len > req->r_count ? -EIO : OK;
+}
+
+/****************************************************************************
+ * Name: nfs_read_start
+ *
+ * Description:
+ *   Send a READ RPC for the data of the file following the reads in the
+ *   pipeline.
+ *
+ ****************************************************************************/
+
+static int nfs_read_start(FAR struct nfsmount *nmp, FAR struct nfsnode *np)
+{
+  FAR struct nfsreq *req;
+  FAR uint32_t      *ptr;
+  size_t             readsize;
+  size_t             reqlen;
+  size_t             tmp;
+  int                index;
+  int                ret;
+
+  index = (nmp->nm_reqhead + nmp->nm_nreqs) % CONFIG_NFS_PIPELINE_DEPTH;
+  req   = &nmp->nm_reqs[index];
+
+  /* Make sure that the attempted read size does not exceed the RPC maximum,
+   * the IO buffer size or the data left in the file.
+   */
+
+  readsize = nmp->nm_rsize;
+  tmp = SIZEOF_rpc_reply_read(readsize);
+  if (tmp > nmp->nm_buflen)
+    {
+      readsize -= (tmp - nmp->nm_buflen);
+    }
+
+  if (readsize > np->n_size - nmp->nm_reqnext)
+    {
+      readsize = np->n_size - nmp->nm_reqnext;
+    }
+
+  /* Initialize the request */
+
+  ptr     = (FAR uint32_t *)&req->r_msg.read.read;
+  reqlen  = 0;
+
+  /* Copy the variable length, file handle */
+
+  *ptr++  = txdr_unsigned((uint32_t)np->n_fhsize);
+  reqlen += sizeof(uint32_t);
+
+  memcpy(ptr, &np->n_fhandle, np->n_fhsize);
+  reqlen += uint32_alignup(np->n_fhsize);
+  ptr    += uint32_increment(np->n_fhsize);
+
+  /* Copy the file offset */
+
+  txdr_hyper(nmp->nm_reqnext, ptr);
+  ptr += 2;
+  reqlen += 2*sizeof(uint32_t);
+
+  /* Set the readsize */
+
+  *ptr = txdr_unsigned(readsize);
+  reqlen += sizeof(uint32_t);
+
+  /* Send the read */
+
+  finfo("Reading %zu bytes at %" PRIu64 "\n", readsize, nmp->nm_reqnext);
+
+  nmp->nm_calls[index].reqlen = sizeof(struct rpc_call_header) + reqlen;
+  req->r_np     = np;
+  req->r_offset = nmp->nm_reqnext;
+  req->r_count  = readsize;
+  req->r_len    = 0;
+
+  ret = nfs_pipe_start(nmp, index, NFSPROC_READ);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  nmp->nm_nreqs++;
+  nmp->nm_reqnext += readsize;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nfs_pipe_begin
+ *
+ * Description:
+ *   Prepare the pipeline for READ or WRITE RPCs, completing the RPCs of the
+ *   other kind first.  The requests of a READ pipeline receive the replies
+ *   into their I/O buffers, those of a WRITE pipeline send the calls from
+ *   them.
+ *
+ ****************************************************************************/
+
+static void nfs_pipe_begin(FAR struct nfsmount *nmp, int procnum)
+{
+  FAR struct rpcclnt_call_s *call;
+  FAR struct nfsreq *req;
+  int i;
+
+  if (nmp->nm_reqproc == procnum)
+    {
+      return;
+    }
+
+  nfs_pipe_flush(nmp);
+
+  for (i = 0; i < CONFIG_NFS_PIPELINE_DEPTH; i++)
+    {
+      call = &nmp->nm_calls[i];
+      req  = &nmp->nm_reqs[i];
+
+      if (procnum == NFSPROC_READ)
+        {
+          call->request  = &req->r_msg.read;
+          call->response = req->r_iobuffer;
+          call->resplen  = nmp->nm_buflen;
+        }
+      else
+        {
+          call->request  = req->r_iobuffer;
+          call->response = &req->r_msg.write;
+          call->resplen  = sizeof(struct rpc_reply_write);
+        }
+    }
+
+  nmp->nm_reqproc = procnum;
+}
+
+/****************************************************************************
+ * Name: nfs_pipe_flush
+ *
+ * Description:
+ *   Wait for the WRITE RPCs in flight and drop the data read ahead.  This
+ *   must be done before any other RPC is sent and before a file is closed.
+ *
+ ****************************************************************************/
+
+static void nfs_pipe_flush(FAR struct nfsmount *nmp)
+{
+  int status;
+  int ret;
+  int i;
+
+  while (nmp->nm_reqproc == NFSPROC_WRITE && nmp->nm_nreqs > 0)
+    {
+      ret = nfs_pipe_wait(nmp, &status);
+      if (ret < 0)
+        {
+          nfs_pipe_abort(nmp, ret);
+          break;
+        }
+
+      nfs_write_done(nmp, ret, status);
+    }
+
+  nfs_pipe_abort(nmp, OK);
+
+  /* The READ replies may have moved between the I/O buffers */
+
+  if (nmp->nm_reqproc == NFSPROC_READ)
+    {
+      for (i = 0; i < CONFIG_NFS_PIPELINE_DEPTH; i++)
+        {
+          nmp->nm_reqs[i].r_iobuffer = nmp->nm_calls[i].response;
+        }
+    }
+
+  nmp->nm_reqproc = 0;
+}
+
+/****************************************************************************
+ * Name: nfs_write_error
+ *
+ * Description:
+ *   Return and clear the error of a write of the file that completed after
+ *   write() returned.  The pipeline must be flushed.
+ *
+ ****************************************************************************/
+
+static int nfs_write_error(FAR struct nfsnode *np)
+{
+  int ret = np->n_error;
+
+  np->n_error = 0;
   return ret;
 }
 
 /****************************************************************************
  * Name: nfs_read
  *
+ * Description:
+ *   Read data from a file.  Up to CONFIG_NFS_PIPELINE_DEPTH READ RPCs are
+ *   kept in flight, the data beyond the end of the user buffer is kept for
+ *   the next sequential read of the file.
+ *
  * Returned Value:
  *   The (non-negative) number of bytes read on success; a negated errno
  *   value on failure.
@@ -876,11 +1338,10 @@ static ssize_t nfs_read(FAR struct file *filep, FAR char *buffer,
 {
   FAR struct nfsmount       *nmp;
   FAR struct nfsnode        *np;
-  ssize_t                    readsize;
-  ssize_t                    tmp;
-  ssize_t                    bytesread;
-  size_t                     reqlen;
-  FAR uint32_t              *ptr;
+  FAR struct nfsreq         *req;
+  ssize_t                    bytesread = 0;
+  size_t                     readsize;
+  int                        status;
   int                        ret = 0;
 
   finfo("Read %zu bytes from offset %jd\n",
@@ -907,113 +1368,78 @@ static ssize_t nfs_read(FAR struct file *filep, FAR char *buffer,
    * it does not exceed the number of bytes left in the file.
    */
 
-  tmp = np->n_size - filep->f_pos;
-  if (buflen > tmp)
+  if (filep->f_pos >= np->n_size)
     {
-      buflen = tmp;
+      buflen = 0;
+    }
+  else if (buflen > np->n_size - filep->f_pos)
+    {
+      buflen = np->n_size - filep->f_pos;
       finfo("Read size truncated to %zu\n", buflen);
     }
 
-  /* Now loop until we fill the user buffer (or hit the end of the file) */
+  /* The data read ahead is only used by sequential reads of the file */
+
+  nfs_pipe_begin(nmp, NFSPROC_READ);
 
-  for (bytesread = 0; bytesread < buflen; )
+  req = &nmp->nm_reqs[nmp->nm_reqhead];
+  if (nmp->nm_nreqs > 0 &&
+      (req->r_np != np || req->r_offset != filep->f_pos))
     {
-      /* Make sure that the attempted read size does not exceed the RPC
-       * maximum
-       */
+      nfs_pipe_abort(nmp, OK);
+    }
 
-      readsize = buflen - bytesread;
-      if (readsize > nmp->nm_rsize)
-        {
-          readsize = nmp->nm_rsize;
-        }
+  if (nmp->nm_nreqs == 0)
+    {
+      nmp->nm_reqnext = filep->f_pos;
+    }
 
-      /* Make sure that the attempted read size does not exceed the IO buffer
-       * size
-       */
+  /* Now loop until we fill the user buffer (or hit the end of the file) */
+
+  while (bytesread < buflen)
+    {
+      /* Keep the pipeline full, up to the end of the file */
 
-      tmp = SIZEOF_rpc_reply_read(readsize);
-      if (tmp > nmp->nm_buflen)
+      while (nmp->nm_nreqs < CONFIG_NFS_PIPELINE_DEPTH &&
+             nmp->nm_reqnext < np->n_size)
         {
-          readsize -= (tmp - nmp->nm_buflen);
+          ret = nfs_read_start(nmp, np);
+          if (ret < 0)
+            {
+              goto errout_with_abort;
+            }
         }
 
-      /* Initialize the request */
-
-      ptr     = (FAR uint32_t *)&nmp->nm_msgbuffer.read.read;
-      reqlen  = 0;
-
-      /* Copy the variable length, file handle */
-
-      *ptr++  = txdr_unsigned((uint32_t)np->n_fhsize);
-      reqlen += sizeof(uint32_t);
-
-      memcpy(ptr, &np->n_fhandle, np->n_fhsize);
-      reqlen += uint32_alignup(np->n_fhsize);
-      ptr    += uint32_increment(np->n_fhsize);
-
-      /* Copy the file offset */
-
-      txdr_hyper((uint64_t)filep->f_pos, ptr);
-      ptr += 2;
-      reqlen += 2*sizeof(uint32_t);
-
-      /* Set the readsize */
-
-      *ptr = txdr_unsigned(readsize);
-      reqlen += sizeof(uint32_t);
-
-      /* Perform the read */
-
-      finfo("Reading %zu bytes\n", readsize);
-      nfs_statistics(NFSPROC_READ);
-      ret = nfs_request(nmp, NFSPROC_READ,
-                        &nmp->nm_msgbuffer.read, reqlen,
-                        nmp->nm_iobuffer, nmp->nm_buflen);
-      if (ret)
+      if (nmp->nm_nreqs == 0)
         {
-          ferr("ERROR: nfs_request failed: %d\n", ret);
-          goto errout_with_lock;
+          break;
         }
 
-      /* The read was successful.  Get a pointer to the beginning of the NFS
-       * response data.
-       */
-
-      ptr = (FAR uint32_t *)
-        &((FAR struct rpc_reply_read *)nmp->nm_iobuffer)->read;
+      /* Wait for the oldest read, the replies to the others are kept */
 
-      /* Check if attributes are included in the responses */
-
-      tmp = *ptr++;
-      if (tmp != 0)
+      req = &nmp->nm_reqs[nmp->nm_reqhead];
+      while (nmp->nm_calls[nmp->nm_reqhead].xid != 0)
         {
-          /* Yes.. Update the cached file status in the file structure. */
+          ret = nfs_pipe_wait(nmp, &status);
+          if (ret >= 0)
+            {
+              ret = nfs_read_done(nmp, ret, status);
+            }
 
-          nfs_attrupdate(np, (FAR struct nfs_fattr *)ptr);
-          ptr += uint32_increment(sizeof(struct nfs_fattr));
+          if (ret < 0)
+            {
+              goto errout_with_abort;
+            }
         }
 
-      /* This is followed by the count of data read.  Isn't this
-       * the same as the length that is included in the read data?
-       *
-       * Just skip over if for now.
-       */
-
-      ptr++;
-
-      /* Next comes an EOF indication.  Save that in tmp for now. */
-
-      tmp = *ptr++;
-
-      /* Then the length of the read data followed by the read data itself */
-
-      readsize = fxdr_unsigned(uint32_t, *ptr);
-      ptr++;
-
       /* Copy the read data into the user buffer */
 
-      memcpy(buffer, ptr, readsize);
+      readsize = MIN(req->r_len, buflen - bytesread);
+      memcpy(buffer, req->r_data, readsize);
+
+      req->r_data   += readsize;
+      req->r_len    -= readsize;
+      req->r_offset += readsize;
 
       /* Update the read state data */
 
@@ -1021,15 +1447,37 @@ static ssize_t nfs_read(FAR struct file *filep, FAR char *buffer,
       bytesread    += readsize;
       buffer       += readsize;
 
-      /* Check if we hit the end of file */
-
-      if (tmp != 0)
+      if (req->r_len > 0)
         {
           break;
         }
+
+      /* The reply is used up.  After a short read or the end of the file,
+       * the reads that follow it are dropped and sent again if needed.
+       */
+
+      if (req->r_last)
+        {
+          nfs_pipe_abort(nmp, OK);
+          nmp->nm_reqnext = filep->f_pos;
+          if (readsize == 0)
+            {
+              break;
+            }
+        }
+      else
+        {
+          nmp->nm_reqhead = (nmp->nm_reqhead + 1) %
+                            CONFIG_NFS_PIPELINE_DEPTH;
+          nmp->nm_nreqs--;
+        }
     }
 
-errout_with_lock:
+  nxmutex_unlock(&nmp->nm_lock);
+  return bytesread;
+
+errout_with_abort:
+  nfs_pipe_abort(nmp, OK);
   nxmutex_unlock(&nmp->nm_lock);
   return bytesread > 0 ? bytesread : ret;
 }
@@ -1037,6 +1485,12 @@ errout_with_lock:
 /****************************************************************************
  * Name: nfs_write
  *
+ * Description:
+ *   Write data to a file.  Up to CONFIG_NFS_PIPELINE_DEPTH WRITE RPCs are
+ *   kept in flight, so write() may return before the server has replied.
+ *   The failure of such a write is reported by the next write(), fsync()
+ *   or close() of the file.
+ *
  * Returned Value:
  *   The (non-negative) number of bytes written on success; a negated errno
  *   value on failure.
@@ -1048,14 +1502,14 @@ static ssize_t nfs_write(FAR struct file *filep, FAR const char *buffer,
 {
   FAR struct nfsmount *nmp;
   FAR struct nfsnode  *np;
+  FAR struct nfsreq   *req;
   ssize_t              writesize;
   ssize_t              bufsize;
   ssize_t              byteswritten = 0;
   size_t               reqlen;
   FAR uint32_t        *ptr;
-  uint32_t             tmp;
-  int                  commit = 0;
-  int                  committed = NFSV3WRITE_FILESYNC;
+  int                  status;
+  int                  index;
   int                  ret;
 
   finfo("Write %zu bytes to offset %jd\n",
@@ -1078,6 +1532,15 @@ static ssize_t nfs_write(FAR struct file *filep, FAR const char *buffer,
       return (ssize_t)ret;
     }
 
+  /* Report the failure of an earlier write */
+
+  if (np->n_error < 0)
+    {
+      ret = np->n_error;
+      np->n_error = 0;
+      goto errout_with_lock;
+    }
+
   /* Check if the file size would exceed the range of off_t */
 
   if (np->n_size + buflen < np->n_size)
@@ -1086,10 +1549,33 @@ static ssize_t nfs_write(FAR struct file *filep, FAR const char *buffer,
       goto errout_with_lock;
     }
 
+  nfs_pipe_begin(nmp, NFSPROC_WRITE);
+  nfs_attrcache_purge(nmp, &np->n_fhandle, np->n_fhsize);
+
   /* Now loop until we send the entire user buffer */
 
   for (byteswritten = 0; byteswritten < buflen; )
     {
+      /* Wait for a request to complete if all of them are in flight */
+
+      while (nmp->nm_nreqs >= CONFIG_NFS_PIPELINE_DEPTH)
+        {
+          ret = nfs_pipe_wait(nmp, &status);
+          if (ret < 0)
+            {
+              nfs_pipe_abort(nmp, ret);
+              goto errout_with_lock;
+            }
+
+          nfs_write_done(nmp, ret, status);
+        }
+
+      for (index = 0; nmp->nm_calls[index].xid != 0; index++)
+        {
+        }
+
+      req = &nmp->nm_reqs[index];
+
       /* Make sure that the attempted write size does not exceed the RPC
        * maximum.
        */
@@ -1116,7 +1602,7 @@ static ssize_t nfs_write(FAR struct file *filep, FAR const char *buffer,
        */
 
       ptr     = (FAR uint32_t *)&((FAR struct rpc_call_write *)
-                  nmp->nm_iobuffer)->write;
+                  req->r_iobuffer)->write;
       reqlen  = 0;
 
       /* Copy the variable length, file handle */
@@ -1137,7 +1623,7 @@ static ssize_t nfs_write(FAR struct file *filep, FAR const char *buffer,
       /* Copy the count and stable values */
 
       *ptr++  = txdr_unsigned(writesize);
-      *ptr++  = txdr_unsigned(committed);
+      *ptr++  = txdr_unsigned(NFSV3WRITE_FILESYNC);
       reqlen += 2*sizeof(uint32_t);
 
       /* Copy a chunk of the user data into the I/O buffer */
@@ -1147,76 +1633,44 @@ static ssize_t nfs_write(FAR struct file *filep, FAR const char *buffer,
       memcpy(ptr, buffer, writesize);
       reqlen += uint32_alignup(writesize);
 
-      /* Perform the write */
-
-      nfs_statistics(NFSPROC_WRITE);
-      ret = nfs_request(nmp, NFSPROC_WRITE,
-                        nmp->nm_iobuffer, reqlen,
-                        &nmp->nm_msgbuffer.write,
-                        sizeof(struct rpc_reply_write));
-      if (ret)
-        {
-          ferr("ERROR: nfs_request failed: %d\n", ret);
-          goto errout_with_lock;
-        }
-
-      /* Get a pointer to the WRITE reply data */
-
-      ptr = (FAR uint32_t *)&nmp->nm_msgbuffer.write.write;
-
-      /* Parse file_wcc.  First, check if WCC attributes follow. */
-
-      tmp = *ptr++;
-      if (tmp != 0)
-        {
-          /* Yes.. WCC attributes follow.  But we just skip over them. */
-
-          ptr += uint32_increment(sizeof(struct wcc_attr));
-        }
+      /* Send the write */
 
-      /* Check if normal file attributes follow */
+      nmp->nm_calls[index].reqlen = sizeof(struct rpc_call_header) + reqlen;
+      req->r_np     = np;
+      req->r_offset = filep->f_pos;
+      req->r_count  = writesize;
 
-      tmp = *ptr++;
-      if (tmp != 0)
+      ret = nfs_pipe_start(nmp, index, NFSPROC_WRITE);
+      if (ret < 0)
         {
-          /* Yes.. Update the cached file status in the file structure. */
-
-          nfs_attrupdate(np, (FAR struct nfs_fattr *)ptr);
-          ptr += uint32_increment(sizeof(struct nfs_fattr));
-        }
-
-      /* Get the count of bytes actually written */
-
-      tmp = fxdr_unsigned(uint32_t, *ptr);
-      ptr++;
-
-      if (tmp < 1 || tmp > writesize)
-        {
-          ret = -EIO;
           goto errout_with_lock;
         }
 
-      writesize = tmp;
+      nmp->nm_nreqs++;
 
-      /* Determine the lowest commitment level obtained by any of the RPCs. */
+      /* Update the write state data */
 
-      commit = *ptr++;
-      if (committed == NFSV3WRITE_FILESYNC)
-        {
-          committed = commit;
-        }
-      else if (committed == NFSV3WRITE_DATASYNC &&
-               commit == NFSV3WRITE_UNSTABLE)
+      filep->f_pos += writesize;
+      byteswritten += writesize;
+      buffer       += writesize;
+
+      if (filep->f_pos > np->n_size)
         {
-          committed = commit;
+          np->n_size = filep->f_pos;
         }
+    }
 
-      /* Update the read state data */
+#if CONFIG_NFS_PIPELINE_DEPTH == 1
+  /* Without a pipeline, the data is on the server when write() returns */
 
-      filep->f_pos += writesize;
-      byteswritten += writesize;
-      buffer       += writesize;
+  nfs_pipe_flush(nmp);
+  if (np->n_error < 0)
+    {
+      ret = np->n_error;
+      np->n_error = 0;
+      byteswritten = 0;
     }
+#endif
 
 errout_with_lock:
   nxmutex_unlock(&nmp->nm_lock);
@@ -1298,7 +1752,34 @@ static off_t nfs_seek(FAR struct file *filep, off_t offset, int whence)
 
 static int nfs_sync(FAR struct file *filep)
 {
-  return 0;
+  FAR struct nfsmount *nmp;
+  FAR struct nfsnode  *np;
+  int ret;
+
+  /* Sanity checks */
+
+  DEBUGASSERT(filep->f_priv != NULL);
+
+  /* Recover our private data from the struct file instance */
+
+  nmp = filep->f_inode->i_private;
+  np  = (FAR struct nfsnode *)filep->f_priv;
+
+  DEBUGASSERT(nmp != NULL);
+
+  ret = nxmutex_lock(&nmp->nm_lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Wait for the writes in flight, they are stable once they completed */
+
+  nfs_pipe_flush(nmp);
+  ret = nfs_write_error(np);
+
+  nxmutex_unlock(&nmp->nm_lock);
+  return ret;
 }
 
 /****************************************************************************
@@ -1431,6 +1912,8 @@ static int nfs_fchstat(FAR const struct file *filep,
       return ret;
     }
 
+  nfs_pipe_flush(nmp);
+
   /* Change the file mode, owner, group and time. */
 
   ret = nfs_filechstat(nmp, np, buf, flags);
@@ -1469,6 +1952,8 @@ static int nfs_truncate(FAR struct file *filep, off_t length)
     {
       struct stat buf;
 
+      nfs_pipe_flush(nmp);
+
       /* Then perform the SETATTR RPC to set the new file size */
 
       buf.st_size = length;
@@ -1522,6 +2007,8 @@ static int nfs_opendir(FAR struct inode *mountpt, FAR const char *relpath,
       goto errout_with_ndir;
     }
 
+  nfs_pipe_flush(nmp);
+
   /* Find the NFS node associate with the path */
 
   ret = nfs_findnode(nmp, relpath, &fhandle, &obj_attributes, NULL);
@@ -1597,11 +2084,15 @@ static int nfs_readdir(FAR struct inode *mountpt,
   FAR struct nfs_dir_s *ndir;
   struct file_handle fhandle;
   struct nfs_fattr obj_attributes;
+  FAR struct nfs_fattr *attributes;
+  FAR uint32_t *handle;
+  uint32_t handlelen;
   uint32_t readsize;
   uint32_t tmp;
   FAR uint32_t *ptr;
   FAR uint8_t *name;
   unsigned int length;
+  bool plus;
   int reqlen;
   int ret;
 
@@ -1622,6 +2113,8 @@ static int nfs_readdir(FAR struct inode *mountpt,
       return ret;
     }
 
+  nfs_pipe_flush(nmp);
+
 read_dir:
   /* Request a block directory entries, copying directory information from
    * the dirent structure.
@@ -1661,15 +2154,34 @@ read_dir:
       readsize -= (tmp - nmp->nm_buflen);
     }
 
+  /* READDIRPLUS returns the attributes and handles of the entries too,
+   * which saves a LOOKUP per entry.  Its arguments only add the maximum
+   * size of the reply.
+   */
+
+  plus = !nmp->nm_noreaddirplus;
+  if (plus)
+    {
+      *ptr++   = txdr_unsigned(readsize);
+      reqlen  += sizeof(uint32_t);
+    }
+
   *ptr     = txdr_unsigned(readsize);
   reqlen  += sizeof(uint32_t);
 
   /* And read the directory */
 
-  nfs_statistics(NFSPROC_READDIR);
-  ret = nfs_request(nmp, NFSPROC_READDIR,
+  nfs_statistics(plus ? NFSPROC_READDIRPLUS : NFSPROC_READDIR);
+  ret = nfs_request(nmp, plus ? NFSPROC_READDIRPLUS : NFSPROC_READDIR,
                     &nmp->nm_msgbuffer.readdir, reqlen,
                     nmp->nm_iobuffer, nmp->nm_buflen);
+  if (plus && (ret == -NFSERR_NOTSUPP || ret == -EOPNOTSUPP))
+    {
+      finfo("READDIRPLUS not supported, using READDIR\n");
+      nmp->nm_noreaddirplus = true;
+      goto read_dir;
+    }
+
   if (ret != OK)
     {
       ferr("ERROR: nfs_request failed: %d\n", ret);
@@ -1742,6 +2254,9 @@ next_entry:
    *    Name length (4 bytes)
    *    Name string (variable size but in multiples of 4 bytes)
    *    Cookie (8 bytes)
+   *    READDIRPLUS only: Attributes follow indication (4 bytes) and
+   *      attributes, handle follows indication (4 bytes), handle length
+   *      (4 bytes) and handle (variable size)
    *    next entry (4 bytes)
    */
 
@@ -1766,6 +2281,28 @@ next_entry:
   ndir->nfs_cookie[0] = *ptr++;
   ndir->nfs_cookie[1] = *ptr++;
 
+  attributes = NULL;
+  handle     = NULL;
+  handlelen  = 0;
+
+  if (plus)
+    {
+      tmp = *ptr++;
+      if (tmp != 0)
+        {
+          attributes = (FAR struct nfs_fattr *)ptr;
+          ptr += uint32_increment(sizeof(struct nfs_fattr));
+        }
+
+      tmp = *ptr++;
+      if (tmp != 0)
+        {
+          handlelen = fxdr_unsigned(uint32_t, *ptr);
+          handle    = ptr + 1;
+          ptr      += 1 + uint32_increment(handlelen);
+        }
+    }
+
   /* Return the name of the node to the caller */
 
   if (length > NAME_MAX)
@@ -1790,11 +2327,33 @@ next_entry:
   fhandle.length = (uint32_t)ndir->nfs_fhsize;
   memcpy(&fhandle.handle, ndir->nfs_fhandle, fhandle.length);
 
-  ret = nfs_lookup(nmp, entry->d_name, &fhandle, &obj_attributes, NULL);
-  if (ret != OK)
+  if (attributes != NULL)
     {
-      ferr("ERROR: nfs_lookup failed: %d\n", ret);
-      goto errout_with_lock;
+      memcpy(&obj_attributes, attributes, sizeof(struct nfs_fattr));
+
+      /* Save the entry for the stat() that usually follows */
+
+      if (handle != NULL && handlelen <= NFSX_V3FHMAX)
+        {
+#if CONFIG_NFS_ATTRCACHE > 0
+          struct file_handle objhandle;
+
+          objhandle.length = handlelen;
+          memcpy(&objhandle.handle, handle, handlelen);
+          nfs_attrcache_enter(nmp, &fhandle, entry->d_name, &objhandle,
+                              attributes);
+#endif
+        }
+    }
+  else
+    {
+      ret = nfs_lookup(nmp, entry->d_name, &fhandle, &obj_attributes,
+                       NULL);
+      if (ret != OK)
+        {
+          ferr("ERROR: nfs_lookup failed: %d\n", ret);
+          goto errout_with_lock;
+        }
     }
 
   /* Set the dirent file type */
@@ -2038,6 +2597,7 @@ static int nfs_bind(FAR struct inode *blkdriver, FAR const void *data,
   uint32_t                    buflen;
   uint32_t                    tmp;
   int                         ret = 0;
+  int                         i;
 
   DEBUGASSERT(data && handle);
 
@@ -2100,6 +2660,30 @@ static int nfs_bind(FAR struct inode *blkdriver, FAR const void *data,
   /* Save the allocated I/O buffer size */
 
   nmp->nm_buflen = (uint16_t)buflen;
+  nmp->nm_noac   = (argp->flags & NFSMNT_NOAC) != 0;
+
+  /* The first request of the pipeline uses the I/O buffer of the mount,
+   * each of the others needs a buffer of the same size.
+   */
+
+  tmp = (buflen + 3) & ~3;
+  if (CONFIG_NFS_PIPELINE_DEPTH > 1)
+    {
+      nmp->nm_reqbuffers =
+        fs_heap_malloc((CONFIG_NFS_PIPELINE_DEPTH - 1) * tmp);
+      if (nmp->nm_reqbuffers == NULL)
+        {
+          ferr("ERROR: Failed to allocate pipeline buffers\n");
+          fs_heap_free(nmp);
+          return -ENOMEM;
+        }
+    }
+
+  nmp->nm_reqs[0].r_iobuffer = nmp->nm_iobuffer;
+  for (i = 1; i < CONFIG_NFS_PIPELINE_DEPTH; i++)
+    {
+      nmp->nm_reqs[i].r_iobuffer = nmp->nm_reqbuffers + (i - 1) * tmp;
+    }
 
   /* Initialize the allocated mountpt state structure. */
 
@@ -2188,6 +2772,7 @@ bad:
   /* Free connection-related resources */
 
   nxmutex_destroy(&nmp->nm_lock);
+  fs_heap_free(nmp->nm_reqbuffers);
   fs_heap_free(nmp);
 
   return ret;
@@ -2245,8 +2830,10 @@ static int nfs_unbind(FAR void *handle, FAR struct inode **blkdriver,
 
   /* And free any allocated resources */
 
+  nfs_attrcache_purge(nmp, NULL, 0);
   nxmutex_destroy(&nmp->nm_lock);
   fs_heap_free(nmp->nm_rpcclnt);
+  fs_heap_free(nmp->nm_reqbuffers);
   fs_heap_free(nmp);
 
   return OK;
@@ -2400,6 +2987,8 @@ static int nfs_statfs(FAR struct inode *mountpt, FAR struct statfs *sbp)
       return ret;
     }
 
+  nfs_pipe_flush(nmp);
+
   /* Fill in the statfs info */
 
   sbp->f_type = NFS_SUPER_MAGIC;
@@ -2472,6 +3061,8 @@ static int nfs_remove(FAR struct inode *mountpt, FAR const char *relpath)
       return ret;
     }
 
+  nfs_pipe_flush(nmp);
+
   /* Find the NFS node of the directory containing the file to be deleted */
 
   ret = nfs_finddir(nmp, relpath, &fhandle, &fattr, filename);
@@ -2507,6 +3098,7 @@ static int nfs_remove(FAR struct inode *mountpt, FAR const char *relpath)
 
   /* Perform the REMOVE RPC call */
 
+  nfs_attrcache_purge(nmp, NULL, 0);
   nfs_statistics(NFSPROC_REMOVE);
   ret = nfs_request(nmp, NFSPROC_REMOVE,
                     &nmp->nm_msgbuffer.removef, reqlen,
@@ -2555,6 +3147,8 @@ static int nfs_mkdir(FAR struct inode *mountpt, FAR const char *relpath,
       return ret;
     }
 
+  nfs_pipe_flush(nmp);
+
   /* Find the NFS node of the directory containing the directory to be
    * created
    */
@@ -2630,6 +3224,7 @@ static int nfs_mkdir(FAR struct inode *mountpt, FAR const char *relpath,
 
   /* Perform the MKDIR RPC */
 
+  nfs_attrcache_purge(nmp, NULL, 0);
   nfs_statistics(NFSPROC_MKDIR);
   ret = nfs_request(nmp, NFSPROC_MKDIR,
                     &nmp->nm_msgbuffer.mkdir, reqlen,
@@ -2680,6 +3275,8 @@ static int nfs_rmdir(FAR struct inode *mountpt, FAR const char *relpath)
       return ret;
     }
 
+  nfs_pipe_flush(nmp);
+
   /* Find the NFS node of the directory containing the directory to be
    * removed
    */
@@ -2717,6 +3314,7 @@ static int nfs_rmdir(FAR struct inode *mountpt, FAR const char *relpath)
 
   /* Perform the RMDIR RPC */
 
+  nfs_attrcache_purge(nmp, NULL, 0);
   nfs_statistics(NFSPROC_RMDIR);
   ret = nfs_request(nmp, NFSPROC_RMDIR,
                     &nmp->nm_msgbuffer.rmdir, reqlen,
@@ -2766,6 +3364,8 @@ static int nfs_rename(FAR struct inode *mountpt, FAR const char *oldrelpath,
       return ret;
     }
 
+  nfs_pipe_flush(nmp);
+
   /* Find the NFS node of the directory containing the 'from' object */
 
   ret = nfs_finddir(nmp, oldrelpath, &from_handle, &fattr, from_name);
@@ -2830,6 +3430,7 @@ static int nfs_rename(FAR struct inode *mountpt, FAR const char *oldrelpath,
 
   /* Perform the RENAME RPC */
 
+  nfs_attrcache_purge(nmp, NULL, 0);
   nfs_statistics(NFSPROC_RENAME);
   ret = nfs_request(nmp, NFSPROC_RENAME,
                     &nmp->nm_msgbuffer.renamef, reqlen,
@@ -2939,6 +3540,8 @@ static int nfs_stat(FAR struct inode *mountpt, FAR const char *relpath,
       return ret;
     }
 
+  nfs_pipe_flush(nmp);
+
   /* Get the file handle attributes of the requested node */
 
   ret = nfs_findnode(nmp, relpath, &fhandle, &attributes, NULL);
@@ -3004,6 +3607,8 @@ static int nfs_chstat(FAR struct inode *mountpt, FAR const char *relpath,
       return ret;
     }
 
+  nfs_pipe_flush(nmp);
+
   /* Get the file handle of the requested node */
 
   ret = nfs_findnode(nmp, relpath, &fhandle, NULL, NULL);
@@ -317,6 +317,12 @@ struct rpc_call_readdir
   struct READDIR3args readdir;
 };
 
+struct rpc_call_readdirplus
+{
+  struct rpc_call_header ch;
+  struct READDIRPLUS3args readdirplus;
+};
+
 struct rpc_call_setattr
 {
   struct rpc_call_header ch;
@@ -462,6 +468,19 @@ struct rpcclnt
   uint32_t  rc_xid;           /* Transaction id */
 };
 
+/* An RPC call that may be in flight together with other calls.  xid is
+ * zero when the call is not pending.
+ */
+
+struct rpcclnt_call_s
+{
+  FAR void *request;          /* Call message, including the RPC header */
+  size_t    reqlen;           /* Length of the call message */
+  FAR void *response;         /* Reply buffer */
+  size_t    resplen;          /* Size of the reply buffer */
+  uint32_t  xid;              /* Transaction id */
+};
+
 /****************************************************************************
  * Public Function Prototypes
  ****************************************************************************/
@@ -472,5 +491,11 @@ void rpcclnt_disconnect(FAR struct rpcclnt *rpc);
 int  rpcclnt_request(FAR struct rpcclnt *rpc, int procnum, int prog,
                      int version, FAR void *request, size_t reqlen,
                      FAR void *response, size_t resplen);
+int  rpcclnt_start(FAR struct rpcclnt *rpc, FAR struct rpcclnt_call_s *call,
+                   int procnum, int prog, int version);
+int  rpcclnt_resend(FAR struct rpcclnt *rpc,
+                    FAR struct rpcclnt_call_s *calls, int ncalls);
+int  rpcclnt_wait(FAR struct rpcclnt *rpc,
+                  FAR struct rpcclnt_call_s *calls, int ncalls);
 
 #endif /* __FS_NFS_RPC_H */
@@ -83,6 +83,7 @@
 #include <sys/time.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <assert.h>
 #include <errno.h>
 #include <inttypes.h>
 #include <string.h>
@@ -149,8 +150,6 @@ static int rpcclnt_send(FAR struct rpcclnt *rpc,
                         FAR void *call, int reqlen);
 static int rpcclnt_receive(FAR struct rpcclnt *rpc,
                            FAR void *reply, size_t resplen);
-static int rpcclnt_reply(FAR struct rpcclnt *rpc, uint32_t xid,
-                         FAR void *reply, size_t resplen);
 static void rpcclnt_fmtheader(FAR struct rpc_call_header *ch,
                               uint32_t xid, int procid, int prog, int vers);
 
@@ -370,6 +369,7 @@ static int rpcclnt_send(FAR struct rpcclnt *rpc,
 static int rpcclnt_receive(FAR struct rpcclnt *rpc,
                            FAR void *reply, size_t resplen)
 {
+  size_t excess = 0;
   uint32_t mark;
   int error = 0;
   int offset = 0;
@@ -393,13 +393,20 @@ static int rpcclnt_receive(FAR struct rpcclnt *rpc,
           return -ENOSYS;
         }
 
+      /* A record larger than the buffer is received up to its size and
+       * the rest is dropped, so that the stream stays in sync.  This is a
+       * stale reply to a request that was given up in most cases.
+       */
+
       mark &= 0x7fffffff;
       if (mark > resplen)
         {
-          return -E2BIG;
+          excess = mark - resplen;
+        }
+      else
+        {
+          resplen = mark;
         }
-
-      resplen = mark;
     }
 
   do
@@ -417,54 +424,27 @@ static int rpcclnt_receive(FAR struct rpcclnt *rpc,
     }
   while (rpc->rc_sotype == SOCK_STREAM && resplen != 0);
 
-  return OK;
-}
-
-/****************************************************************************
- * Name: rpcclnt_reply
- *
- * Description:
- *   Received the RPC reply on the socket.
- *
- ****************************************************************************/
-
-static int rpcclnt_reply(FAR struct rpcclnt *rpc, uint32_t xid,
-                         FAR void *reply, size_t resplen)
-{
-  int error;
-
-retry:
-
-  /* Get the next RPC reply from the socket */
-
-  error = rpcclnt_receive(rpc, reply, resplen);
-  if (error != 0)
-    {
-      ferr("ERROR: rpcclnt_receive returned: %d\n", error);
-    }
-
-  /* Get the xid and check that it is an RPC replysvr */
-
-  else
+  while (excess > 0)
     {
-      FAR struct rpc_reply_header *replyheader =
-        (FAR struct rpc_reply_header *)reply;
+      uint8_t discard[32];
 
-      if (replyheader->rp_direction != rpc_reply)
+      error = psock_recv(&rpc->rc_so, discard,
+                         excess < sizeof(discard) ?
+                         excess : sizeof(discard), 0);
+      if (error < 0)
         {
-          ferr("ERROR: Different RPC REPLY returned\n");
-          rpc_statistics(rpcinvalid);
-          error = -EPROTO;
+          ferr("ERROR: psock_recv excess failed: %d\n", error);
+          return error;
         }
-      else if (replyheader->rp_xid != txdr_unsigned(xid))
+
+      excess -= error;
+      if (excess == 0)
         {
-          ferr("ERROR: Different RPC XID returned\n");
-          rpc_statistics(rpcinvalid);
-          goto retry;
+          return -E2BIG;
         }
     }
 
-  return error;
+  return OK;
 }
 
 /****************************************************************************
@@ -753,7 +733,7 @@ bad:
  * Description:
  *   Perform the RPC request.  Logic formats the RPC CALL message and calls
  *   rpcclnt_send to send the RPC CALL message.  It then calls
- *   rpcclnt_reply() to get the response.  It may attempt to re-send the
+ *   rpcclnt_wait() to get the response.  It may attempt to re-send the
  *   CALL message on certain errors.
  *
  *   On successful receipt, it verifies the RPC level of the returned values.
@@ -766,85 +746,228 @@ int rpcclnt_request(FAR struct rpcclnt *rpc, int procnum, int prog,
                     int version, FAR void *request, size_t reqlen,
                     FAR void *response, size_t resplen)
 {
-  FAR struct rpc_reply_header *replymsg;
-  uint32_t tmp;
-  uint32_t xid;
-  int retries = 0;
-  int error = 0;
+  struct rpcclnt_call_s call;
+  int error;
+
+  /* Get the full size of the message (the size of variable data plus the
+   * size of the messages header).
+   */
+
+  call.request  = request;
+  call.reqlen   = reqlen + sizeof(struct rpc_call_header);
+  call.response = response;
+  call.resplen  = resplen;
+
+  error = rpcclnt_start(rpc, &call, procnum, prog, version);
+  if (error == OK)
+    {
+      error = rpcclnt_wait(rpc, &call, 1);
+    }
+
+  if (error < 0)
+    {
+      ferr("ERROR: RPC failed: %d\n", error);
+      return error;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: rpcclnt_start
+ *
+ * Description:
+ *   Format the header of the RPC CALL message of 'call' with a new xid and
+ *   send it without waiting for the reply.  The reply is collected with
+ *   rpcclnt_wait(), so several calls can be in flight at the same time.
+ *
+ ****************************************************************************/
+
+int rpcclnt_start(FAR struct rpcclnt *rpc, FAR struct rpcclnt_call_s *call,
+                  int procnum, int prog, int version)
+{
+  int error;
 
   /* Get a new (non-zero) xid */
 
-  xid = ++rpc->rc_xid;
+  call->xid = ++rpc->rc_xid;
+  if (call->xid == 0)
+    {
+      call->xid = ++rpc->rc_xid;
+    }
 
   /* Initialize the RPC header fields */
 
-  rpcclnt_fmtheader((FAR struct rpc_call_header *)request,
-                    xid, prog, version, procnum);
+  rpcclnt_fmtheader((FAR struct rpc_call_header *)call->request,
+                    call->xid, prog, version, procnum);
 
-  /* Get the full size of the message (the size of variable data plus the
-   * size of the messages header).
-   */
+  rpc_statistics(rpcrequests);
 
-  reqlen += sizeof(struct rpc_call_header);
+  /* A CALL message lost to a timeout is sent again by rpcclnt_wait() */
 
-  /* Send the RPC call messages and receive the RPC response.  A limited
-   * number of re-tries will be attempted, but only for the case of response
-   * timeouts.
-   */
+  error = rpcclnt_send(rpc, call->request, call->reqlen);
+  if (error == -EAGAIN || error == -ETIMEDOUT)
+    {
+      error = OK;
+    }
+  else if (error < 0)
+    {
+      finfo("ERROR rpcclnt_send failed: %d\n", error);
+      call->xid = 0;
+    }
+
+  return error;
+}
+
+/****************************************************************************
+ * Name: rpcclnt_resend
+ *
+ * Description:
+ *   Send the CALL messages of all pending calls again, after a timeout or
+ *   after the connection to the server was re-established.
+ *
+ ****************************************************************************/
+
+int rpcclnt_resend(FAR struct rpcclnt *rpc,
+                   FAR struct rpcclnt_call_s *calls, int ncalls)
+{
+  int error;
+  int i;
+
+  for (i = 0; i < ncalls; i++)
+    {
+      if (calls[i].xid != 0)
+        {
+          error = rpcclnt_send(rpc, calls[i].request, calls[i].reqlen);
+          if (error < 0 && error != -EAGAIN && error != -ETIMEDOUT)
+            {
+              return error;
+            }
+        }
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: rpcclnt_wait
+ *
+ * Description:
+ *   Wait for the reply to any of the pending calls in 'calls'.  Replies to
+ *   other xids, for example of calls that were given up, are dropped.  On
+ *   a timeout, all pending calls are sent again, up to the retry count of
+ *   the client.
+ *
+ *   The reply is received into the buffer of the first pending call.  If
+ *   it belongs to another call, the response buffers of the two calls are
+ *   exchanged, so all the calls waited for together must have response
+ *   buffers of the same size.
+ *
+ * Returned Value:
+ *   The index of the call that was answered, whose xid is then zero, or a
+ *   negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int rpcclnt_wait(FAR struct rpcclnt *rpc,
+                 FAR struct rpcclnt_call_s *calls, int ncalls)
+{
+  FAR struct rpc_reply_header *replymsg;
+  FAR void *response;
+  uint32_t tmp;
+  int retries = 0;
+  int error;
+  int first;
+  int i;
+
+  for (first = 0; first < ncalls && calls[first].xid == 0; first++)
+    {
+    }
+
+  if (first >= ncalls)
+    {
+      return -EINVAL;
+    }
 
   for (; ; )
     {
-      /* Do the client side RPC. */
+      /* Get the next RPC reply from the socket */
 
-      rpc_statistics(rpcrequests);
+      error = rpcclnt_receive(rpc, calls[first].response,
+                              calls[first].resplen);
 
-      /* Send the RPC CALL message */
+      /* If we failed because of a timeout, then try sending the CALL
+       * messages again.
+       */
 
-      error = rpcclnt_send(rpc, request, reqlen);
-      if (error != OK)
+      if (error == -EAGAIN || error == -ETIMEDOUT)
         {
-          finfo("ERROR rpcclnt_send failed: %d\n", error);
+          rpc_statistics(rpctimeouts);
+          if (++retries >= rpc->rc_retry)
+            {
+              return error;
+            }
+
+          rpc_statistics(rpcretries);
+          error = rpcclnt_resend(rpc, calls, ncalls);
+          if (error < 0)
+            {
+              return error;
+            }
+
+          continue;
+        }
+      else if (error < 0 && error != -E2BIG)
+        {
+          ferr("ERROR: rpcclnt_receive returned: %d\n", error);
+          return error;
         }
 
-      /* Wait for the reply from our send */
+      /* Get the xid and check that it is an RPC replysvr */
 
-      else
+      replymsg = (FAR struct rpc_reply_header *)calls[first].response;
+      if (replymsg->rp_direction != rpc_reply)
+        {
+          ferr("ERROR: Different RPC REPLY returned\n");
+          rpc_statistics(rpcinvalid);
+          return -EPROTO;
+        }
+
+      for (i = first; i < ncalls; i++)
         {
-          error = rpcclnt_reply(rpc, xid, response, resplen);
-          if (error != OK)
+          if (calls[i].xid != 0 &&
+              replymsg->rp_xid == txdr_unsigned(calls[i].xid))
             {
-              finfo("ERROR rpcclnt_reply failed: %d\n", error);
+              break;
             }
         }
 
-      /* If we failed because of a timeout, then try sending the CALL
-       * message again.
-       */
-
-      if (error != -EAGAIN && error != -ETIMEDOUT)
+      if (i >= ncalls)
         {
-          break;
+          ferr("ERROR: Different RPC XID returned\n");
+          rpc_statistics(rpcinvalid);
+          continue;
         }
 
-      rpc_statistics(rpctimeouts);
-      if (++retries >= rpc->rc_retry)
+      calls[i].xid = 0;
+      if (error < 0)
         {
-          break;
+          return error;
         }
 
-      rpc_statistics(rpcretries);
-    }
+      if (i != first)
+        {
+          DEBUGASSERT(calls[i].resplen == calls[first].resplen);
+          response              = calls[i].response;
+          calls[i].response     = calls[first].response;
+          calls[first].response = response;
+        }
 
-  if (error != OK)
-    {
-      ferr("ERROR: RPC failed: %d\n", error);
-      return error;
+      break;
     }
 
   /* Break down the RPC header and check if it is OK */
 
-  replymsg = (FAR struct rpc_reply_header *)response;
-
   tmp = fxdr_unsigned(uint32_t, replymsg->type);
   if (tmp != RPC_MSGACCEPTED)
     {
@@ -862,5 +985,5 @@ int rpcclnt_request(FAR struct rpcclnt *rpc, int procnum, int prog,
       return -EOPNOTSUPP;
     }
 
-  return OK;
+  return i;
 }
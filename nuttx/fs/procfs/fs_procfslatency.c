@@ -0,0 +1,540 @@
+/****************************************************************************
+ * fs/procfs/fs_procfslatency.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <fcntl.h>
+#include <assert.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <nuttx/clock.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/procfs.h>
+#include <nuttx/sched.h>
+
+#include "fs_heap.h"
+
+#if !defined(CONFIG_DISABLE_MOUNTPOINT) && defined(CONFIG_FS_PROCFS) && \
+     defined(CONFIG_SCHED_LATENCYMON)
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Determines the size of an intermediate buffer that must be large enough
+ * to handle the longest line generated by this logic.
+ */
+
+#define LATENCY_LINELEN 96
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* This structure describes one open "file" */
+
+struct latency_file_s
+{
+  struct procfs_file_s  base;   /* Base open file structure */
+  unsigned int linesize;        /* Number of valid characters in line[] */
+  char line[LATENCY_LINELEN];   /* Pre-allocated buffer for formatted lines */
+};
+
+/* This structure carries the read state across the output helpers */
+
+struct latency_read_s
+{
+  FAR struct latency_file_s *attr; /* Open file state */
+  FAR char *buffer;                /* User buffer */
+  size_t buflen;                   /* Space remaining in the user buffer */
+  size_t totalsize;                /* Bytes copied to the user buffer */
+  off_t offset;                    /* Bytes still to skip */
+};
+
+/* Copy of the histogram of one task, taken during the task list walk */
+
+struct latency_task_s
+{
+  pid_t pid;                       /* Task ID */
+  uint8_t priority;                /* Priority at the time of the copy */
+  struct latmon_hist_s hist;       /* Wakeup-to-run histogram */
+};
+
+/* This structure carries the copied task histograms */
+
+struct latency_tasks_s
+{
+  FAR struct latency_task_s *task; /* Array of copied histograms */
+  size_t ntasks;                   /* Number of entries used */
+  size_t maxtasks;                 /* Number of entries allocated */
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+/* File system methods */
+
+static int     latency_open(FAR struct file *filep, FAR const char *relpath,
+                 int oflags, mode_t mode);
+static int     latency_close(FAR struct file *filep);
+static ssize_t latency_read(FAR struct file *filep, FAR char *buffer,
+                 size_t buflen);
+static ssize_t latency_write(FAR struct file *filep, FAR const char *buffer,
+                 size_t buflen);
+static int     latency_dup(FAR const struct file *oldp,
+                 FAR struct file *newp);
+static int     latency_stat(FAR const char *relpath, FAR struct stat *buf);
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+/* See fs_mount.c -- this structure is explicitly externed there.
+ * We use the old-fashioned kind of initializers so that this will compile
+ * with any compiler.
+ */
+
+const struct procfs_operations g_latency_operations =
+{
+  latency_open,       /* open */
+  latency_close,      /* close */
+  latency_read,       /* read */
+  latency_write,      /* write */
+  NULL,               /* poll */
+
+  latency_dup,        /* dup */
+
+  NULL,               /* opendir */
+  NULL,               /* closedir */
+  NULL,               /* readdir */
+  NULL,               /* rewinddir */
+
+  latency_stat        /* stat */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: latency_open
+ ****************************************************************************/
+
+static int latency_open(FAR struct file *filep, FAR const char *relpath,
+                        int oflags, mode_t mode)
+{
+  FAR struct latency_file_s *attr;
+
+  finfo("Open '%s'\n", relpath);
+
+  /* Allocate a container to hold the file attributes.  Write access is
+   * permitted: Any write resets the histograms.
+   */
+
+  attr = fs_heap_zalloc(sizeof(struct latency_file_s));
+  if (!attr)
+    {
+      ferr("ERROR: Failed to allocate file attributes\n");
+      return -ENOMEM;
+    }
+
+  /* Save the attributes as the open-specific state in filep->f_priv */
+
+  filep->f_priv = (FAR void *)attr;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: latency_close
+ ****************************************************************************/
+
+static int latency_close(FAR struct file *filep)
+{
+  FAR struct latency_file_s *attr;
+
+  /* Recover our private data from the struct file instance */
+
+  attr = (FAR struct latency_file_s *)filep->f_priv;
+  DEBUGASSERT(attr);
+
+  /* Release the file attributes structure */
+
+  fs_heap_free(attr);
+  filep->f_priv = NULL;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: latency_emit
+ *
+ * Description:
+ *   Copy the formatted line in attr->line to the user buffer.
+ *
+ ****************************************************************************/
+
+static void latency_emit(FAR struct latency_read_s *rd, size_t linesize)
+{
+  size_t copysize;
+
+  if (rd->buflen == 0)
+    {
+      return;
+    }
+
+  copysize = procfs_memcpy(rd->attr->line, linesize, rd->buffer,
+                           rd->buflen, &rd->offset);
+
+  rd->totalsize += copysize;
+  rd->buffer    += copysize;
+  rd->buflen    -= copysize;
+}
+
+/****************************************************************************
+ * Name: latency_nsec
+ *
+ * Description:
+ *   Convert perf_gettime() counts to nanoseconds.
+ *
+ ****************************************************************************/
+
+static uint64_t latency_nsec(clock_t elapsed)
+{
+  struct timespec ts;
+
+  perf_convert(elapsed, &ts);
+  return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/****************************************************************************
+ * Name: latency_read_hist
+ *
+ * Description:
+ *   Generate one line for one histogram.  Trailing empty buckets are
+ *   omitted.
+ *
+ ****************************************************************************/
+
+static void latency_read_hist(FAR struct latency_read_s *rd,
+                              FAR const char *prefix,
+                              FAR const struct latmon_hist_s *hist)
+{
+  size_t linesize;
+  int last;
+  int i;
+
+  linesize = procfs_snprintf(rd->attr->line, LATENCY_LINELEN,
+                             "%s count %" PRIu32 " avg %" PRIu64
+                             " max %" PRIu64 " hist",
+                             prefix, hist->count,
+                             latency_nsec((clock_t)
+                                          (hist->total / hist->count)),
+                             latency_nsec(hist->max));
+  latency_emit(rd, linesize);
+
+  for (last = CONFIG_SCHED_LATENCYMON_NBUCKETS - 1; last > 0; last--)
+    {
+      if (hist->bucket[last] != 0)
+        {
+          break;
+        }
+    }
+
+  for (i = 0; i <= last; i++)
+    {
+      linesize = procfs_snprintf(rd->attr->line, LATENCY_LINELEN,
+                                 " %" PRIu32, hist->bucket[i]);
+      latency_emit(rd, linesize);
+    }
+
+  linesize = procfs_snprintf(rd->attr->line, LATENCY_LINELEN, "\n");
+  latency_emit(rd, linesize);
+}
+
+/****************************************************************************
+ * Name: latency_read_band
+ *
+ * Description:
+ *   Sum the per-CPU histograms of one priority band and generate its line.
+ *
+ ****************************************************************************/
+
+static void latency_read_band(FAR struct latency_read_s *rd,
+                              FAR const char *name,
+                              FAR struct latmon_hist_s
+                              hist[][LATMON_NPRIOBANDS],
+                              int band)
+{
+  struct latmon_hist_s sum;
+  char prefix[32];
+  int cpu;
+  int i;
+
+  memset(&sum, 0, sizeof(sum));
+
+  for (cpu = 0; cpu < CONFIG_SMP_NCPUS; cpu++)
+    {
+      FAR struct latmon_hist_s *h = &hist[cpu][band];
+
+      sum.count += h->count;
+      sum.total += h->total;
+      if (h->max > sum.max)
+        {
+          sum.max = h->max;
+        }
+
+      for (i = 0; i < CONFIG_SCHED_LATENCYMON_NBUCKETS; i++)
+        {
+          sum.bucket[i] += h->bucket[i];
+        }
+    }
+
+  if (sum.count > 0)
+    {
+      snprintf(prefix, sizeof(prefix), "%s prio %d-%d", name,
+               band << CONFIG_SCHED_LATENCYMON_PRIOSHIFT,
+               ((band + 1) << CONFIG_SCHED_LATENCYMON_PRIOSHIFT) - 1);
+      latency_read_hist(rd, prefix, &sum);
+    }
+}
+
+/****************************************************************************
+ * Name: latency_count_task
+ *
+ * Description:
+ *   nxsched_foreach() callback that counts the tasks with samples.
+ *
+ ****************************************************************************/
+
+static void latency_count_task(FAR struct tcb_s *tcb, FAR void *arg)
+{
+  if (tcb->wakeup_latency.count > 0)
+    {
+      (*(FAR size_t *)arg)++;
+    }
+}
+
+/****************************************************************************
+ * Name: latency_copy_task
+ *
+ * Description:
+ *   nxsched_foreach() callback that copies the histogram of one task.  It
+ *   runs in a critical section, the lines are generated after the walk.
+ *
+ ****************************************************************************/
+
+static void latency_copy_task(FAR struct tcb_s *tcb, FAR void *arg)
+{
+  FAR struct latency_tasks_s *tasks = arg;
+  FAR struct latency_task_s *entry;
+
+  if (tcb->wakeup_latency.count > 0 && tasks->ntasks < tasks->maxtasks)
+    {
+      entry           = &tasks->task[tasks->ntasks++];
+      entry->pid      = tcb->pid;
+      entry->priority = tcb->sched_priority;
+      memcpy(&entry->hist, &tcb->wakeup_latency, sizeof(entry->hist));
+    }
+}
+
+/****************************************************************************
+ * Name: latency_read
+ ****************************************************************************/
+
+static ssize_t latency_read(FAR struct file *filep, FAR char *buffer,
+                            size_t buflen)
+{
+  struct latency_tasks_s tasks;
+  struct latency_read_s rd;
+  char prefix[32];
+  size_t linesize;
+  size_t n;
+  int band;
+  int i;
+
+  finfo("buffer=%p buflen=%d\n", buffer, (int)buflen);
+
+  /* Recover our private data from the struct file instance */
+
+  rd.attr      = (FAR struct latency_file_s *)filep->f_priv;
+  rd.buffer    = buffer;
+  rd.buflen    = buflen;
+  rd.totalsize = 0;
+  rd.offset    = filep->f_pos;
+  DEBUGASSERT(rd.attr);
+
+  /* Copy the histograms of the tasks first.  Tasks that get their first
+   * sample between the two walks are left out of this read.
+   */
+
+  tasks.task     = NULL;
+  tasks.ntasks   = 0;
+  tasks.maxtasks = 0;
+
+  nxsched_foreach(latency_count_task, &tasks.maxtasks);
+  if (tasks.maxtasks > 0)
+    {
+      tasks.task = fs_heap_malloc(tasks.maxtasks *
+                                  sizeof(struct latency_task_s));
+      if (tasks.task == NULL)
+        {
+          return -ENOMEM;
+        }
+
+      nxsched_foreach(latency_copy_task, &tasks);
+    }
+
+  /* Generate the lower bound of each bucket in nanoseconds.  All the
+   * remaining times are in nanoseconds as well.
+   */
+
+  linesize = procfs_snprintf(rd.attr->line, LATENCY_LINELEN, "buckets");
+  latency_emit(&rd, linesize);
+
+  for (i = 0; i < CONFIG_SCHED_LATENCYMON_NBUCKETS; i++)
+    {
+      linesize = procfs_snprintf(rd.attr->line, LATENCY_LINELEN,
+                                 " %" PRIu64,
+                                 i > 0 ? latency_nsec(UINT64_C(1) << i) : 0);
+      latency_emit(&rd, linesize);
+    }
+
+  linesize = procfs_snprintf(rd.attr->line, LATENCY_LINELEN, "\n");
+  latency_emit(&rd, linesize);
+
+  /* Wakeup-to-run and IRQ-to-run histograms per priority band */
+
+  for (band = 0; band < LATMON_NPRIOBANDS; band++)
+    {
+      latency_read_band(&rd, "wakeup", g_latmon_wakeup, band);
+    }
+
+  for (band = 0; band < LATMON_NPRIOBANDS; band++)
+    {
+      latency_read_band(&rd, "irq", g_latmon_irq, band);
+    }
+
+  /* Wakeup-to-run histogram of each task */
+
+  for (n = 0; n < tasks.ntasks; n++)
+    {
+      snprintf(prefix, sizeof(prefix), "task pid %d prio %d",
+               tasks.task[n].pid, tasks.task[n].priority);
+      latency_read_hist(&rd, prefix, &tasks.task[n].hist);
+    }
+
+  fs_heap_free(tasks.task);
+
+  filep->f_pos += rd.totalsize;
+  return rd.totalsize;
+}
+
+/****************************************************************************
+ * Name: latency_write
+ *
+ * Description:
+ *   Any write resets all histograms.
+ *
+ ****************************************************************************/
+
+static ssize_t latency_write(FAR struct file *filep, FAR const char *buffer,
+                             size_t buflen)
+{
+  nxsched_latmon_reset();
+  return buflen;
+}
+
+/****************************************************************************
+ * Name: latency_dup
+ *
+ * Description:
+ *   Duplicate open file data in the new file structure.
+ *
+ ****************************************************************************/
+
+static int latency_dup(FAR const struct file *oldp, FAR struct file *newp)
+{
+  FAR struct latency_file_s *oldattr;
+  FAR struct latency_file_s *newattr;
+
+  finfo("Dup %p->%p\n", oldp, newp);
+
+  /* Recover our private data from the old struct file instance */
+
+  oldattr = (FAR struct latency_file_s *)oldp->f_priv;
+  DEBUGASSERT(oldattr);
+
+  /* Allocate a new container to hold the task and attribute selection */
+
+  newattr = fs_heap_malloc(sizeof(struct latency_file_s));
+  if (!newattr)
+    {
+      ferr("ERROR: Failed to allocate file attributes\n");
+      return -ENOMEM;
+    }
+
+  /* The copy the file attributes from the old attributes to the new */
+
+  memcpy(newattr, oldattr, sizeof(struct latency_file_s));
+
+  /* Save the new attributes in the new file structure */
+
+  newp->f_priv = (FAR void *)newattr;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: latency_stat
+ *
+ * Description: Return information about a file or directory
+ *
+ ****************************************************************************/
+
+static int latency_stat(const char *relpath, struct stat *buf)
+{
+  /* "latency" is the name for a read/write file */
+
+  memset(buf, 0, sizeof(struct stat));
+  buf->st_mode = S_IFREG | S_IROTH | S_IRGRP | S_IRUSR | S_IWUSR;
+  return OK;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+#endif /* !CONFIG_DISABLE_MOUNTPOINT && CONFIG_FS_PROCFS && CONFIG_SCHED_LATENCYMON */
@@ -0,0 +1,420 @@
+/****************************************************************************
+ * fs/procfs/fs_procfslockstat.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <fcntl.h>
+#include <assert.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <nuttx/clock.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/procfs.h>
+#include <nuttx/lockstat.h>
+
+#include "fs_heap.h"
+
+#if !defined(CONFIG_DISABLE_MOUNTPOINT) && defined(CONFIG_FS_PROCFS) && \
+     defined(CONFIG_SCHED_LOCKSTAT)
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Determines the size of an intermediate buffer that must be large enough
+ * to handle the longest line generated by this logic.
+ */
+
+#define LOCKSTAT_LINELEN 128
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* This structure describes one open "file" */
+
+struct lockstat_file_s
+{
+  struct procfs_file_s base;    /* Base open file structure */
+  unsigned int linesize;        /* Number of valid characters in line[] */
+  char line[LOCKSTAT_LINELEN];  /* Pre-allocated buffer for formatted lines */
+};
+
+/* This structure carries the read state across the output helpers */
+
+struct lockstat_read_s
+{
+  FAR struct lockstat_file_s *attr; /* Open file state */
+  FAR char *buffer;                 /* User buffer */
+  size_t buflen;                    /* Space remaining in the user buffer */
+  size_t totalsize;                 /* Bytes copied to the user buffer */
+  off_t offset;                     /* Bytes still to skip */
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+/* File system methods */
+
+static int     lockstat_open(FAR struct file *filep, FAR const char *relpath,
+                 int oflags, mode_t mode);
+static int     lockstat_close(FAR struct file *filep);
+static ssize_t lockstat_read(FAR struct file *filep, FAR char *buffer,
+                 size_t buflen);
+static ssize_t lockstat_write(FAR struct file *filep, FAR const char *buffer,
+                 size_t buflen);
+static int     lockstat_dup(FAR const struct file *oldp,
+                 FAR struct file *newp);
+static int     lockstat_stat(FAR const char *relpath, FAR struct stat *buf);
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* Names of the LOCKSTAT_* lock types */
+
+static FAR const char *const g_lockstat_type[] =
+{
+  "sem",
+  "mutex",
+  "spinlock",
+  "csection"
+};
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+/* See fs_mount.c -- this structure is explicitly externed there.
+ * We use the old-fashioned kind of initializers so that this will compile
+ * with any compiler.
+ */
+
+const struct procfs_operations g_lockstat_operations =
+{
+  lockstat_open,      /* open */
+  lockstat_close,     /* close */
+  lockstat_read,      /* read */
+  lockstat_write,     /* write */
+  NULL,               /* poll */
+
+  lockstat_dup,       /* dup */
+
+  NULL,               /* opendir */
+  NULL,               /* closedir */
+  NULL,               /* readdir */
+  NULL,               /* rewinddir */
+
+  lockstat_stat       /* stat */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: lockstat_open
+ ****************************************************************************/
+
+static int lockstat_open(FAR struct file *filep, FAR const char *relpath,
+                         int oflags, mode_t mode)
+{
+  FAR struct lockstat_file_s *attr;
+
+  finfo("Open '%s'\n", relpath);
+
+  /* Allocate a container to hold the file attributes.  Write access is
+   * permitted: Any write resets the statistics.
+   */
+
+  attr = fs_heap_zalloc(sizeof(struct lockstat_file_s));
+  if (!attr)
+    {
+      ferr("ERROR: Failed to allocate file attributes\n");
+      return -ENOMEM;
+    }
+
+  /* Save the attributes as the open-specific state in filep->f_priv */
+
+  filep->f_priv = (FAR void *)attr;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: lockstat_close
+ ****************************************************************************/
+
+static int lockstat_close(FAR struct file *filep)
+{
+  FAR struct lockstat_file_s *attr;
+
+  /* Recover our private data from the struct file instance */
+
+  attr = (FAR struct lockstat_file_s *)filep->f_priv;
+  DEBUGASSERT(attr);
+
+  /* Release the file attributes structure */
+
+  fs_heap_free(attr);
+  filep->f_priv = NULL;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: lockstat_emit
+ *
+ * Description:
+ *   Copy the formatted line in attr->line to the user buffer.
+ *
+ ****************************************************************************/
+
+static void lockstat_emit(FAR struct lockstat_read_s *rd, size_t linesize)
+{
+  size_t copysize;
+
+  if (rd->buflen == 0)
+    {
+      return;
+    }
+
+  copysize = procfs_memcpy(rd->attr->line, linesize, rd->buffer,
+                           rd->buflen, &rd->offset);
+
+  rd->totalsize += copysize;
+  rd->buffer    += copysize;
+  rd->buflen    -= copysize;
+}
+
+/****************************************************************************
+ * Name: lockstat_nsec
+ *
+ * Description:
+ *   Convert perf_gettime() counts to nanoseconds.
+ *
+ ****************************************************************************/
+
+static uint64_t lockstat_nsec(uint64_t elapsed)
+{
+  struct timespec ts;
+
+  perf_convert(elapsed, &ts);
+  return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/****************************************************************************
+ * Name: lockstat_read_entry
+ *
+ * Description:
+ *   Generate the line of one lock.
+ *
+ ****************************************************************************/
+
+static void lockstat_read_entry(FAR struct lockstat_read_s *rd,
+                                FAR const struct lockstat_s *entry)
+{
+  size_t linesize;
+#if CONFIG_SCHED_LOCKSTAT_BACKTRACE > 0
+  int i;
+#endif
+
+  linesize = procfs_snprintf(rd->attr->line, LOCKSTAT_LINELEN,
+                             "%p %-8s %10" PRIu32 " %10" PRIu32
+                             " %12" PRIu64 " %10" PRIu64 " %10" PRIu64,
+                             entry->lock, g_lockstat_type[entry->type],
+                             entry->acquired, entry->contended,
+                             lockstat_nsec(entry->wait_total),
+                             lockstat_nsec(entry->wait_max),
+                             lockstat_nsec(entry->hold_max));
+  lockstat_emit(rd, linesize);
+
+  /* Resolve the lock (or caller) address and the holder backtrace to
+   * symbols when CONFIG_ALLSYMS is enabled.
+   */
+
+  linesize = procfs_snprintf(rd->attr->line, LOCKSTAT_LINELEN, " %pS",
+                             entry->lock);
+  lockstat_emit(rd, linesize);
+
+#if CONFIG_SCHED_LOCKSTAT_BACKTRACE > 0
+  for (i = 0; i < CONFIG_SCHED_LOCKSTAT_BACKTRACE; i++)
+    {
+      if (entry->backtrace[i] == NULL)
+        {
+          break;
+        }
+
+      linesize = procfs_snprintf(rd->attr->line, LOCKSTAT_LINELEN,
+                                 " %pS", entry->backtrace[i]);
+      lockstat_emit(rd, linesize);
+    }
+#endif
+
+  linesize = procfs_snprintf(rd->attr->line, LOCKSTAT_LINELEN, "\n");
+  lockstat_emit(rd, linesize);
+}
+
+/****************************************************************************
+ * Name: lockstat_read
+ ****************************************************************************/
+
+static ssize_t lockstat_read(FAR struct file *filep, FAR char *buffer,
+                             size_t buflen)
+{
+  struct lockstat_read_s rd;
+  struct lockstat_s entry;
+  size_t linesize;
+  int i;
+
+  finfo("buffer=%p buflen=%d\n", buffer, (int)buflen);
+
+  /* Recover our private data from the struct file instance */
+
+  rd.attr      = (FAR struct lockstat_file_s *)filep->f_priv;
+  rd.buffer    = buffer;
+  rd.buflen    = buflen;
+  rd.totalsize = 0;
+  rd.offset    = filep->f_pos;
+  DEBUGASSERT(rd.attr);
+
+  /* All times are in nanoseconds */
+
+  linesize = procfs_snprintf(rd.attr->line, LOCKSTAT_LINELEN,
+                             "%-10s %-8s %10s %10s %12s %10s %10s %s\n",
+                             "LOCK", "TYPE", "ACQUIRED", "CONTENDED",
+                             "WAIT_TOTAL", "WAIT_MAX", "HOLD_MAX",
+                             "SYMBOL");
+  lockstat_emit(&rd, linesize);
+
+  for (i = 0; i < CONFIG_SCHED_LOCKSTAT_NENTRIES; i++)
+    {
+      /* Work on a copy, the entry may be updated concurrently */
+
+      memcpy(&entry, &g_lockstat[i], sizeof(entry));
+      if (entry.lock != NULL && entry.acquired > 0)
+        {
+          lockstat_read_entry(&rd, &entry);
+        }
+    }
+
+  if (g_lockstat_dropped > 0)
+    {
+      linesize = procfs_snprintf(rd.attr->line, LOCKSTAT_LINELEN,
+                                 "dropped %" PRIu32 "\n",
+                                 g_lockstat_dropped);
+      lockstat_emit(&rd, linesize);
+    }
+
+  filep->f_pos += rd.totalsize;
+  return rd.totalsize;
+}
+
+/****************************************************************************
+ * Name: lockstat_write
+ *
+ * Description:
+ *   Any write resets the statistics of all locks.
+ *
+ ****************************************************************************/
+
+static ssize_t lockstat_write(FAR struct file *filep, FAR const char *buffer,
+                              size_t buflen)
+{
+  nxsched_lockstat_reset();
+  return buflen;
+}
+
+/****************************************************************************
+ * Name: lockstat_dup
+ *
+ * Description:
+ *   Duplicate open file data in the new file structure.
+ *
+ ****************************************************************************/
+
+static int lockstat_dup(FAR const struct file *oldp, FAR struct file *newp)
+{
+  FAR struct lockstat_file_s *oldattr;
+  FAR struct lockstat_file_s *newattr;
+
+  finfo("Dup %p->%p\n", oldp, newp);
+
+  /* Recover our private data from the old struct file instance */
+
+  oldattr = (FAR struct lockstat_file_s *)oldp->f_priv;
+  DEBUGASSERT(oldattr);
+
+  /* Allocate a new container to hold the task and attribute selection */
+
+  newattr = fs_heap_malloc(sizeof(struct lockstat_file_s));
+  if (!newattr)
+    {
+      ferr("ERROR: Failed to allocate file attributes\n");
+      return -ENOMEM;
+    }
+
+  /* The copy the file attributes from the old attributes to the new */
+
+  memcpy(newattr, oldattr, sizeof(struct lockstat_file_s));
+
+  /* Save the new attributes in the new file structure */
+
+  newp->f_priv = (FAR void *)newattr;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: lockstat_stat
+ *
+ * Description: Return information about a file or directory
+ *
+ ****************************************************************************/
+
+static int lockstat_stat(const char *relpath, struct stat *buf)
+{
+  /* "lockstat" is the name for a read/write file */
+
+  memset(buf, 0, sizeof(struct stat));
+  buf->st_mode = S_IFREG | S_IROTH | S_IRGRP | S_IRUSR | S_IWUSR;
+  return OK;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+#endif /* !CONFIG_DISABLE_MOUNTPOINT && CONFIG_FS_PROCFS && ... */
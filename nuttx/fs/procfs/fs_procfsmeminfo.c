@@ -751,4 +751,27 @@ void procfs_unregister_meminfo(FAR struct procfs_meminfo_entry_s *entry)
         }
     }
 }
+
+/****************************************************************************
+ * Name: procfs_foreach_meminfo
+ *
+ * Description:
+ *   Call a handler for every registered meminfo entry.
+ *
+ * Input Parameters:
+ *   handler - Called with each entry
+ *   arg     - Opaque argument passed to the handler
+ *
+ ****************************************************************************/
+
+void procfs_foreach_meminfo(procfs_meminfo_handler_t handler,
+                            FAR void *arg)
+{
+  FAR struct procfs_meminfo_entry_s *entry;
+
+  for (entry = g_procfs_meminfo; entry != NULL; entry = entry->next)
+    {
+      handler(entry, arg);
+    }
+}
 #endif /* !CONFIG_FS_PROCFS_EXCLUDE_MEMINFO */
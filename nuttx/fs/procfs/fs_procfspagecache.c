@@ -0,0 +1,288 @@
+/****************************************************************************
+ * fs/procfs/fs_procfspagecache.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <assert.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/procfs.h>
+#include <nuttx/fs/pagecache.h>
+
+#include "fs_heap.h"
+
+#if !defined(CONFIG_DISABLE_MOUNTPOINT) && defined(CONFIG_FS_PROCFS) && \
+     defined(CONFIG_FS_PAGECACHE)
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Size of the buffer holding the whole file */
+
+#define PAGECACHE_BUFSIZE 256
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* This structure describes one open "file" */
+
+struct pagecache_file_s
+{
+  struct procfs_file_s base;      /* Base open file structure */
+  char line[PAGECACHE_BUFSIZE];   /* Pre-allocated buffer for the content */
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+/* File system methods */
+
+static int     pagecache_procfs_open(FAR struct file *filep,
+                 FAR const char *relpath, int oflags, mode_t mode);
+static int     pagecache_procfs_close(FAR struct file *filep);
+static ssize_t pagecache_procfs_read(FAR struct file *filep,
+                 FAR char *buffer, size_t buflen);
+static int     pagecache_procfs_dup(FAR const struct file *oldp,
+                 FAR struct file *newp);
+static int     pagecache_procfs_stat(FAR const char *relpath,
+                 FAR struct stat *buf);
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+/* See fs_mount.c -- this structure is explicitly externed there.
+ * We use the old-fashioned kind of initializers so that this will compile
+ * with any compiler.
+ */
+
+const struct procfs_operations g_pagecache_operations =
+{
+  pagecache_procfs_open,   /* open */
+  pagecache_procfs_close,  /* close */
+  pagecache_procfs_read,   /* read */
+  NULL,                    /* write */
+  NULL,                    /* poll */
+
+  pagecache_procfs_dup,    /* dup */
+
+  NULL,                    /* opendir */
+  NULL,                    /* closedir */
+  NULL,                    /* readdir */
+  NULL,                    /* rewinddir */
+
+  pagecache_procfs_stat    /* stat */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: pagecache_procfs_open
+ ****************************************************************************/
+
+static int pagecache_procfs_open(FAR struct file *filep,
+                                 FAR const char *relpath, int oflags,
+                                 mode_t mode)
+{
+  FAR struct pagecache_file_s *attr;
+
+  finfo("Open '%s'\n", relpath);
+
+  /* PROCFS is read-only.  Any attempt to open with any kind of write
+   * access is not permitted.
+   */
+
+  if ((oflags & O_WRONLY) != 0 || (oflags & O_RDONLY) == 0)
+    {
+      ferr("ERROR: Only O_RDONLY supported\n");
+      return -EACCES;
+    }
+
+  /* Allocate a container to hold the file attributes */
+
+  attr = fs_heap_zalloc(sizeof(struct pagecache_file_s));
+  if (!attr)
+    {
+      ferr("ERROR: Failed to allocate file attributes\n");
+      return -ENOMEM;
+    }
+
+  /* Save the attributes as the open-specific state in filep->f_priv */
+
+  filep->f_priv = (FAR void *)attr;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: pagecache_procfs_close
+ ****************************************************************************/
+
+static int pagecache_procfs_close(FAR struct file *filep)
+{
+  FAR struct pagecache_file_s *attr;
+
+  /* Recover our private data from the struct file instance */
+
+  attr = (FAR struct pagecache_file_s *)filep->f_priv;
+  DEBUGASSERT(attr);
+
+  /* Release the file attributes structure */
+
+  fs_heap_free(attr);
+  filep->f_priv = NULL;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: pagecache_procfs_read
+ ****************************************************************************/
+
+static ssize_t pagecache_procfs_read(FAR struct file *filep,
+                                     FAR char *buffer, size_t buflen)
+{
+  FAR struct pagecache_file_s *attr;
+  struct pagecache_stats_s stats;
+  uint64_t requests;
+  uint32_t permille = 0;
+  size_t linesize;
+  size_t copysize;
+  off_t offset;
+
+  finfo("buffer=%p buflen=%d\n", buffer, (int)buflen);
+
+  /* Recover our private data from the struct file instance */
+
+  attr = (FAR struct pagecache_file_s *)filep->f_priv;
+  DEBUGASSERT(attr);
+
+  pagecache_stats(&stats);
+
+  /* The hit rate is the share of the requested sectors found in the cache,
+   * in tenths of a percent.
+   */
+
+  requests = (uint64_t)stats.hits + stats.misses;
+  if (requests > 0)
+    {
+      permille = (uint32_t)(stats.hits * UINT64_C(1000) / requests);
+    }
+
+  linesize = procfs_snprintf(attr->line, PAGECACHE_BUFSIZE,
+                             "size:      %zu\n"
+                             "used:      %zu\n"
+                             "dirty:     %zu\n"
+                             "hits:      %" PRIu32 "\n"
+                             "misses:    %" PRIu32 "\n"
+                             "readahead: %" PRIu32 "\n"
+                             "writeback: %" PRIu32 "\n"
+                             "evictions: %" PRIu32 "\n"
+                             "hitrate:   %" PRIu32 ".%" PRIu32 "%%\n",
+                             stats.size, stats.used, stats.dirty,
+                             stats.hits, stats.misses, stats.readahead,
+                             stats.writeback, stats.evictions,
+                             permille / 10, permille % 10);
+
+  offset   = filep->f_pos;
+  copysize = procfs_memcpy(attr->line, linesize, buffer, buflen, &offset);
+
+  filep->f_pos += copysize;
+  return copysize;
+}
+
+/****************************************************************************
+ * Name: pagecache_procfs_dup
+ *
+ * Description:
+ *   Duplicate open file data in the new file structure.
+ *
+ ****************************************************************************/
+
+static int pagecache_procfs_dup(FAR const struct file *oldp,
+                                FAR struct file *newp)
+{
+  FAR struct pagecache_file_s *oldattr;
+  FAR struct pagecache_file_s *newattr;
+
+  finfo("Dup %p->%p\n", oldp, newp);
+
+  /* Recover our private data from the old struct file instance */
+
+  oldattr = (FAR struct pagecache_file_s *)oldp->f_priv;
+  DEBUGASSERT(oldattr);
+
+  /* Allocate a new container to hold the task and attribute selection */
+
+  newattr = fs_heap_malloc(sizeof(struct pagecache_file_s));
+  if (!newattr)
+    {
+      ferr("ERROR: Failed to allocate file attributes\n");
+      return -ENOMEM;
+    }
+
+  /* The copy the file attributes from the old attributes to the new */
+
+  memcpy(newattr, oldattr, sizeof(struct pagecache_file_s));
+
+  /* Save the new attributes in the new file structure */
+
+  newp->f_priv = (FAR void *)newattr;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: pagecache_procfs_stat
+ *
+ * Description: Return information about a file or directory
+ *
+ ****************************************************************************/
+
+static int pagecache_procfs_stat(FAR const char *relpath,
+                                 FAR struct stat *buf)
+{
+  /* "fs/pagecache" is the name for a read-only file */
+
+  memset(buf, 0, sizeof(struct stat));
+  buf->st_mode = S_IFREG | S_IROTH | S_IRGRP | S_IRUSR;
+  return OK;
+}
+
+#endif /* !CONFIG_DISABLE_MOUNTPOINT && CONFIG_FS_PROCFS && ... */
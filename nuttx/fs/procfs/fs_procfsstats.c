@@ -0,0 +1,796 @@
+/****************************************************************************
+ * fs/procfs/fs_procfsstats.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <assert.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <nuttx/clock.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/procstats.h>
+#include <nuttx/sched.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/procfs.h>
+#include <nuttx/mm/iob.h>
+#include <nuttx/mm/mm.h>
+#include <nuttx/net/netdev.h>
+
+#include "fs_heap.h"
+
+#if !defined(CONFIG_DISABLE_MOUNTPOINT) && defined(CONFIG_FS_PROCFS) && \
+    !defined(CONFIG_FS_PROCFS_EXCLUDE_STATS)
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#if CONFIG_FS_PROCFS_STATS_DELTA > 0
+#  define STATS_HAVE_DELTA 1
+#endif
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+#ifdef STATS_HAVE_DELTA
+/* The last reported state of one object, for delta snapshots */
+
+struct stats_prev_s
+{
+  uint32_t id;                    /* Id of the object */
+  uint32_t sum;                   /* Hash of the last reported record */
+  uint16_t type;                  /* Record type, 0 if the entry is free */
+  bool seen;                      /* Object is in the current snapshot */
+};
+#endif
+
+/* This structure describes one open "file" */
+
+struct stats_file_s
+{
+  struct procfs_file_s base;      /* Base open file structure */
+  uint32_t seq;                   /* Number of snapshots taken */
+#ifdef STATS_HAVE_DELTA
+  bool delta;                     /* Report only the changed records */
+  struct stats_prev_s prev[CONFIG_FS_PROCFS_STATS_DELTA];
+#endif
+};
+
+/* This structure carries the read state across the record helpers */
+
+struct stats_read_s
+{
+  FAR struct stats_file_s *attr;  /* Open file state */
+  FAR char *buffer;               /* User buffer */
+  size_t buflen;                  /* Size of the user buffer */
+  size_t totalsize;               /* Bytes stored in the user buffer */
+  uint32_t nrecords;              /* Number of records stored */
+  uint32_t index;                 /* Id of the next heap or device */
+  uint16_t flags;                 /* PROCSTATS_FLAG_* of the snapshot */
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+/* File system methods */
+
+static int     stats_open(FAR struct file *filep, FAR const char *relpath,
+                 int oflags, mode_t mode);
+static int     stats_close(FAR struct file *filep);
+static ssize_t stats_read(FAR struct file *filep, FAR char *buffer,
+                 size_t buflen);
+static ssize_t stats_write(FAR struct file *filep, FAR const char *buffer,
+                 size_t buflen);
+static int     stats_dup(FAR const struct file *oldp,
+                 FAR struct file *newp);
+static int     stats_stat(FAR const char *relpath, FAR struct stat *buf);
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+/* See fs_mount.c -- this structure is explicitly externed there.
+ * We use the old-fashioned kind of initializers so that this will compile
+ * with any compiler.
+ */
+
+const struct procfs_operations g_stats_operations =
+{
+  stats_open,         /* open */
+  stats_close,        /* close */
+  stats_read,         /* read */
+  stats_write,        /* write */
+  NULL,               /* poll */
+
+  stats_dup,          /* dup */
+
+  NULL,               /* opendir */
+  NULL,               /* closedir */
+  NULL,               /* readdir */
+  NULL,               /* rewinddir */
+
+  stats_stat          /* stat */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: stats_open
+ ****************************************************************************/
+
+static int stats_open(FAR struct file *filep, FAR const char *relpath,
+                      int oflags, mode_t mode)
+{
+  FAR struct stats_file_s *attr;
+
+  finfo("Open '%s'\n", relpath);
+
+  /* Allocate a container to hold the file attributes.  Write access is
+   * permitted:  Writes select full or delta snapshots.  Nothing is
+   * allocated when a snapshot is read.
+   */
+
+  attr = fs_heap_zalloc(sizeof(struct stats_file_s));
+  if (!attr)
+    {
+      ferr("ERROR: Failed to allocate file attributes\n");
+      return -ENOMEM;
+    }
+
+  /* Save the attributes as the open-specific state in filep->f_priv */
+
+  filep->f_priv = (FAR void *)attr;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: stats_close
+ ****************************************************************************/
+
+static int stats_close(FAR struct file *filep)
+{
+  FAR struct stats_file_s *attr;
+
+  /* Recover our private data from the struct file instance */
+
+  attr = (FAR struct stats_file_s *)filep->f_priv;
+  DEBUGASSERT(attr);
+
+  /* Release the file attributes structure */
+
+  fs_heap_free(attr);
+  filep->f_priv = NULL;
+  return OK;
+}
+
+#ifdef STATS_HAVE_DELTA
+/****************************************************************************
+ * Name: stats_hash
+ *
+ * Description:
+ *   FNV-1a hash of the payload of a record.
+ *
+ ****************************************************************************/
+
+static uint32_t stats_hash(FAR const struct procstats_rec_s *rec)
+{
+  FAR const uint8_t *ptr = (FAR const uint8_t *)(rec + 1);
+  FAR const uint8_t *end = (FAR const uint8_t *)rec + rec->size;
+  uint32_t hash = 2166136261u;
+
+  while (ptr < end)
+    {
+      hash = (hash ^ *ptr++) * 16777619u;
+    }
+
+  return hash;
+}
+
+/****************************************************************************
+ * Name: stats_find
+ ****************************************************************************/
+
+static FAR struct stats_prev_s *
+stats_find(FAR struct stats_file_s *attr, uint16_t type, uint32_t id)
+{
+  int i;
+
+  for (i = 0; i < CONFIG_FS_PROCFS_STATS_DELTA; i++)
+    {
+      if (attr->prev[i].type == type && attr->prev[i].id == id)
+        {
+          return &attr->prev[i];
+        }
+    }
+
+  return NULL;
+}
+#endif
+
+/****************************************************************************
+ * Name: stats_store
+ *
+ * Description:
+ *   Copy a record to the user buffer.  The record is dropped if it does not
+ *   fit.
+ *
+ ****************************************************************************/
+
+static bool stats_store(FAR struct stats_read_s *rd,
+                        FAR const struct procstats_rec_s *rec)
+{
+  if (rec->size > rd->buflen - rd->totalsize)
+    {
+      rd->flags |= PROCSTATS_FLAG_TRUNCATED;
+      return false;
+    }
+
+  memcpy(rd->buffer + rd->totalsize, rec, rec->size);
+  rd->totalsize += rec->size;
+  rd->nrecords++;
+  return true;
+}
+
+/****************************************************************************
+ * Name: stats_emit
+ *
+ * Description:
+ *   Report a record.  In delta mode, a record is only reported if the
+ *   object is new or has changed since it was last reported.
+ *
+ ****************************************************************************/
+
+static void stats_emit(FAR struct stats_read_s *rd, uint16_t type,
+                       uint32_t id, FAR struct procstats_rec_s *rec,
+                       size_t size)
+{
+#ifdef STATS_HAVE_DELTA
+  FAR struct stats_file_s *attr = rd->attr;
+  FAR struct stats_prev_s *prev;
+  uint32_t sum;
+#endif
+
+  rec->type = type;
+  rec->size = size;
+  rec->id   = id;
+
+#ifdef STATS_HAVE_DELTA
+  if (!attr->delta)
+    {
+      stats_store(rd, rec);
+      return;
+    }
+
+  sum  = stats_hash(rec);
+  prev = stats_find(attr, type, id);
+  if (prev != NULL)
+    {
+      prev->seen = true;
+      if (prev->sum != sum && stats_store(rd, rec))
+        {
+          prev->sum = sum;
+        }
+    }
+  else if (stats_store(rd, rec))
+    {
+      /* Remember the object if there is room, objects that are not
+       * remembered are reported in every snapshot.
+       */
+
+      prev = stats_find(attr, 0, 0);
+      if (prev != NULL)
+        {
+          prev->id   = id;
+          prev->sum  = sum;
+          prev->type = type;
+          prev->seen = true;
+        }
+    }
+#else
+  stats_store(rd, rec);
+#endif
+}
+
+#ifdef STATS_HAVE_DELTA
+/****************************************************************************
+ * Name: stats_read_gone
+ *
+ * Description:
+ *   Report the objects of the previous snapshots that no longer exist.
+ *
+ ****************************************************************************/
+
+static void stats_read_gone(FAR struct stats_read_s *rd)
+{
+  FAR struct stats_prev_s *prev;
+  struct procstats_gone_s gone;
+  int i;
+
+  memset(&gone, 0, sizeof(gone));
+  gone.rec.type = PROCSTATS_GONE;
+  gone.rec.size = sizeof(gone);
+
+  for (i = 0; i < CONFIG_FS_PROCFS_STATS_DELTA; i++)
+    {
+      prev = &rd->attr->prev[i];
+      if (prev->type != 0 && !prev->seen)
+        {
+          gone.rec.id = prev->id;
+          gone.type   = prev->type;
+
+          /* Retry in the next snapshot if it does not fit */
+
+          if (stats_store(rd, &gone.rec))
+            {
+              prev->id   = 0;
+              prev->type = 0;
+            }
+        }
+
+      prev->seen = false;
+    }
+}
+#endif
+
+/****************************************************************************
+ * Name: stats_read_task
+ *
+ * Description:
+ *   nxsched_foreach() callback that copies the fields of one TCB to the
+ *   free part of the user buffer.  It runs in a critical section, so the
+ *   record is completed and filtered later by stats_read_tasks().
+ *
+ ****************************************************************************/
+
+static void stats_read_task(FAR struct tcb_s *tcb, FAR void *arg)
+{
+  FAR struct stats_read_s *rd = arg;
+  struct procstats_task_s task;
+
+  if (sizeof(task) > rd->buflen - rd->totalsize)
+    {
+      rd->flags |= PROCSTATS_FLAG_TRUNCATED;
+      return;
+    }
+
+  memset(&task, 0, sizeof(task));
+  task.rec.id    = tcb->pid;
+  task.group     = tcb->group ? tcb->group->tg_pid : -1;
+  task.flags     = tcb->flags;
+  task.state     = tcb->task_state;
+  task.priority  = tcb->sched_priority;
+#ifdef CONFIG_SMP
+  task.cpu       = tcb->cpu;
+#endif
+  task.stacksize = tcb->adj_stack_size;
+  strlcpy(task.name, get_task_name(tcb), sizeof(task.name));
+
+  memcpy(rd->buffer + rd->totalsize, &task, sizeof(task));
+  rd->totalsize += sizeof(task);
+}
+
+/****************************************************************************
+ * Name: stats_read_tasks
+ *
+ * Description:
+ *   Generate the records of all tasks.  The TCB fields are collected first,
+ *   the CPU load, the delta filtering and the final placement of each
+ *   record follow outside of the critical section of the task walk.
+ *
+ ****************************************************************************/
+
+static void stats_read_tasks(FAR struct stats_read_s *rd)
+{
+  struct procstats_task_s task;
+#ifndef CONFIG_SCHED_CPULOAD_NONE
+  struct cpuload_s cpuload;
+#endif
+  size_t offset = rd->totalsize;
+  size_t end;
+#ifdef STATS_HAVE_DELTA
+  int i;
+#endif
+
+  nxsched_foreach(stats_read_task, rd);
+
+  /* The records are emitted over the collected ones, which never moves a
+   * record forward.  The collected record is copied out first, it may not
+   * be aligned.
+   */
+
+  end           = rd->totalsize;
+  rd->totalsize = offset;
+
+  for (; offset < end; offset += sizeof(task))
+    {
+      memcpy(&task, rd->buffer + offset, sizeof(task));
+
+#ifndef CONFIG_SCHED_CPULOAD_NONE
+      if (clock_cpuload(task.rec.id, &cpuload) >= 0)
+        {
+          task.load_active = cpuload.active;
+          task.load_total  = cpuload.total;
+        }
+#endif
+
+      stats_emit(rd, PROCSTATS_TASK, task.rec.id, &task.rec, sizeof(task));
+    }
+
+#ifdef STATS_HAVE_DELTA
+  /* The tasks that did not fit were not seen, but they may still exist */
+
+  if ((rd->flags & PROCSTATS_FLAG_TRUNCATED) != 0)
+    {
+      for (i = 0; i < CONFIG_FS_PROCFS_STATS_DELTA; i++)
+        {
+          if (rd->attr->prev[i].type == PROCSTATS_TASK)
+            {
+              rd->attr->prev[i].seen = true;
+            }
+        }
+    }
+#endif
+}
+
+#ifndef CONFIG_SCHED_CPULOAD_NONE
+/****************************************************************************
+ * Name: stats_read_cpu
+ *
+ * Description:
+ *   Generate the records of the CPUs from the load of their IDLE threads.
+ *
+ ****************************************************************************/
+
+static void stats_read_cpu(FAR struct stats_read_s *rd)
+{
+  struct procstats_cpu_s cpu;
+  struct cpuload_s cpuload;
+  int i;
+
+  for (i = 0; i < CONFIG_SMP_NCPUS; i++)
+    {
+      memset(&cpu, 0, sizeof(cpu));
+      if (clock_cpuload(i, &cpuload) >= 0)
+        {
+          cpu.load_active = cpuload.total - cpuload.active;
+          cpu.load_total  = cpuload.total;
+        }
+
+      stats_emit(rd, PROCSTATS_CPU, i, &cpu.rec, sizeof(cpu));
+    }
+}
+#endif
+
+#ifndef CONFIG_FS_PROCFS_EXCLUDE_MEMINFO
+/****************************************************************************
+ * Name: stats_read_heap
+ *
+ * Description:
+ *   procfs_foreach_meminfo() callback that generates the record of one
+ *   heap.
+ *
+ ****************************************************************************/
+
+static void stats_read_heap(FAR struct procfs_meminfo_entry_s *entry,
+                            FAR void *arg)
+{
+  FAR struct stats_read_s *rd = arg;
+  struct procstats_heap_s heap;
+  struct mallinfo info;
+
+  /* Reclaim the delay list first, like meminfo */
+
+  mm_free_delaylist(entry->heap);
+  info = mm_mallinfo(entry->heap);
+
+  memset(&heap, 0, sizeof(heap));
+  heap.total   = info.arena;
+  heap.used    = info.uordblks;
+  heap.free    = info.fordblks;
+  heap.maxused = info.usmblks;
+  heap.maxfree = info.mxordblk;
+  heap.nused   = info.aordblks;
+  heap.nfree   = info.ordblks;
+  strlcpy(heap.name, entry->name, sizeof(heap.name));
+
+  stats_emit(rd, PROCSTATS_HEAP, rd->index++, &heap.rec, sizeof(heap));
+}
+#endif
+
+#ifdef CONFIG_MM_IOB
+/****************************************************************************
+ * Name: stats_read_iob
+ ****************************************************************************/
+
+static void stats_read_iob(FAR struct stats_read_s *rd)
+{
+  struct procstats_iob_s iob;
+  struct iob_stats_s stats;
+
+  iob_getstats(&stats);
+
+  memset(&iob, 0, sizeof(iob));
+  iob.ntotal    = stats.ntotal;
+  iob.nfree     = stats.nfree;
+  iob.nwait     = stats.nwait;
+  iob.nthrottle = stats.nthrottle;
+
+  stats_emit(rd, PROCSTATS_IOB, 0, &iob.rec, sizeof(iob));
+}
+#endif
+
+#ifdef CONFIG_NETDEV_STATISTICS
+/****************************************************************************
+ * Name: stats_read_netdev
+ *
+ * Description:
+ *   netdev_statistics_foreach() callback that generates the record of one
+ *   network device.
+ *
+ ****************************************************************************/
+
+static int stats_read_netdev(FAR struct net_driver_s *dev, FAR void *arg)
+{
+  FAR struct stats_read_s *rd = arg;
+  FAR struct netdev_statistics_s *stats = &dev->d_statistics;
+  struct procstats_netdev_s netdev;
+
+  memset(&netdev, 0, sizeof(netdev));
+  netdev.flags       = dev->d_flags;
+  netdev.rx_packets  = stats->rx_packets;
+  netdev.rx_errors   = stats->rx_errors;
+  netdev.rx_dropped  = stats->rx_dropped;
+  netdev.tx_packets  = stats->tx_packets;
+  netdev.tx_done     = stats->tx_done;
+  netdev.tx_errors   = stats->tx_errors;
+  netdev.tx_timeouts = stats->tx_timeouts;
+  netdev.errors      = stats->errors;
+  netdev.rx_bytes    = stats->rx_bytes;
+  netdev.tx_bytes    = stats->tx_bytes;
+  strlcpy(netdev.name, dev->d_ifname, sizeof(netdev.name));
+
+#ifdef CONFIG_NETDEV_IFINDEX
+  stats_emit(rd, PROCSTATS_NETDEV, dev->d_ifindex, &netdev.rec,
+             sizeof(netdev));
+#else
+  stats_emit(rd, PROCSTATS_NETDEV, rd->index++, &netdev.rec,
+             sizeof(netdev));
+#endif
+  return 0;
+}
+#endif
+
+/****************************************************************************
+ * Name: stats_read
+ *
+ * Description:
+ *   A read at offset 0 returns one complete snapshot, records that do not
+ *   fit in the buffer are dropped and the snapshot is marked as truncated.
+ *   Any other read returns end-of-file, so a reader samples with pread()
+ *   at offset 0 or rewinds the file before every read.
+ *
+ ****************************************************************************/
+
+static ssize_t stats_read(FAR struct file *filep, FAR char *buffer,
+                          size_t buflen)
+{
+  struct procstats_hdr_s hdr;
+  struct stats_read_s rd;
+  struct timespec ts;
+
+  finfo("buffer=%p buflen=%d\n", buffer, (int)buflen);
+
+  if (filep->f_pos != 0)
+    {
+      return 0;
+    }
+
+  if (buflen < sizeof(hdr))
+    {
+      return -EINVAL;
+    }
+
+  /* Recover our private data from the struct file instance */
+
+  rd.attr      = (FAR struct stats_file_s *)filep->f_priv;
+  rd.buffer    = buffer;
+  rd.buflen    = buflen;
+  rd.totalsize = sizeof(hdr);
+  rd.nrecords  = 0;
+  rd.index     = 0;
+  rd.flags     = 0;
+  DEBUGASSERT(rd.attr);
+
+  clock_systime_timespec(&ts);
+
+  /* Generate the records straight into the user buffer */
+
+  stats_read_tasks(&rd);
+
+#ifndef CONFIG_SCHED_CPULOAD_NONE
+  stats_read_cpu(&rd);
+#endif
+
+#ifndef CONFIG_FS_PROCFS_EXCLUDE_MEMINFO
+  procfs_foreach_meminfo(stats_read_heap, &rd);
+#endif
+
+#ifdef CONFIG_MM_IOB
+  stats_read_iob(&rd);
+#endif
+
+#ifdef CONFIG_NETDEV_STATISTICS
+  rd.index = 0;
+  netdev_statistics_foreach(stats_read_netdev, &rd);
+#endif
+
+#ifdef STATS_HAVE_DELTA
+  if (rd.attr->delta)
+    {
+      stats_read_gone(&rd);
+      rd.flags |= PROCSTATS_FLAG_DELTA;
+    }
+#endif
+
+  /* And finally the header */
+
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic    = PROCSTATS_MAGIC;
+  hdr.version  = PROCSTATS_VERSION;
+  hdr.flags    = rd.flags;
+  hdr.size     = rd.totalsize;
+  hdr.nrecords = rd.nrecords;
+  hdr.seq      = rd.attr->seq++;
+  hdr.uptime   = (uint64_t)ts.tv_sec * USEC_PER_SEC +
+                 ts.tv_nsec / NSEC_PER_USEC;
+  memcpy(buffer, &hdr, sizeof(hdr));
+
+  filep->f_pos += rd.totalsize;
+  return rd.totalsize;
+}
+
+/****************************************************************************
+ * Name: stats_write
+ *
+ * Description:
+ *   "full" selects full snapshots, "delta" selects snapshots of the objects
+ *   that changed since the previous snapshot of this open file.
+ *
+ ****************************************************************************/
+
+static ssize_t stats_write(FAR struct file *filep, FAR const char *buffer,
+                           size_t buflen)
+{
+  FAR struct stats_file_s *attr;
+  size_t len = buflen;
+
+  attr = (FAR struct stats_file_s *)filep->f_priv;
+  DEBUGASSERT(attr);
+
+  /* Ignore a trailing newline, as written by echo */
+
+  if (len > 0 && buffer[len - 1] == '\n')
+    {
+      len--;
+    }
+
+  if (len == strlen(PROCSTATS_CMD_FULL) &&
+      memcmp(buffer, PROCSTATS_CMD_FULL, len) == 0)
+    {
+#ifdef STATS_HAVE_DELTA
+      attr->delta = false;
+#endif
+      return buflen;
+    }
+
+#ifdef STATS_HAVE_DELTA
+  if (len == strlen(PROCSTATS_CMD_DELTA) &&
+      memcmp(buffer, PROCSTATS_CMD_DELTA, len) == 0)
+    {
+      /* The first delta snapshot reports all objects */
+
+      memset(attr->prev, 0, sizeof(attr->prev));
+      attr->delta = true;
+      return buflen;
+    }
+#endif
+
+  return -EINVAL;
+}
+
+/****************************************************************************
+ * Name: stats_dup
+ *
+ * Description:
+ *   Duplicate open file data in the new file structure.
+ *
+ ****************************************************************************/
+
+static int stats_dup(FAR const struct file *oldp, FAR struct file *newp)
+{
+  FAR struct stats_file_s *oldattr;
+  FAR struct stats_file_s *newattr;
+
+  finfo("Dup %p->%p\n", oldp, newp);
+
+  /* Recover our private data from the old struct file instance */
+
+  oldattr = (FAR struct stats_file_s *)oldp->f_priv;
+  DEBUGASSERT(oldattr);
+
+  /* Allocate a new container to hold the task and attribute selection */
+
+  newattr = fs_heap_malloc(sizeof(struct stats_file_s));
+  if (!newattr)
+    {
+      ferr("ERROR: Failed to allocate file attributes\n");
+      return -ENOMEM;
+    }
+
+  /* The copy the file attributes from the old attributes to the new */
+
+  memcpy(newattr, oldattr, sizeof(struct stats_file_s));
+
+  /* Save the new attributes in the new file structure */
+
+  newp->f_priv = (FAR void *)newattr;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: stats_stat
+ *
+ * Description: Return information about a file or directory
+ *
+ ****************************************************************************/
+
+static int stats_stat(FAR const char *relpath, FAR struct stat *buf)
+{
+  /* "stats" is the name for a read/write file */
+
+  memset(buf, 0, sizeof(struct stat));
+  buf->st_mode = S_IFREG | S_IROTH | S_IRGRP | S_IRUSR | S_IWUSR;
+  return OK;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+#endif /* !CONFIG_DISABLE_MOUNTPOINT && CONFIG_FS_PROCFS &&
+        * !CONFIG_FS_PROCFS_EXCLUDE_STATS */
@@ -149,7 +149,9 @@ const struct mountpt_operations g_romfs_operations =
   NULL,            /* rmdir */
   NULL,            /* rename */
   romfs_stat,      /* stat */
-  NULL             /* chstat */
+  NULL,            /* chstat */
+  NULL,            /* syncfs */
+  MNTPT_FLAG_DCACHE /* flags */
 };
 
 /****************************************************************************
@@ -666,6 +668,26 @@ static int romfs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
           return -ENXIO;
         }
     }
+  else if (cmd == FIOC_MEMREGION)
+    {
+      FAR struct romfs_mountpt_s *rm = filep->f_inode->i_private;
+      FAR struct file_memregion_s *region =
+        (FAR struct file_memregion_s *)((uintptr_t)arg);
+
+      if (rm->rm_xipbase == NULL)
+        {
+          return -ENXIO;
+        }
+      else if (region->offset < 0)
+        {
+          return -EINVAL;
+        }
+
+      region->addr = rm->rm_xipbase + rf->rf_startoffset + region->offset;
+      region->len  = region->offset < rf->rf_size ?
+                     rf->rf_size - region->offset : 0;
+      return 0;
+    }
 
   return -ENOTTY;
 }
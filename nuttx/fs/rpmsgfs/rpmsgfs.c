@@ -73,6 +73,23 @@ struct rpmsgfs_ofile_s
   int16_t                    crefs;    /* Reference count */
   mode_t                     oflags;   /* Open mode */
   int                        fd;
+#if CONFIG_FS_RPMSGFS_CACHE > 0
+  FAR char                   *path;    /* Server path of the file */
+#endif
+#if CONFIG_FS_RPMSGFS_READAHEAD > 0
+  FAR char                   *rabuf;   /* Buffer reads are served from */
+  FAR char                   *rafill;  /* Buffer being prefetched into */
+  off_t                      rapos;    /* File position of rabuf[0] */
+  size_t                     ralen;    /* Valid bytes in rabuf */
+  off_t                      srvpos;   /* Position of fd on the server */
+  struct rpmsgfs_aio_s       raio;     /* Prefetch into rafill */
+#endif
+#if CONFIG_FS_RPMSGFS_WRITEBEHIND > 0
+  int                        error;    /* First failed write-behind */
+  uint8_t                    wbhead;   /* Oldest write in flight */
+  uint8_t                    wbcount;  /* Number of writes in flight */
+  struct rpmsgfs_aio_s       wbio[CONFIG_FS_RPMSGFS_WRITEBEHIND];
+#endif
 };
 
 /* This structure represents the overall mountpoint state.  An instance of
@@ -272,6 +289,290 @@ static void rpmsgfs_mkpath(FAR struct rpmsgfs_mountpt_s *fs,
     }
 }
 
+#if CONFIG_FS_RPMSGFS_READAHEAD > 0
+
+/****************************************************************************
+ * Name: rpmsgfs_ra_drop
+ *
+ * Description: Wait for the prefetch in flight and forget the buffered
+ *   data, the file position of the server is left where the last request
+ *   moved it.
+ *
+ ****************************************************************************/
+
+static void rpmsgfs_ra_drop(FAR struct rpmsgfs_mountpt_s *fs,
+                            FAR struct rpmsgfs_ofile_s *hf)
+{
+  ssize_t ret;
+
+  if (hf->raio.pending)
+    {
+      ret = rpmsgfs_client_wait(fs->handle, &hf->raio);
+      if (ret > 0 && hf->srvpos >= 0)
+        {
+          hf->srvpos += ret;
+        }
+    }
+
+  hf->rapos = hf->srvpos;
+  hf->ralen = 0;
+}
+
+/****************************************************************************
+ * Name: rpmsgfs_ra_seek
+ *
+ * Description: Drop the buffered data and move the file position of the
+ *   server to pos.
+ *
+ ****************************************************************************/
+
+static int rpmsgfs_ra_seek(FAR struct rpmsgfs_mountpt_s *fs,
+                           FAR struct rpmsgfs_ofile_s *hf, off_t pos)
+{
+  off_t ret;
+
+  rpmsgfs_ra_drop(fs, hf);
+  if (hf->srvpos != pos)
+    {
+      ret = rpmsgfs_client_lseek(fs->handle, hf->fd, pos, SEEK_SET);
+      if (ret < 0)
+        {
+          hf->srvpos = -1;
+          hf->rapos  = -1;
+          return ret;
+        }
+
+      hf->srvpos = ret;
+    }
+
+  hf->rapos = hf->srvpos;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: rpmsgfs_ra_complete
+ *
+ * Description: Wait for the prefetch in flight and make the buffer it
+ *   filled the one reads are served from.
+ *
+ ****************************************************************************/
+
+static ssize_t rpmsgfs_ra_complete(FAR struct rpmsgfs_mountpt_s *fs,
+                                   FAR struct rpmsgfs_ofile_s *hf)
+{
+  FAR char *buf;
+  ssize_t ret;
+
+  ret = rpmsgfs_client_wait(fs->handle, &hf->raio);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  hf->srvpos += ret;
+  hf->rapos  += hf->ralen;
+  hf->ralen   = ret;
+
+  buf        = hf->rabuf;
+  hf->rabuf  = hf->rafill;
+  hf->rafill = buf;
+  return ret;
+}
+
+/****************************************************************************
+ * Name: rpmsgfs_ra_read
+ *
+ * Description: Read through the readahead buffers.  A read continuing the
+ *   previous one is served from the buffered data, when that is used up
+ *   the next part of the file has mostly arrived already and the part
+ *   after it is requested before returning.  Other reads, and reads larger
+ *   than the buffers, go to the server directly.
+ *
+ ****************************************************************************/
+
+static ssize_t rpmsgfs_ra_read(FAR struct rpmsgfs_mountpt_s *fs,
+                               FAR struct rpmsgfs_ofile_s *hf, off_t pos,
+                               FAR char *buffer, size_t buflen)
+{
+  bool sequential = true;
+  size_t done = 0;
+  ssize_t ret = 0;
+  size_t off;
+
+  if (pos < hf->rapos || pos > hf->rapos + (off_t)hf->ralen)
+    {
+      ret = rpmsgfs_ra_seek(fs, hf, pos);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      sequential = false;
+    }
+
+  while (done < buflen)
+    {
+      off = pos + done - hf->rapos;
+      if (off < hf->ralen)
+        {
+          ret = MIN(hf->ralen - off, buflen - done);
+          memcpy(buffer + done, hf->rabuf + off, ret);
+          done += ret;
+          continue;
+        }
+
+      if (!hf->raio.pending)
+        {
+          if (hf->rabuf == NULL && sequential)
+            {
+              hf->rabuf = fs_heap_malloc(2 * CONFIG_FS_RPMSGFS_READAHEAD);
+              if (hf->rabuf != NULL)
+                {
+                  hf->rafill = hf->rabuf + CONFIG_FS_RPMSGFS_READAHEAD;
+                }
+            }
+
+          if (hf->rabuf == NULL || !sequential ||
+              buflen - done >= CONFIG_FS_RPMSGFS_READAHEAD)
+            {
+              ret = rpmsgfs_client_read(fs->handle, hf->fd, buffer + done,
+                                        buflen - done);
+              if (ret > 0)
+                {
+                  hf->srvpos += ret;
+                  done       += ret;
+                }
+
+              hf->rapos = hf->srvpos;
+              hf->ralen = 0;
+              break;
+            }
+
+          ret = rpmsgfs_client_read_start(fs->handle, hf->fd, hf->rafill,
+                                          CONFIG_FS_RPMSGFS_READAHEAD,
+                                          &hf->raio);
+          if (ret < 0)
+            {
+              break;
+            }
+        }
+
+      ret = rpmsgfs_ra_complete(fs, hf);
+      if (ret <= 0)
+        {
+          break;
+        }
+
+      /* A full buffer is no end of file, request the next part while the
+       * caller consumes this one.
+       */
+
+      if (ret == CONFIG_FS_RPMSGFS_READAHEAD)
+        {
+          rpmsgfs_client_read_start(fs->handle, hf->fd, hf->rafill,
+                                    CONFIG_FS_RPMSGFS_READAHEAD,
+                                    &hf->raio);
+        }
+    }
+
+  return done > 0 ? done : ret;
+}
+#endif
+
+#if CONFIG_FS_RPMSGFS_WRITEBEHIND > 0
+
+/****************************************************************************
+ * Name: rpmsgfs_wb_complete
+ *
+ * Description: Wait for the oldest write in flight and remember its
+ *   failure.  The server runs the writes in order, so their results arrive
+ *   in order too.
+ *
+ ****************************************************************************/
+
+static void rpmsgfs_wb_complete(FAR struct rpmsgfs_mountpt_s *fs,
+                                FAR struct rpmsgfs_ofile_s *hf)
+{
+  ssize_t ret;
+
+  ret = rpmsgfs_client_wait(fs->handle, &hf->wbio[hf->wbhead]);
+  if (ret < 0 && hf->error == 0)
+    {
+      hf->error = ret;
+    }
+
+  hf->wbhead = (hf->wbhead + 1) % CONFIG_FS_RPMSGFS_WRITEBEHIND;
+  hf->wbcount--;
+}
+
+/****************************************************************************
+ * Name: rpmsgfs_wb_flush
+ *
+ * Description: Wait for all writes in flight, return and clear the first
+ *   failure not reported yet.
+ *
+ ****************************************************************************/
+
+static int rpmsgfs_wb_flush(FAR struct rpmsgfs_mountpt_s *fs,
+                            FAR struct rpmsgfs_ofile_s *hf)
+{
+  int ret;
+
+  while (hf->wbcount > 0)
+    {
+      rpmsgfs_wb_complete(fs, hf);
+    }
+
+  ret = hf->error;
+  hf->error = 0;
+  return ret;
+}
+#endif
+
+/****************************************************************************
+ * Name: rpmsgfs_ofile_free
+ *
+ * Description: Wait for the requests of an open file still in flight and
+ *   release it.
+ *
+ ****************************************************************************/
+
+static int rpmsgfs_ofile_free(FAR struct rpmsgfs_mountpt_s *fs,
+                              FAR struct rpmsgfs_ofile_s *hf)
+{
+  int ret = OK;
+#if CONFIG_FS_RPMSGFS_WRITEBEHIND > 0
+  int i;
+#endif
+
+#if CONFIG_FS_RPMSGFS_READAHEAD > 0
+  rpmsgfs_ra_drop(fs, hf);
+  rpmsgfs_client_aio_fini(&hf->raio);
+  if (hf->rabuf != NULL)
+    {
+      fs_heap_free(MIN(hf->rabuf, hf->rafill));
+    }
+#endif
+
+#if CONFIG_FS_RPMSGFS_WRITEBEHIND > 0
+  ret = rpmsgfs_wb_flush(fs, hf);
+  for (i = 0; i < CONFIG_FS_RPMSGFS_WRITEBEHIND; i++)
+    {
+      rpmsgfs_client_aio_fini(&hf->wbio[i]);
+    }
+#endif
+
+#if CONFIG_FS_RPMSGFS_CACHE > 0
+  if (hf->path != NULL)
+    {
+      fs_heap_free(hf->path);
+    }
+#endif
+
+  fs_heap_free(hf);
+  return ret;
+}
+
 /****************************************************************************
  * Name: rpmsgfs_open
  ****************************************************************************/
@@ -284,6 +585,9 @@ static int rpmsgfs_open(FAR struct file *filep, FAR const char *relpath,
   FAR struct rpmsgfs_ofile_s  *hf;
   FAR char *path;
   int ret;
+#if CONFIG_FS_RPMSGFS_WRITEBEHIND > 0
+  int i;
+#endif
 
   /* Sanity checks */
 
@@ -315,17 +619,38 @@ static int rpmsgfs_open(FAR struct file *filep, FAR const char *relpath,
 
   /* Allocate memory for the open file */
 
-  hf = fs_heap_malloc(sizeof *hf);
+  hf = fs_heap_zalloc(sizeof *hf);
   if (hf == NULL)
     {
       ret = -ENOMEM;
       goto errout_with_lock;
     }
 
+#if CONFIG_FS_RPMSGFS_READAHEAD > 0
+  rpmsgfs_client_aio_init(&hf->raio);
+#endif
+#if CONFIG_FS_RPMSGFS_WRITEBEHIND > 0
+  for (i = 0; i < CONFIG_FS_RPMSGFS_WRITEBEHIND; i++)
+    {
+      rpmsgfs_client_aio_init(&hf->wbio[i]);
+    }
+#endif
+
   /* Append to the host's root directory */
 
   rpmsgfs_mkpath(fs, relpath, path, PATH_MAX);
 
+#if CONFIG_FS_RPMSGFS_CACHE > 0
+  /* Changes through this file must drop its cached stat() result */
+
+  hf->path = fs_heap_strdup(path);
+  if (hf->path == NULL)
+    {
+      ret = -ENOMEM;
+      goto errout_with_buffer;
+    }
+#endif
+
   /* Try to open the file in the host file system */
 
   hf->fd = rpmsgfs_client_open(fs->handle, path, oflags, mode);
@@ -337,6 +662,10 @@ static int rpmsgfs_open(FAR struct file *filep, FAR const char *relpath,
       goto errout_with_buffer;
     }
 
+#if CONFIG_FS_RPMSGFS_READAHEAD > 0
+  hf->srvpos = 0;
+#endif
+
   /* In write/append mode, we need to set the file pointer to the end of the
    * file.
    */
@@ -347,9 +676,14 @@ static int rpmsgfs_open(FAR struct file *filep, FAR const char *relpath,
       if (ret >= 0)
         {
           filep->f_pos = ret;
+#if CONFIG_FS_RPMSGFS_READAHEAD > 0
+          hf->srvpos = ret;
+          hf->rapos  = ret;
+#endif
         }
       else
         {
+          rpmsgfs_client_close(fs->handle, hf->fd);
           goto errout_with_buffer;
         }
     }
@@ -373,7 +707,7 @@ static int rpmsgfs_open(FAR struct file *filep, FAR const char *relpath,
   goto errout_with_lock;
 
 errout_with_buffer:
-  fs_heap_free(hf);
+  rpmsgfs_ofile_free(fs, hf);
 
 errout_with_lock:
   nxmutex_unlock(&fs->fs_lock);
@@ -398,6 +732,7 @@ static int rpmsgfs_close(FAR struct file *filep)
   FAR struct rpmsgfs_ofile_s   *nextfile;
   FAR struct rpmsgfs_ofile_s   *prevfile;
   int ret;
+  int fd;
 
   /* Sanity checks */
 
@@ -461,18 +796,19 @@ static int rpmsgfs_close(FAR struct file *filep)
         }
     }
 
-  /* Close the host file */
+  /* Wait for the requests in flight and close the host file */
 
-  rpmsgfs_client_close(fs->handle, hf->fd);
+  fd  = hf->fd;
+  ret = rpmsgfs_ofile_free(fs, hf);
+  rpmsgfs_client_close(fs->handle, fd);
 
   /* Now free the pointer */
 
   filep->f_priv = NULL;
-  fs_heap_free(hf);
 
 okout:
   nxmutex_unlock(&fs->fs_lock);
-  return OK;
+  return ret;
 }
 
 /****************************************************************************
@@ -509,7 +845,11 @@ static ssize_t rpmsgfs_read(FAR struct file *filep, FAR char *buffer,
 
   /* Call the host to perform the read */
 
+#if CONFIG_FS_RPMSGFS_READAHEAD > 0
+  ret = rpmsgfs_ra_read(fs, hf, filep->f_pos, buffer, buflen);
+#else
   ret = rpmsgfs_client_read(fs->handle, hf->fd, buffer, buflen);
+#endif
   if (ret > 0)
     {
       filep->f_pos += ret;
@@ -559,12 +899,61 @@ static ssize_t rpmsgfs_write(FAR struct file *filep, const char *buffer,
       goto errout_with_lock;
     }
 
+#if CONFIG_FS_RPMSGFS_READAHEAD > 0
+  /* The server position is ahead of the file position after readahead */
+
+  ret = rpmsgfs_ra_seek(fs, hf, filep->f_pos);
+  if (ret < 0)
+    {
+      goto errout_with_lock;
+    }
+#endif
+
+#if CONFIG_FS_RPMSGFS_CACHE > 0
+  rpmsgfs_client_invalidate(fs->handle, hf->path);
+#endif
+
   /* Call the host to perform the write */
 
+#if CONFIG_FS_RPMSGFS_WRITEBEHIND > 0
+  /* Only wait for the oldest write when all slots are in flight.  A
+   * failure is returned by a later write, fsync() or close(), once for all
+   * the writes in flight when it is reported.
+   */
+
+  if (hf->wbcount == CONFIG_FS_RPMSGFS_WRITEBEHIND)
+    {
+      rpmsgfs_wb_complete(fs, hf);
+    }
+
+  if (hf->error < 0)
+    {
+      ret = rpmsgfs_wb_flush(fs, hf);
+      goto errout_with_lock;
+    }
+
+  ret = 0;
+  if (buflen > 0)
+    {
+      ret = rpmsgfs_client_write_start(fs->handle, hf->fd, buffer, buflen,
+                  &hf->wbio[(hf->wbhead + hf->wbcount) %
+                            CONFIG_FS_RPMSGFS_WRITEBEHIND]);
+      if (ret >= 0)
+        {
+          hf->wbcount++;
+          ret = buflen;
+        }
+    }
+#else
   ret = rpmsgfs_client_write(fs->handle, hf->fd, buffer, buflen);
+#endif
   if (ret > 0)
     {
       filep->f_pos += ret;
+#if CONFIG_FS_RPMSGFS_READAHEAD > 0
+      hf->srvpos = (hf->oflags & O_APPEND) ? -1 : filep->f_pos;
+      hf->rapos  = hf->srvpos;
+#endif
     }
 
 errout_with_lock:
@@ -605,7 +994,38 @@ static off_t rpmsgfs_seek(FAR struct file *filep, off_t offset, int whence)
 
   /* Call our internal routine to perform the seek */
 
+#if CONFIG_FS_RPMSGFS_READAHEAD > 0
+  /* Seeks relative to the file position are resolved here, they need no
+   * round trip at all when the target is buffered.
+   */
+
+  if (whence == SEEK_SET || whence == SEEK_CUR)
+    {
+      ret = whence == SEEK_CUR ? filep->f_pos + offset : offset;
+      if (ret < 0)
+        {
+          ret = -EINVAL;
+        }
+      else if (ret < hf->rapos || ret > hf->rapos + (off_t)hf->ralen)
+        {
+          off_t err = rpmsgfs_ra_seek(fs, hf, ret);
+
+          if (err < 0)
+            {
+              ret = err;
+            }
+        }
+    }
+  else
+    {
+      rpmsgfs_ra_drop(fs, hf);
+      ret = rpmsgfs_client_lseek(fs->handle, hf->fd, offset, whence);
+      hf->srvpos = ret < 0 ? -1 : ret;
+      hf->rapos  = hf->srvpos;
+    }
+#else
   ret = rpmsgfs_client_lseek(fs->handle, hf->fd, offset, whence);
+#endif
   if (ret >= 0)
     {
       filep->f_pos = ret;
@@ -646,6 +1066,15 @@ static int rpmsgfs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
       return ret;
     }
 
+#if CONFIG_FS_RPMSGFS_READAHEAD > 0
+  ret = rpmsgfs_ra_seek(fs, hf, filep->f_pos);
+  if (ret < 0)
+    {
+      nxmutex_unlock(&fs->fs_lock);
+      return ret;
+    }
+#endif
+
   /* Call our internal routine to perform the ioctl */
 
   ret = rpmsgfs_client_ioctl(fs->handle, hf->fd, cmd, arg);
@@ -693,10 +1122,14 @@ static int rpmsgfs_sync(FAR struct file *filep)
       return ret;
     }
 
+#if CONFIG_FS_RPMSGFS_WRITEBEHIND > 0
+  ret = rpmsgfs_wb_flush(fs, hf);
+#endif
+
   rpmsgfs_client_sync(fs->handle, hf->fd);
 
   nxmutex_unlock(&fs->fs_lock);
-  return OK;
+  return ret;
 }
 
 /****************************************************************************
@@ -816,6 +1249,9 @@ static int rpmsgfs_fchstat(FAR const struct file *filep,
   /* Call the host to perform the change */
 
   ret = rpmsgfs_client_fchstat(fs->handle, hf->fd, buf, flags);
+#if CONFIG_FS_RPMSGFS_CACHE > 0
+  rpmsgfs_client_invalidate(fs->handle, hf->path);
+#endif
 
   nxmutex_unlock(&fs->fs_lock);
   return ret;
@@ -854,9 +1290,16 @@ static int rpmsgfs_truncate(FAR struct file *filep, off_t length)
       return ret;
     }
 
+#if CONFIG_FS_RPMSGFS_READAHEAD > 0
+  rpmsgfs_ra_drop(fs, hf);
+#endif
+
   /* Call the host to perform the truncate */
 
   ret = rpmsgfs_client_ftruncate(fs->handle, hf->fd, length);
+#if CONFIG_FS_RPMSGFS_CACHE > 0
+  rpmsgfs_client_invalidate(fs->handle, hf->path);
+#endif
 
   nxmutex_unlock(&fs->fs_lock);
   return ret;
@@ -31,6 +31,9 @@
 #include <sys/stat.h>
 #include <sys/statfs.h>
 #include <sys/param.h>
+#include <sys/uio.h>
+
+#include <nuttx/semaphore.h>
 
 /****************************************************************************
  * Pre-processor definitions
@@ -60,6 +63,7 @@
 #define RPMSGFS_STAT            20
 #define RPMSGFS_FCHSTAT         21
 #define RPMSGFS_CHSTAT          22
+#define RPMSGFS_INVALIDATE      23
 
 /****************************************************************************
  * Public Types
@@ -216,6 +220,32 @@ begin_packed_struct struct rpmsgfs_fchstat_s
 
 #define rpmsgfs_chstat_s rpmsgfs_fchstat_s
 
+/* Sent by the server without a cookie when another client changed the
+ * object at pathname, an empty pathname drops every cached entry.
+ */
+
+#define rpmsgfs_invalidate_s rpmsgfs_opendir_s
+
+/* Completion state of one request.  An asynchronous read or write is owned
+ * by the caller from rpmsgfs_client_read_start() or
+ * rpmsgfs_client_write_start() until rpmsgfs_client_wait() returned.
+ */
+
+struct rpmsgfs_cookie_s
+{
+  sem_t                   sem;
+  int                     result;
+  FAR void                *data;
+};
+
+struct rpmsgfs_aio_s
+{
+  struct rpmsgfs_cookie_s cookie;
+  struct iovec            iov;      /* Data read or size written */
+  uint32_t                command;  /* RPMSGFS_READ or RPMSGFS_WRITE */
+  bool                    pending;  /* Sent and not waited for */
+};
+
 /****************************************************************************
  * Internal function prototypes
  ****************************************************************************/
@@ -227,6 +257,16 @@ ssize_t   rpmsgfs_client_read(FAR void *handle, int fd,
                               FAR void *buf, size_t count);
 ssize_t   rpmsgfs_client_write(FAR void *handle, int fd,
                                FAR const void *buf, size_t count);
+void      rpmsgfs_client_aio_init(FAR struct rpmsgfs_aio_s *aio);
+void      rpmsgfs_client_aio_fini(FAR struct rpmsgfs_aio_s *aio);
+int       rpmsgfs_client_read_start(FAR void *handle, int fd,
+                                    FAR void *buf, size_t count,
+                                    FAR struct rpmsgfs_aio_s *aio);
+int       rpmsgfs_client_write_start(FAR void *handle, int fd,
+                                     FAR const void *buf, size_t count,
+                                     FAR struct rpmsgfs_aio_s *aio);
+ssize_t   rpmsgfs_client_wait(FAR void *handle,
+                              FAR struct rpmsgfs_aio_s *aio);
 off_t     rpmsgfs_client_lseek(FAR void *handle, int fd,
                                off_t offset, int whence);
 int       rpmsgfs_client_ioctl(FAR void *handle, int fd,
@@ -257,6 +297,7 @@ int       rpmsgfs_client_stat(FAR void *handle, FAR const char *path,
                               FAR struct stat *buf);
 int       rpmsgfs_client_chstat(FAR void *handle, FAR const char *path,
                                 FAR const struct stat *buf, int flags);
+void      rpmsgfs_client_invalidate(FAR void *handle, FAR const char *path);
 
 /****************************************************************************
  * Public Function Prototypes
@@ -32,30 +32,54 @@
 #include <termios.h>
 #include <fcntl.h>
 
+#include <nuttx/clock.h>
+#include <nuttx/crc32.h>
 #include <nuttx/kmalloc.h>
 #include <nuttx/fs/ioctl.h>
+#include <nuttx/mutex.h>
 #include <nuttx/rpmsg/rpmsg.h>
 #include <nuttx/semaphore.h>
 
 #include "rpmsgfs.h"
 #include "fs_heap.h"
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#if CONFIG_FS_RPMSGFS_CACHE > 0
+#  define RPMSGFS_CACHE_TICKS MSEC2TICK(CONFIG_FS_RPMSGFS_CACHE_TIMEOUT)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
 
+#if CONFIG_FS_RPMSGFS_CACHE > 0
+
+/* One cached stat() result, result is 0 or the error of the lookup */
+
+struct rpmsgfs_cache_s
+{
+  FAR char              *path;
+  uint32_t              hash;
+  int                   result;
+  clock_t               time;
+  struct stat           buf;
+};
+#endif
+
 struct rpmsgfs_s
 {
   struct rpmsg_endpoint ept;
   char                  cpuname[RPMSG_NAME_SIZE];
   sem_t                 wait;
-};
-
-struct rpmsgfs_cookie_s
-{
-  sem_t    sem;
-  int      result;
-  FAR void *data;
+#if CONFIG_FS_RPMSGFS_CACHE > 0
+  mutex_t               cache_lock;
+  uint32_t              cache_gen;  /* Incremented by every invalidation */
+  int                   cache_next; /* Next entry to replace */
+  struct rpmsgfs_cache_s cache[CONFIG_FS_RPMSGFS_CACHE];
+#endif
 };
 
 /****************************************************************************
@@ -80,6 +104,9 @@ static int rpmsgfs_statfs_handler(FAR struct rpmsg_endpoint *ept,
 static int rpmsgfs_stat_handler(FAR struct rpmsg_endpoint *ept,
                                  FAR void *data, size_t len,
                                  uint32_t src, FAR void *priv);
+static int rpmsgfs_invalidate_handler(FAR struct rpmsg_endpoint *ept,
+                                      FAR void *data, size_t len,
+                                      uint32_t src, FAR void *priv);
 static void rpmsgfs_device_created(struct rpmsg_device *rdev,
                                    FAR void *priv_);
 static void rpmsgfs_device_destroy(struct rpmsg_device *rdev,
@@ -120,6 +147,7 @@ static const rpmsg_ept_cb g_rpmsgfs_handler[] =
   [RPMSGFS_STAT]      = rpmsgfs_stat_handler,
   [RPMSGFS_FCHSTAT]   = rpmsgfs_default_handler,
   [RPMSGFS_CHSTAT]    = rpmsgfs_default_handler,
+  [RPMSGFS_INVALIDATE] = rpmsgfs_invalidate_handler,
 };
 
 /****************************************************************************
@@ -276,6 +304,165 @@ static int rpmsgfs_stat_handler(FAR struct rpmsg_endpoint *ept,
   return 0;
 }
 
+static int rpmsgfs_invalidate_handler(FAR struct rpmsg_endpoint *ept,
+                                      FAR void *data, size_t len,
+                                      uint32_t src, FAR void *priv)
+{
+  FAR struct rpmsgfs_invalidate_s *msg = data;
+
+  if (len > sizeof(*msg))
+    {
+      /* Terminate the path in case the message was cut */
+
+      ((FAR char *)data)[len - 1] = '\0';
+      rpmsgfs_client_invalidate(priv, msg->pathname);
+    }
+
+  return 0;
+}
+
+#if CONFIG_FS_RPMSGFS_CACHE > 0
+
+/* Entries are keyed by the path without trailing slashes, so the parent of
+ * "/data/file" and the root "/data/" of a mount share the key "/data".
+ */
+
+static uint32_t rpmsgfs_cache_key(FAR const char *path, FAR size_t *len)
+{
+  size_t n = strlen(path);
+
+  while (n > 1 && path[n - 1] == '/')
+    {
+      n--;
+    }
+
+  *len = n;
+  return crc32((FAR const uint8_t *)path, n);
+}
+
+static FAR struct rpmsgfs_cache_s *
+rpmsgfs_cache_find(FAR struct rpmsgfs_s *priv, FAR const char *path,
+                   size_t len, uint32_t hash)
+{
+  int i;
+
+  for (i = 0; i < CONFIG_FS_RPMSGFS_CACHE; i++)
+    {
+      FAR struct rpmsgfs_cache_s *entry = &priv->cache[i];
+
+      if (entry->path != NULL && entry->hash == hash &&
+          strncmp(entry->path, path, len) == 0 && entry->path[len] == '\0')
+        {
+          return entry;
+        }
+    }
+
+  return NULL;
+}
+
+static bool rpmsgfs_cache_lookup(FAR struct rpmsgfs_s *priv,
+                                 FAR const char *path,
+                                 FAR struct stat *buf, FAR int *result)
+{
+  FAR struct rpmsgfs_cache_s *entry;
+  uint32_t hash;
+  size_t len;
+  bool found = false;
+
+  hash = rpmsgfs_cache_key(path, &len);
+
+  nxmutex_lock(&priv->cache_lock);
+  entry = rpmsgfs_cache_find(priv, path, len, hash);
+  if (entry != NULL)
+    {
+      if (clock_systime_ticks() - entry->time <= RPMSGFS_CACHE_TICKS)
+        {
+          *buf    = entry->buf;
+          *result = entry->result;
+          found   = true;
+        }
+      else
+        {
+          fs_heap_free(entry->path);
+          entry->path = NULL;
+        }
+    }
+
+  nxmutex_unlock(&priv->cache_lock);
+  return found;
+}
+
+/* Remember the result of a stat() sent while the cache generation was gen,
+ * unless an invalidation arrived while it was in flight.
+ */
+
+static void rpmsgfs_cache_enter(FAR struct rpmsgfs_s *priv,
+                                FAR const char *path, uint32_t gen,
+                                FAR const struct stat *buf, int result)
+{
+  FAR struct rpmsgfs_cache_s *entry;
+  FAR char *copy;
+  uint32_t hash;
+  size_t len;
+
+  if (result < 0 && result != -ENOENT)
+    {
+      return;
+    }
+
+  hash = rpmsgfs_cache_key(path, &len);
+  copy = fs_heap_strndup(path, len);
+  if (copy == NULL)
+    {
+      return;
+    }
+
+  nxmutex_lock(&priv->cache_lock);
+  if (priv->cache_gen != gen)
+    {
+      nxmutex_unlock(&priv->cache_lock);
+      fs_heap_free(copy);
+      return;
+    }
+
+  entry = rpmsgfs_cache_find(priv, path, len, hash);
+  if (entry == NULL)
+    {
+      entry = &priv->cache[priv->cache_next];
+      priv->cache_next = (priv->cache_next + 1) % CONFIG_FS_RPMSGFS_CACHE;
+    }
+
+  if (entry->path != NULL)
+    {
+      fs_heap_free(entry->path);
+    }
+
+  entry->path   = copy;
+  entry->hash   = hash;
+  entry->result = result;
+  entry->time   = clock_systime_ticks();
+  if (result >= 0)
+    {
+      entry->buf = *buf;
+    }
+
+  nxmutex_unlock(&priv->cache_lock);
+}
+
+static void rpmsgfs_cache_free(FAR struct rpmsgfs_s *priv)
+{
+  int i;
+
+  for (i = 0; i < CONFIG_FS_RPMSGFS_CACHE; i++)
+    {
+      if (priv->cache[i].path != NULL)
+        {
+          fs_heap_free(priv->cache[i].path);
+        }
+    }
+}
+#endif
+
 static FAR void *rpmsgfs_get_tx_payload_buffer(FAR struct rpmsgfs_s *priv,
                                                FAR uint32_t *len)
 {
@@ -430,6 +617,7 @@ int rpmsgfs_client_open(FAR void *handle, FAR const char *pathname,
   FAR struct rpmsgfs_open_s *msg;
   uint32_t space;
   size_t len;
+  int ret;
 
   len = sizeof(*msg) + strlen(pathname) + 1;
 
@@ -445,8 +633,14 @@ int rpmsgfs_client_open(FAR void *handle, FAR const char *pathname,
   msg->mode  = mode;
   strlcpy(msg->pathname, pathname, space - sizeof(*msg));
 
-  return rpmsgfs_send_recv(priv, RPMSGFS_OPEN, false,
+  ret = rpmsgfs_send_recv(priv, RPMSGFS_OPEN, false,
           (struct rpmsgfs_header_s *)msg, len, NULL);
+  if (flags & (O_CREAT | O_TRUNC))
+    {
+      rpmsgfs_client_invalidate(priv, pathname);
+    }
+
+  return ret;
 }
 
 int rpmsgfs_client_close(FAR void *handle, int fd)
@@ -463,67 +657,115 @@ int rpmsgfs_client_close(FAR void *handle, int fd)
 ssize_t rpmsgfs_client_read(FAR void *handle, int fd,
                             FAR void *buf, size_t count)
 {
-  FAR struct rpmsgfs_s *priv = handle;
-  struct iovec read =
+  struct rpmsgfs_aio_s aio;
+  ssize_t ret;
+
+  if (!buf || count <= 0)
     {
-      .iov_base = buf,
-      .iov_len  = 0,
-    };
+      return 0;
+    }
 
-  struct rpmsgfs_cookie_s cookie;
-  struct rpmsgfs_read_s msg;
-  int ret = 0;
+  rpmsgfs_client_aio_init(&aio);
+  ret = rpmsgfs_client_read_start(handle, fd, buf, count, &aio);
+  if (ret >= 0)
+    {
+      ret = rpmsgfs_client_wait(handle, &aio);
+    }
+
+  rpmsgfs_client_aio_fini(&aio);
+  return ret;
+}
+
+ssize_t rpmsgfs_client_write(FAR void *handle, int fd,
+                             FAR const void *buf, size_t count)
+{
+  struct rpmsgfs_aio_s aio;
+  ssize_t ret;
 
   if (!buf || count <= 0)
     {
       return 0;
     }
 
-  memset(&cookie, 0, sizeof(cookie));
+  rpmsgfs_client_aio_init(&aio);
+  ret = rpmsgfs_client_write_start(handle, fd, buf, count, &aio);
+  if (ret >= 0)
+    {
+      ret = rpmsgfs_client_wait(handle, &aio);
+    }
 
-  nxsem_init(&cookie.sem, 0, 0);
-  cookie.data = &read;
+  rpmsgfs_client_aio_fini(&aio);
+  return ret;
+}
+
+void rpmsgfs_client_aio_init(FAR struct rpmsgfs_aio_s *aio)
+{
+  memset(aio, 0, sizeof(*aio));
+  nxsem_init(&aio->cookie.sem, 0, 0);
+}
+
+void rpmsgfs_client_aio_fini(FAR struct rpmsgfs_aio_s *aio)
+{
+  DEBUGASSERT(!aio->pending);
+  nxsem_destroy(&aio->cookie.sem);
+}
+
+/* Send a read of count bytes at the current position of fd.  The server
+ * streams the data back in as many messages as needed, which the read
+ * handler gathers into buf.
+ */
+
+int rpmsgfs_client_read_start(FAR void *handle, int fd,
+                              FAR void *buf, size_t count,
+                              FAR struct rpmsgfs_aio_s *aio)
+{
+  FAR struct rpmsgfs_s *priv = handle;
+  struct rpmsgfs_read_s msg;
+  int ret;
+
+  DEBUGASSERT(!aio->pending && count > 0);
+
+  aio->command       = RPMSGFS_READ;
+  aio->iov.iov_base  = buf;
+  aio->iov.iov_len   = 0;
+  aio->cookie.result = -ENXIO;
+  aio->cookie.data   = &aio->iov;
 
   msg.header.command = RPMSGFS_READ;
   msg.header.result  = -ENXIO;
-  msg.header.cookie  = (uintptr_t)&cookie;
+  msg.header.cookie  = (uintptr_t)&aio->cookie;
   msg.fd             = fd;
   msg.count          = count;
 
   ret = rpmsg_send(&priv->ept, &msg, sizeof(msg));
   if (ret < 0)
     {
-      goto out;
-    }
-
-  ret = rpmsg_wait(&priv->ept, &cookie.sem);
-  if (ret < 0)
-    {
-      goto out;
+      return ret;
     }
 
-  ret = cookie.result;
-
-out:
-  nxsem_destroy(&cookie.sem);
-  return read.iov_len > 0 ? read.iov_len : ret;
+  aio->pending = true;
+  return 0;
 }
 
-ssize_t rpmsgfs_client_write(FAR void *handle, int fd,
-                             FAR const void *buf, size_t count)
+/* Copy buf into as many write messages as needed, only the last one asks
+ * for a reply.  buf may be reused as soon as this returns.
+ */
+
+int rpmsgfs_client_write_start(FAR void *handle, int fd,
+                               FAR const void *buf, size_t count,
+                               FAR struct rpmsgfs_aio_s *aio)
 {
   FAR struct rpmsgfs_s *priv = handle;
-  struct rpmsgfs_cookie_s cookie;
   size_t written = 0;
-  int ret = 0;
+  int ret;
 
-  if (!buf || count <= 0)
-    {
-      return 0;
-    }
+  DEBUGASSERT(!aio->pending && count > 0);
 
-  memset(&cookie, 0, sizeof(cookie));
-  nxsem_init(&cookie.sem, 0, 0);
+  aio->command       = RPMSGFS_WRITE;
+  aio->iov.iov_base  = NULL;
+  aio->iov.iov_len   = count;
+  aio->cookie.result = -ENXIO;
+  aio->cookie.data   = NULL;
 
   while (written < count)
     {
@@ -533,15 +775,14 @@ ssize_t rpmsgfs_client_write(FAR void *handle, int fd,
       msg = rpmsgfs_get_tx_payload_buffer(priv, &space);
       if (!msg)
         {
-          ret = -ENOMEM;
-          goto out;
+          return -ENOMEM;
         }
 
       space -= sizeof(*msg);
       if (space >= count - written)
         {
           space = count - written;
-          msg->header.cookie = (uintptr_t)&cookie;
+          msg->header.cookie = (uintptr_t)&aio->cookie;
         }
       else
         {
@@ -558,23 +799,44 @@ ssize_t rpmsgfs_client_write(FAR void *handle, int fd,
       if (ret < 0)
         {
           rpmsg_release_tx_buffer(&priv->ept, msg);
-          goto out;
+          return ret;
         }
 
       written += space;
     }
 
-  ret = rpmsg_wait(&priv->ept, &cookie.sem);
+  aio->pending = true;
+  return 0;
+}
+
+/* Wait for a request started by rpmsgfs_client_read_start() or
+ * rpmsgfs_client_write_start(), return the number of bytes transferred or
+ * the error of the server.
+ */
+
+ssize_t rpmsgfs_client_wait(FAR void *handle, FAR struct rpmsgfs_aio_s *aio)
+{
+  FAR struct rpmsgfs_s *priv = handle;
+  int ret;
+
+  if (!aio->pending)
+    {
+      return 0;
+    }
+
+  ret = rpmsg_wait(&priv->ept, &aio->cookie.sem);
+  aio->pending = false;
   if (ret < 0)
     {
-      goto out;
+      return ret;
     }
 
-  ret = cookie.result;
+  if (aio->command == RPMSGFS_READ)
+    {
+      return aio->iov.iov_len > 0 ? aio->iov.iov_len : aio->cookie.result;
+    }
 
-out:
-  nxsem_destroy(&cookie.sem);
-  return ret < 0 ? ret : count;
+  return aio->cookie.result < 0 ? aio->cookie.result : aio->iov.iov_len;
 }
 
 off_t rpmsgfs_client_lseek(FAR void *handle, int fd,
@@ -753,6 +1015,9 @@ int rpmsgfs_client_bind(FAR void **handle, FAR const char *cpuname)
     }
 
   nxsem_init(&priv->wait, 0, 0);
+#if CONFIG_FS_RPMSGFS_CACHE > 0
+  nxmutex_init(&priv->cache_lock);
+#endif
   strlcpy(priv->cpuname, cpuname, sizeof(priv->cpuname));
   ret = rpmsg_register_callback(priv,
                                 rpmsgfs_device_created,
@@ -761,6 +1026,9 @@ int rpmsgfs_client_bind(FAR void **handle, FAR const char *cpuname)
                                 NULL);
   if (ret < 0)
     {
+#if CONFIG_FS_RPMSGFS_CACHE > 0
+      nxmutex_destroy(&priv->cache_lock);
+#endif
       nxsem_destroy(&priv->wait);
       fs_heap_free(priv);
       return ret;
@@ -781,6 +1049,10 @@ int rpmsgfs_client_unbind(FAR void *handle)
                             NULL,
                             NULL);
 
+#if CONFIG_FS_RPMSGFS_CACHE > 0
+  rpmsgfs_cache_free(priv);
+  nxmutex_destroy(&priv->cache_lock);
+#endif
   nxsem_destroy(&priv->wait);
   fs_heap_free(priv);
   return 0;
@@ -827,6 +1099,7 @@ int rpmsgfs_client_unlink(FAR void *handle, FAR const char *pathname)
   struct rpmsgfs_unlink_s *msg;
   uint32_t space;
   size_t len;
+  int ret;
 
   len = sizeof(*msg) + strlen(pathname) + 1;
 
@@ -840,8 +1113,10 @@ int rpmsgfs_client_unlink(FAR void *handle, FAR const char *pathname)
 
   strlcpy(msg->pathname, pathname, space - sizeof(*msg));
 
-  return rpmsgfs_send_recv(priv, RPMSGFS_UNLINK, false,
+  ret = rpmsgfs_send_recv(priv, RPMSGFS_UNLINK, false,
           (struct rpmsgfs_header_s *)msg, len, NULL);
+  rpmsgfs_client_invalidate(priv, pathname);
+  return ret;
 }
 
 int rpmsgfs_client_mkdir(FAR void *handle, FAR const char *pathname,
@@ -851,6 +1126,7 @@ int rpmsgfs_client_mkdir(FAR void *handle, FAR const char *pathname,
   struct rpmsgfs_mkdir_s *msg;
   uint32_t space;
   size_t len;
+  int ret;
 
   len = sizeof(*msg) + strlen(pathname) + 1;
 
@@ -863,8 +1139,10 @@ int rpmsgfs_client_mkdir(FAR void *handle, FAR const char *pathname,
   msg->mode = mode;
   strlcpy(msg->pathname, pathname, space - sizeof(*msg));
 
-  return rpmsgfs_send_recv(priv, RPMSGFS_MKDIR, false,
+  ret = rpmsgfs_send_recv(priv, RPMSGFS_MKDIR, false,
           (struct rpmsgfs_header_s *)msg, len, NULL);
+  rpmsgfs_client_invalidate(priv, pathname);
+  return ret;
 }
 
 int rpmsgfs_client_rmdir(FAR void *handle, FAR const char *pathname)
@@ -873,6 +1151,7 @@ int rpmsgfs_client_rmdir(FAR void *handle, FAR const char *pathname)
   struct rpmsgfs_rmdir_s *msg;
   uint32_t space;
   size_t len;
+  int ret;
 
   len = sizeof(*msg) + strlen(pathname) + 1;
 
@@ -886,8 +1165,10 @@ int rpmsgfs_client_rmdir(FAR void *handle, FAR const char *pathname)
 
   strlcpy(msg->pathname, pathname, space - sizeof(*msg));
 
-  return rpmsgfs_send_recv(priv, RPMSGFS_RMDIR, false,
+  ret = rpmsgfs_send_recv(priv, RPMSGFS_RMDIR, false,
           (struct rpmsgfs_header_s *)msg, len, NULL);
+  rpmsgfs_client_invalidate(priv, pathname);
+  return ret;
 }
 
 int rpmsgfs_client_rename(FAR void *handle, FAR const char *oldpath,
@@ -900,6 +1181,7 @@ int rpmsgfs_client_rename(FAR void *handle, FAR const char *oldpath,
   size_t newlen;
   size_t alignlen;
   uint32_t space;
+  int ret;
 
   oldlen   = strlen(oldpath) + 1;
   alignlen = (oldlen + 0x7) & ~0x7;
@@ -917,8 +1199,11 @@ int rpmsgfs_client_rename(FAR void *handle, FAR const char *oldpath,
   memcpy(msg->pathname, oldpath, oldlen);
   memcpy(msg->pathname + alignlen, newpath, newlen);
 
-  return rpmsgfs_send_recv(priv, RPMSGFS_RENAME, false,
+  ret = rpmsgfs_send_recv(priv, RPMSGFS_RENAME, false,
           (struct rpmsgfs_header_s *)msg, len, NULL);
+  rpmsgfs_client_invalidate(priv, oldpath);
+  rpmsgfs_client_invalidate(priv, newpath);
+  return ret;
 }
 
 int rpmsgfs_client_stat(FAR void *handle, FAR const char *path,
@@ -928,6 +1213,17 @@ int rpmsgfs_client_stat(FAR void *handle, FAR const char *path,
   FAR struct rpmsgfs_stat_s *msg;
   uint32_t space;
   size_t len;
+  int ret;
+#if CONFIG_FS_RPMSGFS_CACHE > 0
+  uint32_t gen;
+
+  if (rpmsgfs_cache_lookup(priv, path, buf, &ret))
+    {
+      return ret;
+    }
+
+  gen = priv->cache_gen;
+#endif
 
   len = sizeof(*msg) + strlen(path) + 1;
 
@@ -941,8 +1237,12 @@ int rpmsgfs_client_stat(FAR void *handle, FAR const char *path,
 
   strlcpy(msg->pathname, path, space - sizeof(*msg));
 
-  return rpmsgfs_send_recv(priv, RPMSGFS_STAT, false,
+  ret = rpmsgfs_send_recv(priv, RPMSGFS_STAT, false,
           (struct rpmsgfs_header_s *)msg, len, buf);
+#if CONFIG_FS_RPMSGFS_CACHE > 0
+  rpmsgfs_cache_enter(priv, path, gen, buf, ret);
+#endif
+  return ret;
 }
 
 int rpmsgfs_client_fchstat(FAR void *handle, int fd,
@@ -981,6 +1281,7 @@ int rpmsgfs_client_chstat(FAR void *handle, FAR const char *path,
   FAR struct rpmsgfs_chstat_s *msg;
   uint32_t space;
   size_t len;
+  int ret;
 
   len = sizeof(*msg) + strlen(path) + 1;
 
@@ -1012,6 +1313,45 @@ int rpmsgfs_client_chstat(FAR void *handle, FAR const char *path,
 
   strlcpy(msg->pathname, path, space - sizeof(*msg));
 
-  return rpmsgfs_send_recv(priv, RPMSGFS_CHSTAT, false,
+  ret = rpmsgfs_send_recv(priv, RPMSGFS_CHSTAT, false,
           (struct rpmsgfs_header_s *)msg, len, NULL);
+  rpmsgfs_client_invalidate(priv, path);
+  return ret;
+}
+
+/* Drop the cached stat() results of path and its parent directory */
+
+void rpmsgfs_client_invalidate(FAR void *handle, FAR const char *path)
+{
+#if CONFIG_FS_RPMSGFS_CACHE > 0
+  FAR struct rpmsgfs_s *priv = handle;
+  uint32_t parent;
+  uint32_t hash;
+  size_t len;
+  int i;
+
+  hash = rpmsgfs_cache_key(path, &len);
+  while (len > 0 && path[len - 1] != '/')
+    {
+      len--;
+    }
+
+  parent = crc32((FAR const uint8_t *)path, len > 1 ? len - 1 : len);
+
+  nxmutex_lock(&priv->cache_lock);
+  priv->cache_gen++;
+  for (i = 0; i < CONFIG_FS_RPMSGFS_CACHE; i++)
+    {
+      FAR struct rpmsgfs_cache_s *entry = &priv->cache[i];
+
+      if (entry->path != NULL &&
+          (path[0] == '\0' || entry->hash == hash || entry->hash == parent))
+        {
+          fs_heap_free(entry->path);
+          entry->path = NULL;
+        }
+    }
+
+  nxmutex_unlock(&priv->cache_lock);
+#endif
 }
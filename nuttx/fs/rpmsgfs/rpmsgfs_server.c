@@ -35,8 +35,11 @@
 #include <errno.h>
 
 #include <nuttx/kmalloc.h>
+#include <nuttx/list.h>
 #include <nuttx/mutex.h>
 #include <nuttx/fs/fs.h>
+#include <nuttx/fs/ioctl.h>
+#include <nuttx/lib/lib.h>
 #include <nuttx/rpmsg/rpmsg.h>
 
 #include "rpmsgfs.h"
@@ -49,6 +52,7 @@
 struct rpmsgfs_server_s
 {
   struct rpmsg_endpoint ept;
+  struct list_node      node;    /* Entry of g_rpmsgfs_servers */
   FAR struct file     **files;
   FAR void            **dirs;
   int                   file_rows;
@@ -167,6 +171,12 @@ static const rpmsg_ept_cb g_rpmsgfs_handler[] =
   [RPMSGFS_CHSTAT]    = rpmsgfs_chstat_handler,
 };
 
+/* The endpoints of all clients, to send them invalidations */
+
+static struct list_node g_rpmsgfs_servers =
+  LIST_INITIAL_VALUE(g_rpmsgfs_servers);
+static mutex_t g_rpmsgfs_servers_lock = NXMUTEX_INITIALIZER;
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -313,6 +323,88 @@ static FAR void *rpmsgfs_get_dir(
   return dir;
 }
 
+/* Tell the clients other than priv that the object at path, or the file
+ * filep, was changed so they drop it from their stat() caches.  The client
+ * that made the change drops it itself.
+ */
+
+static void rpmsgfs_notify(FAR struct rpmsgfs_server_s *priv,
+                           FAR const char *path, FAR struct file *filep)
+{
+  FAR struct rpmsgfs_invalidate_s *msg;
+  FAR struct rpmsgfs_server_s *peer;
+  FAR char *buf = NULL;
+  uint32_t space;
+  size_t len;
+
+  nxmutex_lock(&g_rpmsgfs_servers_lock);
+  if (list_is_singular(&g_rpmsgfs_servers))
+    {
+      goto out;
+    }
+
+  if (filep != NULL)
+    {
+      /* An empty path makes the clients drop every entry */
+
+      buf = lib_get_pathbuffer();
+      if (buf == NULL)
+        {
+          goto out;
+        }
+
+      if (file_ioctl(filep, FIOC_FILEPATH, (unsigned long)(uintptr_t)buf)
+          < 0)
+        {
+          buf[0] = '\0';
+        }
+
+      path = buf;
+    }
+
+  len = sizeof(*msg) + strlen(path) + 1;
+  list_for_every_entry(&g_rpmsgfs_servers, peer,
+                       struct rpmsgfs_server_s, node)
+    {
+      if (peer == priv || !is_rpmsg_ept_ready(&peer->ept))
+        {
+          continue;
+        }
+
+      msg = rpmsg_get_tx_payload_buffer(&peer->ept, &space, true);
+      if (msg == NULL)
+        {
+          continue;
+        }
+
+      msg->header.command = RPMSGFS_INVALIDATE;
+      msg->header.result  = 0;
+      msg->header.cookie  = 0;
+      if (len <= space)
+        {
+          strlcpy(msg->pathname, path, space - sizeof(*msg));
+        }
+      else
+        {
+          msg->pathname[0] = '\0';
+        }
+
+      if (rpmsg_send_nocopy(&peer->ept, msg,
+                            sizeof(*msg) + strlen(msg->pathname) + 1) < 0)
+        {
+          rpmsg_release_tx_buffer(&peer->ept, msg);
+        }
+    }
+
+  if (buf != NULL)
+    {
+      lib_put_pathbuffer(buf);
+    }
+
+out:
+  nxmutex_unlock(&g_rpmsgfs_servers_lock);
+}
+
 static int rpmsgfs_open_handler(FAR struct rpmsg_endpoint *ept,
                                 FAR void *data, size_t len,
                                 uint32_t src, FAR void *priv)
@@ -333,6 +425,10 @@ static int rpmsgfs_open_handler(FAR struct rpmsg_endpoint *ept,
     {
       filep->f_inode = NULL;
     }
+  else if (msg->flags & (O_CREAT | O_TRUNC))
+    {
+      rpmsgfs_notify(priv, msg->pathname, NULL);
+    }
 
 out:
   msg->header.result = ret < 0 ? ret : fd;
@@ -350,6 +446,13 @@ static int rpmsgfs_close_handler(FAR struct rpmsg_endpoint *ept,
   filep = rpmsgfs_get_file(priv, msg->fd);
   if (filep)
     {
+      /* Other clients see the writes through this file from now on */
+
+      if (filep->f_oflags & O_WROK)
+        {
+          rpmsgfs_notify(priv, NULL, filep);
+        }
+
       ret = file_close(filep);
     }
 
@@ -492,6 +595,7 @@ static int rpmsgfs_sync_handler(FAR struct rpmsg_endpoint *ept,
   if (filep != NULL)
     {
       ret = file_fsync(filep);
+      rpmsgfs_notify(priv, NULL, filep);
     }
 
   msg->header.result = ret;
@@ -573,6 +677,7 @@ static int rpmsgfs_ftruncate_handler(FAR struct rpmsg_endpoint *ept,
   if (filep != NULL)
     {
       ret = file_truncate(filep, msg->length);
+      rpmsgfs_notify(priv, NULL, filep);
     }
 
   msg->header.result = ret;
@@ -704,6 +809,7 @@ static int rpmsgfs_unlink_handler(FAR struct rpmsg_endpoint *ept,
   FAR struct rpmsgfs_unlink_s *msg = data;
 
   msg->header.result = nx_unlink(msg->pathname);
+  rpmsgfs_notify(priv, msg->pathname, NULL);
   return rpmsg_send(ept, msg, sizeof(*msg));
 }
 
@@ -716,6 +822,7 @@ static int rpmsgfs_mkdir_handler(FAR struct rpmsg_endpoint *ept,
 
   ret = mkdir(msg->pathname, msg->mode);
   msg->header.result = ret ? -get_errno() : 0;
+  rpmsgfs_notify(priv, msg->pathname, NULL);
   return rpmsg_send(ept, msg, sizeof(*msg));
 }
 
@@ -728,6 +835,7 @@ static int rpmsgfs_rmdir_handler(FAR struct rpmsg_endpoint *ept,
 
   ret = rmdir(msg->pathname);
   msg->header.result = ret ? -get_errno() : 0;
+  rpmsgfs_notify(priv, msg->pathname, NULL);
   return rpmsg_send(ept, msg, sizeof(*msg));
 }
 
@@ -745,6 +853,8 @@ static int rpmsgfs_rename_handler(FAR struct rpmsg_endpoint *ept,
 
   ret = rename(msg->pathname, newpath);
   msg->header.result = ret ? -get_errno() : 0;
+  rpmsgfs_notify(priv, msg->pathname, NULL);
+  rpmsgfs_notify(priv, newpath, NULL);
   return rpmsg_send(ept, msg, sizeof(*msg));
 }
 
@@ -811,6 +921,7 @@ static int rpmsgfs_fchstat_handler(FAR struct rpmsg_endpoint *ept,
       buf.st_blocks       = msg->buf.blocks;
 
       ret = file_fchstat(filep, &buf, msg->flags);
+      rpmsgfs_notify(priv, NULL, filep);
     }
 
   msg->header.result = ret;
@@ -879,6 +990,7 @@ static int rpmsgfs_chstat_handler(FAR struct rpmsg_endpoint *ept,
 
 out:
   msg->header.result = ret;
+  rpmsgfs_notify(priv, msg->pathname, NULL);
   return rpmsg_send(ept, msg, sizeof(*msg));
 }
 
@@ -895,6 +1007,10 @@ static void rpmsgfs_ept_release(FAR struct rpmsg_endpoint *ept)
   int i;
   int j;
 
+  nxmutex_lock(&g_rpmsgfs_servers_lock);
+  list_delete(&priv->node);
+  nxmutex_unlock(&g_rpmsgfs_servers_lock);
+
   for (i = 0; i < priv->file_rows; i++)
     {
       for (j = 0; j < CONFIG_NFILE_DESCRIPTORS_PER_BLOCK; j++)
@@ -940,11 +1056,20 @@ static void rpmsgfs_ns_bind(FAR struct rpmsg_device *rdev,
   priv->ept.release_cb = rpmsgfs_ept_release;
   nxmutex_init(&priv->lock);
 
+  /* Link the endpoint first, its release unlinks it */
+
+  nxmutex_lock(&g_rpmsgfs_servers_lock);
+  list_add_tail(&g_rpmsgfs_servers, &priv->node);
+  nxmutex_unlock(&g_rpmsgfs_servers_lock);
+
   ret = rpmsg_create_ept(&priv->ept, rdev, name,
                          RPMSG_ADDR_ANY, dest,
                          rpmsgfs_ept_cb, rpmsg_destroy_ept);
   if (ret)
     {
+      nxmutex_lock(&g_rpmsgfs_servers_lock);
+      list_delete(&priv->node);
+      nxmutex_unlock(&g_rpmsgfs_servers_lock);
       nxmutex_destroy(&priv->lock);
       fs_heap_free(priv);
     }
@@ -26,6 +26,7 @@
 
 #include <nuttx/config.h>
 
+#include <sys/param.h>
 #include <sys/stat.h>
 #include <sys/statfs.h>
 #include <stdint.h>
@@ -58,6 +59,10 @@
 #  warning CONFIG_FS_TMPFS_FILE_FREEGUARD needs to be > ALLOCGUARD
 #endif
 
+/* Minimum number of hash buckets of a directory */
+
+#define TMPFS_MIN_BUCKETS 8
+
 #define tmpfs_lock(fs) \
            nxrmutex_lock(&fs->tfs_lock)
 #define tmpfs_lock_object(to) \
@@ -92,10 +97,29 @@ struct tmpfs_dir_s
 
 /* TMPFS helpers */
 
+static uint32_t tmpfs_hash_name(FAR const char *name, size_t len);
+static void tmpfs_hash_link(FAR struct tmpfs_directory_s *tdo,
+              unsigned int index);
+static void tmpfs_hash_unlink(FAR struct tmpfs_directory_s *tdo,
+              unsigned int index);
+static int  tmpfs_hash_resize(FAR struct tmpfs_directory_s *tdo,
+              unsigned int nentries);
 static int  tmpfs_realloc_directory(FAR struct tmpfs_directory_s *tdo,
               unsigned int nentries);
+static void tmpfs_delete_dirent(FAR struct tmpfs_directory_s *tdo,
+              unsigned int index);
 static int  tmpfs_realloc_file(FAR struct tmpfs_file_s *tfo,
               size_t newsize);
+static FAR uint8_t *tmpfs_get_page(FAR struct tmpfs_file_s *tfo,
+              size_t index, bool alloc);
+static void tmpfs_read_pages(FAR struct tmpfs_file_s *tfo, size_t pos,
+              FAR uint8_t *buffer, size_t buflen);
+static ssize_t tmpfs_write_pages(FAR struct tmpfs_file_s *tfo, size_t pos,
+              FAR const uint8_t *buffer, size_t buflen);
+static void tmpfs_free_data(FAR struct tmpfs_file_s *tfo);
+static int  tmpfs_resize_file(FAR struct tmpfs_file_s *tfo,
+              size_t newsize);
+static int  tmpfs_linearize_file(FAR struct tmpfs_file_s *tfo);
 static void tmpfs_release_lockedobject(FAR struct tmpfs_object_s *to);
 static void tmpfs_release_lockedfile(FAR struct tmpfs_file_s *tfo);
 static int  tmpfs_release_file(FAR struct tmpfs_file_s *tfo);
@@ -212,13 +236,131 @@ const struct mountpt_operations g_tmpfs_operations =
   tmpfs_rmdir,      /* rmdir */
   tmpfs_rename,     /* rename */
   tmpfs_stat,       /* stat */
-  NULL              /* chstat */
+  NULL,             /* chstat */
+  NULL,             /* syncfs */
+  MNTPT_FLAG_DCACHE /* flags */
 };
 
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: tmpfs_hash_name
+ *
+ * Description:
+ *   FNV-1a hash of the first 'len' characters of a directory entry name.
+ *
+ ****************************************************************************/
+
+static uint32_t tmpfs_hash_name(FAR const char *name, size_t len)
+{
+  uint32_t hash = 2166136261u;
+
+  while (len-- > 0)
+    {
+      hash = (hash ^ (uint8_t)*name++) * 16777619u;
+    }
+
+  return hash;
+}
+
+/****************************************************************************
+ * Name: tmpfs_hash_link
+ *
+ * Description:
+ *   Add directory entry 'index' to the head of its hash chain.
+ *
+ ****************************************************************************/
+
+static void tmpfs_hash_link(FAR struct tmpfs_directory_s *tdo,
+                            unsigned int index)
+{
+  FAR struct tmpfs_dirent_s *tde = &tdo->tdo_entry[index];
+  FAR uint16_t *head;
+
+  head          = &tdo->tdo_bucket[tde->tde_hash & (tdo->tdo_nbuckets - 1)];
+  tde->tde_next = *head;
+  *head         = index;
+}
+
+/****************************************************************************
+ * Name: tmpfs_hash_unlink
+ *
+ * Description:
+ *   Remove directory entry 'index' from its hash chain.
+ *
+ ****************************************************************************/
+
+static void tmpfs_hash_unlink(FAR struct tmpfs_directory_s *tdo,
+                              unsigned int index)
+{
+  FAR struct tmpfs_dirent_s *tde = &tdo->tdo_entry[index];
+  FAR uint16_t *next;
+
+  next = &tdo->tdo_bucket[tde->tde_hash & (tdo->tdo_nbuckets - 1)];
+  while (*next != index)
+    {
+      DEBUGASSERT(*next != TMPFS_NOENTRY);
+      next = &tdo->tdo_entry[*next].tde_next;
+    }
+
+  *next = tde->tde_next;
+}
+
+/****************************************************************************
+ * Name: tmpfs_hash_resize
+ *
+ * Description:
+ *   Make sure that the hash table of the directory is large enough for
+ *   'nentries' entries, with at most two entries per bucket on average.
+ *   The table is never shrunk.
+ *
+ ****************************************************************************/
+
+static int tmpfs_hash_resize(FAR struct tmpfs_directory_s *tdo,
+                             unsigned int nentries)
+{
+  FAR uint16_t *bucket;
+  unsigned int nbuckets;
+  unsigned int i;
+
+  nbuckets = tdo->tdo_nbuckets > 0 ? tdo->tdo_nbuckets : TMPFS_MIN_BUCKETS;
+  while (2 * nbuckets < nentries)
+    {
+      nbuckets <<= 1;
+    }
+
+  if (nbuckets == tdo->tdo_nbuckets)
+    {
+      return OK;
+    }
+
+  bucket = fs_heap_malloc(nbuckets * sizeof(uint16_t));
+  if (bucket == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  /* Rehash the existing entries into the new table */
+
+  fs_heap_free(tdo->tdo_bucket);
+  tdo->tdo_bucket   = bucket;
+  tdo->tdo_nbuckets = nbuckets;
+
+  for (i = 0; i < nbuckets; i++)
+    {
+      bucket[i] = TMPFS_NOENTRY;
+    }
+
+  for (i = 0; i < tdo->tdo_nentries; i++)
+    {
+      tmpfs_hash_link(tdo, i);
+    }
+
+  return OK;
+}
+
 /****************************************************************************
  * Name: tmpfs_realloc_directory
  ****************************************************************************/
@@ -346,6 +488,282 @@ static int tmpfs_realloc_file(FAR struct tmpfs_file_s *tfo,
   return OK;
 }
 
+/****************************************************************************
+ * Name: tmpfs_get_page
+ *
+ * Description:
+ *   Return page 'index' of a file that is not TFO_FLAG_LINEAR.  If the
+ *   page is a hole, a zeroed page is allocated if 'alloc' is true, else
+ *   NULL is returned.  NULL is also returned if the allocation fails.
+ *
+ ****************************************************************************/
+
+static FAR uint8_t *tmpfs_get_page(FAR struct tmpfs_file_s *tfo,
+                                   size_t index, bool alloc)
+{
+  FAR uint8_t **pages;
+  FAR uint8_t *page;
+  size_t npages;
+
+  if (index < tfo->tfo_npages && tfo->tfo_pages[index] != NULL)
+    {
+      return tfo->tfo_pages[index];
+    }
+  else if (!alloc)
+    {
+      return NULL;
+    }
+
+  if (index >= tfo->tfo_npages)
+    {
+      /* Grow the page list geometrically, so that the cost of appending to
+       * a file stays constant.
+       */
+
+      npages = tfo->tfo_npages > 0 ? tfo->tfo_npages : 4;
+      while (npages <= index)
+        {
+          npages <<= 1;
+        }
+
+      pages = fs_heap_realloc(tfo->tfo_pages, npages * sizeof(*pages));
+      if (pages == NULL)
+        {
+          return NULL;
+        }
+
+      memset(&pages[tfo->tfo_npages], 0,
+             (npages - tfo->tfo_npages) * sizeof(*pages));
+
+      tfo->tfo_alloc += (npages - tfo->tfo_npages) * sizeof(*pages);
+      tfo->tfo_pages  = pages;
+      tfo->tfo_npages = npages;
+    }
+
+  page = fs_heap_zalloc(CONFIG_FS_TMPFS_PAGESIZE);
+  if (page != NULL)
+    {
+      tfo->tfo_pages[index] = page;
+      tfo->tfo_alloc       += CONFIG_FS_TMPFS_PAGESIZE;
+    }
+
+  return page;
+}
+
+/****************************************************************************
+ * Name: tmpfs_read_pages
+ *
+ * Description:
+ *   Copy file data from the pages of a file.  Holes read as zeroes.
+ *
+ ****************************************************************************/
+
+static void tmpfs_read_pages(FAR struct tmpfs_file_s *tfo, size_t pos,
+                             FAR uint8_t *buffer, size_t buflen)
+{
+  FAR uint8_t *page;
+  size_t offset;
+  size_t nbytes;
+
+  while (buflen > 0)
+    {
+      page   = tmpfs_get_page(tfo, pos / CONFIG_FS_TMPFS_PAGESIZE, false);
+      offset = pos % CONFIG_FS_TMPFS_PAGESIZE;
+      nbytes = MIN(CONFIG_FS_TMPFS_PAGESIZE - offset, buflen);
+
+      if (page != NULL)
+        {
+          memcpy(buffer, page + offset, nbytes);
+        }
+      else
+        {
+          memset(buffer, 0, nbytes);
+        }
+
+      pos    += nbytes;
+      buffer += nbytes;
+      buflen -= nbytes;
+    }
+}
+
+/****************************************************************************
+ * Name: tmpfs_write_pages
+ *
+ * Description:
+ *   Copy file data to the pages of a file, allocating the pages as needed.
+ *   The file size is not changed.
+ *
+ * Returned Value:
+ *   The number of bytes written or -ENOMEM if nothing could be written.
+ *
+ ****************************************************************************/
+
+static ssize_t tmpfs_write_pages(FAR struct tmpfs_file_s *tfo, size_t pos,
+                                 FAR const uint8_t *buffer, size_t buflen)
+{
+  FAR uint8_t *page;
+  size_t nwritten = 0;
+  size_t offset;
+  size_t nbytes;
+
+  while (nwritten < buflen)
+    {
+      page = tmpfs_get_page(tfo, pos / CONFIG_FS_TMPFS_PAGESIZE, true);
+      if (page == NULL)
+        {
+          return nwritten > 0 ? (ssize_t)nwritten : -ENOMEM;
+        }
+
+      offset = pos % CONFIG_FS_TMPFS_PAGESIZE;
+      nbytes = MIN(CONFIG_FS_TMPFS_PAGESIZE - offset, buflen - nwritten);
+      memcpy(page + offset, buffer + nwritten, nbytes);
+
+      pos      += nbytes;
+      nwritten += nbytes;
+    }
+
+  return nwritten;
+}
+
+/****************************************************************************
+ * Name: tmpfs_free_data
+ *
+ * Description:
+ *   Free all of the data of a file, pages or contiguous.
+ *
+ ****************************************************************************/
+
+static void tmpfs_free_data(FAR struct tmpfs_file_s *tfo)
+{
+  size_t i;
+
+  for (i = 0; i < tfo->tfo_npages; i++)
+    {
+      fs_heap_free(tfo->tfo_pages[i]);
+    }
+
+  fs_heap_free(tfo->tfo_pages);
+  fs_heap_free(tfo->tfo_data);
+
+  tfo->tfo_pages  = NULL;
+  tfo->tfo_npages = 0;
+  tfo->tfo_data   = NULL;
+  tfo->tfo_alloc  = 0;
+}
+
+/****************************************************************************
+ * Name: tmpfs_resize_file
+ *
+ * Description:
+ *   Change the size of a file.  Growing a paged file only creates a hole;
+ *   shrinking it frees the pages beyond the new end of the file.  In any
+ *   case, the data beyond the end of the file reads as zeroes afterwards.
+ *
+ ****************************************************************************/
+
+static int tmpfs_resize_file(FAR struct tmpfs_file_s *tfo, size_t newsize)
+{
+  FAR uint8_t *page;
+  size_t oldsize = tfo->tfo_size;
+  size_t offset;
+  size_t i;
+  int ret;
+
+  if (newsize == 0)
+    {
+      /* An empty file starts over with pages */
+
+      tmpfs_free_data(tfo);
+      tfo->tfo_flags &= ~TFO_FLAG_LINEAR;
+      tfo->tfo_size   = 0;
+      return OK;
+    }
+
+  if ((tfo->tfo_flags & TFO_FLAG_LINEAR) != 0)
+    {
+      ret = tmpfs_realloc_file(tfo, newsize);
+      if (ret >= 0 && newsize > oldsize)
+        {
+          memset(&tfo->tfo_data[oldsize], 0, newsize - oldsize);
+        }
+
+      return ret;
+    }
+
+  if (newsize < oldsize)
+    {
+      /* Free the pages that are entirely beyond the new end of file.
+       * REVISIT: The page list itself is not shrunk.
+       */
+
+      for (i = (newsize + CONFIG_FS_TMPFS_PAGESIZE - 1) /
+               CONFIG_FS_TMPFS_PAGESIZE;
+           i < tfo->tfo_npages; i++)
+        {
+          if (tfo->tfo_pages[i] != NULL)
+            {
+              fs_heap_free(tfo->tfo_pages[i]);
+              tfo->tfo_pages[i] = NULL;
+              tfo->tfo_alloc   -= CONFIG_FS_TMPFS_PAGESIZE;
+            }
+        }
+
+      /* And clear the end of the last page */
+
+      offset = newsize % CONFIG_FS_TMPFS_PAGESIZE;
+      page   = tmpfs_get_page(tfo, newsize / CONFIG_FS_TMPFS_PAGESIZE,
+                              false);
+      if (offset > 0 && page != NULL)
+        {
+          memset(page + offset, 0, CONFIG_FS_TMPFS_PAGESIZE - offset);
+        }
+    }
+
+  tfo->tfo_size = newsize;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: tmpfs_linearize_file
+ *
+ * Description:
+ *   Convert the pages of a file into one contiguous allocation, as needed
+ *   to map the file into memory or to execute it in place.  The file stays
+ *   linear until it is truncated to zero length.
+ *
+ ****************************************************************************/
+
+static int tmpfs_linearize_file(FAR struct tmpfs_file_s *tfo)
+{
+  FAR uint8_t *data = NULL;
+  size_t allocsize = 0;
+
+  if ((tfo->tfo_flags & TFO_FLAG_LINEAR) != 0)
+    {
+      return OK;
+    }
+
+  if (tfo->tfo_size > 0)
+    {
+      allocsize = tfo->tfo_size + CONFIG_FS_TMPFS_FILE_ALLOCGUARD;
+      data = fs_heap_malloc(allocsize);
+      if (data == NULL)
+        {
+          return -ENOMEM;
+        }
+
+      tmpfs_read_pages(tfo, 0, data, tfo->tfo_size);
+      memset(data + tfo->tfo_size, 0, allocsize - tfo->tfo_size);
+    }
+
+  tmpfs_free_data(tfo);
+
+  tfo->tfo_data   = data;
+  tfo->tfo_alloc  = allocsize;
+  tfo->tfo_flags |= TFO_FLAG_LINEAR;
+  return OK;
+}
+
 /****************************************************************************
  * Name: tmpfs_release_lockedobject
  ****************************************************************************/
@@ -383,7 +801,7 @@ static void tmpfs_release_lockedfile(FAR struct tmpfs_file_s *tfo)
     {
       tmpfs_unlock_file(tfo);
       nxrmutex_destroy(&tfo->tfo_lock);
-      fs_heap_free(tfo->tfo_data);
+      tmpfs_free_data(tfo);
       fs_heap_free(tfo);
     }
 
@@ -425,7 +843,9 @@ static int tmpfs_release_file(FAR struct tmpfs_file_s *tfo)
 static int tmpfs_find_dirent(FAR struct tmpfs_directory_s *tdo,
                              FAR const char *name, size_t len)
 {
-  int i;
+  FAR struct tmpfs_dirent_s *tde;
+  uint32_t hash;
+  unsigned int i;
 
   if (len == 0)
     {
@@ -441,36 +861,44 @@ static int tmpfs_find_dirent(FAR struct tmpfs_directory_s *tdo,
         }
     }
 
-  /* Search the list of directory entries for a match */
+  if (tdo->tdo_nbuckets == 0)
+    {
+      return -ENOENT;
+    }
 
-  for (i = 0;
-       i < tdo->tdo_nentries &&
-       (strncmp(tdo->tdo_entry[i].tde_name, name, len) != 0 ||
-       tdo->tdo_entry[i].tde_name[len] != 0);
-       i++);
+  /* Search the hash chain of the name for a match */
 
-  /* Return what we found, if anything */
+  hash = tmpfs_hash_name(name, len);
+  for (i = tdo->tdo_bucket[hash & (tdo->tdo_nbuckets - 1)];
+       i != TMPFS_NOENTRY; i = tde->tde_next)
+    {
+      tde = &tdo->tdo_entry[i];
+      if (tde->tde_hash == hash &&
+          strncmp(tde->tde_name, name, len) == 0 &&
+          tde->tde_name[len] == '\0')
+        {
+          return i;
+        }
+    }
 
-  return i < tdo->tdo_nentries ? i : -ENOENT;
+  return -ENOENT;
 }
 
 /****************************************************************************
- * Name: tmpfs_remove_dirent
+ * Name: tmpfs_delete_dirent
+ *
+ * Description:
+ *   Remove directory entry 'index' by replacing it with the final directory
+ *   entry.
+ *
  ****************************************************************************/
 
-static int tmpfs_remove_dirent(FAR struct tmpfs_directory_s *tdo,
-                               FAR const char *name)
+static void tmpfs_delete_dirent(FAR struct tmpfs_directory_s *tdo,
+                                unsigned int index)
 {
-  int index;
-  int last;
+  unsigned int last = tdo->tdo_nentries - 1;
 
-  /* Search the list of directory entries for a match */
-
-  index = tmpfs_find_dirent(tdo, name, strlen(name));
-  if (index < 0)
-    {
-      return index;
-    }
+  tmpfs_hash_unlink(tdo, index);
 
   /* Free the object name */
 
@@ -479,17 +907,38 @@ static int tmpfs_remove_dirent(FAR struct tmpfs_directory_s *tdo,
       fs_heap_free(tdo->tdo_entry[index].tde_name);
     }
 
-  /* Remove by replacing this entry with the final directory entry */
+  /* Move the final entry, which changes its index */
 
-  last = tdo->tdo_nentries - 1;
   if (index != last)
     {
+      tmpfs_hash_unlink(tdo, last);
       tdo->tdo_entry[index] = tdo->tdo_entry[last];
+      tmpfs_hash_link(tdo, index);
     }
 
   /* And decrement the count of directory entries */
 
   tdo->tdo_nentries = last;
+}
+
+/****************************************************************************
+ * Name: tmpfs_remove_dirent
+ ****************************************************************************/
+
+static int tmpfs_remove_dirent(FAR struct tmpfs_directory_s *tdo,
+                               FAR const char *name)
+{
+  int index;
+
+  /* Search the list of directory entries for a match */
+
+  index = tmpfs_find_dirent(tdo, name, strlen(name));
+  if (index < 0)
+    {
+      return index;
+    }
+
+  tmpfs_delete_dirent(tdo, index);
   return OK;
 }
 
@@ -535,10 +984,22 @@ static int tmpfs_add_dirent(FAR struct tmpfs_directory_s *tdo,
   /* Get the new number of entries */
 
   nentries = tdo->tdo_nentries + 1;
+  if (nentries >= TMPFS_NOENTRY)
+    {
+      fs_heap_free(newname);
+      return -ENOSPC;
+    }
 
-  /* Reallocate the directory object (if necessary) */
+  /* Grow the hash table and reallocate the directory object (if
+   * necessary)
+   */
+
+  index = tmpfs_hash_resize(tdo, nentries);
+  if (index >= 0)
+    {
+      index = tmpfs_realloc_directory(tdo, nentries);
+    }
 
-  index = tmpfs_realloc_directory(tdo, nentries);
   if (index < 0)
     {
       fs_heap_free(newname);
@@ -551,6 +1012,8 @@ static int tmpfs_add_dirent(FAR struct tmpfs_directory_s *tdo,
   tde             = &tdo->tdo_entry[index];
   tde->tde_object = to;
   tde->tde_name   = newname;
+  tde->tde_hash   = tmpfs_hash_name(newname, namelen);
+  tmpfs_hash_link(tdo, index);
 
   return OK;
 }
@@ -582,6 +1045,8 @@ tmpfs_alloc_file(FAR struct tmpfs_directory_s *parent)
   tfo->tfo_parent = parent;
   tfo->tfo_flags  = 0;
   tfo->tfo_size   = 0;
+  tfo->tfo_npages = 0;
+  tfo->tfo_pages  = NULL;
   tfo->tfo_data   = NULL;
 
   nxrmutex_init(&tfo->tfo_lock);
@@ -731,7 +1196,9 @@ tmpfs_alloc_directory(FAR struct tmpfs_directory_s *parent)
   tdo->tdo_refs     = 0;
   tdo->tdo_parent   = parent;
   tdo->tdo_nentries = 0;
+  tdo->tdo_nbuckets = 0;
   tdo->tdo_entry    = NULL;
+  tdo->tdo_bucket   = NULL;
 
   nxrmutex_init(&tdo->tdo_lock);
 
@@ -1189,7 +1656,11 @@ static int tmpfs_statfs_callout(FAR struct tmpfs_directory_s *tdo,
 
       tmptfo             = (FAR struct tmpfs_file_s *)to;
       tmpbuf->tsf_alloc += sizeof(struct tmpfs_file_s);
-      tmpbuf->tsf_avail += to->to_alloc - tmptfo->tfo_size;
+      if (to->to_alloc > tmptfo->tfo_size)
+        {
+          tmpbuf->tsf_avail += to->to_alloc - tmptfo->tfo_size;
+        }
+
       tmpbuf->tsf_files++;
     }
   else /* if (to->to_type == TMPFS_DIRECTORY) */
@@ -1220,34 +1691,13 @@ static int tmpfs_statfs_callout(FAR struct tmpfs_directory_s *tdo,
 static int tmpfs_free_callout(FAR struct tmpfs_directory_s *tdo,
                               unsigned int index, FAR void *arg)
 {
-  FAR struct tmpfs_dirent_s *tde;
   FAR struct tmpfs_object_s *to;
   FAR struct tmpfs_file_s *tfo;
-  unsigned int last;
-
-  /* Free the object name */
-
-  if (tdo->tdo_entry[index].tde_name != NULL)
-    {
-      fs_heap_free(tdo->tdo_entry[index].tde_name);
-    }
-
-  /* Remove by replacing this entry with the final directory entry */
 
-  tde  = &tdo->tdo_entry[index];
-  to   = tde->tde_object;
-  last = tdo->tdo_nentries - 1;
+  /* Remove the directory entry */
 
-  if (index != last)
-    {
-      /* Move the directory entry */
-
-      *tde = tdo->tdo_entry[last];
-    }
-
-  /* And decrement the count of directory entries */
-
-  tdo->tdo_nentries = last;
+  to = tdo->tdo_entry[index].tde_object;
+  tmpfs_delete_dirent(tdo, index);
 
   /* Is this directory entry a file object? */
 
@@ -1265,13 +1715,14 @@ static int tmpfs_free_callout(FAR struct tmpfs_directory_s *tdo,
           return TMPFS_UNLINKED;
         }
 
-      fs_heap_free(tfo->tfo_data);
+      tmpfs_free_data(tfo);
     }
   else /* if (to->to_type == TMPFS_DIRECTORY) */
     {
       tdo = (FAR struct tmpfs_directory_s *)to;
 
       fs_heap_free(tdo->tdo_entry);
+      fs_heap_free(tdo->tdo_bucket);
     }
 
   /* Free the object now */
@@ -1438,7 +1889,7 @@ static int tmpfs_open(FAR struct file *filep, FAR const char *relpath,
 
           if (tfo->tfo_size > 0)
             {
-              ret = tmpfs_realloc_file(tfo, 0);
+              ret = tmpfs_resize_file(tfo, 0);
               if (ret < 0)
                 {
                   goto errout_with_filelock;
@@ -1586,7 +2037,12 @@ static ssize_t tmpfs_read(FAR struct file *filep, FAR char *buffer,
 
   /* Copy data from the memory object to the user buffer */
 
-  if (tfo->tfo_data != NULL)
+  if ((tfo->tfo_flags & TFO_FLAG_LINEAR) == 0)
+    {
+      tmpfs_read_pages(tfo, startpos, (FAR uint8_t *)buffer, nread);
+      filep->f_pos += nread;
+    }
+  else if (tfo->tfo_data != NULL)
     {
       memcpy(buffer, &tfo->tfo_data[startpos], nread);
       filep->f_pos += nread;
@@ -1645,26 +2101,51 @@ static ssize_t tmpfs_write(FAR struct file *filep, FAR const char *buffer,
   nwritten = buflen;
   endpos   = startpos + buflen;
 
-  if (endpos > tfo->tfo_size)
+  if ((tfo->tfo_flags & TFO_FLAG_LINEAR) == 0)
     {
-      /* Reallocate the file to handle the write past the end of the file. */
+      /* Copy the data to the pages, allocating them as needed.  The data
+       * already written is never moved.
+       */
 
-      ret = tmpfs_realloc_file(tfo, (size_t)endpos);
-      if (ret < 0)
+      nwritten = tmpfs_write_pages(tfo, startpos,
+                                   (FAR const uint8_t *)buffer, buflen);
+      if (nwritten < 0)
         {
+          ret = nwritten;
           goto errout_with_lock;
         }
-    }
-
-  /* Copy data from the memory object to the user buffer */
 
-  if (tfo->tfo_data != NULL)
-    {
-      memcpy(&tfo->tfo_data[startpos], buffer, nwritten);
+      endpos = startpos + nwritten;
+      if (endpos > tfo->tfo_size)
+        {
+          tfo->tfo_size = endpos;
+        }
     }
   else
     {
-      DEBUGASSERT(tfo->tfo_size == 0 && nwritten == 0);
+      if (endpos > tfo->tfo_size)
+        {
+          /* Reallocate the file to handle the write past the end of the
+           * file.
+           */
+
+          ret = tmpfs_resize_file(tfo, (size_t)endpos);
+          if (ret < 0)
+            {
+              goto errout_with_lock;
+            }
+        }
+
+      /* Copy data from the user buffer to the memory object */
+
+      if (tfo->tfo_data != NULL)
+        {
+          memcpy(&tfo->tfo_data[startpos], buffer, nwritten);
+        }
+      else
+        {
+          DEBUGASSERT(tfo->tfo_size == 0 && nwritten == 0);
+        }
     }
 
   filep->f_pos = endpos;
@@ -1765,7 +2246,7 @@ static int tmpfs_unmap(FAR struct task_group_s *group,
     {
       entry->length = offset;
       tmpfs_lock_file(tfo);
-      ret = tmpfs_realloc_file(tfo, offset);
+      ret = tmpfs_resize_file(tfo, offset);
       tmpfs_unlock_file(tfo);
     }
 
@@ -1788,7 +2269,20 @@ static int tmpfs_mmap(FAR struct file *filep, FAR struct mm_map_entry_s *map)
   if (map->offset >= 0 && map->offset < tfo->tfo_size &&
       map->length && map->offset + map->length <= tfo->tfo_size)
     {
+      /* The mapping needs the file to be contiguous in memory.  The pages
+       * cannot be mapped in place, because a later mapping across pages
+       * would move them.
+       */
+
+      tmpfs_lock_file(tfo);
+      ret = tmpfs_linearize_file(tfo);
       map->vaddr = tfo->tfo_data + map->offset;
+      tmpfs_unlock_file(tfo);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
       map->priv.p = tfo;
       map->munmap = tmpfs_unmap;
       ret = mm_map_add(get_current_mm(), map);
@@ -1842,8 +2336,18 @@ static int tmpfs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
     {
       FAR uintptr_t *ptr = (FAR uintptr_t *)arg;
 
+      /* Executing in place needs the file to be contiguous */
+
+      ret = tmpfs_lock_file(tfo);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      ret = tmpfs_linearize_file(tfo);
       *ptr = (uintptr_t)tfo->tfo_data;
-      return OK;
+      tmpfs_unlock_file(tfo);
+      return ret;
     }
 
   return ret;
@@ -1968,29 +2472,15 @@ static int tmpfs_truncate(FAR struct file *filep, off_t length)
   oldsize = tfo->tfo_size;
   if (oldsize != length)
     {
-      /* The size is changing.. up or down.  Reallocate the file memory. */
-
-      ret = tmpfs_realloc_file(tfo, (size_t)length);
-      if (ret < 0)
-        {
-          goto errout_with_lock;
-        }
-
-      /* If the size has increased, then we need to zero the newly added
-       * memory.
+      /* The size is changing.. up or down.  Newly added space reads as
+       * zeroes.
        */
 
-      if (length > oldsize)
-        {
-          memset(&tfo->tfo_data[oldsize], 0, length - oldsize);
-        }
-
-      ret = OK;
+      ret = tmpfs_resize_file(tfo, (size_t)length);
     }
 
   /* Release the lock on the file */
 
-errout_with_lock:
   tmpfs_unlock_file(tfo);
   return ret;
 }
@@ -2260,6 +2750,7 @@ static int tmpfs_unbind(FAR void *handle, FAR struct inode **blkdriver,
 
   nxrmutex_destroy(&tdo->tdo_lock);
   fs_heap_free(tdo->tdo_entry);
+  fs_heap_free(tdo->tdo_bucket);
   fs_heap_free(tdo);
 
   nxrmutex_destroy(&fs->tfs_lock);
@@ -2426,7 +2917,7 @@ static int tmpfs_unlink(FAR struct inode *mountpt, FAR const char *relpath)
   else
     {
       nxrmutex_destroy(&tfo->tfo_lock);
-      fs_heap_free(tfo->tfo_data);
+      tmpfs_free_data(tfo);
       fs_heap_free(tfo);
     }
 
@@ -2569,6 +3060,7 @@ static int tmpfs_rmdir(FAR struct inode *mountpt, FAR const char *relpath)
 
   nxrmutex_destroy(&tdo->tdo_lock);
   fs_heap_free(tdo->tdo_entry);
+  fs_heap_free(tdo->tdo_bucket);
   fs_heap_free(tdo);
 
   /* Release the reference and lock on the parent directory */
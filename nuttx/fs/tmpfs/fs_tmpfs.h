@@ -41,6 +41,11 @@
 /* Bit definitions for file object flags */
 
 #define TFO_FLAG_UNLINKED (1 << 0)  /* Bit 0: File is unlinked */
+#define TFO_FLAG_LINEAR   (1 << 1)  /* Bit 1: Data is contiguous (tfo_data) */
+
+/* End of a hash chain of directory entries */
+
+#define TMPFS_NOENTRY     UINT16_MAX
 
 /****************************************************************************
  * Public Types
@@ -70,6 +75,8 @@ struct tmpfs_dirent_s
 {
   FAR struct tmpfs_object_s *tde_object;
   FAR char *tde_name;
+  uint32_t tde_hash;     /* Hash of tde_name */
+  uint16_t tde_next;     /* Next entry in the same hash bucket */
 };
 
 /* The generic form of a TMPFS memory object */
@@ -100,7 +107,9 @@ struct tmpfs_directory_s
   /* Remaining fields are unique to a directory object */
 
   uint16_t tdo_nentries; /* Number of directory entries */
+  uint16_t tdo_nbuckets; /* Number of hash buckets (power of two) */
   FAR struct tmpfs_dirent_s *tdo_entry;
+  FAR uint16_t *tdo_bucket; /* First entry of each hash bucket */
 };
 
 #define SIZEOF_TMPFS_DIRECTORY(n) ((n) * sizeof(struct tmpfs_dirent_s))
@@ -111,6 +120,12 @@ struct tmpfs_directory_s
  * state.  The file memory object also serves as the open file object,
  * saving an allocation.  This has the negative side effect that no per-
  * open state can be retained (such as open flags).
+ *
+ * The file data is held in a list of CONFIG_FS_TMPFS_PAGESIZE pages, so
+ * that appending to a file never copies the data already written.  A NULL
+ * page is a hole that reads as zeroes.  A file that must be contiguous in
+ * memory (mmap() across pages, FIOC_XIPBASE) is converted once to a single
+ * allocation, tfo_data, and then grows by reallocation (TFO_FLAG_LINEAR).
  */
 
 struct tmpfs_file_s
@@ -126,9 +141,11 @@ struct tmpfs_file_s
 
   /* Remaining fields are unique to a directory object */
 
-  uint8_t       tfo_flags; /* See TFO_FLAG_* definitions */
-  size_t        tfo_size;  /* Valid file size */
-  FAR uint8_t  *tfo_data;  /* File data starts here */
+  uint8_t       tfo_flags;  /* See TFO_FLAG_* definitions */
+  size_t        tfo_size;   /* Valid file size */
+  size_t        tfo_npages; /* Number of entries in tfo_pages */
+  FAR uint8_t **tfo_pages;  /* Page list, NULL pages are holes */
+  FAR uint8_t  *tfo_data;   /* File data starts here (TFO_FLAG_LINEAR) */
 };
 
 /* This structure represents one instance of a TMPFS file system */
@@ -52,18 +52,93 @@
 
 #if !defined(CONFIG_DISABLE_MOUNTPOINT) && defined(CONFIG_FS_UNIONFS)
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Flags of a name in a cached directory */
+
+#define UNIONFS_NAME_FS1      (1 << 0) /* Exists on file system 1 */
+#define UNIONFS_NAME_FS2      (1 << 1) /* Exists on file system 2 */
+#define UNIONFS_NAME_DIR1     (1 << 2) /* Is a directory on file system 1 */
+#define UNIONFS_NAME_DIR2     (1 << 3) /* Is a directory on file system 2 */
+#define UNIONFS_NAME_WHITEOUT (1 << 4) /* Hidden on file system 2 */
+#define UNIONFS_NAME_UNKNOWN  (1 << 5) /* Existence not checked */
+
+#define UNIONFS_NAME_MERGED \
+  (UNIONFS_NAME_FS1 | UNIONFS_NAME_FS2 | UNIONFS_NAME_DIR1 | UNIONFS_NAME_DIR2)
+
+/* The name on file system 2 is visible if file system 1 does not hide it,
+ * a directory on both file systems is merged.
+ */
+
+#define UNIONFS_LOWER(f) \
+  (((f) & (UNIONFS_NAME_FS2 | UNIONFS_NAME_WHITEOUT)) == UNIONFS_NAME_FS2)
+#define UNIONFS_VISIBLE(f) \
+  (((f) & UNIONFS_NAME_FS1) != 0 || UNIONFS_LOWER(f))
+#define UNIONFS_ISMERGED(f) \
+  (((f) & (UNIONFS_NAME_MERGED | UNIONFS_NAME_WHITEOUT)) == \
+   UNIONFS_NAME_MERGED)
+#define UNIONFS_ISDIR(f) \
+  (((f) & UNIONFS_NAME_FS1) != 0 ? ((f) & UNIONFS_NAME_DIR1) != 0 : \
+                                   ((f) & UNIONFS_NAME_DIR2) != 0)
+
+/* Initial number of hash buckets of a cached directory */
+
+#define UNIONFS_NBUCKETS      16
+
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+/* A whiteout is an empty file on file system 1 that hides the name after
+ * the prefix on file system 2.
+ */
+
+#  define UNIONFS_WHITEOUT     ".wh."
+#  define UNIONFS_WHITEOUT_LEN 4
+
+/* Size of the buffer used to copy a file up to file system 1 */
+
+#  define UNIONFS_COPYBUF_SIZE 512
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
 
+/* This structure describes one name in a cached directory */
+
+struct unionfs_name_s
+{
+  FAR struct unionfs_name_s *un_flink; /* Next name in the directory */
+  FAR struct unionfs_name_s *un_hlink; /* Next name in the hash bucket */
+  uint32_t un_hash;                    /* Hash of the name */
+  uint8_t un_flags;                    /* See UNIONFS_NAME_* */
+  uint8_t un_type[2];                  /* Type on each file system */
+  char un_name[1];                     /* Name of the entry */
+};
+
+/* This structure describes the merged contents of one directory */
+
+struct unionfs_cdir_s
+{
+  FAR struct unionfs_cdir_s *uc_flink; /* Next cached directory */
+  FAR struct unionfs_name_s *uc_head;  /* Names in the order they were read */
+  FAR struct unionfs_name_s *uc_tail;  /* Last name read */
+  FAR struct unionfs_name_s **uc_hash; /* Hash buckets of the names */
+  unsigned int uc_nbuckets;            /* Number of hash buckets */
+  unsigned int uc_nnames;              /* Number of names */
+  uint32_t uc_pathhash;                /* Hash of the path */
+  size_t uc_pathlen;                   /* Length of the path */
+  int16_t uc_crefs;                    /* References by cache and readers */
+  char uc_relpath[1];                  /* Path of the directory */
+};
+
 struct unionfs_dir_s
 {
   struct fs_dirent_s fu_base;          /* Vfs directory structure */
-  uint8_t fu_ndx;                      /* Index of file system being enumerated */
-  bool fu_eod;                         /* True: At end of directory */
-  bool fu_prefix[2];                   /* True: Fake directory in prefix */
-  FAR char *fu_relpath;                /* Path being enumerated */
-  FAR struct fs_dirent_s *fu_lower[2]; /* dirent struct used by contained file system */
+  uint8_t fu_ndx;                      /* File system of a single directory */
+  FAR struct fs_dirent_s *fu_lower;    /* Directory on that file system */
+  FAR struct unionfs_cdir_s *fu_cdir;  /* Or contents of a merged directory */
+  FAR struct unionfs_name_s *fu_next;  /* Next name of the merged directory */
 };
 
 /* This structure describes one contained file system mountpoint */
@@ -81,7 +156,12 @@ struct unionfs_inode_s
   struct unionfs_mountpt_s ui_fs[2]; /* Contained file systems */
   mutex_t ui_lock;                   /* Enforces mutually exclusive access */
   int16_t ui_nopen;                  /* Number of open references */
+  uint16_t ui_ncdirs;                /* Number of cached directories */
   bool ui_unmounted;                 /* File system has been unmounted */
+
+  /* Cached directories, the most recently used first */
+
+  FAR struct unionfs_cdir_s *ui_cdirs;
 };
 
 /* This structure describes one opened file */
@@ -132,15 +212,59 @@ static int     unionfs_trychstat(FAR struct inode *inode,
                                  FAR const char *relpath,
                                  FAR const char *prefix,
                                  FAR const struct stat *buf, int flags);
-static int     unionfs_trystatdir(FAR struct inode *inode,
+
+/* Directory cache */
+
+static uint32_t unionfs_hash(FAR const char *str, size_t len);
+static size_t  unionfs_pathlen(FAR const char *relpath);
+static FAR const char *unionfs_basename(FAR const char *relpath,
+                                        FAR size_t *dirlen,
+                                        FAR size_t *namelen);
+static FAR struct unionfs_name_s *
+               unionfs_cache_find(FAR struct unionfs_cdir_s *cdir,
+                                  FAR const char *name, size_t len);
+static FAR struct unionfs_name_s *
+               unionfs_cache_insert(FAR struct unionfs_cdir_s *cdir,
+                                    FAR const char *name, size_t len);
+static int     unionfs_cache_add(FAR struct unionfs_cdir_s *cdir, int ndx,
+                                 FAR const char *name, uint8_t type);
+static void    unionfs_cache_release(FAR struct unionfs_cdir_s *cdir);
+static int     unionfs_cache_build(FAR struct unionfs_inode_s *ui,
+                                   FAR const char *relpath, size_t len,
+                                   uint8_t layers,
+                                   FAR struct unionfs_cdir_s **cdirp);
+static FAR struct unionfs_cdir_s *
+               unionfs_cache_dir(FAR struct unionfs_inode_s *ui,
+                                 FAR const char *relpath, size_t len,
+                                 FAR struct unionfs_cdir_s **prevp);
+static int     unionfs_cache_get(FAR struct unionfs_inode_s *ui,
+                                 FAR const char *relpath, size_t len,
+                                 FAR struct unionfs_cdir_s **cdirp);
+static void    unionfs_cache_drop(FAR struct unionfs_inode_s *ui,
+                                  FAR const char *relpath, size_t len);
+static void    unionfs_cache_update(FAR struct unionfs_inode_s *ui,
+                                    FAR const char *relpath, uint8_t set,
+                                    uint8_t clear, uint8_t type);
+static int     unionfs_lookup(FAR struct unionfs_inode_s *ui,
+                              FAR const char *relpath, FAR uint8_t *flags);
+static int     unionfs_lookupstat(FAR struct unionfs_inode_s *ui,
                                   FAR const char *relpath,
-                                  FAR const char *prefix);
-static int     unionfs_trystatfile(FAR struct inode *inode,
-                                   FAR const char *relpath,
-                                   FAR const char *prefix);
-static FAR char *unionfs_relpath(FAR const char *path,
-                                 FAR const char *name);
+                                  FAR uint8_t *flags);
+
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+/* Copy-up */
+
+static FAR char *unionfs_whpath(FAR const char *relpath, size_t dirlen,
+                                FAR const char *name, size_t namelen);
+static int     unionfs_whiteout(FAR struct unionfs_inode_s *ui,
+                                FAR const char *relpath);
+static int     unionfs_copyup_parent(FAR struct unionfs_inode_s *ui,
+                                     FAR const char *relpath);
+static int     unionfs_copyup(FAR struct unionfs_inode_s *ui,
+                              FAR const char *relpath, bool data);
+#endif
 
+static int     unionfs_writable(FAR struct unionfs_file_s *uf);
 static int     unionfs_unbind_child(FAR struct unionfs_mountpt_s *um);
 static void    unionfs_destroy(FAR struct unionfs_inode_s *ui);
 
@@ -398,6 +522,7 @@ static int unionfs_tryopen(FAR struct file *filep, FAR const char *relpath,
 {
   FAR const struct mountpt_operations *ops;
   FAR const char *trypath;
+  int ret;
 
   /* Is this path valid on this file system? */
 
@@ -419,7 +544,18 @@ static int unionfs_tryopen(FAR struct file *filep, FAR const char *relpath,
       return -ENOSYS;
     }
 
-  return ops->open(filep, trypath, oflags, mode);
+  /* The layers are called directly, not through the VFS.  A name created
+   * in a layer may be cached as missing under the mount point of that
+   * layer.
+   */
+
+  ret = ops->open(filep, trypath, oflags, mode);
+  if (ret >= 0 && (oflags & O_CREAT) != 0)
+    {
+      inode_dcache_invalidate();
+    }
+
+  return ret;
 }
 
 /****************************************************************************
@@ -466,6 +602,7 @@ static int unionfs_trymkdir(FAR struct inode *inode, FAR const char *relpath,
 {
   FAR const struct mountpt_operations *ops;
   FAR const char *trypath;
+  int ret;
 
   /* Is this path valid on this file system? */
 
@@ -485,7 +622,13 @@ static int unionfs_trymkdir(FAR struct inode *inode, FAR const char *relpath,
       return -ENOSYS;
     }
 
-  return ops->mkdir(inode, trypath, mode);
+  ret = ops->mkdir(inode, trypath, mode);
+  if (ret >= 0)
+    {
+      inode_dcache_invalidate();
+    }
+
+  return ret;
 }
 
 /****************************************************************************
@@ -500,6 +643,7 @@ static int unionfs_tryrename(FAR struct inode *mountpt,
   FAR const struct mountpt_operations *ops;
   FAR const char *tryoldpath;
   FAR const char *trynewpath;
+  int ret;
 
   /* Is source path valid on this file system? */
 
@@ -539,7 +683,13 @@ static int unionfs_tryrename(FAR struct inode *mountpt,
       return -ENOSYS;
     }
 
-  return ops->rename(mountpt, tryoldpath, trynewpath);
+  ret = ops->rename(mountpt, tryoldpath, trynewpath);
+  if (ret >= 0)
+    {
+      inode_dcache_invalidate();
+    }
+
+  return ret;
 }
 
 /****************************************************************************
@@ -605,53 +755,6 @@ static int unionfs_trychstat(FAR struct inode *inode,
   return ops->chstat(inode, trypath, buf, flags);
 }
 
-/****************************************************************************
- * Name: unionfs_trystatdir
- ****************************************************************************/
-
-static int unionfs_trystatdir(FAR struct inode *inode,
-                              FAR const char *relpath,
-                              FAR const char *prefix)
-{
-  struct stat buf;
-  int ret;
-
-  /* Check if relative path refers to a directory. */
-
-  ret = unionfs_trystat(inode, relpath, prefix, &buf);
-  if (ret >= 0 && !S_ISDIR(buf.st_mode))
-    {
-      return -ENOTDIR;
-    }
-
-  return ret;
-}
-
-/****************************************************************************
- * Name: unionfs_trystatfile
- ****************************************************************************/
-
-static int unionfs_trystatfile(FAR struct inode *inode,
-                               FAR const char *relpath,
-                               FAR const char *prefix)
-{
-  struct stat buf;
-  int ret;
-
-  /* Check if relative path refers to a regular file.  We specifically
-   * exclude directories but neither do we expect any kind of special file
-   * to reside on the mounted filesystem.
-   */
-
-  ret = unionfs_trystat(inode, relpath, prefix, &buf);
-  if (ret >= 0 && !S_ISREG(buf.st_mode))
-    {
-      return -EISDIR;
-    }
-
-  return ret;
-}
-
 /****************************************************************************
  * Name: unionfs_tryrmdir
  ****************************************************************************/
@@ -716,221 +819,1209 @@ static int unionfs_tryunlink(FAR struct inode *inode,
 }
 
 /****************************************************************************
- * Name: unionfs_relpath
+ * Name: unionfs_hash
  ****************************************************************************/
 
-static FAR char *unionfs_relpath(FAR const char *path, FAR const char *name)
+static uint32_t unionfs_hash(FAR const char *str, size_t len)
 {
-  FAR char *relpath;
-  int pathlen;
-  int ret;
+  uint32_t hash = 2166136261u;
 
-  /* Check if there is a valid, non-zero-legnth path */
+  /* FNV-1a */
 
-  if (path && (pathlen = strlen(path)) > 0)
+  while (len-- > 0)
     {
-      /* Yes.. extend the file name by prepending the path */
+      hash = (hash ^ (uint8_t)*str++) * 16777619u;
+    }
 
-      if (path[pathlen - 1] == '/')
-        {
-          ret = fs_heap_asprintf(&relpath, "%s%s", path, name);
-        }
-      else
-        {
-          ret = fs_heap_asprintf(&relpath, "%s/%s", path, name);
-        }
+  return hash;
+}
 
-      /* Handle errors */
+/****************************************************************************
+ * Name: unionfs_pathlen
+ *
+ * Description:
+ *   Return the length of a path without any trailing '/'.
+ *
+ ****************************************************************************/
 
-      if (ret < 0)
-        {
-          return NULL;
-        }
-      else
-        {
-          return relpath;
-        }
-    }
-  else
-    {
-      /* There is no path... just duplicate the name (so that fs_heap_free()
-       * will work later).
-       */
+static size_t unionfs_pathlen(FAR const char *relpath)
+{
+  size_t len = strlen(relpath);
 
-      return fs_heap_strdup(name);
+  while (len > 0 && relpath[len - 1] == '/')
+    {
+      len--;
     }
+
+  return len;
 }
 
 /****************************************************************************
- * Name: unionfs_unbind_child
+ * Name: unionfs_basename
+ *
+ * Description:
+ *   Split a path into the length of its directory and its last name.
+ *
  ****************************************************************************/
 
-static int unionfs_unbind_child(FAR struct unionfs_mountpt_s *um)
+static FAR const char *unionfs_basename(FAR const char *relpath,
+                                        FAR size_t *dirlen,
+                                        FAR size_t *namelen)
 {
-  FAR struct inode *mpinode = um->um_node;
-  FAR struct inode *bdinode = NULL;
-  int ret;
+  size_t len = unionfs_pathlen(relpath);
+  size_t i;
 
-  /* Unbind the block driver from the file system (destroying any fs
-   * private data).  This logic is essentially the same as the logic in
-   * nuttx/fs/mount/fs_umount2.c.
-   */
+  for (i = len; i > 0 && relpath[i - 1] != '/'; i--);
 
-  if (!mpinode->u.i_mops->unbind)
+  *namelen = len - i;
+  *dirlen  = i;
+  while (*dirlen > 0 && relpath[*dirlen - 1] == '/')
     {
-      /* The filesystem does not support the unbind operation ??? */
-
-      return -EINVAL;
+      (*dirlen)--;
     }
 
-  /* The unbind method returns the number of references to the file system
-   * (i.e., open files), zero if the unbind was performed, or a negated
-   * error code on a failure.
-   */
+  return relpath + i;
+}
 
-  ret = mpinode->u.i_mops->unbind(mpinode->i_private, &bdinode, MNT_FORCE);
-  if (ret < 0)
+/****************************************************************************
+ * Name: unionfs_cache_find
+ *
+ * Description:
+ *   Find a name in a cached directory.
+ *
+ ****************************************************************************/
+
+static FAR struct unionfs_name_s *
+unionfs_cache_find(FAR struct unionfs_cdir_s *cdir, FAR const char *name,
+                   size_t len)
+{
+  FAR struct unionfs_name_s *un;
+  uint32_t hash;
+
+  if (cdir->uc_nbuckets == 0)
     {
-      /* Some failure occurred */
+      return NULL;
+    }
 
-      return ret;
+  hash = unionfs_hash(name, len);
+  for (un = cdir->uc_hash[hash & (cdir->uc_nbuckets - 1)]; un != NULL;
+       un = un->un_hlink)
+    {
+      if (un->un_hash == hash && strncmp(un->un_name, name, len) == 0 &&
+          un->un_name[len] == '\0')
+        {
+          return un;
+        }
     }
-  else if (ret > 0)
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: unionfs_cache_insert
+ *
+ * Description:
+ *   Add a new name to a cached directory.
+ *
+ ****************************************************************************/
+
+static FAR struct unionfs_name_s *
+unionfs_cache_insert(FAR struct unionfs_cdir_s *cdir, FAR const char *name,
+                     size_t len)
+{
+  FAR struct unionfs_name_s **hash;
+  FAR struct unionfs_name_s *un;
+  unsigned int nbuckets;
+
+  /* Keep at least as many buckets as names */
+
+  if (cdir->uc_nnames >= cdir->uc_nbuckets)
     {
-      /* REVISIT: This is bad if the file system cannot support a deferred
-       * unmount.  Ideally it would perform the unmount when the last file
-       * is closed.  But I don't think any file system do that.
-       */
+      nbuckets = cdir->uc_nbuckets > 0 ? cdir->uc_nbuckets * 2 :
+                 UNIONFS_NBUCKETS;
+      hash = fs_heap_zalloc(nbuckets * sizeof(*hash));
+      if (hash == NULL)
+        {
+          return NULL;
+        }
 
-      return -EBUSY;
-    }
+      for (un = cdir->uc_head; un != NULL; un = un->un_flink)
+        {
+          un->un_hlink = hash[un->un_hash & (nbuckets - 1)];
+          hash[un->un_hash & (nbuckets - 1)] = un;
+        }
 
-  /* Successfully unbound */
+      if (cdir->uc_hash != NULL)
+        {
+          fs_heap_free(cdir->uc_hash);
+        }
 
-  mpinode->i_private = NULL;
+      cdir->uc_hash     = hash;
+      cdir->uc_nbuckets = nbuckets;
+    }
 
-  /* Release the mountpoint inode and any block driver inode
-   * returned by the file system unbind above.  This should cause
-   * the inode to be deleted (unless there are other references)
-   */
+  un = fs_heap_zalloc(sizeof(struct unionfs_name_s) + len);
+  if (un == NULL)
+    {
+      return NULL;
+    }
 
-  inode_release(mpinode);
+  memcpy(un->un_name, name, len);
+  un->un_hash  = unionfs_hash(name, len);
+  un->un_hlink = cdir->uc_hash[un->un_hash & (cdir->uc_nbuckets - 1)];
+  cdir->uc_hash[un->un_hash & (cdir->uc_nbuckets - 1)] = un;
 
-  /* Did the unbind method return a contained block driver */
+  /* Names are listed in the order they were added */
 
-  if (bdinode)
+  if (cdir->uc_tail != NULL)
     {
-      inode_release(bdinode);
+      cdir->uc_tail->un_flink = un;
+    }
+  else
+    {
+      cdir->uc_head = un;
     }
 
-  return OK;
+  cdir->uc_tail = un;
+  cdir->uc_nnames++;
+  return un;
 }
 
 /****************************************************************************
- * Name: unionfs_destroy
+ * Name: unionfs_cache_add
+ *
+ * Description:
+ *   Merge a name read from file system 'ndx' into a cached directory.
+ *
  ****************************************************************************/
 
-static void unionfs_destroy(FAR struct unionfs_inode_s *ui)
+static int unionfs_cache_add(FAR struct unionfs_cdir_s *cdir, int ndx,
+                             FAR const char *name, uint8_t type)
 {
-  DEBUGASSERT(ui != NULL && ui->ui_fs[0].um_node != NULL &&
-              ui->ui_fs[1].um_node != NULL && ui->ui_nopen == 0);
-
-  /* Unbind the contained file systems */
+  FAR struct unionfs_name_s *un;
+  uint8_t flags;
 
-  unionfs_unbind_child(&ui->ui_fs[0]);
-  unionfs_unbind_child(&ui->ui_fs[1]);
+  flags = UNIONFS_NAME_FS1 << ndx;
+  if (DIRENT_ISDIRECTORY(type))
+    {
+      flags |= UNIONFS_NAME_DIR1 << ndx;
+    }
 
-  /* Free any allocated prefix strings */
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+  /* A whiteout on file system 1 hides the name on file system 2 */
 
-  if (ui->ui_fs[0].um_prefix)
+  if (ndx == 0 &&
+      strncmp(name, UNIONFS_WHITEOUT, UNIONFS_WHITEOUT_LEN) == 0)
     {
-      fs_heap_free(ui->ui_fs[0].um_prefix);
+      name += UNIONFS_WHITEOUT_LEN;
+      flags = UNIONFS_NAME_WHITEOUT;
     }
+#endif
 
-  if (ui->ui_fs[1].um_prefix)
+  un = unionfs_cache_find(cdir, name, strlen(name));
+  if (un == NULL)
     {
-      fs_heap_free(ui->ui_fs[1].um_prefix);
+      un = unionfs_cache_insert(cdir, name, strlen(name));
+      if (un == NULL)
+        {
+          return -ENOMEM;
+        }
     }
 
-  /* And finally free the allocated unionfs state structure as well */
+  if (flags != UNIONFS_NAME_WHITEOUT)
+    {
+      un->un_type[ndx] = type;
+    }
 
-  nxmutex_destroy(&ui->ui_lock);
-  fs_heap_free(ui);
+  un->un_flags |= flags;
+  return OK;
 }
 
 /****************************************************************************
- * Name: unionfs_open
+ * Name: unionfs_cache_release
  ****************************************************************************/
 
-static int unionfs_open(FAR struct file *filep, FAR const char *relpath,
-                        int oflags, mode_t mode)
+static void unionfs_cache_release(FAR struct unionfs_cdir_s *cdir)
 {
-  FAR struct unionfs_inode_s *ui;
-  FAR struct unionfs_file_s *uf;
-  FAR struct unionfs_mountpt_s *um;
-  int ret;
-
-  /* Recover the open file data from the struct file instance */
-
-  ui = filep->f_inode->i_private;
+  FAR struct unionfs_name_s *next;
+  FAR struct unionfs_name_s *un;
 
-  finfo("Opening: ui_nopen=%d\n", ui->ui_nopen);
-
-  /* Get exclusive access to the file system data structures */
+  /* Free the directory when neither the cache nor a reader uses it */
 
-  ret = nxmutex_lock(&ui->ui_lock);
-  if (ret < 0)
+  if (--cdir->uc_crefs > 0)
     {
-      return ret;
+      return;
     }
 
-  /* Allocate a container to hold the open file system information */
+  for (un = cdir->uc_head; un != NULL; un = next)
+    {
+      next = un->un_flink;
+      fs_heap_free(un);
+    }
 
-  uf = (FAR struct unionfs_file_s *)
-    fs_heap_zalloc(sizeof(struct unionfs_file_s));
-  if (uf == NULL)
+  if (cdir->uc_hash != NULL)
     {
-      ret = -ENOMEM;
-      goto errout_with_lock;
+      fs_heap_free(cdir->uc_hash);
     }
 
-  /* Try to open the file on file system 1 */
+  fs_heap_free(cdir);
+}
 
-  um = &ui->ui_fs[0];
-  DEBUGASSERT(um != NULL && um->um_node != NULL &&
-              um->um_node->u.i_mops != NULL);
+/****************************************************************************
+ * Name: unionfs_cache_build
+ *
+ * Description:
+ *   Read a directory from the file systems in 'layers' and merge the
+ *   names.  The new directory is not added to the cache.
+ *
+ ****************************************************************************/
 
-  uf->uf_file.f_oflags = filep->f_oflags;
-  uf->uf_file.f_inode  = um->um_node;
+static int unionfs_cache_build(FAR struct unionfs_inode_s *ui,
+                               FAR const char *relpath, size_t len,
+                               uint8_t layers,
+                               FAR struct unionfs_cdir_s **cdirp)
+{
+  FAR const struct mountpt_operations *ops;
+  FAR struct unionfs_mountpt_s *um;
+  FAR struct unionfs_cdir_s *cdir;
+  FAR struct fs_dirent_s *lower;
+  struct dirent entry;
+  int ret = OK;
+  int i;
 
-  ret = unionfs_tryopen(&uf->uf_file, relpath, um->um_prefix, oflags, mode);
-  if (ret >= 0)
+  cdir = fs_heap_zalloc(sizeof(struct unionfs_cdir_s) + len);
+  if (cdir == NULL)
     {
-      /* Successfully opened on file system 1 */
+      return -ENOMEM;
+    }
+
+  memcpy(cdir->uc_relpath, relpath, len);
+  cdir->uc_pathlen  = len;
+  cdir->uc_pathhash = unionfs_hash(relpath, len);
+  cdir->uc_crefs    = 1;
+
+  /* Read file system 1 first, so that its names and whiteouts are known
+   * when the names of file system 2 are merged in.
+   */
+
+  for (i = 0; i < 2 && ret >= 0; i++)
+    {
+      if ((layers & (UNIONFS_NAME_FS1 << i)) == 0)
+        {
+          continue;
+        }
+
+      um = &ui->ui_fs[i];
+      if (unionfs_offsetpath(cdir->uc_relpath, um->um_prefix) == NULL)
+        {
+          /* The directory may be a 'fake' node in the prefix */
+
+          if (unionfs_ispartprefix(cdir->uc_relpath, um->um_prefix))
+            {
+              ret = unionfs_cache_add(cdir, i, um->um_prefix,
+                                      DTYPE_DIRECTORY);
+            }
+
+          continue;
+        }
+
+      ret = unionfs_tryopendir(um->um_node, cdir->uc_relpath,
+                               um->um_prefix, &lower);
+      if (ret < 0)
+        {
+          /* The directory is not on this file system */
+
+          ret = OK;
+          continue;
+        }
+
+      lower->fd_root = um->um_node;
+      ops = um->um_node->u.i_mops;
+
+      while (ops->readdir != NULL &&
+             (ret = ops->readdir(um->um_node, lower, &entry)) >= 0)
+        {
+          ret = unionfs_cache_add(cdir, i, entry.d_name, entry.d_type);
+          if (ret < 0)
+            {
+              break;
+            }
+        }
+
+      if (ops->closedir != NULL)
+        {
+          ops->closedir(um->um_node, lower);
+        }
+
+      /* -ENOENT marks the end of the directory */
+
+      if (ret == -ENOENT)
+        {
+          ret = OK;
+        }
+    }
+
+  if (ret < 0)
+    {
+      unionfs_cache_release(cdir);
+      return ret;
+    }
+
+  *cdirp = cdir;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: unionfs_cache_dir
+ *
+ * Description:
+ *   Find a directory in the cache.
+ *
+ ****************************************************************************/
+
+static FAR struct unionfs_cdir_s *
+unionfs_cache_dir(FAR struct unionfs_inode_s *ui, FAR const char *relpath,
+                  size_t len, FAR struct unionfs_cdir_s **prevp)
+{
+  FAR struct unionfs_cdir_s *prev = NULL;
+  FAR struct unionfs_cdir_s *cdir;
+  uint32_t hash = unionfs_hash(relpath, len);
+
+  for (cdir = ui->ui_cdirs; cdir != NULL; cdir = cdir->uc_flink)
+    {
+      if (cdir->uc_pathhash == hash && cdir->uc_pathlen == len &&
+          memcmp(cdir->uc_relpath, relpath, len) == 0)
+        {
+          break;
+        }
+
+      prev = cdir;
+    }
+
+  if (prevp != NULL)
+    {
+      *prevp = prev;
+    }
+
+  return cdir;
+}
+
+/****************************************************************************
+ * Name: unionfs_cache_get
+ *
+ * Description:
+ *   Return the merged contents of a directory on both file systems, from
+ *   the cache or read and added to it.
+ *
+ ****************************************************************************/
+
+static int unionfs_cache_get(FAR struct unionfs_inode_s *ui,
+                             FAR const char *relpath, size_t len,
+                             FAR struct unionfs_cdir_s **cdirp)
+{
+  FAR struct unionfs_cdir_s *prev;
+  FAR struct unionfs_cdir_s *cdir;
+  int ret;
+
+  cdir = unionfs_cache_dir(ui, relpath, len, &prev);
+  if (cdir != NULL)
+    {
+      /* Move the directory to the head of the list */
+
+      if (prev != NULL)
+        {
+          prev->uc_flink = cdir->uc_flink;
+          cdir->uc_flink = ui->ui_cdirs;
+          ui->ui_cdirs   = cdir;
+        }
+
+      *cdirp = cdir;
+      return OK;
+    }
+
+  ret = unionfs_cache_build(ui, relpath, len,
+                            UNIONFS_NAME_FS1 | UNIONFS_NAME_FS2, &cdir);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Replace the least recently used directory if the cache is full */
+
+  if (ui->ui_ncdirs >= CONFIG_FS_UNIONFS_DIRCACHE)
+    {
+      FAR struct unionfs_cdir_s **link = &ui->ui_cdirs;
+
+      while ((*link)->uc_flink != NULL)
+        {
+          link = &(*link)->uc_flink;
+        }
+
+      unionfs_cache_release(*link);
+      *link = NULL;
+      ui->ui_ncdirs--;
+    }
+
+  cdir->uc_flink = ui->ui_cdirs;
+  ui->ui_cdirs   = cdir;
+  ui->ui_ncdirs++;
+
+  *cdirp = cdir;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: unionfs_cache_drop
+ *
+ * Description:
+ *   Drop a directory and all the directories below it from the cache.
+ *
+ ****************************************************************************/
+
+static void unionfs_cache_drop(FAR struct unionfs_inode_s *ui,
+                               FAR const char *relpath, size_t len)
+{
+  FAR struct unionfs_cdir_s **link = &ui->ui_cdirs;
+  FAR struct unionfs_cdir_s *cdir;
+
+  while ((cdir = *link) != NULL)
+    {
+      if (cdir->uc_pathlen >= len &&
+          memcmp(cdir->uc_relpath, relpath, len) == 0 &&
+          (len == 0 || cdir->uc_pathlen == len ||
+           cdir->uc_relpath[len] == '/'))
+        {
+          *link = cdir->uc_flink;
+          ui->ui_ncdirs--;
+          unionfs_cache_release(cdir);
+        }
+      else
+        {
+          link = &cdir->uc_flink;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: unionfs_cache_update
+ *
+ * Description:
+ *   Record a change of a name in its cached directory, if any.  The 'type'
+ *   is that of the name on the file systems in 'set'.
+ *
+ ****************************************************************************/
+
+static void unionfs_cache_update(FAR struct unionfs_inode_s *ui,
+                                 FAR const char *relpath, uint8_t set,
+                                 uint8_t clear, uint8_t type)
+{
+  FAR struct unionfs_name_s *un;
+  FAR struct unionfs_cdir_s *cdir;
+  FAR const char *name;
+  size_t namelen;
+  size_t dirlen;
+
+  name = unionfs_basename(relpath, &dirlen, &namelen);
+  cdir = unionfs_cache_dir(ui, relpath, dirlen, NULL);
+  if (cdir == NULL)
+    {
+      return;
+    }
+
+  un = unionfs_cache_find(cdir, name, namelen);
+  if (un == NULL && set != 0)
+    {
+      un = unionfs_cache_insert(cdir, name, namelen);
+      if (un == NULL)
+        {
+          /* The directory can no longer be trusted */
+
+          unionfs_cache_drop(ui, relpath, dirlen);
+          return;
+        }
+    }
+
+  if (un != NULL)
+    {
+      un->un_flags = (un->un_flags & ~clear) | set;
+      if ((set & UNIONFS_NAME_FS1) != 0)
+        {
+          un->un_type[0] = type;
+        }
+
+      if ((set & UNIONFS_NAME_FS2) != 0)
+        {
+          un->un_type[1] = type;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: unionfs_lookup
+ *
+ * Description:
+ *   Find the file systems that hold a path.  Every directory on the way
+ *   that exists on both file systems is looked up in the directory cache.
+ *   Once a name exists on one file system only, everything below it is on
+ *   that file system and 'flags' is returned with UNIONFS_NAME_UNKNOWN.
+ *
+ ****************************************************************************/
+
+static int unionfs_lookup(FAR struct unionfs_inode_s *ui,
+                          FAR const char *relpath, FAR uint8_t *flags)
+{
+  FAR struct unionfs_name_s *un;
+  FAR struct unionfs_cdir_s *cdir;
+  FAR const char *comp = relpath;
+  FAR const char *end;
+  uint8_t layers = UNIONFS_NAME_MERGED;
+  size_t dirlen;
+  int ret;
+
+  for (; *comp == '/'; comp++);
+
+  while (*comp != '\0')
+    {
+      if (!UNIONFS_ISMERGED(layers))
+        {
+          /* The rest of the path is on one file system */
+
+          *flags = ((layers & UNIONFS_NAME_FS1) != 0 ?
+                    UNIONFS_NAME_FS1 : UNIONFS_NAME_FS2) |
+                   UNIONFS_NAME_UNKNOWN;
+          return OK;
+        }
+
+      end = strchr(comp, '/');
+      if (end == NULL)
+        {
+          end = comp + strlen(comp);
+        }
+
+      for (dirlen = comp - relpath;
+           dirlen > 0 && relpath[dirlen - 1] == '/'; dirlen--);
+
+      ret = unionfs_cache_get(ui, relpath, dirlen, &cdir);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      un = unionfs_cache_find(cdir, comp, end - comp);
+      layers = un != NULL ? un->un_flags : 0;
+
+      for (comp = end; *comp == '/'; comp++);
+
+      if (!UNIONFS_VISIBLE(layers) && *comp != '\0')
+        {
+          return -ENOENT;
+        }
+    }
+
+  *flags = layers;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: unionfs_lookupstat
+ *
+ * Description:
+ *   Like unionfs_lookup() but check the existence and type of a path that
+ *   is on one file system only.
+ *
+ ****************************************************************************/
+
+static int unionfs_lookupstat(FAR struct unionfs_inode_s *ui,
+                              FAR const char *relpath, FAR uint8_t *flags)
+{
+  FAR struct unionfs_mountpt_s *um;
+  struct stat buf;
+  int ndx;
+  int ret;
+
+  ret = unionfs_lookup(ui, relpath, flags);
+  if (ret < 0 || (*flags & UNIONFS_NAME_UNKNOWN) == 0)
+    {
+      return ret;
+    }
+
+  ndx = (*flags & UNIONFS_NAME_FS1) != 0 ? 0 : 1;
+  um  = &ui->ui_fs[ndx];
+  ret = unionfs_trystat(um->um_node, relpath, um->um_prefix, &buf);
+  if (ret == -ENOENT)
+    {
+      *flags = 0;
+      return OK;
+    }
+  else if (ret < 0)
+    {
+      return ret;
+    }
+
+  *flags = UNIONFS_NAME_FS1 << ndx;
+  if (S_ISDIR(buf.st_mode))
+    {
+      *flags |= UNIONFS_NAME_DIR1 << ndx;
+    }
+
+  return OK;
+}
+
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+/****************************************************************************
+ * Name: unionfs_whpath
+ *
+ * Description:
+ *   Return the path of the whiteout of 'name' in directory 'relpath'.
+ *
+ ****************************************************************************/
+
+static FAR char *unionfs_whpath(FAR const char *relpath, size_t dirlen,
+                                FAR const char *name, size_t namelen)
+{
+  FAR char *path;
+  int ret;
+
+  ret = fs_heap_asprintf(&path, "%.*s%s" UNIONFS_WHITEOUT "%.*s",
+                         (int)dirlen, relpath, dirlen > 0 ? "/" : "",
+                         (int)namelen, name);
+  return ret < 0 ? NULL : path;
+}
+
+/****************************************************************************
+ * Name: unionfs_whiteout
+ *
+ * Description:
+ *   Hide a path on file system 2 by a whiteout on file system 1.
+ *
+ ****************************************************************************/
+
+static int unionfs_whiteout(FAR struct unionfs_inode_s *ui,
+                            FAR const char *relpath)
+{
+  FAR struct unionfs_mountpt_s *um = &ui->ui_fs[0];
+  FAR const char *name;
+  struct file file;
+  FAR char *path;
+  size_t namelen;
+  size_t dirlen;
+  int ret;
+
+  ret = unionfs_copyup_parent(ui, relpath);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  name = unionfs_basename(relpath, &dirlen, &namelen);
+  path = unionfs_whpath(relpath, dirlen, name, namelen);
+  if (path == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  memset(&file, 0, sizeof(file));
+  file.f_oflags = O_WRONLY | O_CREAT | O_TRUNC;
+  file.f_inode  = um->um_node;
+
+  ret = unionfs_tryopen(&file, path, um->um_prefix, file.f_oflags, 0644);
+  if (ret >= 0)
+    {
+      if (um->um_node->u.i_mops->close != NULL)
+        {
+          um->um_node->u.i_mops->close(&file);
+        }
+
+      unionfs_cache_update(ui, relpath, UNIONFS_NAME_WHITEOUT, 0, 0);
+    }
+
+  fs_heap_free(path);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: unionfs_copyup_parent
+ *
+ * Description:
+ *   Create the directories leading to a path on file system 1, with the
+ *   modes of the same directories on file system 2.
+ *
+ ****************************************************************************/
+
+static int unionfs_copyup_parent(FAR struct unionfs_inode_s *ui,
+                                 FAR const char *relpath)
+{
+  FAR struct unionfs_mountpt_s *um1 = &ui->ui_fs[0];
+  FAR struct unionfs_mountpt_s *um2 = &ui->ui_fs[1];
+  struct stat buf;
+  FAR char *path;
+  FAR char *sep;
+  size_t namelen;
+  size_t dirlen;
+  int ret = OK;
+
+  unionfs_basename(relpath, &dirlen, &namelen);
+  if (dirlen == 0)
+    {
+      return OK;
+    }
+
+  path = fs_heap_malloc(dirlen + 1);
+  if (path == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  memcpy(path, relpath, dirlen);
+  path[dirlen] = '\0';
+
+  /* Check every directory from the top down */
+
+  sep = path;
+  do
+    {
+      sep = strchr(sep, '/');
+      if (sep != NULL)
+        {
+          *sep = '\0';
+        }
+
+      ret = unionfs_trystat(um1->um_node, path, um1->um_prefix, &buf);
+      if (ret >= 0 && !S_ISDIR(buf.st_mode))
+        {
+          ret = -ENOTDIR;
+        }
+      else if (ret == -ENOENT)
+        {
+          ret = unionfs_trystat(um2->um_node, path, um2->um_prefix, &buf);
+          if (ret >= 0)
+            {
+              ret = unionfs_trymkdir(um1->um_node, path, um1->um_prefix,
+                                     buf.st_mode & ~S_IFMT);
+            }
+
+          if (ret >= 0)
+            {
+              unionfs_cache_update(ui, path,
+                                   UNIONFS_NAME_FS1 | UNIONFS_NAME_DIR1,
+                                   0, DTYPE_DIRECTORY);
+            }
+        }
+
+      if (sep != NULL)
+        {
+          *sep++ = '/';
+        }
+    }
+  while (ret >= 0 && sep != NULL);
+
+  fs_heap_free(path);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: unionfs_copyup
+ *
+ * Description:
+ *   Copy a file or directory on file system 2 to file system 1.  The data
+ *   of a file is copied only if 'data' is true.
+ *
+ ****************************************************************************/
+
+static int unionfs_copyup(FAR struct unionfs_inode_s *ui,
+                          FAR const char *relpath, bool data)
+{
+  FAR struct unionfs_mountpt_s *um1 = &ui->ui_fs[0];
+  FAR struct unionfs_mountpt_s *um2 = &ui->ui_fs[1];
+  FAR const struct mountpt_operations *ops1 = um1->um_node->u.i_mops;
+  FAR const struct mountpt_operations *ops2 = um2->um_node->u.i_mops;
+  struct stat buf;
+  struct file src;
+  struct file dst;
+  FAR char *copy;
+  ssize_t nread;
+  ssize_t nwritten;
+  int ret;
+
+  ret = unionfs_trystat(um2->um_node, relpath, um2->um_prefix, &buf);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = unionfs_copyup_parent(ui, relpath);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (S_ISDIR(buf.st_mode))
+    {
+      ret = unionfs_trymkdir(um1->um_node, relpath, um1->um_prefix,
+                             buf.st_mode & ~S_IFMT);
+      if (ret >= 0)
+        {
+          unionfs_cache_update(ui, relpath,
+                               UNIONFS_NAME_FS1 | UNIONFS_NAME_DIR1, 0,
+                               DTYPE_DIRECTORY);
+        }
+
+      return ret;
+    }
+  else if (!S_ISREG(buf.st_mode))
+    {
+      return -ENOTSUP;
+    }
+
+  memset(&dst, 0, sizeof(dst));
+  dst.f_oflags = O_WRONLY | O_CREAT | O_TRUNC;
+  dst.f_inode  = um1->um_node;
+
+  ret = unionfs_tryopen(&dst, relpath, um1->um_prefix, dst.f_oflags,
+                        buf.st_mode & ~S_IFMT);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (data && buf.st_size > 0)
+    {
+      memset(&src, 0, sizeof(src));
+      src.f_oflags = O_RDONLY;
+      src.f_inode  = um2->um_node;
+
+      copy = fs_heap_malloc(UNIONFS_COPYBUF_SIZE);
+      if (copy == NULL)
+        {
+          ret = -ENOMEM;
+        }
+      else if (ops2->read == NULL || ops1->write == NULL)
+        {
+          ret = -ENOSYS;
+        }
+      else
+        {
+          ret = unionfs_tryopen(&src, relpath, um2->um_prefix, O_RDONLY, 0);
+        }
+
+      if (ret >= 0)
+        {
+          while ((nread = ops2->read(&src, copy, UNIONFS_COPYBUF_SIZE)) > 0)
+            {
+              nwritten = ops1->write(&dst, copy, nread);
+              if (nwritten != nread)
+                {
+                  ret = nwritten < 0 ? nwritten : -ENOSPC;
+                  break;
+                }
+            }
+
+          if (nread < 0)
+            {
+              ret = nread;
+            }
+
+          if (ops2->close != NULL)
+            {
+              ops2->close(&src);
+            }
+        }
+
+      if (copy != NULL)
+        {
+          fs_heap_free(copy);
+        }
+    }
+
+  if (ops1->close != NULL)
+    {
+      ops1->close(&dst);
+    }
+
+  if (ret < 0)
+    {
+      unionfs_tryunlink(um1->um_node, relpath, um1->um_prefix);
+      return ret;
+    }
+
+  /* Keep the times of the original, not every file system supports it */
+
+  unionfs_trychstat(um1->um_node, relpath, um1->um_prefix, &buf,
+                    CH_STAT_ATIME | CH_STAT_MTIME);
+  unionfs_cache_update(ui, relpath, UNIONFS_NAME_FS1, UNIONFS_NAME_DIR1,
+                       DTYPE_FILE);
+  return OK;
+}
+#endif /* CONFIG_FS_UNIONFS_COPYUP */
+
+/****************************************************************************
+ * Name: unionfs_writable
+ *
+ * Description:
+ *   Check if an open file may be changed through its descriptor.  With
+ *   copy-up, file system 2 is never modified.  A file opened there
+ *   read-only was not copied up and cannot be switched to a copy while it
+ *   is open.
+ *
+ ****************************************************************************/
+
+static int unionfs_writable(FAR struct unionfs_file_s *uf)
+{
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+  if (uf->uf_ndx == 1)
+    {
+      return -EROFS;
+    }
+#endif
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: unionfs_unbind_child
+ ****************************************************************************/
+
+static int unionfs_unbind_child(FAR struct unionfs_mountpt_s *um)
+{
+  FAR struct inode *mpinode = um->um_node;
+  FAR struct inode *bdinode = NULL;
+  int ret;
+
+  /* Unbind the block driver from the file system (destroying any fs
+   * private data).  This logic is essentially the same as the logic in
+   * nuttx/fs/mount/fs_umount2.c.
+   */
+
+  if (!mpinode->u.i_mops->unbind)
+    {
+      /* The filesystem does not support the unbind operation ??? */
+
+      return -EINVAL;
+    }
+
+  /* The unbind method returns the number of references to the file system
+   * (i.e., open files), zero if the unbind was performed, or a negated
+   * error code on a failure.
+   */
+
+  ret = mpinode->u.i_mops->unbind(mpinode->i_private, &bdinode, MNT_FORCE);
+  if (ret < 0)
+    {
+      /* Some failure occurred */
+
+      return ret;
+    }
+  else if (ret > 0)
+    {
+      /* REVISIT: This is bad if the file system cannot support a deferred
+       * unmount.  Ideally it would perform the unmount when the last file
+       * is closed.  But I don't think any file system do that.
+       */
+
+      return -EBUSY;
+    }
+
+  /* Successfully unbound */
+
+  mpinode->i_private = NULL;
+
+  /* Release the mountpoint inode and any block driver inode
+   * returned by the file system unbind above.  This should cause
+   * the inode to be deleted (unless there are other references)
+   */
+
+  inode_release(mpinode);
+
+  /* Did the unbind method return a contained block driver */
+
+  if (bdinode)
+    {
+      inode_release(bdinode);
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: unionfs_destroy
+ ****************************************************************************/
+
+static void unionfs_destroy(FAR struct unionfs_inode_s *ui)
+{
+  DEBUGASSERT(ui != NULL && ui->ui_fs[0].um_node != NULL &&
+              ui->ui_fs[1].um_node != NULL && ui->ui_nopen == 0);
+
+  /* Unbind the contained file systems */
+
+  unionfs_unbind_child(&ui->ui_fs[0]);
+  unionfs_unbind_child(&ui->ui_fs[1]);
+
+  /* Free any allocated prefix strings */
+
+  if (ui->ui_fs[0].um_prefix)
+    {
+      fs_heap_free(ui->ui_fs[0].um_prefix);
+    }
+
+  if (ui->ui_fs[1].um_prefix)
+    {
+      fs_heap_free(ui->ui_fs[1].um_prefix);
+    }
+
+  /* Free the cached directories */
+
+  unionfs_cache_drop(ui, "", 0);
+
+  /* And finally free the allocated unionfs state structure as well */
+
+  nxmutex_destroy(&ui->ui_lock);
+  fs_heap_free(ui);
+}
+
+/****************************************************************************
+ * Name: unionfs_open
+ ****************************************************************************/
+
+static int unionfs_open(FAR struct file *filep, FAR const char *relpath,
+                        int oflags, mode_t mode)
+{
+  FAR struct unionfs_inode_s *ui;
+  FAR struct unionfs_file_s *uf;
+  FAR struct unionfs_mountpt_s *um;
+  bool create = false;
+  uint8_t flags;
+  int ndx;
+  int ret;
+
+  /* Recover the open file data from the struct file instance */
+
+  ui = filep->f_inode->i_private;
+
+  finfo("Opening: ui_nopen=%d\n", ui->ui_nopen);
+
+  /* Get exclusive access to the file system data structures */
+
+  ret = nxmutex_lock(&ui->ui_lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Allocate a container to hold the open file system information */
+
+  uf = (FAR struct unionfs_file_s *)
+    fs_heap_zalloc(sizeof(struct unionfs_file_s));
+  if (uf == NULL)
+    {
+      ret = -ENOMEM;
+      goto errout_with_lock;
+    }
+
+  /* Find the file system that holds the file.  Its existence matters only
+   * if the file may be created or modified.
+   */
+
+  if ((oflags & (O_CREAT | O_WROK | O_TRUNC)) != 0)
+    {
+      ret = unionfs_lookupstat(ui, relpath, &flags);
+    }
+  else
+    {
+      ret = unionfs_lookup(ui, relpath, &flags);
+    }
+
+  if (ret < 0)
+    {
+      goto errout_with_uf;
+    }
+
+  if (UNIONFS_VISIBLE(flags))
+    {
+      if ((oflags & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL))
+        {
+          ret = -EEXIST;
+          goto errout_with_uf;
+        }
+
+      ndx = (flags & UNIONFS_NAME_FS1) != 0 ? 0 : 1;
+
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+      /* A file on file system 2 is modified as a copy on file system 1 */
+
+      if (ndx == 1 && (oflags & (O_WROK | O_TRUNC)) != 0)
+        {
+          ret = unionfs_copyup(ui, relpath, (oflags & O_TRUNC) == 0);
+          if (ret < 0)
+            {
+              goto errout_with_uf;
+            }
 
-      uf->uf_ndx = 0;
+          ndx = 0;
+        }
+#endif
+    }
+  else if ((oflags & O_CREAT) == 0)
+    {
+      ret = -ENOENT;
+      goto errout_with_uf;
     }
   else
     {
-      /* Try to open the file on file system 1 */
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+      /* New files are created on file system 1 only */
 
+      ret = unionfs_copyup_parent(ui, relpath);
+      if (ret < 0)
+        {
+          goto errout_with_uf;
+        }
+#else
+      create = true;
+#endif
+      ndx = 0;
+    }
+
+  /* Try to open the file on that file system */
+
+  um = &ui->ui_fs[ndx];
+  DEBUGASSERT(um != NULL && um->um_node != NULL &&
+              um->um_node->u.i_mops != NULL);
+
+  uf->uf_file.f_oflags = filep->f_oflags;
+  uf->uf_file.f_inode  = um->um_node;
+
+  ret = unionfs_tryopen(&uf->uf_file, relpath, um->um_prefix, oflags, mode);
+
+  /* A merged directory, or a new file that file system 1 refuses, may
+   * still be opened on file system 2.
+   */
+
+  if (ret < 0 && ndx == 0 && (create || UNIONFS_ISMERGED(flags)))
+    {
+      ndx = 1;
       um  = &ui->ui_fs[1];
 
+      memset(&uf->uf_file, 0, sizeof(uf->uf_file));
       uf->uf_file.f_oflags = filep->f_oflags;
       uf->uf_file.f_inode  = um->um_node;
 
       ret = unionfs_tryopen(&uf->uf_file, relpath, um->um_prefix, oflags,
                             mode);
-      if (ret < 0)
-        {
-          goto errout_with_lock;
-        }
+    }
 
-      /* Successfully opened on file system 1 */
+  if (ret < 0)
+    {
+      goto errout_with_uf;
+    }
 
-      uf->uf_ndx = 1;
+  if (!UNIONFS_VISIBLE(flags))
+    {
+      unionfs_cache_update(ui, relpath, UNIONFS_NAME_FS1 << ndx,
+                           UNIONFS_NAME_DIR1 << ndx, DTYPE_FILE);
     }
 
+  uf->uf_ndx = ndx;
+
   /* Increment the open reference count */
 
   ui->ui_nopen++;
@@ -939,7 +2030,11 @@ static int unionfs_open(FAR struct file *filep, FAR const char *relpath,
   /* Save our private data in the file structure */
 
   filep->f_priv = (FAR void *)uf;
-  ret = OK;
+  nxmutex_unlock(&ui->ui_lock);
+  return OK;
+
+errout_with_uf:
+  fs_heap_free(uf);
 
 errout_with_lock:
   nxmutex_unlock(&ui->ui_lock);
@@ -1335,6 +2430,7 @@ static int unionfs_fchstat(FAR const struct file *filep,
   FAR struct unionfs_file_s *uf;
   FAR struct unionfs_mountpt_s *um;
   FAR const struct mountpt_operations *ops;
+  int ret;
 
   finfo("filep=%p buf=%p\n", filep, buf);
 
@@ -1346,6 +2442,13 @@ static int unionfs_fchstat(FAR const struct file *filep,
   uf = (FAR struct unionfs_file_s *)filep->f_priv;
 
   DEBUGASSERT(uf->uf_ndx == 0 || uf->uf_ndx == 1);
+
+  ret = unionfs_writable(uf);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
   um = &ui->ui_fs[uf->uf_ndx];
 
   DEBUGASSERT(um != NULL && um->um_node != NULL &&
@@ -1371,6 +2474,7 @@ static int unionfs_truncate(FAR struct file *filep, off_t length)
   FAR struct unionfs_file_s *uf;
   FAR struct unionfs_mountpt_s *um;
   FAR const struct mountpt_operations *ops;
+  int ret;
 
   finfo("filep=%p length=%ld\n", filep, (long)length);
 
@@ -1382,6 +2486,13 @@ static int unionfs_truncate(FAR struct file *filep, off_t length)
   uf = (FAR struct unionfs_file_s *)filep->f_priv;
 
   DEBUGASSERT(uf->uf_ndx == 0 || uf->uf_ndx == 1);
+
+  ret = unionfs_writable(uf);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
   um = &ui->ui_fs[uf->uf_ndx];
 
   DEBUGASSERT(um != NULL && um->um_node != NULL &&
@@ -1404,6 +2515,7 @@ static int unionfs_opendir(FAR struct inode *mountpt,
   FAR struct unionfs_inode_s *ui;
   FAR struct unionfs_mountpt_s *um;
   FAR struct unionfs_dir_s *udir;
+  uint8_t flags;
   int ret;
 
   finfo("relpath: \"%s\"\n", relpath ? relpath : "NULL");
@@ -1434,84 +2546,49 @@ static int unionfs_opendir(FAR struct inode *mountpt,
 
   DEBUGASSERT(dir);
 
-  /* Clone the path.  We will need this when we traverse file system 2 to
-   * omit duplicates on file system 1.
-   */
+  ret = unionfs_lookup(ui, relpath, &flags);
+  if (ret < 0)
+    {
+      goto errout_with_lock;
+    }
 
-  if (strlen(relpath) > 0)
+  if (UNIONFS_ISMERGED(flags))
     {
-      udir->fu_relpath = fs_heap_strdup(relpath);
-      if (!udir->fu_relpath)
+      /* The directory is on both file systems.  It is listed from the
+       * cache, where the names of file system 2 that are hidden by file
+       * system 1 are already dropped.
+       */
+
+      ret = unionfs_cache_get(ui, relpath, unionfs_pathlen(relpath),
+                              &udir->fu_cdir);
+      if (ret < 0)
         {
           goto errout_with_lock;
         }
-    }
 
-  /* Check file system 2 first. */
-
-  um = &ui->ui_fs[1];
-  ret = unionfs_tryopendir(um->um_node, relpath, um->um_prefix,
-                           &udir->fu_lower[1]);
-  if (ret >= 0)
-    {
-      /* Save the file system 2 access info */
-
-      udir->fu_ndx = 1;
-      udir->fu_lower[1]->fd_root = um->um_node;
+      udir->fu_cdir->uc_crefs++;
+      udir->fu_next = udir->fu_cdir->uc_head;
     }
-
-  /* Check if the user is stat'ing some "fake" node between the unionfs root
-   * and the file system 1/2 root directory.
-   */
-
-  else if (unionfs_ispartprefix(relpath, ui->ui_fs[1].um_prefix))
+  else if (UNIONFS_VISIBLE(flags))
     {
-      /* File system 2 prefix includes this relpath */
-
-      udir->fu_ndx = 1;
-      udir->fu_prefix[1] = true;
-    }
+      /* The directory is on one file system, list it from there */
 
-  /* Check file system 1 last, possibly overwriting fu_ndx */
+      udir->fu_ndx = (flags & UNIONFS_NAME_FS1) != 0 ? 0 : 1;
+      um = &ui->ui_fs[udir->fu_ndx];
 
-  um = &ui->ui_fs[0];
-  ret = unionfs_tryopendir(um->um_node, relpath, um->um_prefix,
-                           &udir->fu_lower[0]);
-  if (ret >= 0)
-    {
-      /* Save the file system 1 access info */
+      ret = unionfs_tryopendir(um->um_node, relpath, um->um_prefix,
+                               &udir->fu_lower);
+      if (ret < 0)
+        {
+          goto errout_with_lock;
+        }
 
-      udir->fu_ndx = 0;
-      udir->fu_lower[0]->fd_root = um->um_node;
+      udir->fu_lower->fd_root = um->um_node;
     }
   else
     {
-      /* Check if the user is stat'ing some "fake" node between the unionfs
-       * root and the file system 1 root directory.
-       */
-
-      if (unionfs_ispartprefix(relpath, ui->ui_fs[0].um_prefix))
-        {
-          /* File system 1 offset includes this relpath.  Make sure that only
-           * one
-           */
-
-          udir->fu_ndx = 0;
-          udir->fu_prefix[0] = true;
-          udir->fu_prefix[1] = false;
-        }
-
-      /* If the directory was not found on either file system, then we have
-       * failed to open this path on either file system.
-       */
-
-      else if (udir->fu_lower[1] == NULL && !udir->fu_prefix[1])
-        {
-          /* Neither of the two path file systems include this relpath */
-
-          ret = -ENOENT;
-          goto errout_with_relpath;
-        }
+      ret = -ENOENT;
+      goto errout_with_lock;
     }
 
   /* Increment the number of open references and return success */
@@ -1523,12 +2600,6 @@ static int unionfs_opendir(FAR struct inode *mountpt,
   *dir = &udir->fu_base;
   return OK;
 
-errout_with_relpath:
-  if (udir->fu_relpath != NULL)
-    {
-      fs_heap_free(udir->fu_relpath);
-    }
-
 errout_with_lock:
   nxmutex_unlock(&ui->ui_lock);
 
@@ -1549,7 +2620,6 @@ static int unionfs_closedir(FAR struct inode *mountpt,
   FAR const struct mountpt_operations *ops;
   FAR struct unionfs_dir_s *udir;
   int ret = OK;
-  int i;
 
   finfo("mountpt=%p dir=%p\n", mountpt, dir);
 
@@ -1569,36 +2639,28 @@ static int unionfs_closedir(FAR struct inode *mountpt,
   DEBUGASSERT(dir);
   udir = (FAR struct unionfs_dir_s *)dir;
 
-  /* Close both contained file systems */
-
-  for (i = 0; i < 2; i++)
+  if (udir->fu_cdir != NULL)
     {
-      /* Was this file system opened? */
+      /* Release the merged directory */
 
-      if (udir->fu_lower[i] != NULL)
-        {
-          um = &ui->ui_fs[i];
+      unionfs_cache_release(udir->fu_cdir);
+    }
+  else
+    {
+      um = &ui->ui_fs[udir->fu_ndx];
 
-          DEBUGASSERT(um != NULL && um->um_node != NULL &&
-                      um->um_node->u.i_mops != NULL);
-          ops = um->um_node->u.i_mops;
+      DEBUGASSERT(um != NULL && um->um_node != NULL &&
+                  um->um_node->u.i_mops != NULL);
+      ops = um->um_node->u.i_mops;
 
-          /* Perform the lower level closedir operation */
+      /* Perform the lower level closedir operation */
 
-          if (ops->closedir != NULL)
-            {
-              ret = ops->closedir(um->um_node, udir->fu_lower[i]);
-            }
+      if (ops->closedir != NULL)
+        {
+          ret = ops->closedir(um->um_node, udir->fu_lower);
         }
     }
 
-  /* Free any allocated path */
-
-  if (udir->fu_relpath != NULL)
-    {
-      fs_heap_free(udir->fu_relpath);
-    }
-
   fs_heap_free(udir);
 
   /* Decrement the count of open reference.  If that count would go to zero
@@ -1628,13 +2690,10 @@ static int unionfs_readdir(FAR struct inode *mountpt,
 {
   FAR struct unionfs_inode_s *ui;
   FAR struct unionfs_mountpt_s *um;
-  FAR struct unionfs_mountpt_s *um0;
   FAR const struct mountpt_operations *ops;
+  FAR struct unionfs_name_s *un;
   FAR struct unionfs_dir_s *udir;
-  FAR char *relpath;
-  struct stat buf;
-  bool duplicate;
-  int ret = -ENOSYS;
+  int ret;
 
   /* Recover the union file system data from the struct inode instance */
 
@@ -1644,235 +2703,69 @@ static int unionfs_readdir(FAR struct inode *mountpt,
   DEBUGASSERT(dir);
   udir = (FAR struct unionfs_dir_s *)dir;
 
-  /* Check if we are at the end of the directory listing. */
-
-  if (udir->fu_eod)
-    {
-      /* End of file and error conditions are not distinguishable
-       * with readdir.  Here we return -ENOENT to signal the end
-       * of the directory.
-       */
-
-      return -ENOENT;
-    }
-
-  DEBUGASSERT(udir->fu_ndx == 0 || udir->fu_ndx == 1);
-  um = &ui->ui_fs[udir->fu_ndx];
-
-  /* Special case: If the open directory is a 'fake' node in the prefix on
-   * one of the mounted file system, then we must also fake the return value.
-   */
-
-  if (udir->fu_prefix[udir->fu_ndx])
+  if (udir->fu_cdir != NULL)
     {
-      DEBUGASSERT(udir->fu_lower[udir->fu_ndx] == NULL &&
-                  um->um_prefix != NULL);
-
-      /* Copy the file system offset into the dirent structure.
-       * REVISIT:  This will not handle the case where the prefix contains
-       * the '/' character the so the offset appears to be multiple
-       * directories.
+      /* Return the next visible name of the merged directory.  Names
+       * added while the directory is listed are appended, names removed
+       * are only marked.
        */
 
-      strlcpy(entry->d_name, um->um_prefix, sizeof(entry->d_name));
-
-      /* Describe this as a read only directory */
-
-      entry->d_type = DTYPE_DIRECTORY;
+      ret = nxmutex_lock(&ui->ui_lock);
+      if (ret < 0)
+        {
+          return ret;
+        }
 
-      /* Increment the index to file system 2 (maybe) */
+      for (un = udir->fu_next; un != NULL && !UNIONFS_VISIBLE(un->un_flags);
+           un = un->un_flink);
 
-      if (udir->fu_ndx == 0 && (udir->fu_prefix[1] ||
-                                udir->fu_lower[1] != NULL))
+      if (un != NULL)
         {
-          /* Yes.. set up to do file system 2 next time */
-
-          udir->fu_ndx++;
+          strlcpy(entry->d_name, un->un_name, sizeof(entry->d_name));
+          entry->d_type = (un->un_flags & UNIONFS_NAME_FS1) != 0 ?
+                          un->un_type[0] : un->un_type[1];
+          udir->fu_next = un->un_flink;
         }
       else
         {
-          /* No.. we are finished */
+          /* End of file and error conditions are not distinguishable
+           * with readdir.  Here we return -ENOENT to signal the end
+           * of the directory.
+           */
 
-          udir->fu_eod = true;
+          udir->fu_next = NULL;
+          ret = -ENOENT;
         }
 
-      return OK;
+      nxmutex_unlock(&ui->ui_lock);
+      return ret;
     }
 
   /* This is a normal, mediated file system readdir() */
 
-  DEBUGASSERT(udir->fu_lower[udir->fu_ndx] != NULL);
+  um = &ui->ui_fs[udir->fu_ndx];
   DEBUGASSERT(um->um_node != NULL && um->um_node->u.i_mops != NULL);
   ops = um->um_node->u.i_mops;
 
   finfo("fu_ndx: %d\n", udir->fu_ndx);
 
-  /* Perform the lower level readdir operation */
-
-  if (ops->readdir != NULL)
+  if (ops->readdir == NULL)
     {
-      /* Loop if we discard duplicate directory entries in filey system 2 */
-
-      do
-        {
-          /* Read the directory entry */
-
-          ret = ops->readdir(um->um_node, udir->fu_lower[udir->fu_ndx],
-                             entry);
-
-          /* Did the read operation fail because we reached the end of the
-           * directory?  In that case, the error would be -ENOENT.  If we
-           * hit the end-of-directory on file system, we need to seamlessly
-           * move to the second file system (if there is one).
-           */
-
-          if (ret == -ENOENT && udir->fu_ndx == 0)
-            {
-              /* Special case: If the open directory is a 'fake' node in the
-               * prefix on file system2, then we must also fake the return
-               * value.
-               */
-
-              if (udir->fu_prefix[1])
-                {
-                  DEBUGASSERT(udir->fu_lower[1] == NULL);
-
-                  /* Switch to the second file system */
-
-                  udir->fu_ndx = 1;
-                  um = &ui->ui_fs[1];
-
-                  DEBUGASSERT(um != NULL && um->um_prefix != NULL);
-
-                  /* Copy the file system offset into the dirent structure.
-                   * REVISIT:  This will not handle the case where the prefix
-                   * contains the '/' character the so the offset appears to
-                   * be multiple directories.
-                   */
-
-                  strlcpy(entry->d_name, um->um_prefix,
-                          sizeof(entry->d_name));
-
-                  /* Describe this as a read only directory */
-
-                  entry->d_type = DTYPE_DIRECTORY;
-
-                  /* Mark the end of the directory listing */
-
-                  udir->fu_eod = true;
-
-                  /* Check if have already reported something of this name
-                   * in file system 1.
-                   */
-
-                  relpath = unionfs_relpath(udir->fu_relpath, um->um_prefix);
-                  if (relpath)
-                    {
-                      int tmp;
-
-                      /* Check if anything exists at this path on file
-                       * system 1
-                       */
-
-                      um0 = &ui->ui_fs[0];
-                      tmp = unionfs_trystat(um0->um_node, relpath,
-                                            um0->um_prefix, &buf);
-
-                      /* Free the allocated relpath */
-
-                      fs_heap_free(relpath);
-
-                      /* Check for a duplicate */
-
-                      if (tmp >= 0)
-                        {
-                          /* There is something there!
-                           * REVISIT: We could allow files and directories to
-                           * have duplicate names.
-                           */
-
-                          return -ENOENT;
-                        }
-                    }
-
-                  return OK;
-                }
-
-              /* No.. check for a normal directory access */
-
-              else if (udir->fu_lower[1] != NULL)
-                {
-                  /* Switch to the second file system */
-
-                  udir->fu_ndx = 1;
-                  um = &ui->ui_fs[1];
-
-                  DEBUGASSERT(um != NULL && um->um_node != NULL &&
-                              um->um_node->u.i_mops != NULL);
-                  ops = um->um_node->u.i_mops;
-
-                  /* Make sure that the second file system directory
-                   * enumeration is rewound to the beginning of the
-                   * directory.
-                   */
-
-                  if (ops->rewinddir != NULL)
-                    {
-                      ret = ops->rewinddir(um->um_node, udir->fu_lower[1]);
-                      if (ret < 0)
-                        {
-                          return ret;
-                        }
-                    }
-
-                  /* Then try the read operation again */
-
-                  ret = ops->readdir(um->um_node, udir->fu_lower[1], entry);
-                }
-            }
-
-          /* Did we successfully read a directory from file system 2?  If
-           * so, we need to omit an duplicates that should be occluded by
-           * the matching file on file system 1 (if we are enumerating
-           * file system 1).
-           */
-
-          duplicate = false;
-          if (ret >= 0 && udir->fu_ndx == 1 && udir->fu_lower[0] != NULL)
-            {
-              /* Get the relative path to the same file on file system 1.
-               * NOTE: the on any failures we just assume that the filep
-               * is not a duplicate.
-               */
-
-              relpath = unionfs_relpath(udir->fu_relpath, entry->d_name);
-              if (relpath)
-                {
-                  int tmp;
-
-                  /* Check if anything exists at this path on file system 1 */
-
-                  um0 = &ui->ui_fs[0];
-                  tmp = unionfs_trystat(um0->um_node, relpath,
-                                        um0->um_prefix, &buf);
-                  if (tmp >= 0)
-                    {
-                      /* There is something there!
-                       * REVISIT: We could allow files and directories to
-                       * have duplicate names.
-                       */
+      return -ENOSYS;
+    }
 
-                      duplicate = true;
-                    }
+  ret = ops->readdir(um->um_node, udir->fu_lower, entry);
 
-                  /* Free the allocated relpath */
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+  /* Whiteouts are not listed */
 
-                  fs_heap_free(relpath);
-                }
-            }
-        }
-      while (duplicate);
+  while (ret >= 0 && udir->fu_ndx == 0 &&
+         strncmp(entry->d_name, UNIONFS_WHITEOUT,
+                 UNIONFS_WHITEOUT_LEN) == 0)
+    {
+      ret = ops->readdir(um->um_node, udir->fu_lower, entry);
     }
+#endif
 
   return ret;
 }
@@ -1900,33 +2793,25 @@ static int unionfs_rewinddir(FAR struct inode *mountpt,
   DEBUGASSERT(dir);
   udir = (FAR struct unionfs_dir_s *)dir;
 
-  /* Were we currently enumerating on file system 1?  If not, is an
-   * enumeration possible on file system 1?
-   */
-
-  DEBUGASSERT(udir->fu_ndx == 0 || udir->fu_ndx == 1);
-  if (/* udir->fu_ndx != 0 && */ udir->fu_prefix[0] || udir->fu_lower[0] != NULL)
+  if (udir->fu_cdir != NULL)
     {
-      /* Yes.. switch to file system 1 */
+      /* Start over with the first name of the merged directory */
 
-      udir->fu_ndx = 0;
+      udir->fu_next = udir->fu_cdir->uc_head;
+      return OK;
     }
 
-  if (!udir->fu_prefix[udir->fu_ndx])
-    {
-      DEBUGASSERT(udir->fu_lower[udir->fu_ndx] != NULL);
-      um = &ui->ui_fs[udir->fu_ndx];
+  um = &ui->ui_fs[udir->fu_ndx];
 
-      DEBUGASSERT(um != NULL && um->um_node != NULL &&
-                  um->um_node->u.i_mops != NULL);
-      ops = um->um_node->u.i_mops;
+  DEBUGASSERT(um != NULL && um->um_node != NULL &&
+              um->um_node->u.i_mops != NULL);
+  ops = um->um_node->u.i_mops;
 
-      /* Perform the file system rewind operation */
+  /* Perform the file system rewind operation */
 
-      if (ops->rewinddir != NULL)
-        {
-          ret = ops->rewinddir(um->um_node, udir->fu_lower[udir->fu_ndx]);
-        }
+  if (ops->rewinddir != NULL)
+    {
+      ret = ops->rewinddir(um->um_node, udir->fu_lower);
     }
 
   return ret;
@@ -2170,7 +3055,8 @@ static int unionfs_unlink(FAR struct inode *mountpt,
 {
   FAR struct unionfs_inode_s *ui;
   FAR struct unionfs_mountpt_s *um;
-  struct stat buf;
+  uint8_t flags;
+  int ndx;
   int ret;
 
   finfo("relpath: %s\n", relpath);
@@ -2181,45 +3067,66 @@ static int unionfs_unlink(FAR struct inode *mountpt,
               relpath != NULL);
   ui = mountpt->i_private;
 
-  /* Check if some exists at this path on file system 1.  This might be
-   * a file or a directory
-   */
-
-  um  = &ui->ui_fs[0];
-  ret = unionfs_trystat(um->um_node, relpath, um->um_prefix, &buf);
-  if (ret >= 0)
+  ret = nxmutex_lock(&ui->ui_lock);
+  if (ret < 0)
     {
-      /* Yes.. Try to unlink the file on file system 1 (perhaps exposing
-       * a file of the same name on file system 2).  This would fail
-       * with -ENOSYS if file system 1 is a read-only only file system or
-       * -EISDIR if the path is not a file.
-       */
+      return ret;
+    }
 
-      ret = unionfs_tryunlink(um->um_node, relpath, um->um_prefix);
+  /* Find the file that is visible at this path */
+
+  ret = unionfs_lookupstat(ui, relpath, &flags);
+  if (ret < 0)
+    {
+      goto errout_with_lock;
     }
+  else if (!UNIONFS_VISIBLE(flags))
+    {
+      ret = -ENOENT;
+      goto errout_with_lock;
+    }
+  else if (UNIONFS_ISDIR(flags))
+    {
+      ret = -EISDIR;
+      goto errout_with_lock;
+    }
+
+  /* Unlink the file on file system 1 (perhaps exposing a file of the same
+   * name on file system 2) or on file system 2.  This would fail with
+   * -ENOSYS if the file system is a read-only file system.
+   */
 
-  /* There is nothing at this path on file system 1 */
+  ndx = (flags & UNIONFS_NAME_FS1) != 0 ? 0 : 1;
+  um  = &ui->ui_fs[ndx];
 
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+  /* File system 2 is never modified, its files are hidden instead */
+
+  if (ndx == 1)
+    {
+      ret = OK;
+    }
   else
+#endif
     {
-      /* Check if the file exists with name on file system 2.  The only
-       * reason that we check here is so that we can return the more
-       * meaningful -ENOSYS if file system 2 is a read-only file system.
-       */
-
-      um  = &ui->ui_fs[1];
-      ret = unionfs_trystat(um->um_node, relpath, um->um_prefix, &buf);
+      ret = unionfs_tryunlink(um->um_node, relpath, um->um_prefix);
       if (ret >= 0)
         {
-          /* Yes.. Try to unlink the file on file system 1.  This would fail
-           * with -ENOSYS if file system 2 is a read-only only file system or
-           * -EISDIR if the path is not a file.
-           * */
-
-          ret = unionfs_tryunlink(um->um_node, relpath, um->um_prefix);
+          unionfs_cache_update(ui, relpath, 0,
+                               (UNIONFS_NAME_FS1 | UNIONFS_NAME_DIR1) << ndx,
+                               0);
         }
     }
 
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+  if (ret >= 0 && UNIONFS_LOWER(flags))
+    {
+      ret = unionfs_whiteout(ui, relpath);
+    }
+#endif
+
+errout_with_lock:
+  nxmutex_unlock(&ui->ui_lock);
   return ret;
 }
 
@@ -2232,10 +3139,12 @@ static int unionfs_mkdir(FAR struct inode *mountpt, FAR const char *relpath,
 {
   FAR struct unionfs_inode_s *ui;
   FAR struct unionfs_mountpt_s *um;
-  struct stat buf;
-  int ret1;
-  int ret2;
+  uint8_t flags;
   int ret;
+#ifndef CONFIG_FS_UNIONFS_COPYUP
+  int ret1;
+  int i;
+#endif
 
   finfo("relpath: %s\n", relpath);
 
@@ -2245,36 +3154,74 @@ static int unionfs_mkdir(FAR struct inode *mountpt, FAR const char *relpath,
               relpath != NULL);
   ui = mountpt->i_private;
 
+  ret = nxmutex_lock(&ui->ui_lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
   /* Is there anything with this name on either file system? */
 
-  um  = &ui->ui_fs[0];
-  ret = unionfs_trystat(um->um_node, relpath, um->um_prefix, &buf);
-  if (ret >= 0)
+  ret = unionfs_lookupstat(ui, relpath, &flags);
+  if (ret < 0)
+    {
+      goto errout_with_lock;
+    }
+  else if (UNIONFS_VISIBLE(flags))
     {
-      return -EEXIST;
+      ret = -EEXIST;
+      goto errout_with_lock;
     }
 
-  um  = &ui->ui_fs[1];
-  ret = unionfs_trystat(um->um_node, relpath, um->um_prefix, &buf);
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+  /* Create the directory on file system 1 only.  If a directory of the
+   * same name on file system 2 is whited out, it stays hidden.
+   */
+
+  ret = unionfs_copyup_parent(ui, relpath);
   if (ret >= 0)
     {
-      return -EEXIST;
+      um  = &ui->ui_fs[0];
+      ret = unionfs_trymkdir(um->um_node, relpath, um->um_prefix, mode);
     }
 
-  /* Try to create the directory on both file systems. */
+  if (ret >= 0)
+    {
+      unionfs_cache_update(ui, relpath,
+                           UNIONFS_NAME_FS1 | UNIONFS_NAME_DIR1, 0,
+                           DTYPE_DIRECTORY);
+    }
+#else
+  /* Try to create the directory on both file systems.  We will say we
+   * were successful if we were able to create the directory on either
+   * file system.  Perhaps one file system is read-only and the other is
+   * write-able?
+   */
 
-  um  = &ui->ui_fs[0];
-  ret1 = unionfs_trymkdir(um->um_node, relpath, um->um_prefix, mode);
+  ret1 = -ENOENT;
+  for (i = 0; i < 2; i++)
+    {
+      um  = &ui->ui_fs[i];
+      ret = unionfs_trymkdir(um->um_node, relpath, um->um_prefix, mode);
+      if (ret >= 0)
+        {
+          unionfs_cache_update(ui, relpath,
+                               (UNIONFS_NAME_FS1 | UNIONFS_NAME_DIR1) << i,
+                               0, DTYPE_DIRECTORY);
+        }
 
-  um  = &ui->ui_fs[1];
-  ret2 = unionfs_trymkdir(um->um_node, relpath, um->um_prefix, mode);
+      if (i == 0)
+        {
+          ret1 = ret;
+        }
+    }
 
-  /* We will say we were successful if we were able to create the
-   * directory on either file system.  Perhaps one file system is
-   * read-only and the other is write-able?
-   */
+  ret = (ret1 >= 0 || ret >= 0) ? OK : ret1;
+#endif
 
-  return (ret1 >= 0 || ret2 >= 0) ? OK : ret1;
+errout_with_lock:
+  nxmutex_unlock(&ui->ui_lock);
+  return ret;
 }
 
 /****************************************************************************
@@ -2285,8 +3232,16 @@ static int unionfs_rmdir(FAR struct inode *mountpt, FAR const char *relpath)
 {
   FAR struct unionfs_inode_s *ui;
   FAR struct unionfs_mountpt_s *um;
-  int ret = -ENOENT;
-  int tmp;
+  size_t namelen;
+  size_t dirlen;
+  uint8_t flags;
+  int ret;
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+  FAR struct unionfs_cdir_s *cdir;
+  FAR struct unionfs_name_s *un;
+  FAR char *path;
+  uint8_t layers;
+#endif
 
   finfo("relpath: %s\n", relpath);
 
@@ -2296,46 +3251,118 @@ static int unionfs_rmdir(FAR struct inode *mountpt, FAR const char *relpath)
               relpath != NULL);
   ui = mountpt->i_private;
 
-  /* We really don't know any better so we will try to remove the directory
-   * from both file systems.
+  ret = nxmutex_lock(&ui->ui_lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = unionfs_lookupstat(ui, relpath, &flags);
+  if (ret < 0)
+    {
+      goto errout_with_lock;
+    }
+  else if (!UNIONFS_VISIBLE(flags))
+    {
+      ret = -ENOENT;
+      goto errout_with_lock;
+    }
+  else if (!UNIONFS_ISDIR(flags))
+    {
+      ret = -ENOTDIR;
+      goto errout_with_lock;
+    }
+
+  unionfs_basename(relpath, &dirlen, &namelen);
+
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+  /* The directory must look empty in the union.  File system 2 is never
+   * modified, so what remains on file system 1 are whiteouts, which are
+   * removed, and the directory of file system 2 is whited out.
    */
 
-  /* Is there a directory with this name on file system 1 */
+  layers = UNIONFS_ISMERGED(flags) ?
+           UNIONFS_NAME_FS1 | UNIONFS_NAME_FS2 :
+           (flags & UNIONFS_NAME_FS1) != 0 ?
+           UNIONFS_NAME_FS1 : UNIONFS_NAME_FS2;
 
-  um   = &ui->ui_fs[0];
-  tmp = unionfs_trystatdir(um->um_node, relpath, um->um_prefix);
-  if (tmp >= 0)
+  ret = unionfs_cache_build(ui, relpath, unionfs_pathlen(relpath), layers,
+                            &cdir);
+  if (ret < 0)
     {
-      /* Yes.. remove it.  Since we know that the directory exists, any
-       * failure to remove it is a showstopper.
-       */
+      goto errout_with_lock;
+    }
 
-      ret = unionfs_tryrmdir(um->um_node, relpath, um->um_prefix);
-      if (ret < 0)
+  for (un = cdir->uc_head; un != NULL; un = un->un_flink)
+    {
+      if (UNIONFS_VISIBLE(un->un_flags) && strcmp(un->un_name, ".") != 0 &&
+          strcmp(un->un_name, "..") != 0)
         {
-          return ret;
+          ret = -ENOTEMPTY;
+          break;
         }
     }
 
-  /* Either the directory does not exist on file system 1, or we
-   * successfully removed it.  Try again on file system 2.
-   */
+  um = &ui->ui_fs[0];
+  if (ret >= 0 && (flags & UNIONFS_NAME_FS1) != 0)
+    {
+      for (un = cdir->uc_head; un != NULL && ret >= 0; un = un->un_flink)
+        {
+          if ((un->un_flags & UNIONFS_NAME_WHITEOUT) != 0)
+            {
+              path = unionfs_whpath(relpath, unionfs_pathlen(relpath),
+                                    un->un_name, strlen(un->un_name));
+              if (path == NULL)
+                {
+                  ret = -ENOMEM;
+                  break;
+                }
+
+              ret = unionfs_tryunlink(um->um_node, path, um->um_prefix);
+              fs_heap_free(path);
+            }
+        }
+
+      if (ret >= 0)
+        {
+          ret = unionfs_tryrmdir(um->um_node, relpath, um->um_prefix);
+        }
+    }
 
-  um   = &ui->ui_fs[1];
-  tmp = unionfs_trystatdir(um->um_node, relpath, um->um_prefix);
-  if (tmp >= 0)
+  unionfs_cache_release(cdir);
+  unionfs_cache_drop(ui, relpath, dirlen);
+
+  if (ret >= 0 && UNIONFS_LOWER(flags))
     {
-      /* Yes.. remove it.  Since we know that the directory exists, any
-       * failure to remove it is a showstopper.
-       */
+      ret = unionfs_whiteout(ui, relpath);
+    }
+#else
+  /* Remove the directory from file system 1 if it is there, and from file
+   * system 2 if it is visible or merged with the one on file system 1.
+   */
 
+  if ((flags & UNIONFS_NAME_FS1) != 0)
+    {
+      um  = &ui->ui_fs[0];
       ret = unionfs_tryrmdir(um->um_node, relpath, um->um_prefix);
+    }
 
-      /* REVISIT:  Should we try to restore the directory on file system 1
-       * if we failure to removed the directory on file system 2?
-       */
+  /* REVISIT:  Should we try to restore the directory on file system 1
+   * if we failure to removed the directory on file system 2?
+   */
+
+  if (ret >= 0 && (UNIONFS_ISMERGED(flags) ||
+                   (flags & UNIONFS_NAME_FS1) == 0))
+    {
+      um  = &ui->ui_fs[1];
+      ret = unionfs_tryrmdir(um->um_node, relpath, um->um_prefix);
     }
 
+  unionfs_cache_drop(ui, relpath, dirlen);
+#endif
+
+errout_with_lock:
+  nxmutex_unlock(&ui->ui_lock);
   return ret;
 }
 
@@ -2349,8 +3376,13 @@ static int unionfs_rename(FAR struct inode *mountpt,
 {
   FAR struct unionfs_inode_s *ui;
   FAR struct unionfs_mountpt_s *um;
-  int ret = -ENOENT;
-  int tmp;
+  uint8_t oldflags;
+  uint8_t newflags;
+  size_t namelen;
+  size_t olddir;
+  size_t newdir;
+  int ndx;
+  int ret;
 
   finfo("oldrelpath: %s newrelpath: %s\n", oldrelpath, newrelpath);
 
@@ -2359,49 +3391,96 @@ static int unionfs_rename(FAR struct inode *mountpt,
   DEBUGASSERT(mountpt != NULL && mountpt->i_private != NULL);
   ui = mountpt->i_private;
 
-  DEBUGASSERT(oldrelpath != NULL && oldrelpath != NULL);
+  DEBUGASSERT(oldrelpath != NULL && newrelpath != NULL);
 
-  /* Is there a file with this name on file system 1 */
-
-  um   = &ui->ui_fs[0];
-  tmp = unionfs_trystatfile(um->um_node, oldrelpath, um->um_prefix);
-  if (tmp >= 0)
+  ret = nxmutex_lock(&ui->ui_lock);
+  if (ret < 0)
     {
-      /* Yes.. rename it.  Since we know that the directory exists, any
-       * failure to remove it is a showstopper.
-       */
+      return ret;
+    }
 
-      ret = unionfs_tryrename(um->um_node, oldrelpath, newrelpath,
-                              um->um_prefix);
-      if (ret >= 0)
-        {
-          /* Return immediately on success.  In the event that the file
-           * exists in both file systems, this will produce the odd behavior
-           * that one file on file system 1 was renamed but another obscured
-           * file of the same relative path will become visible.
-           */
+  ret = unionfs_lookupstat(ui, oldrelpath, &oldflags);
+  if (ret >= 0)
+    {
+      ret = unionfs_lookupstat(ui, newrelpath, &newflags);
+    }
 
-          return OK;
-        }
+  if (ret < 0)
+    {
+      goto errout_with_lock;
+    }
+  else if (!UNIONFS_VISIBLE(oldflags))
+    {
+      ret = -ENOENT;
+      goto errout_with_lock;
     }
+  else if (UNIONFS_VISIBLE(newflags) &&
+           UNIONFS_ISDIR(oldflags) != UNIONFS_ISDIR(newflags))
+    {
+      ret = UNIONFS_ISDIR(oldflags) ? -ENOTDIR : -EISDIR;
+      goto errout_with_lock;
+    }
+
+  ndx = (oldflags & UNIONFS_NAME_FS1) != 0 ? 0 : 1;
 
-  /* Either the file does not exist on file system 1, or we failed to rename
-   * it (perhaps because the file system was read-only).  Try again on file
-   * system 2.
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+  /* A directory that is on file system 2, or that would be merged with a
+   * directory there, cannot be renamed on file system 1 alone.
    */
 
-  um   = &ui->ui_fs[1];
-  tmp = unionfs_trystatfile(um->um_node, oldrelpath, um->um_prefix);
-  if (tmp >= 0)
+  if (UNIONFS_ISDIR(oldflags) &&
+      (UNIONFS_LOWER(oldflags) || UNIONFS_LOWER(newflags)))
     {
-      /* Yes.. remove it.  Since we know that the directory exists, any
-       * failure to remove it is a showstopper.
-       */
+      ret = -EXDEV;
+      goto errout_with_lock;
+    }
+
+  /* A file on file system 2 is renamed as a copy on file system 1 */
+
+  if (ndx == 1)
+    {
+      ret = unionfs_copyup(ui, oldrelpath, true);
+      ndx = 0;
+    }
+
+  if (ret >= 0)
+    {
+      ret = unionfs_copyup_parent(ui, newrelpath);
+    }
+
+  if (ret < 0)
+    {
+      goto errout_with_lock;
+    }
+#endif
+
+  /* Rename the file on the file system that holds it.  There is no logic
+   * to move a file to the other file system, so the new name must be
+   * within the same file system.
+   */
+
+  um  = &ui->ui_fs[ndx];
+  ret = unionfs_tryrename(um->um_node, oldrelpath, newrelpath,
+                          um->um_prefix);
 
-      ret = unionfs_tryrename(um->um_node, oldrelpath, newrelpath,
-                              um->um_prefix);
+  /* The directories of both names have changed */
+
+  unionfs_basename(oldrelpath, &olddir, &namelen);
+  unionfs_basename(newrelpath, &newdir, &namelen);
+  unionfs_cache_drop(ui, oldrelpath, olddir);
+  unionfs_cache_drop(ui, newrelpath, newdir);
+
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+  /* Do not expose a file of the old name on file system 2 */
+
+  if (ret >= 0 && UNIONFS_LOWER(oldflags))
+    {
+      ret = unionfs_whiteout(ui, oldrelpath);
     }
+#endif
 
+errout_with_lock:
+  nxmutex_unlock(&ui->ui_lock);
   return ret;
 }
 
@@ -2414,6 +3493,7 @@ static int unionfs_stat(FAR struct inode *mountpt, FAR const char *relpath,
 {
   FAR struct unionfs_inode_s *ui;
   FAR struct unionfs_mountpt_s *um;
+  uint8_t flags;
   int ret;
 
   finfo("relpath: %s\n", relpath);
@@ -2424,29 +3504,39 @@ static int unionfs_stat(FAR struct inode *mountpt, FAR const char *relpath,
               relpath != NULL);
   ui = mountpt->i_private;
 
-  /* stat this path on file system 1 */
+  ret = nxmutex_lock(&ui->ui_lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* stat this path on the file system that holds it.  The first instance
+   * of the file shadows the second one.
+   */
 
-  um  = &ui->ui_fs[0];
-  ret = unionfs_trystat(um->um_node, relpath, um->um_prefix, buf);
+  ret = unionfs_lookup(ui, relpath, &flags);
   if (ret >= 0)
     {
-      /* Return on the first success.  The first instance of the file will
-       * shadow the second anyway.
-       */
+      ret = -ENOENT;
+      if ((flags & UNIONFS_NAME_FS1) != 0)
+        {
+          um  = &ui->ui_fs[0];
+          ret = unionfs_trystat(um->um_node, relpath, um->um_prefix, buf);
+        }
 
-      return OK;
+      if (ret < 0 && (UNIONFS_ISMERGED(flags) ||
+                      ((flags & UNIONFS_NAME_FS1) == 0 &&
+                       UNIONFS_LOWER(flags))))
+        {
+          um  = &ui->ui_fs[1];
+          ret = unionfs_trystat(um->um_node, relpath, um->um_prefix, buf);
+        }
     }
 
-  /* stat failed on the file system 1.  Try again on file system 2. */
+  nxmutex_unlock(&ui->ui_lock);
 
-  um  = &ui->ui_fs[1];
-  ret = unionfs_trystat(um->um_node, relpath, um->um_prefix, buf);
   if (ret >= 0)
     {
-      /* Return on the first success.  The first instance of the file will
-       * shadow the second anyway.
-       */
-
       return OK;
     }
 
@@ -2491,6 +3581,8 @@ static int unionfs_chstat(FAR struct inode *mountpt, FAR const char *relpath,
 {
   FAR struct unionfs_inode_s *ui;
   FAR struct unionfs_mountpt_s *um;
+  uint8_t layers;
+  int ndx;
   int ret;
 
   finfo("relpath: %s\n", relpath);
@@ -2501,28 +3593,56 @@ static int unionfs_chstat(FAR struct inode *mountpt, FAR const char *relpath,
               relpath != NULL);
   ui = mountpt->i_private;
 
-  /* chstat this path on file system 1 */
-
-  um  = &ui->ui_fs[0];
-  ret = unionfs_trychstat(um->um_node, relpath, um->um_prefix, buf, flags);
-  if (ret >= 0)
+  ret = nxmutex_lock(&ui->ui_lock);
+  if (ret < 0)
     {
-      /* Return on the first success.  The first instance of the file will
-       * shadow the second anyway.
-       */
+      return ret;
+    }
 
-      return OK;
+  ret = unionfs_lookup(ui, relpath, &layers);
+  if (ret < 0)
+    {
+      goto errout_with_lock;
+    }
+  else if (!UNIONFS_VISIBLE(layers))
+    {
+      ret = -ENOENT;
+      goto errout_with_lock;
     }
 
-  /* chstat failed on the file system 1.  Try again on file system 2. */
+  /* chstat this path on the file system that holds it */
+
+  ndx = (layers & UNIONFS_NAME_FS1) != 0 ? 0 : 1;
+
+#ifdef CONFIG_FS_UNIONFS_COPYUP
+  /* A file on file system 2 is changed as a copy on file system 1 */
 
-  um  = &ui->ui_fs[1];
+  if (ndx == 1)
+    {
+      ret = unionfs_copyup(ui, relpath, true);
+      if (ret < 0)
+        {
+          goto errout_with_lock;
+        }
+
+      ndx = 0;
+    }
+#endif
+
+  um  = &ui->ui_fs[ndx];
   ret = unionfs_trychstat(um->um_node, relpath, um->um_prefix, buf, flags);
-  if (ret >= 0)
+
+  /* A merged directory may be changed on file system 2 only */
+
+  if (ret < 0 && UNIONFS_ISMERGED(layers))
     {
-      return OK;
+      um  = &ui->ui_fs[1];
+      ret = unionfs_trychstat(um->um_node, relpath, um->um_prefix, buf,
+                              flags);
     }
 
+errout_with_lock:
+  nxmutex_unlock(&ui->ui_lock);
   return ret;
 }
 
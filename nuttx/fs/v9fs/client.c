@@ -27,10 +27,12 @@
 #include <sys/param.h>
 #include <fcntl.h>
 
+#include <nuttx/crc32.h>
 #include <nuttx/semaphore.h>
 #include <nuttx/kmalloc.h>
 #include <nuttx/fs/fs.h>
 #include <nuttx/lib/lib.h>
+#include <nuttx/lib/math32.h>
 
 #include "client.h"
 #include "fs_heap.h"
@@ -103,6 +105,10 @@
 
 #define V9FS_QIDSZ             (V9FS_BIT8SZ + V9FS_BIT32SZ + V9FS_BIT64SZ)
 
+#if CONFIG_V9FS_ATTRCACHE > 0
+#  define V9FS_CACHE_TICKS     MSEC2TICK(CONFIG_V9FS_ATTRCACHE_TIMEOUT)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -374,6 +380,17 @@ struct v9fs_fid_s
   char relpath[1];
 };
 
+/* One Tread or Twrite of a pipelined read or write */
+
+struct v9fs_io_s
+{
+  struct v9fs_payload_s payload;
+  struct v9fs_write_s   request;
+  struct v9fs_rwrite_s  response;
+  struct iovec          wiov[2];
+  struct iovec          riov[2];
+};
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -537,6 +554,51 @@ static void v9fs_fid_destroy(FAR struct v9fs_client_s *client,
   fs_heap_free(fidp);
 }
 
+/****************************************************************************
+ * v9fs_client_start
+ *
+ * Description:
+ *   Send a request without waiting for its reply.  On success the payload
+ *   must be passed to v9fs_client_wait() before its buffers are reused.
+ *
+ ****************************************************************************/
+
+static int v9fs_client_start(FAR struct v9fs_transport_s *transport,
+                             FAR struct v9fs_payload_s *payload,
+                             FAR struct iovec *wiov, size_t wcount,
+                             FAR struct iovec *riov, size_t rcount,
+                             uint16_t tag)
+{
+  int ret;
+
+  nxsem_init(&payload->resp, 0, 0);
+  payload->wiov = wiov;
+  payload->riov = riov;
+  payload->wcount = wcount;
+  payload->rcount = rcount;
+  payload->tag = tag;
+  payload->ret = -EIO;
+
+  ret = v9fs_transport_request(transport, payload);
+  if (ret < 0)
+    {
+      nxsem_destroy(&payload->resp);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * v9fs_client_wait
+ ****************************************************************************/
+
+static int v9fs_client_wait(FAR struct v9fs_payload_s *payload)
+{
+  nxsem_wait_uninterruptible(&payload->resp);
+  nxsem_destroy(&payload->resp);
+  return payload->ret;
+}
+
 /****************************************************************************
  * v9fs_client_rpc
  ****************************************************************************/
@@ -549,25 +611,164 @@ static int v9fs_client_rpc(FAR struct v9fs_transport_s *transport,
   struct v9fs_payload_s payload;
   int ret;
 
-  nxsem_init(&payload.resp, 0, 0);
-  payload.wiov = wiov;
-  payload.riov = riov;
-  payload.wcount = wcount;
-  payload.rcount = rcount;
-  payload.tag = tag;
-  payload.ret = -EIO;
-
-  ret = v9fs_transport_request(transport, &payload);
+  ret = v9fs_client_start(transport, &payload, wiov, wcount,
+                          riov, rcount, tag);
   if (ret < 0)
     {
-      nxsem_destroy(&payload.resp);
       return ret;
     }
 
-  nxsem_wait(&payload.resp);
-  nxsem_destroy(&payload.resp);
+  return v9fs_client_wait(&payload);
+}
+
+/****************************************************************************
+ * v9fs_client_io
+ *
+ * Description:
+ *   Read or write buflen bytes at offset with up to
+ *   CONFIG_V9FS_PIPELINE_DEPTH Tread or Twrite requests of at most iounit
+ *   bytes in flight.  The replies are consumed in order, so the transfer
+ *   stops at the first error or short count, as a sequential loop would.
+ *
+ ****************************************************************************/
+
+static ssize_t v9fs_client_io(FAR struct v9fs_client_s *client,
+                              uint32_t fid, uint8_t type,
+                              FAR uint8_t *buffer, off_t offset,
+                              size_t buflen)
+{
+  FAR struct v9fs_fid_s *fidp;
+  FAR struct v9fs_io_s *ios;
+  FAR struct v9fs_io_s *io;
+  struct v9fs_io_s single;
+  size_t depth = 1;
+  size_t inflight = 0;
+  size_t head = 0;
+  size_t sent = 0;
+  size_t done = 0;
+  bool broken = false;
+  bool stop = false;
+  int ret = 0;
+  int err;
+
+  /* size[4] Tread tag[2] fid[4] offset[8] count[4]
+   * size[4] Rread tag[2] count[4] data[count]
+   * size[4] Twrite tag[2] fid[4] offset[8] count[4] data[count]
+   * size[4] Rwrite tag[2] count[4]
+   */
+
+  fidp = idr_find(client->fids, fid);
+  if (fidp == NULL)
+    {
+      return -ENOENT;
+    }
+
+  ios = &single;
+#if CONFIG_V9FS_PIPELINE_DEPTH > 1
+  depth = MIN(CONFIG_V9FS_PIPELINE_DEPTH,
+              div_round_up(buflen, fidp->iounit));
+  if (depth > 1)
+    {
+      ios = fs_heap_malloc(depth * sizeof(struct v9fs_io_s));
+      if (ios == NULL)
+        {
+          /* Fall back to one request at a time */
+
+          ios = &single;
+          depth = 1;
+        }
+    }
+#endif
+
+  for (; ; )
+    {
+      /* Keep the window full */
+
+      while (!stop && inflight < depth && sent < buflen)
+        {
+          io = &ios[(head + inflight) % depth];
+          io->request.count = MIN(buflen - sent, fidp->iounit);
+          io->request.header.size = V9FS_HDRSZ + V9FS_BIT32SZ +
+                                    V9FS_BIT64SZ + V9FS_BIT32SZ;
+          io->request.header.type = type;
+          io->request.header.tag = v9fs_get_tagid(client);
+          io->request.fid = fid;
+          io->request.offset = offset + sent;
+
+          io->wiov[0].iov_base = &io->request;
+          io->wiov[0].iov_len = V9FS_HDRSZ + V9FS_BIT32SZ + V9FS_BIT64SZ +
+                                V9FS_BIT32SZ;
+          io->riov[0].iov_base = &io->response;
+          io->riov[0].iov_len = V9FS_HDRSZ + V9FS_BIT32SZ;
+
+          if (type == V9FS_TWRITE)
+            {
+              io->request.header.size += io->request.count;
+              io->wiov[1].iov_base = buffer + sent;
+              io->wiov[1].iov_len = io->request.count;
+              ret = v9fs_client_start(client->transport, &io->payload,
+                                      io->wiov, 2, io->riov, 1,
+                                      io->request.header.tag);
+            }
+          else
+            {
+              io->riov[1].iov_base = buffer + sent;
+              io->riov[1].iov_len = io->request.count;
+              ret = v9fs_client_start(client->transport, &io->payload,
+                                      io->wiov, 1, io->riov, 2,
+                                      io->request.header.tag);
+            }
+
+          if (ret < 0)
+            {
+              stop = true;
+              break;
+            }
+
+          sent += io->request.count;
+          inflight++;
+        }
+
+      if (inflight == 0)
+        {
+          break;
+        }
+
+      /* Consume the oldest reply, the ones after a failed or short one
+       * are only waited for.
+       */
+
+      io = &ios[head];
+      head = (head + 1) % depth;
+      inflight--;
+
+      err = v9fs_client_wait(&io->payload);
+      if (broken)
+        {
+          continue;
+        }
+
+      if (err < 0)
+        {
+          ret = err;
+          stop = broken = true;
+        }
+      else
+        {
+          done += MIN(io->response.count, io->request.count);
+          if (io->response.count < io->request.count)
+            {
+              stop = broken = true;
+            }
+        }
+    }
+
+  if (ios != &single)
+    {
+      fs_heap_free(ios);
+    }
 
-  return payload.ret;
+  return done ? done : ret;
 }
 
 /****************************************************************************
@@ -724,6 +925,69 @@ static int v9fs_client_version(FAR struct v9fs_client_s *client)
   return 0;
 }
 
+#if CONFIG_V9FS_ATTRCACHE > 0
+
+/****************************************************************************
+ * v9fs_cache_len
+ ****************************************************************************/
+
+static size_t v9fs_cache_len(FAR const char *path)
+{
+  size_t len = strlen(path);
+
+  /* "dir" and "dir/" name the same entry */
+
+  while (len > 0 && path[len - 1] == '/')
+    {
+      len--;
+    }
+
+  return len;
+}
+
+/****************************************************************************
+ * v9fs_cache_find
+ *
+ * Description:
+ *   Find the entry of the first len bytes of path, client->lock must be
+ *   held.
+ *
+ ****************************************************************************/
+
+static FAR struct v9fs_cache_s *
+v9fs_cache_find(FAR struct v9fs_client_s *client, FAR const char *path,
+                size_t len)
+{
+  FAR struct v9fs_cache_s *entry;
+  uint32_t hash;
+  int i;
+
+  hash = crc32((FAR const uint8_t *)path, len);
+  for (i = 0; i < CONFIG_V9FS_ATTRCACHE; i++)
+    {
+      entry = &client->cache[i];
+      if (entry->path != NULL && entry->hash == hash &&
+          strncmp(entry->path, path, len) == 0 && entry->path[len] == '\0')
+        {
+          return entry;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * v9fs_cache_free
+ ****************************************************************************/
+
+static void v9fs_cache_free(FAR struct v9fs_cache_s *entry)
+{
+  fs_heap_free(entry->path);
+  entry->path = NULL;
+}
+
+#endif /* CONFIG_V9FS_ATTRCACHE > 0 */
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -902,61 +1166,7 @@ int v9fs_client_chstat(FAR struct v9fs_client_s *client, uint32_t fid,
 ssize_t v9fs_client_read(FAR struct v9fs_client_s *client, uint32_t fid,
                          FAR void *buffer, off_t offset, size_t buflen)
 {
-  FAR struct v9fs_fid_s *fidp;
-  struct v9fs_read_s request;
-  struct v9fs_rread_s response;
-  struct iovec wiov[1];
-  struct iovec riov[2];
-  size_t nread = 0;
-  int ret = 0;
-
-  /* size[4] Tread tag[2] fid[4] offset[8] count[4]
-   * size[4] Rread tag[2] count[4] data[count]
-   */
-
-  fidp = idr_find(client->fids, fid);
-  if (fidp == NULL)
-    {
-      return -ENOENT;
-    }
-
-  while (buflen > 0)
-    {
-      request.header.size = V9FS_HDRSZ + V9FS_BIT32SZ + V9FS_BIT64SZ +
-                            V9FS_BIT32SZ;
-      request.header.type = V9FS_TREAD;
-      request.header.tag = v9fs_get_tagid(client);
-      request.fid = fid;
-      request.offset = offset;
-      request.count = buflen > fidp->iounit ? fidp->iounit : buflen;
-
-      wiov[0].iov_base = &request;
-      wiov[0].iov_len = V9FS_HDRSZ + V9FS_BIT32SZ + V9FS_BIT64SZ +
-                        V9FS_BIT32SZ;
-      riov[0].iov_base = &response;
-      riov[0].iov_len = V9FS_HDRSZ + V9FS_BIT32SZ;
-      riov[1].iov_base = (FAR void *)buffer;
-      riov[1].iov_len = request.count;
-
-      ret = v9fs_client_rpc(client->transport, wiov, 1, riov, 2,
-                            request.header.tag);
-      if (ret < 0)
-        {
-          break;
-        }
-
-      if (response.count == 0)
-        {
-          break;
-        }
-
-      nread += response.count;
-      offset += response.count;
-      buffer += response.count;
-      buflen -= response.count;
-    }
-
-  return nread ? nread : ret;
+  return v9fs_client_io(client, fid, V9FS_TREAD, buffer, offset, buflen);
 }
 
 /****************************************************************************
@@ -1078,56 +1288,8 @@ ssize_t v9fs_client_write(FAR struct v9fs_client_s *client, uint32_t fid,
                           FAR const void *buffer, off_t offset,
                           size_t buflen)
 {
-  FAR struct v9fs_fid_s *fidp;
-  struct v9fs_write_s request;
-  struct v9fs_rwrite_s response;
-  struct iovec wiov[2];
-  struct iovec riov[1];
-  size_t nwrite = 0;
-  int ret = 0;
-
-  /* size[4] Twrite tag[2] fid[4] offset[8] count[4] data[count]
-   * size[4] Rwrite tag[2] count[4]
-   */
-
-  fidp = idr_find(client->fids, fid);
-  if (fidp == NULL)
-    {
-      return -ENOENT;
-    }
-
-  while (buflen > 0)
-    {
-      request.count = buflen > fidp->iounit ? fidp->iounit : buflen;
-      request.header.size = V9FS_HDRSZ + V9FS_BIT32SZ + V9FS_BIT64SZ +
-                            V9FS_BIT32SZ + request.count;
-      request.header.type = V9FS_TWRITE;
-      request.header.tag = v9fs_get_tagid(client);
-      request.fid = fid;
-      request.offset = offset;
-
-      wiov[0].iov_base = &request;
-      wiov[0].iov_len = V9FS_HDRSZ + V9FS_BIT32SZ + V9FS_BIT64SZ +
-                        V9FS_BIT32SZ;
-      wiov[1].iov_base = (FAR void *)buffer;
-      wiov[1].iov_len = request.count;
-      riov[0].iov_base = &response;
-      riov[0].iov_len = V9FS_HDRSZ + V9FS_BIT32SZ;
-
-      ret = v9fs_client_rpc(client->transport, wiov, 2, riov, 1,
-                            request.header.tag);
-      if (ret < 0)
-        {
-          break;
-        }
-
-      nwrite += response.count;
-      offset += response.count;
-      buffer += response.count;
-      buflen -= response.count;
-    }
-
-  return nwrite ? nwrite : ret;
+  return v9fs_client_io(client, fid, V9FS_TWRITE, (FAR uint8_t *)buffer,
+                        offset, buflen);
 }
 
 /****************************************************************************
@@ -1597,6 +1759,9 @@ int v9fs_client_walk(FAR struct v9fs_client_s *client, FAR const char *path,
 
   if (response.nwqid != nwname)
     {
+      /* The server did not create newfid for a partial walk */
+
+      v9fs_fid_destroy(client, newfid);
       ret = -ENOENT;
     }
 
@@ -1730,6 +1895,9 @@ int v9fs_client_uninit(FAR struct v9fs_client_s *client)
     }
 
   v9fs_transport_destroy(client->transport);
+#if CONFIG_V9FS_ATTRCACHE > 0
+  v9fs_client_cache_invalidate(client, NULL);
+#endif
   nxmutex_destroy(&client->lock);
   idr_destroy(client->fids);
   return 0;
@@ -1748,7 +1916,7 @@ void v9fs_transport_done(FAR struct v9fs_payload_s *cookie, int ret)
    * it means that payload[1] is ecode.
    */
 
-  if (error->header.type == V9FS_RLERROR)
+  if (ret >= 0 && error->header.type == V9FS_RLERROR)
     {
       /* Therefore, we assign the error code to the ecode of the cookie
        * and check it in the next process
@@ -1764,6 +1932,174 @@ void v9fs_transport_done(FAR struct v9fs_payload_s *cookie, int ret)
   nxsem_post(&cookie->resp);
 }
 
+#if CONFIG_V9FS_ATTRCACHE > 0
+
+/****************************************************************************
+ * v9fs_client_cache_lookup
+ *
+ * Description:
+ *   Look up the cached stat() result of a path.  Returns true and sets
+ *   *result to OK or -ENOENT on a hit.
+ *
+ ****************************************************************************/
+
+bool v9fs_client_cache_lookup(FAR struct v9fs_client_s *client,
+                              FAR const char *path, FAR struct stat *buf,
+                              FAR int *result)
+{
+  FAR struct v9fs_cache_s *entry;
+  bool hit = false;
+
+  nxmutex_lock(&client->lock);
+  entry = v9fs_cache_find(client, path, v9fs_cache_len(path));
+  if (entry != NULL)
+    {
+      if (clock_systime_ticks() - entry->time >= V9FS_CACHE_TICKS)
+        {
+          v9fs_cache_free(entry);
+        }
+      else
+        {
+          if (buf != NULL)
+            {
+              *buf = entry->buf;
+            }
+
+          *result = entry->result;
+          hit = true;
+        }
+    }
+
+  nxmutex_unlock(&client->lock);
+  return hit;
+}
+
+/****************************************************************************
+ * v9fs_client_cache_gen
+ *
+ * Description:
+ *   Return the invalidation generation, to be passed to
+ *   v9fs_client_cache_enter() with the result of a lookup started after
+ *   this call.
+ *
+ ****************************************************************************/
+
+uint32_t v9fs_client_cache_gen(FAR struct v9fs_client_s *client)
+{
+  uint32_t gen;
+
+  nxmutex_lock(&client->lock);
+  gen = client->cache_gen;
+  nxmutex_unlock(&client->lock);
+  return gen;
+}
+
+/****************************************************************************
+ * v9fs_client_cache_enter
+ *
+ * Description:
+ *   Cache a stat() result.  Only OK and -ENOENT are cached, and nothing is
+ *   cached if an invalidation happened since gen was read, the result may
+ *   predate it.
+ *
+ ****************************************************************************/
+
+void v9fs_client_cache_enter(FAR struct v9fs_client_s *client,
+                             FAR const char *path,
+                             FAR const struct stat *buf, int result,
+                             uint32_t gen)
+{
+  FAR struct v9fs_cache_s *entry;
+  size_t len = v9fs_cache_len(path);
+
+  if (result != OK && result != -ENOENT)
+    {
+      return;
+    }
+
+  nxmutex_lock(&client->lock);
+  if (gen != client->cache_gen)
+    {
+      nxmutex_unlock(&client->lock);
+      return;
+    }
+
+  entry = v9fs_cache_find(client, path, len);
+  if (entry == NULL)
+    {
+      entry = &client->cache[client->cache_next];
+      client->cache_next = (client->cache_next + 1) %
+                           CONFIG_V9FS_ATTRCACHE;
+      v9fs_cache_free(entry);
+
+      entry->hash = crc32((FAR const uint8_t *)path, len);
+      entry->path = fs_heap_strndup(path, len);
+      if (entry->path == NULL)
+        {
+          nxmutex_unlock(&client->lock);
+          return;
+        }
+    }
+
+  if (result == OK)
+    {
+      entry->buf = *buf;
+    }
+
+  entry->result = result;
+  entry->time = clock_systime_ticks();
+  nxmutex_unlock(&client->lock);
+}
+
+/****************************************************************************
+ * v9fs_client_cache_invalidate
+ *
+ * Description:
+ *   Drop the entries of a path and of its parent directory, whose times
+ *   change with it.  A NULL path drops all the entries.
+ *
+ ****************************************************************************/
+
+void v9fs_client_cache_invalidate(FAR struct v9fs_client_s *client,
+                                  FAR const char *path)
+{
+  FAR struct v9fs_cache_s *entry;
+  FAR const char *slash;
+  size_t len;
+  int i;
+
+  nxmutex_lock(&client->lock);
+  client->cache_gen++;
+  if (path == NULL)
+    {
+      for (i = 0; i < CONFIG_V9FS_ATTRCACHE; i++)
+        {
+          v9fs_cache_free(&client->cache[i]);
+        }
+
+      nxmutex_unlock(&client->lock);
+      return;
+    }
+
+  len = v9fs_cache_len(path);
+  entry = v9fs_cache_find(client, path, len);
+  if (entry != NULL)
+    {
+      v9fs_cache_free(entry);
+    }
+
+  slash = memrchr(path, '/', len);
+  entry = v9fs_cache_find(client, path, slash != NULL ? slash - path : 0);
+  if (entry != NULL)
+    {
+      v9fs_cache_free(entry);
+    }
+
+  nxmutex_unlock(&client->lock);
+}
+
+#endif /* CONFIG_V9FS_ATTRCACHE > 0 */
+
 /****************************************************************************
  * v9fs_fid_put
  ****************************************************************************/
@@ -27,6 +27,7 @@
  * Included Files
  ****************************************************************************/
 
+#include <nuttx/clock.h>
 #include <nuttx/idr.h>
 #include <nuttx/list.h>
 #include <nuttx/mutex.h>
@@ -70,6 +71,17 @@ struct v9fs_transport_ops_s
   CODE void (*destroy)(FAR struct v9fs_transport_s *transport);
 };
 
+#if CONFIG_V9FS_ATTRCACHE > 0
+struct v9fs_cache_s
+{
+  FAR char   *path;   /* Path relative to the mount, NULL if unused */
+  uint32_t    hash;   /* crc32 of the path */
+  int         result; /* OK or -ENOENT */
+  clock_t     time;   /* When the entry was filled */
+  struct stat buf;    /* The attributes if result is OK */
+};
+#endif
+
 struct v9fs_client_s
 {
   FAR struct v9fs_transport_s *transport;
@@ -78,6 +90,11 @@ struct v9fs_client_s
   uint32_t                     root_fid;
   uint32_t                     tag_id;
   mutex_t                      lock;
+#if CONFIG_V9FS_ATTRCACHE > 0
+  uint32_t                     cache_gen;  /* Bumped on every invalidation */
+  int                          cache_next; /* Next entry to replace */
+  struct v9fs_cache_s          cache[CONFIG_V9FS_ATTRCACHE];
+#endif
 };
 
 /****************************************************************************
@@ -125,6 +142,18 @@ int v9fs_transport_request(FAR struct v9fs_transport_s *transport,
                            FAR struct v9fs_payload_s *payload);
 void v9fs_transport_destroy(FAR struct v9fs_transport_s *transport);
 void v9fs_transport_done(FAR struct v9fs_payload_s *cookie, int ret);
+#if CONFIG_V9FS_ATTRCACHE > 0
+bool v9fs_client_cache_lookup(FAR struct v9fs_client_s *client,
+                              FAR const char *path, FAR struct stat *buf,
+                              FAR int *result);
+uint32_t v9fs_client_cache_gen(FAR struct v9fs_client_s *client);
+void v9fs_client_cache_enter(FAR struct v9fs_client_s *client,
+                             FAR const char *path,
+                             FAR const struct stat *buf, int result,
+                             uint32_t gen);
+void v9fs_client_cache_invalidate(FAR struct v9fs_client_s *client,
+                                  FAR const char *path);
+#endif
 int v9fs_fid_put(FAR struct v9fs_client_s *client, uint32_t fid);
 int v9fs_fid_get(FAR struct v9fs_client_s *client, uint32_t fid);
 ssize_t v9fs_parse_size(FAR const void *buffer);
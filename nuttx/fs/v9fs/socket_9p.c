@@ -23,10 +23,15 @@
  ****************************************************************************/
 
 #include <sys/param.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <nuttx/kmalloc.h>
+#include <nuttx/kthread.h>
+#include <nuttx/list.h>
 #include <arpa/inet.h>
 #include <nuttx/net/net.h>
 #include <nuttx/fs/fs.h>
+#include <nuttx/semaphore.h>
 
 #include "client.h"
 
@@ -45,7 +50,11 @@ struct socket_9p_priv_s
 {
   struct v9fs_transport_s transport;
   struct socket psock;
-  mutex_t lock;
+  mutex_t lock;             /* Serializes the requests sent */
+  mutex_t pendlock;         /* Protects pending */
+  struct list_node pending; /* Requests waiting for their replies */
+  sem_t exited;             /* Posted when the receiver exits */
+  pid_t pid;                /* The receiver thread */
 };
 
 /****************************************************************************
@@ -73,6 +82,172 @@ const struct v9fs_transport_ops_s g_socket_9p_transport_ops =
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: socket_9p_discard
+ ****************************************************************************/
+
+static int socket_9p_discard(FAR struct socket_9p_priv_s *priv, size_t len)
+{
+  char buf[32];
+  ssize_t ret;
+
+  while (len > 0)
+    {
+      ret = psock_recvfrom(&priv->psock, buf, MIN(len, sizeof(buf)),
+                           MSG_WAITALL, NULL, NULL);
+      if (ret <= 0)
+        {
+          return ret < 0 ? ret : -ECONNRESET;
+        }
+
+      len -= ret;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: socket_9p_receive
+ *
+ * Description:
+ *   Receive the body of a reply of len bytes after its header into the
+ *   reply buffers of a request.  Whatever does not fit is discarded.
+ *
+ ****************************************************************************/
+
+static int socket_9p_receive(FAR struct socket_9p_priv_s *priv,
+                             FAR struct v9fs_payload_s *payload,
+                             size_t len)
+{
+  struct msghdr msg;
+  size_t avail = 0;
+  size_t index;
+  ssize_t ret;
+
+  /* Skip the header */
+
+  payload->riov[0].iov_base += V9FS_HEADER_OFFSET;
+  payload->riov[0].iov_len -= V9FS_HEADER_OFFSET;
+
+  for (index = 0; index < payload->rcount; index++)
+    {
+      payload->riov[index].iov_len =
+        MIN(len - avail, payload->riov[index].iov_len);
+      avail += payload->riov[index].iov_len;
+    }
+
+  ret = 0;
+  if (avail > 0)
+    {
+      memset(&msg, 0, sizeof(struct msghdr));
+      msg.msg_iov = payload->riov;
+      msg.msg_iovlen = payload->rcount;
+
+      ret = psock_recvmsg(&priv->psock, &msg, MSG_WAITALL);
+      if (ret >= 0 && ret < avail)
+        {
+          ret = -ECONNRESET;
+        }
+    }
+
+  /* Restore the header */
+
+  payload->riov[0].iov_base -= V9FS_HEADER_OFFSET;
+  payload->riov[0].iov_len += V9FS_HEADER_OFFSET;
+
+  if (ret >= 0)
+    {
+      ret = socket_9p_discard(priv, len - avail);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: socket_9p_thread
+ *
+ * Description:
+ *   Receive the replies and hand each one to the request with its tag, so
+ *   that any number of requests can be in flight.
+ *
+ ****************************************************************************/
+
+static int socket_9p_thread(int argc, FAR char *argv[])
+{
+  FAR struct socket_9p_priv_s *priv =
+    (FAR struct socket_9p_priv_s *)(uintptr_t)strtoul(argv[1], NULL, 16);
+  FAR struct v9fs_payload_s *payload;
+  FAR struct v9fs_payload_s *tmp;
+  uint8_t header[V9FS_HEADER_OFFSET];
+  uint16_t tag;
+  ssize_t len;
+  int ret;
+
+  for (; ; )
+    {
+      ret = psock_recvfrom(&priv->psock, header, V9FS_HEADER_OFFSET,
+                           MSG_WAITALL, NULL, NULL);
+      if (ret != V9FS_HEADER_OFFSET)
+        {
+          break;
+        }
+
+      len = v9fs_parse_size(header) - V9FS_HEADER_OFFSET;
+      if (len < 0)
+        {
+          break;
+        }
+
+      memcpy(&tag, header + V9FS_HEADER_OFFSET - sizeof(tag), sizeof(tag));
+
+      nxmutex_lock(&priv->pendlock);
+      list_for_every_entry(&priv->pending, payload, struct v9fs_payload_s,
+                           node)
+        {
+          if (payload->tag == tag)
+            {
+              list_delete(&payload->node);
+              break;
+            }
+        }
+
+      nxmutex_unlock(&priv->pendlock);
+
+      if (&payload->node == &priv->pending)
+        {
+          /* Nobody waits for this reply */
+
+          ret = socket_9p_discard(priv, len);
+        }
+      else
+        {
+          memcpy(payload->riov[0].iov_base, header, V9FS_HEADER_OFFSET);
+          ret = socket_9p_receive(priv, payload, len);
+          v9fs_transport_done(payload, ret < 0 ? ret : 0);
+        }
+
+      if (ret < 0)
+        {
+          break;
+        }
+    }
+
+  /* The connection is gone, fail the requests still waiting */
+
+  nxmutex_lock(&priv->pendlock);
+  priv->pid = -1;
+  list_for_every_entry_safe(&priv->pending, payload, tmp,
+                            struct v9fs_payload_s, node)
+    {
+      list_delete(&payload->node);
+      v9fs_transport_done(payload, -ECONNRESET);
+    }
+
+  nxmutex_unlock(&priv->pendlock);
+  nxsem_post(&priv->exited);
+  return 0;
+}
+
 /****************************************************************************
  * Name: socket_9p_create
  ****************************************************************************/
@@ -84,6 +259,8 @@ static int socket_9p_create(FAR struct v9fs_transport_s **transport,
   struct sockaddr_in sin;
   FAR const char *port;
   FAR const char *addr;
+  FAR char *argv[2];
+  char arg1[32];
   int ret;
 
   /* Parse IP and port */
@@ -127,6 +304,25 @@ static int socket_9p_create(FAR struct v9fs_transport_s **transport,
     }
 
   nxmutex_init(&priv->lock);
+  nxmutex_init(&priv->pendlock);
+  nxsem_init(&priv->exited, 0, 0);
+  list_initialize(&priv->pending);
+
+  snprintf(arg1, sizeof(arg1), "%p", priv);
+  argv[0] = arg1;
+  argv[1] = NULL;
+  ret = kthread_create("socket_9p", SCHED_PRIORITY_DEFAULT,
+                       CONFIG_DEFAULT_TASK_STACKSIZE, socket_9p_thread,
+                       argv);
+  if (ret < 0)
+    {
+      nxsem_destroy(&priv->exited);
+      nxmutex_destroy(&priv->pendlock);
+      nxmutex_destroy(&priv->lock);
+      goto out;
+    }
+
+  priv->pid = ret;
   priv->transport.ops = &g_socket_9p_transport_ops;
   *transport = &priv->transport;
   return 0;
@@ -147,70 +343,45 @@ static int socket_9p_request(FAR struct v9fs_transport_s *transport,
   FAR struct socket_9p_priv_s *priv =
                               (FAR struct socket_9p_priv_s *)transport;
   struct msghdr msg;
-  FAR char *ptr;
-  size_t len;
   int ret;
 
+  /* Queue the request first, its reply may arrive before the send
+   * returns.
+   */
+
+  nxmutex_lock(&priv->pendlock);
+  if (priv->pid < 0)
+    {
+      nxmutex_unlock(&priv->pendlock);
+      return -ECONNRESET;
+    }
+
+  list_add_tail(&priv->pending, &payload->node);
+  nxmutex_unlock(&priv->pendlock);
+
   memset(&msg, 0, sizeof(struct msghdr));
   msg.msg_iov = payload->wiov;
   msg.msg_iovlen = payload->wcount;
 
   nxmutex_lock(&priv->lock);
   ret = psock_sendmsg(&priv->psock, &msg, 0);
-  if (ret < 0)
-    {
-      goto out;
-    }
-
-  ptr = payload->riov[0].iov_base;
-  ret = psock_recvfrom(&priv->psock, ptr, V9FS_HEADER_OFFSET,
-                       MSG_WAITALL, NULL, NULL);
-  if (ret < 0)
+  nxmutex_unlock(&priv->lock);
+  if (ret >= 0)
     {
-      goto out;
+      return 0;
     }
 
-  len = v9fs_parse_size(ptr);
-  len -= ret;
+  /* Take the request back unless the receiver already failed it */
 
-  if (len > 0)
+  nxmutex_lock(&priv->pendlock);
+  if (list_in_list(&payload->node))
     {
-      /* There is still data left to process */
-
-      int index;
-
-      /* Skip the header */
-
-      payload->riov[0].iov_base += V9FS_HEADER_OFFSET;
-      payload->riov[0].iov_len -= V9FS_HEADER_OFFSET;
-
-      for (index = 0; index < payload->rcount; index++)
-        {
-          payload->riov[index].iov_len =
-            MIN(len, payload->riov[index].iov_len);
-          len -= payload->riov[index].iov_len;
-        }
-
-      msg.msg_iov = payload->riov;
-      msg.msg_iovlen = payload->rcount;
-
-      ret = psock_recvmsg(&priv->psock, &msg, MSG_WAITALL);
-      if (ret < 0)
-        {
-          goto out;
-        }
-
-      /* Restore the header */
-
-      payload->riov[0].iov_base -= V9FS_HEADER_OFFSET;
-      payload->riov[0].iov_len += V9FS_HEADER_OFFSET;
+      list_delete(&payload->node);
+      nxmutex_unlock(&priv->pendlock);
+      return ret;
     }
 
-  ret = 0;
-
-out:
-  nxmutex_unlock(&priv->lock);
-  v9fs_transport_done(payload, ret);
+  nxmutex_unlock(&priv->pendlock);
   return 0;
 }
 
@@ -223,7 +394,19 @@ static void socket_9p_destroy(FAR struct v9fs_transport_s *transport)
   FAR struct socket_9p_priv_s *priv =
                               (FAR struct socket_9p_priv_s *)transport;
 
+  /* Closing our side makes the server close the connection, which ends
+   * the receiver.
+   */
+
+  psock_shutdown(&priv->psock, SHUT_RDWR);
+  if (nxsem_tickwait_uninterruptible(&priv->exited, SEC2TICK(1)) < 0)
+    {
+      kthread_delete(priv->pid);
+    }
+
   psock_close(&priv->psock);
+  nxsem_destroy(&priv->exited);
+  nxmutex_destroy(&priv->pendlock);
   nxmutex_destroy(&priv->lock);
   kmm_free(priv);
 }
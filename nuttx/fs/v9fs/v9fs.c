@@ -30,6 +30,7 @@
 #include <inttypes.h>
 #include <libgen.h>
 #include <string.h>
+#include <sys/param.h>
 
 #include <nuttx/fs/fs.h>
 #include <nuttx/fs/ioctl.h>
@@ -45,8 +46,23 @@
 
 struct v9fs_vfs_file_s
 {
-  uint32_t fid;
-  mutex_t  lock;
+  uint32_t  fid;
+  mutex_t   lock;
+#if CONFIG_V9FS_ATTRCACHE > 0
+  FAR char *path;    /* Path of the file, for cache invalidation */
+#endif
+#if CONFIG_V9FS_READAHEAD > 0
+  FAR char *rabuf;   /* Data read ahead, allocated on the first read */
+  off_t     rapos;   /* File position of rabuf[0] */
+  size_t    ralen;   /* Number of valid bytes in rabuf */
+  off_t     nextpos; /* Position after the last read */
+#endif
+#if CONFIG_V9FS_WRITEBEHIND > 0
+  FAR char *wbbuf;   /* Data not yet sent, allocated on the first write */
+  off_t     wbpos;   /* File position of wbbuf[0] */
+  size_t    wblen;   /* Number of bytes in wbbuf */
+  int       error;   /* Failure of a flush to report */
+#endif
 };
 
 struct v9fs_vfs_dirent_s
@@ -157,6 +173,239 @@ const struct mountpt_operations g_v9fs_operations =
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: v9fs_vfs_invalidate
+ ****************************************************************************/
+
+static void v9fs_vfs_invalidate(FAR struct v9fs_client_s *client,
+                                FAR const char *relpath)
+{
+#if CONFIG_V9FS_ATTRCACHE > 0
+  v9fs_client_cache_invalidate(client, relpath);
+#endif
+}
+
+/****************************************************************************
+ * Name: v9fs_vfs_file_invalidate
+ ****************************************************************************/
+
+static void v9fs_vfs_file_invalidate(FAR struct v9fs_client_s *client,
+                                     FAR struct v9fs_vfs_file_s *file)
+{
+#if CONFIG_V9FS_ATTRCACHE > 0
+  v9fs_client_cache_invalidate(client, file->path);
+#endif
+}
+
+/****************************************************************************
+ * Name: v9fs_vfs_writeback
+ *
+ * Description:
+ *   Send the data collected by write behind.  A failure is kept to be
+ *   reported by the next write(), fsync() or close().
+ *
+ ****************************************************************************/
+
+static void v9fs_vfs_writeback(FAR struct v9fs_client_s *client,
+                               FAR struct v9fs_vfs_file_s *file)
+{
+#if CONFIG_V9FS_WRITEBEHIND > 0
+  ssize_t ret;
+
+  if (file->wblen == 0)
+    {
+      return;
+    }
+
+  ret = v9fs_client_write(client, file->fid, file->wbbuf, file->wbpos,
+                          file->wblen);
+  if (ret >= 0 && ret < file->wblen)
+    {
+      ret = -EIO;
+    }
+
+  if (ret < 0 && file->error == 0)
+    {
+      file->error = ret;
+    }
+
+  file->wblen = 0;
+  v9fs_vfs_file_invalidate(client, file);
+#endif
+}
+
+/****************************************************************************
+ * Name: v9fs_vfs_flush
+ *
+ * Description:
+ *   Send the data collected by write behind and return the first failure
+ *   not reported yet.
+ *
+ ****************************************************************************/
+
+static int v9fs_vfs_flush(FAR struct v9fs_client_s *client,
+                          FAR struct v9fs_vfs_file_s *file)
+{
+#if CONFIG_V9FS_WRITEBEHIND > 0
+  int ret;
+
+  v9fs_vfs_writeback(client, file);
+  ret = file->error;
+  file->error = 0;
+  return ret;
+#else
+  return OK;
+#endif
+}
+
+/****************************************************************************
+ * Name: v9fs_vfs_readahead
+ *
+ * Description:
+ *   Read from the read ahead buffer.  A small read that continues the
+ *   previous one refills the buffer on a miss, others go to the server.
+ *
+ ****************************************************************************/
+
+static ssize_t v9fs_vfs_readahead(FAR struct v9fs_client_s *client,
+                                  FAR struct v9fs_vfs_file_s *file,
+                                  FAR char *buffer, off_t pos,
+                                  size_t buflen)
+{
+#if CONFIG_V9FS_READAHEAD > 0
+  bool seq = pos == file->nextpos && buflen < CONFIG_V9FS_READAHEAD;
+  size_t done = 0;
+  ssize_t ret = 0;
+  size_t n;
+
+  if (seq && file->rabuf == NULL)
+    {
+      file->rabuf = fs_heap_malloc(CONFIG_V9FS_READAHEAD);
+    }
+
+  while (done < buflen)
+    {
+      if (file->ralen > 0 && pos >= file->rapos &&
+          pos < file->rapos + file->ralen)
+        {
+          n = MIN(buflen - done, file->rapos + file->ralen - pos);
+          memcpy(buffer + done, file->rabuf + (pos - file->rapos), n);
+          done += n;
+          pos += n;
+          continue;
+        }
+
+      if (!seq || file->rabuf == NULL)
+        {
+          ret = v9fs_client_read(client, file->fid, buffer + done, pos,
+                                 buflen - done);
+          if (ret > 0)
+            {
+              done += ret;
+              pos += ret;
+            }
+
+          break;
+        }
+
+      ret = v9fs_client_read(client, file->fid, file->rabuf, pos,
+                             CONFIG_V9FS_READAHEAD);
+      if (ret <= 0)
+        {
+          file->ralen = 0;
+          break;
+        }
+
+      file->rapos = pos;
+      file->ralen = ret;
+    }
+
+  file->nextpos = pos;
+  return done ? done : ret;
+#else
+  return v9fs_client_read(client, file->fid, buffer, pos, buflen);
+#endif
+}
+
+/****************************************************************************
+ * Name: v9fs_vfs_writebehind
+ *
+ * Description:
+ *   Collect a small write that continues the previous one, send others to
+ *   the server.
+ *
+ ****************************************************************************/
+
+static ssize_t v9fs_vfs_writebehind(FAR struct v9fs_client_s *client,
+                                    FAR struct v9fs_vfs_file_s *file,
+                                    FAR const char *buffer, off_t pos,
+                                    size_t buflen)
+{
+  ssize_t ret;
+
+#if CONFIG_V9FS_READAHEAD > 0
+  file->ralen = 0;
+#endif
+
+#if CONFIG_V9FS_WRITEBEHIND > 0
+  if (file->wblen > 0 &&
+      (pos != file->wbpos + file->wblen ||
+       file->wblen + buflen > CONFIG_V9FS_WRITEBEHIND))
+    {
+      v9fs_vfs_writeback(client, file);
+    }
+
+  if (file->error < 0)
+    {
+      ret = file->error;
+      file->error = 0;
+      return ret;
+    }
+
+  if (buflen < CONFIG_V9FS_WRITEBEHIND)
+    {
+      if (file->wbbuf == NULL)
+        {
+          file->wbbuf = fs_heap_malloc(CONFIG_V9FS_WRITEBEHIND);
+        }
+
+      if (file->wbbuf != NULL)
+        {
+          if (file->wblen == 0)
+            {
+              file->wbpos = pos;
+            }
+
+          memcpy(file->wbbuf + file->wblen, buffer, buflen);
+          file->wblen += buflen;
+          return buflen;
+        }
+    }
+#endif
+
+  ret = v9fs_client_write(client, file->fid, buffer, pos, buflen);
+  v9fs_vfs_file_invalidate(client, file);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: v9fs_vfs_file_free
+ ****************************************************************************/
+
+static void v9fs_vfs_file_free(FAR struct v9fs_vfs_file_s *file)
+{
+#if CONFIG_V9FS_ATTRCACHE > 0
+  fs_heap_free(file->path);
+#endif
+#if CONFIG_V9FS_READAHEAD > 0
+  fs_heap_free(file->rabuf);
+#endif
+#if CONFIG_V9FS_WRITEBEHIND > 0
+  fs_heap_free(file->wbbuf);
+#endif
+  fs_heap_free(file);
+}
+
 /****************************************************************************
  * Name: v9fs_vfs_open
  ****************************************************************************/
@@ -166,6 +415,10 @@ static int v9fs_vfs_open(FAR struct file *filep, FAR const char *relpath,
 {
   FAR struct v9fs_vfs_file_s *file;
   FAR struct v9fs_client_s *client;
+#if CONFIG_V9FS_ATTRCACHE > 0
+  uint32_t gen;
+  int result;
+#endif
   int ret;
 
   /* Sanity checks */
@@ -182,7 +435,34 @@ static int v9fs_vfs_open(FAR struct file *filep, FAR const char *relpath,
       return -ENOMEM;
     }
 
-  ret = v9fs_client_walk(client, relpath, NULL);
+#if CONFIG_V9FS_ATTRCACHE > 0
+  file->path = fs_heap_strdup(relpath);
+  if (file->path == NULL)
+    {
+      ret = -ENOMEM;
+      goto err_free;
+    }
+
+  /* A path known not to exist needs no walk */
+
+  gen = v9fs_client_cache_gen(client);
+  if (v9fs_client_cache_lookup(client, relpath, NULL, &result) &&
+      result < 0)
+    {
+      ret = result;
+    }
+  else
+#endif
+    {
+      ret = v9fs_client_walk(client, relpath, NULL);
+#if CONFIG_V9FS_ATTRCACHE > 0
+      if (ret == -ENOENT)
+        {
+          v9fs_client_cache_enter(client, relpath, NULL, ret, gen);
+        }
+#endif
+    }
+
   if (ret >= 0)
     {
       file->fid = ret;
@@ -192,6 +472,11 @@ static int v9fs_vfs_open(FAR struct file *filep, FAR const char *relpath,
           ferr("ERROR: Failed to open the fid: %d\n", ret);
           goto err_put;
         }
+
+      if ((oflags & O_TRUNC) != 0)
+        {
+          v9fs_vfs_file_invalidate(client, file);
+        }
     }
   else if ((oflags & O_CREAT) != 0)
     {
@@ -206,6 +491,7 @@ static int v9fs_vfs_open(FAR struct file *filep, FAR const char *relpath,
 
       file->fid = ret;
       ret = v9fs_client_create(client, file->fid, relpath, oflags, mode);
+      v9fs_vfs_file_invalidate(client, file);
       if (ret < 0)
         {
           ferr("ERROR: Failed to create the file: %d\n", ret);
@@ -232,6 +518,10 @@ static int v9fs_vfs_open(FAR struct file *filep, FAR const char *relpath,
         }
     }
 
+#if CONFIG_V9FS_READAHEAD > 0
+  file->nextpos = filep->f_pos;
+#endif
+
   nxmutex_init(&file->lock);
   filep->f_priv = file;
   return 0;
@@ -239,7 +529,7 @@ static int v9fs_vfs_open(FAR struct file *filep, FAR const char *relpath,
 err_put:
   v9fs_fid_put(client, file->fid);
 err_free:
-  fs_heap_free(file);
+  v9fs_vfs_file_free(file);
   return ret;
 }
 
@@ -251,6 +541,7 @@ static int v9fs_vfs_close(FAR struct file *filep)
 {
   FAR struct v9fs_client_s *client;
   FAR struct v9fs_vfs_file_s *file;
+  int ret;
 
   /* Sanity checks */
 
@@ -261,10 +552,11 @@ static int v9fs_vfs_close(FAR struct file *filep)
   client = filep->f_inode->i_private;
   file = filep->f_priv;
 
+  ret = v9fs_vfs_flush(client, file);
   v9fs_fid_put(client, file->fid);
   nxmutex_destroy(&file->lock);
-  fs_heap_free(file);
-  return 0;
+  v9fs_vfs_file_free(file);
+  return ret;
 }
 
 /****************************************************************************
@@ -288,7 +580,8 @@ static ssize_t v9fs_vfs_read(FAR struct file *filep, FAR char *buffer,
   file = filep->f_priv;
 
   nxmutex_lock(&file->lock);
-  ret = v9fs_client_read(client, file->fid, buffer, filep->f_pos, buflen);
+  v9fs_vfs_writeback(client, file);
+  ret = v9fs_vfs_readahead(client, file, buffer, filep->f_pos, buflen);
   if (ret > 0)
     {
       filep->f_pos += ret;
@@ -319,7 +612,7 @@ static ssize_t v9fs_vfs_write(FAR struct file *filep, FAR const char *buffer,
   file = filep->f_priv;
 
   nxmutex_lock(&file->lock);
-  ret = v9fs_client_write(client, file->fid, buffer, filep->f_pos, buflen);
+  ret = v9fs_vfs_writebehind(client, file, buffer, filep->f_pos, buflen);
   if (ret > 0)
     {
       filep->f_pos += ret;
@@ -358,6 +651,7 @@ static off_t v9fs_vfs_seek(FAR struct file *filep, off_t offset, int whence)
         ret = filep->f_pos + offset;
         break;
       case SEEK_END:
+        v9fs_vfs_writeback(client, file);
         ret = v9fs_client_getsize(client, file->fid);
         if (ret >= 0)
           {
@@ -411,10 +705,19 @@ static int v9fs_vfs_sync(FAR struct file *filep)
 {
   FAR struct v9fs_vfs_file_s *file;
   FAR struct v9fs_client_s *client;
+  int ret;
 
   client = filep->f_inode->i_private;
   file = filep->f_priv;
 
+  nxmutex_lock(&file->lock);
+  ret = v9fs_vfs_flush(client, file);
+  nxmutex_unlock(&file->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
   return v9fs_client_fsync(client, file->fid);
 }
 
@@ -445,13 +748,26 @@ static int v9fs_vfs_dup(FAR const struct file *oldp, FAR struct file *newp)
       return -ENOMEM;
     }
 
+#if CONFIG_V9FS_ATTRCACHE > 0
+  newfile->path = fs_heap_strdup(file->path);
+  if (newfile->path == NULL)
+    {
+      fs_heap_free(newfile);
+      return -ENOMEM;
+    }
+#endif
+
   ret = v9fs_fid_get(client, file->fid);
   if (ret < 0)
     {
-      fs_heap_free(newfile);
+      v9fs_vfs_file_free(newfile);
       return ret;
     }
 
+#if CONFIG_V9FS_READAHEAD > 0
+  newfile->nextpos = oldp->f_pos;
+#endif
+
   nxmutex_init(&newfile->lock);
   newfile->fid = file->fid;
   newp->f_priv = newfile;
@@ -478,6 +794,10 @@ static int v9fs_vfs_fstat(FAR const struct file *filep,
   file = filep->f_priv;
   memset(buf, 0, sizeof(struct stat));
 
+  nxmutex_lock(&file->lock);
+  v9fs_vfs_writeback(client, file);
+  nxmutex_unlock(&file->lock);
+
   return v9fs_client_stat(client, file->fid, buf);
 }
 
@@ -490,6 +810,7 @@ static int v9fs_vfs_fchstat(FAR const struct file *filep,
 {
   FAR struct v9fs_vfs_file_s *file;
   FAR struct v9fs_client_s *client;
+  int ret;
 
   /* Sanity checks */
 
@@ -500,7 +821,16 @@ static int v9fs_vfs_fchstat(FAR const struct file *filep,
   client = filep->f_inode->i_private;
   file = filep->f_priv;
 
-  return v9fs_client_chstat(client, file->fid, buf, flags);
+  nxmutex_lock(&file->lock);
+  v9fs_vfs_writeback(client, file);
+#if CONFIG_V9FS_READAHEAD > 0
+  file->ralen = 0;
+#endif
+  nxmutex_unlock(&file->lock);
+
+  ret = v9fs_client_chstat(client, file->fid, buf, flags);
+  v9fs_vfs_file_invalidate(client, file);
+  return ret;
 }
 
 /****************************************************************************
@@ -743,6 +1073,7 @@ static int v9fs_vfs_unlink(FAR struct inode *mountpt,
       v9fs_fid_put(client, fid);
     }
 
+  v9fs_vfs_invalidate(client, relpath);
   return ret;
 }
 
@@ -754,6 +1085,7 @@ static int v9fs_vfs_mkdir(FAR struct inode *mountpt,
                           FAR const char *relpath, mode_t mode)
 {
   FAR struct v9fs_client_s *client;
+  FAR const char *dirname;
   uint32_t fid;
   int ret;
 
@@ -765,7 +1097,7 @@ static int v9fs_vfs_mkdir(FAR struct inode *mountpt,
 
   client = mountpt->i_private;
 
-  ret = v9fs_client_walk(client, relpath, &relpath);
+  ret = v9fs_client_walk(client, relpath, &dirname);
   if (ret < 0)
     {
       ferr("ERROR: Can't find the parent fid of relpath: %d\n", ret);
@@ -773,8 +1105,9 @@ static int v9fs_vfs_mkdir(FAR struct inode *mountpt,
     }
 
   fid = ret;
-  ret = v9fs_client_mkdir(client, fid, relpath, mode);
+  ret = v9fs_client_mkdir(client, fid, dirname, mode);
   v9fs_fid_put(client, fid);
+  v9fs_vfs_invalidate(client, relpath);
   return ret;
 }
 
@@ -826,6 +1159,7 @@ static int v9fs_vfs_rmdir(FAR struct inode *mountpt,
       v9fs_fid_put(client, fid);
     }
 
+  v9fs_vfs_invalidate(client, relpath);
   return ret;
 }
 
@@ -871,6 +1205,10 @@ static int v9fs_vfs_rename(FAR struct inode *mountpt,
   ret = v9fs_client_rename(client, oldfid, newpfid, newrelpath);
   v9fs_fid_put(client, oldfid);
   v9fs_fid_put(client, newpfid);
+
+  /* Everything below the old name moved too */
+
+  v9fs_vfs_invalidate(client, NULL);
   return ret;
 }
 
@@ -882,6 +1220,9 @@ static int v9fs_vfs_stat(FAR struct inode *mountpt, FAR const char *relpath,
                          FAR struct stat *buf)
 {
   FAR struct v9fs_client_s *client;
+#if CONFIG_V9FS_ATTRCACHE > 0
+  uint32_t gen;
+#endif
   uint32_t fid;
   int ret;
 
@@ -894,16 +1235,31 @@ static int v9fs_vfs_stat(FAR struct inode *mountpt, FAR const char *relpath,
   client = mountpt->i_private;
   memset(buf, 0, sizeof(struct stat));
 
+#if CONFIG_V9FS_ATTRCACHE > 0
+  if (v9fs_client_cache_lookup(client, relpath, buf, &ret))
+    {
+      return ret;
+    }
+
+  gen = v9fs_client_cache_gen(client);
+#endif
+
   ret = v9fs_client_walk(client, relpath, NULL);
-  if (ret < 0)
+  if (ret >= 0)
+    {
+      fid = ret;
+      ret = v9fs_client_stat(client, fid, buf);
+      v9fs_fid_put(client, fid);
+    }
+  else
     {
       ferr("ERROR: Can't find the fid of the relpath: %d\n", ret);
-      return ret;
     }
 
-  fid = ret;
-  ret = v9fs_client_stat(client, fid, buf);
-  v9fs_fid_put(client, fid);
+#if CONFIG_V9FS_ATTRCACHE > 0
+  v9fs_client_cache_enter(client, relpath, buf, ret, gen);
+#endif
+
   return ret;
 }
 
@@ -937,6 +1293,7 @@ static int v9fs_vfs_chstat(FAR struct inode *mountpt,
   fid = ret;
   ret = v9fs_client_chstat(client, fid, buf, flags);
   v9fs_fid_put(client, fid);
+  v9fs_vfs_invalidate(client, relpath);
   return ret;
 }
 
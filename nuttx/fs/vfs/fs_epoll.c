@@ -42,6 +42,7 @@
 #include <nuttx/list.h>
 #include <nuttx/mutex.h>
 #include <nuttx/signal.h>
+#include <nuttx/spinlock.h>
 
 #include "inode/inode.h"
 #include "fs_heap.h"
@@ -52,9 +53,11 @@
 
 struct epoll_node_s
 {
-  struct list_node         node;
+  struct list_node         node;    /* Link in the setup/oneshot/free list */
+  struct list_node         rnode;   /* Link in the ready list */
   epoll_data_t             data;
-  bool                     notified;
+  bool                     ready;   /* Queued in the ready list */
+  bool                     polling; /* Polled again by epoll_harvest() */
   struct pollfd            pfd;
   FAR struct file         *filep;
   FAR struct epoll_head_s *eph;
@@ -68,13 +71,18 @@ struct epoll_head_s
   int                   crefs;
   mutex_t               lock;
   sem_t                 sem;
-  struct list_node      setup;    /* The setup list, store all the setuped
-                                   * epoll node.
+  spinlock_t            rlock;    /* Protects the ready list and the ready
+                                   * flags of the nodes, the poll callbacks
+                                   * may run in interrupt context.
                                    */
-  struct list_node      teardown; /* The teardown list, store all the epoll
-                                   * node notified after epoll_wait finish,
-                                   * these epoll node should be setup again
-                                   * to check the pending poll notification.
+  struct list_node      setup;    /* The setup list, store all the epoll
+                                   * nodes armed with file_poll(), they stay
+                                   * armed until they are deleted.
+                                   */
+  struct list_node      ready;    /* The ready list, store the armed epoll
+                                   * nodes with pending events in the order
+                                   * they were notified.  epoll_wait() only
+                                   * visits these nodes.
                                    */
   struct list_node      oneshot;  /* The oneshot list, store all the epoll
                                    * node notified after epoll_wait and with
@@ -101,9 +109,7 @@ static int epoll_do_open(FAR struct file *filep);
 static int epoll_do_close(FAR struct file *filep);
 static int epoll_do_poll(FAR struct file *filep,
                          FAR struct pollfd *fds, bool setup);
-static int epoll_setup(FAR epoll_head_t *eph);
-static int epoll_teardown(FAR epoll_head_t *eph, FAR struct epoll_event *evs,
-                          int maxevents);
+static void epoll_default_cb(FAR struct pollfd *fds);
 
 /****************************************************************************
  * Private Data
@@ -197,12 +203,18 @@ static int epoll_do_close(FAR struct file *filep)
   if (eph->crefs <= 0)
     {
       nxmutex_destroy(&eph->lock);
+      nxsem_destroy(&eph->sem);
       list_for_every_entry(&eph->setup, epn, epoll_node_t, node)
         {
           file_poll(epn->filep, &epn->pfd, false);
           file_put(epn->filep);
         }
 
+      list_for_every_entry(&eph->oneshot, epn, epoll_node_t, node)
+        {
+          file_put(epn->filep);
+        }
+
       list_for_every_entry_safe(&eph->extend, epn, tmp, epoll_node_t, node)
         {
           list_delete(&epn->node);
@@ -239,13 +251,14 @@ static int epoll_do_create(int size, int flags)
   eph->size = size;
   nxmutex_init(&eph->lock);
   nxsem_init(&eph->sem, 0, 0);
+  spin_lock_init(&eph->rlock);
 
   /* List initialize */
 
   epn = (FAR epoll_node_t *)(eph + 1);
 
   list_initialize(&eph->setup);
-  list_initialize(&eph->teardown);
+  list_initialize(&eph->ready);
   list_initialize(&eph->oneshot);
   list_initialize(&eph->extend);
   list_initialize(&eph->free);
@@ -262,6 +275,7 @@ static int epoll_do_create(int size, int flags)
   if (fd < 0)
     {
       nxmutex_destroy(&eph->lock);
+      nxsem_destroy(&eph->sem);
       fs_heap_free(eph);
       set_errno(-fd);
       return ERROR;
@@ -271,23 +285,115 @@ static int epoll_do_create(int size, int flags)
 }
 
 /****************************************************************************
- * Name: epoll_setup
+ * Name: epoll_find
  *
  * Description:
- *   Setup all the fd.
+ *   Find the epoll node of a file descriptor in one of the lists.
+ *
+ ****************************************************************************/
+
+static FAR epoll_node_t *epoll_find(FAR struct list_node *list, int fd)
+{
+  FAR epoll_node_t *epn;
+
+  list_for_every_entry(list, epn, epoll_node_t, node)
+    {
+      if (epn->pfd.fd == fd)
+        {
+          return epn;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: epoll_arm
+ *
+ * Description:
+ *   Set up the poll of an epoll node with its current events.  A file that
+ *   is already ready notifies the node immediately, which queues it to the
+ *   ready list.
+ *
+ ****************************************************************************/
+
+static int epoll_arm(FAR epoll_node_t *epn)
+{
+  epn->pfd.revents = 0;
+  return file_poll(epn->filep, &epn->pfd, true);
+}
+
+/****************************************************************************
+ * Name: epoll_unready
+ *
+ * Description:
+ *   Remove an epoll node from the ready list.
+ *
+ ****************************************************************************/
+
+static void epoll_unready(FAR epoll_head_t *eph, FAR epoll_node_t *epn)
+{
+  irqstate_t flags;
+
+  flags = spin_lock_irqsave(&eph->rlock);
+  if (epn->ready)
+    {
+      list_delete(&epn->rnode);
+      epn->ready = false;
+    }
+
+  spin_unlock_irqrestore(&eph->rlock, flags);
+}
+
+/****************************************************************************
+ * Name: epoll_disarm
+ *
+ * Description:
+ *   Tear down the poll of an epoll node and remove it from the ready list.
+ *   The node receives no more notifications after this.
+ *
+ ****************************************************************************/
+
+static void epoll_disarm(FAR epoll_head_t *eph, FAR epoll_node_t *epn)
+{
+  file_poll(epn->filep, &epn->pfd, false);
+  epoll_unready(eph, epn);
+}
+
+/****************************************************************************
+ * Name: epoll_harvest
+ *
+ * Description:
+ *   Collect the events of the nodes in the ready list.  The cost depends on
+ *   the number of ready nodes only, idle descriptors are never visited.
+ *
+ *   Edge-triggered nodes report the events notified since they were queued
+ *   and leave the ready list until they are notified again.  Level-
+ *   triggered nodes are polled again, report the current state of the file
+ *   and stay in the ready list as long as the file is ready.  Oneshot nodes
+ *   are disarmed after they report their events.
  *
  * Input Parameters:
  *   eph       - The epoll head pointer
+ *   evs       - The epoll events array
+ *   maxevents - The epoll events array size
  *
  * Returned Value:
- *   Positive on success, negative on fail
+ *   The number of events stored in evs, or a negated errno value if the
+ *   lock could not be taken.
  *
  ****************************************************************************/
 
-static int epoll_setup(FAR epoll_head_t *eph)
+static int epoll_harvest(FAR epoll_head_t *eph, FAR struct epoll_event *evs,
+                         int maxevents)
 {
-  FAR epoll_node_t *tepn;
+  FAR struct list_node *node;
   FAR epoll_node_t *epn;
+  struct list_node requeue;
+  pollevent_t revents;
+  irqstate_t flags;
+  bool armed;
+  int num = 0;
   int ret;
 
   ret = nxmutex_lock(&eph->lock);
@@ -296,92 +402,192 @@ static int epoll_setup(FAR epoll_head_t *eph)
       return ret;
     }
 
-  list_for_every_entry_safe(&eph->teardown, epn, tepn, epoll_node_t, node)
-    {
-      /* Setup again to check the notified pollfd last epoll_wait() to
-       * cover the situation several poll event pending on one fd.
-       */
+  list_initialize(&requeue);
 
-      epn->notified    = false;
-      epn->pfd.revents = 0;
-      ret = file_poll(epn->filep, &epn->pfd, true);
-      if (ret < 0)
+  while (num < maxevents)
+    {
+      flags = spin_lock_irqsave(&eph->rlock);
+      node  = list_remove_head(&eph->ready);
+      if (node == NULL)
         {
-          ferr("epoll setup failed, filep=%p, events=%08" PRIx32 ", "
-               "ret=%d\n", epn->filep, epn->pfd.events, ret);
+          spin_unlock_irqrestore(&eph->rlock, flags);
           break;
         }
 
-      list_delete(&epn->node);
-      list_add_tail(&eph->setup, &epn->node);
+      epn = container_of(node, epoll_node_t, rnode);
+      epn->ready = false;
+      armed = true;
+      if ((epn->pfd.events & EPOLLET) != 0)
+        {
+          revents = epn->pfd.revents;
+          epn->pfd.revents = 0;
+        }
+      else
+        {
+          revents = 0;
+          epn->polling = true;
+        }
+
+      spin_unlock_irqrestore(&eph->rlock, flags);
+
+      if ((epn->pfd.events & EPOLLET) == 0)
+        {
+          /* Poll again: the events notified earlier may be consumed
+           * already, or more events may be pending.
+           */
+
+          file_poll(epn->filep, &epn->pfd, false);
+          ret = epoll_arm(epn);
+
+          flags = spin_lock_irqsave(&eph->rlock);
+          revents = epn->pfd.revents;
+          epn->polling = false;
+          spin_unlock_irqrestore(&eph->rlock, flags);
+
+          if (ret < 0)
+            {
+              ferr("epoll setup failed, filep=%p, events=%08" PRIx32 ", "
+                   "ret=%d\n", epn->filep, epn->pfd.events, ret);
+
+              /* Park the node like a oneshot node, EPOLL_CTL_MOD arms it
+               * again.
+               */
+
+              list_delete(&epn->node);
+              list_add_tail(&eph->oneshot, &epn->node);
+              revents = POLLERR;
+              armed = false;
+            }
+        }
+
+      revents &= epn->pfd.events | POLLERR | POLLHUP;
+      if (revents == 0)
+        {
+          continue;
+        }
+
+      evs[num].data     = epn->data;
+      evs[num++].events = revents;
+
+      if (!armed)
+        {
+          continue;
+        }
+      else if ((epn->pfd.events & EPOLLONESHOT) != 0)
+        {
+          epoll_disarm(eph, epn);
+          list_delete(&epn->node);
+          list_add_tail(&eph->oneshot, &epn->node);
+        }
+      else if ((epn->pfd.events & EPOLLET) == 0)
+        {
+          /* Still ready, report it again at the next wait.  It is queued
+           * after the other ready nodes, so that a busy descriptor cannot
+           * starve the others when maxevents is small.
+           */
+
+          flags = spin_lock_irqsave(&eph->rlock);
+          if (!epn->ready)
+            {
+              epn->ready = true;
+              list_add_tail(&requeue, &epn->rnode);
+            }
+
+          spin_unlock_irqrestore(&eph->rlock, flags);
+        }
+    }
+
+  flags = spin_lock_irqsave(&eph->rlock);
+  while ((node = list_remove_head(&requeue)) != NULL)
+    {
+      list_add_tail(&eph->ready, node);
     }
 
+  spin_unlock_irqrestore(&eph->rlock, flags);
+
   nxmutex_unlock(&eph->lock);
-  return ret;
+  return num;
 }
 
 /****************************************************************************
- * Name: epoll_teardown
+ * Name: epoll_do_wait
  *
  * Description:
- *   Teardown all the notified fd and check the notified fd's event with user
- *   expected event.
+ *   Wait until events are ready or the timeout expires.
  *
  * Input Parameters:
  *   eph       - The epoll head pointer
  *   evs       - The epoll events array
  *   maxevents - The epoll events array size
+ *   timeout   - The timeout in milliseconds, -1 to wait forever
+ *   sigmask   - The signal mask while waiting, NULL to keep the current one
  *
  * Returned Value:
- *   Return the number of fd that notified and the events is also user
- *   expected.
+ *   The number of events stored in evs, zero on timeout or a negated errno
+ *   value on failure.
  *
  ****************************************************************************/
 
-static int epoll_teardown(FAR epoll_head_t *eph, FAR struct epoll_event *evs,
-                          int maxevents)
+static int epoll_do_wait(FAR epoll_head_t *eph, FAR struct epoll_event *evs,
+                         int maxevents, int timeout,
+                         FAR const sigset_t *sigmask)
 {
-  FAR epoll_node_t *tepn;
-  FAR epoll_node_t *epn;
-  int i = 0;
+  sigset_t oldsigmask;
+  clock_t deadline = 0;
+  sclock_t ticks;
+  int ret;
 
-  nxmutex_lock(&eph->lock);
+  if (maxevents <= 0)
+    {
+      return -EINVAL;
+    }
 
-  list_for_every_entry_safe(&eph->setup, epn, tepn, epoll_node_t, node)
+  if (timeout > 0)
     {
-      /* Only check the notified fd */
+      deadline = clock_systime_ticks() + MSEC2TICK(timeout);
+    }
 
-      if (!epn->notified)
+  for (; ; )
+    {
+      ret = epoll_harvest(eph, evs, maxevents);
+      if (ret != 0 || timeout == 0)
         {
-          continue;
+          return ret;
         }
 
-      /* Teradown all the notified fd */
+      /* Nothing is ready, the poll callbacks post the semaphore when a
+       * node is queued.
+       */
 
-      file_poll(epn->filep, &epn->pfd, false);
-      list_delete(&epn->node);
+      if (sigmask != NULL)
+        {
+          nxsig_procmask(SIG_SETMASK, sigmask, &oldsigmask);
+        }
 
-      if (epn->pfd.revents != 0 && i < maxevents)
+      if (timeout > 0)
         {
-          evs[i].data     = epn->data;
-          evs[i++].events = epn->pfd.revents;
-          if ((epn->pfd.events & EPOLLONESHOT) != 0)
-            {
-              list_add_tail(&eph->oneshot, &epn->node);
-            }
-          else
-            {
-              list_add_tail(&eph->teardown, &epn->node);
-            }
+          ticks = (sclock_t)(deadline - clock_systime_ticks());
+          ret = ticks > 0 ? nxsem_tickwait(&eph->sem, ticks) : -ETIMEDOUT;
         }
       else
         {
-          list_add_tail(&eph->teardown, &epn->node);
+          ret = nxsem_wait(&eph->sem);
         }
-    }
 
-  nxmutex_unlock(&eph->lock);
-  return i;
+      if (sigmask != NULL)
+        {
+          nxsig_procmask(SIG_SETMASK, &oldsigmask, NULL);
+        }
+
+      if (ret == -ETIMEDOUT)
+        {
+          return epoll_harvest(eph, evs, maxevents);
+        }
+      else if (ret < 0)
+        {
+          return ret;
+        }
+    }
 }
 
 /****************************************************************************
@@ -389,7 +595,8 @@ static int epoll_teardown(FAR epoll_head_t *eph, FAR struct epoll_event *evs,
  *
  * Description:
  *   The default epoll callback function, this function do the final step of
- *   poll notification.
+ *   poll notification: queue the node to the ready list once and wake up
+ *   the waiter.
  *
  * Input Parameters:
  *   fds - The fds
@@ -402,15 +609,32 @@ static int epoll_teardown(FAR epoll_head_t *eph, FAR struct epoll_event *evs,
 static void epoll_default_cb(FAR struct pollfd *fds)
 {
   FAR epoll_node_t *epn = fds->arg;
+  FAR epoll_head_t *eph = epn->eph;
+  bool queued = false;
+  irqstate_t flags;
   int semcount = 0;
 
-  epn->notified = true;
-  if (fds->revents != 0)
+  if (fds->revents == 0)
     {
-      nxsem_get_value(&epn->eph->sem, &semcount);
+      return;
+    }
+
+  flags = spin_lock_irqsave(&eph->rlock);
+  if (!epn->ready && !epn->polling)
+    {
+      epn->ready = true;
+      list_add_tail(&eph->ready, &epn->rnode);
+      queued = true;
+    }
+
+  spin_unlock_irqrestore(&eph->rlock, flags);
+
+  if (queued)
+    {
+      nxsem_get_value(&eph->sem, &semcount);
       if (semcount < 1)
         {
-          nxsem_post(&epn->eph->sem);
+          nxsem_post(&eph->sem);
         }
     }
 }
@@ -507,31 +731,11 @@ int epoll_ctl(int epfd, int op, int fd, FAR struct epoll_event *ev)
 
         /* Check repetition */
 
-        list_for_every_entry(&eph->setup, epn, epoll_node_t, node)
-          {
-            if (epn->pfd.fd == fd)
-              {
-                ret = -EEXIST;
-                goto err;
-              }
-          }
-
-        list_for_every_entry(&eph->teardown, epn, epoll_node_t, node)
+        if (epoll_find(&eph->setup, fd) != NULL ||
+            epoll_find(&eph->oneshot, fd) != NULL)
           {
-            if (epn->pfd.fd == fd)
-              {
-                ret = -EEXIST;
-                goto err;
-              }
-          }
-
-        list_for_every_entry(&eph->oneshot, epn, epoll_node_t, node)
-          {
-            if (epn->pfd.fd == fd)
-              {
-                ret = -EEXIST;
-                goto err;
-              }
+            ret = -EEXIST;
+            goto err;
           }
 
         if (list_is_empty(&eph->free))
@@ -561,12 +765,12 @@ int epoll_ctl(int epfd, int op, int fd, FAR struct epoll_event *ev)
         epn = container_of(list_remove_head(&eph->free), epoll_node_t, node);
         epn->eph         = eph;
         epn->data        = ev->data;
-        epn->notified    = false;
-        epn->pfd.events  = ev->events | POLLALWAYS;
+        epn->ready       = false;
+        epn->polling     = false;
+        epn->pfd.events  = ev->events;
         epn->pfd.fd      = fd;
         epn->pfd.arg     = epn;
         epn->pfd.cb      = epoll_default_cb;
-        epn->pfd.revents = 0;
 
         ret = file_get(fd, &epn->filep);
         if (ret < 0)
@@ -575,9 +779,10 @@ int epoll_ctl(int epfd, int op, int fd, FAR struct epoll_event *ev)
             goto err;
           }
 
-        ret = file_poll(epn->filep, &epn->pfd, true);
+        ret = epoll_arm(epn);
         if (ret < 0)
           {
+            epoll_unready(eph, epn);
             file_put(epn->filep);
             list_add_tail(&eph->free, &epn->node);
             goto err;
@@ -588,112 +793,62 @@ int epoll_ctl(int epfd, int op, int fd, FAR struct epoll_event *ev)
 
       case EPOLL_CTL_DEL:
         finfo("%p CTL DEL: fd=%d\n", eph, fd);
-        list_for_every_entry(&eph->setup, epn, epoll_node_t, node)
+        epn = epoll_find(&eph->setup, fd);
+        if (epn != NULL)
           {
-            if (epn->pfd.fd == fd)
-              {
-                file_poll(epn->filep, &epn->pfd, false);
-                file_put(epn->filep);
-                list_delete(&epn->node);
-                list_add_tail(&eph->free, &epn->node);
-                goto out;
-              }
+            epoll_disarm(eph, epn);
           }
-
-        list_for_every_entry(&eph->teardown, epn, epoll_node_t, node)
+        else
           {
-            if (epn->pfd.fd == fd)
-              {
-                file_put(epn->filep);
-                list_delete(&epn->node);
-                list_add_tail(&eph->free, &epn->node);
-                goto out;
-              }
+            epn = epoll_find(&eph->oneshot, fd);
           }
 
-        list_for_every_entry(&eph->oneshot, epn, epoll_node_t, node)
+        if (epn != NULL)
           {
-            if (epn->pfd.fd == fd)
-              {
-                file_put(epn->filep);
-                list_delete(&epn->node);
-                list_add_tail(&eph->free, &epn->node);
-                goto out;
-              }
+            file_put(epn->filep);
+            list_delete(&epn->node);
+            list_add_tail(&eph->free, &epn->node);
           }
 
         break;
 
       case EPOLL_CTL_MOD:
         finfo("%p CTL MOD: fd=%d ev=%08" PRIx32 "\n", eph, fd, ev->events);
-        list_for_every_entry(&eph->setup, epn, epoll_node_t, node)
+        epn = epoll_find(&eph->setup, fd);
+        if (epn != NULL)
           {
-            if (epn->pfd.fd == fd)
+            epn->data = ev->data;
+            if (epn->pfd.events != ev->events)
               {
-                if (epn->pfd.events != (ev->events | POLLALWAYS))
-                  {
-                    file_poll(epn->filep, &epn->pfd, false);
-
-                    epn->notified    = false;
-                    epn->data        = ev->data;
-                    epn->pfd.events  = ev->events | POLLALWAYS;
-                    epn->pfd.revents = 0;
-
-                    ret = file_poll(epn->filep, &epn->pfd, true);
-                    if (ret < 0)
-                      {
-                        goto err;
-                      }
-                  }
-
-                goto out;
-              }
-          }
-
-        list_for_every_entry(&eph->teardown, epn, epoll_node_t, node)
-          {
-            if (epn->pfd.fd == fd)
-              {
-                if (epn->pfd.events != (ev->events | POLLALWAYS))
+                epoll_disarm(eph, epn);
+                epn->pfd.events = ev->events;
+                ret = epoll_arm(epn);
+                if (ret < 0)
                   {
-                    epn->notified    = false;
-                    epn->data        = ev->data;
-                    epn->pfd.events  = ev->events | POLLALWAYS;
-                    epn->pfd.revents = 0;
-
-                    ret = file_poll(epn->filep, &epn->pfd, true);
-                    if (ret < 0)
-                      {
-                        goto err;
-                      }
-
+                    epoll_unready(eph, epn);
                     list_delete(&epn->node);
-                    list_add_tail(&eph->setup, &epn->node);
+                    list_add_tail(&eph->oneshot, &epn->node);
+                    goto err;
                   }
-
-                goto out;
               }
+
+            break;
           }
 
-        list_for_every_entry(&eph->oneshot, epn, epoll_node_t, node)
+        epn = epoll_find(&eph->oneshot, fd);
+        if (epn != NULL)
           {
-            if (epn->pfd.fd == fd)
+            epn->data       = ev->data;
+            epn->pfd.events = ev->events;
+            ret = epoll_arm(epn);
+            if (ret < 0)
               {
-                epn->notified    = false;
-                epn->data        = ev->data;
-                epn->pfd.events  = ev->events | POLLALWAYS;
-                epn->pfd.revents = 0;
-
-                ret = file_poll(epn->filep, &epn->pfd, true);
-                if (ret < 0)
-                  {
-                    goto err;
-                  }
-
-                list_delete(&epn->node);
-                list_add_tail(&eph->setup, &epn->node);
-                break;
+                epoll_unready(eph, epn);
+                goto err;
               }
+
+            list_delete(&epn->node);
+            list_add_tail(&eph->setup, &epn->node);
           }
 
         break;
@@ -703,7 +858,6 @@ int epoll_ctl(int epfd, int op, int fd, FAR struct epoll_event *ev)
         goto err;
     }
 
-out:
   nxmutex_unlock(&eph->lock);
   file_put(filep);
   return OK;
@@ -724,7 +878,6 @@ int epoll_pwait(int epfd, FAR struct epoll_event *evs,
 {
   FAR struct file *filep;
   FAR epoll_head_t *eph;
-  sigset_t oldsigmask;
   int ret;
 
   eph = epoll_head_from_fd(epfd, &filep);
@@ -733,52 +886,16 @@ int epoll_pwait(int epfd, FAR struct epoll_event *evs,
       goto out;
     }
 
-retry:
-  ret = epoll_setup(eph);
+  ret = epoll_do_wait(eph, evs, maxevents, timeout, sigmask);
+  file_put(filep);
   if (ret < 0)
     {
-      goto err;
-    }
-
-  /* Wait the poll ready */
-
-  nxsig_procmask(SIG_SETMASK, sigmask, &oldsigmask);
-
-  if (timeout == 0)
-    {
-      ret = -ETIMEDOUT;
-    }
-  else if (timeout > 0)
-    {
-      ret = nxsem_tickwait(&eph->sem, MSEC2TICK(timeout));
-    }
-  else
-    {
-      ret = nxsem_wait(&eph->sem);
-    }
-
-  nxsig_procmask(SIG_SETMASK, &oldsigmask, NULL);
-  if (ret < 0 && ret != -ETIMEDOUT)
-    {
-      goto err;
-    }
-  else /* ret >= 0 or ret == -ETIMEDOUT */
-    {
-      int num = epoll_teardown(eph, evs, maxevents);
-      if (num == 0 && ret >= 0)
-        {
-          goto retry;
-        }
-
-      ret = num;
+      set_errno(-ret);
+      goto out;
     }
 
-  file_put(filep);
   return ret;
 
-err:
-  file_put(filep);
-  set_errno(-ret);
 out:
   ferr("epoll wait failed:%d, timeout:%d\n", errno, timeout);
   return ERROR;
@@ -808,49 +925,16 @@ int epoll_wait(int epfd, FAR struct epoll_event *evs,
       goto out;
     }
 
-retry:
-  ret = epoll_setup(eph);
+  ret = epoll_do_wait(eph, evs, maxevents, timeout, NULL);
+  file_put(filep);
   if (ret < 0)
     {
-      goto err;
-    }
-
-  /* Wait the poll ready */
-
-  if (timeout == 0)
-    {
-      ret = -ETIMEDOUT;
-    }
-  else if (timeout > 0)
-    {
-      ret = nxsem_tickwait(&eph->sem, MSEC2TICK(timeout));
-    }
-  else
-    {
-      ret = nxsem_wait(&eph->sem);
-    }
-
-  if (ret < 0 && ret != -ETIMEDOUT)
-    {
-      goto err;
-    }
-  else /* ret >= 0 or ret == -ETIMEDOUT */
-    {
-      int num = epoll_teardown(eph, evs, maxevents);
-      if (num == 0 && ret >= 0)
-        {
-          goto retry;
-        }
-
-      ret = num;
+      set_errno(-ret);
+      goto out;
     }
 
-  file_put(filep);
   return ret;
 
-err:
-  file_put(filep);
-  set_errno(-ret);
 out:
   ferr("epoll wait failed:%d, timeout:%d\n", errno, timeout);
   return ERROR;
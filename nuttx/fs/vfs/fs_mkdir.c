@@ -111,6 +111,8 @@ int mkdir(const char *pathname, mode_t mode)
               errcode = -ret;
               goto errout_with_inode;
             }
+
+          inode_dcache_invalidate();
         }
       else
         {
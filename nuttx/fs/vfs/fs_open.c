@@ -245,7 +245,32 @@ static int file_vopen(FAR struct file *filep, FAR const char *path,
     {
       if (inode->u.i_mops->open != NULL)
         {
-          ret = inode->u.i_mops->open(filep, desc.relpath, oflags, mode);
+          uint32_t gen = inode_dcache_generation();
+
+          if ((oflags & O_CREAT) == 0 &&
+              inode_dcache_negative(inode, desc.relpath))
+            {
+              ret = -ENOENT;
+            }
+          else
+            {
+              ret = inode->u.i_mops->open(filep, desc.relpath, oflags,
+                                          mode);
+            }
+
+          /* A file may have been created, or is known not to exist */
+
+          if ((oflags & O_CREAT) != 0)
+            {
+              if (ret >= 0)
+                {
+                  inode_dcache_invalidate();
+                }
+            }
+          else if (ret == -ENOENT)
+            {
+              inode_dcache_addnegative(inode, desc.relpath, gen);
+            }
         }
     }
 #endif
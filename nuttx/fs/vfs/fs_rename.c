@@ -427,6 +427,10 @@ static int mountptrename(FAR const char *oldpath, FAR struct inode *oldinode,
    */
 
   ret = oldinode->u.i_mops->rename(oldinode, oldrelpath, newrelpath);
+  if (ret >= 0)
+    {
+      inode_dcache_invalidate();
+    }
 
 #ifdef CONFIG_FS_NOTIFY
   if (ret >= 0)
@@ -32,6 +32,7 @@
 #include <debug.h>
 
 #include <nuttx/fs/fs.h>
+#include <nuttx/fs/ioctl.h>
 #include <nuttx/kmalloc.h>
 #include <nuttx/net/net.h>
 #include "fs_heap.h"
@@ -40,11 +41,51 @@
  * Private Functions
  ****************************************************************************/
 
+/* Map up to len bytes at the current position of the input file if the
+ * file system holds them in addressable memory, and advance the position
+ * past them.  Returns the number of bytes mapped, 0 at end of file.
+ */
+
+static ssize_t copyfile_map(FAR struct file *infile,
+                            FAR const uint8_t **buffer, size_t len)
+{
+  struct file_memregion_s region;
+  off_t pos;
+  int ret;
+
+  if (!INODE_IS_MOUNTPT(infile->f_inode))
+    {
+      return -ENOTTY;
+    }
+
+  region.offset = infile->f_pos;
+  ret = file_ioctl(infile, FIOC_MEMREGION, (unsigned long)&region);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (len > region.len)
+    {
+      len = region.len;
+    }
+
+  pos = file_seek(infile, len, SEEK_CUR);
+  if (pos < 0)
+    {
+      return pos;
+    }
+
+  *buffer = region.addr;
+  return len;
+}
+
 static ssize_t copyfile(FAR struct file *outfile, FAR struct file *infile,
                         FAR off_t *offset, size_t count)
 {
-  FAR uint8_t *iobuffer;
-  FAR uint8_t *wrbuffer;
+  FAR uint8_t *iobuffer = NULL;
+  FAR const uint8_t *wrbuffer;
+  bool map = true;
   off_t startpos = 0;
   ssize_t nbytesread;
   ssize_t nbyteswritten;
@@ -74,14 +115,6 @@ static ssize_t copyfile(FAR struct file *outfile, FAR struct file *infile,
         }
     }
 
-  /* Allocate an I/O buffer */
-
-  iobuffer = fs_heap_malloc(CONFIG_SENDFILE_BUFSIZE);
-  if (!iobuffer)
-    {
-      return -ENOMEM;
-    }
-
   /* Now transfer 'count' bytes from the infile to the outfile */
 
   for (ntransferred = 0, endxfr = false; ntransferred < count && !endxfr; )
@@ -90,15 +123,41 @@ static ssize_t copyfile(FAR struct file *outfile, FAR struct file *infile,
 
       do
         {
-          /* Read a buffer of data from the infile */
+          /* Write the data straight from the file system memory if the
+           * infile supports that.
+           */
 
-          nbytesread = count - ntransferred;
-          if (nbytesread > CONFIG_SENDFILE_BUFSIZE)
+          if (map)
             {
-              nbytesread = CONFIG_SENDFILE_BUFSIZE;
+              nbytesread = copyfile_map(infile, &wrbuffer,
+                                        count - ntransferred);
+              map = nbytesread >= 0;
             }
 
-          nbytesread = file_read(infile, iobuffer, nbytesread);
+          /* Otherwise read a buffer of data from the infile */
+
+          if (!map)
+            {
+              if (iobuffer == NULL)
+                {
+                  iobuffer = fs_heap_malloc(CONFIG_SENDFILE_BUFSIZE);
+                  if (iobuffer == NULL)
+                    {
+                      ntransferred = -ENOMEM;
+                      endxfr       = true;
+                      break;
+                    }
+                }
+
+              nbytesread = count - ntransferred;
+              if (nbytesread > CONFIG_SENDFILE_BUFSIZE)
+                {
+                  nbytesread = CONFIG_SENDFILE_BUFSIZE;
+                }
+
+              wrbuffer   = iobuffer;
+              nbytesread = file_read(infile, iobuffer, nbytesread);
+            }
 
           /* Check for end of file */
 
@@ -142,7 +201,6 @@ static ssize_t copyfile(FAR struct file *outfile, FAR struct file *infile,
            * conclusion.
            */
 
-          wrbuffer = iobuffer;
           do
             {
               /* Write the buffer of data to the outfile */
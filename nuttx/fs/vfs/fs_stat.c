@@ -118,9 +118,24 @@ static int stat_recursive(FAR const char *path,
 
       if (inode->u.i_mops && inode->u.i_mops->stat)
         {
-          /* Perform the stat() operation */
+          uint32_t gen = inode_dcache_generation();
 
-          ret = inode->u.i_mops->stat(inode, desc.relpath, buf);
+          /* Perform the stat() operation, unless the name is already known
+           * not to exist.
+           */
+
+          if (inode_dcache_negative(inode, desc.relpath))
+            {
+              ret = -ENOENT;
+            }
+          else
+            {
+              ret = inode->u.i_mops->stat(inode, desc.relpath, buf);
+              if (ret == -ENOENT)
+                {
+                  inode_dcache_addnegative(inode, desc.relpath, gen);
+                }
+            }
         }
       else
         {
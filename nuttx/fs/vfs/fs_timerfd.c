@@ -34,6 +34,7 @@
 #include <debug.h>
 
 #include <nuttx/irq.h>
+#include <nuttx/hrtimer.h>
 #include <nuttx/wdog.h>
 #include <nuttx/mutex.h>
 
@@ -65,9 +66,15 @@ struct timerfd_priv_s
   mutex_t                   lock;    /* Enforces device exclusive access */
   FAR timerfd_waiter_sem_t *rdsems;  /* List of blocking readers */
   int                       clock;   /* Clock to use as the timing base */
+#ifdef CONFIG_HRTIMER
+  uint64_t                  period;  /* If non-zero, the period in ns of
+                                      * repetitive timers */
+  struct hrtimer_s          hrtimer; /* The hrtimer that provides the timing */
+#else
   int                       delay;   /* If non-zero, used to reset repetitive
                                       * timers */
   struct wdog_s             wdog;    /* The watchdog that provides the timing */
+#endif
   timerfd_t                 counter; /* timerfd counter */
   uint8_t                   crefs;   /* References counts on timerfd (max: 255) */
 
@@ -101,7 +108,12 @@ static int timerfd_blocking_io(FAR struct timerfd_priv_s *dev,
 static FAR struct timerfd_priv_s *timerfd_allocdev(void);
 static void timerfd_destroy(FAR struct timerfd_priv_s *dev);
 
+#ifdef CONFIG_HRTIMER
+static uint64_t timerfd_timeout(FAR struct hrtimer_s *hrtimer,
+                                uint64_t expired);
+#else
 static void timerfd_timeout(wdparm_t arg);
+#endif
 
 /****************************************************************************
  * Private Data
@@ -151,6 +163,9 @@ static FAR struct timerfd_priv_s *timerfd_allocdev(void)
       nxmutex_init(&dev->lock);
       nxmutex_lock(&dev->lock);
       dev->crefs++;
+#ifdef CONFIG_HRTIMER
+      hrtimer_init(&dev->hrtimer, timerfd_timeout, dev);
+#endif
     }
 
   return dev;
@@ -158,7 +173,13 @@ static FAR struct timerfd_priv_s *timerfd_allocdev(void)
 
 static void timerfd_destroy(FAR struct timerfd_priv_s *dev)
 {
+#ifdef CONFIG_HRTIMER
+  /* The callback may still be running on another CPU */
+
+  hrtimer_cancel_sync(&dev->hrtimer);
+#else
   wd_cancel(&dev->wdog);
+#endif
   nxmutex_unlock(&dev->lock);
   nxmutex_destroy(&dev->lock);
   fs_heap_free(dev);
@@ -384,9 +405,9 @@ out:
 }
 #endif
 
-static void timerfd_timeout(wdparm_t arg)
+static void timerfd_expire(FAR struct timerfd_priv_s *dev,
+                           timerfd_t count)
 {
-  FAR struct timerfd_priv_s *dev = (FAR struct timerfd_priv_s *)arg;
   FAR timerfd_waiter_sem_t *cur_sem;
   irqstate_t intflags;
 
@@ -398,14 +419,7 @@ static void timerfd_timeout(wdparm_t arg)
 
   /* Increment timer expiration counter */
 
-  dev->counter++;
-
-  /* If this is a repetitive timer, then restart the watchdog */
-
-  if (dev->delay > 0)
-    {
-      wd_start(&dev->wdog, dev->delay, timerfd_timeout, arg);
-    }
+  dev->counter += count;
 
 #ifdef CONFIG_TIMER_FD_POLL
   /* Notify all poll/select waiters */
@@ -427,6 +441,65 @@ static void timerfd_timeout(wdparm_t arg)
   leave_critical_section(intflags);
 }
 
+#ifdef CONFIG_HRTIMER
+static uint64_t timerfd_timeout(FAR struct hrtimer_s *hrtimer,
+                                uint64_t expired)
+{
+  FAR struct timerfd_priv_s *dev = hrtimer->arg;
+  uint64_t now = hrtimer_gettime();
+  timerfd_t count = 1;
+
+  /* Account for the periods missed, they are skipped by the restart */
+
+  if (dev->period > 0 && now > expired)
+    {
+      count += (now - expired) / dev->period;
+    }
+
+  timerfd_expire(dev, count);
+
+  /* If this is a repetitive timer, then restart the hrtimer */
+
+  return dev->period;
+}
+
+/* Convert an absolute time on the timerfd clock to the hrtimer time base */
+
+static uint64_t timerfd_abstime2nsec(FAR struct timerfd_priv_s *dev,
+                                     FAR const struct timespec *abstime)
+{
+  struct timespec ts;
+  uint64_t now;
+  uint64_t ns;
+
+  ns = clock_time2nsec(abstime);
+  if (dev->clock != CLOCK_REALTIME)
+    {
+      return ns;
+    }
+
+  /* Express the wall clock time relative to now */
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+  now = clock_time2nsec(&ts);
+  return hrtimer_gettime() + (ns > now ? ns - now : 0);
+}
+#else
+static void timerfd_timeout(wdparm_t arg)
+{
+  FAR struct timerfd_priv_s *dev = (FAR struct timerfd_priv_s *)arg;
+
+  /* If this is a repetitive timer, then restart the watchdog */
+
+  if (dev->delay > 0)
+    {
+      wd_start(&dev->wdog, dev->delay, timerfd_timeout, arg);
+    }
+
+  timerfd_expire(dev, 1);
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -490,7 +563,9 @@ int timerfd_settime(int fd, int flags,
   FAR struct timerfd_priv_s *dev;
   FAR struct file *filep;
   irqstate_t intflags;
+#ifndef CONFIG_HRTIMER
   sclock_t delay;
+#endif
   int ret;
 
   /* Some sanity checks */
@@ -530,6 +605,11 @@ int timerfd_settime(int fd, int flags,
 
   if (old_value)
     {
+#ifdef CONFIG_HRTIMER
+      clock_nsec2time(&old_value->it_value,
+                      hrtimer_remaining(&dev->hrtimer));
+      clock_nsec2time(&old_value->it_interval, dev->period);
+#else
       /* Get the number of ticks before the underlying watchdog expires */
 
       delay = wd_gettime(&dev->wdog);
@@ -538,13 +618,23 @@ int timerfd_settime(int fd, int flags,
 
       clock_ticks2time(&old_value->it_value, delay);
       clock_ticks2time(&old_value->it_interval, dev->delay);
+#endif
     }
 
   /* Disarm the timer (in case the timer was already armed when
    * timerfd_settime() is called).
    */
 
+#ifdef CONFIG_HRTIMER
+  /* A callback that is already running on another CPU must not restart
+   * the timer with the old interval.
+   */
+
+  hrtimer_cancel(&dev->hrtimer);
+  dev->period = 0;
+#else
   wd_cancel(&dev->wdog);
+#endif
 
   /* Clear expiration counter */
 
@@ -561,6 +651,25 @@ int timerfd_settime(int fd, int flags,
       return OK;
     }
 
+#ifdef CONFIG_HRTIMER
+  /* Setup up any repetitive timer and start the hrtimer.  An expiration
+   * time in the past makes it expire immediately.
+   */
+
+  dev->period = clock_time2nsec(&new_value->it_interval);
+
+  if ((flags & TFD_TIMER_ABSTIME) != 0)
+    {
+      ret = hrtimer_start(&dev->hrtimer,
+                          timerfd_abstime2nsec(dev, &new_value->it_value),
+                          HRTIMER_MODE_ABS);
+    }
+  else
+    {
+      ret = hrtimer_start_ts(&dev->hrtimer, &new_value->it_value,
+                             HRTIMER_MODE_REL);
+    }
+#else
   /* Setup up any repetitive timer */
 
   delay = clock_time2ticks(&new_value->it_interval);
@@ -600,6 +709,8 @@ int timerfd_settime(int fd, int flags,
   /* Then start the watchdog */
 
   ret = wd_start(&dev->wdog, delay, timerfd_timeout, (wdparm_t)dev);
+#endif
+
   if (ret < 0)
     {
       leave_critical_section(intflags);
@@ -621,7 +732,9 @@ int timerfd_gettime(int fd, FAR struct itimerspec *curr_value)
 {
   FAR struct timerfd_priv_s *dev;
   FAR struct file *filep;
+#ifndef CONFIG_HRTIMER
   sclock_t ticks;
+#endif
   int ret;
 
   /* Some sanity checks */
@@ -648,6 +761,10 @@ int timerfd_gettime(int fd, FAR struct itimerspec *curr_value)
 
   dev = (FAR struct timerfd_priv_s *)filep->f_priv;
 
+#ifdef CONFIG_HRTIMER
+  clock_nsec2time(&curr_value->it_value, hrtimer_remaining(&dev->hrtimer));
+  clock_nsec2time(&curr_value->it_interval, dev->period);
+#else
   /* Get the number of ticks before the underlying watchdog expires */
 
   ticks = wd_gettime(&dev->wdog);
@@ -656,6 +773,7 @@ int timerfd_gettime(int fd, FAR struct itimerspec *curr_value)
 
   clock_ticks2time(&curr_value->it_value, ticks);
   clock_ticks2time(&curr_value->it_interval, dev->delay);
+#endif
   file_put(filep);
   return OK;
 
@@ -24,9 +24,11 @@
  * Included Files
  ****************************************************************************/
 
+#include <sys/param.h>
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/statfs.h>
@@ -39,6 +41,13 @@
 
 #include "fs_heap.h"
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define ZIPFS_INBUF_SIZE  512
+#define ZIPFS_WINDOW_SIZE 32768
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -51,17 +60,57 @@ struct zipfs_dir_s
   bool last;
 };
 
+/* A file of the archive, cached from the central directory */
+
+struct zipfs_entry_s
+{
+  FAR char *name;            /* Path of the file in the archive */
+  unz64_file_pos pos;        /* Position in the central directory */
+  off_t dataoff;             /* Offset of the file data, zero until known */
+  off_t csize;               /* Size of the compressed data */
+  off_t usize;               /* Size of the uncompressed data */
+  uint16_t method;           /* Compression method */
+  bool encrypted;            /* The data is encrypted */
+};
+
+/* A point of a deflate stream where inflating can resume */
+
+struct zipfs_point_s
+{
+  off_t out;                 /* Offset in the uncompressed data */
+  off_t in;                  /* Offset in the compressed data */
+  uint8_t bits;              /* Unused bits of the byte before 'in' */
+  uInt wlen;                 /* Length of the window */
+  FAR uint8_t *window;       /* Uncompressed data preceding 'out' */
+};
+
 struct zipfs_mountpt_s
 {
+  mutex_t lock;                      /* Protects the entry cache */
+  FAR struct zipfs_entry_s *entries; /* Sorted by name, NULL until loaded */
+  size_t nentries;                   /* Number of entries */
   char abspath[1];
 };
 
+/* Stored and deflated files are read directly from the archive, others
+ * through minizip (uf != NULL).
+ */
+
 struct zipfs_file_s
 {
+  FAR struct zipfs_entry_s *entry;
   unzFile uf;
   mutex_t lock;
   FAR char *seekbuf;
-  char relpath[1];
+  struct file file;                 /* The archive */
+  z_stream strm;                    /* Inflate state */
+  FAR uint8_t *inbuf;               /* Compressed data, NULL if stored */
+  off_t in;                         /* Compressed data read into inbuf */
+  off_t out;                        /* Position in the uncompressed data */
+  bool eof;                         /* End of the deflate stream */
+  FAR struct zipfs_point_s *points; /* Checkpoints, sorted by offset */
+  size_t npoints;                   /* Number of checkpoints */
+  off_t interval;                   /* Distance between checkpoints */
 };
 
 /****************************************************************************
@@ -243,62 +292,523 @@ static int zipfs_convert_result(int ziperr)
     }
 }
 
-static int zipfs_open(FAR struct file *filep, FAR const char *relpath,
-                      int oflags, mode_t mode)
+static int zipfs_compare_entry(FAR const void *a, FAR const void *b)
 {
-  FAR struct zipfs_mountpt_s *fs = filep->f_inode->i_private;
-  FAR struct zipfs_file_s *fp;
+  FAR const struct zipfs_entry_s *ea = a;
+  FAR const struct zipfs_entry_s *eb = b;
+
+  return strcmp(ea->name, eb->name);
+}
+
+static void zipfs_free_entries(FAR struct zipfs_entry_s *entries,
+                               size_t nentries)
+{
+  while (nentries-- > 0)
+    {
+      fs_heap_free(entries[nentries].name);
+    }
+
+  fs_heap_free(entries);
+}
+
+/* Read the central directory once per mount, so that opening a file does
+ * not walk through it again.  Called with the mount locked.
+ */
+
+static int zipfs_load_entries(FAR struct zipfs_mountpt_s *fs)
+{
+  FAR struct zipfs_entry_s *entries;
+  unz_global_info64 global_info;
+  unz_file_info64 file_info;
+  FAR char *name;
+  size_t nentries = 0;
+  unzFile uf;
   int ret;
 
-  DEBUGASSERT(fs != NULL);
+  if (fs->entries != NULL)
+    {
+      return OK;
+    }
 
-  fp = fs_heap_malloc(sizeof(*fp) + strlen(relpath));
-  if (fp == NULL)
+  name = fs_heap_malloc(PATH_MAX);
+  if (name == NULL)
     {
       return -ENOMEM;
     }
 
-  ret = nxmutex_init(&fp->lock);
+  uf = unzOpen2_64(fs->abspath, &zipfs_real_ops);
+  if (uf == NULL)
+    {
+      fs_heap_free(name);
+      return -EINVAL;
+    }
+
+  ret = zipfs_convert_result(unzGetGlobalInfo64(uf, &global_info));
   if (ret < 0)
     {
-      goto err_with_fp;
+      goto err_with_zip;
     }
 
+  entries = fs_heap_zalloc(sizeof(*entries) *
+                           MAX(global_info.number_entry, 1));
+  if (entries == NULL)
+    {
+      ret = -ENOMEM;
+      goto err_with_zip;
+    }
+
+  ret = zipfs_convert_result(unzGoToFirstFile(uf));
+  while (ret == OK && nentries < global_info.number_entry)
+    {
+      FAR struct zipfs_entry_s *entry = &entries[nentries];
+
+      ret = unzGetCurrentFileInfo64(uf, &file_info, name, PATH_MAX,
+                                    NULL, 0, NULL, 0);
+      ret = zipfs_convert_result(ret);
+      if (ret < 0)
+        {
+          break;
+        }
+
+      ret = zipfs_convert_result(unzGetFilePos64(uf, &entry->pos));
+      if (ret < 0)
+        {
+          break;
+        }
+
+      entry->name = fs_heap_strdup(name);
+      if (entry->name == NULL)
+        {
+          ret = -ENOMEM;
+          break;
+        }
+
+      entry->csize     = file_info.compressed_size;
+      entry->usize     = file_info.uncompressed_size;
+      entry->method    = file_info.compression_method;
+      entry->encrypted = (file_info.flag & 1) != 0;
+      nentries++;
+
+      ret = zipfs_convert_result(unzGoToNextFile(uf));
+    }
+
+  if (ret < 0 && ret != -ENOENT)
+    {
+      zipfs_free_entries(entries, nentries);
+      goto err_with_zip;
+    }
+
+  qsort(entries, nentries, sizeof(*entries), zipfs_compare_entry);
+  fs->entries  = entries;
+  fs->nentries = nentries;
+  ret          = OK;
+
+err_with_zip:
+  unzClose(uf);
+  fs_heap_free(name);
+  return ret;
+}
+
+static int zipfs_find_entry(FAR struct zipfs_mountpt_s *fs,
+                            FAR const char *relpath,
+                            FAR struct zipfs_entry_s **entry)
+{
+  struct zipfs_entry_s key;
+  int ret;
+
+  ret = nxmutex_lock(&fs->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = zipfs_load_entries(fs);
+  if (ret >= 0)
+    {
+      key.name = (FAR char *)relpath;
+      *entry = bsearch(&key, fs->entries, fs->nentries,
+                       sizeof(key), zipfs_compare_entry);
+      ret = *entry != NULL ? OK : -ENOENT;
+    }
+
+  nxmutex_unlock(&fs->lock);
+  return ret;
+}
+
+/* Get the offset of the file data behind the local header of the entry */
+
+static int zipfs_data_offset(FAR struct zipfs_mountpt_s *fs,
+                             FAR struct zipfs_entry_s *entry)
+{
+  unzFile uf;
+  int ret;
+
+  ret = nxmutex_lock(&fs->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (entry->dataoff != 0)
+    {
+      goto out;
+    }
+
+  uf = unzOpen2_64(fs->abspath, &zipfs_real_ops);
+  if (uf == NULL)
+    {
+      ret = -EINVAL;
+      goto out;
+    }
+
+  ret = zipfs_convert_result(unzGoToFilePos64(uf, &entry->pos));
+  if (ret >= 0)
+    {
+      ret = unzOpenCurrentFile2(uf, NULL, NULL, 1);
+      ret = zipfs_convert_result(ret);
+    }
+
+  if (ret >= 0)
+    {
+      entry->dataoff = unzGetCurrentFileZStreamPos64(uf);
+      unzCloseCurrentFile(uf);
+    }
+
+  unzClose(uf);
+
+out:
+  nxmutex_unlock(&fs->lock);
+  return ret;
+}
+
+static int zipfs_open_unzip(FAR struct zipfs_mountpt_s *fs,
+                            FAR struct zipfs_file_s *fp)
+{
+  int ret;
+
   fp->uf = unzOpen2_64(fs->abspath, &zipfs_real_ops);
   if (fp->uf == NULL)
     {
-      ret = -EINVAL;
-      goto err_with_mutex;
+      return -EINVAL;
+    }
+
+  ret = zipfs_convert_result(unzGoToFilePos64(fp->uf, &fp->entry->pos));
+  if (ret >= 0)
+    {
+      ret = zipfs_convert_result(unzOpenCurrentFile(fp->uf));
     }
 
-  ret = zipfs_convert_result(unzLocateFile(fp->uf, relpath, 0));
   if (ret < 0)
     {
-      goto err_with_zip;
+      unzClose(fp->uf);
+      fp->uf = NULL;
+    }
+
+  return ret;
+}
+
+/* Restart inflating from a checkpoint, or from the start of the data if
+ * point is NULL.
+ */
+
+static int zipfs_resume(FAR struct zipfs_file_s *fp,
+                        FAR struct zipfs_point_s *point)
+{
+  off_t in = point != NULL ? point->in : 0;
+  uint8_t byte;
+  ssize_t ret;
+
+  inflateReset(&fp->strm);
+  fp->strm.avail_in = 0;
+
+  if (point != NULL && point->bits > 0)
+    {
+      /* The stream resumes in the middle of the previous byte */
+
+      ret = file_pread(&fp->file, &byte, 1, fp->entry->dataoff + in - 1);
+      if (ret != 1)
+        {
+          return ret < 0 ? ret : -EIO;
+        }
+
+      inflatePrime(&fp->strm, point->bits, byte >> (8 - point->bits));
     }
 
-  ret = zipfs_convert_result(unzOpenCurrentFile(fp->uf));
+  ret = file_seek(&fp->file, fp->entry->dataoff + in, SEEK_SET);
   if (ret < 0)
     {
-      goto err_with_zip;
+      return ret;
     }
 
-  if (ret == OK)
+  if (point != NULL)
     {
-      fp->seekbuf = NULL;
-      strcpy(fp->relpath, relpath);
-      filep->f_priv = fp;
+      inflateSetDictionary(&fp->strm, point->window, point->wlen);
+    }
+
+  fp->in  = in;
+  fp->out = point != NULL ? point->out : 0;
+  fp->eof = false;
+  return OK;
+}
+
+/* Find the last checkpoint at or before offset */
+
+static FAR struct zipfs_point_s *
+zipfs_find_point(FAR struct zipfs_file_s *fp, off_t offset)
+{
+  size_t i = fp->npoints;
+
+  while (i-- > 0)
+    {
+      if (fp->points[i].out <= offset)
+        {
+          return &fp->points[i];
+        }
+    }
+
+  return NULL;
+}
+
+/* Record a checkpoint at a deflate block boundary if the previous one is
+ * far enough behind.  When all checkpoints are in use, every other one is
+ * dropped and the interval doubled.  Checkpoints are only an optimization,
+ * so failing to allocate one is not an error.
+ */
+
+static void zipfs_checkpoint(FAR struct zipfs_file_s *fp, off_t out)
+{
+  FAR struct zipfs_point_s *point;
+  off_t last;
+  size_t i;
+
+  last = fp->npoints > 0 ? fp->points[fp->npoints - 1].out : 0;
+  if (fp->interval == 0 || out < last + fp->interval)
+    {
+      return;
+    }
+
+  if (fp->points == NULL)
+    {
+      fp->points = fs_heap_malloc(sizeof(*fp->points) *
+                                  CONFIG_ZIPFS_CHECKPOINT_MAX);
+      if (fp->points == NULL)
+        {
+          return;
+        }
+    }
+  else if (fp->npoints == CONFIG_ZIPFS_CHECKPOINT_MAX)
+    {
+      for (i = 0; i < fp->npoints; i++)
+        {
+          if (i % 2 == 0)
+            {
+              fs_heap_free(fp->points[i].window);
+            }
+          else
+            {
+              fp->points[i / 2] = fp->points[i];
+            }
+        }
+
+      fp->npoints   /= 2;
+      fp->interval  *= 2;
+
+      last = fp->npoints > 0 ? fp->points[fp->npoints - 1].out : 0;
+      if (out < last + fp->interval)
+        {
+          return;
+        }
+    }
+
+  point = &fp->points[fp->npoints];
+  point->window = fs_heap_malloc(ZIPFS_WINDOW_SIZE);
+  if (point->window == NULL)
+    {
+      return;
+    }
+
+  inflateGetDictionary(&fp->strm, point->window, &point->wlen);
+  point->out  = out;
+  point->in   = fp->in - fp->strm.avail_in;
+  point->bits = fp->strm.data_type & 7;
+  fp->npoints++;
+}
+
+static ssize_t zipfs_inflate(FAR struct zipfs_file_s *fp, FAR void *buf,
+                             size_t len)
+{
+  FAR z_stream *strm = &fp->strm;
+  ssize_t nread;
+  int ret = OK;
+
+  strm->next_out  = buf;
+  strm->avail_out = MIN(len, UINT_MAX);
+
+  while (strm->avail_out > 0 && !fp->eof)
+    {
+      /* Inflate may still finish the stream from the bits it holds once
+       * all the input was consumed, running out of data is reported by
+       * Z_BUF_ERROR below.
+       */
+
+      if (strm->avail_in == 0 && fp->in < fp->entry->csize)
+        {
+          nread = MIN(fp->entry->csize - fp->in, ZIPFS_INBUF_SIZE);
+          nread = file_read(&fp->file, fp->inbuf, nread);
+          if (nread <= 0)
+            {
+              ret = nread < 0 ? nread : -EIO;
+              break;
+            }
+
+          fp->in         += nread;
+          strm->next_in   = fp->inbuf;
+          strm->avail_in  = nread;
+        }
+
+      /* Stop at every block boundary to look for a checkpoint */
+
+      ret = inflate(strm, Z_BLOCK);
+      if (ret == Z_STREAM_END)
+        {
+          fp->eof = true;
+        }
+      else if (ret != Z_OK)
+        {
+          ret = -EIO;
+          break;
+        }
+      else if ((strm->data_type & 192) == 128)
+        {
+          zipfs_checkpoint(fp, fp->out + len - strm->avail_out);
+        }
+
+      ret = OK;
+    }
+
+  len    -= strm->avail_out;
+  fp->out += len;
+  return len > 0 ? len : ret;
+}
+
+static ssize_t zipfs_read_current(FAR struct zipfs_file_s *fp,
+                                  FAR void *buf, size_t len)
+{
+  ssize_t ret;
+
+  if (fp->uf != NULL)
+    {
+      return zipfs_convert_result(unzReadCurrentFile(fp->uf, buf, len));
+    }
+  else if (fp->inbuf != NULL)
+    {
+      return zipfs_inflate(fp, buf, len);
+    }
+
+  len = MIN(len, fp->entry->usize - fp->out);
+  ret = file_pread(&fp->file, buf, len, fp->entry->dataoff + fp->out);
+  if (ret > 0)
+    {
+      fp->out += ret;
+    }
+
+  return ret;
+}
+
+static int zipfs_open_direct(FAR struct zipfs_mountpt_s *fs,
+                             FAR struct zipfs_file_s *fp)
+{
+  int ret;
+
+  ret = zipfs_data_offset(fs, fp->entry);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = file_open(&fp->file, fs->abspath, O_RDONLY);
+  if (ret < 0 || fp->entry->method != Z_DEFLATED)
+    {
+      return ret;
+    }
+
+  fp->inbuf = fs_heap_malloc(ZIPFS_INBUF_SIZE);
+  if (fp->inbuf == NULL)
+    {
+      ret = -ENOMEM;
+      goto err_with_file;
+    }
+
+  if (inflateInit2(&fp->strm, -MAX_WBITS) != Z_OK)
+    {
+      ret = -ENOMEM;
+      goto err_with_inbuf;
+    }
+
+  fp->interval = CONFIG_ZIPFS_CHECKPOINT_INTERVAL;
+  ret = zipfs_resume(fp, NULL);
+  if (ret >= 0)
+    {
+      return ret;
+    }
+
+  inflateEnd(&fp->strm);
+err_with_inbuf:
+  fs_heap_free(fp->inbuf);
+  fp->inbuf = NULL;
+err_with_file:
+  file_close(&fp->file);
+  return ret;
+}
+
+static int zipfs_open(FAR struct file *filep, FAR const char *relpath,
+                      int oflags, mode_t mode)
+{
+  FAR struct zipfs_mountpt_s *fs = filep->f_inode->i_private;
+  FAR struct zipfs_entry_s *entry;
+  FAR struct zipfs_file_s *fp;
+  int ret;
+
+  DEBUGASSERT(fs != NULL);
+
+  ret = zipfs_find_entry(fs, relpath, &entry);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  fp = fs_heap_zalloc(sizeof(*fp));
+  if (fp == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  ret = nxmutex_init(&fp->lock);
+  if (ret < 0)
+    {
+      goto err_with_fp;
+    }
+
+  fp->entry = entry;
+  if (!entry->encrypted &&
+      (entry->method == 0 || entry->method == Z_DEFLATED))
+    {
+      ret = zipfs_open_direct(fs, fp);
     }
   else
     {
-err_with_zip:
-      unzClose(fp->uf);
-err_with_mutex:
-      nxmutex_destroy(&fp->lock);
-err_with_fp:
-      fs_heap_free(fp);
+      ret = zipfs_open_unzip(fs, fp);
+    }
+
+  if (ret >= 0)
+    {
+      filep->f_priv = fp;
+      return OK;
     }
 
+  nxmutex_destroy(&fp->lock);
+err_with_fp:
+  fs_heap_free(fp);
   return ret;
 }
 
@@ -307,7 +817,27 @@ static int zipfs_close(FAR struct file *filep)
   FAR struct zipfs_file_s *fp = filep->f_priv;
   int ret;
 
-  ret = zipfs_convert_result(unzClose(fp->uf));
+  if (fp->uf != NULL)
+    {
+      ret = zipfs_convert_result(unzClose(fp->uf));
+    }
+  else
+    {
+      if (fp->inbuf != NULL)
+        {
+          inflateEnd(&fp->strm);
+          fs_heap_free(fp->inbuf);
+        }
+
+      while (fp->npoints > 0)
+        {
+          fs_heap_free(fp->points[--fp->npoints].window);
+        }
+
+      fs_heap_free(fp->points);
+      ret = file_close(&fp->file);
+    }
+
   nxmutex_destroy(&fp->lock);
   fs_heap_free(fp->seekbuf);
   fs_heap_free(fp);
@@ -321,7 +851,7 @@ static ssize_t zipfs_read(FAR struct file *filep, FAR char *buffer,
   ssize_t ret;
 
   nxmutex_lock(&fp->lock);
-  ret = zipfs_convert_result(unzReadCurrentFile(fp->uf, buffer, buflen));
+  ret = zipfs_read_current(fp, buffer, buflen);
   if (ret > 0)
     {
       filep->f_pos += ret;
@@ -353,8 +883,7 @@ static off_t zipfs_skip(FAR struct zipfs_file_s *fp, off_t amount)
           remain = CONFIG_ZIPFS_SEEK_BUFSIZE;
         }
 
-      remain = unzReadCurrentFile(fp->uf, fp->seekbuf, remain);
-      remain = zipfs_convert_result(remain);
+      remain = zipfs_read_current(fp, fp->seekbuf, remain);
       if (remain <= 0)
         {
           return next ? next : remain;
@@ -371,7 +900,7 @@ static off_t zipfs_seek(FAR struct file *filep, off_t offset,
 {
   FAR struct zipfs_mountpt_s *fs = filep->f_inode->i_private;
   FAR struct zipfs_file_s *fp = filep->f_priv;
-  unz_file_info64 file_info;
+  FAR struct zipfs_point_s *point;
   off_t ret = 0;
 
   nxmutex_lock(&fp->lock);
@@ -383,53 +912,69 @@ static off_t zipfs_seek(FAR struct file *filep, off_t offset,
         offset += filep->f_pos;
         break;
       case SEEK_END:
-        ret = unzGetCurrentFileInfo64(fp->uf, &file_info,
-                                      NULL, 0, NULL, 0, NULL, 0);
-        ret = zipfs_convert_result(ret);
-        if (ret < 0)
-          {
-            goto err_with_lock;
-          }
-
-          offset += file_info.uncompressed_size;
+        offset += fp->entry->usize;
         break;
       default:
         ret = -EINVAL;
         goto err_with_lock;
     }
 
+  if (offset < 0)
+    {
+      ret = -EINVAL;
+      goto err_with_lock;
+    }
+
   if (filep->f_pos == offset)
     {
       goto err_with_lock;
     }
-  else if (filep->f_pos > offset)
+  else if (fp->uf != NULL)
     {
-      ret = zipfs_convert_result(unzClose(fp->uf));
-      if (ret < 0)
-        {
-          goto err_with_lock;
-        }
+      /* minizip can only go forward, start over to go backward */
 
-      fp->uf = unzOpen2_64(fs->abspath, &zipfs_real_ops);
-      if (fp->uf == NULL)
+      if (filep->f_pos > offset)
         {
-          ret = -EINVAL;
-          goto err_with_lock;
+          ret = zipfs_convert_result(unzClose(fp->uf));
+          if (ret < 0)
+            {
+              goto err_with_lock;
+            }
+
+          ret = zipfs_open_unzip(fs, fp);
+          if (ret < 0)
+            {
+              goto err_with_lock;
+            }
+
+          filep->f_pos = 0;
         }
+    }
+  else if (fp->inbuf == NULL)
+    {
+      /* Stored data is addressed directly */
 
-      ret = zipfs_convert_result(unzLocateFile(fp->uf, fp->relpath, 0));
-      if (ret < 0)
-        {
-          goto err_with_lock;
-        }
+      fp->out = MIN(offset, fp->entry->usize);
+      filep->f_pos = fp->out;
+      goto err_with_lock;
+    }
+  else
+    {
+      /* Resume inflating from the nearest checkpoint before the offset if
+       * the offset is behind or the checkpoint is ahead.
+       */
 
-      ret = zipfs_convert_result(unzOpenCurrentFile(fp->uf));
-      if (ret < 0)
+      point = zipfs_find_point(fp, offset);
+      if (offset < fp->out || (point != NULL && point->out > fp->out))
         {
-          goto err_with_lock;
+          ret = zipfs_resume(fp, point);
+          if (ret < 0)
+            {
+              goto err_with_lock;
+            }
         }
 
-      filep->f_pos = 0;
+      filep->f_pos = fp->out;
     }
 
   ret = zipfs_skip(fp, offset - filep->f_pos);
@@ -453,26 +998,15 @@ static int zipfs_dup(FAR const struct file *oldp, FAR struct file *newp)
   FAR struct zipfs_file_s *fp;
 
   fp = oldp->f_priv;
-  return zipfs_open(newp, fp->relpath, oldp->f_oflags, 0);
+  return zipfs_open(newp, fp->entry->name, oldp->f_oflags, 0);
 }
 
-static int zipfs_stat_common(unzFile uf, FAR struct stat *buf)
+static void zipfs_stat_common(FAR struct zipfs_entry_s *entry,
+                              FAR struct stat *buf)
 {
-  unz_file_info64 file_info;
-  int ret;
-
   memset(buf, 0, sizeof(struct stat));
-
-  ret = unzGetCurrentFileInfo64(uf, &file_info, NULL, 0,
-                                NULL, 0, NULL, 0);
-  ret = zipfs_convert_result(ret);
-  if (ret >= 0)
-    {
-      buf->st_size = file_info.uncompressed_size;
-      buf->st_mode = S_IFREG | 0444;
-    }
-
-  return ret;
+  buf->st_size = entry->usize;
+  buf->st_mode = S_IFREG | 0444;
 }
 
 static int zipfs_fstat(FAR const struct file *filep,
@@ -480,7 +1014,8 @@ static int zipfs_fstat(FAR const struct file *filep,
 {
   FAR struct zipfs_file_s *fp = filep->f_priv;
 
-  return zipfs_stat_common(fp->uf, buf);
+  zipfs_stat_common(fp->entry, buf);
+  return OK;
 }
 
 static int zipfs_opendir(FAR struct inode *mountpt, FAR const char *relpath,
@@ -604,6 +1139,7 @@ static int zipfs_bind(FAR struct inode *driver, FAR const void *data,
     }
 
   unzClose(uf);
+  nxmutex_init(&fs->lock);
   strcpy(fs->abspath, data);
   *handle = fs;
 
@@ -613,7 +1149,15 @@ static int zipfs_bind(FAR struct inode *driver, FAR const void *data,
 static int zipfs_unbind(FAR void *handle, FAR struct inode **driver,
                         unsigned int flags)
 {
-  fs_heap_free(handle);
+  FAR struct zipfs_mountpt_s *fs = handle;
+
+  if (fs->entries != NULL)
+    {
+      zipfs_free_entries(fs->entries, fs->nentries);
+    }
+
+  nxmutex_destroy(&fs->lock);
+  fs_heap_free(fs);
   return OK;
 }
 
@@ -628,7 +1172,7 @@ static int zipfs_stat(FAR struct inode *mountpt,
                       FAR const char *relpath, FAR struct stat *buf)
 {
   FAR struct zipfs_mountpt_s *fs;
-  unzFile uf;
+  FAR struct zipfs_entry_s *entry;
   int ret;
 
   /* Sanity checks */
@@ -642,21 +1186,11 @@ static int zipfs_stat(FAR struct inode *mountpt,
     }
 
   fs = mountpt->i_private;
-  uf = unzOpen2_64(fs->abspath, &zipfs_real_ops);
-  if (uf == NULL)
-    {
-      return -EINVAL;
-    }
-
-  ret = zipfs_convert_result(unzLocateFile(uf, relpath, 0));
-  if (ret < 0)
+  ret = zipfs_find_entry(fs, relpath, &entry);
+  if (ret >= 0)
     {
-      unzClose(uf);
-      return ret;
+      zipfs_stat_common(entry, buf);
     }
 
-  ret = zipfs_stat_common(uf, buf);
-
-  unzClose(uf);
   return ret;
 }
@@ -259,6 +259,59 @@ struct file_operations
  */
 
 struct inode;
+
+/* Asynchronous block request, see block_submit().  Requests merged into a
+ * request by block_plug_add() are linked through 'merged', they have the
+ * same operation and follow each other on the media.  'done' is called
+ * once for every request of a chain, possibly from an interrupt handler,
+ * with 'result' set to the number of sectors transferred or to a negated
+ * errno value.
+ */
+
+#define BLOCK_REQ_READ    0  /* Read sectors into buffer */
+#define BLOCK_REQ_WRITE   1  /* Write sectors from buffer */
+#define BLOCK_REQ_FLUSH   2  /* Flush the volatile write cache */
+
+struct block_request_s;
+typedef CODE void (*block_done_t)(FAR struct block_request_s *req);
+
+struct block_request_s
+{
+  FAR struct block_request_s *flink;  /* Queue of the plug or the driver */
+  FAR struct block_request_s *merged; /* Next request of the chain */
+  FAR unsigned char *buffer;          /* Data of the request */
+  blkcnt_t sector;                    /* First sector */
+  unsigned int nsectors;              /* Number of sectors */
+  uint8_t op;                         /* BLOCK_REQ_* */
+  ssize_t result;                     /* Sectors transferred or -errno */
+  block_done_t done;                  /* Completion callback */
+  FAR void *priv;                     /* For use by the submitter */
+};
+
+/* Requests collected before they are submitted, adjacent requests are
+ * merged into chains of at most 'maxsectors' sectors.
+ */
+
+struct block_plug_s
+{
+  FAR struct inode *inode;            /* The block driver */
+  FAR struct block_request_s *head;   /* First chain */
+  FAR struct block_request_s *tail;   /* Last chain */
+  FAR struct block_request_s *last;   /* Last request of the last chain */
+  unsigned int nsectors;              /* Sectors in the last chain */
+  unsigned int maxsectors;            /* Largest chain */
+};
+
+/* A plug whose requests are waited for together */
+
+struct block_batch_s
+{
+  struct block_plug_s plug;           /* The requests not yet submitted */
+  sem_t done;                         /* Posted by every completion */
+  unsigned int count;                 /* Number of requests added */
+  int error;                          /* First error of the requests */
+};
+
 struct block_operations
 {
   CODE int     (*open)(FAR struct inode *inode);
@@ -274,8 +327,24 @@ struct block_operations
 #ifndef CONFIG_DISABLE_PSEUDOFS_OPERATIONS
   CODE int     (*unlink)(FAR struct inode *inode);
 #endif
+
+  /* Start a chain of requests without waiting for it, NULL if the driver
+   * only supports read and write.  Use block_submit().
+   */
+
+  CODE int     (*submit)(FAR struct inode *inode,
+                         FAR struct block_request_s *req);
 };
 
+/* Flags for the flags field of struct mountpt_operations:
+ *
+ *   MNTPT_FLAG_DCACHE - The names of the volume change only through the
+ *     VFS, so the VFS may remember the names that do not exist.  Remote
+ *     file systems must not set this flag.
+ */
+
+#define MNTPT_FLAG_DCACHE (1 << 0)
+
 /* This structure is provided by a filesystem to describe a mount point.
  * Note that this structure differs from file_operations ONLY in the form of
  * the open method.  Once the file is opened, it can be accessed either as a
@@ -360,6 +429,8 @@ struct mountpt_operations
   CODE int     (*chstat)(FAR struct inode *mountpt, FAR const char *relpath,
                          FAR const struct stat *buf, int flags);
   CODE int     (*syncfs)(FAR struct inode *mountpt);
+
+  uint32_t     flags;           /* See MNTPT_FLAG_* definitions */
 };
 #endif /* CONFIG_DISABLE_MOUNTPOINT */
 
@@ -488,13 +559,40 @@ struct fd
  * You can get file instance in filelist by the follow methods:
  * (file descriptor / CONFIG_NFILE_DESCRIPTORS_PER_BLOCK) as row index and
  * (file descriptor % CONFIG_NFILE_DESCRIPTORS_PER_BLOCK) as column index.
+ *
+ * fl_lock serializes the changes of the list.  Lookups do not take it,
+ * they run with interrupts disabled and make the sequence in fl_readers of
+ * their CPU odd meanwhile.  A change waits only for the lookups that were
+ * in progress when it was made before it drops the reference of a
+ * replaced file or frees a replaced array.
  */
 
+#define FDLIST_BITMAP_WORDS(rows) \
+  (((rows) * CONFIG_NFILE_DESCRIPTORS_PER_BLOCK + 31) / 32)
+
+/* The lookup sequence of each CPU has a cache line of its own */
+
+#ifndef FDLIST_CACHELINE_SIZE
+#  define FDLIST_CACHELINE_SIZE 64
+#endif
+
+#ifdef CONFIG_SMP
+struct fdlist_reader_s
+{
+  atomic_t          fr_seq;     /* Odd while a lookup is in progress */
+  uint8_t           fr_pad[FDLIST_CACHELINE_SIZE - sizeof(atomic_t)];
+};
+#endif
+
 struct fdlist
 {
   spinlock_t        fl_lock;    /* Manage access to the file descriptor list */
   uint8_t           fl_rows;    /* The number of rows of fl_fds array */
   FAR struct fd   **fl_fds;     /* The pointer of two layer file descriptors array */
+  FAR uint32_t     *fl_bitmap;  /* One bit per descriptor in use */
+#ifdef CONFIG_SMP
+  struct fdlist_reader_s fl_readers[CONFIG_SMP_NCPUS]; /* Lookups per CPU */
+#endif
 
   /* Pre-allocated file descriptors to avoid allocator access during thread
    * creation phase, For functional safety requirements, increasing
@@ -504,6 +602,7 @@ struct fdlist
 
   FAR struct fd    *fl_prefd;
   struct fd         fl_prefds[CONFIG_NFILE_DESCRIPTORS_PER_BLOCK];
+  uint32_t          fl_prebitmap[FDLIST_BITMAP_WORDS(1)];
 };
 
 /* The following structure defines the list of files used for standard C I/O.
@@ -1061,6 +1160,24 @@ int fdlist_allocate(FAR struct fdlist *list, int oflags,
 
 int file_allocate(int oflags, int minfd, FAR struct file **filep);
 
+/****************************************************************************
+ * Name: fdlist_allocate_from_inode
+ *
+ * Description:
+ *   Allocate a struct fd instance in the given list and associate it with
+ *   an file instance.  And initialize them with inode, oflags, pos and
+ *   priv.
+ *
+ * Returned Value:
+ *   Returns the file descriptor == index into the files array on success;
+ *   a negated errno value is returned on any failure.
+ *
+ ****************************************************************************/
+
+int fdlist_allocate_from_inode(FAR struct fdlist *list,
+                               FAR struct inode *inode, int oflags,
+                               off_t pos, FAR void *priv, int minfd);
+
 /****************************************************************************
  * Name: file_allocate_from_inode
  *
@@ -1440,6 +1557,72 @@ int close_blockdriver(FAR struct inode *inode);
 int find_blockdriver(FAR const char *pathname, int mountflags,
                      FAR struct inode **ppinode);
 
+/****************************************************************************
+ * Name: block_submit
+ *
+ * Description:
+ *   Start a chain of block requests.  Drivers without a submit method
+ *   perform the requests before block_submit() returns.  The completion
+ *   callbacks are called for every request of the chain, also on failure.
+ *
+ * Input Parameters:
+ *   inode - The block driver
+ *   req   - The first request of the chain
+ *
+ * Returned Value:
+ *   Zero (OK) if the chain was started, a negated errno value if it was
+ *   completed with an error instead.
+ *
+ ****************************************************************************/
+
+int block_submit(FAR struct inode *inode, FAR struct block_request_s *req);
+
+/****************************************************************************
+ * Name: block_complete
+ *
+ * Description:
+ *   Used by the block drivers to complete 'count' requests of a chain
+ *   starting with 'req'.  The requests succeed with all their sectors if
+ *   'error' is zero.
+ *
+ ****************************************************************************/
+
+void block_complete(FAR struct block_request_s *req, unsigned int count,
+                    int error);
+
+/****************************************************************************
+ * Name: block_plug_init, block_plug_add, block_plug_flush
+ *
+ * Description:
+ *   Collect requests in a plug, merging each request with the previous one
+ *   if it continues it on the media, and submit them all at once with
+ *   block_plug_flush().  The first error of block_submit() is returned.
+ *
+ ****************************************************************************/
+
+void block_plug_init(FAR struct block_plug_s *plug, FAR struct inode *inode);
+void block_plug_add(FAR struct block_plug_s *plug,
+                    FAR struct block_request_s *req);
+int block_plug_flush(FAR struct block_plug_s *plug);
+
+/****************************************************************************
+ * Name: block_batch_init, block_batch_add, block_batch_wait
+ *
+ * Description:
+ *   Submit a number of requests together and wait for all of them.  The
+ *   requests may not be reused before block_batch_wait() returned, which
+ *   returns the first error of the requests.
+ *
+ ****************************************************************************/
+
+void block_batch_init(FAR struct block_batch_s *batch,
+                      FAR struct inode *inode);
+void block_batch_add(FAR struct block_batch_s *batch,
+                     FAR struct block_request_s *req, uint8_t op,
+                     FAR unsigned char *buffer, blkcnt_t sector,
+                     unsigned int nsectors);
+int block_batch_wait(FAR struct block_batch_s *batch);
+
 /****************************************************************************
  * Name: find_mtddriver
  *
@@ -101,6 +101,20 @@
 
 #endif /* __SIM__ */
 
+#ifdef CONFIG_FS_HOSTFS_ASYNC
+
+/* Operations of an asynchronous host request */
+
+#define HOST_AIO_OPEN           0  /* host_open(path, flags, mode) */
+#define HOST_AIO_READ           1  /* pread(fd, buf, count, offset) */
+#define HOST_AIO_WRITE          2  /* pwrite(), write() if offset < 0 */
+#define HOST_AIO_SYNC           3  /* host_sync(fd) */
+#define HOST_AIO_FSTAT          4  /* host_fstat(fd, buf) */
+#define HOST_AIO_STAT           5  /* host_stat(path, buf) */
+#define HOST_AIO_READDIR        6  /* Up to count host_readdir(dirp, buf) */
+
+#endif /* CONFIG_FS_HOSTFS_ASYNC */
+
 /****************************************************************************
  * Public Type Definitions
  ****************************************************************************/
@@ -192,6 +206,32 @@ struct nuttx_stat_s
 
 #endif /* __SIM__ */
 
+#ifdef CONFIG_FS_HOSTFS_ASYNC
+
+/* An asynchronous host request.  It is queued by host_aio_submit() and
+ * performed by a host thread, done() is called from host_aio_poll() once
+ * result holds the return value of the operation.  The layout uses only
+ * fixed size types, it is shared by the NuttX and the host side.
+ */
+
+struct host_aio_s
+{
+  struct host_aio_s *next;                  /* Submission/completion queue */
+  int                op;                    /* HOST_AIO_* */
+  int                fd;                    /* Host file descriptor */
+  int                flags;                 /* Open flags */
+  int                mode;                  /* Open mode */
+  const char        *path;                  /* Host path */
+  void              *dirp;                  /* Host directory */
+  void              *buf;                   /* Data, stat or dirent buffer */
+  uint64_t           count;                 /* Bytes or directory entries */
+  int64_t            offset;                /* File offset */
+  int64_t            result;                /* Return value of the request */
+  void             (*done)(struct host_aio_s *aio);
+};
+
+#endif /* CONFIG_FS_HOSTFS_ASYNC */
+
 /****************************************************************************
  * Public Function Prototypes
  ****************************************************************************/
@@ -248,4 +288,10 @@ int           host_chstat(const char *path,
                           const struct stat *buf, int flags);
 #endif /* __SIM__ */
 
+#ifdef CONFIG_FS_HOSTFS_ASYNC
+int           host_aio_submit(struct host_aio_s *aio);
+void          host_aio_poll(void);
+int           host_aio_irq(void);
+#endif
+
 #endif /* __INCLUDE_NUTTX_FS_HOSTFS_H */
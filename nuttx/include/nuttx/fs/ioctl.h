@@ -244,6 +244,11 @@
 #define FIOGCLEX            _FIOC(0x0018) /* IN:  FAR int *
                                            * OUT: None
                                            */
+#define FIOC_MEMREGION      _FIOC(0x0019) /* IN:  Pointer to struct
+                                           *      file_memregion_s
+                                           * OUT: Address and length of the
+                                           *      file data in memory
+                                           */
 
 /* NuttX file system ioctl definitions **************************************/
 
@@ -362,6 +367,17 @@
                                            * IN:  None
                                            * OUT: None (ioctl return value provides
                                            *      success/failure indication). */
+#define BIOC_CACHESIZE  _BIOC(0x0012)     /* Set the number of sectors cached by
+                                           * the block device (BCH only).
+                                           * IN:  Number of sectors
+                                           * OUT: None (ioctl return value provides
+                                           *      success/failure indication). */
+#define BIOC_FTLSTATS   _BIOC(0x0013)     /* Get the write statistics of an FTL
+                                           * block device.
+                                           * IN:  Pointer to writable instance
+                                           *      of struct ftl_stats_s
+                                           * OUT: Data return in user-provided
+                                           *      buffer. */
 
 /* NuttX MTD driver ioctl definitions ***************************************/
 
@@ -813,6 +829,19 @@ struct pipe_peek_s
   size_t size;
 };
 
+/* Argument of FIOC_MEMREGION: the file data at 'offset' can be read
+ * directly at 'addr' for 'len' bytes (zero at the end of the file).  The
+ * address stays valid until the file is closed, so only file systems whose
+ * file data never moves or changes (romfs XIP images) implement it.
+ */
+
+struct file_memregion_s
+{
+  off_t          offset;  /* IN:  Offset in the file */
+  FAR const void *addr;   /* OUT: Address of the data at offset */
+  size_t         len;     /* OUT: Contiguous bytes at addr */
+};
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
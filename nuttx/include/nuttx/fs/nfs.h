@@ -55,6 +55,7 @@
 #define NFSMNT_TIMEO             (1 << 3)      /* Set initial timeout */
 #define NFSMNT_RETRANS           (1 << 4)      /* Set number of request retries */
 #define NFSMNT_READDIRSIZE       (1 << 5)      /* Set readdir size */
+#define NFSMNT_NOAC              (1 << 6)      /* Disable attribute cache */
 
 /* Default PMAP port number to provide */
 
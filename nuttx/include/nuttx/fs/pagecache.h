@@ -0,0 +1,188 @@
+/****************************************************************************
+ * include/nuttx/fs/pagecache.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __INCLUDE_NUTTX_FS_PAGECACHE_H
+#define __INCLUDE_NUTTX_FS_PAGECACHE_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+
+#ifdef CONFIG_FS_PAGECACHE
+
+/****************************************************************************
+ * Public Type Declarations
+ ****************************************************************************/
+
+/* Statistics reported by /proc/fs/pagecache.  Hits and misses count
+ * sectors requested by pagecache_read(); readahead counts the sectors read
+ * from the media before they were requested.
+ */
+
+struct pagecache_stats_s
+{
+  uint32_t hits;        /* Sectors found in the cache */
+  uint32_t misses;      /* Sectors read from the media on request */
+  uint32_t readahead;   /* Sectors read ahead of the requests */
+  uint32_t writeback;   /* Dirty sectors written back to the media */
+  uint32_t evictions;   /* Pages reclaimed for other sectors or the heap */
+  size_t size;          /* Budget of the cache in bytes */
+  size_t used;          /* Bytes of sector data in the cache */
+  size_t dirty;         /* Bytes of sector data not yet written back */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#undef EXTERN
+#if defined(__cplusplus)
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+struct inode;
+
+/****************************************************************************
+ * Name: pagecache_read
+ *
+ * Description:
+ *   Read sectors of a block driver through the page cache.  Missing sectors
+ *   are read from the driver, together with a readahead window that grows
+ *   while the accesses to the driver remain sequential.
+ *
+ * Input Parameters:
+ *   inode    - The block driver inode
+ *   buffer   - The buffer that receives the data
+ *   start    - The first sector to read
+ *   nsectors - The number of sectors to read
+ *
+ * Returned Value:
+ *   The number of sectors read or a negated errno value on failure, the
+ *   same as the read method of the block driver.
+ *
+ ****************************************************************************/
+
+ssize_t pagecache_read(FAR struct inode *inode, FAR unsigned char *buffer,
+                       blkcnt_t start, unsigned int nsectors);
+
+/****************************************************************************
+ * Name: pagecache_write
+ *
+ * Description:
+ *   Write sectors of a block driver through the page cache.  The sectors
+ *   are written back to the driver later by the flusher work item, by
+ *   pagecache_flush() or when their pages are reclaimed.  Sectors that do
+ *   not fit in the cache are written to the driver immediately.
+ *
+ * Input Parameters:
+ *   inode    - The block driver inode
+ *   buffer   - The data to write
+ *   start    - The first sector to write
+ *   nsectors - The number of sectors to write
+ *
+ * Returned Value:
+ *   The number of sectors written or a negated errno value on failure, the
+ *   same as the write method of the block driver.
+ *
+ ****************************************************************************/
+
+ssize_t pagecache_write(FAR struct inode *inode,
+                        FAR const unsigned char *buffer, blkcnt_t start,
+                        unsigned int nsectors);
+
+/****************************************************************************
+ * Name: pagecache_flush
+ *
+ * Description:
+ *   Write back all dirty sectors of a block driver.  This is the fsync()
+ *   and syncfs() path of the filesystems using the page cache.
+ *
+ * Returned Value:
+ *   Zero (OK) on success.  A negated errno value is returned if a sector
+ *   could not be written back.  Sectors whose write back failed stay dirty
+ *   and are retried by the next write back.
+ *
+ ****************************************************************************/
+
+int pagecache_flush(FAR struct inode *inode);
+
+/****************************************************************************
+ * Name: pagecache_invalidate
+ *
+ * Description:
+ *   Write back the dirty sectors of a block driver, they may belong to
+ *   another user of the driver, and forget all of its sectors.  This must
+ *   be called before the block driver is closed for the last time by its
+ *   user.
+ *
+ * Returned Value:
+ *   Zero (OK) on success.  A negated errno value is returned if a sector
+ *   could not be written back.  Such sectors are lost.
+ *
+ ****************************************************************************/
+
+int pagecache_invalidate(FAR struct inode *inode);
+
+/****************************************************************************
+ * Name: pagecache_shrink
+ *
+ * Description:
+ *   Release clean pages to the heap.  This is called by the memory manager
+ *   when an allocation fails.  It never blocks: Nothing is released if the
+ *   cache is busy.
+ *
+ * Input Parameters:
+ *   size - The number of bytes wanted by the failed allocation
+ *
+ * Returned Value:
+ *   The number of bytes released to the heap.
+ *
+ ****************************************************************************/
+
+size_t pagecache_shrink(size_t size);
+
+/****************************************************************************
+ * Name: pagecache_stats
+ *
+ * Description:
+ *   Return a snapshot of the page cache statistics.
+ *
+ ****************************************************************************/
+
+void pagecache_stats(FAR struct pagecache_stats_s *stats);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONFIG_FS_PAGECACHE */
+#endif /* __INCLUDE_NUTTX_FS_PAGECACHE_H */
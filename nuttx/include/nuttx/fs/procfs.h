@@ -146,6 +146,12 @@ struct procfs_meminfo_entry_s
 #endif
 };
 
+/* This is the callback type used by procfs_foreach_meminfo() */
+
+typedef CODE void (*procfs_meminfo_handler_t)(
+                      FAR struct procfs_meminfo_entry_s *entry,
+                      FAR void *arg);
+
 /****************************************************************************
  * Public Function Prototypes
  ****************************************************************************/
@@ -293,6 +299,21 @@ void procfs_register_meminfo(FAR struct procfs_meminfo_entry_s *entry);
 
 void procfs_unregister_meminfo(FAR struct procfs_meminfo_entry_s *entry);
 
+/****************************************************************************
+ * Name: procfs_foreach_meminfo
+ *
+ * Description:
+ *   Call a handler for every registered meminfo entry.
+ *
+ * Input Parameters:
+ *   handler - Called with each entry
+ *   arg     - Opaque argument passed to the handler
+ *
+ ****************************************************************************/
+
+void procfs_foreach_meminfo(procfs_meminfo_handler_t handler,
+                            FAR void *arg);
+
 #undef EXTERN
 #ifdef __cplusplus
 }
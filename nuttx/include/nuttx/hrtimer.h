@@ -0,0 +1,258 @@
+/****************************************************************************
+ * include/nuttx/hrtimer.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __INCLUDE_NUTTX_HRTIMER_H
+#define __INCLUDE_NUTTX_HRTIMER_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/tree.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <nuttx/clock.h>
+
+#ifdef CONFIG_HRTIMER
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define HRTIMER_ISACTIVE(h) ((h)->active)
+
+/****************************************************************************
+ * Public Type Declarations
+ ****************************************************************************/
+
+/* Interpretation of the expiration time passed to hrtimer_start() */
+
+enum hrtimer_mode_e
+{
+  HRTIMER_MODE_ABS = 0,     /* Absolute CLOCK_MONOTONIC time in nanoseconds */
+  HRTIMER_MODE_REL          /* Relative delay in nanoseconds */
+};
+
+/* This is the form of the function that is called when the hrtimer
+ * expires.  It is called from the interrupt level.  'expired' is the
+ * expiration time that was requested.  A non-zero return value restarts
+ * the timer with that period (in nanoseconds) relative to 'expired', so
+ * periodic timers do not accumulate drift.
+ */
+
+struct hrtimer_s;
+typedef CODE uint64_t (*hrtimer_cb_t)(FAR struct hrtimer_s *hrtimer,
+                                      uint64_t expired);
+
+/* This is the internal representation of the hrtimer structure.  It is
+ * allocated by the user and must stay valid while the timer is active.
+ */
+
+struct hrtimer_s
+{
+  RB_ENTRY(hrtimer_s) node;  /* Node in the tree of pending timers */
+  hrtimer_cb_t func;         /* Function to execute when delay expires */
+  FAR void *arg;             /* Argument for the callback */
+  uint64_t expired;          /* Absolute expiration time in nanoseconds */
+  bool active;               /* True if queued in the pending tree */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#undef EXTERN
+#if defined(__cplusplus)
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Name: hrtimer_init
+ *
+ * Description:
+ *   Initialize an hrtimer before its first use.
+ *
+ * Input Parameters:
+ *   hrtimer - The hrtimer to be initialized
+ *   func    - The function to be called on expiration
+ *   arg     - The argument available to the callback as hrtimer->arg
+ *
+ ****************************************************************************/
+
+void hrtimer_init(FAR struct hrtimer_s *hrtimer, hrtimer_cb_t func,
+                  FAR void *arg);
+
+/****************************************************************************
+ * Name: hrtimer_start
+ *
+ * Description:
+ *   Queue an hrtimer.  If the timer is already active, it is restarted
+ *   with the new expiration time.  Expiration times in the past cause the
+ *   timer to expire as soon as possible.
+ *
+ * Input Parameters:
+ *   hrtimer - The hrtimer to be started
+ *   ns      - Absolute or relative expiration time in nanoseconds
+ *   mode    - Interpretation of ns, see enum hrtimer_mode_e
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success; a negated errno value is returned
+ *   on failure.
+ *
+ * Assumptions:
+ *   May be called from the interrupt level, including from the hrtimer
+ *   callback itself.
+ *
+ ****************************************************************************/
+
+int hrtimer_start(FAR struct hrtimer_s *hrtimer, uint64_t ns,
+                  enum hrtimer_mode_e mode);
+
+/****************************************************************************
+ * Name: hrtimer_cancel
+ *
+ * Description:
+ *   Dequeue an active hrtimer.  Cancelling an inactive hrtimer is not an
+ *   error.  The callback may still be running on another CPU, see
+ *   hrtimer_cancel_sync().
+ *
+ * Input Parameters:
+ *   hrtimer - The hrtimer to be cancelled
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success; a negated errno value is returned
+ *   on failure.
+ *
+ ****************************************************************************/
+
+int hrtimer_cancel(FAR struct hrtimer_s *hrtimer);
+
+/****************************************************************************
+ * Name: hrtimer_cancel_sync
+ *
+ * Description:
+ *   Same as hrtimer_cancel() but also wait for a callback of the hrtimer
+ *   that is running on another CPU.  Use it before freeing the hrtimer or
+ *   the data used by its callback.
+ *
+ * Input Parameters:
+ *   hrtimer - The hrtimer to be cancelled
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success; a negated errno value is returned
+ *   on failure.
+ *
+ * Assumptions:
+ *   Must not be called with a lock held that the callback takes, such as
+ *   the critical section.
+ *
+ ****************************************************************************/
+
+int hrtimer_cancel_sync(FAR struct hrtimer_s *hrtimer);
+
+/****************************************************************************
+ * Name: hrtimer_gettime
+ *
+ * Description:
+ *   Return the current CLOCK_MONOTONIC time in nanoseconds, the time base
+ *   of HRTIMER_MODE_ABS.
+ *
+ ****************************************************************************/
+
+uint64_t hrtimer_gettime(void);
+
+/****************************************************************************
+ * Name: hrtimer_remaining
+ *
+ * Description:
+ *   Return the time remaining in nanoseconds before an active hrtimer
+ *   expires, or zero if the timer is not active or is already due.
+ *
+ ****************************************************************************/
+
+uint64_t hrtimer_remaining(FAR const struct hrtimer_s *hrtimer);
+
+/****************************************************************************
+ * Name: hrtimer_process
+ *
+ * Description:
+ *   Run the callbacks of all hrtimers that expired at or before 'now' and
+ *   program the next expiration.  This is called by the platform-specific
+ *   logic when the expiration requested with up_hrtimer_start() occurs.
+ *
+ * Input Parameters:
+ *   now - The current CLOCK_MONOTONIC time in nanoseconds
+ *
+ * Assumptions:
+ *   Called from the interrupt level.
+ *
+ ****************************************************************************/
+
+void hrtimer_process(uint64_t now);
+
+/****************************************************************************
+ * Name: up_hrtimer_start
+ *
+ * Description:
+ *   Provided by the platform-specific logic (drivers/timers/arch_alarm.c).
+ *   Request a call to hrtimer_process() at the absolute time 'ns'.  A
+ *   value of UINT64_MAX means that no hrtimer is pending.
+ *
+ ****************************************************************************/
+
+int up_hrtimer_start(uint64_t ns);
+
+/****************************************************************************
+ * Inline Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: hrtimer_start_ts
+ *
+ * Description:
+ *   Same as hrtimer_start() but with the expiration time provided as a
+ *   struct timespec.
+ *
+ ****************************************************************************/
+
+static inline int hrtimer_start_ts(FAR struct hrtimer_s *hrtimer,
+                                   FAR const struct timespec *ts,
+                                   enum hrtimer_mode_e mode)
+{
+  return hrtimer_start(hrtimer, clock_time2nsec(ts), mode);
+}
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONFIG_HRTIMER */
+#endif /* __INCLUDE_NUTTX_HRTIMER_H */
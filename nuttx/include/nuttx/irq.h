@@ -285,7 +285,8 @@ int irqchain_detach(int irq, xcpt_t isr, FAR void *arg);
 
 #ifdef CONFIG_IRQCOUNT
 #  if CONFIG_SCHED_CRITMONITOR_MAXTIME_CSECTION >= 0 || \
-      defined(CONFIG_SCHED_INSTRUMENTATION_CSECTION)
+      defined(CONFIG_SCHED_INSTRUMENTATION_CSECTION) || \
+      defined(CONFIG_SCHED_LOCKSTAT)
 irqstate_t enter_critical_section(void) noinstrument_function;
 #  else
 #    define enter_critical_section() enter_critical_section_wo_note()
@@ -323,7 +324,8 @@ irqstate_t enter_critical_section_wo_note(void) noinstrument_function;
 
 #ifdef CONFIG_IRQCOUNT
 #  if CONFIG_SCHED_CRITMONITOR_MAXTIME_CSECTION >= 0 || \
-      defined(CONFIG_SCHED_INSTRUMENTATION_CSECTION)
+      defined(CONFIG_SCHED_INSTRUMENTATION_CSECTION) || \
+      defined(CONFIG_SCHED_LOCKSTAT)
 void leave_critical_section(irqstate_t flags) noinstrument_function;
 #  else
 #    define leave_critical_section(f) leave_critical_section_wo_note(f)
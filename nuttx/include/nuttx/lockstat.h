@@ -0,0 +1,110 @@
+/****************************************************************************
+ * include/nuttx/lockstat.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __INCLUDE_NUTTX_LOCKSTAT_H
+#define __INCLUDE_NUTTX_LOCKSTAT_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+
+#ifdef CONFIG_SCHED_LOCKSTAT
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Kinds of locks */
+
+#define LOCKSTAT_SEM      0  /* Counting semaphore */
+#define LOCKSTAT_MUTEX    1  /* Mutex (semaphore with the mutex flag) */
+#define LOCKSTAT_SPINLOCK 2  /* Spinlock */
+#define LOCKSTAT_CSECTION 3  /* Critical section, keyed by caller */
+
+/****************************************************************************
+ * Public Type Definitions
+ ****************************************************************************/
+
+/* Statistics of one lock.  All times are in perf_gettime() counts. */
+
+struct lockstat_s
+{
+  FAR const void *lock;       /* Lock address, NULL if the entry is free */
+  uint8_t type;               /* See LOCKSTAT_* definitions */
+  uint32_t acquired;          /* Number of acquisitions */
+  uint32_t contended;         /* Number of acquisitions that had to wait */
+  uint64_t wait_total;        /* Total time spent waiting */
+  clock_t wait_max;           /* Longest wait */
+  clock_t hold_max;           /* Longest hold (not for counting semaphores) */
+  clock_t hold_start;         /* Time of the current acquisition */
+#if CONFIG_SCHED_LOCKSTAT_BACKTRACE > 0
+  FAR void *backtrace[CONFIG_SCHED_LOCKSTAT_BACKTRACE]; /* Longest holder */
+#endif
+};
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+#undef EXTERN
+#if defined(__cplusplus)
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/* The table of tracked locks, indexed by a hash of the lock address */
+
+EXTERN struct lockstat_s g_lockstat[CONFIG_SCHED_LOCKSTAT_NENTRIES];
+
+/* Number of locks that could not be tracked because the table was full */
+
+EXTERN uint32_t g_lockstat_dropped;
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxsched_lockstat_reset
+ *
+ * Description:
+ *   Clear the statistics of all locks.
+ *
+ ****************************************************************************/
+
+void nxsched_lockstat_reset(void);
+
+#undef EXTERN
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* CONFIG_SCHED_LOCKSTAT */
+#endif /* __INCLUDE_NUTTX_LOCKSTAT_H */
@@ -129,6 +129,7 @@ struct iob_s
 
 #ifdef CONFIG_IOB_ALLOC
   iob_free_cb_t io_free;  /* Custom free callback */
+  FAR void     *io_freearg; /* Argument of io_free */
   FAR uint8_t  *io_data;
 #else
   uint8_t       io_data[CONFIG_IOB_BUFSIZE];
@@ -266,6 +267,19 @@ FAR struct iob_s *iob_alloc_dynamic(uint16_t size);
 
 FAR struct iob_s *iob_alloc_with_data(FAR void *data, uint16_t size,
                                       iob_free_cb_t free_cb);
+
+/****************************************************************************
+ * Name: iob_alloc_with_arg
+ *
+ * Description:
+ *   Like iob_alloc_with_data(), but free_cb receives 'arg' instead of the
+ *   payload address.  This lets the owner of the payload count the I/O
+ *   buffers that still reference it.
+ *
+ ****************************************************************************/
+
+FAR struct iob_s *iob_alloc_with_arg(FAR void *data, uint16_t size,
+                                     iob_free_cb_t free_cb, FAR void *arg);
 #endif
 
 /****************************************************************************
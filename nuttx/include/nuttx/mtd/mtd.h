@@ -150,6 +150,17 @@ struct mtd_erase_s
   uint32_t nblocks;     /* Number of blocks to be erased */
 };
 
+/* Write statistics of an FTL block device, returned by BIOC_FTLSTATS.
+ * nprogrammed / nwritten is the write amplification of the FTL.
+ */
+
+struct ftl_stats_s
+{
+  uint32_t nwritten;    /* Blocks written to the block device */
+  uint32_t nprogrammed; /* Blocks programmed into the flash */
+  uint32_t nerased;     /* Erase blocks erased */
+};
+
 /* This structure defines the interface to a simple memory technology device.
  * It will likely need to be extended in the future to support more complex
  * devices.
@@ -313,6 +324,8 @@ FAR struct mtd_dev_s *mtd_rwb_initialize(FAR struct mtd_dev_s *mtd);
  *              effect only when both O_DIRECT and O_SYNC are passed in
  *              simultaneously
  *
+ *           Both flags are ignored with CONFIG_FTL_LOGSTRUCT.
+ *
  ****************************************************************************/
 
 int ftl_initialize_by_path(FAR const char *path, FAR struct mtd_dev_s *mtd,
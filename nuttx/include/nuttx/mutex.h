@@ -36,8 +36,24 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
-#define NXMUTEX_INITIALIZER                                             \
-  {NXSEM_INITIALIZER(NXSEM_NO_MHOLDER, SEM_TYPE_MUTEX | SEM_PRIO_INHERIT)}
+/* A mutex has a single holder.  With pre-allocated holders, counting
+ * semaphores keep their holders in a list, the holder of a mutex is
+ * embedded in the mutex instead.
+ */
+
+#if defined(CONFIG_PRIORITY_INHERITANCE) && CONFIG_SEM_PREALLOCHOLDERS > 0
+#  define NXMUTEX_HAVE_HOLDER 1
+#endif
+
+#ifdef NXMUTEX_HAVE_HOLDER
+#  define NXMUTEX_INITIALIZER                                           \
+     {NXSEM_INITIALIZER(NXSEM_NO_MHOLDER,                               \
+                        SEM_TYPE_MUTEX | SEM_PRIO_INHERIT),             \
+      SEMHOLDER_INITIALIZER}
+#else
+#  define NXMUTEX_INITIALIZER                                           \
+     {NXSEM_INITIALIZER(NXSEM_NO_MHOLDER, SEM_TYPE_MUTEX | SEM_PRIO_INHERIT)}
+#endif
 
 #define NXRMUTEX_INITIALIZER   {NXMUTEX_INITIALIZER, 0}
 
@@ -48,6 +64,9 @@
 struct mutex_s
 {
   sem_t sem;
+#ifdef NXMUTEX_HAVE_HOLDER
+  struct semholder_s holder;  /* Priority inheritance holder of the mutex */
+#endif
 #if CONFIG_LIBC_MUTEX_BACKTRACE > 0
   FAR void *backtrace[CONFIG_LIBC_MUTEX_BACKTRACE];
 #endif
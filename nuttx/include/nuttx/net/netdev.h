@@ -1347,4 +1347,28 @@ int netdev_ipv6_foreach(FAR struct net_driver_s *dev,
 void netdev_statistics_log(FAR void *arg);
 #endif
 
+/****************************************************************************
+ * Name: netdev_statistics_foreach
+ *
+ * Description:
+ *   Call a handler for every registered network device with the network
+ *   locked, e.g. to sample the statistics of all devices.
+ *
+ * Input Parameters:
+ *   handler - Called with each device, a non-zero return value ends the
+ *             enumeration
+ *   arg     - Opaque argument passed to the handler
+ *
+ * Returned Value:
+ *   0 if all devices were enumerated, 1 if the handler ended it early.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NETDEV_STATISTICS
+int netdev_statistics_foreach(CODE int (*handler)(
+                                FAR struct net_driver_s *dev,
+                                FAR void *arg),
+                              FAR void *arg);
+#endif
+
 #endif /* __INCLUDE_NUTTX_NET_NETDEV_H */
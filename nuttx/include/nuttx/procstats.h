@@ -0,0 +1,183 @@
+/****************************************************************************
+ * include/nuttx/procstats.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __INCLUDE_NUTTX_PROCSTATS_H
+#define __INCLUDE_NUTTX_PROCSTATS_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* A read of /proc/stats at offset 0 returns one snapshot:  A struct
+ * procstats_hdr_s followed by records, each starting with a struct
+ * procstats_rec_s.  Readers must skip records of unknown types and the
+ * bytes of a record beyond the structures they know, using rec.size.
+ */
+
+#define PROCSTATS_MAGIC         0x5453584e /* "NXST" in little endian */
+#define PROCSTATS_VERSION       1
+
+/* Length of the names in the records, including the terminating NUL */
+
+#define PROCSTATS_NAMELEN       32
+
+/* Snapshot flags */
+
+#define PROCSTATS_FLAG_DELTA     (1 << 0) /* Only the changed records */
+#define PROCSTATS_FLAG_TRUNCATED (1 << 1) /* Records did not fit the buffer */
+
+/* Record types, the type of the id of the record in parentheses */
+
+#define PROCSTATS_TASK          1  /* Task or thread (pid) */
+#define PROCSTATS_CPU           2  /* CPU (CPU index) */
+#define PROCSTATS_HEAP          3  /* Heap (index in the meminfo list) */
+#define PROCSTATS_IOB           4  /* IOB pool (0) */
+#define PROCSTATS_NETDEV        5  /* Network device (device index) */
+#define PROCSTATS_GONE          6  /* Delta only: object removed (its id) */
+
+/* Writing one of these strings to an open /proc/stats file selects the
+ * kind of the following snapshots of that file.
+ */
+
+#define PROCSTATS_CMD_FULL      "full"
+#define PROCSTATS_CMD_DELTA     "delta"
+
+/****************************************************************************
+ * Public Type Definitions
+ ****************************************************************************/
+
+/* Header of a snapshot */
+
+struct procstats_hdr_s
+{
+  uint32_t magic;               /* PROCSTATS_MAGIC */
+  uint16_t version;             /* PROCSTATS_VERSION */
+  uint16_t flags;               /* See PROCSTATS_FLAG_* definitions */
+  uint32_t size;                /* Bytes of the snapshot with this header */
+  uint32_t nrecords;            /* Number of records that follow */
+  uint32_t seq;                 /* Snapshot number on this open file */
+  uint32_t reserved;
+  uint64_t uptime;              /* Time of the snapshot in microseconds */
+};
+
+/* Header of every record */
+
+struct procstats_rec_s
+{
+  uint16_t type;                /* See PROCSTATS_* record types */
+  uint16_t size;                /* Bytes of the record with this header */
+  uint32_t id;                  /* Object described by the record */
+};
+
+/* CPU load values are clock ticks of the last CPU load sampling period,
+ * 'active' out of 'total'.
+ */
+
+struct procstats_task_s
+{
+  struct procstats_rec_s rec;
+  int32_t  group;               /* Pid of the main thread of the task */
+  uint32_t flags;               /* TCB_FLAG_* */
+  uint8_t  state;               /* enum tstate_e */
+  uint8_t  priority;            /* Current priority */
+  uint8_t  cpu;                 /* CPU running or assigned */
+  uint8_t  reserved;
+  uint32_t stacksize;           /* Size of the stack in bytes */
+  uint32_t load_active;         /* Ticks while the task was running */
+  uint32_t load_total;          /* Ticks of the sampling period */
+  char     name[PROCSTATS_NAMELEN];
+};
+
+struct procstats_cpu_s
+{
+  struct procstats_rec_s rec;
+  uint32_t load_active;         /* Ticks while the CPU was not idle */
+  uint32_t load_total;          /* Ticks of the sampling period */
+};
+
+struct procstats_heap_s
+{
+  struct procstats_rec_s rec;
+  uint32_t total;               /* Size of the heap */
+  uint32_t used;                /* Bytes in allocated chunks */
+  uint32_t free;                /* Bytes in free chunks */
+  uint32_t maxused;             /* Largest amount ever allocated */
+  uint32_t maxfree;             /* Largest free chunk */
+  uint32_t nused;               /* Number of allocated chunks */
+  uint32_t nfree;               /* Number of free chunks */
+  uint32_t reserved;
+  char     name[PROCSTATS_NAMELEN];
+};
+
+struct procstats_iob_s
+{
+  struct procstats_rec_s rec;
+  int32_t  ntotal;              /* Number of IOBs */
+  int32_t  nfree;               /* Number of free IOBs */
+  int32_t  nwait;               /* Number of tasks waiting for an IOB */
+  int32_t  nthrottle;           /* Free IOBs left when throttled */
+};
+
+/* The id of a network device is its interface index with
+ * CONFIG_NETDEV_IFINDEX, otherwise its position in the list of devices.
+ */
+
+struct procstats_netdev_s
+{
+  struct procstats_rec_s rec;
+  uint32_t flags;               /* IFF_* flags of the device */
+  uint32_t rx_packets;          /* Packets received */
+  uint32_t rx_errors;           /* Receive errors */
+  uint32_t rx_dropped;          /* Unsupported packets received */
+  uint32_t tx_packets;          /* Packets queued for transmission */
+  uint32_t tx_done;             /* Packets sent */
+  uint32_t tx_errors;           /* Transmit errors */
+  uint32_t tx_timeouts;         /* Transmit timeouts */
+  uint32_t errors;              /* All errors */
+  uint32_t reserved;
+  uint64_t rx_bytes;            /* Bytes received */
+  uint64_t tx_bytes;            /* Bytes sent */
+  char     name[PROCSTATS_NAMELEN];
+};
+
+/* A delta snapshot reports an object of the previous snapshot that no
+ * longer exists with a record of this type whose id is the id of the
+ * object.
+ */
+
+struct procstats_gone_s
+{
+  struct procstats_rec_s rec;
+  uint16_t type;                /* Record type of the removed object */
+  uint16_t reserved;
+  uint32_t reserved2;
+};
+
+#endif /* __INCLUDE_NUTTX_PROCSTATS_H */
@@ -404,6 +404,22 @@ struct stackinfo_s
                                          /* from the stack.                  */
 };
 
+/* struct latmon_hist_s *****************************************************/
+
+/* Log2 histogram of scheduling latencies in perf_gettime() counts.  Bucket
+ * N holds the delays in the range [2^N, 2^(N+1)).
+ */
+
+#ifdef CONFIG_SCHED_LATENCYMON
+struct latmon_hist_s
+{
+  uint32_t count;                        /* Number of samples               */
+  clock_t  max;                          /* Largest delay seen              */
+  uint64_t total;                        /* Sum of all delays               */
+  uint32_t bucket[CONFIG_SCHED_LATENCYMON_NBUCKETS];
+};
+#endif
+
 /* struct task_join_s *******************************************************/
 
 /* Used to save task join information */
@@ -691,6 +707,14 @@ struct tcb_s
   void   *crit_max_caller;               /* Caller of max critical section  */
 #endif
 
+  /* Scheduling latency monitor support ************************************/
+
+#ifdef CONFIG_SCHED_LATENCYMON
+  clock_t wakeup_start;                  /* Time thread was made ready      */
+  clock_t wakeup_irqstart;               /* IRQ entry time of the wakeup    */
+  struct latmon_hist_s wakeup_latency;   /* Wakeup-to-run histogram         */
+#endif
+
   /* State save areas *******************************************************/
 
   /* The form and content of these fields are platform-specific.            */
@@ -847,6 +871,18 @@ EXTERN clock_t g_preemp_max[CONFIG_SMP_NCPUS];
 EXTERN clock_t g_crit_max[CONFIG_SMP_NCPUS];
 #endif /* CONFIG_SCHED_CRITMONITOR_MAXTIME_CSECTION >= 0 */
 
+/* Per-CPU, per-priority band scheduling latency histograms. */
+
+#ifdef CONFIG_SCHED_LATENCYMON
+#  define LATMON_NPRIOBANDS \
+     ((SCHED_PRIORITY_MAX >> CONFIG_SCHED_LATENCYMON_PRIOSHIFT) + 1)
+
+EXTERN struct latmon_hist_s
+g_latmon_wakeup[CONFIG_SMP_NCPUS][LATMON_NPRIOBANDS];
+EXTERN struct latmon_hist_s
+g_latmon_irq[CONFIG_SMP_NCPUS][LATMON_NPRIOBANDS];
+#endif
+
 /* g_running_tasks[] holds a references to the running task for each CPU.
  * It is valid only when up_interrupt_context() returns true.
  */
@@ -1646,6 +1682,18 @@ void nxsched_dumponexit(void);
 #  define nxsched_dumponexit()
 #endif /* CONFIG_SCHED_DUMP_ON_EXIT */
 
+/****************************************************************************
+ * Name: nxsched_latmon_reset
+ *
+ * Description:
+ *   Clear the global and all per-task scheduling latency histograms.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SCHED_LATENCYMON
+void nxsched_latmon_reset(void);
+#endif
+
 #ifdef CONFIG_SMP
 /****************************************************************************
  * Name: nxsched_smp_call_handler
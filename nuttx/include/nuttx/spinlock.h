@@ -80,7 +80,8 @@ extern "C"
 #endif
 
 #if !defined(__SP_UNLOCK_FUNCTION) && (defined(CONFIG_TICKET_SPINLOCK) || \
-     defined(CONFIG_SCHED_INSTRUMENTATION_SPINLOCKS))
+     defined(CONFIG_SCHED_INSTRUMENTATION_SPINLOCKS) || \
+     defined(CONFIG_SCHED_LOCKSTAT_SPINLOCK))
 #  define __SP_UNLOCK_FUNCTION 1
 #endif
 
@@ -100,6 +101,15 @@ void sched_note_spinlock_unlock(FAR volatile spinlock_t *spinlock);
 #  define sched_note_spinlock_unlock(spinlock)
 #endif
 
+#ifdef CONFIG_SCHED_LOCKSTAT_SPINLOCK
+clock_t sched_lockstat_spinlock_lock(FAR volatile spinlock_t *spinlock);
+void sched_lockstat_spinlock_locked(FAR volatile spinlock_t *spinlock,
+                                    clock_t start);
+clock_t sched_lockstat_spinlock_unlock(FAR volatile spinlock_t *spinlock);
+void sched_lockstat_spinlock_unlocked(FAR volatile spinlock_t *spinlock,
+                                      clock_t hold);
+#endif
+
 /****************************************************************************
  * Public Data Types
  ****************************************************************************/
@@ -253,6 +263,10 @@ static inline_function void spin_lock_notrace(FAR volatile spinlock_t *lock)
 #ifdef CONFIG_SPINLOCK
 static inline_function void spin_lock(FAR volatile spinlock_t *lock)
 {
+#ifdef CONFIG_SCHED_LOCKSTAT_SPINLOCK
+  clock_t start = sched_lockstat_spinlock_lock(lock);
+#endif
+
   /* Notify that we are waiting for a spinlock */
 
   sched_note_spinlock_lock(lock);
@@ -264,6 +278,10 @@ static inline_function void spin_lock(FAR volatile spinlock_t *lock)
   /* Notify that we have the spinlock */
 
   sched_note_spinlock_locked(lock);
+
+#ifdef CONFIG_SCHED_LOCKSTAT_SPINLOCK
+  sched_lockstat_spinlock_locked(lock, start);
+#endif
 }
 #else
 #  define spin_lock(lock)
@@ -347,6 +365,9 @@ static inline_function bool spin_trylock(FAR volatile spinlock_t *lock)
       /* Notify that we have the spinlock */
 
       sched_note_spinlock_locked(lock);
+#ifdef CONFIG_SCHED_LOCKSTAT_SPINLOCK
+      sched_lockstat_spinlock_locked(lock, 0);
+#endif
     }
   else
     {
@@ -417,6 +438,10 @@ spin_unlock_notrace(FAR volatile spinlock_t *lock)
 #  ifdef __SP_UNLOCK_FUNCTION
 static inline_function void spin_unlock(FAR volatile spinlock_t *lock)
 {
+#ifdef CONFIG_SCHED_LOCKSTAT_SPINLOCK
+  clock_t hold = sched_lockstat_spinlock_unlock(lock);
+#endif
+
   /* Unlock without trace note */
 
   spin_unlock_notrace(lock);
@@ -424,6 +449,13 @@ static inline_function void spin_unlock(FAR volatile spinlock_t *lock)
   /* Notify that we are unlocking the spinlock */
 
   sched_note_spinlock_unlock(lock);
+
+#ifdef CONFIG_SCHED_LOCKSTAT_SPINLOCK
+  if (hold != 0)
+    {
+      sched_lockstat_spinlock_unlocked(lock, hold);
+    }
+#endif
 }
 #  else
 #    define spin_unlock(l)  do { *(l) = SP_UNLOCKED; } while (0)
@@ -506,6 +538,9 @@ static inline_function
 irqstate_t spin_lock_irqsave(FAR volatile spinlock_t *lock)
 {
   irqstate_t flags;
+#ifdef CONFIG_SCHED_LOCKSTAT_SPINLOCK
+  clock_t start = sched_lockstat_spinlock_lock(lock);
+#endif
 
   /* Notify that we are waiting for a spinlock */
 
@@ -519,6 +554,10 @@ irqstate_t spin_lock_irqsave(FAR volatile spinlock_t *lock)
 
   sched_note_spinlock_locked(lock);
 
+#ifdef CONFIG_SCHED_LOCKSTAT_SPINLOCK
+  sched_lockstat_spinlock_locked(lock, start);
+#endif
+
   return flags;
 }
 #else
@@ -743,6 +782,10 @@ void spin_unlock_irqrestore_notrace(FAR volatile spinlock_t *lock,
 static inline_function
 void spin_unlock_irqrestore(FAR volatile spinlock_t *lock, irqstate_t flags)
 {
+#ifdef CONFIG_SCHED_LOCKSTAT_SPINLOCK
+  clock_t hold = sched_lockstat_spinlock_unlock(lock);
+#endif
+
   /* Unlock without trace note */
 
   spin_unlock_irqrestore_notrace(lock, flags);
@@ -750,6 +793,17 @@ void spin_unlock_irqrestore(FAR volatile spinlock_t *lock, irqstate_t flags)
   /* Notify that we are unlocking the spinlock */
 
   sched_note_spinlock_unlock(lock);
+
+#ifdef CONFIG_SCHED_LOCKSTAT_SPINLOCK
+  /* Save the backtrace of a new longest holder only now that the lock is
+   * released.
+   */
+
+  if (hold != 0)
+    {
+      sched_lockstat_spinlock_unlocked(lock, hold);
+    }
+#endif
 }
 #else
 #  define spin_unlock_irqrestore(l, f) ((void)(l), up_irq_restore(f))
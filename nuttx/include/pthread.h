@@ -348,9 +348,16 @@ typedef struct pthread_mutex_s pthread_mutex_t;
 #define PTHREAD_MUTEX_DEFAULT_PRIO_FLAGS (PTHREAD_MUTEX_DEFAULT_PRIO_INHERIT | \
                                           PTHREAD_MUTEX_DEFAULT_PRIO_PROTECT)
 
-#define PTHREAD_NXMUTEX_INITIALIZER  {                                    \
-    NXSEM_INITIALIZER(NXSEM_NO_MHOLDER,                                   \
-                      SEM_TYPE_MUTEX | PTHREAD_MUTEX_DEFAULT_PRIO_FLAGS)}
+#ifdef NXMUTEX_HAVE_HOLDER
+#  define PTHREAD_NXMUTEX_INITIALIZER  {                                  \
+      NXSEM_INITIALIZER(NXSEM_NO_MHOLDER,                                 \
+                        SEM_TYPE_MUTEX | PTHREAD_MUTEX_DEFAULT_PRIO_FLAGS), \
+      SEMHOLDER_INITIALIZER}
+#else
+#  define PTHREAD_NXMUTEX_INITIALIZER  {                                  \
+      NXSEM_INITIALIZER(NXSEM_NO_MHOLDER,                                 \
+                        SEM_TYPE_MUTEX | PTHREAD_MUTEX_DEFAULT_PRIO_FLAGS)}
+#endif
 #define PTHREAD_NXRMUTEX_INITIALIZER {PTHREAD_NXMUTEX_INITIALIZER, 0}
 
 #if defined(CONFIG_PTHREAD_MUTEX_TYPES) && !defined(CONFIG_PTHREAD_MUTEX_UNSAFE)
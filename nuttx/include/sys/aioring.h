@@ -0,0 +1,226 @@
+/****************************************************************************
+ * include/sys/aioring.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __INCLUDE_SYS_AIORING_H
+#define __INCLUDE_SYS_AIORING_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Operations (aioring_sqe_s::opcode) */
+
+#define AIORING_OP_NOP        0  /* Complete immediately with 0 */
+#define AIORING_OP_READ       1  /* pread(), or read() if off is -1 */
+#define AIORING_OP_WRITE      2  /* pwrite(), or write() if off is -1 */
+#define AIORING_OP_FSYNC      3  /* fsync() */
+#define AIORING_OP_POLL       4  /* Wait for the poll events in opflags */
+#define AIORING_OP_ACCEPT     5  /* accept4() with the SOCK_* in opflags */
+#define AIORING_OP_RECV       6  /* recv() with the MSG_* in opflags */
+#define AIORING_OP_SEND       7  /* send() with the MSG_* in opflags */
+
+/* Submission flags (aioring_sqe_s::flags) */
+
+#define AIORING_SQE_LINK      (1 << 0) /* Run the next entry after this one
+                                        * and cancel it if this one fails */
+
+/* aioring_enter() flags */
+
+#define AIORING_ENTER_GETEVENTS (1 << 0) /* Wait for min_complete entries */
+
+/* Maximum number of submission queue entries of a ring */
+
+#define AIORING_MAX_ENTRIES   256
+
+/****************************************************************************
+ * Public Type Definitions
+ ****************************************************************************/
+
+/* Submission queue entry, filled in by the application */
+
+struct aioring_sqe_s
+{
+  uint8_t opcode;               /* One of AIORING_OP_* */
+  uint8_t flags;                /* AIORING_SQE_* */
+  uint16_t reserved;
+  int32_t fd;                   /* File or socket descriptor */
+  off_t off;                    /* File offset, -1 for the file position */
+  FAR void *addr;               /* Buffer of READ/WRITE/RECV/SEND */
+  uint32_t len;                 /* Size of the buffer */
+  uint32_t opflags;             /* POLL events, MSG_* or SOCK_* flags */
+  uint64_t user_data;           /* Copied to the completion */
+};
+
+/* Completion queue entry, filled in by the worker that ran the entry */
+
+struct aioring_cqe_s
+{
+  uint64_t user_data;           /* aioring_sqe_s::user_data */
+  int32_t res;                  /* Result or a negated errno value */
+  uint32_t flags;               /* Reserved */
+};
+
+/* The ring shared by the application and the kernel.  The application
+ * produces at sq_tail and consumes at cq_head; the kernel consumes at
+ * sq_head and produces at cq_tail.  The indices are free running, the
+ * entries are at index & mask.
+ */
+
+struct aioring_s
+{
+  volatile uint32_t sq_head;    /* Next entry consumed by the kernel */
+  volatile uint32_t sq_tail;    /* Next entry produced by the application */
+  uint32_t sq_mask;             /* Number of submission entries - 1 */
+  volatile uint32_t cq_head;    /* Next completion to be reaped */
+  volatile uint32_t cq_tail;    /* Next completion produced by the kernel */
+  uint32_t cq_mask;             /* Number of completion entries - 1 */
+  FAR struct aioring_sqe_s *sqes;
+  FAR struct aioring_cqe_s *cqes;
+};
+
+/****************************************************************************
+ * Inline Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: aioring_get_sqe
+ *
+ * Description:
+ *   Return the next free submission queue entry or NULL if the submission
+ *   queue is full.  The entry is queued by aioring_enter().
+ *
+ ****************************************************************************/
+
+static inline FAR struct aioring_sqe_s *
+aioring_get_sqe(FAR struct aioring_s *ring)
+{
+  uint32_t head = __atomic_load_n(&ring->sq_head, __ATOMIC_ACQUIRE);
+  uint32_t tail = ring->sq_tail;
+  FAR struct aioring_sqe_s *sqe;
+
+  if (tail - head > ring->sq_mask)
+    {
+      return NULL;
+    }
+
+  sqe = &ring->sqes[tail & ring->sq_mask];
+  __atomic_store_n(&ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  return sqe;
+}
+
+/****************************************************************************
+ * Name: aioring_peek_cqe
+ *
+ * Description:
+ *   Return the oldest completion not yet reaped or NULL if there is none.
+ *   This does not enter the kernel.
+ *
+ ****************************************************************************/
+
+static inline FAR struct aioring_cqe_s *
+aioring_peek_cqe(FAR struct aioring_s *ring)
+{
+  uint32_t tail = __atomic_load_n(&ring->cq_tail, __ATOMIC_ACQUIRE);
+  uint32_t head = ring->cq_head;
+
+  if (head == tail)
+    {
+      return NULL;
+    }
+
+  return &ring->cqes[head & ring->cq_mask];
+}
+
+/****************************************************************************
+ * Name: aioring_cqe_seen
+ *
+ * Description:
+ *   Release the completion returned by aioring_peek_cqe().
+ *
+ ****************************************************************************/
+
+static inline void aioring_cqe_seen(FAR struct aioring_s *ring)
+{
+  __atomic_store_n(&ring->cq_head, ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Name: aioring_setup
+ *
+ * Description:
+ *   Create a ring with room for 'entries' submissions (rounded up to a
+ *   power of two) and twice as many completions.  The ring is allocated in
+ *   the memory of the caller and is valid until the returned descriptor is
+ *   closed.
+ *
+ * Returned Value:
+ *   The ring descriptor on success; -1 with errno set on failure.
+ *
+ ****************************************************************************/
+
+int aioring_setup(unsigned int entries, FAR struct aioring_s **ring);
+
+/****************************************************************************
+ * Name: aioring_enter
+ *
+ * Description:
+ *   Queue up to 'to_submit' entries of the submission queue to the AIO
+ *   workers and, with AIORING_ENTER_GETEVENTS, wait until at least
+ *   'min_complete' completions can be reaped.
+ *
+ * Returned Value:
+ *   The number of entries submitted on success; -1 with errno set on
+ *   failure.  EBUSY means that no entry could be submitted because the
+ *   completion queue would overflow.
+ *
+ ****************************************************************************/
+
+int aioring_enter(int fd, unsigned int to_submit, unsigned int min_complete,
+                  unsigned int flags);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __INCLUDE_SYS_AIORING_H */
@@ -209,6 +209,10 @@ SYSCALL_LOOKUP(pwrite,                     4)
   SYSCALL_LOOKUP(aio_write,                1)
   SYSCALL_LOOKUP(aio_fsync,                2)
   SYSCALL_LOOKUP(aio_cancel,               2)
+#endif
+#ifdef CONFIG_FS_AIO_RING
+  SYSCALL_LOOKUP(aioring_setup,            2)
+  SYSCALL_LOOKUP(aioring_enter,            4)
 #endif
   SYSCALL_LOOKUP(poll,                     3)
   SYSCALL_LOOKUP(select,                   5)
@@ -90,6 +90,10 @@ int nxmutex_init(FAR mutex_t *mutex)
       return ret;
     }
 
+#ifdef NXMUTEX_HAVE_HOLDER
+  INITIALIZE_SEMHOLDER(&mutex->holder);
+#endif
+
 #ifdef CONFIG_PRIORITY_INHERITANCE
   nxsem_set_protocol(&mutex->sem, SEM_TYPE_MUTEX | SEM_PRIO_INHERIT);
 #else
@@ -139,6 +139,14 @@ int nxsem_trywait(FAR sem_t *sem)
     }
 #endif
 
+  /* Disable fast path if lock statistics are collected, they are only
+   * accounted in the slow path
+   */
+
+#ifdef CONFIG_SCHED_LOCKSTAT
+  fastpath = false;
+#endif
+
   while (fastpath)
     {
       FAR atomic_t *val = mutex ? NXSEM_MHOLDER(sem) : NXSEM_COUNT(sem);
@@ -167,6 +167,14 @@ int nxsem_wait(FAR sem_t *sem)
     }
 #endif
 
+  /* Disable fast path if lock statistics are collected, they are only
+   * accounted in the slow path
+   */
+
+#ifdef CONFIG_SCHED_LOCKSTAT
+  fastpath = false;
+#endif
+
   while (fastpath)
     {
       FAR atomic_t *val = mutex ? NXSEM_MHOLDER(sem) : NXSEM_COUNT(sem);
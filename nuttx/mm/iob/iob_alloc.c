@@ -345,6 +345,7 @@ FAR struct iob_s *iob_alloc_dynamic(uint16_t size)
       iob->io_bufsize = size;             /* Total length of the iob buffer */
       iob->io_pktlen  = 0;                /* Total length of the packet */
       iob->io_free    = iob_free_dynamic; /* Customer free callback */
+      iob->io_freearg = NULL;             /* Argument of the callback */
       iob->io_data    = (FAR uint8_t *)ALIGN_UP((uintptr_t)(iob + 1),
                                                 CONFIG_IOB_ALIGNMENT);
     }
@@ -377,6 +378,21 @@ FAR struct iob_s *iob_alloc_dynamic(uint16_t size)
 
 FAR struct iob_s *iob_alloc_with_data(FAR void *data, uint16_t size,
                                       iob_free_cb_t free_cb)
+{
+  return iob_alloc_with_arg(data, size, free_cb, data);
+}
+
+/****************************************************************************
+ * Name: iob_alloc_with_arg
+ *
+ * Description:
+ *   Like iob_alloc_with_data(), but free_cb receives 'arg' instead of the
+ *   payload address.
+ *
+ ****************************************************************************/
+
+FAR struct iob_s *iob_alloc_with_arg(FAR void *data, uint16_t size,
+                                     iob_free_cb_t free_cb, FAR void *arg)
 {
   FAR struct iob_s *iob;
 
@@ -391,6 +407,7 @@ FAR struct iob_s *iob_alloc_with_data(FAR void *data, uint16_t size,
       iob->io_bufsize = size;    /* Total length of the iob buffer */
       iob->io_pktlen  = 0;       /* Total length of the packet */
       iob->io_free    = free_cb; /* Customer free callback */
+      iob->io_freearg = arg;     /* Argument of the callback */
       iob->io_data    = data;
     }
 
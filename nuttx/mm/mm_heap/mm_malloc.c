@@ -31,6 +31,7 @@
 #include <string.h>
 
 #include <nuttx/arch.h>
+#include <nuttx/fs/pagecache.h>
 #include <nuttx/mm/mm.h>
 #include <nuttx/mm/kasan.h>
 #include <nuttx/sched.h>
@@ -351,6 +352,17 @@ FAR void *mm_malloc(FAR struct mm_heap_s *heap, size_t size)
     }
 #endif
 
+#if defined(CONFIG_FS_PAGECACHE) && \
+    (defined(CONFIG_BUILD_FLAT) || defined(__KERNEL__))
+  /* Try again after releasing clean pages of the page cache */
+
+  else if (MM_INTERNAL_HEAP(heap) && !up_interrupt_context() &&
+           pagecache_shrink(alignsize) > 0)
+    {
+      return mm_malloc(heap, size);
+    }
+#endif
+
 #ifdef CONFIG_DEBUG_MM
   else if (MM_INTERNAL_HEAP(heap))
     {
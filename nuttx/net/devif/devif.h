@@ -53,8 +53,10 @@
 #include <errno.h>
 #include <arch/irq.h>
 
+#include <nuttx/atomic.h>
 #include <nuttx/net/ip.h>
 #include <nuttx/net/netdev.h>
+#include <nuttx/semaphore.h>
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -277,6 +279,19 @@ struct devif_callback_s
   uint8_t free_flags;
 };
 
+#ifdef CONFIG_NET_SENDFILE_ZEROCOPY
+/* Counts the I/O buffers sent by devif_file_send_inplace() that reference
+ * the data of a file.  The data must stay valid until all of them are
+ * freed by the network drivers.
+ */
+
+struct devif_fileref_s
+{
+  atomic_t refs;              /* One for the owner plus one per buffer */
+  sem_t    sem;               /* Posted when the last buffer is freed */
+};
+#endif
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
@@ -500,6 +515,43 @@ int devif_file_send(FAR struct net_driver_s *dev, FAR struct file *file,
                     unsigned int target_offset);
 #endif
 
+/****************************************************************************
+ * Name: devif_file_send_inplace
+ *
+ * Description:
+ *   Like devif_file_send(), but the packet references the file data in
+ *   place if the file is held in directly addressable memory.  The file
+ *   position is advanced as devif_file_send() does.
+ *
+ * Returned Value:
+ *   The number of bytes sent; -ENOTTY or -ENXIO if the data is not in
+ *   memory, in that case devif_file_send() must be used instead.  Other
+ *   negated errno values on failure.
+ *
+ * Assumptions:
+ *   Called with the network locked.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NET_SENDFILE_ZEROCOPY
+int devif_file_send_inplace(FAR struct net_driver_s *dev,
+                            FAR struct file *file, unsigned int len,
+                            unsigned int offset, unsigned int target_offset,
+                            FAR struct devif_fileref_s *ref);
+
+/****************************************************************************
+ * Name: devif_fileref_init/devif_fileref_wait
+ *
+ * Description:
+ *   Initialize a file data reference counter, and wait until the network
+ *   drivers have freed all the buffers counted by it.
+ *
+ ****************************************************************************/
+
+void devif_fileref_init(FAR struct devif_fileref_s *ref);
+void devif_fileref_wait(FAR struct devif_fileref_s *ref);
+#endif
+
 /****************************************************************************
  * Name: devif_out
  *
@@ -26,17 +26,46 @@
 
 #include <nuttx/config.h>
 
+#include <sys/param.h>
+
 #include <string.h>
 #include <assert.h>
 #include <debug.h>
 #include <errno.h>
 
 #include <nuttx/fs/fs.h>
+#include <nuttx/fs/ioctl.h>
 #include <nuttx/mm/iob.h>
 #include <nuttx/net/netdev.h>
 
+#include "devif/devif.h"
+
 #ifdef CONFIG_MM_IOB
 
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: devif_fileref_release
+ *
+ * Description:
+ *   Called by iob_free() when a buffer referencing file data is freed.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NET_SENDFILE_ZEROCOPY
+static void devif_fileref_release(FAR void *arg)
+{
+  FAR struct devif_fileref_s *ref = arg;
+
+  if (atomic_fetch_sub(&ref->refs, 1) == 1)
+    {
+      nxsem_post(&ref->sem);
+    }
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -163,4 +192,154 @@ errout:
   return ret;
 }
 
+#ifdef CONFIG_NET_SENDFILE_ZEROCOPY
+
+/****************************************************************************
+ * Name: devif_file_send_inplace
+ *
+ * Description:
+ *   Like devif_file_send(), but the packet references the file data in
+ *   place if the file is held in directly addressable memory.
+ *
+ * Assumptions:
+ *   Called with the network locked.
+ *
+ ****************************************************************************/
+
+int devif_file_send_inplace(FAR struct net_driver_s *dev,
+                            FAR struct file *file, unsigned int len,
+                            unsigned int offset, unsigned int target_offset,
+                            FAR struct devif_fileref_s *ref)
+{
+  struct file_memregion_s region;
+  FAR struct iob_s *chain = NULL;
+  FAR struct iob_s **tail = &chain;
+  FAR struct iob_s *iob;
+  unsigned int remain;
+  size_t nbytes;
+  int ret;
+
+  if (dev == NULL)
+    {
+      return -ENODEV;
+    }
+
+  if (len == 0)
+    {
+      return -EINVAL;
+    }
+
+#ifndef CONFIG_NET_IPFRAG
+  if (len > NETDEV_PKTSIZE(dev) - NET_LL_HDRLEN(dev) - target_offset)
+    {
+      return -EMSGSIZE;
+    }
+#endif
+
+  if (!INODE_IS_MOUNTPT(file->f_inode))
+    {
+      return -ENOTTY;
+    }
+
+  /* Reference the file data, one buffer per contiguous region */
+
+  for (remain = len; remain > 0; remain -= nbytes, offset += nbytes)
+    {
+      region.offset = offset;
+      ret = file_ioctl(file, FIOC_MEMREGION, (unsigned long)&region);
+      if (ret < 0)
+        {
+          goto errout;
+        }
+      else if (region.len == 0)
+        {
+          ret = -ENXIO;
+          goto errout;
+        }
+
+      nbytes = MIN(MIN(region.len, remain), UINT16_MAX);
+      iob = iob_alloc_with_arg((FAR void *)region.addr, nbytes,
+                               devif_fileref_release, ref);
+      if (iob == NULL)
+        {
+          ret = -ENOMEM;
+          goto errout;
+        }
+
+      atomic_fetch_add(&ref->refs, 1);
+      *tail = iob;
+      tail  = &iob->io_flink;
+    }
+
+  /* The headers get a buffer of their own, sized so that the packet length
+   * updates never move file data behind them.
+   */
+
+  iob = iob_alloc_dynamic(CONFIG_NET_LL_GUARDSIZE + target_offset);
+  if (iob == NULL)
+    {
+      ret = -ENOMEM;
+      goto errout;
+    }
+
+  iob_reserve(iob, CONFIG_NET_LL_GUARDSIZE);
+  iob->io_flink = chain;
+  netdev_iob_replace(dev, iob);
+  iob_update_pktlen(dev->d_iob, target_offset + len, false);
+
+  /* Leave the file position where devif_file_send() would */
+
+  ret = file_seek(file, offset, SEEK_SET);
+  if (ret < 0)
+    {
+      netdev_iob_release(dev);
+      return ret;
+    }
+
+  dev->d_sndlen = len;
+  return len;
+
+errout:
+  if (chain != NULL)
+    {
+      iob_free_chain(chain);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: devif_fileref_init
+ *
+ * Description:
+ *   Initialize a file data reference counter.
+ *
+ ****************************************************************************/
+
+void devif_fileref_init(FAR struct devif_fileref_s *ref)
+{
+  atomic_set(&ref->refs, 1);
+  nxsem_init(&ref->sem, 0, 0);
+}
+
+/****************************************************************************
+ * Name: devif_fileref_wait
+ *
+ * Description:
+ *   Drop the reference of the owner and wait until the network drivers
+ *   have freed all the buffers that reference the file data.
+ *
+ ****************************************************************************/
+
+void devif_fileref_wait(FAR struct devif_fileref_s *ref)
+{
+  if (atomic_fetch_sub(&ref->refs, 1) != 1)
+    {
+      nxsem_wait_uninterruptible(&ref->sem);
+    }
+
+  nxsem_destroy(&ref->sem);
+}
+
+#endif /* CONFIG_NET_SENDFILE_ZEROCOPY */
 #endif /* CONFIG_MM_IOB */
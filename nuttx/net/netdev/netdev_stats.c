@@ -28,9 +28,12 @@
 
 #include <syslog.h>
 
+#include <nuttx/net/net.h>
 #include <nuttx/net/netdev.h>
 #include <nuttx/net/netstats.h>
 
+#include "netdev/netdev.h"
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -100,3 +103,34 @@ void netdev_statistics_log(FAR void *arg)
             );
 }
 #endif
+
+/****************************************************************************
+ * Name: netdev_statistics_foreach
+ *
+ * Description:
+ *   Call a handler for every registered network device with the network
+ *   locked, e.g. to sample the statistics of all devices.
+ *
+ * Input Parameters:
+ *   handler - Called with each device, a non-zero return value ends the
+ *             enumeration
+ *   arg     - Opaque argument passed to the handler
+ *
+ * Returned Value:
+ *   0 if all devices were enumerated, 1 if the handler ended it early.
+ *
+ ****************************************************************************/
+
+int netdev_statistics_foreach(CODE int (*handler)(
+                                FAR struct net_driver_s *dev,
+                                FAR void *arg),
+                              FAR void *arg)
+{
+  int ret;
+
+  net_lock();
+  ret = netdev_foreach(handler, arg);
+  net_unlock();
+
+  return ret;
+}
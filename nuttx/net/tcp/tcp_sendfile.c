@@ -90,12 +90,45 @@ struct sendfile_s
 #endif
   int                snd_dup_acks;         /* Duplicate ACK counter */
 #endif
+#ifdef CONFIG_NET_SENDFILE_ZEROCOPY
+  struct devif_fileref_s snd_ref;          /* Buffers referencing the file */
+#endif
 };
 
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: sendfile_filesend
+ *
+ * Description:
+ *   Set up the packet data from the input file.  The file data is
+ *   referenced in place when the file system supports it and copied
+ *   otherwise.
+ *
+ ****************************************************************************/
+
+static int sendfile_filesend(FAR struct net_driver_s *dev,
+                             FAR struct sendfile_s *pstate,
+                             unsigned int len, off_t offset)
+{
+  FAR struct tcp_conn_s *conn = pstate->snd_conn;
+#ifdef CONFIG_NET_SENDFILE_ZEROCOPY
+  int ret;
+
+  ret = devif_file_send_inplace(dev, pstate->snd_file, len, offset,
+                                tcpip_hdrsize(conn), &pstate->snd_ref);
+  if (ret != -ENOTTY && ret != -ENXIO)
+    {
+      return ret;
+    }
+#endif
+
+  return devif_file_send(dev, pstate->snd_file, len, offset,
+                         tcpip_hdrsize(conn));
+}
+
 /****************************************************************************
  * Name: sendfile_eventhandler
  *
@@ -269,9 +302,8 @@ static uint16_t sendfile_eventhandler(FAR struct net_driver_s *dev,
        * happen until the polling cycle completes).
        */
 
-      ret = devif_file_send(dev, pstate->snd_file, sndlen,
-                            pstate->snd_foffset + pstate->snd_acked,
-                            tcpip_hdrsize(conn));
+      ret = sendfile_filesend(dev, pstate, sndlen,
+                              pstate->snd_foffset + pstate->snd_acked);
       if (ret < 0)
         {
           nerr("ERROR: Failed to read from input file: %d\n", (int)ret);
@@ -340,9 +372,8 @@ static uint16_t sendfile_eventhandler(FAR struct net_driver_s *dev,
            * happen until the polling cycle completes).
            */
 
-          ret = devif_file_send(dev, pstate->snd_file, sndlen,
-                                pstate->snd_foffset + pstate->snd_sent,
-                                tcpip_hdrsize(conn));
+          ret = sendfile_filesend(dev, pstate, sndlen,
+                                  pstate->snd_foffset + pstate->snd_sent);
           if (ret < 0)
             {
               nerr("ERROR: Failed to read from input file: %d\n", (int)ret);
@@ -486,6 +517,9 @@ ssize_t tcp_sendfile(FAR struct socket *psock, FAR struct file *infile,
   state.snd_foffset = offset ? *offset : startpos; /* Input file offset */
   state.snd_flen    = count;                       /* Number of bytes to send */
   state.snd_file    = infile;                      /* File to read from */
+#ifdef CONFIG_NET_SENDFILE_ZEROCOPY
+  devif_fileref_init(&state.snd_ref);
+#endif
 
   /* Allocate resources to receive a callback */
 
@@ -545,6 +579,12 @@ errout_locked:
 #endif
   net_unlock();
 
+#ifdef CONFIG_NET_SENDFILE_ZEROCOPY
+  /* The drivers may still hold packets that reference the file data */
+
+  devif_fileref_wait(&state.snd_ref);
+#endif
+
   /* Return the current file position */
 
   if (offset)
@@ -0,0 +1,99 @@
+/****************************************************************************
+ * sched/hrtimer/hrtimer.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __SCHED_HRTIMER_HRTIMER_H
+#define __SCHED_HRTIMER_HRTIMER_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/tree.h>
+#include <stdint.h>
+
+#include <nuttx/hrtimer.h>
+#include <nuttx/spinlock_type.h>
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+RB_HEAD(hrtimer_tree_s, hrtimer_s);
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/* g_hrtimer_tree holds all active hrtimers ordered by expiration time.  It
+ * is protected by g_hrtimer_lock.
+ */
+
+EXTERN struct hrtimer_tree_s g_hrtimer_tree;
+EXTERN spinlock_t g_hrtimer_lock;
+
+/* g_hrtimer_running holds the hrtimer whose callback each CPU is running,
+ * or NULL.  It is protected by g_hrtimer_lock.
+ */
+
+EXTERN FAR struct hrtimer_s *g_hrtimer_running[CONFIG_SMP_NCPUS];
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+RB_PROTOTYPE(hrtimer_tree_s, hrtimer_s, node, hrtimer_compare);
+
+/****************************************************************************
+ * Name: hrtimer_reprogram
+ *
+ * Description:
+ *   Request the platform timer to expire at the time of the first pending
+ *   hrtimer.
+ *
+ * Assumptions:
+ *   g_hrtimer_lock is held.
+ *
+ ****************************************************************************/
+
+static inline void hrtimer_reprogram(void)
+{
+  FAR struct hrtimer_s *head = RB_MIN(hrtimer_tree_s, &g_hrtimer_tree);
+
+  up_hrtimer_start(head != NULL ? head->expired : UINT64_MAX);
+}
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SCHED_HRTIMER_HRTIMER_H */
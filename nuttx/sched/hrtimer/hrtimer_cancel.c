@@ -0,0 +1,173 @@
+/****************************************************************************
+ * sched/hrtimer/hrtimer_cancel.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+
+#include <nuttx/sched.h>
+#include <nuttx/spinlock.h>
+
+#include "hrtimer/hrtimer.h"
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: hrtimer_dequeue
+ *
+ * Description:
+ *   Remove an hrtimer from the pending tree if it is active.
+ *
+ * Assumptions:
+ *   g_hrtimer_lock is held.
+ *
+ ****************************************************************************/
+
+static void hrtimer_dequeue(FAR struct hrtimer_s *hrtimer)
+{
+  bool head;
+
+  if (hrtimer->active)
+    {
+      head = RB_MIN(hrtimer_tree_s, &g_hrtimer_tree) == hrtimer;
+
+      RB_REMOVE(hrtimer_tree_s, &g_hrtimer_tree, hrtimer);
+      hrtimer->active = false;
+
+      if (head)
+        {
+          hrtimer_reprogram();
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: hrtimer_running
+ *
+ * Description:
+ *   Return true if another CPU is running the callback of the hrtimer.
+ *   A callback running on this CPU is the caller itself and is not waited
+ *   for.
+ *
+ * Assumptions:
+ *   g_hrtimer_lock is held.
+ *
+ ****************************************************************************/
+
+static bool hrtimer_running(FAR struct hrtimer_s *hrtimer)
+{
+  int cpu;
+
+  for (cpu = 0; cpu < CONFIG_SMP_NCPUS; cpu++)
+    {
+      if (g_hrtimer_running[cpu] == hrtimer && cpu != this_cpu())
+        {
+          return true;
+        }
+    }
+
+  return false;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: hrtimer_cancel
+ *
+ * Description:
+ *   Dequeue an active hrtimer.  Cancelling an inactive hrtimer is not an
+ *   error.  The callback may still be running on another CPU.
+ *
+ * Input Parameters:
+ *   hrtimer - The hrtimer to be cancelled
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success; a negated errno value is returned
+ *   on failure.
+ *
+ ****************************************************************************/
+
+int hrtimer_cancel(FAR struct hrtimer_s *hrtimer)
+{
+  irqstate_t flags;
+
+  if (hrtimer == NULL)
+    {
+      return -EINVAL;
+    }
+
+  flags = spin_lock_irqsave(&g_hrtimer_lock);
+  hrtimer_dequeue(hrtimer);
+  spin_unlock_irqrestore(&g_hrtimer_lock, flags);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: hrtimer_cancel_sync
+ *
+ * Description:
+ *   Dequeue an hrtimer and wait until its callback is no longer running
+ *   on another CPU.  A periodic timer restarted by that callback is
+ *   dequeued again.  On return the hrtimer may be freed.
+ *
+ * Input Parameters:
+ *   hrtimer - The hrtimer to be cancelled
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success; a negated errno value is returned
+ *   on failure.
+ *
+ * Assumptions:
+ *   The caller does not hold a lock that the callback takes, e.g. the
+ *   critical section for callbacks that enter it.
+ *
+ ****************************************************************************/
+
+int hrtimer_cancel_sync(FAR struct hrtimer_s *hrtimer)
+{
+  irqstate_t flags;
+  bool running;
+
+  if (hrtimer == NULL)
+    {
+      return -EINVAL;
+    }
+
+  do
+    {
+      flags = spin_lock_irqsave(&g_hrtimer_lock);
+      hrtimer_dequeue(hrtimer);
+      running = hrtimer_running(hrtimer);
+      spin_unlock_irqrestore(&g_hrtimer_lock, flags);
+    }
+  while (running);
+
+  return OK;
+}
@@ -0,0 +1,99 @@
+/****************************************************************************
+ * sched/hrtimer/hrtimer_initialize.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <assert.h>
+
+#include <nuttx/spinlock.h>
+
+#include "hrtimer/hrtimer.h"
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+struct hrtimer_tree_s g_hrtimer_tree = RB_INITIALIZER(&g_hrtimer_tree);
+spinlock_t g_hrtimer_lock = SP_UNLOCKED;
+FAR struct hrtimer_s *g_hrtimer_running[CONFIG_SMP_NCPUS];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: hrtimer_compare
+ *
+ * Description:
+ *   Order the hrtimers by expiration time.  Timers with the same expiration
+ *   time are ordered by address, the tree does not accept duplicate keys.
+ *
+ ****************************************************************************/
+
+static int hrtimer_compare(FAR struct hrtimer_s *a, FAR struct hrtimer_s *b)
+{
+  if (a->expired != b->expired)
+    {
+      return a->expired < b->expired ? -1 : 1;
+    }
+
+  if (a != b)
+    {
+      return (uintptr_t)a < (uintptr_t)b ? -1 : 1;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+RB_GENERATE(hrtimer_tree_s, hrtimer_s, node, hrtimer_compare);
+
+/****************************************************************************
+ * Name: hrtimer_init
+ *
+ * Description:
+ *   Initialize an hrtimer before its first use.
+ *
+ * Input Parameters:
+ *   hrtimer - The hrtimer to be initialized
+ *   func    - The function to be called on expiration
+ *   arg     - The argument available to the callback as hrtimer->arg
+ *
+ ****************************************************************************/
+
+void hrtimer_init(FAR struct hrtimer_s *hrtimer, hrtimer_cb_t func,
+                  FAR void *arg)
+{
+  DEBUGASSERT(hrtimer != NULL && func != NULL);
+
+  hrtimer->func    = func;
+  hrtimer->arg     = arg;
+  hrtimer->expired = 0;
+  hrtimer->active  = false;
+}
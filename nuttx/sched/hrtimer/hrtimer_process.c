@@ -0,0 +1,147 @@
+/****************************************************************************
+ * sched/hrtimer/hrtimer_process.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <time.h>
+
+#include <nuttx/arch.h>
+#include <nuttx/spinlock.h>
+
+#include "hrtimer/hrtimer.h"
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: hrtimer_gettime
+ *
+ * Description:
+ *   Return the current CLOCK_MONOTONIC time in nanoseconds, the time base
+ *   of HRTIMER_MODE_ABS.
+ *
+ ****************************************************************************/
+
+uint64_t hrtimer_gettime(void)
+{
+  struct timespec ts;
+
+  up_timer_gettime(&ts);
+  return clock_time2nsec(&ts);
+}
+
+/****************************************************************************
+ * Name: hrtimer_remaining
+ *
+ * Description:
+ *   Return the time remaining in nanoseconds before an active hrtimer
+ *   expires, or zero if the timer is not active or is already due.
+ *
+ ****************************************************************************/
+
+uint64_t hrtimer_remaining(FAR const struct hrtimer_s *hrtimer)
+{
+  uint64_t expired = hrtimer->expired;
+  uint64_t now;
+
+  if (!hrtimer->active)
+    {
+      return 0;
+    }
+
+  now = hrtimer_gettime();
+  return expired > now ? expired - now : 0;
+}
+
+/****************************************************************************
+ * Name: hrtimer_process
+ *
+ * Description:
+ *   Run the callbacks of all hrtimers that expired at or before 'now' and
+ *   program the next expiration.  This is called by the platform-specific
+ *   logic when the expiration requested with up_hrtimer_start() occurs.
+ *
+ * Input Parameters:
+ *   now - The current CLOCK_MONOTONIC time in nanoseconds
+ *
+ * Assumptions:
+ *   Called from the interrupt level.
+ *
+ ****************************************************************************/
+
+void hrtimer_process(uint64_t now)
+{
+  FAR struct hrtimer_s *hrtimer;
+  irqstate_t flags;
+  uint64_t expired;
+  uint64_t period;
+  int cpu;
+
+  flags = spin_lock_irqsave(&g_hrtimer_lock);
+  cpu   = this_cpu();
+
+  while ((hrtimer = RB_MIN(hrtimer_tree_s, &g_hrtimer_tree)) != NULL &&
+         hrtimer->expired <= now)
+    {
+      RB_REMOVE(hrtimer_tree_s, &g_hrtimer_tree, hrtimer);
+      hrtimer->active = false;
+      expired = hrtimer->expired;
+
+      /* Run the callback without holding the lock, it may restart or
+       * cancel any timer, including itself.  hrtimer_cancel_sync() waits
+       * until the callback is no longer marked as running.
+       */
+
+      g_hrtimer_running[cpu] = hrtimer;
+      spin_unlock_irqrestore(&g_hrtimer_lock, flags);
+      period = hrtimer->func(hrtimer, expired);
+      flags = spin_lock_irqsave(&g_hrtimer_lock);
+
+      if (period > 0 && !hrtimer->active)
+        {
+          /* Restart the periodic timer relative to the requested
+           * expiration.  Periods that have already been missed are
+           * skipped rather than delivered back to back.
+           */
+
+          expired += period;
+          if (expired <= now)
+            {
+              expired += ((now - expired) / period + 1) * period;
+            }
+
+          hrtimer->expired = expired;
+          hrtimer->active  = true;
+          RB_INSERT(hrtimer_tree_s, &g_hrtimer_tree, hrtimer);
+        }
+
+      g_hrtimer_running[cpu] = NULL;
+    }
+
+  hrtimer_reprogram();
+  spin_unlock_irqrestore(&g_hrtimer_lock, flags);
+}
@@ -0,0 +1,107 @@
+/****************************************************************************
+ * sched/hrtimer/hrtimer_start.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <assert.h>
+#include <errno.h>
+
+#include <nuttx/spinlock.h>
+
+#include "hrtimer/hrtimer.h"
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: hrtimer_start
+ *
+ * Description:
+ *   Queue an hrtimer.  If the timer is already active, it is restarted
+ *   with the new expiration time.  Expiration times in the past cause the
+ *   timer to expire as soon as possible.
+ *
+ * Input Parameters:
+ *   hrtimer - The hrtimer to be started
+ *   ns      - Absolute or relative expiration time in nanoseconds
+ *   mode    - Interpretation of ns, see enum hrtimer_mode_e
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success; a negated errno value is returned
+ *   on failure.
+ *
+ * Assumptions:
+ *   May be called from the interrupt level, including from the hrtimer
+ *   callback itself.
+ *
+ ****************************************************************************/
+
+int hrtimer_start(FAR struct hrtimer_s *hrtimer, uint64_t ns,
+                  enum hrtimer_mode_e mode)
+{
+  FAR struct hrtimer_s *head;
+  irqstate_t flags;
+
+  if (hrtimer == NULL || hrtimer->func == NULL)
+    {
+      return -EINVAL;
+    }
+
+  if (mode == HRTIMER_MODE_REL)
+    {
+      uint64_t now = hrtimer_gettime();
+
+      ns = ns < UINT64_MAX - now ? now + ns : UINT64_MAX - 1;
+    }
+
+  flags = spin_lock_irqsave(&g_hrtimer_lock);
+
+  head = RB_MIN(hrtimer_tree_s, &g_hrtimer_tree);
+
+  /* Restarting an active timer moves it in the tree */
+
+  if (hrtimer->active)
+    {
+      RB_REMOVE(hrtimer_tree_s, &g_hrtimer_tree, hrtimer);
+    }
+
+  hrtimer->expired = ns;
+  hrtimer->active  = true;
+  RB_INSERT(hrtimer_tree_s, &g_hrtimer_tree, hrtimer);
+
+  /* Only a change of the first timer requires the platform timer to be
+   * programmed again.
+   */
+
+  if (head == hrtimer || RB_MIN(hrtimer_tree_s, &g_hrtimer_tree) == hrtimer)
+    {
+      hrtimer_reprogram();
+    }
+
+  spin_unlock_irqrestore(&g_hrtimer_lock, flags);
+  return OK;
+}
@@ -285,11 +285,26 @@ irqstate_t enter_critical_section_wo_note(void)
 #endif
 
 #if CONFIG_SCHED_CRITMONITOR_MAXTIME_CSECTION >= 0 || \
-    defined(CONFIG_SCHED_INSTRUMENTATION_CSECTION)
+    defined(CONFIG_SCHED_INSTRUMENTATION_CSECTION) || \
+    defined(CONFIG_SCHED_LOCKSTAT)
 irqstate_t enter_critical_section(void)
 {
   FAR struct tcb_s *rtcb;
   irqstate_t flags;
+#ifdef CONFIG_SCHED_LOCKSTAT
+  clock_t start = 0;
+
+#  ifdef CONFIG_SMP
+  /* Another CPU holds the critical section, we will have to wait */
+
+  if (!up_interrupt_context() && this_task()->irqcount == 0 &&
+      spin_is_locked(&g_cpu_irqlock))
+    {
+      start = perf_gettime();
+    }
+#  endif
+#endif
+
   flags = enter_critical_section_wo_note();
 
   if (!up_interrupt_context())
@@ -302,6 +317,9 @@ irqstate_t enter_critical_section(void)
 #endif
 #ifdef CONFIG_SCHED_INSTRUMENTATION_CSECTION
           sched_note_csection(rtcb, true);
+#endif
+#ifdef CONFIG_SCHED_LOCKSTAT
+          nxsched_lockstat_csection_enter(return_address(0), start);
 #endif
         }
     }
@@ -446,10 +464,15 @@ void leave_critical_section_wo_note(irqstate_t flags)
 #endif
 
 #if CONFIG_SCHED_CRITMONITOR_MAXTIME_CSECTION >= 0 || \
-    defined(CONFIG_SCHED_INSTRUMENTATION_CSECTION)
+    defined(CONFIG_SCHED_INSTRUMENTATION_CSECTION) || \
+    defined(CONFIG_SCHED_LOCKSTAT)
 void leave_critical_section(irqstate_t flags)
 {
   FAR struct tcb_s *rtcb;
+#  ifdef CONFIG_SCHED_LOCKSTAT
+  FAR const void *caller = NULL;
+  clock_t hold = 0;
+#  endif
 
   if (!up_interrupt_context())
     {
@@ -461,10 +484,24 @@ void leave_critical_section(irqstate_t flags)
 #  endif
 #  ifdef CONFIG_SCHED_INSTRUMENTATION_CSECTION
           sched_note_csection(rtcb, false);
+#  endif
+#  ifdef CONFIG_SCHED_LOCKSTAT
+          hold = nxsched_lockstat_csection_leave(&caller);
 #  endif
         }
     }
 
   leave_critical_section_wo_note(flags);
+
+#  ifdef CONFIG_SCHED_LOCKSTAT
+  /* Save the backtrace of a new longest holder only after the critical
+   * section has been left.
+   */
+
+  if (hold != 0)
+    {
+      nxsched_lockstat_backtrace(caller, hold);
+    }
+#  endif
 }
 #endif
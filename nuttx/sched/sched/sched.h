@@ -389,6 +389,12 @@ static inline_function FAR struct tcb_s *this_task(void)
 
 #ifdef CONFIG_SMP
 void nxsched_process_delivered(int cpu);
+#  ifdef CONFIG_SCHED_PERCPU_READYQ
+FAR struct tcb_s *nxsched_pull_task(int cpu, int priority);
+#    if CONFIG_SCHED_PERCPU_READYQ_BALANCE > 0
+void nxsched_balance_readyq(void);
+#    endif
+#  endif
 #else
 #  define nxsched_select_cpu(a)     (0)
 #endif
@@ -424,6 +430,27 @@ void nxsched_critmon_csection(FAR struct tcb_s *tcb, bool state,
                               FAR void *caller);
 #endif
 
+/* Scheduling latency monitor */
+
+#ifdef CONFIG_SCHED_LATENCYMON
+void nxsched_latmon_irqentry(void);
+void nxsched_latmon_wakeup(FAR struct tcb_s *tcb);
+void nxsched_resume_latmon(FAR struct tcb_s *tcb);
+void nxsched_suspend_latmon(FAR struct tcb_s *tcb);
+#endif
+
+/* Lock contention statistics */
+
+#ifdef CONFIG_SCHED_LOCKSTAT
+void nxsched_lockstat_acquire(FAR const void *lock, uint8_t type,
+                              clock_t start);
+clock_t nxsched_lockstat_release(FAR const void *lock);
+void nxsched_lockstat_backtrace(FAR const void *lock, clock_t hold);
+void nxsched_lockstat_forget(FAR const void *lock);
+void nxsched_lockstat_csection_enter(FAR void *caller, clock_t start);
+clock_t nxsched_lockstat_csection_leave(FAR const void **caller);
+#endif
+
 /* TCB operations */
 
 bool nxsched_verify_tcb(FAR struct tcb_s *tcb);
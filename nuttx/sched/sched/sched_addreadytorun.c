@@ -71,6 +71,12 @@ bool nxsched_add_readytorun(FAR struct tcb_s *btcb)
   FAR struct tcb_s *rtcb = this_task();
   bool ret;
 
+#ifdef CONFIG_SCHED_LATENCYMON
+  /* Start measuring the wakeup latency */
+
+  nxsched_latmon_wakeup(btcb);
+#endif
+
   /* Check if pre-emption is disabled for the current running task and if
    * the new ready-to-run task would cause the current running task to be
    * preempted.  NOTE that IRQs disabled implies that pre-emption is
@@ -162,6 +168,12 @@ bool nxsched_add_readytorun(FAR struct tcb_s *btcb)
   int cpu;
   int me;
 
+#ifdef CONFIG_SCHED_LATENCYMON
+  /* Start measuring the wakeup latency */
+
+  nxsched_latmon_wakeup(btcb);
+#endif
+
   cpu = nxsched_select_cpu(btcb->affinity);
 
   /* Get the task currently running on the CPU (may be the IDLE task) */
@@ -208,6 +220,19 @@ bool nxsched_add_readytorun(FAR struct tcb_s *btcb)
     }
   else if (task_state == TSTATE_TASK_READYTORUN)
     {
+#ifdef CONFIG_SCHED_PERCPU_READYQ
+      /* Queue the task on the ready queue of the selected CPU, i.e. behind
+       * the running task in its assigned task list.  The running task has
+       * a priority higher than or equal to btcb, so btcb can never become
+       * the head of the list here.  The other CPUs pull the task from that
+       * queue if they run out of higher priority work.
+       */
+
+      nxsched_add_prioritized(btcb, list_assignedtasks(cpu));
+
+      btcb->cpu        = cpu;
+      btcb->task_state = TSTATE_TASK_ASSIGNED;
+#else
       /* The new btcb was added either (1) in the middle of the assigned
        * task list (the btcb->cpu field is already valid) or (2) was
        * added to the ready-to-run list (the btcb->cpu field does not
@@ -219,6 +244,7 @@ bool nxsched_add_readytorun(FAR struct tcb_s *btcb)
       nxsched_add_prioritized(btcb, list_readytorun());
 
       btcb->task_state = TSTATE_TASK_READYTORUN;
+#endif
       doswitch         = false;
     }
   else /* (task_state == TSTATE_TASK_RUNNING) */
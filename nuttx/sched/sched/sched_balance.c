@@ -0,0 +1,297 @@
+/****************************************************************************
+ * sched/sched/sched_balance.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+#include <sched.h>
+#include <assert.h>
+
+#include <nuttx/arch.h>
+#include <nuttx/irq.h>
+#include <nuttx/sched.h>
+
+#include "sched/sched.h"
+
+#ifdef CONFIG_SCHED_PERCPU_READYQ
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+#if CONFIG_SCHED_PERCPU_READYQ_BALANCE > 0
+/* Number of system ticks since the last balancing pass */
+
+static unsigned int g_balance_ticks;
+#endif
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxsched_readyq_load
+ *
+ * Description:
+ *   Return the load of a CPU, i.e. the number of tasks of g_assignedtasks
+ *   [cpu] that are either running or waiting to run, not counting the IDLE
+ *   task.  A CPU that runs its IDLE task has a load of zero.
+ *
+ ****************************************************************************/
+
+#if CONFIG_SCHED_PERCPU_READYQ_BALANCE > 0
+static int nxsched_readyq_load(int cpu)
+{
+  FAR struct tcb_s *tcb;
+  int load = 0;
+
+  for (tcb = current_task(cpu); !is_idle_task(tcb); tcb = tcb->flink)
+    {
+      if (tcb->task_state == TSTATE_TASK_ASSIGNED ||
+          tcb->task_state == TSTATE_TASK_RUNNING)
+        {
+          load++;
+        }
+    }
+
+  return load;
+}
+
+/****************************************************************************
+ * Name: nxsched_balance_one
+ *
+ * Description:
+ *   Move one waiting task from the ready queue of 'busiest' to the least
+ *   loaded CPU permitted by the affinity mask of the task, provided that
+ *   this reduces the imbalance.  If the task has a higher priority than
+ *   the task running on the destination CPU (always the case for an idle
+ *   CPU), it is delivered to that CPU with an SMP scheduling IPI, the same
+ *   way as nxsched_add_readytorun() does.
+ *
+ * Returned Value:
+ *   true if a task was moved.
+ *
+ * Assumptions:
+ *   The caller holds the critical section.
+ *
+ ****************************************************************************/
+
+static bool nxsched_balance_one(FAR int *load, int busiest, int me)
+{
+  FAR struct tcb_s *tcb;
+  int target;
+  int i;
+
+  for (tcb = current_task(busiest)->flink; !is_idle_task(tcb);
+       tcb = tcb->flink)
+    {
+      if (tcb->task_state != TSTATE_TASK_ASSIGNED)
+        {
+          continue;
+        }
+
+      /* Select the least loaded CPU that the task may use.  The task
+       * cannot preempt this CPU from here, the next context switch on this
+       * CPU will pull it anyway.
+       */
+
+      target = -1;
+      for (i = 0; i < CONFIG_SMP_NCPUS; i++)
+        {
+          if (i != busiest && CPU_ISSET(i, &tcb->affinity) &&
+              g_delivertasks[i] == NULL &&
+              (i != me || tcb->sched_priority <=
+                          current_task(i)->sched_priority) &&
+              load[i] + 1 < load[busiest] &&
+              (target < 0 || load[i] < load[target]))
+            {
+              target = i;
+            }
+        }
+
+      if (target < 0)
+        {
+          continue;
+        }
+
+      dq_rem((FAR dq_entry_t *)tcb, list_assignedtasks(busiest));
+      tcb->cpu = target;
+
+      if (tcb->sched_priority > current_task(target)->sched_priority)
+        {
+          g_delivertasks[target] = tcb;
+          up_send_smp_sched(target);
+        }
+      else
+        {
+          nxsched_add_prioritized(tcb, list_assignedtasks(target));
+        }
+
+      load[busiest]--;
+      load[target]++;
+      return true;
+    }
+
+  return false;
+}
+#endif
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxsched_pull_task
+ *
+ * Description:
+ *   Find the highest priority task waiting in the ready queue of some other
+ *   CPU that is permitted to run on 'cpu' by its affinity mask and whose
+ *   priority is strictly higher than 'priority'.  This is how a CPU that
+ *   is about to switch to a lower priority task (or to its IDLE task)
+ *   takes work from the other CPUs.  The task is not removed from its
+ *   ready queue.
+ *
+ *   This visits the head of the ready queue of every other CPU, so the
+ *   cost is O(CONFIG_SMP_NCPUS) per call in the common case.  It is called
+ *   only when the local CPU would otherwise switch to a lower priority
+ *   task and it replaces the re-sorting of all queues through g_readytorun
+ *   that is done without CONFIG_SCHED_PERCPU_READYQ.
+ *
+ * Input Parameters:
+ *   cpu      - The CPU that will run the task
+ *   priority - The priority of the task that would run otherwise
+ *
+ * Returned Value:
+ *   The TCB of the task to migrate or NULL if there is none.
+ *
+ * Assumptions:
+ *   The caller holds the critical section.
+ *
+ ****************************************************************************/
+
+FAR struct tcb_s *nxsched_pull_task(int cpu, int priority)
+{
+  FAR struct tcb_s *best = NULL;
+  FAR struct tcb_s *tcb;
+  int i;
+
+  for (i = 0; i < CONFIG_SMP_NCPUS; i++)
+    {
+      if (i == cpu)
+        {
+          continue;
+        }
+
+      /* The ready queues are prioritized, so the first task that may run
+       * on this CPU is the best candidate of that queue.
+       */
+
+      for (tcb = current_task(i);
+           !is_idle_task(tcb) && tcb->sched_priority > priority;
+           tcb = tcb->flink)
+        {
+          if (tcb->task_state == TSTATE_TASK_ASSIGNED &&
+              CPU_ISSET(cpu, &tcb->affinity))
+            {
+              best     = tcb;
+              priority = tcb->sched_priority;
+              break;
+            }
+        }
+    }
+
+  return best;
+}
+
+/****************************************************************************
+ * Name: nxsched_balance_readyq
+ *
+ * Description:
+ *   Periodic load balancing, called from the system timer.  Every
+ *   CONFIG_SCHED_PERCPU_READYQ_BALANCE ticks, compare the load of the
+ *   CPUs (running plus waiting tasks) and move waiting tasks from the most
+ *   loaded CPU to less loaded ones until the load of any two CPUs differs
+ *   by at most one task or no waiting task can be moved.  This is also
+ *   what wakes up an idle CPU when the other CPUs have queued work for it.
+ *
+ ****************************************************************************/
+
+#if CONFIG_SCHED_PERCPU_READYQ_BALANCE > 0
+void nxsched_balance_readyq(void)
+{
+  irqstate_t flags;
+  int load[CONFIG_SMP_NCPUS];
+  bool stuck[CONFIG_SMP_NCPUS];
+  int busiest;
+  int me;
+  int i;
+
+  if (++g_balance_ticks < CONFIG_SCHED_PERCPU_READYQ_BALANCE)
+    {
+      return;
+    }
+
+  g_balance_ticks = 0;
+
+  flags = enter_critical_section();
+  me    = this_cpu();
+
+  for (i = 0; i < CONFIG_SMP_NCPUS; i++)
+    {
+      load[i]  = nxsched_readyq_load(i);
+      stuck[i] = false;
+    }
+
+  for (; ; )
+    {
+      /* Select the most loaded CPU that may still give away a task */
+
+      busiest = -1;
+      for (i = 0; i < CONFIG_SMP_NCPUS; i++)
+        {
+          if (!stuck[i] && load[i] > 1 &&
+              (busiest < 0 || load[i] > load[busiest]))
+            {
+              busiest = i;
+            }
+        }
+
+      if (busiest < 0)
+        {
+          break;
+        }
+
+      if (!nxsched_balance_one(load, busiest, me))
+        {
+          stuck[busiest] = true;
+        }
+    }
+
+  leave_critical_section(flags);
+}
+#endif
+
+#endif /* CONFIG_SCHED_PERCPU_READYQ */
@@ -0,0 +1,245 @@
+/****************************************************************************
+ * sched/sched/sched_latencymon.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <string.h>
+#include <strings.h>
+
+#include <nuttx/arch.h>
+#include <nuttx/clock.h>
+#include <nuttx/irq.h>
+#include <nuttx/sched.h>
+
+#include "sched/sched.h"
+
+#ifdef CONFIG_SCHED_LATENCYMON
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define LATMON_PRIOBAND(prio) ((prio) >> CONFIG_SCHED_LATENCYMON_PRIOSHIFT)
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+/* Wakeup-to-run and IRQ-entry-to-run histograms.  These are kept per CPU
+ * so that they can be updated from the context switch path without any
+ * additional locking.
+ */
+
+struct latmon_hist_s g_latmon_wakeup[CONFIG_SMP_NCPUS][LATMON_NPRIOBANDS];
+struct latmon_hist_s g_latmon_irq[CONFIG_SMP_NCPUS][LATMON_NPRIOBANDS];
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* Time of the entry into the interrupt handler currently executing */
+
+static clock_t g_latmon_irqstart[CONFIG_SMP_NCPUS];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxsched_latmon_record
+ *
+ * Description:
+ *   Add one delay sample to a histogram.
+ *
+ ****************************************************************************/
+
+static void nxsched_latmon_record(FAR struct latmon_hist_s *hist,
+                                  clock_t elapsed)
+{
+  unsigned int index = 0;
+
+  if (elapsed > 0)
+    {
+      index = flsll(elapsed) - 1;
+      if (index >= CONFIG_SCHED_LATENCYMON_NBUCKETS)
+        {
+          index = CONFIG_SCHED_LATENCYMON_NBUCKETS - 1;
+        }
+    }
+
+  hist->bucket[index]++;
+  hist->count++;
+  hist->total += elapsed;
+
+  if (elapsed > hist->max)
+    {
+      hist->max = elapsed;
+    }
+}
+
+/****************************************************************************
+ * Name: nxsched_latmon_clear
+ *
+ * Description:
+ *   nxsched_foreach() callback that clears the per-task histogram.
+ *
+ ****************************************************************************/
+
+static void nxsched_latmon_clear(FAR struct tcb_s *tcb, FAR void *arg)
+{
+  memset(&tcb->wakeup_latency, 0, sizeof(struct latmon_hist_s));
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxsched_latmon_irqentry
+ *
+ * Description:
+ *   Called on entry into the interrupt dispatch logic to timestamp the
+ *   interrupt.  A thread that is woken up from within the handler is
+ *   charged with the delay from this point on.
+ *
+ * Assumptions:
+ *   - Called from an interrupt handler
+ *
+ ****************************************************************************/
+
+void nxsched_latmon_irqentry(void)
+{
+  g_latmon_irqstart[this_cpu()] = perf_gettime();
+}
+
+/****************************************************************************
+ * Name: nxsched_latmon_wakeup
+ *
+ * Description:
+ *   Called when a thread is made ready-to-run.  Save the wakeup time unless
+ *   the thread already carries one (i.e. it was woken up earlier but has
+ *   not run yet, as with tasks deferred to the pending list).
+ *
+ * Assumptions:
+ *   - Called within a critical section.
+ *   - Might be called from an interrupt handler
+ *
+ ****************************************************************************/
+
+void nxsched_latmon_wakeup(FAR struct tcb_s *tcb)
+{
+  if (tcb->wakeup_start == 0)
+    {
+      tcb->wakeup_start    = perf_gettime();
+      tcb->wakeup_irqstart = up_interrupt_context() ?
+                             g_latmon_irqstart[this_cpu()] : 0;
+    }
+}
+
+/****************************************************************************
+ * Name: nxsched_resume_latmon
+ *
+ * Description:
+ *   Called when a thread resumes execution.  If the thread was woken up,
+ *   account the delay since the wakeup (and since the interrupt that
+ *   caused it, if any) in the histograms.
+ *
+ * Assumptions:
+ *   - Called within a critical section.
+ *   - Might be called from an interrupt handler
+ *
+ ****************************************************************************/
+
+void nxsched_resume_latmon(FAR struct tcb_s *tcb)
+{
+  clock_t current;
+  int band;
+  int cpu;
+
+  if (tcb->wakeup_start == 0)
+    {
+      return;
+    }
+
+  current = perf_gettime();
+  band    = LATMON_PRIOBAND(tcb->sched_priority);
+  cpu     = this_cpu();
+
+  nxsched_latmon_record(&tcb->wakeup_latency, current - tcb->wakeup_start);
+  nxsched_latmon_record(&g_latmon_wakeup[cpu][band],
+                        current - tcb->wakeup_start);
+
+  if (tcb->wakeup_irqstart != 0)
+    {
+      nxsched_latmon_record(&g_latmon_irq[cpu][band],
+                            current - tcb->wakeup_irqstart);
+    }
+
+  tcb->wakeup_start    = 0;
+  tcb->wakeup_irqstart = 0;
+}
+
+/****************************************************************************
+ * Name: nxsched_suspend_latmon
+ *
+ * Description:
+ *   Called when a thread suspends execution.  Any wakeup time recorded
+ *   while the thread was running (e.g. by a reprioritization) is stale and
+ *   is discarded so that preemption is never mistaken for wakeup latency.
+ *
+ * Assumptions:
+ *   - Called within a critical section.
+ *   - Might be called from an interrupt handler
+ *
+ ****************************************************************************/
+
+void nxsched_suspend_latmon(FAR struct tcb_s *tcb)
+{
+  tcb->wakeup_start    = 0;
+  tcb->wakeup_irqstart = 0;
+}
+
+/****************************************************************************
+ * Name: nxsched_latmon_reset
+ *
+ * Description:
+ *   Clear the global and all per-task scheduling latency histograms.
+ *
+ ****************************************************************************/
+
+void nxsched_latmon_reset(void)
+{
+  irqstate_t flags;
+
+  flags = enter_critical_section();
+  memset(g_latmon_wakeup, 0, sizeof(g_latmon_wakeup));
+  memset(g_latmon_irq, 0, sizeof(g_latmon_irq));
+  nxsched_foreach(nxsched_latmon_clear, NULL);
+  leave_critical_section(flags);
+}
+
+#endif /* CONFIG_SCHED_LATENCYMON */
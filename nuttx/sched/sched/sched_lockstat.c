@@ -0,0 +1,562 @@
+/****************************************************************************
+ * sched/sched/sched_lockstat.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <sched.h>
+#include <string.h>
+
+#include <nuttx/arch.h>
+#include <nuttx/clock.h>
+#include <nuttx/irq.h>
+#include <nuttx/lockstat.h>
+#include <nuttx/spinlock.h>
+
+#include "sched/sched.h"
+
+#ifdef CONFIG_SCHED_LOCKSTAT
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define LOCKSTAT_HASH(l) \
+  ((((uintptr_t)(l) >> 2) ^ ((uintptr_t)(l) >> 12)) % \
+   CONFIG_SCHED_LOCKSTAT_NENTRIES)
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+struct lockstat_s g_lockstat[CONFIG_SCHED_LOCKSTAT_NENTRIES];
+uint32_t g_lockstat_dropped;
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* Protects g_lockstat.  Only the notrace spinlock functions may be used on
+ * it, the instrumented ones would recurse into this file.
+ */
+
+static spinlock_t g_lockstat_lock = SP_UNLOCKED;
+
+/* The key of the critical section currently held by each CPU.  The key is
+ * kept rather than the entry because nxsched_lockstat_forget() may move
+ * the entries.
+ */
+
+static FAR const void *g_lockstat_csection[CONFIG_SMP_NCPUS];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxsched_lockstat_find
+ *
+ * Description:
+ *   Return the entry of a lock, allocating it on first use.  NULL is
+ *   returned if the table is full.
+ *
+ * Assumptions:
+ *   g_lockstat_lock is held.
+ *
+ ****************************************************************************/
+
+static FAR struct lockstat_s *nxsched_lockstat_find(FAR const void *lock,
+                                                    uint8_t type)
+{
+  FAR struct lockstat_s *entry;
+  unsigned int index = LOCKSTAT_HASH(lock);
+  unsigned int i;
+
+  for (i = 0; i < CONFIG_SCHED_LOCKSTAT_NENTRIES; i++)
+    {
+      entry = &g_lockstat[index];
+      if (entry->lock == lock)
+        {
+          return entry;
+        }
+      else if (entry->lock == NULL)
+        {
+          entry->lock = lock;
+          entry->type = type;
+          return entry;
+        }
+
+      if (++index >= CONFIG_SCHED_LOCKSTAT_NENTRIES)
+        {
+          index = 0;
+        }
+    }
+
+  g_lockstat_dropped++;
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: nxsched_lockstat_account
+ *
+ * Description:
+ *   Account one acquisition of the lock described by 'entry'.
+ *
+ * Assumptions:
+ *   g_lockstat_lock is held.
+ *
+ ****************************************************************************/
+
+static void nxsched_lockstat_account(FAR struct lockstat_s *entry,
+                                     clock_t start, clock_t now)
+{
+  entry->acquired++;
+
+  if (start != 0)
+    {
+      clock_t wait = now - start;
+
+      entry->contended++;
+      entry->wait_total += wait;
+      if (wait > entry->wait_max)
+        {
+          entry->wait_max = wait;
+        }
+    }
+
+  if (entry->type != LOCKSTAT_SEM)
+    {
+      entry->hold_start = now;
+    }
+}
+
+/****************************************************************************
+ * Name: nxsched_lockstat_lookup
+ *
+ * Description:
+ *   Return the index of the entry of a lock in g_lockstat, -1 if the lock
+ *   is not tracked.
+ *
+ * Assumptions:
+ *   g_lockstat_lock is held.
+ *
+ ****************************************************************************/
+
+static int nxsched_lockstat_lookup(FAR const void *lock)
+{
+  unsigned int index = LOCKSTAT_HASH(lock);
+  unsigned int i;
+
+  for (i = 0; i < CONFIG_SCHED_LOCKSTAT_NENTRIES; i++)
+    {
+      if (g_lockstat[index].lock == lock)
+        {
+          return index;
+        }
+      else if (g_lockstat[index].lock == NULL)
+        {
+          break;
+        }
+
+      if (++index >= CONFIG_SCHED_LOCKSTAT_NENTRIES)
+        {
+          index = 0;
+        }
+    }
+
+  return -1;
+}
+
+/****************************************************************************
+ * Name: nxsched_lockstat_unhold
+ *
+ * Description:
+ *   Account the end of the hold of the lock described by 'entry'.
+ *
+ * Returned Value:
+ *   The hold time if this is the longest hold so far and the backtrace of
+ *   the holder should be saved with nxsched_lockstat_backtrace(), zero
+ *   otherwise.
+ *
+ * Assumptions:
+ *   g_lockstat_lock is held.
+ *
+ ****************************************************************************/
+
+static clock_t nxsched_lockstat_unhold(FAR struct lockstat_s *entry)
+{
+  clock_t hold = 0;
+
+  if (entry->hold_start != 0)
+    {
+      hold = perf_gettime() - entry->hold_start;
+      entry->hold_start = 0;
+      if (hold > entry->hold_max)
+        {
+          entry->hold_max = hold;
+        }
+      else
+        {
+          hold = 0;
+        }
+    }
+
+#if CONFIG_SCHED_LOCKSTAT_BACKTRACE > 0
+  return up_interrupt_context() ? 0 : hold;
+#else
+  return 0;
+#endif
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxsched_lockstat_acquire
+ *
+ * Description:
+ *   Called when a lock has been acquired.
+ *
+ * Input Parameters:
+ *   lock  - The address of the lock
+ *   type  - The kind of lock, see LOCKSTAT_* definitions
+ *   start - The perf_gettime() time when the caller started to wait for
+ *           the lock, zero if the lock was acquired without waiting.
+ *
+ ****************************************************************************/
+
+void nxsched_lockstat_acquire(FAR const void *lock, uint8_t type,
+                              clock_t start)
+{
+  FAR struct lockstat_s *entry;
+  irqstate_t flags;
+  clock_t now = perf_gettime();
+
+  flags = spin_lock_irqsave_notrace(&g_lockstat_lock);
+  entry = nxsched_lockstat_find(lock, type);
+  if (entry != NULL)
+    {
+      nxsched_lockstat_account(entry, start, now);
+    }
+
+  spin_unlock_irqrestore_notrace(&g_lockstat_lock, flags);
+}
+
+/****************************************************************************
+ * Name: nxsched_lockstat_release
+ *
+ * Description:
+ *   Called when a lock is released.  Accounts the hold time of the lock.
+ *
+ * Returned Value:
+ *   Nonzero if the caller should pass the value to
+ *   nxsched_lockstat_backtrace() once it no longer holds the lock.
+ *
+ ****************************************************************************/
+
+clock_t nxsched_lockstat_release(FAR const void *lock)
+{
+  irqstate_t flags;
+  clock_t hold = 0;
+  int index;
+
+  flags = spin_lock_irqsave_notrace(&g_lockstat_lock);
+
+  index = nxsched_lockstat_lookup(lock);
+  if (index >= 0)
+    {
+      hold = nxsched_lockstat_unhold(&g_lockstat[index]);
+    }
+
+  spin_unlock_irqrestore_notrace(&g_lockstat_lock, flags);
+  return hold;
+}
+
+/****************************************************************************
+ * Name: nxsched_lockstat_backtrace
+ *
+ * Description:
+ *   Save the backtrace of the calling thread as the one of the longest
+ *   holder of a lock.  This is called after the lock has been released,
+ *   so that the backtrace logic never runs with the lock held; it may
+ *   itself take locks, including the one that was just released.
+ *
+ * Input Parameters:
+ *   lock - The address of the lock
+ *   hold - The value returned by nxsched_lockstat_release().  The
+ *          backtrace is dropped if another hold has exceeded it since.
+ *
+ ****************************************************************************/
+
+void nxsched_lockstat_backtrace(FAR const void *lock, clock_t hold)
+{
+#if CONFIG_SCHED_LOCKSTAT_BACKTRACE > 0
+  FAR void *backtrace[CONFIG_SCHED_LOCKSTAT_BACKTRACE];
+  irqstate_t flags;
+  int index;
+  int n;
+
+  n = sched_backtrace(_SCHED_GETTID(), backtrace,
+                      CONFIG_SCHED_LOCKSTAT_BACKTRACE, 0);
+  if (n < CONFIG_SCHED_LOCKSTAT_BACKTRACE)
+    {
+      backtrace[n < 0 ? 0 : n] = NULL;
+    }
+
+  flags = spin_lock_irqsave_notrace(&g_lockstat_lock);
+
+  index = nxsched_lockstat_lookup(lock);
+  if (index >= 0 && g_lockstat[index].hold_max == hold)
+    {
+      memcpy(g_lockstat[index].backtrace, backtrace, sizeof(backtrace));
+    }
+
+  spin_unlock_irqrestore_notrace(&g_lockstat_lock, flags);
+#else
+  UNUSED(lock);
+  UNUSED(hold);
+#endif
+}
+
+/****************************************************************************
+ * Name: nxsched_lockstat_forget
+ *
+ * Description:
+ *   Called when a lock is destroyed.  Its entry is reclaimed so that the
+ *   table does not fill up with locks that no longer exist (semaphores on
+ *   the stack or in freed memory) and the address can be reused by an
+ *   unrelated lock without inheriting its statistics.
+ *
+ ****************************************************************************/
+
+void nxsched_lockstat_forget(FAR const void *lock)
+{
+  irqstate_t flags;
+  unsigned int hole;
+  unsigned int next;
+  unsigned int home;
+  unsigned int i;
+  int index;
+
+  flags = spin_lock_irqsave_notrace(&g_lockstat_lock);
+
+  index = nxsched_lockstat_lookup(lock);
+  if (index >= 0)
+    {
+      /* Backward shift deletion: move up the following entries of the
+       * probe sequence whose home slot does not lie between the hole and
+       * their current slot, so that lookups never stop at the hole.
+       * No probe sequence is longer than the table, which may be full.
+       */
+
+      hole = index;
+      next = hole;
+      for (i = 1; i < CONFIG_SCHED_LOCKSTAT_NENTRIES; i++)
+        {
+          if (++next >= CONFIG_SCHED_LOCKSTAT_NENTRIES)
+            {
+              next = 0;
+            }
+
+          if (g_lockstat[next].lock == NULL)
+            {
+              break;
+            }
+
+          home = LOCKSTAT_HASH(g_lockstat[next].lock);
+          if (hole <= next ? (home > hole && home <= next) :
+                             (home > hole || home <= next))
+            {
+              continue;
+            }
+
+          memcpy(&g_lockstat[hole], &g_lockstat[next],
+                 sizeof(struct lockstat_s));
+          hole = next;
+        }
+
+      memset(&g_lockstat[hole], 0, sizeof(struct lockstat_s));
+    }
+
+  spin_unlock_irqrestore_notrace(&g_lockstat_lock, flags);
+}
+
+/****************************************************************************
+ * Name: nxsched_lockstat_csection_enter
+ *
+ * Description:
+ *   Called on the outermost entry into a critical section by a thread.
+ *
+ * Input Parameters:
+ *   caller - The caller of enter_critical_section(), used as the key
+ *   start  - The perf_gettime() time when the caller started to wait for
+ *            another CPU to leave its critical section, zero if it did
+ *            not have to wait.
+ *
+ ****************************************************************************/
+
+void nxsched_lockstat_csection_enter(FAR void *caller, clock_t start)
+{
+  FAR struct lockstat_s *entry;
+  irqstate_t flags;
+  clock_t now = perf_gettime();
+
+  flags = spin_lock_irqsave_notrace(&g_lockstat_lock);
+  entry = nxsched_lockstat_find(caller, LOCKSTAT_CSECTION);
+  if (entry != NULL)
+    {
+      nxsched_lockstat_account(entry, start, now);
+    }
+
+  g_lockstat_csection[this_cpu()] = entry != NULL ? caller : NULL;
+  spin_unlock_irqrestore_notrace(&g_lockstat_lock, flags);
+}
+
+/****************************************************************************
+ * Name: nxsched_lockstat_csection_leave
+ *
+ * Description:
+ *   Called on the outermost exit from a critical section by a thread.
+ *
+ * Output Parameters:
+ *   caller - The key of the critical section, to be passed to
+ *            nxsched_lockstat_backtrace() together with the returned value.
+ *
+ * Returned Value:
+ *   See nxsched_lockstat_release().
+ *
+ ****************************************************************************/
+
+clock_t nxsched_lockstat_csection_leave(FAR const void **caller)
+{
+  irqstate_t flags;
+  clock_t hold = 0;
+  int index = -1;
+  int cpu;
+
+  flags = spin_lock_irqsave_notrace(&g_lockstat_lock);
+
+  cpu     = this_cpu();
+  *caller = g_lockstat_csection[cpu];
+  g_lockstat_csection[cpu] = NULL;
+
+  if (*caller != NULL)
+    {
+      index = nxsched_lockstat_lookup(*caller);
+    }
+
+  if (index >= 0)
+    {
+      hold = nxsched_lockstat_unhold(&g_lockstat[index]);
+    }
+
+  spin_unlock_irqrestore_notrace(&g_lockstat_lock, flags);
+  return hold;
+}
+
+#ifdef CONFIG_SCHED_LOCKSTAT_SPINLOCK
+/****************************************************************************
+ * Name: sched_lockstat_spinlock_lock
+ *
+ * Description:
+ *   Called before a spinlock is taken.  Returns the time to be passed to
+ *   sched_lockstat_spinlock_locked(), zero if the lock is free.
+ *
+ ****************************************************************************/
+
+clock_t sched_lockstat_spinlock_lock(FAR volatile spinlock_t *spinlock)
+{
+  return spin_is_locked(spinlock) ? perf_gettime() : 0;
+}
+
+/****************************************************************************
+ * Name: sched_lockstat_spinlock_locked
+ *
+ * Description:
+ *   Called when a spinlock has been taken.
+ *
+ ****************************************************************************/
+
+void sched_lockstat_spinlock_locked(FAR volatile spinlock_t *spinlock,
+                                    clock_t start)
+{
+  nxsched_lockstat_acquire((FAR const void *)spinlock, LOCKSTAT_SPINLOCK,
+                           start);
+}
+
+/****************************************************************************
+ * Name: sched_lockstat_spinlock_unlock
+ *
+ * Description:
+ *   Called before a spinlock is released.  Returns the value to be passed
+ *   to sched_lockstat_spinlock_unlocked().
+ *
+ ****************************************************************************/
+
+clock_t sched_lockstat_spinlock_unlock(FAR volatile spinlock_t *spinlock)
+{
+  return nxsched_lockstat_release((FAR const void *)spinlock);
+}
+
+/****************************************************************************
+ * Name: sched_lockstat_spinlock_unlocked
+ *
+ * Description:
+ *   Called after a spinlock has been released, with the interrupts
+ *   restored, to save the backtrace of a new longest holder.
+ *
+ ****************************************************************************/
+
+void sched_lockstat_spinlock_unlocked(FAR volatile spinlock_t *spinlock,
+                                      clock_t hold)
+{
+  nxsched_lockstat_backtrace((FAR const void *)spinlock, hold);
+}
+#endif
+
+/****************************************************************************
+ * Name: nxsched_lockstat_reset
+ *
+ * Description:
+ *   Clear the statistics of all locks.  All the entries of the table are
+ *   released, including those of locks that no longer exist; the locks in
+ *   use get a new entry on their next acquisition.
+ *
+ ****************************************************************************/
+
+void nxsched_lockstat_reset(void)
+{
+  irqstate_t flags;
+
+  flags = spin_lock_irqsave_notrace(&g_lockstat_lock);
+  memset(g_lockstat, 0, sizeof(g_lockstat));
+  memset(g_lockstat_csection, 0, sizeof(g_lockstat_csection));
+  g_lockstat_dropped = 0;
+  spin_unlock_irqrestore_notrace(&g_lockstat_lock, flags);
+}
+
+#endif /* CONFIG_SCHED_LOCKSTAT */
@@ -192,6 +192,13 @@ void nxsched_process_timer(void)
 
   nxsched_process_scheduler();
 
+#if defined(CONFIG_SCHED_PERCPU_READYQ) && \
+    CONFIG_SCHED_PERCPU_READYQ_BALANCE > 0
+  /* Balance the per-CPU ready queues */
+
+  nxsched_balance_readyq();
+#endif
+
   /* Process watchdogs */
 
   wd_timer(clock_systime_ticks());
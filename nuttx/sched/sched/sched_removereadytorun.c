@@ -184,6 +184,7 @@ void nxsched_remove_running(FAR struct tcb_s *tcb)
 
   dq_rem_head((FAR dq_entry_t *)tcb, tasklist);
 
+#ifndef CONFIG_SCHED_PERCPU_READYQ
   /* Find the highest priority non-running tasks in the g_assignedtasks
    * list of other CPUs, and also non-idle tasks, place them in the
    * g_readytorun list. so as to find the task with the highest priority,
@@ -224,6 +225,7 @@ void nxsched_remove_running(FAR struct tcb_s *tcb)
             }
         }
     }
+#endif
 
   /* Which task will go at the head of the list?  It will be either the
    * next tcb in the assigned task list (nxttcb) or a TCB in the
@@ -259,6 +261,27 @@ void nxsched_remove_running(FAR struct tcb_s *tcb)
       rtrtcb->cpu = cpu;
       nxttcb = rtrtcb;
     }
+#ifdef CONFIG_SCHED_PERCPU_READYQ
+  else
+    {
+      /* Otherwise, take the best task waiting in the ready queue of some
+       * other CPU if it has a higher priority than nxttcb.  This is what
+       * keeps the CPUs busy (idle-time load balancing) while tasks stay
+       * on their own CPU as long as it has work for them.
+       */
+
+      rtrtcb = nxsched_pull_task(cpu, nxttcb->sched_priority);
+      if (rtrtcb != NULL)
+        {
+          dq_rem((FAR dq_entry_t *)rtrtcb,
+                 list_assignedtasks(rtrtcb->cpu));
+          dq_addfirst_nonempty((FAR dq_entry_t *)rtrtcb, tasklist);
+
+          rtrtcb->cpu = cpu;
+          nxttcb = rtrtcb;
+        }
+    }
+#endif
 
   /* NOTE: If the task runs on another CPU(cpu), adjusting global IRQ
    * controls will be done in the pause handler on the new CPU(cpu).
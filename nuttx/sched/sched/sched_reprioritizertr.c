@@ -58,6 +58,10 @@
 bool nxsched_reprioritize_rtr(FAR struct tcb_s *tcb, int priority)
 {
   bool switch_needed;
+#ifdef CONFIG_SCHED_LATENCYMON
+  clock_t wakeup_start    = tcb->wakeup_start;
+  clock_t wakeup_irqstart = tcb->wakeup_irqstart;
+#endif
 
   /* Remove the tcb task from the ready-to-run list.
    * nxsched_remove_readytorun will return true if we just
@@ -80,6 +84,13 @@ bool nxsched_reprioritize_rtr(FAR struct tcb_s *tcb, int priority)
 
   switch_needed ^= nxsched_add_readytorun(tcb);
 
+#ifdef CONFIG_SCHED_LATENCYMON
+  /* This is not a wakeup, keep the latency measurement as it was */
+
+  tcb->wakeup_start    = wakeup_start;
+  tcb->wakeup_irqstart = wakeup_irqstart;
+#endif
+
   /* If we are going to do a context switch, then now is the right
    * time to add any pending tasks back into the ready-to-run list.
    */
@@ -134,6 +134,16 @@ static FAR struct tcb_s *nxsched_nexttcb(FAR struct tcb_s *tcb)
         {
           return rtrtcb;
         }
+
+#ifdef CONFIG_SCHED_PERCPU_READYQ
+      /* Or a task waiting in the ready queue of another CPU */
+
+      rtrtcb = nxsched_pull_task(tcb->cpu, nxttcb->sched_priority);
+      if (rtrtcb != NULL)
+        {
+          return rtrtcb;
+        }
+#endif
     }
 
   /* Otherwise, return the next TCB in the g_assignedtasks[] list...
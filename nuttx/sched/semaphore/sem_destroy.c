@@ -28,6 +28,7 @@
 
 #include <errno.h>
 
+#include "sched/sched.h"
 #include "semaphore/semaphore.h"
 
 /****************************************************************************
@@ -91,5 +92,12 @@ int nxsem_destroy(FAR sem_t *sem)
   /* Release holders of the semaphore */
 
   nxsem_destroyholder(sem);
+
+#ifdef CONFIG_SCHED_LOCKSTAT
+  /* Forget the statistics of the semaphore, its memory may be reused */
+
+  nxsched_lockstat_forget(sem);
+#endif
+
   return OK;
 }
@@ -32,6 +32,8 @@
 
 #include <nuttx/arch.h>
 #include <nuttx/mm/kmap.h>
+#include <nuttx/mutex.h>
+#include <nuttx/nuttx.h>
 
 #include "sched/sched.h"
 #include "semaphore/semaphore.h"
@@ -42,6 +44,16 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+/* The holder of a mutex.  Every mutex_t embeds one with pre-allocated
+ * holders, otherwise it is the single holder slot of the semaphore.
+ */
+
+#ifdef NXMUTEX_HAVE_HOLDER
+#  define NXSEM_MUTEX_HOLDER(s) (&container_of(s, mutex_t, sem)->holder)
+#else
+#  define NXSEM_MUTEX_HOLDER(s) (&(s)->holder)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -210,6 +222,15 @@ static inline void nxsem_freeholder(FAR sem_t *sem,
   pholder->counts = 0;
 
 #if CONFIG_SEM_PREALLOCHOLDERS > 0
+  /* The holder of a mutex is embedded in the mutex, it is neither in the
+   * semaphore's list nor in the free list.
+   */
+
+  if (NXSEM_IS_MUTEX(sem))
+    {
+      return;
+    }
+
   /* Remove the holder from the semaphore's list */
 
   for (curr = &sem->hhead;
@@ -230,6 +251,47 @@ static inline void nxsem_freeholder(FAR sem_t *sem,
 #endif
 }
 
+/****************************************************************************
+ * Name: nxsem_mutex_addholder
+ *
+ * Description:
+ *   A mutex has exactly one holder, so its holder structure is embedded in
+ *   the mutex and the owner TCB is stored there directly.  Linking it into
+ *   the owner's list of held semaphores needs neither a search through the
+ *   holders nor an allocation.
+ *
+ ****************************************************************************/
+
+static void nxsem_mutex_addholder(FAR sem_t *sem, FAR struct tcb_s *htcb)
+{
+  FAR struct semholder_s *pholder = NXSEM_MUTEX_HOLDER(sem);
+
+  if (pholder->htcb == htcb)
+    {
+      return;
+    }
+
+  /* Drop a stale owner, e.g. if the mutex was reset */
+
+  if (pholder->htcb != NULL)
+    {
+      nxsem_freeholder(sem, pholder);
+    }
+
+#ifdef CONFIG_MM_KMAP
+  sem = kmm_map_user(this_task(), sem, sizeof(*sem));
+#endif
+
+  pholder->sem    = sem;
+  pholder->htcb   = htcb;
+  pholder->counts = 1;
+
+  /* Put it into the task's list */
+
+  pholder->tlink  = htcb->holdsem;
+  htcb->holdsem   = pholder;
+}
+
 /****************************************************************************
  * Name: nxsem_freecount0holder
  ****************************************************************************/
@@ -267,22 +329,28 @@ static int nxsem_foreachholder(FAR sem_t *sem, holderhandler_t handler,
 #if CONFIG_SEM_PREALLOCHOLDERS > 0
   FAR struct semholder_s *next;
 
-  for (pholder = sem->hhead; pholder && ret == 0; pholder = next)
+  if (!NXSEM_IS_MUTEX(sem))
     {
-      /* In case this holder gets deleted */
+      for (pholder = sem->hhead; pholder && ret == 0; pholder = next)
+        {
+          /* In case this holder gets deleted */
 
-      next = pholder->flink;
+          next = pholder->flink;
 
-      DEBUGASSERT(pholder->htcb != NULL);
+          DEBUGASSERT(pholder->htcb != NULL);
 
-      /* Call the handler */
+          /* Call the handler */
 
-      ret = handler(pholder, sem, arg);
+          ret = handler(pholder, sem, arg);
+        }
+
+      return ret;
     }
-#else
-  /* We have one hard-allocated holder structures in sem_t */
+#endif
 
-  pholder = &sem->holder;
+  /* The holder of a mutex, or the one hard-allocated holder in sem_t */
+
+  pholder = NXSEM_MUTEX_HOLDER(sem);
 
   /* The hard-allocated containers may hold a NULL holder */
 
@@ -292,7 +360,6 @@ static int nxsem_foreachholder(FAR sem_t *sem, holderhandler_t handler,
 
       ret = handler(pholder, sem, arg);
     }
-#endif
 
   return ret;
 }
@@ -388,7 +455,8 @@ static int nxsem_dumpholder(FAR struct semholder_s *pholder, FAR sem_t *sem,
  * Name: nxsem_restore_priority
  ****************************************************************************/
 
-static void nxsem_restore_priority(FAR struct tcb_s *htcb)
+static void nxsem_restore_priority(FAR struct tcb_s *htcb,
+                                   FAR struct tcb_s *skip)
 {
   int hpriority;
 
@@ -409,7 +477,8 @@ static void nxsem_restore_priority(FAR struct tcb_s *htcb)
       FAR struct semholder_s *pholder;
 
       /* Try to find the highest priority across all the threads that are
-       * waiting for any semaphore held by htcb.
+       * waiting for any semaphore held by htcb, except 'skip' that is
+       * about to stop waiting.
        */
 
       for (pholder = htcb->holdsem; pholder != NULL;
@@ -418,6 +487,10 @@ static void nxsem_restore_priority(FAR struct tcb_s *htcb)
           FAR struct tcb_s *stcb;
 
           stcb = (FAR struct tcb_s *)dq_peek(SEM_WAITLIST(pholder->sem));
+          if (stcb != NULL && stcb == skip)
+            {
+              stcb = stcb->flink;
+            }
 
           if (stcb != NULL && stcb->sched_priority > hpriority)
             {
@@ -453,7 +526,7 @@ static int nxsem_restoreholderprio(FAR struct semholder_s *pholder,
       nxsem_freeholder(sem, pholder);
     }
 
-  nxsem_restore_priority(htcb);
+  nxsem_restore_priority(htcb, NULL);
 
   return 0;
 }
@@ -634,6 +707,12 @@ void nxsem_add_holder_tcb(FAR struct tcb_s *htcb, FAR sem_t *sem)
 
   if (!is_idle_task(htcb) && prioinherit == SEM_PRIO_INHERIT)
     {
+      if (NXSEM_IS_MUTEX(sem))
+        {
+          nxsem_mutex_addholder(sem, htcb);
+          return;
+        }
+
       /* Find or allocate a container for this new holder */
 
       pholder = nxsem_findorallocateholder(sem, htcb);
@@ -737,6 +816,21 @@ void nxsem_release_holder(FAR sem_t *sem)
       /* Find the container for this holder */
 
 #if CONFIG_SEM_PREALLOCHOLDERS > 0
+      if (NXSEM_IS_MUTEX(sem))
+        {
+          /* The mutex is handed over, the holder is released now and the
+           * priority of this task is restored in nxsem_restore_baseprio.
+           */
+
+          pholder = NXSEM_MUTEX_HOLDER(sem);
+          if (pholder->htcb != NULL)
+            {
+              nxsem_freeholder(sem, pholder);
+            }
+
+          return;
+        }
+
       for (pholder = sem->hhead; pholder != NULL; pholder = pholder->flink)
         {
           DEBUGASSERT(pholder->counts > 0);
@@ -816,6 +910,17 @@ void nxsem_restore_baseprio(FAR struct tcb_s *stcb, FAR sem_t *sem)
   if (stcb != NULL)
     {
 #if CONFIG_SEM_PREALLOCHOLDERS > 0
+      if (NXSEM_IS_MUTEX(sem))
+        {
+          /* The holder was already released in nxsem_release_holder and
+           * the new owner is the highest priority waiter, only restore
+           * the priority of this task.
+           */
+
+          nxsem_restore_priority(this_task(), NULL);
+          return;
+        }
+
       /* The currently executed thread should be the lower priority
        * thread that just posted the count and caused this action.
        * However, we cannot drop the priority of the currently running
@@ -836,7 +941,7 @@ void nxsem_restore_baseprio(FAR struct tcb_s *stcb, FAR sem_t *sem)
        * the older owner when posted the count.
        */
 
-      nxsem_restore_priority(this_task());
+      nxsem_restore_priority(this_task(), NULL);
 #endif
     }
   else
@@ -884,6 +989,36 @@ void nxsem_canceled(FAR struct tcb_s *stcb, FAR sem_t *sem)
   DEBUGASSERT(!NXSEM_IS_MUTEX(sem) ||
               NXSEM_MACQUIRED(atomic_read(NXSEM_MHOLDER(sem))));
 
+  if (NXSEM_IS_MUTEX(sem))
+    {
+      FAR struct semholder_s *pholder = NXSEM_MUTEX_HOLDER(sem);
+      FAR struct tcb_s *htcb = pholder->htcb;
+      FAR struct tcb_s *wtcb;
+
+      if (htcb == NULL)
+        {
+          return;
+        }
+
+      /* The owner stays in the holder as long as some other thread keeps
+       * waiting for the mutex, so that it keeps the boosted priority.
+       */
+
+      wtcb = (FAR struct tcb_s *)dq_peek(SEM_WAITLIST(sem));
+      if (wtcb == stcb)
+        {
+          wtcb = wtcb->flink;
+        }
+
+      if (wtcb == NULL)
+        {
+          nxsem_freeholder(sem, pholder);
+        }
+
+      nxsem_restore_priority(htcb, stcb);
+      return;
+    }
+
   /* Adjust the priority of every holder as necessary */
 
   nxsem_foreachholder(sem, nxsem_restoreholderprio, stcb);
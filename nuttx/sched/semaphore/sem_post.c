@@ -32,6 +32,7 @@
 
 #include <nuttx/irq.h>
 #include <nuttx/arch.h>
+#include <nuttx/lockstat.h>
 
 #include "sched/sched.h"
 #include "semaphore/semaphore.h"
@@ -79,6 +80,9 @@ int nxsem_post_slow(FAR sem_t *sem)
   bool blocking = false;
   bool mutex = NXSEM_IS_MUTEX(sem);
   uint32_t mholder = NXSEM_NO_MHOLDER;
+#ifdef CONFIG_SCHED_LOCKSTAT
+  clock_t hold = 0;
+#endif
 
   /* The following operations must be performed with interrupts
    * disabled because sem_post() may be called from an interrupt
@@ -87,6 +91,13 @@ int nxsem_post_slow(FAR sem_t *sem)
 
   flags = enter_critical_section();
 
+#ifdef CONFIG_SCHED_LOCKSTAT
+  if (mutex)
+    {
+      hold = nxsched_lockstat_release(sem);
+    }
+#endif
+
   if (mutex)
     {
       /* Mutex post from interrupt context is not allowed */
@@ -253,5 +264,16 @@ int nxsem_post_slow(FAR sem_t *sem)
 
   leave_critical_section(flags);
 
+#ifdef CONFIG_SCHED_LOCKSTAT
+  /* Save the backtrace of a new longest holder outside of the critical
+   * section.
+   */
+
+  if (hold != 0)
+    {
+      nxsched_lockstat_backtrace(sem, hold);
+    }
+#endif
+
   return OK;
 }
@@ -34,6 +34,7 @@
 #include <nuttx/init.h>
 #include <nuttx/irq.h>
 #include <nuttx/arch.h>
+#include <nuttx/lockstat.h>
 
 #include "sched/sched.h"
 #include "semaphore/semaphore.h"
@@ -127,6 +128,10 @@ int nxsem_trywait_slow(FAR sem_t *sem)
       nxsem_add_holder(sem);
     }
 
+#ifdef CONFIG_SCHED_LOCKSTAT
+  nxsched_lockstat_acquire(sem, mutex ? LOCKSTAT_MUTEX : LOCKSTAT_SEM, 0);
+#endif
+
 out:
 
   /* Interrupts may now be enabled. */
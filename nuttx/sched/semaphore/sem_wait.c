@@ -33,6 +33,7 @@
 #include <nuttx/init.h>
 #include <nuttx/irq.h>
 #include <nuttx/arch.h>
+#include <nuttx/lockstat.h>
 #include <nuttx/mm/kmap.h>
 
 #include "sched/sched.h"
@@ -77,6 +78,9 @@ int nxsem_wait_slow(FAR sem_t *sem)
   bool unlocked;
   FAR struct tcb_s *htcb = NULL;
   bool mutex = NXSEM_IS_MUTEX(sem);
+#ifdef CONFIG_SCHED_LOCKSTAT
+  clock_t start = 0;
+#endif
 
   /* The following operations must be performed with interrupts
    * disabled because nxsem_post() may be called from an interrupt
@@ -213,6 +217,10 @@ int nxsem_wait_slow(FAR sem_t *sem)
 
       DEBUGASSERT(!is_idle_task(rtcb));
 
+#ifdef CONFIG_SCHED_LOCKSTAT
+      start = perf_gettime();
+#endif
+
       /* Remove the tcb task from the running list. */
 
       nxsched_remove_self(rtcb);
@@ -280,6 +288,14 @@ int nxsem_wait_slow(FAR sem_t *sem)
       atomic_set(NXSEM_MHOLDER(sem), ((uint32_t)rtcb->pid) | blocking_bit);
     }
 
+#ifdef CONFIG_SCHED_LOCKSTAT
+  if (ret == OK)
+    {
+      nxsched_lockstat_acquire(sem, mutex ? LOCKSTAT_MUTEX : LOCKSTAT_SEM,
+                               start);
+    }
+#endif
+
   leave_critical_section(flags);
   return ret;
 }
@@ -38,6 +38,7 @@
 
 #include <nuttx/irq.h>
 #include <nuttx/arch.h>
+#include <nuttx/hrtimer.h>
 #include <nuttx/wdog.h>
 #include <nuttx/signal.h>
 #include <nuttx/cancelpt.h>
@@ -124,6 +125,23 @@ static void nxsig_timeout(wdparm_t arg)
   leave_critical_section(flags);
 }
 
+/****************************************************************************
+ * Name: nxsig_hrtimeout
+ *
+ * Description:
+ *   The hrtimer elapsed while waiting for signals to be queued.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_HRTIMER
+static uint64_t nxsig_hrtimeout(FAR struct hrtimer_s *hrtimer,
+                                uint64_t expired)
+{
+  nxsig_timeout((wdparm_t)(uintptr_t)hrtimer->arg);
+  return 0;
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -248,6 +266,10 @@ int nxsig_clockwait(int clockid, int flags,
   irqstate_t        iflags;
   clock_t expect = 0;
   clock_t stop;
+#ifdef CONFIG_HRTIMER
+  struct hrtimer_s hrtimer;
+  bool usehrtimer = false;
+#endif
 
   if (rqtp && (rqtp->tv_nsec < 0 || rqtp->tv_nsec >= 1000000000))
     {
@@ -295,6 +317,30 @@ int nxsig_clockwait(int clockid, int flags,
     {
       /* Start the watchdog timer */
 
+#ifdef CONFIG_HRTIMER
+      /* Relative and monotonic waits do not need to be rounded up to the
+       * next tick, use a high-resolution timer for them.  Absolute times
+       * on the other clocks are not on the hrtimer time base.
+       *
+       * hrtimer_cancel_sync() below waits for a callback running on
+       * another CPU, which enters the critical section.  A caller that
+       * holds the critical section already would deadlock with it and
+       * keeps using the wdog.
+       */
+
+      if (((flags & TIMER_ABSTIME) == 0 || clockid == CLOCK_MONOTONIC)
+#ifdef CONFIG_SMP
+          && rtcb->irqcount == 1
+#endif
+         )
+        {
+          usehrtimer = true;
+          hrtimer_init(&hrtimer, nxsig_hrtimeout, rtcb);
+          hrtimer_start_ts(&hrtimer, rqtp, (flags & TIMER_ABSTIME) ?
+                           HRTIMER_MODE_ABS : HRTIMER_MODE_REL);
+        }
+      else
+#endif
       if ((flags & TIMER_ABSTIME) == 0)
         {
           expect = clock_delay2abstick(clock_time2ticks(rqtp));
@@ -330,12 +376,42 @@ int nxsig_clockwait(int clockid, int flags,
 
   if (rqtp)
     {
-      wd_cancel(&rtcb->waitdog);
+#ifdef CONFIG_HRTIMER
+      if (usehrtimer)
+        {
+          if (rmtp && (flags & TIMER_ABSTIME) == 0)
+            {
+              clock_nsec2time(rmtp, hrtimer_remaining(&hrtimer));
+            }
+
+          hrtimer_cancel(&hrtimer);
+        }
+      else
+#endif
+        {
+          wd_cancel(&rtcb->waitdog);
+        }
+
       stop = clock_systime_ticks();
     }
 
   leave_critical_section(iflags);
 
+#ifdef CONFIG_HRTIMER
+  /* The hrtimer is on the stack, wait for a callback that is still running
+   * on another CPU.  That callback enters the critical section, which this
+   * CPU must not hold any longer.
+   */
+
+  if (usehrtimer)
+    {
+#ifdef CONFIG_SMP
+      DEBUGASSERT(rtcb->irqcount == 0);
+#endif
+      hrtimer_cancel_sync(&hrtimer);
+    }
+#endif
+
   if (rqtp && rmtp && expect)
     {
       clock_ticks2time(rmtp, expect > stop ? expect - stop : 0);
@@ -636,6 +636,18 @@ static const char *g_white_content_list[] =
   "unzGetCurrentFileInfo64",
   "unzGoToNextFile",
   "unzGoToFirstFile",
+  "unzGetGlobalInfo64",
+  "unzGetFilePos64",
+  "unzGoToFilePos64",
+  "unzOpenCurrentFile2",
+  "unzCloseCurrentFile",
+  "unzGetCurrentFileZStreamPos64",
+  "uInt",
+  "inflateInit2",
+  "inflateReset",
+  "inflatePrime",
+  "inflateGetDictionary",
+  "inflateSetDictionary",
 
   /* Ref:
    * apps/netutils/telnetc/telnetc.c